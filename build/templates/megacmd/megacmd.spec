@@ -398,6 +398,10 @@ killall -s SIGUSR2 mega-cmd-server 2> /dev/null || true
 %{_bindir}/mega-webdav
 %{_bindir}/mega-permissions
 %{_bindir}/mega-deleteversions
+%{_bindir}/mega-dedup
+%{_bindir}/mega-diff
+%{_bindir}/mega-blockcache
+%{_bindir}/mega-prefetch
 %{_bindir}/mega-transfers
 %{_bindir}/mega-import
 %{_bindir}/mega-invite
@@ -440,6 +444,7 @@ killall -s SIGUSR2 mega-cmd-server 2> /dev/null || true
 %{_bindir}/mega-cancel
 %{_bindir}/mega-confirmcancel
 %{_bindir}/mega-errorcode
+%{_bindir}/mega-startup
 %{_bindir}/mega-cmd
 %{_bindir}/mega-cmd-server
 %{_sysconfdir}/bash_completion.d/megacmd_completion.sh
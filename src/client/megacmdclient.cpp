@@ -29,6 +29,7 @@
 #include <condition_variable>
 #include <memory.h>
 #include <limits.h>
+#include <fstream>
 
 #ifdef _WIN32
 #include <Shlwapi.h> //PathAppend
@@ -241,7 +242,10 @@ string parseArgs(int argc, char* argv[])
         if (!strcmp(argv[1],"get")
                 || !strcmp(argv[1],"put")
                 || !strcmp(argv[1],"login")
-                || !strcmp(argv[1],"reload") )
+                || !strcmp(argv[1],"reload")
+                || !strcmp(argv[1],"deleteversions")
+                || !strcmp(argv[1],"import")
+                || !strcmp(argv[1],"prefetch") )
         {
             int waittime = 15000;
             while (waittime > 0 && !clientID.size())
@@ -330,6 +334,38 @@ string parseArgs(int argc, char* argv[])
                 }
             }
         }
+        else if (!strcmp(argv[1],"diff")) //first arg is a localpath
+        {
+            bool firstRealArg = true;
+            for (int i = 2; i < argc; i++)
+            {
+                if (firstRealArg && strlen(argv[i]) && argv[i][0] !='-' )
+                {
+                    absolutedargs.push_back(getAbsPath(argv[i]));
+                    firstRealArg = false;
+                }
+                else
+                {
+                    absolutedargs.push_back(argv[i]);
+                }
+            }
+        }
+        else if (!strcmp(argv[1],"import")) //manifest files are local
+        {
+            for (int i = 2; i < argc; i++)
+            {
+                if (!strncmp(argv[i], "--manifest=", strlen("--manifest=")) || !strncmp(argv[i], "--results=", strlen("--results=")))
+                {
+                    string option = argv[i];
+                    size_t equals = option.find('=');
+                    absolutedargs.push_back(option.substr(0, equals + 1) + getAbsPath(option.substr(equals + 1)));
+                }
+                else
+                {
+                    absolutedargs.push_back(argv[i]);
+                }
+            }
+        }
         else if (!strcmp(argv[1],"lcd")) //localpath args
         {
             for (int i = 2; i < argc; i++)
@@ -360,6 +396,13 @@ string parseArgs(int argc, char* argv[])
                         absolutedargs.push_back(argv[i]);
                     }
                 }
+                else if (!strcmp(argv[1],"get") && (!strncmp(argv[i], "--manifest=", strlen("--manifest="))
+                                                     || !strncmp(argv[i], "--resume=", strlen("--resume=")))) //manifest files are local
+                {
+                    string option = argv[i];
+                    size_t equals = option.find('=');
+                    absolutedargs.push_back(option.substr(0, equals + 1) + getAbsPath(option.substr(equals + 1)));
+                }
                 else
                 {
                     absolutedargs.push_back(argv[i]);
@@ -467,7 +510,10 @@ wstring parsewArgs(int argc, wchar_t* argv[])
         if (!wcscmp(argv[1],L"get")
                 || !wcscmp(argv[1],L"put")
                 || !wcscmp(argv[1],L"login")
-                || !wcscmp(argv[1],L"reload") )
+                || !wcscmp(argv[1],L"reload")
+                || !wcscmp(argv[1],L"deleteversions")
+                || !wcscmp(argv[1],L"import")
+                || !wcscmp(argv[1],L"prefetch") )
         {
             int waittime = 5000;
             while (waittime > 0 && !clientID.size())
@@ -561,6 +607,38 @@ wstring parsewArgs(int argc, wchar_t* argv[])
                 }
             }
         }
+        else if (!wcscmp(argv[1],L"diff")) //first arg is a localpath
+        {
+            bool firstRealArg = true;
+            for (int i = 2; i < argc; i++)
+            {
+                if (firstRealArg && wcslen(argv[i]) && argv[i][0] !='-' )
+                {
+                    absolutedargs.push_back(getWAbsPath(argv[i]));
+                    firstRealArg = false;
+                }
+                else
+                {
+                    absolutedargs.push_back(argv[i]);
+                }
+            }
+        }
+        else if (!wcscmp(argv[1],L"import")) //manifest files are local
+        {
+            for (int i = 2; i < argc; i++)
+            {
+                if (!wcsncmp(argv[i], L"--manifest=", wcslen(L"--manifest=")) || !wcsncmp(argv[i], L"--results=", wcslen(L"--results=")))
+                {
+                    wstring option = argv[i];
+                    size_t equals = option.find(L'=');
+                    absolutedargs.push_back(option.substr(0, equals + 1) + getWAbsPath(option.substr(equals + 1)));
+                }
+                else
+                {
+                    absolutedargs.push_back(argv[i]);
+                }
+            }
+        }
         else if (!wcscmp(argv[1],L"lcd")) //localpath args
         {
             for (int i = 2; i < argc; i++)
@@ -591,6 +669,13 @@ wstring parsewArgs(int argc, wchar_t* argv[])
                         absolutedargs.push_back(argv[i]);
                     }
                 }
+                else if (!wcscmp(argv[1],L"get") && (!wcsncmp(argv[i], L"--manifest=", wcslen(L"--manifest="))
+                                                      || !wcsncmp(argv[i], L"--resume=", wcslen(L"--resume=")))) //manifest files are local
+                {
+                    wstring option = argv[i];
+                    size_t equals = option.find(L'=');
+                    absolutedargs.push_back(option.substr(0, equals + 1) + getWAbsPath(option.substr(equals + 1)));
+                }
                 else
                 {
                     absolutedargs.push_back(argv[i]);
@@ -882,6 +967,109 @@ void statechangehandle(string statestring)
     }
 }
 
+#define BATCH_MAX_COMMANDS_PER_PETITION 1000
+#define BATCH_MAX_PETITION_SIZE 65536
+
+/**
+ * @brief Executes the commands read from a file (or stdin), one per line (or NUL-delimited with --null).
+ *
+ * Commands are sent to the server in batch petitions, which execute them back to back and return the output
+ * of each one followed by its exit code, so that neither a process nor a connection is needed per command.
+ * Each command is parsed as if it were given to mega-exec, so that relative local paths are relative to this process.
+ * @return the exit code of the first command that failed
+ */
+int executeBatch(MegaCmdShellCommunications *comms, int argc, char* argv[])
+{
+    bool nullDelimited = false;
+    string file;
+    for (int i = 2; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--null") || !strcmp(argv[i], "-0"))
+        {
+            nullDelimited = true;
+        }
+        else
+        {
+            file = argv[i];
+        }
+    }
+
+    istream *input = &cin;
+    ifstream finput;
+    if (file.size() && file != "-")
+    {
+        finput.open(file.c_str());
+        if (!finput.is_open())
+        {
+            cerr << "Could not open batch file: " << file << endl;
+            return MCMD_NOTFOUND;
+        }
+        input = &finput;
+    }
+
+    int outcode = MCMD_OK;
+    string petition;
+    int commandsInPetition = 0;
+    auto sendPetition = [&]()
+    {
+        if (!commandsInPetition)
+        {
+            return;
+        }
+        // no response can be read from the input: confirmations will be answered negatively
+        int petitionOutcode = comms->executeCommand(petition, NULL, COUT, false);
+        if (petitionOutcode != MCMD_OK && outcode == MCMD_OK)
+        {
+            outcode = petitionOutcode;
+        }
+        petition.clear();
+        commandsInPetition = 0;
+    };
+
+    string line;
+    while (getline(*input, line, nullDelimited ? '\0' : '\n'))
+    {
+        if (line.size() && line[line.size() - 1] == '\r')
+        {
+            line.resize(line.size() - 1);
+        }
+        if (!line.size() || line[0] == '#' || line.find(BATCH_COMMAND_SEPARATOR) != string::npos)
+        {
+            continue;
+        }
+
+        vector<char> linebuffer(line.begin(), line.end());
+        linebuffer.push_back('\0');
+        vector<string> words = getlistOfWords(linebuffer.data());
+        if (!words.size())
+        {
+            continue;
+        }
+
+        vector<char *> args;
+        args.push_back(argv[0]);
+        for (auto &word : words)
+        {
+            args.push_back((char *)word.c_str());
+        }
+
+        if (!petition.size())
+        {
+            petition = nullDelimited ? BATCH_PETITION " --null" : BATCH_PETITION;
+        }
+        petition += BATCH_COMMAND_SEPARATOR;
+        petition += parseArgs(int(args.size()), args.data());
+
+        if (++commandsInPetition >= BATCH_MAX_COMMANDS_PER_PETITION || petition.size() >= BATCH_MAX_PETITION_SIZE)
+        {
+            sendPetition();
+        }
+    }
+    sendPetition();
+
+    return outcode;
+}
+
 } //end namespace
 
 using namespace megacmd;
@@ -946,6 +1134,12 @@ int main(int argc, char* argv[])
         }
     } while (serverTryingToLog && !isInloginInValidCommands);
 
+    if (command == "--batch")
+    {
+        int outcode = executeBatch(comms, argc, argv);
+        delete comms;
+        return (outcode < 0) ? -outcode : outcode;
+    }
 
 #ifdef _WIN32
     int outcode = comms->executeCommandW(wParsedArgs, readresponse, COUT, false);
@@ -0,0 +1,2 @@
+@echo off
+"%~dp0MegaClient.exe" diff %*
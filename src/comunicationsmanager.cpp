@@ -64,6 +64,11 @@ void ComunicationsManager::stopWaiting()
 {
 }
 
+int ComunicationsManager::prepareListeningSocketInheritance()
+{
+    return -1;
+}
+
 int ComunicationsManager::get_next_comm_id()
 {
     return 0;
@@ -79,6 +79,13 @@ public:
 
     virtual void stopWaiting();
 
+    /**
+     * @brief Prepares the listening endpoint to be inherited by a new server exec'd from this process,
+     * so that clients are queued rather than rejected while the new server starts (see restartServer)
+     * @return the descriptor to pass to the new server, or -1 if not supported
+     */
+    virtual int prepareListeningSocketInheritance();
+
     virtual int get_next_comm_id();
 
     /**
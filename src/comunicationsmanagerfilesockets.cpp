@@ -131,14 +131,54 @@ int ComunicationsManagerFileSockets::create_new_socket(int *sockId)
 }
 
 
-ComunicationsManagerFileSockets::ComunicationsManagerFileSockets()
+ComunicationsManagerFileSockets::ComunicationsManagerFileSockets(int inheritedSocket)
 {
     count = 0;
-    initialize();
+    listeningSocketHandedOff = false;
+    if (pipe(wakeupPipe))
+    {
+        LOG_err << "ERROR creating wake up pipe: " << errno;
+        wakeupPipe[0] = wakeupPipe[1] = -1;
+    }
+    else
+    {
+        fcntl(wakeupPipe[0], F_SETFD, FD_CLOEXEC);
+        fcntl(wakeupPipe[1], F_SETFD, FD_CLOEXEC);
+    }
+    initialize(inheritedSocket);
 }
 
-int ComunicationsManagerFileSockets::initialize()
+int ComunicationsManagerFileSockets::initialize(int inheritedSocket)
 {
+    char socketPath[60];
+    bzero(socketPath, sizeof( socketPath ) * sizeof( *socketPath ));
+    sprintf(socketPath, "/tmp/megaCMD_%d/srv", getuid());
+
+    if (inheritedSocket >= 0)
+    {
+        // only valid if it is still listening on the expected path
+        int accepting = 0;
+        socklen_t optlen = sizeof( accepting );
+        struct sockaddr_un boundaddr;
+        socklen_t boundaddrlen = sizeof( boundaddr );
+        memset(&boundaddr, 0, sizeof( boundaddr ));
+        if (!getsockopt(inheritedSocket, SOL_SOCKET, SO_ACCEPTCONN, &accepting, &optlen) && accepting
+                && !getsockname(inheritedSocket, (struct sockaddr*)&boundaddr, &boundaddrlen)
+                && boundaddr.sun_family == AF_UNIX && !strncmp(boundaddr.sun_path, socketPath, sizeof( boundaddr.sun_path )))
+        {
+            if (fcntl(inheritedSocket, F_SETFD, FD_CLOEXEC) == -1)
+            {
+                LOG_err << "ERROR setting CLOEXEC to socket: " << errno;
+            }
+            sockfd = inheritedSocket;
+            LOG_debug << "Using listening socket inherited from former server: " << socketPath;
+            return 0;
+        }
+
+        LOG_warn << "Inherited socket " << inheritedSocket << " is not listening on " << socketPath << ". Creating a new one";
+        close(inheritedSocket);
+    }
+
     MegaFileSystemAccess *fsAccess = new MegaFileSystemAccess();
     char csocketsFolder[34]; // enough to hold all numbers up to 64-bits
     sprintf(csocketsFolder, "/tmp/megaCMD_%d", getuid());
@@ -169,10 +209,6 @@ int ComunicationsManagerFileSockets::initialize()
     memset(&addr, 0, sizeof( addr ));
     addr.sun_family = AF_UNIX;
 
-    char socketPath[60];
-    bzero(socketPath, sizeof( socketPath ) * sizeof( *socketPath ));
-    sprintf(socketPath, "/tmp/megaCMD_%d/srv", getuid());
-
     strncpy(addr.sun_path, socketPath, sizeof( addr.sun_path ) - 1);
 
     unlink(socketPath);
@@ -213,6 +249,10 @@ int ComunicationsManagerFileSockets::waitForPetition()
     {
         FD_SET(sockfd, &fds);
     }
+    if (wakeupPipe[0] >= 0)
+    {
+        FD_SET(wakeupPipe[0], &fds);
+    }
     int rc = select(FD_SETSIZE, &fds, NULL, NULL, NULL);
     if (rc < 0)
     {
@@ -230,6 +270,17 @@ void ComunicationsManagerFileSockets::stopWaiting()
 #ifdef _WIN32
     shutdown(sockfd,SD_BOTH);
 #else
+    if (listeningSocketHandedOff && wakeupPipe[1] >= 0)
+    {
+        // the socket is shared with the new server: shutting it down would stop it from listening too
+        LOG_verbose << "Waking up main socket waiter";
+        if (write(wakeupPipe[1], "w", 1) != 1)
+        {
+            LOG_err << "ERROR writing to wake up pipe: " << errno;
+        }
+        return;
+    }
+
     LOG_verbose << "Shutting down main socket ";
 
     if (shutdown(sockfd,SHUT_RDWR) == -1)
@@ -659,8 +710,28 @@ string ComunicationsManagerFileSockets::get_petition_details(CmdPetition *inf)
 }
 
 
+int ComunicationsManagerFileSockets::prepareListeningSocketInheritance()
+{
+    if (sockfd < 0)
+    {
+        return -1;
+    }
+    if (fcntl(sockfd, F_SETFD, 0) == -1)
+    {
+        LOG_err << "ERROR clearing CLOEXEC of listening socket: " << errno;
+        return -1;
+    }
+    listeningSocketHandedOff = true;
+    return sockfd;
+}
+
 ComunicationsManagerFileSockets::~ComunicationsManagerFileSockets()
 {
+    if (wakeupPipe[0] >= 0)
+    {
+        close(wakeupPipe[0]);
+        close(wakeupPipe[1]);
+    }
 }
 }//end namespace
 
@@ -55,6 +55,8 @@ private:
 
     // sockets and asociated variables
     int sockfd, newsockfd;
+    int wakeupPipe[2]; // to wake up waitForPetition without shutting down sockfd
+    bool listeningSocketHandedOff;
     socklen_t clilen;
     char buffer[1024];
     struct sockaddr_in serv_addr, cli_addr;
@@ -72,9 +74,12 @@ private:
     int create_new_socket(int *sockId);
 
 public:
-    ComunicationsManagerFileSockets();
+    /**
+     * @param inheritedSocket listening socket inherited from a former server (see prepareListeningSocketInheritance). -1 to create a new one
+     */
+    ComunicationsManagerFileSockets(int inheritedSocket = -1);
 
-    int initialize();
+    int initialize(int inheritedSocket = -1);
 
     bool receivedPetition();
 
@@ -84,6 +89,8 @@ public:
 
     virtual void stopWaiting();
 
+    int prepareListeningSocketInheritance();
+
     void registerStateListener(CmdPetition *inf);
 
     /**
@@ -59,6 +59,8 @@ int ConfigurationManager::fd;
 map<string, sync_struct *> ConfigurationManager::configuredSyncs;
 string ConfigurationManager::session;
 std::set<std::string> ConfigurationManager::excludedNames;
+std::mutex ConfigurationManager::exclusionMatcherMutex;
+std::shared_ptr<ExclusionMatcher> ConfigurationManager::exclusionMatcher;
 map<std::string, backup_struct *> ConfigurationManager::configuredBackups;
 std::recursive_mutex ConfigurationManager::settingsMutex;
 
@@ -341,6 +343,7 @@ void ConfigurationManager::addExcludedName(string excludedName)
     LOG_verbose << "Adding: " << excludedName << " to exclusion list";
     excludedNames.insert(excludedName);
     saveExcludedNames();
+    compileExcludedNames();
 }
 
 void ConfigurationManager::removeExcludedName(string excludedName)
@@ -349,6 +352,7 @@ void ConfigurationManager::removeExcludedName(string excludedName)
     LOG_verbose << "Removing: " << excludedName << " from exclusion list";
     excludedNames.erase(excludedName);
     saveExcludedNames();
+    compileExcludedNames();
 }
 
 void ConfigurationManager::saveExcludedNames()
@@ -426,6 +430,25 @@ void ConfigurationManager::loadExcludedNames()
             fi.close();
         }
     }
+    compileExcludedNames();
+}
+
+void ConfigurationManager::compileExcludedNames()
+{
+    std::lock_guard<std::recursive_mutex> g(settingsMutex);
+    std::shared_ptr<ExclusionMatcher> compiled = std::make_shared<ExclusionMatcher>(excludedNames);
+    std::lock_guard<std::mutex> gm(exclusionMatcherMutex);
+    exclusionMatcher = compiled;
+}
+
+std::shared_ptr<ExclusionMatcher> ConfigurationManager::getExclusionMatcher()
+{
+    std::lock_guard<std::mutex> g(exclusionMatcherMutex);
+    if (!exclusionMatcher)
+    {
+        exclusionMatcher = std::make_shared<ExclusionMatcher>(std::set<string>());
+    }
+    return exclusionMatcher;
 }
 
 void ConfigurationManager::unloadConfiguration()
@@ -447,6 +470,7 @@ void ConfigurationManager::unloadConfiguration()
     }
     ConfigurationManager::session = string();
     ConfigurationManager::excludedNames.clear();
+    compileExcludedNames();
 }
 
 void ConfigurationManager::loadsyncs()
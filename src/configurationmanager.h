@@ -22,6 +22,7 @@
 #include "megacmd.h"
 #include <map>
 #include <set>
+#include <memory>
 
 #ifndef _WIN32
 #include <sys/file.h> // LOCK_EX and LOCK_NB
@@ -29,16 +30,21 @@
 
 #define CONFIGURATIONSTOREDBYVERSION -2
 namespace megacmd {
+class ExclusionMatcher;
+
 class ConfigurationManager
 {
 private:
     static std::string configFolder;
     static bool hasBeenUpdated;
+    static std::mutex exclusionMatcherMutex;
+    static std::shared_ptr<ExclusionMatcher> exclusionMatcher;
 #if !defined(_WIN32) && defined(LOCK_EX) && defined(LOCK_NB)
     static int fd;
 #endif
 
     static void loadConfigDir();
+    static void compileExcludedNames();
 
 
 public:
@@ -70,6 +76,11 @@ public:
      * if called for the first time, it will add default excluded names if no sync has been loaded previously
      */
     static void loadExcludedNames();
+    /**
+     * @brief getExclusionMatcher
+     * @return the excluded names compiled into a matcher, to be used by local walks
+     */
+    static std::shared_ptr<ExclusionMatcher> getExclusionMatcher();
 
     static void saveSession(const char*session);
 
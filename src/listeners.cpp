@@ -74,6 +74,8 @@ MegaCmdGlobalListener::MegaCmdGlobalListener(MegaCMDLogger *logger, MegaCmdSandb
 
 void MegaCmdGlobalListener::onNodesUpdate(MegaApi *api, MegaNodeList *nodes)
 {
+    sandboxCMD->nodePathCache.invalidate(nodes);
+
     long long nfolders = 0;
     long long nfiles = 0;
     long long rfolders = 0;
@@ -160,7 +162,7 @@ void MegaCmdGlobalListener::onAccountUpdate(MegaApi *api)
     {
         sandboxCMD->setOverquota(false);
     }
-    sandboxCMD->temporalbandwidth = 0; //This will cause account details to be queried again
+    sandboxCMD->accountDetails.invalidate(); //This will cause account details to be queried again
 }
 
 void MegaCmdGlobalListener::onEvent(MegaApi *api, MegaEvent *event)
@@ -221,6 +223,7 @@ void MegaCmdGlobalListener::onEvent(MegaApi *api, MegaEvent *event)
     }
     else if (event->getType() == MegaEvent::EVENT_STORAGE)
     {
+        sandboxCMD->accountDetails.invalidate();
         if (event->getNumber() == MegaApi::STORAGE_STATE_CHANGE)
         {
             api->getAccountDetails();
@@ -302,6 +305,7 @@ void MegaCmdGlobalListener::onEvent(MegaApi *api, MegaEvent *event)
     else if (event->getType() == MegaEvent::EVENT_STORAGE_SUM_CHANGED)
     {
         sandboxCMD->receivedStorageSum = event->getNumber();
+        sandboxCMD->accountDetails.invalidate();
     }
 }
 
@@ -626,6 +630,8 @@ void MegaCmdTransferListener::onTransferStart(MegaApi* api, MegaTransfer *transf
         LOG_err << " onTransferStart for undefined Transfer ";
         return;
     }
+    sandboxCMD->bandwidthScheduler.onTransferStart(clientID, transfer);
+    sandboxCMD->transferQueue.onTransferStart(clientID, transfer);
 
     LOG_verbose << "onTransferStart Transfer->getType(): " << transfer->getType();
 }
@@ -642,6 +648,9 @@ void MegaCmdTransferListener::doOnTransferFinish(MegaApi* api, MegaTransfer *tra
         return;
     }
 
+    sandboxCMD->bandwidthScheduler.onTransferFinish(clientID, transfer);
+    sandboxCMD->transferQueue.onTransferFinish(clientID, transfer);
+
     LOG_verbose << "doOnTransferFinish Transfer->getType(): " << transfer->getType();
     informProgressUpdate(PROGRESS_COMPLETE, transfer->getTotalBytes(), clientID);
 
@@ -660,6 +669,8 @@ void MegaCmdTransferListener::onTransferUpdate(MegaApi* api, MegaTransfer *trans
         LOG_err << " onTransferUpdate for undefined Transfer ";
         return;
     }
+    sandboxCMD->bandwidthScheduler.onTransferUpdate(clientID, transfer);
+    sandboxCMD->transferQueue.onTransferUpdate(clientID, transfer);
 
     unsigned int cols = getNumberOfCols(80);
 
@@ -779,6 +790,8 @@ void MegaCmdMultiTransferListener::onTransferStart(MegaApi* api, MegaTransfer *t
         LOG_err << " onTransferStart for undefined Transfer ";
         return;
     }
+    sandboxCMD->bandwidthScheduler.onTransferStart(clientID, transfer);
+    sandboxCMD->transferQueue.onTransferStart(clientID, transfer, priority, deadline);
     alreadyFinished = false;
     if (totalbytes == 0)
     {
@@ -804,6 +817,13 @@ void MegaCmdMultiTransferListener::doOnTransferFinish(MegaApi* api, MegaTransfer
         LOG_err << " onTransferFinish for undefined transfer ";
         return;
     }
+    sandboxCMD->bandwidthScheduler.onTransferFinish(clientID, transfer);
+    sandboxCMD->transferQueue.onTransferFinish(clientID, transfer);
+
+    if (onTransferFinishCallback)
+    {
+        onTransferFinishCallback(transfer, e);
+    }
 
     LOG_verbose << "doOnTransferFinish MegaCmdMultiTransferListener Transfer->getType(): " << transfer->getType() << " transferring " << transfer->getFileName();
 
@@ -851,12 +871,32 @@ void MegaCmdMultiTransferListener::doOnTransferFinish(MegaApi* api, MegaTransfer
 
 void MegaCmdMultiTransferListener::waitMultiEnd()
 {
-    for (int i=0; i < started; i++)
+    for (; waited < started; waited++)
+    {
+        wait();
+    }
+}
+
+void MegaCmdMultiTransferListener::waitForInFlightBelow(int maxInFlight)
+{
+    // each finished transfer releases the semaphore once
+    for (; maxInFlight > 0 && (started - waited) >= maxInFlight; waited++)
     {
         wait();
     }
 }
 
+void MegaCmdMultiTransferListener::setOnTransferFinishCallback(std::function<void (MegaTransfer *, MegaError *)> func)
+{
+    onTransferFinishCallback = std::move(func);
+}
+
+void MegaCmdMultiTransferListener::setPriority(int priority, m_time_t deadline)
+{
+    this->priority = priority;
+    this->deadline = deadline;
+}
+
 
 void MegaCmdMultiTransferListener::onTransferUpdate(MegaApi* api, MegaTransfer *transfer)
 {
@@ -865,6 +905,8 @@ void MegaCmdMultiTransferListener::onTransferUpdate(MegaApi* api, MegaTransfer *
         LOG_err << " onTransferUpdate for undefined Transfer ";
         return;
     }
+    sandboxCMD->bandwidthScheduler.onTransferUpdate(clientID, transfer);
+    sandboxCMD->transferQueue.onTransferUpdate(clientID, transfer);
     ongoingtransferredbytes[transfer->getTag()] = transfer->getTransferredBytes();
     ongoingtotalbytes[transfer->getTag()] = transfer->getTotalBytes();
 
@@ -1001,6 +1043,7 @@ MegaCmdMultiTransferListener::MegaCmdMultiTransferListener(MegaApi *megaApi, Meg
 
     started = 0;
     finished = 0;
+    waited = 0;
     totalbytes = 0;
     transferredbytes = 0;
 
@@ -1008,6 +1051,9 @@ MegaCmdMultiTransferListener::MegaCmdMultiTransferListener(MegaApi *megaApi, Meg
 
     finalerror = MegaError::API_OK;
 
+    priority = 0;
+    deadline = 0;
+
 }
 
 bool MegaCmdMultiTransferListener::onTransferData(MegaApi *api, MegaTransfer *transfer, char *buffer, size_t size)
@@ -1034,17 +1080,15 @@ MegaCmdGlobalTransferListener::MegaCmdGlobalTransferListener(MegaApi *megaApi, M
 
 void MegaCmdGlobalTransferListener::onTransferFinish(MegaApi* api, MegaTransfer *transfer, MegaError* error)
 {
+    // source
+    string nodepath = sandboxCMD->nodePathCache.getNodePath(api, transfer->getNodeHandle());
+
     completedTransfersMutex.lock();
     completedTransfers.push_front(transfer->copy());
 
-    // source
-    MegaNode * node = api->getNodeByHandle(transfer->getNodeHandle());
-    if (node)
+    if (nodepath.size())
     {
-        char * nodepath = api->getNodePath(node);
-        completedPathsByHandle[transfer->getNodeHandle()]=nodepath;
-        delete []nodepath;
-        delete node;
+        completedPathsByHandle[transfer->getNodeHandle()] = nodepath;
     }
 
     if (completedTransfers.size()>MAXCOMPLETEDTRANSFERSBUFFER)
@@ -1090,20 +1134,56 @@ MegaCmdGlobalTransferListener::~MegaCmdGlobalTransferListener()
     completedTransfersMutex.unlock();
 }
 
+void MegaCmdCatTransferListener::setBlockCache(LocalBlockCache *cache, MegaNode *n, long long start)
+{
+    blockCache = cache;
+    cachedHandle = n->getHandle();
+    cachedFingerprint = n->getFingerprint() ? n->getFingerprint() : "";
+    cachedSize = n->getSize();
+    cachedBlock = start / LocalBlockCache::BLOCK_SIZE;
+    pendingBlock.clear();
+}
+
 bool MegaCmdCatTransferListener::onTransferData(MegaApi *api, MegaTransfer *transfer, char *buffer, size_t size)
 {
-    if (!ls->isClientConnected())
+    if (ls && !ls->isClientConnected())
     {
         LOG_debug << " CatTransfer listener, cancelled transfer due to client disconnected";
         api->cancelTransfer(transfer);
+        return true;
     }
-    else
-    {
 
+    if (ls)
+    {
         LOG_debug << " CatTransfer listener, streaming " << size << " bytes";  //TODO: verbose
         *ls << string(buffer,size);
     }
 
+    if (blockCache)
+    {
+        pendingBlock.append(buffer, size);
+        long long length = LocalBlockCache::blockLength(cachedSize, cachedBlock);
+        while (length && pendingBlock.size() >= size_t(length))
+        {
+            blockCache->writeBlock(cachedHandle, cachedFingerprint, cachedSize, cachedBlock, pendingBlock.data(), size_t(length));
+            pendingBlock.erase(0, size_t(length));
+            length = LocalBlockCache::blockLength(cachedSize, ++cachedBlock);
+        }
+    }
+
     return true;
 }
+
+bool MegaCmdHashTransferListener::onTransferData(MegaApi *api, MegaTransfer *transfer, char *buffer, size_t size)
+{
+    hasher.add((const mega::byte *)buffer, unsigned(size));
+    return true;
+}
+
+string MegaCmdHashTransferListener::getDigest()
+{
+    string digest;
+    hasher.get(&digest);
+    return digest;
+}
 } //end namespace
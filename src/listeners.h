@@ -114,15 +114,45 @@ class MegaCmdCatTransferListener : public MegaCmdTransferListener
 {
 private:
     LoggedStream *ls;
+
+    LocalBlockCache *blockCache = nullptr;
+    mega::MegaHandle cachedHandle = mega::INVALID_HANDLE;
+    std::string cachedFingerprint;
+    long long cachedSize = 0;
+    long long cachedBlock = 0;
+    std::string pendingBlock;
+
 public:
     std::string contents;
 
     MegaCmdCatTransferListener(LoggedStream *_ls, mega::MegaApi *megaApi, MegaCmdSandbox * sandboxCMD, mega::MegaTransferListener *listener = NULL, int clientID=-1)
         :MegaCmdTransferListener(megaApi,sandboxCMD,listener,clientID),ls(_ls){};
 
+    /**
+     * @brief Keeps the data streamed into a block cache as well. With no stream, data is only cached
+     * @param start offset streaming starts from: it must be the beginning of a block
+     */
+    void setBlockCache(LocalBlockCache *cache, mega::MegaNode *n, long long start);
+
     bool onTransferData(mega::MegaApi *api, mega::MegaTransfer *transfer, char *buffer, size_t size);
 };
 
+/**
+ * @brief Hashes the whole contents streamed, to compare them without keeping them
+ */
+class MegaCmdHashTransferListener : public MegaCmdTransferListener
+{
+private:
+    mega::HashSHA256 hasher;
+
+public:
+    MegaCmdHashTransferListener(mega::MegaApi *megaApi, MegaCmdSandbox * sandboxCMD)
+        :MegaCmdTransferListener(megaApi,sandboxCMD){};
+
+    bool onTransferData(mega::MegaApi *api, mega::MegaTransfer *transfer, char *buffer, size_t size);
+    std::string getDigest();
+};
+
 class MegaCmdMultiTransferListener : public mega::SynchronousTransferListener
 {
 private:
@@ -133,17 +163,22 @@ private:
     int clientID;
     int started;
     int finished;
+    int waited;
     long long transferredbytes;
     std::map<int, long long> ongoingtransferredbytes;
     std::map<int, long long> ongoingtotalbytes;
     long long totalbytes;
     int finalerror;
+    int priority;
+    mega::m_time_t deadline;
 
     long long getOngoingTransferredBytes();
     long long getOngoingTotalBytes();
 
     bool progressinformed;
 
+    std::function<void(mega::MegaTransfer *transfer, mega::MegaError *e)> onTransferFinishCallback;
+
 public:
     MegaCmdMultiTransferListener(mega::MegaApi *megaApi, MegaCmdSandbox * sandboxCMD, mega::MegaTransferListener *listener = NULL, int clientID=-1);
     virtual ~MegaCmdMultiTransferListener();
@@ -159,6 +194,25 @@ public:
 
     void waitMultiEnd();
 
+    /**
+     * @brief waitForInFlightBelow blocks until less than maxInFlight of the transfers started
+     * with this listener remain unfinished
+     * @param maxInFlight maximum number of unfinished transfers. 0 means no limit
+     */
+    void waitForInFlightBelow(int maxInFlight);
+
+    /**
+     * @brief setOnTransferFinishCallback
+     * @param func to call upon each transfer finish (from the SDK thread)
+     */
+    void setOnTransferFinishCallback(std::function<void(mega::MegaTransfer *transfer, mega::MegaError *e)> func);
+
+    /**
+     * @brief setPriority sets the priority and deadline (0 for none) given to the transfers started
+     * with this listener in the transfer queue
+     */
+    void setPriority(int priority, mega::m_time_t deadline);
+
     int getFinalerror() const;
 
     long long getTotalbytes() const;
@@ -35,11 +35,11 @@
 #include <iomanip>
 #include <string>
 #include <deque>
+#include <list>
 #include <atomic>
-
-#ifdef __linux__
+#include <chrono>
 #include <condition_variable>
-#endif
+
 #ifndef _WIN32
 #include "signal.h"
 #include <sys/wait.h>
@@ -107,10 +107,29 @@ MegaSemaphore semaphoreClients; //to limit max parallel petitions
 MegaApi *api = nullptr;
 
 //api objects for folderlinks
-std::queue<MegaApi *> apiFolders;
-std::vector<MegaApi *> occupiedapiFolders;
-MegaSemaphore semaphoreapiFolders;
+struct ApiFolderSession
+{
+    MegaApi *apiFolder;
+    string link; // folder link it is logged into, with its nodes fetched ("" if none)
+    long long nodes; // number of nodes fetched from it
+    long long fetchMs; // time taken to log into it and fetch its nodes
+    std::chrono::steady_clock::time_point lastUsed;
+
+    ApiFolderSession(MegaApi *apiFolder = NULL)
+        : apiFolder(apiFolder), nodes(0), fetchMs(0), lastUsed(std::chrono::steady_clock::now())
+    {
+    }
+};
+
+static const int INITIAL_API_FOLDERS = 5;
+std::list<ApiFolderSession> apiFolders; // free ones, the most recently used first
+std::vector<ApiFolderSession> occupiedapiFolders;
+int numapiFolders = 0; // free and occupied
+std::condition_variable apiFoldersCV;
 std::mutex mutexapiFolders;
+unsigned long long apiFolderSessionHits = 0;
+unsigned long long apiFolderSessionMisses = 0;
+long long apiFolderSessionSavedMs = 0; // fetch time saved by reusing sessions
 
 MegaCMDLogger *loggerCMD;
 
@@ -118,6 +137,7 @@ std::mutex mutexEndedPetitionThreads;
 std::vector<MegaThread *> petitionThreads;
 std::vector<MegaThread *> endedPetitionThreads;
 MegaThread *threadRetryConnections;
+MegaThread *threadBandwidthScheduler;
 
 std::deque<std::string> greetingsFirstClientMsgs; // to be given on first client to register as state listener
 std::deque<std::string> greetingsAllClientMsgs; // to be given on all clients when registering as state listener
@@ -147,6 +167,7 @@ string dynamicprompt = "MEGA CMD> ";
 static prompttype prompt = COMMAND;
 
 static std::atomic_bool loginInAtStartup(false);
+static std::atomic_bool restrictedCommands(false); // only loginInValidCommands are valid (see updatevalidCommands)
 static std::atomic<int> blocked(0);
 
 time_t lastTimeCheckBlockStatus = 0;
@@ -166,6 +187,7 @@ char ** mcmdMainArgv;
 int mcmdMainArgc;
 
 void printWelcomeMsg();
+string getLocaleCode();
 
 void delete_finished_threads();
 
@@ -365,6 +387,11 @@ void insertValidParamsPerCommand(set<string> *validParams, string thecommand, se
 
     validOptValues->insert("client-width");
 
+    if ("ls" == thecommand || "find" == thecommand || "du" == thecommand || "transfers" == thecommand || "sync" == thecommand
+            || "diff" == thecommand)
+    {
+        validOptValues->insert("output");
+    }
 
     if ("ls" == thecommand)
     {
@@ -435,6 +462,7 @@ void insertValidParamsPerCommand(set<string> *validParams, string thecommand, se
         validParams->insert("u");
         validParams->insert("d");
         validParams->insert("h");
+        validOptValues->insert("schedule");
     }
     else if ("whoami" == thecommand)
     {
@@ -446,7 +474,12 @@ void insertValidParamsPerCommand(set<string> *validParams, string thecommand, se
     }
     else if ("mediainfo" == thecommand)
     {
+        validParams->insert("r");
         validOptValues->insert("path-display-size");
+        validOptValues->insert("output");
+#ifdef USE_PCRE
+        validParams->insert("use-pcre");
+#endif
     }
     else if ("log" == thecommand)
     {
@@ -465,6 +498,36 @@ void insertValidParamsPerCommand(set<string> *validParams, string thecommand, se
     {
         validParams->insert("all");
         validParams->insert("f");
+        validParams->insert("dry-run");
+        validOptValues->insert("clientID");
+#ifdef USE_PCRE
+        validParams->insert("use-pcre");
+#endif
+    }
+    else if ("dedup" == thecommand)
+    {
+        validParams->insert("remove");
+        validParams->insert("f");
+    }
+    else if ("diff" == thecommand)
+    {
+        validParams->insert("fingerprint");
+    }
+    else if ("prefetch" == thecommand)
+    {
+        validOptValues->insert("blocks-under");
+        validOptValues->insert("clientID");
+#ifdef USE_PCRE
+        validParams->insert("use-pcre");
+#endif
+    }
+    else if ("blockcache" == thecommand)
+    {
+        validParams->insert("pin");
+        validParams->insert("unpin");
+        validParams->insert("prefetch");
+        validParams->insert("clear");
+        validOptValues->insert("limit");
 #ifdef USE_PCRE
         validParams->insert("use-pcre");
 #endif
@@ -617,32 +680,58 @@ void insertValidParamsPerCommand(set<string> *validParams, string thecommand, se
     else if ("thumbnail" == thecommand)
     {
         validParams->insert("s");
+        validParams->insert("r");
+        validParams->insert("skip-existing");
+        validOptValues->insert("layout");
+#ifdef USE_PCRE
+        validParams->insert("use-pcre");
+#endif
     }
     else if ("preview" == thecommand)
     {
         validParams->insert("s");
+        validParams->insert("r");
+        validParams->insert("skip-existing");
+        validOptValues->insert("layout");
+#ifdef USE_PCRE
+        validParams->insert("use-pcre");
+#endif
     }
     else if ("put" == thecommand)
     {
         validParams->insert("c");
         validParams->insert("q");
         validParams->insert("ignore-quota-warn");
+        validParams->insert("skip-unchanged");
         validOptValues->insert("clientID");
+        validOptValues->insert("priority");
+        validOptValues->insert("deadline");
     }
     else if ("get" == thecommand)
     {
         validParams->insert("m");
         validParams->insert("q");
         validParams->insert("ignore-quota-warn");
+        validParams->insert("skip-unchanged");
         validOptValues->insert("password");
 #ifdef USE_PCRE
         validParams->insert("use-pcre");
 #endif
         validOptValues->insert("clientID");
+        validOptValues->insert("order");
+        validOptValues->insert("max-in-flight");
+        validOptValues->insert("manifest");
+        validOptValues->insert("resume");
+        validOptValues->insert("priority");
+        validOptValues->insert("deadline");
     }
     else if ("import" == thecommand)
     {
         validOptValues->insert("password");
+        validOptValues->insert("manifest");
+        validOptValues->insert("results");
+        validOptValues->insert("max-in-flight");
+        validOptValues->insert("clientID");
     }
     else if ("login" == thecommand)
     {
@@ -669,8 +758,12 @@ void insertValidParamsPerCommand(set<string> *validParams, string thecommand, se
         validParams->insert("a");
         validParams->insert("p");
         validParams->insert("r");
+        validParams->insert("queue");
         validOptValues->insert("limit");
         validOptValues->insert("path-display-size");
+        validOptValues->insert("policy");
+        validOptValues->insert("priority");
+        validOptValues->insert("deadline");
     }
     else if ("proxy" == thecommand)
     {
@@ -679,6 +772,10 @@ void insertValidParamsPerCommand(set<string> *validParams, string thecommand, se
         validOptValues->insert("username");
         validOptValues->insert("password");
     }
+    else if ("startup" == thecommand)
+    {
+        validParams->insert("timings");
+    }
     else if ("exit" == thecommand || "quit" == thecommand)
     {
         validParams->insert("only-shell");
@@ -689,8 +786,83 @@ void insertValidParamsPerCommand(set<string> *validParams, string thecommand, se
         validOptValues->insert("auto");
     }
 #endif
+    else if ("debug" == thecommand)
+    {
+        validParams->insert("stats");
+    }
 }
 
+enum CommandCost
+{
+    COMMAND_COST_LOCAL, // does not involve the api (e.g. pwd, log)
+    COMMAND_COST_LIGHT, // single requests or in-memory node tree operations
+    COMMAND_COST_HEAVY, // transfers, recursive walks or many requests
+};
+
+typedef completionfunction_t *parameterscompletion_t(int currentparameter);
+
+#define COMMAND_LATENCY_BUCKETS 24 // bucket i counts executions lasting [2^(i-1), 2^i) ms; the last one, anything longer
+
+/**
+ * @brief Everything known about a command that does not depend on its arguments.
+ * Descriptors are built once (see getCommandDescriptor) and never modified afterwards, except for their counters.
+ */
+struct CommandDescriptor
+{
+    string name;
+    MegaCmdExecuter::CommandHandler handler = nullptr; // NULL for commands handled in here (e.g. help)
+    set<string> validParams; // flags and options (global ones included): as passed to setOptionsAndFlags
+    set<string> validFlags; // only for completion
+    set<string> validOptValues; // only for completion
+    parameterscompletion_t *completion = nullptr; // completion function for the nth parameter
+    CommandCost cost = COMMAND_COST_LIGHT;
+    bool availableWhileRestricted = false; // i.e. while login in or with the account blocked
+    StartupStage requiredStage = STARTUP_STAGES_TOTAL; // stage to wait for (if running) before executing. STARTUP_STAGES_TOTAL: none
+    string usage;
+
+    std::atomic<uint64_t> executions{0};
+    std::atomic<uint64_t> failures{0};
+    std::atomic<uint64_t> latencyHistogram[COMMAND_LATENCY_BUCKETS] = {};
+
+    void recordExecution(int64_t milliseconds, bool failed)
+    {
+        unsigned int bucket = 0;
+        while (milliseconds > 0 && bucket < COMMAND_LATENCY_BUCKETS - 1)
+        {
+            milliseconds >>= 1;
+            bucket++;
+        }
+        latencyHistogram[bucket]++;
+        executions++;
+        if (failed)
+        {
+            failures++;
+        }
+    }
+
+    // upper bound (in ms) of the latency of the given fraction of the executions
+    int64_t latencyPercentile(double fraction) const
+    {
+        uint64_t total = 0;
+        for (int i = 0; i < COMMAND_LATENCY_BUCKETS; i++)
+        {
+            total += latencyHistogram[i];
+        }
+        uint64_t accumulated = 0;
+        for (int i = 0; i < COMMAND_LATENCY_BUCKETS; i++)
+        {
+            accumulated += latencyHistogram[i];
+            if (total && accumulated >= fraction * total)
+            {
+                return int64_t(1) << i;
+            }
+        }
+        return 0;
+    }
+};
+
+CommandDescriptor *getCommandDescriptor(const string &thecommand);
+
 void escapeEspace(string &orig)
 {
     replaceAll(orig," ", "\\ ");
@@ -786,15 +958,12 @@ char * flags_completion(const char*text, int state)
         char *saved_line = strdup(getCurrentThreadLine().c_str());
         vector<string> words = getlistOfWords(saved_line, !getCurrentThreadIsCmdShell());
         free(saved_line);
-        if (words.size())
+        CommandDescriptor *descriptor = words.size() ? getCommandDescriptor(words[0]) : NULL;
+        if (descriptor)
         {
-            set<string> setvalidparams;
-            set<string> setvalidOptValues;
-            addGlobalFlags(&setvalidparams);
-
-            string thecommand = words[0];
-            insertValidParamsPerCommand(&setvalidparams, thecommand, &setvalidOptValues);
-            set<string>::iterator it;
+            const set<string> &setvalidparams = descriptor->validFlags;
+            const set<string> &setvalidOptValues = descriptor->validOptValues;
+            set<string>::const_iterator it;
             for (it = setvalidparams.begin(); it != setvalidparams.end(); it++)
             {
                 string param = *it;
@@ -854,11 +1023,8 @@ char * flags_value_completion(const char*text, int state)
             map<string, string> cloptions;
             map<string, int> clflags;
 
-            set<string> validParams;
-
-            insertValidParamsPerCommand(&validParams, thecommand);
-
-            if (setOptionsAndFlags(&cloptions, &clflags, &words, validParams, true))
+            CommandDescriptor *descriptor = getCommandDescriptor(thecommand);
+            if (descriptor && setOptionsAndFlags(&cloptions, &clflags, &words, descriptor->validParams, true))
             {
                 // return invalid??
             }
@@ -1113,161 +1279,327 @@ char* userattrs_completion(const char* text, int state)
     return generic_completion(text, state, validAttrs);
 }
 
-completionfunction_t *getCompletionFunction(vector<string> words)
+completionfunction_t *localremotefolder_parameters_completion(int currentparameter)
 {
-    // Strip words without flags
-    string thecommand = words[0];
+    return currentparameter == 1 ? local_completion : currentparameter == 2 ? remotefolders_completion : empty_completion;
+}
 
-    if (words.size() > 1)
-    {
-        string lastword = words[words.size() - 1];
-        if (lastword.find_first_of("-") == 0)
-        {
-            if (lastword.find_last_of("=") != string::npos)
-            {
-                return flags_value_completion;
-            }
-            else
-            {
-                return flags_completion;
-            }
-        }
-    }
-    discardOptionsAndFlags(&words);
+completionfunction_t *put_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? local_completion : remotepaths_completion;
+}
 
-    int currentparameter = int(words.size() - 1);
+completionfunction_t *backup_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? localfolders_completion : remotefolders_completion;
+}
+
+completionfunction_t *remote_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? remotepaths_completion : empty_completion;
+}
+
+completionfunction_t *remotefolder_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? remotefolders_completion : empty_completion;
+}
+
+completionfunction_t *multipleremote_parameters_completion(int currentparameter)
+{
+    return currentparameter >= 1 ? remotepaths_completion : empty_completion;
+}
+
+completionfunction_t *localfolder_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? localfolders_completion : empty_completion;
+}
+
+completionfunction_t *remoteremote_parameters_completion(int currentparameter)
+{
+    return ( currentparameter == 1 ) || ( currentparameter == 2 ) ? remotepaths_completion : empty_completion;
+}
+
+completionfunction_t *remotelocal_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? remotepaths_completion : currentparameter == 2 ? local_completion : empty_completion;
+}
+
+completionfunction_t *email_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? contacts_completion : empty_completion;
+}
+
+completionfunction_t *import_parameters_completion(int currentparameter)
+{
+    return currentparameter == 2 ? remotepaths_completion : empty_completion;
+}
+
+completionfunction_t *killsession_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? sessions_completion : empty_completion;
+}
+
+completionfunction_t *attr_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? remotepaths_completion : currentparameter == 2 ? nodeattrs_completion : empty_completion;
+}
+
+completionfunction_t *userattr_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? userattrs_completion : empty_completion;
+}
+
+completionfunction_t *log_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? loglevels_completion : empty_completion;
+}
+
+completionfunction_t *transfers_parameters_completion(int currentparameter)
+{
+    return currentparameter == 1 ? transfertags_completion : empty_completion;
+}
+
+parameterscompletion_t *getParametersCompletion(const string &thecommand)
+{
     if (stringcontained(thecommand.c_str(), localremotefolderpatterncommands))
     {
-        if (currentparameter == 1)
-        {
-            return local_completion;
-        }
-        if (currentparameter == 2)
-        {
-            return remotefolders_completion;
-        }
+        return localremotefolder_parameters_completion;
     }
     else if (thecommand == "put")
     {
-        if (currentparameter == 1)
-        {
-            return local_completion;
-        }
-        else
-        {
-            return remotepaths_completion;
-        }
+        return put_parameters_completion;
     }
     else if (thecommand == "backup")
     {
-        if (currentparameter == 1)
-        {
-            return localfolders_completion;
-        }
-        else
-        {
-            return remotefolders_completion;
-        }
+        return backup_parameters_completion;
     }
     else if (stringcontained(thecommand.c_str(), remotepatterncommands))
     {
-        if (currentparameter == 1)
-        {
-            return remotepaths_completion;
-        }
+        return remote_parameters_completion;
     }
     else if (stringcontained(thecommand.c_str(), remotefolderspatterncommands))
     {
-        if (currentparameter == 1)
-        {
-            return remotefolders_completion;
-        }
+        return remotefolder_parameters_completion;
     }
     else if (stringcontained(thecommand.c_str(), multipleremotepatterncommands))
     {
-        if (currentparameter >= 1)
-        {
-            return remotepaths_completion;
-        }
+        return multipleremote_parameters_completion;
     }
     else if (stringcontained(thecommand.c_str(), localfolderpatterncommands))
     {
-        if (currentparameter == 1)
-        {
-            return localfolders_completion;
-        }
+        return localfolder_parameters_completion;
     }
     else if (stringcontained(thecommand.c_str(), remoteremotepatterncommands))
     {
-        if (( currentparameter == 1 ) || ( currentparameter == 2 ))
-        {
-            return remotepaths_completion;
-        }
+        return remoteremote_parameters_completion;
     }
     else if (stringcontained(thecommand.c_str(), remotelocalpatterncommands))
     {
-        if (currentparameter == 1)
-        {
-            return remotepaths_completion;
-        }
-        if (currentparameter == 2)
-        {
-            return local_completion;
-        }
+        return remotelocal_parameters_completion;
     }
     else if (stringcontained(thecommand.c_str(), emailpatterncommands))
     {
-        if (currentparameter == 1)
-        {
-            return contacts_completion;
-        }
+        return email_parameters_completion;
     }
     else if (thecommand == "import")
     {
-        if (currentparameter == 2)
-        {
-            return remotepaths_completion;
-        }
+        return import_parameters_completion;
     }
     else if (thecommand == "killsession")
     {
-        if (currentparameter == 1)
-        {
-            return sessions_completion;
-        }
+        return killsession_parameters_completion;
     }
     else if (thecommand == "attr")
     {
-        if (currentparameter == 1)
+        return attr_parameters_completion;
+    }
+    else if (thecommand == "userattr")
+    {
+        return userattr_parameters_completion;
+    }
+    else if (thecommand == "log")
+    {
+        return log_parameters_completion;
+    }
+    else if (thecommand == "transfers")
+    {
+        return transfers_parameters_completion;
+    }
+    return nullptr;
+}
+
+CommandCost getCommandCost(const string &thecommand)
+{
+    static const set<string> localCommands { "log", "debug", "pwd", "lcd", "lpwd", "help", "version", "history", "clear", "quit",
+                                             "exit", "errorcode", "completion", "graphics", "https", "proxy", "speedlimit", "permissions",
+                                             "autocomplete", "codepage", "unicode", "update", "psa", "locallogout", "startup" };
+    static const set<string> heavyCommands { "get", "put", "sync", "backup", "cp", "rm", "mv", "du", "find", "ls", "tree", "deleteversions", "dedup", "diff", "blockcache",
+                                             "import", "export", "share", "thumbnail", "preview", "mediainfo", "cat", "webdav", "ftp",
+                                             "df", "login", "reload" };
+    if (localCommands.count(thecommand))
+    {
+        return COMMAND_COST_LOCAL;
+    }
+    if (heavyCommands.count(thecommand))
+    {
+        return COMMAND_COST_HEAVY;
+    }
+    return COMMAND_COST_LIGHT;
+}
+
+const char *getCommandCostStr(CommandCost cost)
+{
+    switch (cost)
+    {
+        case COMMAND_COST_LOCAL:
+            return "local";
+        case COMMAND_COST_HEAVY:
+            return "heavy";
+        default:
+            return "light";
+    }
+}
+
+typedef std::unordered_map<string, std::unique_ptr<CommandDescriptor> > CommandRegistry;
+
+CommandRegistry *buildCommandRegistry()
+{
+    CommandRegistry *registry = new CommandRegistry();
+    set<string> names(allValidCommands.begin(), allValidCommands.end());
+    names.insert(loginInValidCommands.begin(), loginInValidCommands.end());
+
+    const auto &handlers = MegaCmdExecuter::getCommandHandlers();
+    for (auto &name : names)
+    {
+        CommandDescriptor *descriptor = new CommandDescriptor();
+        descriptor->name = name;
+        auto itHandler = handlers.find(name);
+        if (itHandler != handlers.end())
         {
-            return remotepaths_completion;
+            descriptor->handler = itHandler->second;
         }
-        if (currentparameter == 2)
+
+        addGlobalFlags(&descriptor->validParams);
+        insertValidParamsPerCommand(&descriptor->validParams, name);
+        addGlobalFlags(&descriptor->validFlags);
+        insertValidParamsPerCommand(&descriptor->validFlags, name, &descriptor->validOptValues);
+
+        descriptor->completion = getParametersCompletion(name);
+        descriptor->cost = getCommandCost(name);
+        descriptor->availableWhileRestricted = stringcontained(name.c_str(), loginInValidCommands);
+        if (name == "backup")
         {
-            return nodeattrs_completion;
+            descriptor->requiredStage = STARTUP_STAGE_BACKUPS;
         }
-    }
-    else if (thecommand == "userattr")
-    {
-        if (currentparameter == 1)
+        else if (name == "webdav")
         {
-            return userattrs_completion;
+            descriptor->requiredStage = STARTUP_STAGE_WEBDAV;
         }
+        else if (name == "ftp")
+        {
+            descriptor->requiredStage = STARTUP_STAGE_FTP;
+        }
+        descriptor->usage = getUsageStr(name.c_str());
+        (*registry)[name].reset(descriptor);
     }
-    else if (thecommand == "log")
+    return registry;
+}
+
+CommandDescriptor *getCommandDescriptor(const string &thecommand)
+{
+    static CommandRegistry *registry = buildCommandRegistry(); // never freed: petitions may still be running at exit
+
+    auto it = registry->find(thecommand);
+    return it == registry->end() ? NULL : it->second.get();
+}
+
+void printCommandStats()
+{
+    vector<CommandDescriptor *> executed;
+    for (auto &name : allValidCommands)
     {
-        if (currentparameter == 1)
+        CommandDescriptor *descriptor = getCommandDescriptor(name);
+        if (descriptor && descriptor->executions)
         {
-            return loglevels_completion;
+            executed.push_back(descriptor);
         }
     }
-    else if (thecommand == "transfers")
+
+    if (executed.empty())
+    {
+        OUTSTREAM << "No commands executed yet" << endl;
+        return;
+    }
+
+    sort(executed.begin(), executed.end(), [](CommandDescriptor *a, CommandDescriptor *b)
+    {
+        return a->executions > b->executions;
+    });
+
+    OUTSTREAM << getFixLengthString("COMMAND", 16) << getFixLengthString("COST", 7) << getFixLengthString("RUNS", 9, ' ', true)
+              << getFixLengthString("FAILED", 9, ' ', true) << getFixLengthString("P50(ms)", 10, ' ', true)
+              << getFixLengthString("P90(ms)", 10, ' ', true) << getFixLengthString("P99(ms)", 10, ' ', true) << endl;
+    for (auto descriptor : executed)
+    {
+        OUTSTREAM << getFixLengthString(descriptor->name, 16) << getFixLengthString(getCommandCostStr(descriptor->cost), 7)
+                  << getFixLengthString(SSTR(descriptor->executions.load()), 9, ' ', true)
+                  << getFixLengthString(SSTR(descriptor->failures.load()), 9, ' ', true)
+                  << getFixLengthString("<" + SSTR(descriptor->latencyPercentile(0.5)), 10, ' ', true)
+                  << getFixLengthString("<" + SSTR(descriptor->latencyPercentile(0.9)), 10, ' ', true)
+                  << getFixLengthString("<" + SSTR(descriptor->latencyPercentile(0.99)), 10, ' ', true) << endl;
+    }
+}
+
+/**
+ * @brief Records the execution of a command in its descriptor when going out of scope
+ */
+class CommandExecutionRecorder
+{
+    CommandDescriptor *descriptor;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    CommandExecutionRecorder(CommandDescriptor *descriptor)
+        : descriptor(descriptor), start(std::chrono::steady_clock::now())
     {
-        if (currentparameter == 1)
+    }
+
+    ~CommandExecutionRecorder()
+    {
+        auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+        int outCode = getCurrentOutCode();
+        descriptor->recordExecution(elapsed, outCode != MCMD_OK && outCode != MCMD_PARTIALOUT);
+    }
+};
+
+completionfunction_t *getCompletionFunction(vector<string> words)
+{
+    // Strip words without flags
+    string thecommand = words[0];
+
+    if (words.size() > 1)
+    {
+        string lastword = words[words.size() - 1];
+        if (lastword.find_first_of("-") == 0)
         {
-            return transfertags_completion;
+            if (lastword.find_last_of("=") != string::npos)
+            {
+                return flags_value_completion;
+            }
+            else
+            {
+                return flags_completion;
+            }
         }
     }
+    discardOptionsAndFlags(&words);
+
+    int currentparameter = int(words.size() - 1);
+    CommandDescriptor *descriptor = getCommandDescriptor(thecommand);
+    if (descriptor && descriptor->completion)
+    {
+        return descriptor->completion(currentparameter);
+    }
     return empty_completion;
 }
 
@@ -1308,60 +1640,288 @@ string getListOfCompletionValues(vector<string> words, char separator = ' ', con
     if (words.size()>1)
     while (true)
     {
-        char *newval;
-        string &lastword = words[words.size()-1];
-        if (suppressflag && lastword.size()>3 && lastword[0]== '-' && lastword[1]== '-' && lastword.find('=')!=string::npos)
+        char *newval;
+        string &lastword = words[words.size()-1];
+        if (suppressflag && lastword.size()>3 && lastword[0]== '-' && lastword[1]== '-' && lastword.find('=')!=string::npos)
+        {
+            newval = compfunction(lastword.substr(lastword.find_first_of('=')+1).c_str(), state);
+        }
+        else
+        {
+            newval = compfunction(lastword.c_str(), state);
+        }
+
+        if (!newval) break;
+        if (completionValues.size())
+        {
+            completionValues+=separator;
+        }
+
+        string snewval=newval;
+        if (snewval.find_first_of(separators) != string::npos)
+        {
+            completionValues+="\"";
+            replaceAll(snewval,"\"","\\\"");
+            completionValues+=snewval;
+            completionValues+="\"";
+        }
+        else
+        {
+            completionValues+=newval;
+        }
+        free(newval);
+
+        state++;
+    }
+    return completionValues;
+}
+
+static MegaApi *newApiFolder()
+{
+    MegaApi *apiFolder = new MegaApi("BdARkQSQ", (MegaGfxProcessor*)NULL, (const char*)NULL, api->getUserAgent());
+    apiFolder->setLanguage(getLocaleCode().c_str());
+    apiFolder->setLogLevel(MegaApi::LOG_LEVEL_MAX);
+    return apiFolder;
+}
+
+/**
+ * @brief Takes an instance from the pool used to access folder links.
+ *
+ * If an idle instance is still logged into link (with its nodes fetched), that one is returned and
+ * *logged is set: it requires no login nor fetchnodes. Otherwise, an instance not logged into any
+ * link is preferred over the least recently used one. When all of them are busy, the pool grows
+ * up to "folder_links_pool_max" instances.
+ */
+MegaApi* getFreeApiFolder(const string &link, bool *logged)
+{
+    std::unique_lock<std::mutex> lock(mutexapiFolders);
+    for (;;)
+    {
+        auto chosen = apiFolders.end();
+        if (link.size())
+        {
+            chosen = std::find_if(apiFolders.begin(), apiFolders.end(), [&link](const ApiFolderSession &s) { return s.link == link; });
+        }
+        if (chosen != apiFolders.end())
+        {
+            apiFolderSessionHits++;
+            apiFolderSessionSavedMs += chosen->fetchMs;
+        }
+        else if (!apiFolders.empty())
+        {
+            chosen = std::find_if(apiFolders.begin(), apiFolders.end(), [](const ApiFolderSession &s) { return s.link.empty(); });
+            if (chosen == apiFolders.end())
+            {
+                chosen = std::prev(apiFolders.end());
+            }
+            chosen->link.clear();
+            chosen->nodes = 0;
+        }
+        else if (numapiFolders < ConfigurationManager::getConfigurationValue("folder_links_pool_max", 20))
+        {
+            int instances = ++numapiFolders;
+            apiFolderSessionMisses += link.size() ? 1 : 0;
+            lock.unlock();
+            MegaApi *apiFolder = newApiFolder();
+            LOG_debug << "Folder links pool grown to " << instances << " instances";
+            lock.lock();
+            occupiedapiFolders.push_back(ApiFolderSession(apiFolder));
+            if (logged)
+            {
+                *logged = false;
+            }
+            return apiFolder;
+        }
+        else
+        {
+            apiFoldersCV.wait(lock);
+            continue;
+        }
+
+        if (logged)
+        {
+            *logged = chosen->link.size();
+        }
+        apiFolderSessionMisses += (link.size() && chosen->link.empty()) ? 1 : 0;
+        occupiedapiFolders.push_back(*chosen);
+        apiFolders.erase(chosen);
+        return occupiedapiFolders.back().apiFolder;
+    }
+}
+
+/**
+ * @brief Records that apiFolder is logged into link (with its nodes fetched), or into none if link is empty
+ */
+void setApiFolderSession(MegaApi *apiFolder, const string &link, long long fetchMs)
+{
+    long long nodes = link.size() ? apiFolder->getNumNodes() : 0;
+
+    std::lock_guard<std::mutex> g(mutexapiFolders);
+    for (auto &session : occupiedapiFolders)
+    {
+        if (session.apiFolder == apiFolder)
         {
-            newval = compfunction(lastword.substr(lastword.find_first_of('=')+1).c_str(), state);
+            session.link = link;
+            session.nodes = nodes;
+            session.fetchMs = fetchMs;
         }
-        else
+    }
+}
+
+/**
+ * @brief Logs out the idle sessions exceeding "folder_links_cached_max" sessions or "folder_links_cached_nodes_max"
+ * nodes altogether (the least recently used first), or idle for "folder_links_cache_ttl" seconds.
+ * Instances the pool grew with are removed once idle for that long. Must be called with mutexapiFolders locked:
+ * those to log out and to delete are returned, to do it once unlocked (see releaseApiFolders). Meanwhile,
+ * those to log out are kept as occupied, so that they are not taken to access another link before that
+ */
+static void evictApiFolders(vector<pair<MegaApi *, string> > *toLogout, vector<MegaApi *> *toDelete)
+{
+    int maxSessions = ConfigurationManager::getConfigurationValue("folder_links_cached_max", 5);
+    long long maxNodes = ConfigurationManager::getConfigurationValue("folder_links_cached_nodes_max", 2000000);
+    auto ttl = std::chrono::seconds(ConfigurationManager::getConfigurationValue("folder_links_cache_ttl", 3600));
+    auto now = std::chrono::steady_clock::now();
+    int sessions = 0;
+    long long nodes = 0;
+    for (auto s = apiFolders.begin(); s != apiFolders.end(); )
+    {
+        bool expired = now - s->lastUsed > ttl;
+        bool loggingOut = false;
+        if (s->link.size())
         {
-            newval = compfunction(lastword.c_str(), state);
+            sessions++;
+            nodes += s->nodes;
+            if (expired || sessions > maxSessions || nodes > maxNodes)
+            {
+                toLogout->push_back(std::make_pair(s->apiFolder, s->link));
+                s->link.clear();
+                s->nodes = 0;
+                loggingOut = true;
+            }
         }
-
-        if (!newval) break;
-        if (completionValues.size())
+        if (expired && s->link.empty() && numapiFolders > INITIAL_API_FOLDERS)
         {
-            completionValues+=separator;
+            toDelete->push_back(s->apiFolder);
+            numapiFolders--;
+            s = apiFolders.erase(s);
+            continue;
+        }
+        if (loggingOut)
+        {
+            occupiedapiFolders.push_back(*s);
+            s = apiFolders.erase(s);
+            continue;
         }
+        s++;
+    }
+}
 
-        string snewval=newval;
-        if (snewval.find_first_of(separators) != string::npos)
+static void releaseApiFolders(const vector<pair<MegaApi *, string> > &toLogout, const vector<MegaApi *> &toDelete, int instances)
+{
+    vector<MegaApi *> loggedOut;
+    for (auto &a : toLogout)
+    {
+        LOG_debug << "Dropping session of folder link " << a.second;
+        if (std::find(toDelete.begin(), toDelete.end(), a.first) == toDelete.end())
         {
-            completionValues+="\"";
-            replaceAll(snewval,"\"","\\\"");
-            completionValues+=snewval;
-            completionValues+="\"";
+            a.first->localLogout(); // not to keep its nodes in memory
+            loggedOut.push_back(a.first);
         }
-        else
+    }
+    if (loggedOut.size())
+    {
+        // only now they can be taken again, as the least recently used ones
+        std::lock_guard<std::mutex> g(mutexapiFolders);
+        for (auto apiFolder : loggedOut)
         {
-            completionValues+=newval;
+            auto it = std::find_if(occupiedapiFolders.begin(), occupiedapiFolders.end(), [apiFolder](const ApiFolderSession &s) { return s.apiFolder == apiFolder; });
+            if (it != occupiedapiFolders.end())
+            {
+                apiFolders.push_back(*it);
+                occupiedapiFolders.erase(it);
+            }
         }
-        free(newval);
+        apiFoldersCV.notify_all();
+    }
+    for (auto a : toDelete)
+    {
+        delete a;
+    }
+    if (toDelete.size())
+    {
+        LOG_debug << "Folder links pool shrunk to " << instances << " instances";
+    }
+}
 
-        state++;
+/**
+ * @brief Returns apiFolder to the pool, keeping the session of the link it is logged into.
+ *
+ * Sessions and instances exceeding the limits are dropped right away (see evictApiFolders).
+ */
+void freeApiFolder(MegaApi *apiFolder)
+{
+    vector<pair<MegaApi *, string> > toLogout;
+    vector<MegaApi *> toDelete;
+    int instances;
+    {
+        std::lock_guard<std::mutex> g(mutexapiFolders);
+        auto it = std::find_if(occupiedapiFolders.begin(), occupiedapiFolders.end(), [apiFolder](const ApiFolderSession &s) { return s.apiFolder == apiFolder; });
+        ApiFolderSession session = (it != occupiedapiFolders.end()) ? *it : ApiFolderSession(apiFolder);
+        if (it != occupiedapiFolders.end())
+        {
+            occupiedapiFolders.erase(it);
+        }
+        session.lastUsed = std::chrono::steady_clock::now();
+        apiFolders.push_front(session);
+
+        evictApiFolders(&toLogout, &toDelete);
+        instances = numapiFolders;
+        apiFoldersCV.notify_all();
     }
-    return completionValues;
+
+    releaseApiFolders(toLogout, toDelete, instances);
 }
 
-MegaApi* getFreeApiFolder()
+/**
+ * @brief Drops the idle sessions and instances that expired while none was returned to the pool
+ */
+void sweepApiFolders()
 {
-    semaphoreapiFolders.wait();
-    mutexapiFolders.lock();
-    MegaApi* toret = apiFolders.front();
-    apiFolders.pop();
-    occupiedapiFolders.push_back(toret);
-    mutexapiFolders.unlock();
-    return toret;
+    vector<pair<MegaApi *, string> > toLogout;
+    vector<MegaApi *> toDelete;
+    int instances;
+    {
+        std::lock_guard<std::mutex> g(mutexapiFolders);
+        evictApiFolders(&toLogout, &toDelete);
+        instances = numapiFolders;
+    }
+
+    releaseApiFolders(toLogout, toDelete, instances);
 }
 
-void freeApiFolder(MegaApi *apiFolder)
+void printApiFolderStats()
 {
-    mutexapiFolders.lock();
-    occupiedapiFolders.erase(std::remove(occupiedapiFolders.begin(), occupiedapiFolders.end(), apiFolder), occupiedapiFolders.end());
-    apiFolders.push(apiFolder);
-    semaphoreapiFolders.release();
-    mutexapiFolders.unlock();
+    unsigned long long requests, hits;
+    long long savedMs;
+    int instances, sessions = 0;
+    {
+        std::lock_guard<std::mutex> g(mutexapiFolders);
+        hits = apiFolderSessionHits;
+        requests = hits + apiFolderSessionMisses;
+        savedMs = apiFolderSessionSavedMs;
+        instances = numapiFolders;
+        for (auto &s : apiFolders)
+        {
+            sessions += s.link.size() ? 1 : 0;
+        }
+    }
+    OUTSTREAM << "Folder links: " << requests << " accesses, " << hits << " reused sessions";
+    if (requests)
+    {
+        OUTSTREAM << " (" << (hits * 100 / requests) << "% hit rate)";
+    }
+    OUTSTREAM << ", " << savedMs << " ms of login and fetch saved. "
+              << instances << " instances, " << sessions << " idle sessions cached" << endl;
 }
 
 const char * getUsageStr(const char *command)
@@ -1447,9 +2007,9 @@ const char * getUsageStr(const char *command)
     if (!strcmp(command, "ls"))
     {
 #ifdef USE_PCRE
-        return "ls [-halRr] [--show-handles] [--tree] [--versions] [remotepath] [--use-pcre] [--time-format=FORMAT]";
+        return "ls [-halRr] [--show-handles] [--tree] [--versions] [remotepath] [--use-pcre] [--time-format=FORMAT] [--output=ndjson]";
 #else
-        return "ls [-halRr] [--show-handles] [--tree] [--versions] [remotepath] [--time-format=FORMAT]";
+        return "ls [-halRr] [--show-handles] [--tree] [--versions] [remotepath] [--time-format=FORMAT] [--output=ndjson]";
 #endif
     }
     if (!strcmp(command, "tree"))
@@ -1467,9 +2027,9 @@ const char * getUsageStr(const char *command)
     if (!strcmp(command, "du"))
     {
 #ifdef USE_PCRE
-        return "du [-h] [--versions] [remotepath remotepath2 remotepath3 ... ] [--use-pcre]";
+        return "du [-h] [--versions] [remotepath remotepath2 remotepath3 ... ] [--use-pcre] [--output=ndjson]";
 #else
-        return "du [-h] [--versions] [remotepath remotepath2 remotepath3 ... ]";
+        return "du [-h] [--versions] [remotepath remotepath2 remotepath3 ... ] [--output=ndjson]";
 #endif
     }
     if (!strcmp(command, "pwd"))
@@ -1486,11 +2046,11 @@ const char * getUsageStr(const char *command)
     }
     if (!strcmp(command, "import"))
     {
-        return "import exportedlink [--password=PASSWORD] [remotepath]";
+        return "import exportedlink [--password=PASSWORD] [remotepath] | import --manifest=FILE [--results=FILE] [--max-in-flight=N] [remotepath]";
     }
     if (!strcmp(command, "put"))
     {
-        return "put  [-c] [-q] [--ignore-quota-warn] localfile [localfile2 localfile3 ...] [dstremotepath]";
+        return "put  [-c] [-q] [--ignore-quota-warn] [--skip-unchanged] [--priority=N] [--deadline=TIMEDELAY] localfile [localfile2 localfile3 ...] [dstremotepath]";
     }
     if (!strcmp(command, "putq"))
     {
@@ -1499,9 +2059,9 @@ const char * getUsageStr(const char *command)
     if (!strcmp(command, "get"))
     {
 #ifdef USE_PCRE
-        return "get [-m] [-q] [--ignore-quota-warn] [--use-pcre] [--password=PASSWORD] exportedlink|remotepath [localpath]";
+        return "get [-m] [-q] [--ignore-quota-warn] [--skip-unchanged] [--use-pcre] [--password=PASSWORD] [--order=size|folder|none] [--max-in-flight=N] [--manifest=FILE] [--priority=N] [--deadline=TIMEDELAY] exportedlink|remotepath [localpath] | get --resume=FILE";
 #else
-        return "get [-m] [-q] [--ignore-quota-warn] [--password=PASSWORD] exportedlink|remotepath [localpath]";
+        return "get [-m] [-q] [--ignore-quota-warn] [--skip-unchanged] [--password=PASSWORD] [--order=size|folder|none] [--max-in-flight=N] [--manifest=FILE] [--priority=N] [--deadline=TIMEDELAY] exportedlink|remotepath [localpath] | get --resume=FILE";
 #endif
     }
     if (!strcmp(command, "getq"))
@@ -1522,7 +2082,7 @@ const char * getUsageStr(const char *command)
     }
     if (!strcmp(command, "mkdir"))
     {
-        return "mkdir [-p] remotepath";
+        return "mkdir [-p] remotepath [remotepath2 remotepath3 ...]";
     }
     if (!strcmp(command, "rm"))
     {
@@ -1551,12 +2111,36 @@ const char * getUsageStr(const char *command)
     if (!strcmp(command, "deleteversions"))
     {
 #ifdef USE_PCRE
-        return "deleteversions [-f] (--all | remotepath1 remotepath2 ...)  [--use-pcre]";
+        return "deleteversions [-f] [--dry-run] (--all | remotepath1 remotepath2 ...)  [--use-pcre]";
 #else
-        return "deleteversions [-f] (--all | remotepath1 remotepath2 ...)";
+        return "deleteversions [-f] [--dry-run] (--all | remotepath1 remotepath2 ...)";
 #endif
 
     }
+    if (!strcmp(command, "prefetch"))
+    {
+#ifdef USE_PCRE
+        return "prefetch [--blocks-under=SIZE] [--use-pcre] [remotepath1 remotepath2 ...]";
+#else
+        return "prefetch [--blocks-under=SIZE] [remotepath1 remotepath2 ...]";
+#endif
+    }
+    if (!strcmp(command, "blockcache"))
+    {
+#ifdef USE_PCRE
+        return "blockcache [--limit=SIZE] [--clear] | blockcache (--pin|--unpin|--prefetch) remotepath1 remotepath2 ... [--use-pcre]";
+#else
+        return "blockcache [--limit=SIZE] [--clear] | blockcache (--pin|--unpin|--prefetch) remotepath1 remotepath2 ...";
+#endif
+    }
+    if (!strcmp(command, "dedup"))
+    {
+        return "dedup [--remove [-f]] [remotepath1 remotepath2 ...]";
+    }
+    if (!strcmp(command, "diff"))
+    {
+        return "diff [--fingerprint] localpath [remotepath] [--output=ndjson]";
+    }
     if (!strcmp(command, "exclude"))
     {
         return "exclude [(-a|-d) pattern1 pattern2 pattern3 [--restart-syncs]]";
@@ -1581,7 +2165,7 @@ const char * getUsageStr(const char *command)
 #endif
     if (!strcmp(command, "sync"))
     {
-        return "sync [localpath dstremotepath| [-dsr] [ID|localpath]";
+        return "sync [localpath dstremotepath| [-dsr] [ID|localpath] [--output=ndjson]";
     }
     if (!strcmp(command, "backup"))
     {
@@ -1643,7 +2227,7 @@ const char * getUsageStr(const char *command)
     }
     if (!strcmp(command, "speedlimit"))
     {
-        return "speedlimit [-u|-d] [-h] [NEWLIMIT]";
+        return "speedlimit [-u|-d] [-h] [NEWLIMIT] [--schedule=\"HH:MM-HH:MM=LIMIT[/UPLIMIT],...\"|--schedule=none]";
     }
     if (!strcmp(command, "killsession"))
     {
@@ -1661,13 +2245,17 @@ const char * getUsageStr(const char *command)
     {
         return "proxy [URL|--auto|--none] [--username=USERNAME --password=PASSWORD]";
     }
+    if (!strcmp(command, "startup"))
+    {
+        return "startup [--timings]";
+    }
     if (!strcmp(command, "cat"))
     {
         return "cat remotepath1 remotepath2 ...";
     }
     if (!strcmp(command, "mediainfo"))
     {
-        return "info remotepath1 remotepath2 ...";
+        return "mediainfo [-r] [--output=ndjson] [--path-display-size=N] remotepath1 remotepath2 ...";
     }
     if (!strcmp(command, "passwd"))
     {
@@ -1706,7 +2294,7 @@ const char * getUsageStr(const char *command)
     }
     if (!strcmp(command, "debug"))
     {
-        return "debug";
+        return "debug [--stats]";
     }
     if (!strcmp(command, "chatf"))
     {
@@ -1750,18 +2338,18 @@ const char * getUsageStr(const char *command)
     }
     if (!strcmp(command, "thumbnail"))
     {
-        return "thumbnail [-s] remotepath localpath";
+        return "thumbnail [-s] [-r] [--skip-existing] [--layout=path|handle] [--use-pcre] remotepath [localpath]";
     }
     if (!strcmp(command, "preview"))
     {
-        return "preview [-s] remotepath localpath";
+        return "preview [-s] [-r] [--skip-existing] [--layout=path|handle] [--use-pcre] remotepath [localpath]";
     }
     if (!strcmp(command, "find"))
     {
 #ifdef USE_PCRE
-        return "find [remotepath] [-l] [--pattern=PATTERN] [--mtime=TIMECONSTRAIN] [--size=SIZECONSTRAIN] [--use-pcre] [--time-format=FORMAT] [--show-handles]";
+        return "find [remotepath] [-l] [--pattern=PATTERN] [--mtime=TIMECONSTRAIN] [--size=SIZECONSTRAIN] [--use-pcre] [--time-format=FORMAT] [--show-handles] [--output=ndjson]";
 #else
-        return "find [remotepath] [-l] [--pattern=PATTERN] [--mtime=TIMECONSTRAIN] [--size=SIZECONSTRAIN] [--time-format=FORMAT] [--show-handles]";
+        return "find [remotepath] [-l] [--pattern=PATTERN] [--mtime=TIMECONSTRAIN] [--size=SIZECONSTRAIN] [--time-format=FORMAT] [--show-handles] [--output=ndjson]";
 #endif
     }
     if (!strcmp(command, "help"))
@@ -1774,7 +2362,7 @@ const char * getUsageStr(const char *command)
     }
     if (!strcmp(command, "transfers"))
     {
-        return "transfers [-c TAG|-a] | [-r TAG|-a]  | [-p TAG|-a] [--only-downloads | --only-uploads] [SHOWOPTIONS]";
+        return "transfers [-c TAG|-a] | [-r TAG|-a]  | [-p TAG|-a] | [--priority=N] [--deadline=TIMEDELAY] TAG... | --policy=fifo|shortest-first|fair-share [--only-downloads | --only-uploads] [SHOWOPTIONS] [--output=ndjson]";
     }
 #if defined(_WIN32) && defined(NO_READLINE)
     if (!strcmp(command, "autocomplete"))
@@ -1797,7 +2385,8 @@ const char * getUsageStr(const char *command)
 
 bool validCommand(string thecommand)
 {
-    return stringcontained((char*)thecommand.c_str(), validCommands);
+    CommandDescriptor *descriptor = getCommandDescriptor(thecommand);
+    return descriptor && (descriptor->availableWhileRestricted || !restrictedCommands);
 }
 
 string getsupportedregexps()
@@ -1823,6 +2412,12 @@ void printTimeFormatHelp(ostringstream &os)
     os << "                 You can use any strftime compliant format: http://www.cplusplus.com/reference/ctime/strftime/" << endl;
 }
 
+void printOutputFormatHelp(ostringstream &os)
+{
+    os << " --output=ndjson" << "\t" << "Print one JSON object per line for each listed element, instead of human readable output." << endl;
+    os << "                " << "\t" << " Lines are written as soon as each element is processed. Intended for automation" << endl;
+}
+
 string getHelpStr(const char *command)
 {
     ostringstream os;
@@ -1974,6 +2569,8 @@ string getHelpStr(const char *command)
         os << " --versions" << "\t" << "show historical versions" << endl;
         os << "   " << "\t" << "You can delete all versions of a file with \"deleteversions\"" << endl;
         printTimeFormatHelp(os);
+        printOutputFormatHelp(os);
+        os << "   " << "\t" << " Fields: handle, path, type, size & mtime (files), ctime (folders), state (exported/shared)" << endl;
 
 #ifdef USE_PCRE
         os << " --use-pcre" << "\t" << "use PCRE expressions" << endl;
@@ -2036,6 +2633,8 @@ string getHelpStr(const char *command)
         os << " --versions" << "\t" << "Calculate size including all versions." << endl;
         os << "   " << "\t" << "You can remove all versions with \"deleteversions\" and list them with \"ls --versions\"" << endl;
         os << " --path-display-size=N" << "\t" << "Use a fixed size of N characters for paths" << endl;
+        printOutputFormatHelp(os);
+        os << "   " << "\t" << " Fields: handle, path, type, size (and size_with_versions with --versions). No total is printed" << endl;
 
 #ifdef USE_PCRE
         os << " --use-pcre" << "\t" << "use PCRE expressions" << endl;
@@ -2078,6 +2677,16 @@ string getHelpStr(const char *command)
         os << "Exported links: Exported links are usually formed as publiclink#key." << endl;
         os << " Alternativelly you can provide a password-protected link and" << endl;
         os << " provide the password with --password. Please, avoid using passwords containing \" or '" << endl;
+        os << endl;
+        os << "Options:" << endl;
+        os << " --manifest=FILE" << "\t" << "Imports all the links listed in FILE, one per line, with tab separated fields:" << endl;
+        os << "                " << "\t" << " link, password (may be empty) and remote destination (remotepath if empty)." << endl;
+        os << "                " << "\t" << " Lines starting with # are ignored" << endl;
+        os << " --results=FILE" << "\t" << "Writes the outcome of each link of the manifest into FILE. They are printed as well, as they finish:" << endl;
+        os << "               " << "\t" << " line number, link, OK or ERROR, and the handle and path imported or the error, tab separated" << endl;
+        os << " --max-in-flight=N" << "\t" << "Number of links of the manifest imported at the same time." << endl;
+        os << "                  " << "\t" << " Defaults to \"import_max_in_flight\" configuration value (8), and is capped at" << endl;
+        os << "                  " << "\t" << " \"folder_links_pool_max\" configuration value (20)" << endl;
     }
     else if (!strcmp(command, "put"))
     {
@@ -2088,6 +2697,17 @@ string getHelpStr(const char *command)
         os << " -q" << "\t" << "queue upload: execute in the background. Don't wait for it to end' " << endl;
         os << " --ignore-quota-warn" << "\t" << "ignore quota surpassing warning. " << endl;
         os << "                    " << "\t" << "  The upload will be attempted anyway." << endl;
+        os << " --skip-unchanged" << "\t" << "Do not upload files whose remote counterpart has the same contents." << endl;
+        os << "                 " << "\t" << "  Files are compared by size first, and by fingerprint only when sizes match." << endl;
+        os << "                 " << "\t" << "  Fingerprints include the modification time: files with the same contents" << endl;
+        os << "                 " << "\t" << "  but a different modification time are uploaded. A summary of the skipped" << endl;
+        os << "                 " << "\t" << "  files is printed at the end" << endl;
+        os << "                 " << "\t" << "  Local fingerprints are cached. Those of files gone or changed are dropped" << endl;
+        os << "                 " << "\t" << "  in the background. If fingerprint_verify_period (configuration value, in seconds)" << endl;
+        os << "                 " << "\t" << "  is set, the cache is also refreshed for backed up folders that often (default 0: never)" << endl;
+        os << " --priority=N" << "\t" << "Start these uploads before queued transfers of lower priority (default 0)." << endl;
+        os << " --deadline=TIMEDELAY" << "\t" << "Among queued transfers of the same priority, start first those with" << endl;
+        os << "                     " << "\t" << "  earlier deadlines (e.g: 1h30M). See \"transfers --policy\"" << endl;
 
         os << endl;
         os << "Notice that the dstremotepath can only be omitted when only one local path is provided. " << endl;
@@ -2118,10 +2738,28 @@ string getHelpStr(const char *command)
         os << "                     downloaded one (preserving the existing files)" << endl;
         os << " --ignore-quota-warn" << "\t" << "ignore quota surpassing warning. " << endl;
         os << "                    " << "\t" << "  The download will be attempted anyway." << endl;
+        os << " --skip-unchanged" << "\t" << "Do not download files whose local counterpart has the same contents." << endl;
+        os << "                 " << "\t" << "  Files are compared by size first, and by fingerprint only when sizes match." << endl;
+        os << "                 " << "\t" << "  Fingerprints include the modification time: files with the same contents" << endl;
+        os << "                 " << "\t" << "  but a different modification time are downloaded. Not available for exported links" << endl;
         os << " --password=PASSWORD" << "\t" << "Password to decrypt the password-protected link. Please, avoid using passwords containing \" or '" << endl;
+        os << " --priority=N" << "\t" << "Start these downloads before queued transfers of lower priority (default 0)." << endl;
+        os << " --deadline=TIMEDELAY" << "\t" << "Among queued transfers of the same priority, start first those with" << endl;
+        os << "                     " << "\t" << "  earlier deadlines (e.g: 1h30M). See \"transfers --policy\"" << endl;
 #ifdef USE_PCRE
         os << " --use-pcre" << "\t" << "use PCRE expressions" << endl;
 #endif
+        os << endl;
+        os << "Options for remote paths matching several nodes:" << endl;
+        os << " --order=size|folder|none" << "\t" << "Order in which downloads are queued: smaller files first (default)," << endl;
+        os << "                         " << "\t" << "  grouped by containing folder, or as found" << endl;
+        os << " --max-in-flight=N" << "\t" << "Do not queue a new download while N of them are ongoing. " << endl;
+        os << "                  " << "\t" << "  Defaults to configuration value max_in_flight_downloads (0: no limit)" << endl;
+        os << " --manifest=FILE" << "\t" << "Record the resolved downloads (and their completion) into FILE" << endl;
+        os << " --resume=FILE" << "\t" << "Resume the downloads recorded in a manifest that have not completed," << endl;
+        os << "              " << "\t" << "  without resolving the remote paths again" << endl;
+        os << endl;
+        os << "Local folders for the downloaded folders are created beforehand, in parallel." << endl;
 
     }
     if (!strcmp(command, "attr"))
@@ -2147,6 +2785,9 @@ string getHelpStr(const char *command)
         os << endl;
         os << "Options:" << endl;
         os << " -p" << "\t" << "Allow recursive" << endl;
+        os << endl;
+        os << "With -p, the folders of all the given paths are created level by level, sharing their common" << endl;
+        os << " parents and creating the folders of the same level concurrently." << endl;
     }
     else if (!strcmp(command, "rm"))
     {
@@ -2227,12 +2868,91 @@ string getHelpStr(const char *command)
         os << "Options:" << endl;
         os << " -f   " << "\t" << "Force (no asking)" << endl;
         os << " --all" << "\t" << "Delete versions of all nodes. This will delete the version histories of all files (not current files)." << endl;
+        os << " --dry-run" << "\t" << "Do not delete anything: only report the versions found and the space they take" << endl;
 #ifdef USE_PCRE
         os << " --use-pcre" << "\t" << "use PCRE expressions" << endl;
 #endif
         os << endl;
         os << "To see versions of a file use \"ls --versions\"." << endl;
         os << "To see space occupied by file versions use \"du --versions\"." << endl;
+        os << endl;
+        os << "Folders are scanned in parallel, printing the number and size of the versions found in each of them." << endl;
+        os << " Versions are then deleted keeping several requests in flight, reporting the progress." << endl;
+    }
+    else if (!strcmp(command, "prefetch"))
+    {
+        os << "Warms up remote folders in the background, for the commands that will use them next" << endl;
+        os << endl;
+        os << "The trees under the given paths are walked by \"prefetch_parallelism\" threads (4 by default)," << endl;
+        os << "caching the paths of their nodes and the media info of their files." << endl;
+        os << "The command returns straight away: progress is reported to the shell and a message is shown at the end." << endl;
+        os << "Prefetches requested at once are run one after the other." << endl;
+        os << "If no path is given, it lists the prefetches requested lately and their progress." << endl;
+        os << endl;
+        os << "Options:" << endl;
+        os << " --blocks-under=SIZE" << "\t" << "Downloads the files up to SIZE into the block cache (see \"blockcache --help\")" << endl;
+#ifdef USE_PCRE
+        os << " --use-pcre" << "\t" << "use PCRE expressions" << endl;
+#endif
+    }
+    else if (!strcmp(command, "blockcache"))
+    {
+        os << "Manages the local cache of blocks of remote files" << endl;
+        os << endl;
+        os << "When enabled, the contents streamed with \"cat\" are kept in blocks of 1 MB in the configuration folder," << endl;
+        os << "so that reading them again does not download them. The least recently used blocks are evicted" << endl;
+        os << "when the cache grows beyond its size, except those of pinned files." << endl;
+        os << "If no option is given, it prints the size of the cache, its hit ratio, the bytes saved and the pinned files." << endl;
+        os << endl;
+        os << "Options:" << endl;
+        os << " --limit=SIZE" << "\t" << "Sets the size of the cache (e.g. 2G). 0 disables it (default)" << endl;
+        os << " --clear" << "\t" << "Empties the cache, pinned files included" << endl;
+        os << " --pin" << "\t" << "Downloads the given files into the cache and keeps them there." << endl;
+        os << "      " << "\t" << " Files are not pinned if the pinned ones would not fit in the cache altogether" << endl;
+        os << " --unpin" << "\t" << "Lets the blocks of the given files be evicted" << endl;
+        os << " --prefetch" << "\t" << "Downloads the given files into the cache" << endl;
+#ifdef USE_PCRE
+        os << " --use-pcre" << "\t" << "use PCRE expressions" << endl;
+#endif
+        os << endl;
+        os << "Note: WebDAV and FTP servers serve files by themselves, without this cache." << endl;
+    }
+    else if (!strcmp(command, "dedup"))
+    {
+        os << "Finds duplicated files" << endl;
+        os << endl;
+        os << "Files with the same size and fingerprint CRC under the given paths (current folder by default)" << endl;
+        os << " are listed in groups, as soon as each group is found, followed by the space they waste." << endl;
+        os << endl;
+        os << "Options:" << endl;
+        os << " --remove" << "\t" << "Move the duplicates to the Rubbish Bin, keeping the oldest copy of each group." << endl;
+        os << "         " << "\t" << " Their whole contents are downloaded and compared first: only identical files are removed" << endl;
+        os << " -f   " << "\t" << "Force (no asking)" << endl;
+        os << endl;
+        os << "Folders are scanned in parallel, and fingerprint CRCs are only compared among files of the same size." << endl;
+        os << "That CRC samples parts of the contents, so files listed without --remove may still differ." << endl;
+        os << "Modification times are not taken into account." << endl;
+    }
+    else if (!strcmp(command, "diff"))
+    {
+        os << "Shows the differences between a local folder and a remote one, without transferring anything" << endl;
+        os << endl;
+        os << "remotepath defaults to the current folder. Entries are matched by name, and reported as:" << endl;
+        os << " added  " << "\t" << "only present in the local folder" << endl;
+        os << " removed" << "\t" << "only present in the remote folder. Remote entries sharing a name with a sibling" << endl;
+        os << "        " << "\t" << "are matched only once: the others are reported as removed" << endl;
+        os << " changed" << "\t" << "with a different type, size or fingerprint CRC" << endl;
+        os << "Files with the same size and modification time are considered equal. Otherwise, files with" << endl;
+        os << "the same size are compared by fingerprint CRC, which samples their contents, regardless of" << endl;
+        os << "their modification times." << endl;
+        os << "Folders only present at one side are reported as a whole, without listing their contents." << endl;
+        os << endl;
+        os << "Options:" << endl;
+        os << " --fingerprint" << "\t" << "Compare the fingerprint CRCs of the files with the same size, even if their modification times match" << endl;
+        printOutputFormatHelp(os);
+        os << "   " << "\t" << " Fields: status, path, type, local_size and remote_size. No summary is printed" << endl;
+        os << endl;
+        os << "Both trees are walked folder by folder in parallel, and differences are printed as soon as each folder is compared." << endl;
     }
 #ifdef HAVE_LIBUV
     else if (!strcmp(command, "webdav"))
@@ -2306,6 +3026,11 @@ string getHelpStr(const char *command)
         os << "  This will cause active transfers to be restarted" << endl;
         os << "  In certain cases --restart-syncs might be unable to re-enable a synchronization. " << endl;
         os << "  In such case, you will need to manually resume it or restart MEGAcmd server." << endl;
+        os << endl;
+        os << "Excluded names are skipped as well when MEGAcmd walks local folders itself:" << endl;
+        os << " when the files of backups are scanned and when completing local paths (unless you have started" << endl;
+        os << " typing the name). Uploads are not affected." << endl;
+        os << " Excluded folders are not descended into." << endl;
     }
     else if (!strcmp(command, "sync"))
     {
@@ -2324,6 +3049,8 @@ string getHelpStr(const char *command)
         os << "-s" << " " << "ID|localpath" << "\t" << "stops(pauses) a synchronization" << endl;
         os << "-r" << " " << "ID|localpath" << "\t" << "resumes a synchronization" << endl;
         os << " --path-display-size=N" << "\t" << "Use at least N characters for displaying paths" << endl;
+        printOutputFormatHelp(os);
+        os << "   " << "\t" << " Fields: id, localpath, path, handle, state, pathstate, size, files & folders" << endl;
     }
     else if (!strcmp(command, "backup"))
     {
@@ -2346,6 +3073,11 @@ string getHelpStr(const char *command)
         os << "Display Options:" << endl;
         os << "-l\t" << "Show extended info: period, max number, next scheduled backup" << endl;
         os << "  \t" << " or the status of current/last backup" << endl;
+        os << "  \t" << " It also shows the counters of the fingerprints change journal of the local folder, which records" << endl;
+        os << "  \t" << " the paths changed between the refreshes of the local fingerprints cache every" << endl;
+        os << "  \t" << " fingerprint_verify_period (see \"put --help\"). Backups do not use it to find changes." << endl;
+        os << "  \t" << " It is disabled by default: set configuration value backup_change_journal to 1, along with" << endl;
+        os << "  \t" << " fingerprint_verify_period (Linux only)" << endl;
         os << "-h\t" << "Show history of created backups" << endl;
         os << "  \t" << "Backup states:" << endl;
         os << "  \t"  << "While a backup is being performed, the backup will be considered and labeled as ONGOING" << endl;
@@ -2533,6 +3265,13 @@ string getHelpStr(const char *command)
         os << " -d" << "\t" << "Download speed limit" << endl;
         os << " -u" << "\t" << "Upload speed limit" << endl;
         os << " -h" << "\t" << "Human readable" << endl;
+        os << " --schedule=\"HH:MM-HH:MM=LIMIT[/UPLIMIT],...\"" << "\t" << "Sets time windows with their own limits (download/upload, or the same for both)." << endl;
+        os << "    " << "\t" << "Out of those windows, the base limits (NEWLIMIT) apply. Windows may cross midnight." << endl;
+        os << "    " << "\t" << "e.g: --schedule=\"08:00-20:00=1M/256K,20:00-08:00=0\". Use --schedule=none to remove it" << endl;
+        os << endl;
+        os << "When several clients transfer at the same time, the limit in effect is shared among them:" << endl;
+        os << "the transfers of a client using more than its share are paused until it is back within it." << endl;
+        os << "Active clients are listed with the throughput observed and the one allowed." << endl;
         os << endl;
         os << "Notice: this limit will be saved for the next time you execute MEGAcmd server. They will be removed if you logout." << endl;
     }
@@ -2577,10 +3316,22 @@ string getHelpStr(const char *command)
         os << " --password=PASSWORD" << "\t" << "The password, for authenticated proxies. Please, avoid using passwords containing \" or '" << endl;
 
     }
+    else if (!strcmp(command, "startup"))
+    {
+        os << "Shows whether the account is ready after login or server startup" << endl;
+        os << endl;
+        os << "Once nodes are fetched, backups and webdav/ftp served locations are restored in parallel." << endl;
+        os << "Meanwhile, the readiness is \"nodes available\": most commands can be used, those depending " << endl;
+        os << "on what is being restored (backup, webdav, ftp) will wait for it to complete." << endl;
+        os << endl;
+        os << "Options:" << endl;
+        os << " --timings" << "\t" << "Shows when each stage started (since server start) and how long it took" << endl;
+    }
     else if (!strcmp(command, "cat"))
     {
         os << "Prints the contents of remote files" << endl;
         os << endl;
+        os << "Contents are read from the local block cache when enabled (see \"blockcache --help\")" << endl;
 #ifdef _WIN32
         os << "To avoid issues with encoding, if you want to cat the exact binary contents of a remote file into a local one, " << endl;
         os << "use non-interactive mode with -o /path/to/file. See help \"non-interactive\"" << endl;
@@ -2591,7 +3342,15 @@ string getHelpStr(const char *command)
         os << "Prints media info of remote files" << endl;
         os << endl;
         os << "Options:" << endl;
+        os << " -r" << "\t" << "Lists the files with media info within the folders given, recursively." << endl;
+        os << "   " << "\t" << " Folders are walked by several threads (see \"mediainfo_parallelism\" configuration value, 8 by default)" << endl;
         os << " --path-display-size=N" << "\t" << "Use a fixed size of N characters for paths" << endl;
+        printOutputFormatHelp(os);
+#ifdef USE_PCRE
+        os << " --use-pcre" << "\t" << "use PCRE expressions" << endl;
+#endif
+        os << endl;
+        os << "Media info decoded from files is cached, so that repeating the query on the same files is faster." << endl;
     }
     else if (!strcmp(command, "passwd"))
     {
@@ -2623,17 +3382,43 @@ string getHelpStr(const char *command)
     {
         os << "To download/upload the thumbnail of a file." << endl;
         os << " If no -s is inidicated, it will download the thumbnail." << endl;
+        os << " remotepath may be a pattern or, with -r, a folder: localpath is then a folder where the thumbnails are saved" << endl;
+        os << " (or taken from, with -s) as the remote paths followed by \".jpg\"" << endl;
         os << endl;
         os << "Options:" << endl;
         os << " -s" << "\t" << "Sets the thumbnail to the specified file" << endl;
+        os << " -r" << "\t" << "Processes the files within folders recursively" << endl;
+        os << " --skip-existing" << "\t" << "Skips files whose thumbnail is already saved locally (or already set, with -s)" << endl;
+        os << " --layout=path|handle" << "\t" << "Names local files after the remote paths (default) or after the handles of the files." << endl;
+        os << "                     " << "\t" << " Paths of the matches of a pattern are relative to the folder it starts at. Files that" << endl;
+        os << "                     " << "\t" << " would be saved into the same local file fail: use --layout=handle for them" << endl;
+#ifdef USE_PCRE
+        os << " --use-pcre" << "\t" << "use PCRE expressions" << endl;
+#endif
+        os << endl;
+        os << "Several requests are kept in flight (see \"thumbnail_window\" configuration value, 16 by default)." << endl;
+        os << "Failures are reported for each file." << endl;
     }
     else if (!strcmp(command, "preview"))
     {
         os << "To download/upload the preview of a file." << endl;
         os << " If no -s is inidicated, it will download the preview." << endl;
+        os << " remotepath may be a pattern or, with -r, a folder: localpath is then a folder where the previews are saved" << endl;
+        os << " (or taken from, with -s) as the remote paths followed by \".jpg\"" << endl;
         os << endl;
         os << "Options:" << endl;
         os << " -s" << "\t" << "Sets the preview to the specified file" << endl;
+        os << " -r" << "\t" << "Processes the files within folders recursively" << endl;
+        os << " --skip-existing" << "\t" << "Skips files whose preview is already saved locally (or already set, with -s)" << endl;
+        os << " --layout=path|handle" << "\t" << "Names local files after the remote paths (default) or after the handles of the files." << endl;
+        os << "                     " << "\t" << " Paths of the matches of a pattern are relative to the folder it starts at. Files that" << endl;
+        os << "                     " << "\t" << " would be saved into the same local file fail: use --layout=handle for them" << endl;
+#ifdef USE_PCRE
+        os << " --use-pcre" << "\t" << "use PCRE expressions" << endl;
+#endif
+        os << endl;
+        os << "Several requests are kept in flight (see \"thumbnail_window\" configuration value, 16 by default)." << endl;
+        os << "Failures are reported for each file." << endl;
     }
     else if (!strcmp(command, "find"))
     {
@@ -2662,12 +3447,22 @@ string getHelpStr(const char *command)
 #endif
         os << " -l" << "\t" << "Prints file info" << endl;
         printTimeFormatHelp(os);
+        printOutputFormatHelp(os);
+        os << "   " << "\t" << " Fields: handle, path, type, size & mtime (files), ctime (folders), state (exported/shared)" << endl;
     }
     else if(!strcmp(command,"debug") )
     {
         os << "Enters debugging mode (HIGHLY VERBOSE)" << endl;
         os << endl;
         os << "For a finer control of log level see \"log --help\"" << endl;
+        os << endl;
+        os << "Options:" << endl;
+        os << " --stats" << "\t" << "Instead, prints how many times each command has been executed since MEGAcmd server started," << endl;
+        os << "        " << "\t" << "how many of those failed, its cost class and latency percentiles" << endl;
+        os << "        " << "\t" << "how often the sessions of folder links were reused, and the time that saved," << endl;
+        os << "        " << "\t" << "how many account details, media info queries and file blocks were served from cache," << endl;
+        os << "        " << "\t" << "how many local entries were skipped for being excluded (see \"exclude --help\")" << endl;
+        os << "        " << "\t" << "and how long transfers waited queued (see \"transfers --help\")" << endl;
     }
     else if (!strcmp(command, "quit") || !strcmp(command, "exit"))
     {
@@ -2693,14 +3488,29 @@ string getHelpStr(const char *command)
         os << " -r (TAG|-a)" << "\t" << "Resume transfer with TAG (or all with -a)" << endl;
         os << " --only-uploads" << "\t" << "Show/Operate only upload transfers" << endl;
         os << " --only-downloads" << "\t" << "Show/Operate only download transfers" << endl;
+        os << " --priority=N TAG..." << "\t" << "Sets the priority of queued transfers: higher ones start first" << endl;
+        os << " --deadline=TIMEDELAY TAG..." << "\t" << "Sets the deadline of queued transfers (e.g: 1h30M): among those with" << endl;
+        os << "                            " << "\t" << "  the same priority, earlier deadlines start first" << endl;
+        os << " --policy=POLICY" << "\t" << "Sets the order in which queued transfers of the same priority and deadline start:" << endl;
+        os << "                " << "\t" << "  fifo: in the order they were requested (default)" << endl;
+        os << "                " << "\t" << "  shortest-first: smaller ones first" << endl;
+        os << "                " << "\t" << "  fair-share: taking turns among the clients that requested them" << endl;
+        os << "                " << "\t" << "  Queued transfers are moved in the queue to follow it once per second" << endl;
         os << endl;
         os << "Show options:" << endl;
+        os << " --queue" << "\t" << "Shows the policy in effect and the transfers in the order they will start," << endl;
+        os << "        " << "\t" << "  with the time they have waited queued (or waited before starting)." << endl;
+        os << "        " << "\t" << "  With --show-completed, also the last ones finished" << endl;
         os << " --summary" << "\t" << "Prints summary of on going transfers" << endl;
         os << " --show-syncs" << "\t" << "Show synchronization transfers" << endl;
         os << " --show-completed" << "\t" << "Show completed transfers" << endl;
         os << " --only-completed" << "\t" << "Show only completed download" << endl;
         os << " --limit=N" << "\t" << "Show only first N transfers" << endl;
         os << " --path-display-size=N" << "\t" << "Use at least N characters for displaying paths" << endl;
+        printOutputFormatHelp(os);
+        os << "   " << "\t" << " Fields: tag, type, sync, backup, handle, path, localpath, size, transferred & state" << endl;
+        os << "   " << "\t" << " With --summary, one line with the totals of downloads and another one with those of uploads" << endl;
+        os << "   " << "\t" << " With --queue, fields: tag, type, client, priority, deadline, size, wait_ms & state" << endl;
         os << endl;
         os << "TYPE legend correspondence:" << endl;
 #ifdef _WIN32
@@ -2902,17 +3712,27 @@ void executecommand(char* ptr)
     map<string, string> cloptions;
     map<string, int> clflags;
 
-    set<string> validParams;
-    addGlobalFlags(&validParams);
+    static const set<string> globalParams(validGlobalParameters.begin(), validGlobalParameters.end());
 
-    if (setOptionsAndFlags(&cloptions, &clflags, &words, validParams, true))
+    if (setOptionsAndFlags(&cloptions, &clflags, &words, globalParams, true))
     {
         setCurrentOutCode(MCMD_EARGS);
         LOG_err << "      " << getUsageStr(thecommand.c_str());
         return;
     }
 
-    insertValidParamsPerCommand(&validParams, thecommand);
+    CommandDescriptor *descriptor = getCommandDescriptor(thecommand);
+
+    if (descriptor && !validCommand(thecommand) && loginInAtStartup && !blocked)
+    {
+        // e.g. right after a (re)start: rather than failing, hold the command until the session is resumed and nodes are available
+        int timeout = ConfigurationManager::getConfigurationValue("startup_hold_timeout", 120);
+        LOG_verbose << "Holding " << thecommand << " until login ends";
+        if (timeout > 0)
+        {
+            waitForLoginInAtStartup(timeout);
+        }
+    }
 
     if (!validCommand(thecommand))   //unknown command
     {
@@ -2928,10 +3748,10 @@ void executecommand(char* ptr)
         return;
     }
 
-    if (setOptionsAndFlags(&cloptions, &clflags, &words, validParams))
+    if (setOptionsAndFlags(&cloptions, &clflags, &words, descriptor->validParams))
     {
         setCurrentOutCode(MCMD_EARGS);
-        LOG_err << "      " << getUsageStr(thecommand.c_str());
+        LOG_err << "      " << descriptor->usage;
         return;
     }
     setCurrentThreadLogLevel(MegaApi::LOG_LEVEL_ERROR + (getFlag(&clflags, "v")?(1+getFlag(&clflags, "v")):0));
@@ -2943,6 +3763,29 @@ void executecommand(char* ptr)
         return;
     }
 
+    CommandExecutionRecorder recorder(descriptor);
+
+    if ( thecommand == "debug" && getFlag(&clflags, "stats"))
+    {
+        printCommandStats();
+        printApiFolderStats();
+        OUTSTREAM << "Account details: " << sandboxCMD->accountDetails.getHits() << " served from cache, "
+                  << sandboxCMD->accountDetails.getMisses() << " fetched" << endl;
+        OUTSTREAM << "Media info: " << sandboxCMD->mediaInfoCache.getHits() << " served from cache, "
+                  << sandboxCMD->mediaInfoCache.getMisses() << " decoded" << endl;
+        OUTSTREAM << "Block cache: " << cmdexecuter->getBlockCache().getHits() << " blocks served from cache, "
+                  << cmdexecuter->getBlockCache().getMisses() << " downloaded" << endl;
+        OUTSTREAM << "Excluded names: " << ExclusionMatcher::getPrunedEntries() << " local entries skipped ("
+                  << sizeToText(ExclusionMatcher::getPrunedBytes(), false) << " in files)" << endl;
+        unsigned long long waits, moved;
+        long long averageWaitMs, maxWaitMs;
+        sandboxCMD->transferQueue.getWaitStats(&waits, &averageWaitMs, &maxWaitMs, &moved);
+        OUTSTREAM << "Transfer queue: " << waits << " transfers started after waiting " << averageWaitMs << " ms on average ("
+                  << maxWaitMs << " ms at most), " << moved << " moved by the " << TransferQueueScheduler::policyToString(TransferQueueScheduler::getPolicy())
+                  << " policy" << endl;
+        return;
+    }
+
     if ( thecommand == "help" )
     {
         if (getFlag(&clflags,"upgrade"))
@@ -3105,7 +3948,19 @@ void executecommand(char* ptr)
         return;
     }
 
-    cmdexecuter->executecommand(words, &clflags, &cloptions);
+    if (descriptor->requiredStage != STARTUP_STAGES_TOTAL && !waitForStartupStage(descriptor->requiredStage))
+    {
+        LOG_warn << "Startup still in progress (" << getStartupReadinessStr() << "). Executing " << thecommand << " nevertheless";
+    }
+
+    if (descriptor->handler)
+    {
+        (cmdexecuter->*(descriptor->handler))(words, &clflags, &cloptions);
+    }
+    else
+    {
+        cmdexecuter->executecommand(words, &clflags, &cloptions);
+    }
 }
 
 bool executeUpdater(bool *restartRequired, bool doNotInstall = false)
@@ -3292,10 +4147,13 @@ bool restartServer()
             return false;
         }
 #else
+    // the new server inherits the listening socket: clients are queued until it is ready instead of finding no server
+    int inheritedSocket = cm ? cm->prepareListeningSocketInheritance() : -1;
+
     pid_t childid = fork();
     if ( childid ) //parent
     {
-        char **argv = new char*[mcmdMainArgc+3];
+        char **argv = new char*[mcmdMainArgc+5];
         int i = 0, j = 0;
 
 #ifdef __linux__
@@ -3311,9 +4169,9 @@ bool restartServer()
 
         for (;i < mcmdMainArgc; i++)
         {
-            if ( (i+1) < mcmdMainArgc && !strcmp(mcmdMainArgv[i],"--wait-for"))
+            if ( (i+1) < mcmdMainArgc && (!strcmp(mcmdMainArgv[i],"--wait-for") || !strcmp(mcmdMainArgv[i],"--inherited-socket")))
             {
-                i+=2;
+                i++;
             }
             else
             {
@@ -3321,8 +4179,15 @@ bool restartServer()
             }
         }
 
+        string schildid = SSTR(childid);
         argv[j++]="--wait-for";
-        argv[j++]=(char*)SSTR(childid).c_str();
+        argv[j++]=(char*)schildid.c_str();
+        string sinheritedSocket = SSTR(inheritedSocket);
+        if (inheritedSocket >= 0)
+        {
+            argv[j++]="--inherited-socket";
+            argv[j++]=(char*)sinheritedSocket.c_str();
+        }
         argv[j++]=NULL;
 
         LOG_debug << "Restarting the server : <" << argv[0] << ">";
@@ -3366,6 +4231,8 @@ bool isBareCommand(const char *l, const string &command)
    return true;
 }
 
+static bool process_batch(char* l);
+
 static bool process_line(char* l)
 {
     switch (prompt)
@@ -3486,6 +4353,11 @@ static bool process_line(char* l)
                 cm->informStateListeners(sack);
                 break;
             }
+            else if (!strncmp(l, BATCH_PETITION, strlen(BATCH_PETITION))
+                     && (l[strlen(BATCH_PETITION)] == ' ' || l[strlen(BATCH_PETITION)] == BATCH_COMMAND_SEPARATOR))
+            {
+                return process_batch(l);
+            }
 
 #if defined(_WIN32) || defined(__APPLE__)
             else if (isBareCommand(l, "update")) //if extra args are received, it'll be processed by executer
@@ -3533,6 +4405,71 @@ static bool process_line(char* l)
     return false; //Do not exit
 }
 
+/**
+ * @brief Executes the commands of a batch petition one after the other, sending the output of each one
+ * followed by its exit code as soon as it completes: after a "### exit code N: command" line, or
+ * followed by '\0' N '\0' with --null.
+ *
+ * The exit code of the petition is that of the first command that failed.
+ * @return true if one of the commands requested to exit
+ */
+static bool process_batch(char* l)
+{
+    string petition(l);
+    size_t pos = petition.find(BATCH_COMMAND_SEPARATOR);
+    bool nullDelimited = petition.substr(0, pos).find("--null") != string::npos;
+
+    LoggedStream &petitionOut = getCurrentOut();
+    int batchOutCode = MCMD_OK;
+    bool exitRequested = false;
+    while (pos != string::npos && !exitRequested)
+    {
+        size_t next = petition.find(BATCH_COMMAND_SEPARATOR, pos + 1);
+        string command = petition.substr(pos + 1, (next == string::npos) ? string::npos : next - pos - 1);
+        pos = next;
+        if (!command.size())
+        {
+            continue;
+        }
+
+        OUTSTRINGSTREAM commandOutput;
+        LoggedStream commandOut(&commandOutput);
+        setCurrentThreadOutStream(&commandOut);
+        setCurrentOutCode(MCMD_OK);
+
+        vector<char> line(command.begin(), command.end());
+        line.push_back('\0');
+        exitRequested = process_line(line.data());
+
+        setCurrentThreadOutStream(&petitionOut);
+        int outCode = getCurrentOutCode();
+        if (outCode != MCMD_OK && batchOutCode == MCMD_OK)
+        {
+            batchOutCode = outCode;
+        }
+
+        OUTSTRING output = commandOutput.str();
+        OUTSTRINGSTREAM result;
+        result << output;
+        if (nullDelimited)
+        {
+            result << '\0' << -outCode << '\0';
+        }
+        else
+        {
+            if (output.size() && output[output.size() - 1] != '\n')
+            {
+                result << "\n";
+            }
+            result << "### exit code " << -outCode << ": " << command << "\n";
+        }
+        petitionOut << result.str();
+    }
+
+    setCurrentOutCode(batchOutCode);
+    return exitRequested;
+}
+
 void * doProcessLine(void *pointer)
 {
     CmdPetition *inf = (CmdPetition*)pointer;
@@ -3705,17 +4642,22 @@ void finalize(bool waitForRestartSignal)
         threadRetryConnections->join();
     }
     delete threadRetryConnections;
+    if (threadBandwidthScheduler)
+    {
+        threadBandwidthScheduler->join();
+    }
+    delete threadBandwidthScheduler;
     delete api;
 
-    while (!apiFolders.empty())
+    for (auto &session : apiFolders)
     {
-        delete apiFolders.front();
-        apiFolders.pop();
+        delete session.apiFolder;
     }
+    apiFolders.clear();
 
-    for (std::vector< MegaApi * >::iterator it = occupiedapiFolders.begin(); it != occupiedapiFolders.end(); ++it)
+    for (auto &session : occupiedapiFolders)
     {
-        delete ( *it );
+        delete session.apiFolder;
     }
 
     occupiedapiFolders.clear();
@@ -3758,6 +4700,7 @@ void * retryConnections(void *pointer)
     {
         LOG_verbose << "Calling recurrent retryPendingConnections";
         api->retryPendingConnections();
+        sweepApiFolders();
 
         int count = 100;
         while (!doExit && --count)
@@ -3768,6 +4711,21 @@ void * retryConnections(void *pointer)
     return NULL;
 }
 
+void * scheduleBandwidth(void *pointer)
+{
+    while(!doExit)
+    {
+        sandboxCMD->bandwidthScheduler.tick(api);
+        sandboxCMD->transferQueue.reorder(api);
+
+        int count = 4;
+        while (!doExit && count--)
+        {
+            sleepMilliSeconds(250);
+        }
+    }
+    return NULL;
+}
 
 void startcheckingForUpdates()
 {
@@ -3910,6 +4868,8 @@ void megacmd()
 {
     threadRetryConnections = new MegaThread();
     threadRetryConnections->start(retryConnections, NULL);
+    threadBandwidthScheduler = new MegaThread();
+    threadBandwidthScheduler->start(scheduleBandwidth, NULL);
 
     LOG_info << "Listening to petitions ... ";
 
@@ -4623,6 +5583,9 @@ bool getloginInAtStartup()
     return timeOfLoginInAtStartup;
 }
 
+static std::mutex startupStagesMutex;
+static std::condition_variable startupStagesCV; // notified on stage completion and when valid commands change
+
 void setloginInAtStartup(bool value)
 {
     loginInAtStartup = value;
@@ -4633,6 +5596,113 @@ void setloginInAtStartup(bool value)
     updatevalidCommands();
 }
 
+bool waitForLoginInAtStartup(int seconds)
+{
+    std::unique_lock<std::mutex> lock(startupStagesMutex);
+    return startupStagesCV.wait_for(lock, std::chrono::seconds(seconds), []() { return !restrictedCommands || blocked; });
+}
+
+enum StartupStageStatus
+{
+    STARTUP_STAGE_PENDING, STARTUP_STAGE_RUNNING, STARTUP_STAGE_DONE, STARTUP_STAGE_FAILED
+};
+
+static const char *startupStageNames[STARTUP_STAGES_TOTAL] = { "session", "nodes", "backups", "webdav", "ftp" };
+static const std::chrono::steady_clock::time_point serverStartTime = std::chrono::steady_clock::now();
+
+struct StartupStageState
+{
+    StartupStageStatus status = STARTUP_STAGE_PENDING;
+    std::chrono::steady_clock::time_point start;
+    std::chrono::steady_clock::time_point end;
+};
+
+static StartupStageState startupStages[STARTUP_STAGES_TOTAL];
+
+void startupStageStarted(StartupStage stage)
+{
+    std::lock_guard<std::mutex> g(startupStagesMutex);
+    startupStages[stage].status = STARTUP_STAGE_RUNNING;
+    startupStages[stage].start = std::chrono::steady_clock::now();
+}
+
+void startupStageEnded(StartupStage stage, bool succeeded)
+{
+    {
+        std::lock_guard<std::mutex> g(startupStagesMutex);
+        if (startupStages[stage].status != STARTUP_STAGE_RUNNING)
+        {
+            return;
+        }
+        startupStages[stage].status = succeeded ? STARTUP_STAGE_DONE : STARTUP_STAGE_FAILED;
+        startupStages[stage].end = std::chrono::steady_clock::now();
+        LOG_debug << "Startup stage " << startupStageNames[stage] << (succeeded ? " completed" : " failed") << " in "
+                  << std::chrono::duration_cast<std::chrono::milliseconds>(startupStages[stage].end - startupStages[stage].start).count() << " ms";
+    }
+    startupStagesCV.notify_all();
+}
+
+bool waitForStartupStage(StartupStage stage, int timeoutSeconds)
+{
+    std::unique_lock<std::mutex> lock(startupStagesMutex);
+    if (startupStages[stage].status == STARTUP_STAGE_RUNNING)
+    {
+        LOG_verbose << "Waiting for startup stage " << startupStageNames[stage] << " to complete";
+        return startupStagesCV.wait_for(lock, std::chrono::seconds(timeoutSeconds), [stage]() { return startupStages[stage].status != STARTUP_STAGE_RUNNING; });
+    }
+    return true;
+}
+
+string getStartupReadinessStr()
+{
+    std::lock_guard<std::mutex> g(startupStagesMutex);
+    if (startupStages[STARTUP_STAGE_SESSION].status == STARTUP_STAGE_RUNNING)
+    {
+        return "logging in";
+    }
+    if (startupStages[STARTUP_STAGE_NODES].status == STARTUP_STAGE_RUNNING)
+    {
+        return "fetching nodes";
+    }
+    if (startupStages[STARTUP_STAGE_NODES].status != STARTUP_STAGE_DONE)
+    {
+        return "not logged in";
+    }
+    for (int i = STARTUP_STAGE_NODES + 1; i < STARTUP_STAGES_TOTAL; i++)
+    {
+        if (startupStages[i].status == STARTUP_STAGE_RUNNING)
+        {
+            return "nodes available";
+        }
+    }
+    return "ready";
+}
+
+void printStartupTimings()
+{
+    OUTSTREAM << getFixLengthString("STAGE", 10) << getFixLengthString("STATUS", 9) << getFixLengthString("START(ms)", 11, ' ', true)
+              << getFixLengthString("DURATION(ms)", 14, ' ', true) << endl;
+
+    std::lock_guard<std::mutex> g(startupStagesMutex);
+    auto now = std::chrono::steady_clock::now();
+    for (int i = 0; i < STARTUP_STAGES_TOTAL; i++)
+    {
+        const StartupStageState &state = startupStages[i];
+        OUTSTREAM << getFixLengthString(startupStageNames[i], 10);
+        if (state.status == STARTUP_STAGE_PENDING)
+        {
+            OUTSTREAM << "-" << endl;
+            continue;
+        }
+
+        const char *status = state.status == STARTUP_STAGE_RUNNING ? "running" : (state.status == STARTUP_STAGE_DONE ? "done" : "failed");
+        auto end = state.status == STARTUP_STAGE_RUNNING ? now : state.end;
+        OUTSTREAM << getFixLengthString(status, 9)
+                  << getFixLengthString(SSTR(std::chrono::duration_cast<std::chrono::milliseconds>(state.start - serverStartTime).count()), 11, ' ', true)
+                  << getFixLengthString(SSTR(std::chrono::duration_cast<std::chrono::milliseconds>(end - state.start).count()), 14, ' ', true) << endl;
+    }
+}
+
 void unblock()
 {
     setBlocked(0);
@@ -4672,6 +5742,11 @@ void updatevalidCommands()
     {
         validCommands = allValidCommands;
     }
+    {
+        std::lock_guard<std::mutex> g(startupStagesMutex);
+        restrictedCommands = loginInAtStartup || blocked;
+    }
+    startupStagesCV.notify_all();
 }
 
 void reset()
@@ -4804,6 +5879,9 @@ int main(int argc, char* argv[])
     }
 #endif
 
+    string sinheritedSocket;
+    int inheritedSocket = extractargparam(args, "--inherited-socket", sinheritedSocket) ? atoi(sinheritedSocket.c_str()) : -1;
+
     string shandletowait;
     bool dowaitforhandle = extractargparam(args, "--wait-for", shandletowait);
     if (dowaitforhandle)
@@ -4894,13 +5972,10 @@ int main(int argc, char* argv[])
 
     api->setLanguage(localecode.c_str());
 
-    for (int i = 0; i < 5; i++)
+    for (int i = 0; i < INITIAL_API_FOLDERS; i++)
     {
-        MegaApi *apiFolder = new MegaApi("BdARkQSQ", (MegaGfxProcessor*)NULL, (const char*)NULL, userAgent);
-        apiFolder->setLanguage(localecode.c_str());
-        apiFolders.push(apiFolder);
-        apiFolder->setLogLevel(MegaApi::LOG_LEVEL_MAX);
-        semaphoreapiFolders.release();
+        apiFolders.push_back(ApiFolderSession(newApiFolder()));
+        numapiFolders++;
     }
 
     for (int i = 0; i < 100; i++)
@@ -4913,6 +5988,7 @@ int main(int argc, char* argv[])
     sandboxCMD = new MegaCmdSandbox();
     cmdexecuter = new MegaCmdExecuter(api, loggerCMD, sandboxCMD);
     sandboxCMD->cmdexecuter = cmdexecuter;
+    getCommandDescriptor(""); // builds the command registry before any petition arrives
 
     megaCmdGlobalListener = new MegaCmdGlobalListener(loggerCMD, sandboxCMD);
     megaCmdMegaListener = new MegaCmdMegaListener(api, NULL, sandboxCMD);
@@ -4934,7 +6010,11 @@ int main(int argc, char* argv[])
         console = new CONSOLE_CLASS;
     }
 #endif
+#ifdef _WIN32
     cm = new COMUNICATIONMANAGER();
+#else
+    cm = new COMUNICATIONMANAGER(inheritedSocket);
+#endif
 
 #if _WIN32
     if( SetConsoleCtrlHandler( (PHANDLER_ROUTINE) CtrlHandler, TRUE ) )
@@ -129,6 +129,30 @@ void removeGreetingStatusAllListener(const std::string &msj);
 
 
 void setloginInAtStartup(bool value);
+
+// Stages of the server startup (or of any login) after which the account is fully operative.
+// Those after STARTUP_STAGE_NODES run in parallel, and commands not depending on them are not held.
+enum StartupStage
+{
+    STARTUP_STAGE_SESSION, // login or session resumption
+    STARTUP_STAGE_NODES, // fetch nodes: the account can be browsed afterwards
+    STARTUP_STAGE_BACKUPS, // reestablishing configured backups
+    STARTUP_STAGE_WEBDAV, // restarting the webdav server and its served locations
+    STARTUP_STAGE_FTP, // restarting the ftp server and its served locations
+    STARTUP_STAGES_TOTAL
+};
+
+void startupStageStarted(StartupStage stage);
+void startupStageEnded(StartupStage stage, bool succeeded = true);
+
+/**
+ * @brief Waits for a startup stage to end, up to timeoutSeconds
+ * @return false if it is still running
+ */
+bool waitForStartupStage(StartupStage stage, int timeoutSeconds = 300);
+std::string getStartupReadinessStr();
+void printStartupTimings();
+
 void setBlocked(int value);
 int getBlocked();
 void unblock();
@@ -155,8 +179,26 @@ public:
     }
 };
 
+/**
+ * @brief Starts a startup stage, and fails it when going out of scope unless it was ended before
+ */
+class StartupStageGuard {
+    StartupStage stage;
+public:
+    StartupStageGuard(StartupStage stage) : stage(stage)
+    {
+        startupStageStarted(stage);
+    }
+
+    ~StartupStageGuard()
+    {
+        startupStageEnded(stage, false); // no effect if already ended
+    }
+};
+
 
-mega::MegaApi* getFreeApiFolder();
+mega::MegaApi* getFreeApiFolder(const std::string &link = std::string(), bool *logged = NULL);
+void setApiFolderSession(mega::MegaApi *apiFolder, const std::string &link, long long fetchMs);
 void freeApiFolder(mega::MegaApi *apiFolder);
 
 const char * getUsageStr(const char *command);
@@ -76,14 +76,18 @@ void utf16ToUtf8(const wchar_t* utf16data, int utf16size, std::string* utf8strin
 
 #define OUTSTREAM COUT
 
+/* batch petitions: "batch[ --null]" followed by the commands, each one preceded by this separator */
+#define BATCH_PETITION "batch"
+#define BATCH_COMMAND_SEPARATOR '\x1e'
+
 
 /* commands */
 static std::vector<std::string> validGlobalParameters {"v", "help"};
-static std::vector<std::string> localremotefolderpatterncommands {"sync"};
+static std::vector<std::string> localremotefolderpatterncommands {"sync", "diff"};
 static std::vector<std::string> remotepatterncommands {"export", "attr"};
 static std::vector<std::string> remotefolderspatterncommands {"cd", "share"};
 
-static std::vector<std::string> multipleremotepatterncommands {"ls", "tree", "mkdir", "rm", "du", "find", "mv", "deleteversions", "cat", "mediainfo"
+static std::vector<std::string> multipleremotepatterncommands {"ls", "tree", "mkdir", "rm", "du", "find", "mv", "deleteversions", "dedup", "cat", "mediainfo", "blockcache", "prefetch"
 #ifdef HAVE_LIBUV
                                            , "webdav", "ftp"
 #endif
@@ -98,7 +102,7 @@ static std::vector<std::string> localfolderpatterncommands {"lcd"};
 static std::vector<std::string> emailpatterncommands {"invite", "signup", "ipc", "users"};
 
 static std::vector<std::string> loginInValidCommands { "log", "debug", "speedlimit", "help", "logout", "version", "quit",
-                            "clear", "https", "exit", "errorcode", "proxy"
+                            "clear", "https", "exit", "errorcode", "proxy", "startup"
 #if defined(_WIN32) && defined(NO_READLINE)
                              , "autocomplete", "codepage"
 #elif defined(_WIN32)
@@ -113,7 +117,7 @@ static std::vector<std::string> allValidCommands { "login", "signup", "confirm",
                              "put", "get", "attr", "userattr", "mkdir", "rm", "du", "mv", "cp", "sync", "export", "share", "invite", "ipc", "df",
                              "showpcr", "users", "speedlimit", "killsession", "whoami", "help", "passwd", "reload", "logout", "version", "quit",
                              "thumbnail", "preview", "find", "completion", "clear", "https", "transfers", "exclude", "exit", "errorcode", "graphics",
-                             "cancel", "confirmcancel", "cat", "tree", "psa", "proxy"
+                             "cancel", "confirmcancel", "cat", "tree", "psa", "proxy", "startup"
                              , "mediainfo"
 #ifdef HAVE_LIBUV
                              , "webdav", "ftp"
@@ -121,7 +125,7 @@ static std::vector<std::string> allValidCommands { "login", "signup", "confirm",
 #ifdef ENABLE_BACKUPS
                              , "backup"
 #endif
-                             , "deleteversions"
+                             , "deleteversions", "dedup", "diff", "blockcache", "prefetch"
 #if defined(_WIN32) && defined(NO_READLINE)
                              , "autocomplete", "codepage"
 #elif defined(_WIN32)
@@ -29,10 +29,20 @@
 #include <iomanip>
 #include <string>
 #include <ctime>
+#include <fstream>
+#include <thread>
+#include <condition_variable>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <limits>
 
 #include <set>
 
 #include <signal.h>
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
 
 
 #if (__cplusplus >= 201700L)
@@ -156,6 +166,28 @@ MegaCmdExecuter::MegaCmdExecuter(MegaApi *api, MegaCMDLogger *loggerCMD, MegaCmd
 
 MegaCmdExecuter::~MegaCmdExecuter()
 {
+    joinStartupStages();
+
+    {
+        std::lock_guard<std::mutex> g(fingerprintVerifierMutex);
+        stopFingerprintVerifier = true;
+    }
+    fingerprintVerifierCV.notify_all();
+    if (fingerprintVerifierThread.joinable())
+    {
+        fingerprintVerifierThread.join();
+    }
+
+    {
+        std::lock_guard<std::mutex> g(prefetchMutex);
+        stopPrefetcher = true;
+    }
+    prefetchCV.notify_all();
+    if (prefetchThread.joinable())
+    {
+        prefetchThread.join();
+    }
+
     delete fsAccessCMD;
     delete []session;
     for (std::vector< MegaNode * >::iterator it = nodesToConfirmDelete.begin(); it != nodesToConfirmDelete.end(); ++it)
@@ -1765,6 +1797,92 @@ void MegaCmdExecuter::dumpTreeSummary(MegaNode *n, const char *timeFormat, std::
     delete []nodepath;
 }
 
+void MegaCmdExecuter::dumpNodeNdjson(MegaNode *n, const string &path, bool isversion)
+{
+    std::unique_ptr<char []> handle {api->handleToBase64(n->getHandle())};
+
+    NdjsonLine line;
+    line.addString("handle", handle.get());
+    line.addString("path", path);
+    line.addString("type", getNodeTypeStr(n->getType()));
+    if (n->isFile())
+    {
+        line.addNumber("size", n->getSize());
+        line.addNumber("mtime", n->getModificationTime());
+    }
+    else
+    {
+        line.addNumber("ctime", n->getCreationTime());
+    }
+    if (UNDEF != n->getPublicHandle())
+    {
+        line.addString("state", n->getExpirationTime() ? "exported-temporal" : "exported");
+    }
+    else if (n->isShared())
+    {
+        line.addString("state", "shared");
+    }
+    else if (n->isInShare())
+    {
+        line.addString("state", "inshare");
+    }
+    if (isversion)
+    {
+        line.addBool("version", true);
+    }
+
+    OUTSTREAM << line.str();
+}
+
+void MegaCmdExecuter::printDuNdjson(MegaNode *n, bool showversionssize)
+{
+    std::unique_ptr<char []> handle {api->handleToBase64(n->getHandle())};
+
+    NdjsonLine line;
+    line.addString("handle", handle.get());
+    line.addString("path", sandboxCMD->nodePathCache.getNodePath(api, n));
+    line.addString("type", getNodeTypeStr(n->getType()));
+    line.addNumber("size", api->getSize(n));
+    if (showversionssize)
+    {
+        line.addNumber("size_with_versions", getVersionsSize(n));
+    }
+
+    OUTSTREAM << line.str();
+}
+
+void MegaCmdExecuter::dumpTreeNdjson(MegaNode *n, int recurse, bool showversions, int depth)
+{
+    if (depth || ( n->getType() == MegaNode::TYPE_FILE ))
+    {
+        string path = sandboxCMD->nodePathCache.getNodePath(api, n);
+        dumpNodeNdjson(n, path);
+
+        if (showversions && n->isFile())
+        {
+            std::unique_ptr<MegaNodeList> versionNodes {api->getVersions(n)};
+            for (int i = 1; versionNodes && i < versionNodes->size(); i++) // the first one is the node itself
+            {
+                dumpNodeNdjson(versionNodes->get(i), path, true);
+            }
+        }
+
+        if (!recurse && depth)
+        {
+            return;
+        }
+    }
+
+    if (n->getType() != MegaNode::TYPE_FILE)
+    {
+        std::unique_ptr<MegaNodeList> children {api->getChildren(n)};
+        for (int i = 0; children && i < children->size(); i++)
+        {
+            dumpTreeNdjson(children->get(i), recurse, showversions, depth + 1);
+        }
+    }
+}
+
 
 /**
  * @brief Tests if a path can be created
@@ -1826,15 +1944,13 @@ MegaContactRequest * MegaCmdExecuter::getPcrByContact(string contactEmail)
 
 string MegaCmdExecuter::getDisplayPath(string givenPath, MegaNode* n)
 {
-    char * pathToNode = api->getNodePath(n);
-    if (!pathToNode)
+    string pathToNode = sandboxCMD->nodePathCache.getNodePath(api, n);
+    if (pathToNode.empty())
     {
         LOG_err << " GetNodePath failed for: " << givenPath;
         return givenPath;
     }
 
-    char * pathToShow = pathToNode;
-
     string pathRelativeTo = "NULL";
     string cwpath = getCurrentPath();
     string toret="";
@@ -1856,10 +1972,9 @@ string MegaCmdExecuter::getDisplayPath(string givenPath, MegaNode* n)
                 toret+="./";
                 if (n)
                 {
-                    char *npath = api->getNodePath(n);
-                    pathRelativeTo = string(npath);
-                    delete []npath;
+                    pathRelativeTo = sandboxCMD->nodePathCache.getNodePath(api, n);
                 }
+                delete n;
                 return toret;
 
             }
@@ -1875,9 +1990,7 @@ string MegaCmdExecuter::getDisplayPath(string givenPath, MegaNode* n)
                 delete aux;
                 if (n)
                 {
-                    char *npath = api->getNodePath(n);
-                    pathRelativeTo = string(npath);
-                    delete []npath;
+                    pathRelativeTo = sandboxCMD->nodePathCache.getNodePath(api, n);
                 }
             }
             else
@@ -1899,32 +2012,21 @@ string MegaCmdExecuter::getDisplayPath(string givenPath, MegaNode* n)
         }
     }
 
-    if (( "" == givenPath ) && !strcmp(pathToNode, cwpath.c_str()))
-    {
-        assert(strlen(pathToNode)>0);
-        pathToNode[0] = '.';
-        pathToNode[1] = '\0';
-    }
-
-    if (pathRelativeTo != "")
+    if (( "" == givenPath ) && pathToNode == cwpath)
     {
-        pathToShow = strstr(pathToNode, pathRelativeTo.c_str());
+        pathToNode = ".";
     }
 
-    if (pathToShow == pathToNode)     //found at beginning
+    size_t pathToShowPos = 0;
+    if (pathRelativeTo != "" && pathToNode.find(pathRelativeTo) == 0)     //found at beginning
     {
-        if (strcmp(pathToNode, "/"))
+        if (pathToNode != "/")
         {
-            pathToShow += pathRelativeTo.size();
+            pathToShowPos = pathRelativeTo.size();
         }
     }
-    else
-    {
-        pathToShow = pathToNode;
-    }
 
-    toret+=pathToShow;
-    delete []pathToNode;
+    toret.append(pathToNode, pathToShowPos, string::npos);
     return toret;
 }
 
@@ -2099,183 +2201,159 @@ void str_localtime(char s[32], ::mega::m_time_t t)
 }
 
 
-void MegaCmdExecuter::actUponGetExtendedAccountDetails(SynchronousRequestListener *srl, int timeout)
+void MegaCmdExecuter::printAccountDetails(MegaAccountDetails *details)
 {
-    if (timeout == -1)
+    char timebuf[32], timebuf2[32];
+
+    OUTSTREAM << "    Available storage: "
+              << getFixLengthString(sizeToText(details->getStorageMax()), 9, ' ', true)
+              << "ytes" << endl;
+    MegaNode *n = api->getRootNode();
+    if (n)
     {
-        srl->wait();
+        OUTSTREAM << "        In ROOT:      "
+                  << getFixLengthString(sizeToText(details->getStorageUsed(n->getHandle())), 9, ' ', true) << "ytes in "
+                  << getFixLengthString(SSTR(details->getNumFiles(n->getHandle())),5,' ',true) << " file(s) and "
+                  << getFixLengthString(SSTR(details->getNumFolders(n->getHandle())),5,' ',true) << " folder(s)" << endl;
+        delete n;
     }
-    else
+
+    n = api->getInboxNode();
+    if (n)
     {
-        int trywaitout = srl->trywait(timeout);
-        if (trywaitout)
-        {
-            LOG_err << "GetExtendedAccountDetails took too long, it may have failed. No further actions performed";
-            return;
-        }
+        OUTSTREAM << "        In INBOX:     "
+                  << getFixLengthString( sizeToText(details->getStorageUsed(n->getHandle())), 9, ' ', true ) << "ytes in "
+                  << getFixLengthString(SSTR(details->getNumFiles(n->getHandle())),5,' ',true) << " file(s) and "
+                  << getFixLengthString(SSTR(details->getNumFolders(n->getHandle())),5,' ',true) << " folder(s)" << endl;
+        delete n;
     }
 
-    if (checkNoErrors(srl->getError(), "failed to GetExtendedAccountDetails"))
+    n = api->getRubbishNode();
+    if (n)
     {
-        char timebuf[32], timebuf2[32];
-
-        LOG_verbose << "actUponGetExtendedAccountDetails ok";
+        OUTSTREAM << "        In RUBBISH:   "
+                  << getFixLengthString(sizeToText(details->getStorageUsed(n->getHandle())), 9, ' ', true) << "ytes in "
+                  << getFixLengthString(SSTR(details->getNumFiles(n->getHandle())),5,' ',true) << " file(s) and "
+                  << getFixLengthString(SSTR(details->getNumFolders(n->getHandle())),5,' ',true) << " folder(s)" << endl;
+        delete n;
+    }
 
-        MegaAccountDetails *details = srl->getRequest()->getMegaAccountDetails();
-        if (details)
-        {
-            OUTSTREAM << "    Available storage: "
-                      << getFixLengthString(sizeToText(details->getStorageMax()), 9, ' ', true)
-                      << "ytes" << endl;
-            MegaNode *n = api->getRootNode();
-            if (n)
-            {
-                OUTSTREAM << "        In ROOT:      "
-                          << getFixLengthString(sizeToText(details->getStorageUsed(n->getHandle())), 9, ' ', true) << "ytes in "
-                          << getFixLengthString(SSTR(details->getNumFiles(n->getHandle())),5,' ',true) << " file(s) and "
-                          << getFixLengthString(SSTR(details->getNumFolders(n->getHandle())),5,' ',true) << " folder(s)" << endl;
-                delete n;
-            }
+    long long usedinVersions = details->getVersionStorageUsed();
 
-            n = api->getInboxNode();
-            if (n)
-            {
-                OUTSTREAM << "        In INBOX:     "
-                          << getFixLengthString( sizeToText(details->getStorageUsed(n->getHandle())), 9, ' ', true ) << "ytes in "
-                          << getFixLengthString(SSTR(details->getNumFiles(n->getHandle())),5,' ',true) << " file(s) and "
-                          << getFixLengthString(SSTR(details->getNumFolders(n->getHandle())),5,' ',true) << " folder(s)" << endl;
-                delete n;
-            }
+    OUTSTREAM << "        Total size taken up by file versions: "
+              << getFixLengthString(sizeToText(usedinVersions), 12, ' ', true) << "ytes"<< endl;
 
-            n = api->getRubbishNode();
-            if (n)
-            {
-                OUTSTREAM << "        In RUBBISH:   "
-                          << getFixLengthString(sizeToText(details->getStorageUsed(n->getHandle())), 9, ' ', true) << "ytes in "
-                          << getFixLengthString(SSTR(details->getNumFiles(n->getHandle())),5,' ',true) << " file(s) and "
-                          << getFixLengthString(SSTR(details->getNumFolders(n->getHandle())),5,' ',true) << " folder(s)" << endl;
-                delete n;
-            }
 
-            long long usedinVersions = details->getVersionStorageUsed();
+    MegaNodeList *inshares = api->getInShares();
+    if (inshares)
+    {
+        for (int i = 0; i < inshares->size(); i++)
+        {
+            n = inshares->get(i);
+            OUTSTREAM << "        In INSHARE " << n->getName() << ": "
+                      << getFixLengthString(sizeToText(details->getStorageUsed(n->getHandle())), 9, ' ', true) << "ytes in "
+                      << getFixLengthString(SSTR(details->getNumFiles(n->getHandle())),5,' ',true) << " file(s) and "
+                      << getFixLengthString(SSTR(details->getNumFolders(n->getHandle())),5,' ',true) << " folder(s)" << endl;
+        }
+    }
+    delete inshares;
 
-            OUTSTREAM << "        Total size taken up by file versions: "
-                      << getFixLengthString(sizeToText(usedinVersions), 12, ' ', true) << "ytes"<< endl;
+    OUTSTREAM << "    Pro level: " << details->getProLevel() << endl;
+    if (details->getProLevel())
+    {
+        if (details->getProExpiration())
+        {
+            str_localtime(timebuf, details->getProExpiration());
+            OUTSTREAM << "        " << "Pro expiration date: " << timebuf << endl;
+        }
+    }
+    char * subscriptionMethod = details->getSubscriptionMethod();
+    OUTSTREAM << "    Subscription type: " << subscriptionMethod << endl;
+    delete []subscriptionMethod;
+    OUTSTREAM << "    Account balance:" << endl;
+    for (int i = 0; i < details->getNumBalances(); i++)
+    {
+        MegaAccountBalance * balance = details->getBalance(i);
+        char sbalance[50];
+        sprintf(sbalance, "    Balance: %.3s %.02f", balance->getCurrency(), balance->getAmount());
+        OUTSTREAM << "    " << "Balance: " << sbalance << endl;
+    }
 
+    if (details->getNumPurchases())
+    {
+        OUTSTREAM << "Purchase history:" << endl;
+        for (int i = 0; i < details->getNumPurchases(); i++)
+        {
+            MegaAccountPurchase *purchase = details->getPurchase(i);
 
-            MegaNodeList *inshares = api->getInShares();
-            if (inshares)
-            {
-                for (int i = 0; i < inshares->size(); i++)
-                {
-                    n = inshares->get(i);
-                    OUTSTREAM << "        In INSHARE " << n->getName() << ": "
-                              << getFixLengthString(sizeToText(details->getStorageUsed(n->getHandle())), 9, ' ', true) << "ytes in "
-                              << getFixLengthString(SSTR(details->getNumFiles(n->getHandle())),5,' ',true) << " file(s) and "
-                              << getFixLengthString(SSTR(details->getNumFolders(n->getHandle())),5,' ',true) << " folder(s)" << endl;
-                }
-            }
-            delete inshares;
+            char spurchase[150];
 
-            OUTSTREAM << "    Pro level: " << details->getProLevel() << endl;
-            if (details->getProLevel())
-            {
-                if (details->getProExpiration())
-                {
-                    str_localtime(timebuf, details->getProExpiration());
-                    OUTSTREAM << "        " << "Pro expiration date: " << timebuf << endl;
-                }
-            }
-            char * subscriptionMethod = details->getSubscriptionMethod();
-            OUTSTREAM << "    Subscription type: " << subscriptionMethod << endl;
-            delete []subscriptionMethod;
-            OUTSTREAM << "    Account balance:" << endl;
-            for (int i = 0; i < details->getNumBalances(); i++)
-            {
-                MegaAccountBalance * balance = details->getBalance(i);
-                char sbalance[50];
-                sprintf(sbalance, "    Balance: %.3s %.02f", balance->getCurrency(), balance->getAmount());
-                OUTSTREAM << "    " << "Balance: " << sbalance << endl;
-            }
+            str_localtime(timebuf, purchase->getTimestamp());
+            sprintf(spurchase, "ID: %.11s Time: %s Amount: %.3s %.02f Payment method: %d\n",
+                purchase->getHandle(), timebuf, purchase->getCurrency(), purchase->getAmount(), purchase->getMethod());
+            OUTSTREAM << "    " << spurchase << endl;
+        }
+    }
 
-            if (details->getNumPurchases())
-            {
-                OUTSTREAM << "Purchase history:" << endl;
-                for (int i = 0; i < details->getNumPurchases(); i++)
-                {
-                    MegaAccountPurchase *purchase = details->getPurchase(i);
+    if (details->getNumTransactions())
+    {
+        OUTSTREAM << "Transaction history:" << endl;
+        for (int i = 0; i < details->getNumTransactions(); i++)
+        {
+            MegaAccountTransaction *transaction = details->getTransaction(i);
+            char stransaction[100];
+            str_localtime(timebuf, transaction->getTimestamp());
+            sprintf(stransaction, "ID: %.11s Time: %s Amount: %.3s %.02f\n",
+                transaction->getHandle(), timebuf, transaction->getCurrency(), transaction->getAmount());
+            OUTSTREAM << "    " << stransaction << endl;
+        }
+    }
 
-                    char spurchase[150];
+    int alive_sessions = 0;
+    OUTSTREAM << "Current Active Sessions:" << endl;
+    char sdetails[500];
+    for (int i = 0; i < details->getNumSessions(); i++)
+    {
+        MegaAccountSession * session = details->getSession(i);
+        if (session->isAlive())
+        {
+            sdetails[0]='\0';
+            str_localtime(timebuf, session->getCreationTimestamp());
+            str_localtime(timebuf2, session->getMostRecentUsage());
 
-                    str_localtime(timebuf, purchase->getTimestamp());
-                    sprintf(spurchase, "ID: %.11s Time: %s Amount: %.3s %.02f Payment method: %d\n",
-                        purchase->getHandle(), timebuf, purchase->getCurrency(), purchase->getAmount(), purchase->getMethod());
-                    OUTSTREAM << "    " << spurchase << endl;
-                }
-            }
+            char *sid = api->userHandleToBase64(session->getHandle());
 
-            if (details->getNumTransactions())
+            if (session->isCurrent())
             {
-                OUTSTREAM << "Transaction history:" << endl;
-                for (int i = 0; i < details->getNumTransactions(); i++)
-                {
-                    MegaAccountTransaction *transaction = details->getTransaction(i);
-                    char stransaction[100];
-                    str_localtime(timebuf, transaction->getTimestamp());
-                    sprintf(stransaction, "ID: %.11s Time: %s Amount: %.3s %.02f\n",
-                        transaction->getHandle(), timebuf, transaction->getCurrency(), transaction->getAmount());
-                    OUTSTREAM << "    " << stransaction << endl;
-                }
+                sprintf(sdetails, "    * Current Session\n");
             }
 
-            int alive_sessions = 0;
-            OUTSTREAM << "Current Active Sessions:" << endl;
-            char sdetails[500];
-            for (int i = 0; i < details->getNumSessions(); i++)
-            {
-                MegaAccountSession * session = details->getSession(i);
-                if (session->isAlive())
-                {
-                    sdetails[0]='\0';
-                    str_localtime(timebuf, session->getCreationTimestamp());
-                    str_localtime(timebuf2, session->getMostRecentUsage());
-
-                    char *sid = api->userHandleToBase64(session->getHandle());
-
-                    if (session->isCurrent())
-                    {
-                        sprintf(sdetails, "    * Current Session\n");
-                    }
-
-                    char * userAgent = session->getUserAgent();
-                    char * country = session->getCountry();
-                    char * ip = session->getIP();
-
-                    sprintf(sdetails, "%s    Session ID: %s\n    Session start: %s\n    Most recent activity: %s\n    IP: %s\n    Country: %.2s\n    User-Agent: %s\n    -----\n",
-                    sdetails,
-                    sid,
-                    timebuf,
-                    timebuf2,
-                    ip,
-                    country,
-                    userAgent
-                    );
-                    OUTSTREAM << sdetails;
-                    delete []sid;
-                    delete []userAgent;
-                    delete []country;
-                    delete []ip;
-                    alive_sessions++;
-                }
-                delete session;
-            }
+            char * userAgent = session->getUserAgent();
+            char * country = session->getCountry();
+            char * ip = session->getIP();
 
-            if (alive_sessions)
-            {
-                OUTSTREAM << alive_sessions << " active sessions opened" << endl;
-            }
-            delete details;
+            sprintf(sdetails, "%s    Session ID: %s\n    Session start: %s\n    Most recent activity: %s\n    IP: %s\n    Country: %.2s\n    User-Agent: %s\n    -----\n",
+            sdetails,
+            sid,
+            timebuf,
+            timebuf2,
+            ip,
+            country,
+            userAgent
+            );
+            OUTSTREAM << sdetails;
+            delete []sid;
+            delete []userAgent;
+            delete []country;
+            delete []ip;
+            alive_sessions++;
         }
+        delete session;
+    }
+
+    if (alive_sessions)
+    {
+        OUTSTREAM << alive_sessions << " active sessions opened" << endl;
     }
 }
 
@@ -2316,6 +2394,7 @@ bool MegaCmdExecuter::actUponFetchNodes(MegaApi *api, SynchronousRequestListener
 
 int MegaCmdExecuter::actUponLogin(SynchronousRequestListener *srl, int timeout)
 {
+    StartupStageGuard sessionStage(STARTUP_STAGE_SESSION); // ended on every return
     if (timeout == -1)
     {
         srl->wait();
@@ -2344,6 +2423,8 @@ int MegaCmdExecuter::actUponLogin(SynchronousRequestListener *srl, int timeout)
         return srl->getError()->getErrorCode();
     }
 
+    startupStageEnded(STARTUP_STAGE_SESSION, srl->getError()->getErrorCode() == MegaError::API_OK);
+
 
     if (srl->getError()->getErrorCode() == MegaError::API_ENOENT) // failed to login
     {
@@ -2377,10 +2458,7 @@ int MegaCmdExecuter::actUponLogin(SynchronousRequestListener *srl, int timeout)
         std::vector<string> vexcludednames(ConfigurationManager::excludedNames.begin(), ConfigurationManager::excludedNames.end());
         api->setExcludedNames(&vexcludednames);
 
-        long long maxspeeddownload = ConfigurationManager::getConfigurationValue("maxspeeddownload", -1);
-        if (maxspeeddownload != -1) api->setMaxDownloadSpeed(maxspeeddownload);
-        long long maxspeedupload = ConfigurationManager::getConfigurationValue("maxspeedupload", -1);
-        if (maxspeedupload != -1) api->setMaxUploadSpeed(maxspeedupload);
+        sandboxCMD->bandwidthScheduler.apply(api); // speed limits, as scheduled
 
         api->useHttpsOnly(ConfigurationManager::getConfigurationValue("https", false));
         api->disableGfxFeatures(!ConfigurationManager::getConfigurationValue("graphics", true));
@@ -2467,10 +2545,14 @@ int MegaCmdExecuter::actUponLogin(SynchronousRequestListener *srl, int timeout)
 void MegaCmdExecuter::fetchNodes(MegaApi *api, int clientID)
 {
     if (!api) api = this->api;
+    joinStartupStages();
+
+    startupStageStarted(STARTUP_STAGE_NODES);
     MegaCmdListener * megaCmdListener = new MegaCmdListener(api, NULL, clientID);
     api->fetchNodes(megaCmdListener);
     if (!actUponFetchNodes(api, megaCmdListener))
     {
+        startupStageEnded(STARTUP_STAGE_NODES, false);
         //Ideally we should enter an state that indicates that we are not fully logged.
         //Specially when the account is blocked
         return;
@@ -2492,6 +2574,24 @@ void MegaCmdExecuter::fetchNodes(MegaApi *api, int clientID)
         delete cwdNode;
     }
 
+    startupStageEnded(STARTUP_STAGE_NODES);
+
+    // The rest of stages are independent: they are run in parallel, while commands that do not depend on them are already allowed.
+    // Those that do, wait for them (see waitForStartupStage)
+    {
+        std::lock_guard<std::mutex> g(startupStageThreadsMutex);
+#ifdef ENABLE_BACKUPS
+        startupStageStarted(STARTUP_STAGE_BACKUPS);
+        startupStageThreads.emplace_back([this, api]() { restoreBackups(api); });
+#endif
+#ifdef HAVE_LIBUV
+        startupStageStarted(STARTUP_STAGE_WEBDAV);
+        startupStageThreads.emplace_back([this, api]() { restoreWebdavServer(api); });
+        startupStageStarted(STARTUP_STAGE_FTP);
+        startupStageThreads.emplace_back([this, api]() { restoreFtpServer(api); });
+#endif
+    }
+
     setloginInAtStartup(false); //to enable all commands before giving clients the green light!
     informStateListeners("loged:"); // tell the clients login ended, before providing them the first prompt
     updateprompt(api);
@@ -2507,53 +2607,113 @@ void MegaCmdExecuter::fetchNodes(MegaApi *api, int clientID)
     if (ConfigurationManager::getConfigurationValue("ask4storage", true))
     {
         ConfigurationManager::savePropertyValue("ask4storage",false);
-        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-        api->getAccountDetails(megaCmdListener);
-        megaCmdListener->wait();
+        sandboxCMD->accountDetails.get(AccountDetailsCache::BASIC, api, false);
         // we don't call getAccountDetails on startup always: we ask on first login (no "ask4storage") or previous state was STATE_RED | STATE_ORANGE
         // if we were green, don't need to ask: if there are changes they will be received via action packet indicating STATE_CHANGE
     }
 
     checkAndInformPSA(NULL); // this needs broacasting in case there's another Shell running.
     // no need to enforce, because time since last check should has been restored
+}
 
 #ifdef ENABLE_BACKUPS
+void MegaCmdExecuter::restoreBackups(MegaApi *api)
+{
+    struct BackupToRestore
+    {
+        string key;
+        MegaHandle handle;
+        string localpath;
+        int64_t period;
+        string speriod;
+        int numBackups;
+    };
+
+    vector<BackupToRestore> toRestore;
     mtxBackupsMap.lock();
-    if (ConfigurationManager::configuredBackups.size())
+    for (map<string, backup_struct *>::iterator itr = ConfigurationManager::configuredBackups.begin();
+         itr != ConfigurationManager::configuredBackups.end(); ++itr)
+    {
+        backup_struct *thebackup = itr->second;
+        toRestore.push_back({itr->first, thebackup->handle, thebackup->localpath, thebackup->period, thebackup->speriod, thebackup->numBackups});
+    }
+    mtxBackupsMap.unlock();
+
+    std::atomic<int> failed(0);
+    if (toRestore.size())
     {
         LOG_info << "Restablishing backups ... ";
-        unsigned int i=0;
-        for (map<string, backup_struct *>::iterator itr = ConfigurationManager::configuredBackups.begin();
-             itr != ConfigurationManager::configuredBackups.end(); ++itr, i++)
-        {
-            backup_struct *thebackup = itr->second;
 
-            MegaNode * node = api->getNodeByHandle(thebackup->handle);
-            if (establishBackup(thebackup->localpath, node, thebackup->period, thebackup->speriod, thebackup->numBackups))
-            {
-                thebackup->failed = false;
-                const char *nodepath = api->getNodePath(node);
-                LOG_debug << "Succesfully resumed backup: " << thebackup->localpath << " to " << nodepath;
-                delete []nodepath;
-            }
-            else
+        // each one requires a roundtrip to the api: several are resumed at a time
+        std::atomic<size_t> next(0);
+        auto restorer = [this, api, &toRestore, &next, &failed]()
+        {
+            size_t i;
+            while ((i = next++) < toRestore.size())
             {
-                thebackup->failed = true;
-                char *nodepath = api->getNodePath(node);
-                LOG_err << "Failed to resume backup: " << thebackup->localpath << " to " << nodepath;
-                delete []nodepath;
+                const BackupToRestore &backup = toRestore[i];
+                MegaNode * node = api->getNodeByHandle(backup.handle);
+                bool established = establishBackup(backup.localpath, node, backup.period, backup.speriod, backup.numBackups);
+                if (established)
+                {
+                    LOG_debug << "Succesfully resumed backup: " << backup.localpath;
+                }
+                else
+                {
+                    char *nodepath = node ? api->getNodePath(node) : NULL;
+                    LOG_err << "Failed to resume backup: " << backup.localpath << " to " << (nodepath ? nodepath : "(not found)");
+                    delete []nodepath;
+                    failed++;
+                }
+                delete node;
+
+                std::lock_guard<std::recursive_mutex> g(mtxBackupsMap);
+                map<string, backup_struct *>::iterator itr = ConfigurationManager::configuredBackups.find(backup.key);
+                if (itr != ConfigurationManager::configuredBackups.end())
+                {
+                    itr->second->failed = !established;
+                }
             }
+        };
 
-            delete node;
+        size_t nthreads = std::min(toRestore.size(), size_t(std::max(1, ConfigurationManager::getConfigurationValue("startup_backups_parallelism", 8))));
+        vector<std::thread> restorers;
+        for (size_t i = 1; i < nthreads; i++)
+        {
+            restorers.emplace_back(restorer);
+        }
+        restorer();
+        for (auto &t : restorers)
+        {
+            t.join();
         }
 
+        mtxBackupsMap.lock();
         ConfigurationManager::saveBackups(&ConfigurationManager::configuredBackups);
+        mtxBackupsMap.unlock();
     }
-    mtxBackupsMap.unlock();
+
+    startupStageEnded(STARTUP_STAGE_BACKUPS, !failed);
+}
 #endif
 
+void MegaCmdExecuter::joinStartupStages()
+{
+    vector<std::thread> threads;
+    {
+        std::lock_guard<std::mutex> g(startupStageThreadsMutex);
+        threads.swap(startupStageThreads);
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+}
+
 #ifdef HAVE_LIBUV
-    // restart webdav
+void MegaCmdExecuter::restoreWebdavServer(MegaApi *api)
+{
+    bool succeeded = true;
     int port = ConfigurationManager::getConfigurationValue("webdav_port", -1);
     if (port != -1)
     {
@@ -2607,11 +2767,16 @@ void MegaCmdExecuter::fetchNodes(MegaApi *api, int clientID)
         else
         {
             LOG_err << "Failed to initialize WEBDAV server. Ensure the port is free.";
+            succeeded = false;
         }
     }
 
-    //ftp
-    // restart ftp
+    startupStageEnded(STARTUP_STAGE_WEBDAV, succeeded);
+}
+
+void MegaCmdExecuter::restoreFtpServer(MegaApi *api)
+{
+    bool succeeded = true;
     int portftp = ConfigurationManager::getConfigurationValue("ftp_port", -1);
 
     if (portftp != -1)
@@ -2667,10 +2832,13 @@ void MegaCmdExecuter::fetchNodes(MegaApi *api, int clientID)
         else
         {
             LOG_err << "Failed to initialize FTP server. Ensure the port is free.";
+            succeeded = false;
         }
     }
-#endif
+
+    startupStageEnded(STARTUP_STAGE_FTP, succeeded);
 }
+#endif
 
 void MegaCmdExecuter::actUponLogout(SynchronousRequestListener *srl, bool keptSession, int timeout)
 {
@@ -2691,6 +2859,7 @@ void MegaCmdExecuter::actUponLogout(SynchronousRequestListener *srl, bool keptSe
     if (srl->getError()->getErrorCode() == MegaError::API_ESID || checkNoErrors(srl->getError(), "logout"))
     {
         LOG_verbose << "actUponLogout logout ok";
+        joinStartupStages(); // they might still be using the configuration about to be unloaded
         cwd = UNDEF;
         delete []session;
         session = NULL;
@@ -2837,7 +3006,7 @@ void MegaCmdExecuter::doDeleteNode(MegaNode *nodeToDelete,MegaApi* api)
 
 }
 
-int MegaCmdExecuter::deleteNodeVersions(MegaNode *nodeToDelete, MegaApi* api, int force)
+int MegaCmdExecuter::deleteNodeVersions(MegaNode *nodeToDelete, MegaApi* api, int force, bool dryrun, int clientID)
 {
     if (nodeToDelete->getType() == MegaNode::TYPE_FILE && api->getNumVersions(nodeToDelete) < 2)
     {
@@ -2848,65 +3017,48 @@ int MegaCmdExecuter::deleteNodeVersions(MegaNode *nodeToDelete, MegaApi* api, in
         return MCMDCONFIRM_YES; //nothing to do, no sense asking
     }
 
-    int confirmationResponse;
-
-    if (nodeToDelete->getType() != MegaNode::TYPE_FILE)
+    int confirmationResponse = MCMDCONFIRM_ALL;
+    if (!dryrun && !force)
     {
-        string confirmationQuery("Are you sure todelete the version histories of files within ");
+        string confirmationQuery(nodeToDelete->getType() != MegaNode::TYPE_FILE ? "Are you sure todelete the version histories of files within "
+                                                                                 : "Are you sure todelete the version histories of ");
         confirmationQuery += nodeToDelete->getName();
         confirmationQuery += "? (Yes/No): ";
+        confirmationResponse = askforConfirmation(confirmationQuery);
+    }
 
-        confirmationResponse = force?MCMDCONFIRM_ALL:askforConfirmation(confirmationQuery);
+    if (confirmationResponse != MCMDCONFIRM_YES && confirmationResponse != MCMDCONFIRM_ALL)
+    {
+        return confirmationResponse;
+    }
 
-        if (confirmationResponse == MCMDCONFIRM_YES || confirmationResponse == MCMDCONFIRM_ALL)
+    vector<pair<MegaHandle, long long> > versions;
+    long long reclaimableSize = 0;
+    scanVersions(nodeToDelete, [this, api, &reclaimableSize](const FolderVersionsReport &report)
+    {
+        if (report.nversions)
         {
-            MegaNodeList *children = api->getChildren(nodeToDelete);
-            if (children)
-            {
-                for (int i = 0; i < children->size(); i++)
-                {
-                    MegaNode *child = children->get(i);
-                    deleteNodeVersions(child, api, true);
-                }
-                delete children;
-            }
+            reclaimableSize += report.reclaimableSize;
+            OUTSTREAM << sandboxCMD->nodePathCache.getNodePath(api, report.folder) << ": " << report.nversions << " versions, "
+                      << sizeToText(report.reclaimableSize) << endl;
         }
+    }, &versions);
+
+    if (dryrun)
+    {
+        OUTSTREAM << versions.size() << " versions (" << sizeToText(reclaimableSize) << ") would be deleted from " << nodeToDelete->getName() << endl;
     }
-    else
+    else if (versions.size())
     {
-
-        string confirmationQuery("Are you sure todelete the version histories of ");
-        confirmationQuery += nodeToDelete->getName();
-        confirmationQuery += "? (Yes/No): ";
-        confirmationResponse = force?MCMDCONFIRM_ALL:askforConfirmation(confirmationQuery);
-
-        if (confirmationResponse == MCMDCONFIRM_YES || confirmationResponse == MCMDCONFIRM_ALL)
+        int failed = removeVersions(versions, clientID);
+        if (failed)
         {
-
-            MegaNodeList *versionsToDelete = api->getVersions(nodeToDelete);
-            if (versionsToDelete)
-            {
-                for (int i = 0; i < versionsToDelete->size(); i++)
-                {
-                    MegaNode *versionNode = versionsToDelete->get(i);
-
-                    if (versionNode->getHandle() != nodeToDelete->getHandle())
-                    {
-                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                        api->removeVersion(versionNode,megaCmdListener);
-                        megaCmdListener->wait();
-                        string fullname(versionNode->getName()?versionNode->getName():"NO_NAME");
-                        fullname += "#";
-                        fullname += SSTR(versionNode->getModificationTime());
-                        if (checkNoErrors(megaCmdListener->getError(), "remove version: "+fullname))
-                        {
-                            LOG_verbose << " Removed " << fullname << " (" << getReadableTime(versionNode->getModificationTime()) << ")";
-                        }
-                        delete megaCmdListener;
-                    }
-                }
-                delete versionsToDelete;
-            }
+            setCurrentOutCode(MCMD_EUNEXPECTED);
+            LOG_err << "Failed to delete " << failed << " of " << versions.size() << " versions from " << nodeToDelete->getName();
+        }
+        else
+        {
+            OUTSTREAM << versions.size() << " versions (" << sizeToText(reclaimableSize) << ") deleted from " << nodeToDelete->getName() << endl;
         }
     }
     return confirmationResponse;
@@ -2990,32 +3142,85 @@ int MegaCmdExecuter::deleteNode(MegaNode *nodeToDelete, MegaApi* api, int recurs
     return MCMDCONFIRM_NO; //default return
 }
 
-void MegaCmdExecuter::downloadNode(string path, MegaApi* api, MegaNode *node, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener)
-{
-    if (sandboxCMD->isOverquota() && !ignorequotawarn)
+/**
+ * @brief Gets an instance of the folder links pool logged into publicLink, with its nodes fetched.
+ *
+ * The session of a recently accessed link is reused when still valid, so that neither login nor
+ * fetchnodes are required. The instance is to be returned with freeApiFolder.
+ * @param error If given, failures are described there instead of being reported to the petition
+ * @return NULL if the folder link could not be accessed (the instance is already returned)
+ */
+MegaApi *MegaCmdExecuter::getApiFolderForLink(const string &publicLink, string *error)
+{
+    bool logged = false;
+    MegaApi *apiFolder = getFreeApiFolder(publicLink, &logged);
+    char *accountAuth = api->getAccountAuth();
+    apiFolder->setAccountAuth(accountAuth);
+    delete []accountAuth;
+
+    if (logged)
     {
-        m_time_t ts = m_time();
-        // in order to speedup and not flood the server we only ask for the details every 1 minute or after account changes
-        if (!sandboxCMD->temporalbandwidth || (ts - sandboxCMD->lastQuerytemporalBandwith ) > 60 )
+        std::unique_ptr<MegaNode> rootNode {apiFolder->getRootNode()};
+        if (rootNode)
+        {
+            LOG_debug << "Reusing session of folder link " << publicLink;
+            return apiFolder;
+        }
+        setApiFolderSession(apiFolder, "", 0);
+    }
+
+    auto succeeded = [this, error](MegaError *e, const string &message)
+    {
+        if (!error)
+        {
+            return checkNoErrors(e, message);
+        }
+        if (e->getErrorCode() != MegaError::API_OK)
         {
-            LOG_verbose << " Updating temporal bandwith ";
-            sandboxCMD->lastQuerytemporalBandwith = ts;
+            *error = "Failed to " + message + ": " + e->getErrorString();
+        }
+        return e->getErrorCode() == MegaError::API_OK;
+    };
 
-            MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
-            api->getExtendedAccountDetails(false, false, false, megaCmdListener);
-            megaCmdListener->wait();
+    auto start = std::chrono::steady_clock::now();
+    bool ok = false;
+    MegaCmdListener *megaCmdListener = new MegaCmdListener(apiFolder, NULL);
+    apiFolder->loginToFolder(publicLink.c_str(), megaCmdListener);
+    megaCmdListener->wait();
+    if (succeeded(megaCmdListener->getError(), "login to folder"))
+    {
+        MegaCmdListener *megaCmdListener2 = new MegaCmdListener(apiFolder, NULL);
+        apiFolder->fetchNodes(megaCmdListener2);
+        megaCmdListener2->wait();
+        ok = succeeded(megaCmdListener2->getError(), "access folder link " + publicLink);
+        delete megaCmdListener2;
+    }
+    delete megaCmdListener;
+
+    if (!ok)
+    {
+        freeApiFolder(apiFolder);
+        return NULL;
+    }
+    setApiFolderSession(apiFolder, publicLink, std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+    return apiFolder;
+}
 
-            if (checkNoErrors(megaCmdListener->getError(), "get account details"))
+void MegaCmdExecuter::downloadNode(string path, MegaApi* api, MegaNode *node, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener)
+{
+    if (sandboxCMD->isOverquota() && !ignorequotawarn)
+    {
+        m_time_t ts = m_time();
+        // in order to speedup and not flood the server, cached details are used (refreshed after account changes)
+        std::shared_ptr<MegaAccountDetails> details = sandboxCMD->accountDetails.get(AccountDetailsCache::BASIC, this->api, true);
+        if (details)
+        {
+            sandboxCMD->istemporalbandwidthvalid = details->isTemporalBandwidthValid();
+            if (details->isTemporalBandwidthValid())
             {
-                MegaAccountDetails *details = megaCmdListener->getRequest()->getMegaAccountDetails();
-                sandboxCMD->istemporalbandwidthvalid = details->isTemporalBandwidthValid();
-                if (details && details->isTemporalBandwidthValid())
-                {
-                    sandboxCMD->temporalbandwidth = details->getTemporalBandwidth();
-                    sandboxCMD->temporalbandwithinterval = details->getTemporalBandwidthInterval();
-                }
+                sandboxCMD->temporalbandwidth = details->getTemporalBandwidth();
+                sandboxCMD->temporalbandwithinterval = details->getTemporalBandwidthInterval();
             }
-            delete megaCmdListener;
         }
 
         OUTSTREAM << "Transfer not started. " << endl;
@@ -3091,3290 +3296,5451 @@ void MegaCmdExecuter::downloadNode(string path, MegaApi* api, MegaNode *node, bo
     }
 }
 
-void MegaCmdExecuter::uploadNode(string path, MegaApi* api, MegaNode *node, string newname, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener)
-{
-    if (!ignorequotawarn)
-    { //TODO: reenable this if ever queryBandwidthQuota applies to uploads as well
-//        MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
-//        api->queryBandwidthQuota(node->getSize(),megaCmdListener);
-//        megaCmdListener->wait();
-//        if (checkNoErrors(megaCmdListener->getError(), "query bandwidth quota"))
-//        {
-//            if (megaCmdListener->getRequest() && megaCmdListener->getRequest()->getFlag() )
-//            {
-//                OUTSTREAM << "Transfer not started: proceding will exceed bandwith quota. "
-//                             "Use --ignore-quota-warn to initiate nevertheless" << endl;
-//                return;
-//            }
-//        }
-    }
-    unescapeifRequired(path);
+static const char DOWNLOAD_MANIFEST_HEADER[] = "#MEGAcmd download manifest";
 
-    LocalPath locallocal = LocalPath::fromPath(path, *fsAccessCMD);
-    std::unique_ptr<FileAccess> fa = fsAccessCMD->newfileaccess();
-    if (!fa->fopen(locallocal, true, false))
+/**
+ * @brief isSafeLocalFolderName
+ * @return whether the name can be used as a local folder name without the escaping the SDK would apply
+ */
+static bool isSafeLocalFolderName(const char *name)
+{
+    if (!name || !*name || !strcmp(name, ".") || !strcmp(name, ".."))
     {
-        setCurrentOutCode(MCMD_NOTFOUND);
-        LOG_err << "Unable to open local path: " << path;
-        return;
+        return false;
     }
-
-    MegaCmdTransferListener *megaCmdTransferListener = NULL;
-    if (!background)
+    for (const char *c = name; *c; c++)
     {
-        if (!multiTransferListener)
+        if (!isalnum((unsigned char)*c) && !strchr(" ._-()[]+,@", *c))
         {
-            megaCmdTransferListener = new MegaCmdTransferListener(api, sandboxCMD, multiTransferListener, clientID);
+            return false;
         }
-        multiTransferListener->onNewTransfer();
     }
+    return true;
+}
+
+static string getDownloadRootPath(const string &path, MegaNode *n)
+{
+    if (path.size() && (path.back() == '/' || path.back() == '\\'))
+    {
+        return path + n->getName();
+    }
+    return path;
+}
 
+/**
+ * @brief precreateLocalFolders creates the local folder hierarchy of the given remote folders, using several threads
+ *
+ * Only folders whose names need no escaping are created: the rest (and their descendants) are left for the SDK.
+ * @param folderRoots pairs of remote folder handle and the local path it will be downloaded into
+ */
+static void precreateLocalFolders(MegaApi *api, const vector<pair<MegaHandle, string>> &folderRoots, unsigned int nthreads)
+{
+#ifdef MEGACMDEXECUTER_FILESYSTEM
 #ifdef _WIN32
-    replaceAll(path,"/","\\");
+    const char separator = '\\';
+#else
+    const char separator = '/';
 #endif
+    std::mutex queueMutex;
+    std::condition_variable queueCV;
+    std::deque<pair<MegaHandle, string>> pending(folderRoots.begin(), folderRoots.end());
+    unsigned int busy = 0;
+    long long created = 0;
 
-    LOG_debug << "Starting upload: " << path << " to : " << node->getName() << (newname.size()?"/":"") << newname;
+    auto worker = [&]()
+    {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        while (true)
+        {
+            queueCV.wait(lock, [&](){ return !pending.empty() || !busy; });
+            if (pending.empty())
+            {
+                return;
+            }
+            pair<MegaHandle, string> folder = pending.front();
+            pending.pop_front();
+            busy++;
+            lock.unlock();
+
+            vector<pair<MegaHandle, string>> subfolders;
+            std::error_code ec;
+            fs::create_directories(fs::u8path(folder.second), ec);
+            if (ec)
+            {
+                LOG_debug << "Could not precreate local folder " << folder.second << ": " << ec.message();
+            }
+            else
+            {
+                std::unique_ptr<MegaNode> node(api->getNodeByHandle(folder.first));
+                std::unique_ptr<MegaNodeList> children(node ? api->getChildren(node.get()) : nullptr);
+                for (int i = 0; children && i < children->size(); i++)
+                {
+                    MegaNode *child = children->get(i);
+                    if (child->getType() != MegaNode::TYPE_FILE && isSafeLocalFolderName(child->getName()))
+                    {
+                        subfolders.push_back(std::make_pair(child->getHandle(), folder.second + separator + child->getName()));
+                    }
+                }
+            }
 
+            lock.lock();
+            busy--;
+            if (!ec)
+            {
+                created++;
+            }
+            pending.insert(pending.end(), subfolders.begin(), subfolders.end());
+            queueCV.notify_all();
+        }
+    };
 
-    MegaTransferListener *thelistener;
-    if (multiTransferListener && !background)
+    vector<std::thread> workers;
+    for (unsigned int i = 0; i < max(1u, nthreads); i++)
     {
-       thelistener = multiTransferListener;
+        workers.push_back(std::thread(worker));
     }
-    else
+    for (auto &w : workers)
     {
-        thelistener = megaCmdTransferListener;
+        w.join();
     }
+    LOG_debug << "Precreated " << created << " local folders";
+#endif
+}
 
-    if (newname.size())
+void MegaCmdExecuter::downloadNodes(vector<MegaNode *> *nodes, string path, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener, map<string, string> *cloptions, SkipUnchangedStats *skipUnchangedStats)
+{
+    string order = getOption(cloptions, "order", "size");
+    if (order == "size") // small files first, folders at the end
+    {
+        std::stable_sort(nodes->begin(), nodes->end(), [](MegaNode *a, MegaNode *b)
+        {
+            bool afile = a->getType() == MegaNode::TYPE_FILE;
+            bool bfile = b->getType() == MegaNode::TYPE_FILE;
+            if (afile != bfile)
+            {
+                return afile;
+            }
+            return afile && a->getSize() < b->getSize();
+        });
+    }
+    else if (order == "folder") // grouped by containing folder
     {
+        std::stable_sort(nodes->begin(), nodes->end(), [](MegaNode *a, MegaNode *b)
+        {
+            if (a->getParentHandle() != b->getParentHandle())
+            {
+                return a->getParentHandle() < b->getParentHandle();
+            }
+            return strcmp(a->getName(), b->getName()) < 0;
+        });
+    }
+    else if (order != "none")
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "Invalid order: " << order << ". Valid values: size, folder, none";
+        return;
+    }
 
-        api->startUpload(removeTrailingSeparators(path).c_str(), node, newname.c_str(), thelistener);
+    vector<pair<MegaHandle, string>> targets;
+    vector<pair<MegaHandle, string>> folderRoots;
+    if (skipUnchangedStats)
+    {
+        planDownloadsSkippingUnchanged(nodes, path, targets, skipUnchangedStats);
+        for (auto &target : targets)
+        {
+            std::unique_ptr<MegaNode> n(api->getNodeByHandle(target.first));
+            if (n && n->getType() != MegaNode::TYPE_FILE && isSafeLocalFolderName(n->getName()))
+            {
+                folderRoots.push_back(std::make_pair(n->getHandle(), getDownloadRootPath(target.second, n.get())));
+            }
+        }
     }
     else
     {
-        api->startUpload(removeTrailingSeparators(path).c_str(), node, thelistener);
+        for (auto n : *nodes)
+        {
+            targets.push_back(std::make_pair(n->getHandle(), path));
+            if (n->getType() != MegaNode::TYPE_FILE && isSafeLocalFolderName(n->getName()))
+            {
+                folderRoots.push_back(std::make_pair(n->getHandle(), getDownloadRootPath(path, n)));
+            }
+        }
     }
-    if (megaCmdTransferListener)
+
+    string manifestPath = getOption(cloptions, "manifest", "");
+    if (manifestPath.size())
     {
-        megaCmdTransferListener->wait();
-#ifdef _WIN32
-            Sleep(100); //give a while to print end of transfer
-#endif
-        if (megaCmdTransferListener->getError()->getErrorCode() == API_EREAD)
+        ofstream manifest(manifestPath.c_str(), ios::out | ios::trunc);
+        if (!manifest.is_open())
         {
-            setCurrentOutCode(MCMD_NOTFOUND);
-            LOG_err << "Could not find local path: " << path;
+            setCurrentOutCode(MCMD_NOTPERMITTED);
+            LOG_err << "Could not create manifest file: " << manifestPath;
+            return;
         }
-        else if (checkNoErrors(megaCmdTransferListener->getError(), "Upload node"))
+        manifest << DOWNLOAD_MANIFEST_HEADER << endl;
+        for (auto &target : targets)
         {
-            char * destinyPath = api->getNodePath(node);
-            LOG_info << "Upload complete: " << path << " to " << destinyPath << newname;
-            delete []destinyPath;
+            std::unique_ptr<char[]> base64handle(api->handleToBase64(target.first));
+            manifest << "T " << base64handle.get() << " " << target.second << endl;
         }
-        delete megaCmdTransferListener;
     }
-}
-
 
-bool MegaCmdExecuter::amIPro()
-{
-    int prolevel = -1;
-    MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
-    api->getAccountDetails(megaCmdListener);
-    megaCmdListener->wait();
-    if (checkNoErrors(megaCmdListener->getError(), "export node"))
+    if (folderRoots.size())
     {
-        MegaAccountDetails *details = megaCmdListener->getRequest()->getMegaAccountDetails();
-        prolevel = details->getProLevel();
+        precreateLocalFolders(api, folderRoots, min(4u, std::thread::hardware_concurrency()));
     }
-    delete megaCmdListener;
-    return prolevel > 0;
+
+    scheduleDownloads(targets, manifestPath, background, ignorequotawarn, clientID, multiTransferListener, cloptions);
 }
 
-void MegaCmdExecuter::exportNode(MegaNode *n, int64_t expireTime, std::string password, bool force)
+void MegaCmdExecuter::resumeDownloads(string manifestPath, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener, map<string, string> *cloptions)
 {
-    bool copyrightAccepted = false;
+    ifstream manifest(manifestPath.c_str(), ios::in);
+    string line;
+    if (!manifest.is_open() || !getline(manifest, line) || line != DOWNLOAD_MANIFEST_HEADER)
+    {
+        setCurrentOutCode(MCMD_INVALIDTYPE);
+        LOG_err << "Not a valid download manifest: " << manifestPath;
+        return;
+    }
 
-    copyrightAccepted = ConfigurationManager::getConfigurationValue("copyrightAccepted", false) || force;
-    if (!copyrightAccepted)
+    vector<pair<MegaHandle, string>> targets;
+    std::set<MegaHandle> completed;
+    while (getline(manifest, line))
     {
-        MegaNodeList * mnl = api->getPublicLinks();
-        copyrightAccepted = mnl->size();
-        delete mnl;
+        size_t sep = line.find(' ', 2);
+        if (line.size() < 3 || line[1] != ' ')
+        {
+            continue;
+        }
+        MegaHandle h = api->base64ToHandle(line.substr(2, sep == string::npos ? string::npos : sep - 2).c_str());
+        if (line[0] == 'T' && sep != string::npos)
+        {
+            targets.push_back(std::make_pair(h, line.substr(sep + 1)));
+        }
+        else if (line[0] == 'D')
+        {
+            completed.insert(h);
+        }
     }
+    manifest.close();
 
-    int confirmationResponse = copyrightAccepted?MCMDCONFIRM_YES:MCMDCONFIRM_NO;
-    if (!copyrightAccepted)
+    targets.erase(std::remove_if(targets.begin(), targets.end(), [&completed](const pair<MegaHandle, string> &t)
     {
-        string confirmationQuery("MEGA respects the copyrights of others and requires that users of the MEGA cloud service comply with the laws of copyright.\n"
-                                 "You are strictly prohibited from using the MEGA cloud service to infringe copyrights.\n"
-                                 "You may not upload, download, store, share, display, stream, distribute, email, link to, "
-                                 "transmit or otherwise make available any files, data or content that infringes any copyright "
-                                 "or other proprietary rights of any person or entity.");
+        return completed.count(t.first) != 0;
+    }), targets.end());
 
-        confirmationQuery+=" Do you accept this terms? (Yes/No): ";
+    LOG_verbose << "Resuming " << targets.size() << " downloads (" << completed.size() << " already completed) from " << manifestPath;
+    scheduleDownloads(targets, manifestPath, background, ignorequotawarn, clientID, multiTransferListener, cloptions);
+}
 
-        confirmationResponse = askforConfirmation(confirmationQuery);
-    }
+void MegaCmdExecuter::scheduleDownloads(vector<pair<MegaHandle, string>> &targets, string manifestPath, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener, map<string, string> *cloptions)
+{
+    int maxInFlight = getintOption(cloptions, "max-in-flight", ConfigurationManager::getConfigurationValue("max_in_flight_downloads", 0));
 
-    if (confirmationResponse == MCMDCONFIRM_YES || confirmationResponse == MCMDCONFIRM_ALL)
+    std::mutex manifestMutex;
+    ofstream manifest;
+    bool trackCompletion = manifestPath.size() && !background && multiTransferListener;
+    if (manifestPath.size() && !trackCompletion)
     {
-        ConfigurationManager::savePropertyValue("copyrightAccepted",true);
-        MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
-        api->exportNode(n, expireTime, megaCmdListener);
-        megaCmdListener->wait();
-        if (checkNoErrors(megaCmdListener->getError(), "export node"))
+        LOG_warn << "Completed downloads will not be recorded in the manifest for queued downloads";
+    }
+    if (trackCompletion)
+    {
+        manifest.open(manifestPath.c_str(), ios::out | ios::app);
+        multiTransferListener->setOnTransferFinishCallback([this, &manifest, &manifestMutex](MegaTransfer *transfer, MegaError *e)
         {
-            MegaNode *nexported = api->getNodeByHandle(megaCmdListener->getRequest()->getNodeHandle());
-            if (nexported)
+            if (e->getErrorCode() == API_OK)
             {
-                char *nodepath = api->getNodePath(nexported);
-                char *publiclink = nexported->getPublicLink();
-                string publicPassProtectedLink = string();
-
-                if (amIPro() && password.size() )
-                {
-                    MegaCmdListener *megaCmdListener2 = new MegaCmdListener(api, NULL);
-                    api->encryptLinkWithPassword(publiclink, password.c_str(), megaCmdListener2);
-                    megaCmdListener2->wait();
-                    if (checkNoErrors(megaCmdListener2->getError(), "protect public link with password"))
-                    {
-                        publicPassProtectedLink = megaCmdListener2->getRequest()->getText();
-                    }
-                    delete megaCmdListener2;
-                }
-                else if (password.size())
-                {
-                    LOG_err << "Only PRO users can protect links with passwords. Showing UNPROTECTED link";
-                }
-
-                OUTSTREAM << "Exported " << nodepath << ": "
-                          << (publicPassProtectedLink.size()?publicPassProtectedLink:publiclink);
+                std::unique_ptr<char[]> base64handle(api->handleToBase64(transfer->getNodeHandle()));
+                std::lock_guard<std::mutex> g(manifestMutex);
+                manifest << "D " << base64handle.get() << endl;
+            }
+        });
+    }
 
+    int notfound = 0;
+    for (auto &target : targets)
+    {
+        if (!background && multiTransferListener)
+        {
+            multiTransferListener->waitForInFlightBelow(maxInFlight);
+        }
 
-                if (nexported->getExpirationTime())
-                {
-                    OUTSTREAM << " expires at " << getReadableTime(nexported->getExpirationTime());
-                }
-                OUTSTREAM << endl;
-                delete[] nodepath;
-                delete[] publiclink;
-                delete nexported;
-            }
-            else
-            {
-                setCurrentOutCode(MCMD_NOTFOUND);
-                LOG_err << "Exported node not found!";
-            }
+        std::unique_ptr<MegaNode> n(api->getNodeByHandle(target.first));
+        if (!n)
+        {
+            notfound++;
+            continue;
         }
-        delete megaCmdListener;
+        downloadNode(target.second, api, n.get(), background, ignorequotawarn, clientID, multiTransferListener);
     }
-}
 
-void MegaCmdExecuter::disableExport(MegaNode *n)
-{
-    if (!n->isExported())
+    if (notfound)
     {
-        setCurrentOutCode(MCMD_INVALIDSTATE);
-        LOG_err << "Could not disable export: node not exported.";
-        return;
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << notfound << " of the nodes to download could no longer be found";
     }
-    MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
 
-    api->disableExport(n, megaCmdListener);
-    megaCmdListener->wait();
-    if (checkNoErrors(megaCmdListener->getError(), "disable export"))
+    if (trackCompletion)
     {
-        MegaNode *nexported = api->getNodeByHandle(megaCmdListener->getRequest()->getNodeHandle());
-        if (nexported)
-        {
-            char *nodepath = api->getNodePath(nexported);
-            OUTSTREAM << "Disabled export: " << nodepath << endl;
-            delete[] nodepath;
-            delete nexported;
-        }
-        else
-        {
-            setCurrentOutCode(MCMD_NOTFOUND);
-            LOG_err << "Exported node not found!";
-        }
+        // the manifest is written from the listener: wait for all the transfers before it goes out of scope
+        multiTransferListener->waitMultiEnd();
+        multiTransferListener->setOnTransferFinishCallback(nullptr);
     }
+}
 
-    delete megaCmdListener;
+/**
+ * @brief Fills the key that identifies the current version of a local file
+ * @return true if it is an existing file with a valid inode (otherwise key->size is set to -1 if it cannot be opened)
+ */
+static bool statLocalFile(MegaFileSystemAccess *fsAccess, const string &path, LocalFingerprintKey *key)
+{
+    key->inode = 0;
+    key->size = -1;
+    key->mtime = 0;
+    key->device = 0;
+
+    LocalPath locallocal = LocalPath::fromPath(path, *fsAccess);
+    std::unique_ptr<FileAccess> fa = fsAccess->newfileaccess();
+    if (!fa->fopen(locallocal, true, false) || fa->type != FILENODE)
+    {
+        return false;
+    }
+    key->size = fa->size;
+    key->mtime = fa->mtime;
+    if (fa->fsidvalid)
+    {
+        key->inode = fa->fsid;
+    }
+
+    // inodes are only unique within a file system
+#ifdef _WIN32
+    string wpath;
+    MegaApi::utf8ToUtf16(path.c_str(), &wpath);
+    HANDLE hFile = CreateFileW((LPCWSTR)wpath.data(), 0, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+                               OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, NULL);
+    BY_HANDLE_FILE_INFORMATION info;
+    if (hFile != INVALID_HANDLE_VALUE && GetFileInformationByHandle(hFile, &info))
+    {
+        key->device = info.dwVolumeSerialNumber;
+    }
+    if (hFile != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(hFile);
+    }
+#else
+    struct stat st;
+    if (!stat(path.c_str(), &st))
+    {
+        key->device = st.st_dev;
+    }
+#endif
+    return key->inode != 0;
 }
 
-void MegaCmdExecuter::shareNode(MegaNode *n, string with, int level)
+static bool localFileExists(MegaFileSystemAccess *fsAccess, const string &path)
 {
-    MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
+    LocalPath locallocal = LocalPath::fromPath(path, *fsAccess);
+    std::unique_ptr<FileAccess> fa = fsAccess->newfileaccess();
+    return fa->fopen(locallocal, true, false) && fa->type == FILENODE;
+}
 
-    api->share(n, with.c_str(), level, megaCmdListener);
-    megaCmdListener->wait();
-    if (checkNoErrors(megaCmdListener->getError(), ( level != MegaShare::ACCESS_UNKNOWN ) ? "share node" : "disable share"))
+#ifdef MEGACMDEXECUTER_FILESYSTEM
+static long long localEntrySize(const fs::directory_entry &entry, const fs::file_status &status)
+{
+    std::error_code ec;
+    uintmax_t size = fs::is_regular_file(status) ? entry.file_size(ec) : 0;
+    return ec ? 0 : (long long)size;
+}
+#endif
+
+void MegaCmdExecuter::startFingerprintVerifier()
+{
+    std::lock_guard<std::mutex> g(fingerprintVerifierMutex);
+    if (fingerprintVerifierThread.joinable() || stopFingerprintVerifier)
     {
-        MegaNode *nshared = api->getNodeByHandle(megaCmdListener->getRequest()->getNodeHandle());
-        if (nshared)
+        return;
+    }
+
+    int period = ConfigurationManager::getConfigurationValue("fingerprint_verify_period", 0);
+    fingerprintCache.load(ConfigurationManager::getConfigFolder() + "/" + "fingerprints");
+    fingerprintVerifierThread = std::thread([this, period]()
+    {
+        if (period <= 0)
         {
-            char *nodepath = api->getNodePath(nshared);
-            if (megaCmdListener->getRequest()->getAccess() == MegaShare::ACCESS_UNKNOWN)
-            {
-                OUTSTREAM << "Stopped sharing " << nodepath << " with " << megaCmdListener->getRequest()->getEmail() << endl;
-            }
-            else
+            // only drop the records of files gone or changed since they were cached: a stat per file
+            MegaFileSystemAccess fsAccess;
+            size_t dropped = fingerprintCache.verify([&fsAccess](const string &path, LocalFingerprintKey *key)
             {
-                OUTSTREAM << "Shared " << nodepath << " : " << megaCmdListener->getRequest()->getEmail()
-                          << " accessLevel=" << megaCmdListener->getRequest()->getAccess() << endl;
-            }
-            delete[] nodepath;
-            delete nshared;
+                return statLocalFile(&fsAccess, path, key);
+            });
+            fingerprintCache.flush();
+            LOG_debug << "Local fingerprints checked: " << dropped << " dropped";
+            return;
         }
-        else
+
+        std::unique_lock<std::mutex> lock(fingerprintVerifierMutex);
+        while (!fingerprintVerifierCV.wait_for(lock, std::chrono::seconds(period), [this]() { return stopFingerprintVerifier.load(); }))
         {
-            setCurrentOutCode(MCMD_NOTFOUND);
-            LOG_err << "Shared node not found!";
+            lock.unlock();
+            verifyLocalFingerprints();
+            lock.lock();
         }
-    }
-
-    delete megaCmdListener;
+    });
 }
 
-void MegaCmdExecuter::disableShare(MegaNode *n, string with)
+/**
+ * @brief Gets the change journal of a backed up folder, used to refresh its local fingerprints
+ * incrementally. Backups themselves are scanned by the SDK, which does not use it
+ * @return NULL if disabled or if the folder cannot be journaled
+ */
+LocalChangeJournal *MegaCmdExecuter::getBackupChangeJournal(const string &localpath)
 {
-    shareNode(n, with, MegaShare::ACCESS_UNKNOWN);
+    if (!ConfigurationManager::getConfigurationValue("backup_change_journal", false)
+            || ConfigurationManager::getConfigurationValue("fingerprint_verify_period", 0) <= 0)
+    {
+        return NULL;
+    }
+
+    {
+        std::lock_guard<std::mutex> g(backupJournalsMutex);
+        auto it = backupJournals.find(localpath);
+        if (it != backupJournals.end())
+        {
+            return it->second.get();
+        }
+    }
+
+    // watching the whole tree may take long: not to be done holding the lock
+    std::unique_ptr<LocalChangeJournal> journal(new LocalChangeJournal(localpath));
+    if (!journal->start())
+    {
+        journal.reset(); // remember it cannot be journaled, not to retry every time
+    }
+
+    std::lock_guard<std::mutex> g(backupJournalsMutex);
+    return (backupJournals[localpath] = std::move(journal)).get();
 }
 
-int MegaCmdExecuter::makedir(string remotepath, bool recursive, MegaNode *parentnode)
+void MegaCmdExecuter::verifyLocalFingerprints()
 {
-    MegaNode *currentnode;
-    if (parentnode)
+    MegaFileSystemAccess fsAccess; // not to share fsAccessCMD with the main thread
+    size_t dropped = fingerprintCache.verify([&fsAccess](const string &path, LocalFingerprintKey *key)
     {
-        currentnode = parentnode;
-    }
-    else
+        return statLocalFile(&fsAccess, path, key);
+    });
+
+    size_t computed = 0;
+#if defined(ENABLE_BACKUPS) && defined(MEGACMDEXECUTER_FILESYSTEM)
+    // keep the fingerprints of the backed up folders up to date, so that comparing them is metadata-only
+    vector<string> roots;
+    mtxBackupsMap.lock();
+    for (auto &backup : ConfigurationManager::configuredBackups)
     {
-        currentnode = api->getNodeByHandle(cwd);
+        if (backup.second->active)
+        {
+            roots.push_back(backup.second->localpath);
+        }
     }
-    if (currentnode)
+    mtxBackupsMap.unlock();
+
+    auto refreshFingerprint = [this, &fsAccess, &computed](const string &path)
     {
-        string rest = remotepath;
-        while (rest.length())
+        LocalFingerprintKey key;
+        string fingerprint;
+        if (!statLocalFile(&fsAccess, path, &key) || fingerprintCache.getFingerprint(path, key, &fingerprint))
         {
-            bool lastleave = false;
-            size_t possep = rest.find_first_of("/");
-            if (possep == string::npos)
-            {
-                possep = rest.length();
-                lastleave = true;
-            }
+            return;
+        }
 
-            string newfoldername = rest.substr(0, possep);
-            if (!rest.length())
-            {
-                break;
-            }
-            if (newfoldername.length())
+        std::unique_ptr<char[]> newfingerprint(api->getFingerprint(path.c_str()));
+        if (newfingerprint)
+        {
+            fingerprintCache.setFingerprint(path, key, newfingerprint.get());
+            computed++;
+        }
+    };
+
+    std::shared_ptr<ExclusionMatcher> exclusions = ConfigurationManager::getExclusionMatcher();
+    for (auto &root : roots)
+    {
+        LocalChangeJournal *journal = getBackupChangeJournal(root);
+        auto scanStart = std::chrono::steady_clock::now();
+
+        std::set<string> changed;
+        if (journal && journal->takeChanges(&changed))
+        {
+            for (auto &path : changed)
             {
-                MegaNode *existing_node = api->getChildNode(currentnode, newfoldername.c_str());
-                if (!existing_node)
+                if (stopFingerprintVerifier)
                 {
-                    if (!recursive && !lastleave)
-                    {
-                        LOG_err << "Use -p to create folders recursively";
-                        if (currentnode != parentnode)
-                            delete currentnode;
-                        return MCMD_EARGS;
-                    }
-                    LOG_verbose << "Creating (sub)folder: " << newfoldername;
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->createFolder(newfoldername.c_str(), currentnode, megaCmdListener);
-                    actUponCreateFolder(megaCmdListener);
-                    delete megaCmdListener;
-                    MegaNode *prevcurrentNode = currentnode;
-                    currentnode = api->getChildNode(currentnode, newfoldername.c_str());
-                    if (prevcurrentNode != parentnode)
-                        delete prevcurrentNode;
-                    if (!currentnode)
-                    {
-                        LOG_err << "Couldn't get node for created subfolder: " << newfoldername;
-                        if (currentnode != parentnode)
-                            delete currentnode;
-                        return MCMD_INVALIDSTATE;
-                    }
+                    break;
                 }
-                else
+                // as the full scan does, skip the files within excluded folders too
+                bool excluded = false;
+                for (size_t start = root.size(), end; !excluded && start < path.size(); start = end + 1)
                 {
-                    if (currentnode != parentnode)
-                        delete currentnode;
-                    currentnode = existing_node;
+                    end = path.find('/', start);
+                    end = (end == string::npos) ? path.size() : end;
+                    excluded = end > start && exclusions->matches(path.substr(start, end - start));
                 }
-
-                if (lastleave && existing_node)
+                if (!excluded)
                 {
-                    LOG_err << ((existing_node->getType() == MegaNode::TYPE_FILE)?"File":"Folder") << " already exists: " << remotepath;
-                    if (currentnode != parentnode)
-                        delete currentnode;
-                    return MCMD_INVALIDSTATE;
+                    refreshFingerprint(path);
                 }
             }
+            journal->recordIncrementalScan(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - scanStart).count());
+            continue;
+        }
 
-            //string rest = rest.substr(possep+1,rest.length()-possep-1);
-            if (!lastleave)
+        std::error_code ec;
+        for (fs::recursive_directory_iterator iter(fs::u8path(root), fs::directory_options::skip_permission_denied, ec);
+             !ec && iter != fs::recursive_directory_iterator() && !stopFingerprintVerifier; iter.increment(ec))
+        {
+            fs::file_status status = iter->symlink_status();
+            if (exclusions->prune(iter->path().filename().u8string(), localEntrySize(*iter, status)))
             {
-                rest = rest.substr(possep + 1, rest.length());
+                if (fs::is_directory(status))
+                {
+                    iter.disable_recursion_pending(); // not to walk excluded folders
+                }
+                continue;
             }
-            else
+            if (fs::is_regular_file(status))
             {
-                break;
+                refreshFingerprint(iter->path().u8string());
             }
         }
-        if (currentnode != parentnode)
-            delete currentnode;
+        if (journal)
+        {
+            journal->recordFullScan(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - scanStart).count());
+        }
     }
-    else
+
+    // forget the journals of the folders no longer backed up
+    std::lock_guard<std::mutex> g(backupJournalsMutex);
+    for (auto it = backupJournals.begin(); it != backupJournals.end(); )
     {
-        return MCMD_EARGS;
+        if (std::find(roots.begin(), roots.end(), it->first) == roots.end())
+        {
+            it = backupJournals.erase(it);
+        }
+        else
+        {
+            it++;
+        }
     }
-    return MCMD_OK;
+#endif
 
+    fingerprintCache.flush();
+    LOG_debug << "Local fingerprints verified: " << dropped << " dropped, " << computed << " computed, " << fingerprintCache.size()
+              << " cached (hits: " << fingerprintCache.getHits() << ", misses: " << fingerprintCache.getMisses()
+              << ", invalidations: " << fingerprintCache.getInvalidations() << ")";
 }
 
-
-string MegaCmdExecuter::getCurrentPath()
+vector<bool> MegaCmdExecuter::findUnchangedFiles(const vector<pair<string, MegaNode *>> &comparisons)
 {
-    string toret;
-    MegaNode *ncwd = api->getNodeByHandle(cwd);
-    if (ncwd)
-    {
-        char *currentPath = api->getNodePath(ncwd);
-        toret = string(currentPath);
-        delete []currentPath;
-        delete ncwd;
-    }
-    return toret;
-}
+    vector<char> unchanged(comparisons.size(), false); // not vector<bool>: written from several threads
+    vector<LocalFingerprintKey> keys(comparisons.size());
+    vector<size_t> toHash;
 
-long long MegaCmdExecuter::getVersionsSize(MegaNode *n)
-{
-    long long toret = 0;
+    fingerprintCache.load(ConfigurationManager::getConfigFolder() + "/" + "fingerprints");
+    startFingerprintVerifier();
 
-    MegaNodeList *versionNodes = api->getVersions(n);
-    if (versionNodes)
+    // first pass: metadata only
+    for (size_t i = 0; i < comparisons.size(); i++)
     {
-        for (int i = 0; i < versionNodes->size(); i++)
+        MegaNode *n = comparisons[i].second;
+        if (!n || !n->getFingerprint())
         {
-            MegaNode *versionNode = versionNodes->get(i);
-            toret += api->getSize(versionNode);
+            continue;
         }
-        delete versionNodes;
-    }
 
-    MegaNodeList *children = api->getChildren(n);
-    if (children)
-    {
-        for (int i = 0; i < children->size(); i++)
+        bool hasInode = statLocalFile(fsAccessCMD, comparisons[i].first, &keys[i]);
+        if (keys[i].size != n->getSize())
         {
-            MegaNode *child = children->get(i);
-            toret += getVersionsSize(child);
+            continue;
+        }
+
+        string fingerprint;
+        if (!hasInode)
+        {
+            toHash.push_back(i); // no stable identity for the file: it cannot be cached
+        }
+        else if (fingerprintCache.getFingerprint(comparisons[i].first, keys[i], &fingerprint))
+        {
+            unchanged[i] = (fingerprint == n->getFingerprint());
+        }
+        else
+        {
+            toHash.push_back(i);
         }
-        delete children;
     }
-    return toret;
-}
 
-void MegaCmdExecuter::getInfoFromFolder(MegaNode *n, MegaApi *api, long long *nfiles, long long *nfolders, long long *nversions)
-{
-    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-    api->getFolderInfo(n, megaCmdListener);
-    *nfiles = 0;
-    *nfolders = 0;
-    megaCmdListener->wait();
-    if (checkNoErrors(megaCmdListener->getError(), "getting folder info"))
+    // second pass: compute the fingerprints not cached, in parallel
+    std::atomic<size_t> next(0);
+    auto worker = [&]()
     {
-        MegaFolderInfo * mfi = megaCmdListener->getRequest()->getMegaFolderInfo();
-        if (mfi)
+        for (size_t j = next++; j < toHash.size(); j = next++)
         {
-            *nfiles  = mfi->getNumFiles();
-            *nfolders  = mfi->getNumFolders();
-            if (nversions)
+            size_t i = toHash[j];
+            std::unique_ptr<char[]> fingerprint(api->getFingerprint(comparisons[i].first.c_str()));
+            if (fingerprint)
             {
-                *nversions = mfi->getNumVersions();
+                if (keys[i].inode)
+                {
+                    fingerprintCache.setFingerprint(comparisons[i].first, keys[i], fingerprint.get());
+                }
+                unchanged[i] = !strcmp(fingerprint.get(), comparisons[i].second->getFingerprint());
             }
-            delete mfi;
         }
+    };
+
+    unsigned int nthreads = min(max(1u, min(4u, std::thread::hardware_concurrency())), (unsigned int)toHash.size());
+    vector<std::thread> workers;
+    for (unsigned int i = 0; i < nthreads; i++)
+    {
+        workers.push_back(std::thread(worker));
+    }
+    for (auto &w : workers)
+    {
+        w.join();
     }
+
+    LOG_debug << "Compared " << comparisons.size() << " files: " << toHash.size() << " fingerprints computed";
+    fingerprintCache.flush();
+    return vector<bool>(unchanged.begin(), unchanged.end());
 }
 
-vector<string> MegaCmdExecuter::listpaths(bool usepcre, string askedPath, bool discardFiles)
+void MegaCmdExecuter::planUpload(const string &localPath, MegaNode *parent, const string &newname, vector<PlannedTransfer> &planned, vector<pair<string, MegaNode *>> &comparisons)
 {
-    vector<string> paths;
-    if ((int)askedPath.size())
+    PlannedTransfer transfer;
+    transfer.localPath = localPath;
+    transfer.handle = parent->getHandle();
+    transfer.newname = newname;
+    transfer.comparisonIndex = -1;
+
+    string name = newname;
+    if (!name.size())
     {
-        vector<string> *pathsToList = nodesPathsbypath(askedPath.c_str(), usepcre);
-        if (pathsToList)
+        string trimmed = localPath;
+        trimmed = removeTrailingSeparators(trimmed);
+        size_t pos = trimmed.find_last_of("/\\");
+        name = (pos == string::npos) ? trimmed : trimmed.substr(pos + 1);
+    }
+
+    MegaNode *remote = api->getChildNode(parent, name.c_str());
+    if (!remote)
+    {
+        planned.push_back(transfer);
+        return;
+    }
+
+    if (!IsFolder(localPath))
+    {
+        if (remote->getType() == MegaNode::TYPE_FILE)
         {
-            for (std::vector< string >::iterator it = pathsToList->begin(); it != pathsToList->end(); ++it)
-            {
-                string nodepath= *it;
-                MegaNode *ncwd = api->getNodeByHandle(cwd);
-                if (ncwd)
-                {
-                    MegaNode * n = nodebypath(nodepath.c_str());
-                    if (n)
-                    {
-                        if (n->getType() != MegaNode::TYPE_FILE)
-                        {
-                            nodepath += "/";
-                        }
-                        if (!( discardFiles && ( n->getType() == MegaNode::TYPE_FILE )))
-                        {
-                            paths.push_back(nodepath);
-                        }
-
-                        delete n;
-                    }
-                    else
-                    {
-                        LOG_debug << "Unexpected: matching path has no associated node: " << nodepath << ". Could have been deleted in the process";
-                    }
-                    delete ncwd;
-                }
-                else
-                {
-                    setCurrentOutCode(MCMD_INVALIDSTATE);
-                    LOG_err << "Couldn't find woking folder (it might been deleted)";
-                }
-            }
-            pathsToList->clear();
-            delete pathsToList;
+            transfer.comparisonIndex = int(comparisons.size());
+            comparisons.push_back(std::make_pair(localPath, remote));
         }
+        else
+        {
+            delete remote;
+        }
+        planned.push_back(transfer);
+        return;
     }
 
-    return paths;
-}
-
-#ifdef _WIN32
-//TODO: try to use these functions from somewhere else
-static std::wstring toUtf16String(const std::string& s, UINT codepage = CP_UTF8)
-{
-    std::wstring ws;
-    ws.resize(s.size() + 1);
-    int nwchars = MultiByteToWideChar(codepage, 0, s.data(), int(s.size()), (LPWSTR)ws.data(), int(ws.size()));
-    ws.resize(nwchars);
-    return ws;
-}
-
-std::string toUtf8String(const std::wstring& ws, UINT codepage = CP_UTF8)
-{
-    std::string s;
-    s.resize((ws.size() + 1) * 4);
-    int nchars = WideCharToMultiByte(codepage, 0, ws.data(), int(ws.size()), (LPSTR)s.data(), int(s.size()), NULL, NULL);
-    s.resize(nchars);
-    return s;
-}
-
-
-bool replaceW(std::wstring& str, const std::wstring& from, const std::wstring& to)
-{
-    size_t start_pos = str.find(from);
-    if (start_pos == std::wstring::npos)
-    {
-        return false;
-    }
-    str.replace(start_pos, from.length(), to);
-    return true;
-}
-#endif
-
-vector<string> MegaCmdExecuter::listlocalpathsstartingby(string askedPath, bool discardFiles)
-{
-    vector<string> paths;
-
-#ifdef WIN32
-    string actualaskedPath = fs::u8path(askedPath).u8string();
-    char sep = (!askedPath.empty() && askedPath.find('/') != string::npos ) ?'/':'\\';
-    size_t postlastsep = actualaskedPath.find_last_of("/\\");
-#else
-    string actualaskedPath = askedPath;
-    char sep = '/';
-    size_t postlastsep = actualaskedPath.find_last_of(sep);
-#endif
-
-    if (postlastsep == 0) postlastsep++; // absolute paths
-    string containingfolder = postlastsep == string::npos ? string() : actualaskedPath.substr(0, postlastsep);
-
-    bool removeprefix = false;
-    bool requiresseparatorafterunit = false;
-    if (!containingfolder.size())
-    {
-        containingfolder = ".";
-        removeprefix= true;
-    }
-#ifdef WIN32
-    else if (containingfolder.find(":") == 1 && (containingfolder.size() < 3 || ( containingfolder.at(2) != '/' && containingfolder.at(2) != '\\')))
-    {
-        requiresseparatorafterunit = true;
-    }
-#endif
-
+    std::unique_ptr<MegaNode> remoteFolder(remote);
 #ifdef MEGACMDEXECUTER_FILESYSTEM
-    for (fs::directory_iterator iter(fs::u8path(containingfolder)); iter != fs::directory_iterator(); ++iter)
+    if (remoteFolder->getType() != MegaNode::TYPE_FILE)
     {
-        if (!discardFiles || iter->status().type() == fs::file_type::directory)
+        // existing remote folder: only its differing contents will be uploaded. Exclusions are not applied,
+        // as in any other upload: contents uploaded must not depend on --skip-unchanged
+        std::error_code ec;
+        for (fs::directory_iterator iter(fs::u8path(localPath), ec); !ec && iter != fs::directory_iterator(); iter.increment(ec))
         {
-#ifdef _WIN32
-            wstring path = iter->path().wstring();
-#else
-            string path = iter->path().string();
-#endif
-            if (removeprefix) path = path.substr(2);
-            if (requiresseparatorafterunit) path.insert(2, 1, sep);
-            if (iter->status().type() == fs::file_type::directory)
-            {
-                path.append(1, sep);
-            }
-#ifdef _WIN32
-                // try to mimic the exact startup of the asked path to allow mix of '\' & '/'
-                fs::path paskedpath = fs::u8path(askedPath);
-                paskedpath.make_preferred();
-                wstring toreplace = paskedpath.wstring();
-                if (path.find(toreplace) == 0)
-                {
-                    replaceW(path, toreplace, toUtf16String(askedPath));
-                }
-#endif
-#ifdef _WIN32
-            paths.push_back(toUtf8String(path));
-#else
-            paths.push_back(path);
-#endif
-
+            planUpload(iter->path().u8string(), remoteFolder.get(), "", planned, comparisons);
         }
-    }
-
-#elif defined(HAVE_DIRENT_H)
-    DIR *dir;
-    if ((dir = opendir (containingfolder.c_str())) != NULL)
-    {
-        struct dirent *entry;
-        while ((entry = readdir (dir)) != NULL)
+        if (!ec)
         {
-            if (!discardFiles || entry->d_type == DT_DIR)
-            {
-                string path = containingfolder;
-                if (path != "/")
-                    path.append(1, sep);
-                path.append(entry->d_name);
-                if (removeprefix) path = path.substr(2);
-                if (path.size() && entry->d_type == DT_DIR)
-                {
-                    path.append(1, sep);
-                }
-                paths.push_back(path);
-            }
+            return;
         }
-
-        closedir(dir);
+        LOG_warn << "Could not list local folder " << localPath << ": " << ec.message();
     }
 #endif
-    return paths;
+    planned.push_back(transfer);
 }
 
-vector<string> MegaCmdExecuter::getlistusers()
+void MegaCmdExecuter::planDownload(MegaNode *node, const string &localPath, vector<PlannedTransfer> &planned, vector<pair<string, MegaNode *>> &comparisons)
 {
-    vector<string> users;
+#ifdef _WIN32
+    const char *separator = "\\";
+#else
+    const char *separator = "/";
+#endif
+    PlannedTransfer transfer;
+    transfer.localPath = localPath;
+    transfer.handle = node->getHandle();
+    transfer.comparisonIndex = -1;
 
-    MegaUserList* usersList = api->getContacts();
-    if (usersList)
+    string localRoot = getDownloadRootPath(localPath, node);
+    if (node->getType() == MegaNode::TYPE_FILE)
     {
-        for (int i = 0; i < usersList->size(); i++)
+        transfer.comparisonIndex = int(comparisons.size());
+        comparisons.push_back(std::make_pair(localRoot, node->copy()));
+    }
+    else if (IsFolder(localRoot))
+    {
+        // existing local folder: only its differing contents will be downloaded
+        std::unique_ptr<MegaNodeList> children(api->getChildren(node));
+        for (int i = 0; children && i < children->size(); i++)
         {
-            users.push_back(usersList->get(i)->getEmail());
+            planDownload(children->get(i), localRoot + separator, planned, comparisons);
         }
-
-        delete usersList;
+        return;
     }
-    return users;
+    planned.push_back(transfer);
 }
 
-vector<string> MegaCmdExecuter::getNodeAttrs(string nodePath)
+void MegaCmdExecuter::uploadNodesSkippingUnchanged(const vector<string> &localPaths, MegaNode *node, string newname, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener, SkipUnchangedStats *stats)
 {
-    vector<string> attrs;
-
-    MegaNode *n = nodebypath(nodePath.c_str());
-    if (n)
+    vector<PlannedTransfer> planned;
+    vector<pair<string, MegaNode *>> comparisons;
+    for (auto localPath : localPaths)
     {
-        //List node custom attributes
-        MegaStringList *attrlist = n->getCustomAttrNames();
-        if (attrlist)
-        {
-            for (int a = 0; a < attrlist->size(); a++)
-            {
-                attrs.push_back(attrlist->get(a));
-            }
-
-            delete attrlist;
-        }
-        delete n;
+        unescapeifRequired(localPath);
+        planUpload(localPath, node, newname, planned, comparisons);
     }
-    return attrs;
-}
 
-vector<string> MegaCmdExecuter::getUserAttrs()
-{
-    vector<string> attrs;
-    int i = 0;
-    do
+    vector<bool> unchanged = findUnchangedFiles(comparisons);
+    for (auto &transfer : planned)
     {
-        const char *catrn = api->userAttributeToString(i);
-        if (strlen(catrn))
+        if (transfer.comparisonIndex >= 0 && unchanged[transfer.comparisonIndex])
         {
-            attrs.push_back(catrn);
+            stats->skippedFiles++;
+            stats->skippedBytes += comparisons[transfer.comparisonIndex].second->getSize();
+            continue;
         }
-        else
+
+        std::unique_ptr<MegaNode> parent(api->getNodeByHandle(transfer.handle));
+        if (parent)
         {
-            delete [] catrn;
-            break;
+            uploadNode(transfer.localPath, api, parent.get(), transfer.newname, background, ignorequotawarn, clientID, multiTransferListener);
+            stats->enqueuedTransfers++;
         }
-        delete [] catrn;
-        i++;
-    } while (true);
+    }
 
-    return attrs;
+    for (auto &comparison : comparisons)
+    {
+        delete comparison.second;
+    }
 }
 
-vector<string> MegaCmdExecuter::getsessions()
+void MegaCmdExecuter::planDownloadsSkippingUnchanged(vector<MegaNode *> *nodes, string localPath, vector<pair<MegaHandle, string>> &targets, SkipUnchangedStats *stats)
 {
-    vector<string> sessions;
-    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-    api->getExtendedAccountDetails(true, true, true, megaCmdListener);
-    int trywaitout = megaCmdListener->trywait(3000);
-    if (trywaitout)
+    vector<PlannedTransfer> planned;
+    vector<pair<string, MegaNode *>> comparisons;
+    for (auto n : *nodes)
     {
-        return sessions;
+        planDownload(n, localPath, planned, comparisons);
     }
 
-    if (checkNoErrors(megaCmdListener->getError(), "get sessions"))
+    vector<bool> unchanged = findUnchangedFiles(comparisons);
+    for (auto &transfer : planned)
     {
-        MegaAccountDetails *details = megaCmdListener->getRequest()->getMegaAccountDetails();
-        if (details)
+        if (transfer.comparisonIndex >= 0 && unchanged[transfer.comparisonIndex])
         {
-            int numSessions = details->getNumSessions();
-            for (int i = 0; i < numSessions; i++)
-            {
-                MegaAccountSession * session = details->getSession(i);
-                if (session)
-                {
-                    if (session->isAlive())
-                    {
-                        std::unique_ptr<char []> handle {api->userHandleToBase64(session->getHandle())};
-                        sessions.push_back(handle.get());
-                    }
-                    delete session;
-                }
-            }
-
-            delete details;
+            stats->skippedFiles++;
+            stats->skippedBytes += comparisons[transfer.comparisonIndex].second->getSize();
+            continue;
         }
+        targets.push_back(std::make_pair(transfer.handle, transfer.localPath));
+        stats->enqueuedTransfers++;
+    }
+
+    for (auto &comparison : comparisons)
+    {
+        delete comparison.second;
     }
-    delete megaCmdListener;
-    return sessions;
 }
 
-vector<string> MegaCmdExecuter::getlistfilesfolders(string location)
+void MegaCmdExecuter::printSkipUnchangedStats(SkipUnchangedStats *stats, MegaCmdMultiTransferListener *multiTransferListener, bool background)
 {
-    vector<string> toret;
-#ifdef MEGACMDEXECUTER_FILESYSTEM
-    for (fs::directory_iterator iter(fs::u8path(location)); iter != fs::directory_iterator(); ++iter)
+    OUTSTREAM << "Skipped " << stats->skippedFiles << " unchanged files (" << sizeToText(stats->skippedBytes) << ")";
+    if (background)
     {
-        toret.push_back(iter->path().filename().u8string());
+        OUTSTREAM << ", queued " << stats->enqueuedTransfers << " transfers" << endl;
     }
-
-#elif defined(HAVE_DIRENT_H)
-    DIR *dir;
-    struct dirent *entry;
-    if ((dir = opendir (location.c_str())) != NULL)
+    else
     {
-        while ((entry = readdir (dir)) != NULL)
-        {
-            if (IsFolder(location + entry->d_name))
-            {
-                toret.push_back(entry->d_name + string("/"));
-            }
-            else
-            {
-                toret.push_back(entry->d_name);
-            }
-        }
-        closedir (dir);
+        OUTSTREAM << ", transferred " << stats->enqueuedTransfers << " files/folders (" << sizeToText(multiTransferListener->getTotalbytes()) << ")" << endl;
     }
-#endif
-    return toret;
 }
 
-void MegaCmdExecuter::signup(string name, string passwd, string email)
+void MegaCmdExecuter::uploadNode(string path, MegaApi* api, MegaNode *node, string newname, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener)
 {
-    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-
-    size_t spos = name.find(" ");
-    string firstname = name.substr(0, spos);
-    string lastname;
-    if (spos != string::npos && ((spos + 1) < name.length()))
-    {
-        lastname = name.substr(spos+1);
+    if (!ignorequotawarn)
+    { //TODO: reenable this if ever queryBandwidthQuota applies to uploads as well
+//        MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
+//        api->queryBandwidthQuota(node->getSize(),megaCmdListener);
+//        megaCmdListener->wait();
+//        if (checkNoErrors(megaCmdListener->getError(), "query bandwidth quota"))
+//        {
+//            if (megaCmdListener->getRequest() && megaCmdListener->getRequest()->getFlag() )
+//            {
+//                OUTSTREAM << "Transfer not started: proceding will exceed bandwith quota. "
+//                             "Use --ignore-quota-warn to initiate nevertheless" << endl;
+//                return;
+//            }
+//        }
     }
+    unescapeifRequired(path);
 
-    OUTSTREAM << "Singinup up. name=" << firstname << ". surname=" << lastname<< endl;
-
-    api->createAccount(email.c_str(), passwd.c_str(), firstname.c_str(), lastname.c_str(), megaCmdListener);
-    megaCmdListener->wait();
-    if (checkNoErrors(megaCmdListener->getError(), "create account <" + email + ">"))
+    LocalPath locallocal = LocalPath::fromPath(path, *fsAccessCMD);
+    std::unique_ptr<FileAccess> fa = fsAccessCMD->newfileaccess();
+    if (!fa->fopen(locallocal, true, false))
     {
-        OUTSTREAM << "Account <" << email << "> created succesfully. You will receive a confirmation link. Use \"confirm\" with the provided link to confirm that account" << endl;
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << "Unable to open local path: " << path;
+        return;
     }
 
-    delete megaCmdListener;
-
-    MegaCmdListener *megaCmdListener2 = new MegaCmdListener(NULL);
-    api->localLogout(megaCmdListener2);
-    megaCmdListener2->wait();
-    checkNoErrors(megaCmdListener2->getError(), "logging out from ephemeral account");
-    delete megaCmdListener2;
-}
-
-void MegaCmdExecuter::signupWithPassword(string passwd)
-{
-    return signup(name, passwd, login);
-}
-
-void MegaCmdExecuter::confirm(string passwd, string email, string link)
-{
-    MegaCmdListener *megaCmdListener2 = new MegaCmdListener(NULL);
-    api->confirmAccount(link.c_str(), passwd.c_str(), megaCmdListener2);
-    megaCmdListener2->wait();
-    if (megaCmdListener2->getError()->getErrorCode() == MegaError::API_ENOENT)
-    {
-        LOG_err << "Invalid password";
-    }
-    else if (checkNoErrors(megaCmdListener2->getError(), "confirm account"))
+    MegaCmdTransferListener *megaCmdTransferListener = NULL;
+    if (!background)
     {
-        OUTSTREAM << "Account " << email << " confirmed succesfully. You can login with it now" << endl;
+        if (!multiTransferListener)
+        {
+            megaCmdTransferListener = new MegaCmdTransferListener(api, sandboxCMD, multiTransferListener, clientID);
+        }
+        multiTransferListener->onNewTransfer();
     }
 
-    delete megaCmdListener2;
-}
-
-void MegaCmdExecuter::confirmWithPassword(string passwd)
-{
-    return confirm(passwd, login, link);
-}
-
-bool MegaCmdExecuter::IsFolder(string path)
-{
 #ifdef _WIN32
     replaceAll(path,"/","\\");
 #endif
-    LocalPath localpath = LocalPath::fromPath(path, *fsAccessCMD);
-    std::unique_ptr<FileAccess> fa = fsAccessCMD->newfileaccess();
-    return fa->isfolder(localpath);
-}
 
-void MegaCmdExecuter::printTransfersHeader(const unsigned int PATHSIZE, bool printstate)
-{
-    OUTSTREAM << "TYPE     TAG  " << getFixLengthString("SOURCEPATH ",PATHSIZE) << getFixLengthString("DESTINYPATH ",PATHSIZE)
-              << "  " << getFixLengthString("    PROGRESS",21);
-    if (printstate)
-    {
-        OUTSTREAM  << "  " << "STATE";
-    }
-    OUTSTREAM << endl;
-}
+    LOG_debug << "Starting upload: " << path << " to : " << node->getName() << (newname.size()?"/":"") << newname;
 
-void MegaCmdExecuter::printTransfer(MegaTransfer *transfer, const unsigned int PATHSIZE, bool printstate)
-{
-    //Direction
-#ifdef _WIN32
-    OUTSTREAM << " " << ((transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)?"D":"U") << " ";
-#else
-    OUTSTREAM << " " << ((transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)?"\u21d3":"\u21d1") << " ";
-#endif
-    //TODO: handle TYPE_LOCAL_TCP_DOWNLOAD
 
-    //type (transfer/normal)
-    if (transfer->isSyncTransfer())
-    {
-#ifdef _WIN32
-        OUTSTREAM << "S";
-#else
-        OUTSTREAM << "\u21f5";
-#endif
-    }
-#ifdef ENABLE_BACKUPS
-    else if (transfer->isBackupTransfer())
+    MegaTransferListener *thelistener;
+    if (multiTransferListener && !background)
     {
-#ifdef _WIN32
-        OUTSTREAM << "B";
-#else
-        OUTSTREAM << "\u23eb";
-#endif
+       thelistener = multiTransferListener;
     }
-#endif
     else
     {
-        OUTSTREAM << " " ;
+        thelistener = megaCmdTransferListener;
     }
 
-    OUTSTREAM << " " ;
-
-    //tag
-    OUTSTREAM << getRightAlignedString(SSTR(transfer->getTag()),7) << " ";
-
-    if (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)
+    if (newname.size())
     {
-        // source
-        MegaNode * node = api->getNodeByHandle(transfer->getNodeHandle());
-        if (node)
-        {
-            char * nodepath = api->getNodePath(node);
-            OUTSTREAM << getFixLengthString(nodepath,PATHSIZE);
-            delete []nodepath;
-
-            delete node;
-        }
-        else
-        {
-            globalTransferListener->completedTransfersMutex.lock();
-            OUTSTREAM << getFixLengthString(globalTransferListener->completedPathsByHandle[transfer->getNodeHandle()],PATHSIZE);
-            globalTransferListener->completedTransfersMutex.unlock();
-        }
-
-        OUTSTREAM << " ";
 
-        //destination
-        string dest = transfer->getParentPath() ? transfer->getParentPath() : "";
-        dest.append(transfer->getFileName());
-        OUTSTREAM << getFixLengthString(dest,PATHSIZE);
+        api->startUpload(removeTrailingSeparators(path).c_str(), node, newname.c_str(), thelistener);
     }
     else
     {
-
-        //source
-        string source(transfer->getParentPath()?transfer->getParentPath():"");
-        source.append(transfer->getFileName());
-
-        OUTSTREAM << getFixLengthString(source, PATHSIZE);
-        OUTSTREAM << " ";
-
-        //destination
-        MegaNode * parentNode = api->getNodeByHandle(transfer->getParentHandle());
-        if (parentNode)
+        api->startUpload(removeTrailingSeparators(path).c_str(), node, thelistener);
+    }
+    if (megaCmdTransferListener)
+    {
+        megaCmdTransferListener->wait();
+#ifdef _WIN32
+            Sleep(100); //give a while to print end of transfer
+#endif
+        if (megaCmdTransferListener->getError()->getErrorCode() == API_EREAD)
         {
-            char * parentnodepath = api->getNodePath(parentNode);
-            OUTSTREAM << getFixLengthString(parentnodepath ,PATHSIZE);
-            delete []parentnodepath;
-
-            delete parentNode;
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << "Could not find local path: " << path;
         }
-        else
+        else if (checkNoErrors(megaCmdTransferListener->getError(), "Upload node"))
         {
-            OUTSTREAM << getFixLengthString("",PATHSIZE,'-');
-            LOG_warn << "Could not find destination (parent handle "<< ((transfer->getParentHandle()==INVALID_HANDLE)?" invalid":" valid")
-                     <<" ) for upload transfer. Source=" << transfer->getParentPath() << transfer->getFileName();
+            char * destinyPath = api->getNodePath(node);
+            LOG_info << "Upload complete: " << path << " to " << destinyPath << newname;
+            delete []destinyPath;
         }
+        delete megaCmdTransferListener;
     }
+}
 
-    //progress
-    float percent;
-    if (transfer->getTotalBytes() == 0)
-    {
-        percent = 0;
-    }
-    else
-    {
-        percent = float(transfer->getTransferredBytes()*1.0/transfer->getTotalBytes());
-    }
-    OUTSTREAM << "  " << getFixLengthString(percentageToText(percent),7,' ',true)
-              << " of " << getFixLengthString(sizeToText(transfer->getTotalBytes()),10,' ',true);
-
-    //state
-    if (printstate)
-    {
-        OUTSTREAM << "  " << getTransferStateStr(transfer->getState());
-    }
 
-    OUTSTREAM << endl;
+bool MegaCmdExecuter::amIPro()
+{
+    std::shared_ptr<MegaAccountDetails> details = sandboxCMD->accountDetails.get(AccountDetailsCache::BASIC, api, true);
+    return details && details->getProLevel() > 0;
 }
 
-void MegaCmdExecuter::printTransferColumnDisplayer(ColumnDisplayer *cd, MegaTransfer *transfer, bool printstate)
+void MegaCmdExecuter::exportNode(MegaNode *n, int64_t expireTime, std::string password, bool force)
 {
-    //Direction
-    string type;
-#ifdef _WIN32
-    type += getutf8fromUtf16((transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)?L"\u25bc":L"\u25b2");
-#else
-    type += (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)?"\u21d3":"\u21d1";
-#endif
-    //TODO: handle TYPE_LOCAL_TCP_DOWNLOAD
+    bool copyrightAccepted = false;
 
-    //type (transfer/normal)
-    if (transfer->isSyncTransfer())
-    {
-#ifdef _WIN32
-        type += getutf8fromUtf16(L"\u21a8");
-#else
-        type += "\u21f5";
-#endif
-    }
-#ifdef ENABLE_BACKUPS
-    else if (transfer->isBackupTransfer())
+    copyrightAccepted = ConfigurationManager::getConfigurationValue("copyrightAccepted", false) || force;
+    if (!copyrightAccepted)
     {
-#ifdef _WIN32
-        type += getutf8fromUtf16(L"\u2191");
-#else
-        type += "\u23eb";
-#endif
+        MegaNodeList * mnl = api->getPublicLinks();
+        copyrightAccepted = mnl->size();
+        delete mnl;
     }
-#endif
 
-    cd->addValue("TYPE",type);
-    cd->addValue("TAG", SSTR(transfer->getTag())); //TODO: do SSTR within ColumnDisplayer
-
-    if (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)
+    int confirmationResponse = copyrightAccepted?MCMDCONFIRM_YES:MCMDCONFIRM_NO;
+    if (!copyrightAccepted)
     {
-        // source
-        MegaNode * node = api->getNodeByHandle(transfer->getNodeHandle());
-        if (node)
-        {
-            char * nodepath = api->getNodePath(node);
-            cd->addValue("SOURCEPATH",nodepath);
-            delete []nodepath;
+        string confirmationQuery("MEGA respects the copyrights of others and requires that users of the MEGA cloud service comply with the laws of copyright.\n"
+                                 "You are strictly prohibited from using the MEGA cloud service to infringe copyrights.\n"
+                                 "You may not upload, download, store, share, display, stream, distribute, email, link to, "
+                                 "transmit or otherwise make available any files, data or content that infringes any copyright "
+                                 "or other proprietary rights of any person or entity.");
 
-            delete node;
-        }
-        else
-        {
-            globalTransferListener->completedTransfersMutex.lock();
-            cd->addValue("SOURCEPATH",globalTransferListener->completedPathsByHandle[transfer->getNodeHandle()]);
-            globalTransferListener->completedTransfersMutex.unlock();
-        }
+        confirmationQuery+=" Do you accept this terms? (Yes/No): ";
 
-        //destination
-        string dest = transfer->getParentPath() ? transfer->getParentPath() : "";
-        dest.append(transfer->getFileName());
-        cd->addValue("DESTINYPATH",dest);
+        confirmationResponse = askforConfirmation(confirmationQuery);
     }
-    else
-    {
-        //source
-        string source(transfer->getParentPath()?transfer->getParentPath():"");
-        source.append(transfer->getFileName());
-
-        cd->addValue("SOURCEPATH",source);
-
-        //destination
-        MegaNode * parentNode = api->getNodeByHandle(transfer->getParentHandle());
-        if (parentNode)
-        {
-            char * parentnodepath = api->getNodePath(parentNode);
-            cd->addValue("DESTINYPATH",parentnodepath);
-            delete []parentnodepath;
 
-            delete parentNode;
-        }
-        else
+    if (confirmationResponse == MCMDCONFIRM_YES || confirmationResponse == MCMDCONFIRM_ALL)
+    {
+        ConfigurationManager::savePropertyValue("copyrightAccepted",true);
+        MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
+        api->exportNode(n, expireTime, megaCmdListener);
+        megaCmdListener->wait();
+        if (checkNoErrors(megaCmdListener->getError(), "export node"))
         {
-            cd->addValue("DESTINYPATH","---------");
+            MegaNode *nexported = api->getNodeByHandle(megaCmdListener->getRequest()->getNodeHandle());
+            if (nexported)
+            {
+                char *nodepath = api->getNodePath(nexported);
+                char *publiclink = nexported->getPublicLink();
+                string publicPassProtectedLink = string();
 
-            LOG_warn << "Could not find destination (parent handle "<< ((transfer->getParentHandle()==INVALID_HANDLE)?" invalid":" valid")
-                     <<" ) for upload transfer. Source=" << transfer->getParentPath() << transfer->getFileName();
-        }
-    }
+                if (amIPro() && password.size() )
+                {
+                    MegaCmdListener *megaCmdListener2 = new MegaCmdListener(api, NULL);
+                    api->encryptLinkWithPassword(publiclink, password.c_str(), megaCmdListener2);
+                    megaCmdListener2->wait();
+                    if (checkNoErrors(megaCmdListener2->getError(), "protect public link with password"))
+                    {
+                        publicPassProtectedLink = megaCmdListener2->getRequest()->getText();
+                    }
+                    delete megaCmdListener2;
+                }
+                else if (password.size())
+                {
+                    LOG_err << "Only PRO users can protect links with passwords. Showing UNPROTECTED link";
+                }
 
-    //progress
-    float percent;
-    if (transfer->getTotalBytes() == 0)
-    {
-        percent = 0;
-    }
-    else
-    {
-        percent = float(transfer->getTransferredBytes()*1.0/transfer->getTotalBytes());
-    }
+                OUTSTREAM << "Exported " << nodepath << ": "
+                          << (publicPassProtectedLink.size()?publicPassProtectedLink:publiclink);
 
-    stringstream osspercent;
-    osspercent << percentageToText(percent) << " of " << getFixLengthString(sizeToText(transfer->getTotalBytes()),10,' ',true);
-    cd->addValue("PROGRESS",osspercent.str());
 
-    //state
-    if (printstate)
-    {
-        cd->addValue("STATE",getTransferStateStr(transfer->getState()));
+                if (nexported->getExpirationTime())
+                {
+                    OUTSTREAM << " expires at " << getReadableTime(nexported->getExpirationTime());
+                }
+                OUTSTREAM << endl;
+                delete[] nodepath;
+                delete[] publiclink;
+                delete nexported;
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Exported node not found!";
+            }
+        }
+        delete megaCmdListener;
     }
 }
 
-void MegaCmdExecuter::printSyncHeader(const unsigned int PATHSIZE, ColumnDisplayer *cd)
+void MegaCmdExecuter::disableExport(MegaNode *n)
 {
-    if (cd)
+    if (!n->isExported())
     {
-        cd->addHeader("LOCALPATH", false);
-        cd->addHeader("REMOTEPATH", false);
+        setCurrentOutCode(MCMD_INVALIDSTATE);
+        LOG_err << "Could not disable export: node not exported.";
         return;
     }
-    OUTSTREAM << "ID ";
-    OUTSTREAM << getFixLengthString("LOCALPATH ", PATHSIZE) << " ";
-    OUTSTREAM << getFixLengthString("REMOTEPATH ", PATHSIZE) << " ";
-
-    OUTSTREAM << getFixLengthString("ActState", 10) << " ";
-    OUTSTREAM << getFixLengthString("SyncState", 9) << " ";
-    OUTSTREAM << getRightAlignedString("SIZE", 8) << " ";
-    OUTSTREAM << getRightAlignedString("FILES", 6) << " ";
-    OUTSTREAM << getRightAlignedString("DIRS", 6);
-    OUTSTREAM << endl;
-}
+    MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
 
-#ifdef ENABLE_BACKUPS
+    api->disableExport(n, megaCmdListener);
+    megaCmdListener->wait();
+    if (checkNoErrors(megaCmdListener->getError(), "disable export"))
+    {
+        MegaNode *nexported = api->getNodeByHandle(megaCmdListener->getRequest()->getNodeHandle());
+        if (nexported)
+        {
+            char *nodepath = api->getNodePath(nexported);
+            OUTSTREAM << "Disabled export: " << nodepath << endl;
+            delete[] nodepath;
+            delete nexported;
+        }
+        else
+        {
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << "Exported node not found!";
+        }
+    }
 
-void MegaCmdExecuter::printBackupHeader(const unsigned int PATHSIZE)
-{
-    OUTSTREAM << "TAG  " << " ";
-    OUTSTREAM << getFixLengthString("LOCALPATH ", PATHSIZE) << " ";
-    OUTSTREAM << getFixLengthString("REMOTEPARENTPATH ", PATHSIZE) << " ";
-    OUTSTREAM << getRightAlignedString("STATUS", 14);
-    OUTSTREAM << endl;
+    delete megaCmdListener;
 }
 
-
-void MegaCmdExecuter::printBackupSummary(int tag, const char * localfolder, const char *remoteparentfolder, string status, const unsigned int PATHSIZE)
+void MegaCmdExecuter::shareNode(MegaNode *n, string with, int level)
 {
-    OUTSTREAM << getFixLengthString(SSTR(tag),5) << " "
-              << getFixLengthString(localfolder, PATHSIZE) << " "
-              << getFixLengthString((remoteparentfolder?remoteparentfolder:"INVALIDPATH"), PATHSIZE) << " "
-              << getRightAlignedString(status, 14)
-              << endl;
-}
+    MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
 
-void MegaCmdExecuter::printBackupDetails(MegaBackup *backup, const char *timeFormat)
-{
-    if (backup)
+    api->share(n, with.c_str(), level, megaCmdListener);
+    megaCmdListener->wait();
+    if (checkNoErrors(megaCmdListener->getError(), ( level != MegaShare::ACCESS_UNKNOWN ) ? "share node" : "disable share"))
     {
-        string speriod = (backup->getPeriod() == -1)?backup->getPeriodString():getReadablePeriod(backup->getPeriod()/10);
-        OUTSTREAM << "  Max Backups:   " << backup->getMaxBackups() << endl;
-        OUTSTREAM << "  Period:         " << "\"" << speriod << "\"" << endl;
-        OUTSTREAM << "  Next backup scheduled for: " << getReadableTime(backup->getNextStartTime(), timeFormat);
-
-        OUTSTREAM << endl;
-        OUTSTREAM << "  " << " -- CURRENT/LAST BACKUP --" << endl;
-        OUTSTREAM << "  " << getFixLengthString("FILES UP/TOT", 15);
-        OUTSTREAM << "  " << getFixLengthString("FOLDERS CREATED", 15);
-        OUTSTREAM << "  " << getRightAlignedString("PROGRESS     ", 22);
-
-        MegaTransferList * ml = backup->getFailedTransfers();
-        if (ml && ml->size())
+        MegaNode *nshared = api->getNodeByHandle(megaCmdListener->getRequest()->getNodeHandle());
+        if (nshared)
         {
-            OUTSTREAM << "  " << getRightAlignedString("FAILED TRANSFERS", 17);
+            char *nodepath = api->getNodePath(nshared);
+            if (megaCmdListener->getRequest()->getAccess() == MegaShare::ACCESS_UNKNOWN)
+            {
+                OUTSTREAM << "Stopped sharing " << nodepath << " with " << megaCmdListener->getRequest()->getEmail() << endl;
+            }
+            else
+            {
+                OUTSTREAM << "Shared " << nodepath << " : " << megaCmdListener->getRequest()->getEmail()
+                          << " accessLevel=" << megaCmdListener->getRequest()->getAccess() << endl;
+            }
+            delete[] nodepath;
+            delete nshared;
         }
-        OUTSTREAM << endl;
-
-        string sfiles = SSTR(backup->getNumberFiles()) + "/" + SSTR(backup->getTotalFiles());
-        OUTSTREAM << "  " << getRightAlignedString(sfiles, 8) << "       ";
-        OUTSTREAM << "  " << getRightAlignedString(SSTR(backup->getNumberFolders()), 8) << "       ";
-        long long trabytes = backup->getTransferredBytes();
-        long long totbytes = backup->getTotalBytes();
-        double percent = totbytes?double(trabytes)/double(totbytes):0;
-
-        string sprogress = sizeProgressToText(trabytes, totbytes) + "  " + percentageToText(float(percent));
-        OUTSTREAM << "  " << getRightAlignedString(sprogress,22);
-        if (ml && ml->size())
+        else
         {
-            OUTSTREAM << getRightAlignedString(SSTR(backup->getFailedTransfers()->size()), 17);
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << "Shared node not found!";
         }
-        delete ml;
-        OUTSTREAM << endl;
     }
+
+    delete megaCmdListener;
 }
 
-void MegaCmdExecuter::printBackupHistory(MegaBackup *backup, const char *timeFormat, MegaNode *parentnode, const unsigned int PATHSIZE)
+void MegaCmdExecuter::disableShare(MegaNode *n, string with)
 {
-    bool firstinhistory = true;
-    MegaStringList *msl = api->getBackupFolders(backup->getTag());
-    if (msl)
+    shareNode(n, with, MegaShare::ACCESS_UNKNOWN);
+}
+
+int MegaCmdExecuter::makedir(string remotepath, bool recursive, MegaNode *parentnode)
+{
+    MegaNode *currentnode;
+    if (parentnode)
     {
-        for (int i = 0; i < msl->size(); i++)
+        currentnode = parentnode;
+    }
+    else
+    {
+        currentnode = api->getNodeByHandle(cwd);
+    }
+    if (currentnode)
+    {
+        string rest = remotepath;
+        while (rest.length())
         {
-            int datelength = getReadableTime(m_time(), timeFormat).size();
-
-            if (firstinhistory)
-            {
-                OUTSTREAM << "  " << " -- SAVED BACKUPS --" << endl;
-
-                // print header
-                OUTSTREAM << "  " << getFixLengthString("NAME", PATHSIZE) << " ";
-                OUTSTREAM << getFixLengthString("DATE", datelength+1) << " ";
-                OUTSTREAM << getRightAlignedString("STATUS", 11)<< " ";
-                OUTSTREAM << getRightAlignedString("FILES", 6)<< " ";
-                OUTSTREAM << getRightAlignedString("FOLDERS", 7);
-                OUTSTREAM << endl;
-
-                firstinhistory = false;
-            }
-
-            string bpath = msl->get(i);
-            size_t pos = bpath.find("_bk_");
-            string btime = "";
-            if (pos != string::npos)
+            bool lastleave = false;
+            size_t possep = rest.find_first_of("/");
+            if (possep == string::npos)
             {
-                btime = bpath.substr(pos+4);
+                possep = rest.length();
+                lastleave = true;
             }
 
-            pos = bpath.find_last_of("/\\");
-            string backupInstanceName = bpath;
-            if (pos != string::npos)
+            string newfoldername = rest.substr(0, possep);
+            if (!rest.length())
             {
-                backupInstanceName = bpath.substr(pos+1);
+                break;
             }
-
-            string printableDate = "UNKNOWN";
-            if (btime.size())
+            if (newfoldername.length())
             {
-                struct tm dt;
-                fillStructWithSYYmdHMS(btime,dt);
-                printableDate = getReadableTime(m_mktime(&dt), timeFormat);
-            }
-
-            string backupInstanceStatus="NOT_FOUND";
-            long long nfiles = 0;
-            long long nfolders = 0;
-            if (parentnode)
-            {
-                MegaNode *backupInstanceNode = nodebypath(msl->get(i));
-                if (backupInstanceNode)
+                MegaNode *existing_node = api->getChildNode(currentnode, newfoldername.c_str());
+                if (!existing_node)
                 {
-                    backupInstanceStatus = backupInstanceNode->getCustomAttr("BACKST");
-
-                    getNumFolderFiles(backupInstanceNode, api, &nfiles, &nfolders);
-
+                    if (!recursive && !lastleave)
+                    {
+                        LOG_err << "Use -p to create folders recursively";
+                        if (currentnode != parentnode)
+                            delete currentnode;
+                        return MCMD_EARGS;
+                    }
+                    LOG_verbose << "Creating (sub)folder: " << newfoldername;
+                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                    api->createFolder(newfoldername.c_str(), currentnode, megaCmdListener);
+                    actUponCreateFolder(megaCmdListener);
+                    delete megaCmdListener;
+                    MegaNode *prevcurrentNode = currentnode;
+                    currentnode = api->getChildNode(currentnode, newfoldername.c_str());
+                    if (prevcurrentNode != parentnode)
+                        delete prevcurrentNode;
+                    if (!currentnode)
+                    {
+                        LOG_err << "Couldn't get node for created subfolder: " << newfoldername;
+                        if (currentnode != parentnode)
+                            delete currentnode;
+                        return MCMD_INVALIDSTATE;
+                    }
+                }
+                else
+                {
+                    if (currentnode != parentnode)
+                        delete currentnode;
+                    currentnode = existing_node;
                 }
 
-                delete backupInstanceNode;
+                if (lastleave && existing_node)
+                {
+                    LOG_err << ((existing_node->getType() == MegaNode::TYPE_FILE)?"File":"Folder") << " already exists: " << remotepath;
+                    if (currentnode != parentnode)
+                        delete currentnode;
+                    return MCMD_INVALIDSTATE;
+                }
             }
 
-            OUTSTREAM << "  " << getFixLengthString(backupInstanceName, PATHSIZE) << " ";
-            OUTSTREAM << getFixLengthString(printableDate, datelength+1) << " ";
-            OUTSTREAM << getRightAlignedString(backupInstanceStatus, 11) << " ";
-            OUTSTREAM << getRightAlignedString(SSTR(nfiles), 6)<< " ";
-            OUTSTREAM << getRightAlignedString(SSTR(nfolders), 7);
-            //OUTSTREAM << getRightAlignedString("PROGRESS", 10);// some info regarding progress or the like in case of failure could be interesting. Although we don't know total files/folders/bytes
-            OUTSTREAM << endl;
-
+            //string rest = rest.substr(possep+1,rest.length()-possep-1);
+            if (!lastleave)
+            {
+                rest = rest.substr(possep + 1, rest.length());
+            }
+            else
+            {
+                break;
+            }
         }
-        delete msl;
+        if (currentnode != parentnode)
+            delete currentnode;
+    }
+    else
+    {
+        return MCMD_EARGS;
     }
+    return MCMD_OK;
+
 }
 
-void MegaCmdExecuter::printBackup(int tag, MegaBackup *backup, const char *timeFormat, const unsigned int PATHSIZE, bool extendedinfo, bool showhistory, MegaNode *parentnode)
+/**
+ * @brief Removes the empty components of a path ("a//b/" -> "a/b")
+ */
+static string normalizeFolderPath(const string &path)
 {
-    if (backup)
+    string normalized;
+    size_t start = 0;
+    while (start < path.size())
     {
-        const char *nodepath = NULL;
-        bool deleteparentnode = false;
-
-        if (!parentnode)
+        size_t possep = path.find('/', start);
+        if (possep == string::npos)
         {
-            parentnode = api->getNodeByHandle(backup->getMegaHandle());
-            if (parentnode)
+            possep = path.size();
+        }
+        if (possep > start)
+        {
+            if (normalized.size())
             {
-                nodepath = api->getNodePath(parentnode);
-                deleteparentnode = true;
+                normalized += "/";
             }
+            normalized += path.substr(start, possep - start);
         }
-        else
+        start = possep + 1;
+    }
+    return normalized;
+}
+
+/**
+ * @brief Creates the folders in paths (relative to parent, separated by '/') that do not exist yet.
+ *
+ * Common prefixes are resolved only once, and folders are created level by level: all the folders of
+ * the same depth are requested at once, keeping up to "mkdir_window" requests in flight.
+ *
+ * @param created if not NULL, the paths of the folders that had to be created are inserted into it
+ * @return the handles of the folders in paths and of all their ancestors, indexed by their path
+ * (without empty components). Those that could not be created, or that are files, are missing.
+ */
+map<string, MegaHandle> MegaCmdExecuter::materializeFolders(MegaNode *parent, const vector<string> &paths, set<string> *created)
+{
+    size_t window = size_t(std::max(1, ConfigurationManager::getConfigurationValue("mkdir_window", 32)));
+
+    // levels[d] holds the paths of d+1 components: shared prefixes are only there once
+    vector<set<string> > levels;
+    for (auto &path : paths)
+    {
+        string normalized = normalizeFolderPath(path);
+        size_t depth = 0;
+        for (size_t possep = 0; possep != string::npos && normalized.size(); depth++)
         {
-            nodepath = api->getNodePath(parentnode);
+            possep = normalized.find('/', possep ? possep + 1 : 0);
+            if (levels.size() <= depth)
+            {
+                levels.resize(depth + 1);
+            }
+            levels[depth].insert(normalized.substr(0, possep));
         }
+    }
 
-        printBackupSummary(tag, backup->getLocalFolder(),nodepath,backupSatetStr(backup->getState()), PATHSIZE);
-        if (extendedinfo)
+    map<string, MegaHandle> handles {{"", parent->getHandle()}};
+    for (auto &level : levels)
+    {
+        std::deque<pair<const string *, std::unique_ptr<MegaCmdListener> > > inflight;
+
+        auto waitOldest = [&]()
         {
-            printBackupDetails(backup, timeFormat);
-        }
-        delete []nodepath;
+            const string &path = *inflight.front().first;
+            MegaCmdListener *megaCmdListener = inflight.front().second.get();
+            megaCmdListener->wait();
+            if (checkNoErrors(megaCmdListener->getError(), "create folder " + path))
+            {
+                handles[path] = megaCmdListener->getRequest()->getNodeHandle();
+                if (created)
+                {
+                    created->insert(path);
+                }
+            }
+            inflight.pop_front();
+        };
 
-        if (showhistory && parentnode)
+        for (auto &path : level)
         {
-            printBackupHistory(backup, timeFormat, parentnode, PATHSIZE);
-        }
+            size_t possep = path.find_last_of('/');
+            string parentPath = (possep == string::npos) ? "" : path.substr(0, possep);
+            string name = (possep == string::npos) ? path : path.substr(possep + 1);
 
-        if (deleteparentnode)
+            auto parentHandle = handles.find(parentPath);
+            std::unique_ptr<MegaNode> parentNode {(parentHandle != handles.end()) ? api->getNodeByHandle(parentHandle->second) : NULL};
+            if (!parentNode)
+            {
+                continue; // its parent could not be created
+            }
+
+            std::unique_ptr<MegaNode> existing {api->getChildNode(parentNode.get(), name.c_str())};
+            if (existing)
+            {
+                if (existing->getType() == MegaNode::TYPE_FILE)
+                {
+                    LOG_err << "File already exists: " << path;
+                }
+                else
+                {
+                    handles[path] = existing->getHandle();
+                }
+                continue;
+            }
+
+            if (inflight.size() >= window)
+            {
+                waitOldest();
+            }
+            LOG_verbose << "Creating (sub)folder: " << path;
+            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+            api->createFolder(name.c_str(), parentNode.get(), megaCmdListener);
+            inflight.push_back(std::make_pair(&path, std::unique_ptr<MegaCmdListener>(megaCmdListener)));
+        }
+        while (!inflight.empty())
         {
-            delete parentnode;
+            waitOldest();
         }
     }
-    else
+
+    handles.erase("");
+    return handles;
+}
+
+
+string MegaCmdExecuter::getCurrentPath()
+{
+    string toret;
+    MegaNode *ncwd = api->getNodeByHandle(cwd);
+    if (ncwd)
     {
-        OUTSTREAM << "BACKUP not found " << endl;
+        toret = sandboxCMD->nodePathCache.getNodePath(api, ncwd);
+        delete ncwd;
     }
+    return toret;
 }
 
-void MegaCmdExecuter::printBackup(backup_struct *backupstruct, const char *timeFormat, const unsigned int PATHSIZE, bool extendedinfo, bool showhistory)
+long long MegaCmdExecuter::getVersionsSize(MegaNode *n)
 {
-    if (backupstruct->tag >= 0)
+    long long toret = 0;
+    scanVersions(n, [&toret](const FolderVersionsReport &report)
     {
-        MegaBackup *backup = api->getBackupByTag(backupstruct->tag);
-        if (backup)
+        toret += report.currentSize + report.reclaimableSize;
+    });
+    return toret;
+}
+
+/**
+ * @brief Visits the folders of the tree under n (n included) with a pool of threads, that take
+ * folders from a shared queue and queue their subfolders.
+ *
+ * visitFolder is called from those threads, with the children of each folder.
+ * onFolderVisited (if any) is called from the calling thread after folders are visited,
+ * so that it can output to the petition while the walk goes on.
+ * descendInto (if any) is called after visiting a folder, to choose which of its subfolders are walked.
+ */
+void MegaCmdExecuter::walkTreeInParallel(MegaNode *n, int parallelism, std::function<void(MegaNode *, MegaNodeList *)> visitFolder,
+                                         std::function<void()> onFolderVisited, std::function<bool(MegaNode *)> descendInto)
+{
+    std::mutex walkMutex;
+    std::condition_variable walkCV;
+    std::deque<MegaHandle> pendingFolders {n->getHandle()};
+    int busyWalkers = 0;
+    int runningWalkers = std::max(1, parallelism);
+    bool folderVisited = false;
+
+    auto walker = [&]()
+    {
+        std::unique_lock<std::mutex> lock(walkMutex);
+        for (;;)
         {
-            printBackup(backupstruct->tag, backup, timeFormat, PATHSIZE, extendedinfo, showhistory);
-            delete backup;
+            walkCV.wait(lock, [&]() { return !pendingFolders.empty() || !busyWalkers; });
+            if (pendingFolders.empty())
+            {
+                break; // no folder pending nor any walker that could find more
+            }
+            MegaHandle h = pendingFolders.front();
+            pendingFolders.pop_front();
+            busyWalkers++;
+            lock.unlock();
+
+            std::unique_ptr<MegaNode> folder {api->getNodeByHandle(h)};
+            std::unique_ptr<MegaNodeList> children {folder ? api->getChildren(folder.get()) : NULL};
+            if (folder)
+            {
+                visitFolder(folder.get(), children.get());
+            }
+
+            vector<MegaHandle> subfolders;
+            for (int i = 0; children && i < children->size(); i++)
+            {
+                MegaNode *child = children->get(i);
+                if (child->getType() != MegaNode::TYPE_FILE && (!descendInto || descendInto(child)))
+                {
+                    subfolders.push_back(child->getHandle());
+                }
+            }
+
+            lock.lock();
+            busyWalkers--;
+            pendingFolders.insert(pendingFolders.end(), subfolders.begin(), subfolders.end());
+            folderVisited = true;
+            walkCV.notify_all();
         }
-        else
+    };
+
+    vector<std::thread> walkers;
+    for (int i = runningWalkers; i--; )
+    {
+        walkers.emplace_back([&]()
         {
-            OUTSTREAM << "BACKUP not found: " << backupstruct->tag << endl;
-        }
+            walker();
+            std::lock_guard<std::mutex> g(walkMutex);
+            runningWalkers--;
+            walkCV.notify_all();
+        });
     }
-    else
-    { //merely print configuration
-        printBackupSummary(backupstruct->tag, backupstruct->localpath.c_str(),"UNKOWN"," FAILED", PATHSIZE);
-        if (extendedinfo)
+
+    {
+        std::unique_lock<std::mutex> lock(walkMutex);
+        for (;;)
         {
-            string speriod = (backupstruct->period == -1)?backupstruct->speriod:getReadablePeriod(backupstruct->period/10);
-            OUTSTREAM << "         Period: " << "\"" << speriod << "\"" << endl;
-            OUTSTREAM << "   Max. Backups: " << backupstruct->numBackups << endl;
+            walkCV.wait(lock, [&]() { return folderVisited || !runningWalkers; });
+            if (folderVisited)
+            {
+                folderVisited = false;
+                lock.unlock();
+                if (onFolderVisited)
+                {
+                    onFolderVisited();
+                }
+                lock.lock();
+            }
+            else
+            {
+                break;
+            }
         }
     }
+
+    for (auto &t : walkers)
+    {
+        t.join();
+    }
 }
-#endif
 
-void MegaCmdExecuter::printSync(int i, string key, const char *nodepath, sync_struct * thesync, MegaNode *n, long long nfiles, long long nfolders, const unsigned int PATHSIZE, megacmd::ColumnDisplayer *cd)
+/**
+ * @brief Walks the tree under n looking for the previous versions of its files.
+ *
+ * Folders are scanned in parallel (see "versions_scan_parallelism"), while onFolderScanned
+ * is called from the calling thread as soon as each folder is done. Reports are not sorted.
+ *
+ * @param versionsFound if not NULL, the handles and sizes of the previous versions are appended to it
+ */
+void MegaCmdExecuter::scanVersions(MegaNode *n, std::function<void(const FolderVersionsReport &)> onFolderScanned, vector<pair<MegaHandle, long long> > *versionsFound)
 {
-    if (cd)
+    auto scanFile = [this](MegaNode *file, FolderVersionsReport &report, vector<pair<MegaHandle, long long> > *versions)
     {
-        cd->addValue("ID", SSTR(i));
-        cd->addValue("LOCALPATH", key);
-        cd->addValue("REMOTEPATH", nodepath);
-
-        string sstate(key);
-        sstate = rtrim(sstate, '/');
-    #ifdef _WIN32
-        sstate = rtrim(sstate, '\\');
-    #endif
-        string psstate;
-        fsAccessCMD->path2local(&sstate,&psstate);
-        int statepath = api->syncPathState(&psstate);
-
-        MegaSync *msync = api->getSyncByNode(n);
-        string syncstate = "REMOVED";
-        if (msync)
-        {
-            syncstate = getSyncStateStr(msync->getState());
-        }
-
-        string statetoprint;
-        if (thesync->active)
+        report.currentSize += file->getSize();
+        if (api->getNumVersions(file) < 2)
         {
-            statetoprint = syncstate;
+            return;
         }
-        else
+        std::unique_ptr<MegaNodeList> versionNodes {api->getVersions(file)};
+        for (int i = 0; versionNodes && i < versionNodes->size(); i++)
         {
-            if (msync)
-            {
-                statetoprint = "Disabling:";
-                statetoprint+=syncstate;
-            }
-            else
+            MegaNode *versionNode = versionNodes->get(i);
+            if (versionNode->getHandle() != file->getHandle())
             {
-                statetoprint = "Disabled";
+                report.reclaimableSize += versionNode->getSize();
+                report.nversions++;
+                if (versions)
+                {
+                    versions->push_back(std::make_pair(versionNode->getHandle(), versionNode->getSize()));
+                }
             }
         }
-        delete msync;
-        cd->addValue("ActState", statetoprint);
-        cd->addValue("SyncState", getSyncPathStateStr(statepath));
-        cd->addValue("SIZE", sizeToText(api->getSize(n)));
-        cd->addValue("FILES", SSTR(nfiles));
-        cd->addValue("DIRS", SSTR(nfolders));
+    };
 
+    if (n->getType() == MegaNode::TYPE_FILE)
+    {
+        FolderVersionsReport report;
+        report.folder = n->getHandle();
+        scanFile(n, report, versionsFound);
+        onFolderScanned(report);
         return;
     }
 
-    //tag
-    OUTSTREAM << getRightAlignedString(SSTR(i),2) << " ";
-
-    OUTSTREAM << getFixLengthString(key,PATHSIZE) << " ";
+    std::mutex reportsMutex;
+    std::deque<FolderVersionsReport> reports;
 
-    OUTSTREAM << getFixLengthString(nodepath,PATHSIZE) << " ";
+    walkTreeInParallel(n, ConfigurationManager::getConfigurationValue("versions_scan_parallelism", 8), [&](MegaNode *folder, MegaNodeList *children)
+    {
+        FolderVersionsReport report;
+        report.folder = folder->getHandle();
+        vector<pair<MegaHandle, long long> > versions;
+        for (int i = 0; children && i < children->size(); i++)
+        {
+            if (children->get(i)->getType() == MegaNode::TYPE_FILE)
+            {
+                scanFile(children->get(i), report, versionsFound ? &versions : NULL);
+            }
+        }
 
-    string sstate(key);
-    sstate = rtrim(sstate, '/');
-#ifdef _WIN32
-    sstate = rtrim(sstate, '\\');
-#endif
-    string psstate;
-    fsAccessCMD->path2local(&sstate,&psstate);
-    int statepath = api->syncPathState(&psstate);
-
-    MegaSync *msync = api->getSyncByNode(n);
-    string syncstate = "REMOVED";
-    if (msync)
+        std::lock_guard<std::mutex> g(reportsMutex);
+        if (versionsFound)
+        {
+            versionsFound->insert(versionsFound->end(), versions.begin(), versions.end());
+        }
+        reports.push_back(report);
+    }, [&]()
     {
-        syncstate = getSyncStateStr(msync->getState());
-    }
+        std::deque<FolderVersionsReport> ready;
+        {
+            std::lock_guard<std::mutex> g(reportsMutex);
+            ready.swap(reports);
+        }
+        for (auto &report : ready)
+        {
+            onFolderScanned(report);
+        }
+    });
+}
 
-    string statetoprint;
-    if (thesync->active)
+/**
+ * @brief Removes versions keeping a window of requests in flight (see "versions_removal_window"),
+ * informing the client of the progress in bytes
+ * @return the number of versions that could not be removed
+ */
+int MegaCmdExecuter::removeVersions(const vector<pair<MegaHandle, long long> > &versions, int clientID)
+{
+    size_t window = size_t(std::max(1, ConfigurationManager::getConfigurationValue("versions_removal_window", 16)));
+
+    long long totalSize = 0;
+    for (auto &v : versions)
     {
-        statetoprint = syncstate;
+        totalSize += v.second;
     }
-    else
+
+    std::deque<pair<const pair<MegaHandle, long long> *, std::unique_ptr<MegaCmdListener> > > inflight;
+    long long removedSize = 0;
+    int failed = 0;
+
+    auto waitOldest = [&]()
     {
-        if (msync)
+        const pair<MegaHandle, long long> *version = inflight.front().first;
+        MegaCmdListener *megaCmdListener = inflight.front().second.get();
+        megaCmdListener->wait();
+        std::unique_ptr<char []> handle {api->handleToBase64(version->first)};
+        if (megaCmdListener->getError()->getErrorCode() == MegaError::API_OK)
         {
-            statetoprint = "Disabling:";
-            statetoprint+=syncstate;
+            LOG_verbose << " Removed version " << handle.get();
         }
         else
         {
-            statetoprint = "Disabled";
+            LOG_err << "Failed to remove version " << handle.get() << ": " << megaCmdListener->getError()->getErrorString();
+            failed++;
         }
-    }
-    delete msync;
-
-    OUTSTREAM << getFixLengthString(statetoprint,10) << " ";
-    OUTSTREAM << getFixLengthString(getSyncPathStateStr(statepath),9) << " ";
-
-    OUTSTREAM << getRightAlignedString(sizeToText(api->getSize(n), false),8) << " ";
+        removedSize += version->second;
+        informProgressUpdate(removedSize, totalSize, clientID, "Deleting versions");
+        inflight.pop_front();
+    };
 
-    OUTSTREAM << getRightAlignedString(SSTR(nfiles),6) << " ";
-    OUTSTREAM << getRightAlignedString(SSTR(nfolders),6) << " ";
+    for (auto &v : versions)
+    {
+        if (inflight.size() >= window)
+        {
+            waitOldest();
+        }
 
-    OUTSTREAM << endl;
+        std::unique_ptr<MegaNode> versionNode {api->getNodeByHandle(v.first)};
+        if (!versionNode) // already gone
+        {
+            removedSize += v.second;
+            continue;
+        }
+        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+        api->removeVersion(versionNode.get(), megaCmdListener);
+        inflight.push_back(std::make_pair(&v, std::unique_ptr<MegaCmdListener>(megaCmdListener)));
+    }
+    while (!inflight.empty())
+    {
+        waitOldest();
+    }
 
+    informProgressUpdate(PROGRESS_COMPLETE, totalSize, clientID, "Deleting versions");
+    return failed;
 }
 
-void MegaCmdExecuter::doFind(MegaNode* nodeBase, const char *timeFormat, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions, string word, int printfileinfo, string pattern, bool usepcre, m_time_t minTime, m_time_t maxTime, int64_t minSize, int64_t maxSize)
+/**
+ * @brief Tells whether the CRCs of the fingerprints (sampled from the contents) of a local file and a remote one match
+ */
+bool MegaCmdExecuter::sameContents(const string &localPath, const LocalFingerprintKey &key, MegaNode *remote)
 {
-    struct criteriaNodeVector pnv;
-    pnv.pattern = pattern;
-
-    vector<MegaNode *> listOfMatches;
-    pnv.nodesMatching = &listOfMatches;
-    pnv.usepcre = usepcre;
+    // fingerprints include the modification time: only their CRC part is compared
+    string fingerprint;
+    if (!key.inode || !fingerprintCache.getFingerprint(localPath, key, &fingerprint))
+    {
+        std::unique_ptr<char[]> newfingerprint(api->getFingerprint(localPath.c_str()));
+        if (!newfingerprint)
+        {
+            return false;
+        }
+        fingerprint = newfingerprint.get();
+        if (key.inode)
+        {
+            fingerprintCache.setFingerprint(localPath, key, newfingerprint.get());
+        }
+    }
 
-    pnv.minTime = minTime;
-    pnv.maxTime = maxTime;
-    pnv.minSize = minSize;
-    pnv.maxSize = maxSize;
+    std::unique_ptr<char[]> localCRC(api->getCRCFromFingerprint(fingerprint.c_str()));
+    std::unique_ptr<char[]> remoteCRC(api->getCRC(remote));
+    return localCRC && remoteCRC && !strcmp(localCRC.get(), remoteCRC.get());
+}
 
+/**
+ * @brief Compares the entries of a local folder with the children of its remote counterpart, matching them by name.
+ *
+ * Files differ when their sizes do. Otherwise, the CRCs of their fingerprints are compared when their modification
+ * times differ (or always, with checkFingerprints). Local fingerprints are taken from fingerprintCache when possible.
+ * Entries only present at one side are not walked: they are reported as a whole.
+ *
+ * @param subfolders the handle, local path and relative path of the subfolders present at both sides
+ */
+void MegaCmdExecuter::diffFolder(const string &localFolder, const string &relativePath, MegaNodeList *children, bool checkFingerprints,
+                                 MegaFileSystemAccess *fsAccess, vector<DiffRecord> *records,
+                                 vector<pair<MegaHandle, pair<string, string> > > *subfolders)
+{
+#ifdef MEGACMDEXECUTER_FILESYSTEM
+    multimap<string, MegaNode *> remoteEntries; // same-name siblings are kept: all but one will be reported as removed
+    for (int i = 0; children && i < children->size(); i++)
+    {
+        remoteEntries.insert(std::make_pair(string(children->get(i)->getName()), children->get(i)));
+    }
 
-    processTree(nodeBase, includeIfMatchesCriteria, (void*)&pnv);
+    map<string, pair<fs::path, bool> > localEntries; // name -> path and whether it is a folder
+    std::error_code ec;
+    for (fs::directory_iterator iter(fs::u8path(localFolder), ec); !ec && iter != fs::directory_iterator(); iter.increment(ec))
+    {
+        fs::file_status status = iter->symlink_status();
+        if (fs::is_regular_file(status) || fs::is_directory(status))
+        {
+            localEntries[iter->path().filename().u8string()] = std::make_pair(iter->path(), fs::is_directory(status));
+        }
+    }
+    if (ec)
+    {
+        LOG_warn << "Could not list local folder " << localFolder << ": " << ec.message();
+        return;
+    }
 
+    auto report = [records, &relativePath](DiffRecord::Status status, const string &name, bool isFolder, long long localSize, long long remoteSize)
+    {
+        DiffRecord record;
+        record.status = status;
+        record.path = relativePath + name + (isFolder ? "/" : "");
+        record.isFolder = isFolder;
+        record.localSize = localSize;
+        record.remoteSize = remoteSize;
+        records->push_back(record);
+    };
 
-    for (std::vector< MegaNode * >::iterator it = listOfMatches.begin(); it != listOfMatches.end(); ++it)
+    for (auto &localEntry : localEntries)
     {
-        MegaNode * n = *it;
-        if (n)
+        string localPath = localEntry.second.first.u8string();
+        bool localIsFolder = localEntry.second.second;
+        LocalFingerprintKey key {0, -1, 0, 0};
+        if (!localIsFolder)
         {
-            string pathToShow;
-
-            if ( word.size() > 0 && ( (word.find("/") == 0) || (word.find("..") != string::npos)) )
-            {
-                char * nodepath = api->getNodePath(n);
-                pathToShow = string(nodepath);
-                delete [] nodepath;
-            }
-            else
-            {
-                pathToShow = getDisplayPath("", n);
-            }
-            if (printfileinfo)
-            {
-                dumpNode(n, timeFormat, clflags, cloptions, 3, false, 1, pathToShow.c_str());
-            }
-            else
-            {
-                OUTSTREAM << pathToShow;
+            statLocalFile(fsAccess, localPath, &key);
+        }
 
-                if (getFlag(clflags, "show-handles"))
-                {
-                    std::unique_ptr<char []> handle {api->handleToBase64(n->getHandle())};
-                    OUTSTREAM << " <H:" << handle.get() << ">";
-                }
+        auto remoteEntry = remoteEntries.find(localEntry.first);
+        if (remoteEntry == remoteEntries.end())
+        {
+            report(DiffRecord::ADDED, localEntry.first, localIsFolder, key.size, -1);
+            continue;
+        }
+        MegaNode *remote = remoteEntry->second;
+        remoteEntries.erase(remoteEntry);
 
-                OUTSTREAM << endl;
-            }
-            //notice: some nodes may be dumped twice
+        bool remoteIsFolder = remote->getType() != MegaNode::TYPE_FILE;
+        if (localIsFolder && remoteIsFolder)
+        {
+            subfolders->push_back(std::make_pair(remote->getHandle(), std::make_pair(localPath, relativePath + localEntry.first + "/")));
+            continue;
+        }
+        if (localIsFolder != remoteIsFolder || key.size != remote->getSize())
+        {
+            report(DiffRecord::CHANGED, localEntry.first, localIsFolder, key.size, remote->getSize());
+            continue;
+        }
+        if (!checkFingerprints && key.mtime == remote->getModificationTime())
+        {
+            continue;
+        }
 
-            delete n;
+        if (!sameContents(localPath, key, remote))
+        {
+            report(DiffRecord::CHANGED, localEntry.first, false, key.size, remote->getSize());
         }
     }
 
-    listOfMatches.clear();
-}
-
-string MegaCmdExecuter::getLPWD()
-{
-    string relativePath = ".";
-    string absolutePath = "Unknown";
-    LocalPath localRelativePath = LocalPath::fromPath(relativePath, *fsAccessCMD);
-    LocalPath localAbsolutePath;
-    if (fsAccessCMD->expanselocalpath(localRelativePath, localAbsolutePath))
+    for (auto &remoteEntry : remoteEntries)
     {
-        absolutePath = localAbsolutePath.toPath(*fsAccessCMD);
+        bool remoteIsFolder = remoteEntry.second->getType() != MegaNode::TYPE_FILE;
+        report(DiffRecord::REMOVED, remoteEntry.first, remoteIsFolder, -1, remoteIsFolder ? api->getSize(remoteEntry.second) : remoteEntry.second->getSize());
     }
-
-    return absolutePath;
+#endif
 }
 
-
-void MegaCmdExecuter::move(MegaNode * n, string destiny)
+void MegaCmdExecuter::getInfoFromFolder(MegaNode *n, MegaApi *api, long long *nfiles, long long *nfolders, long long *nversions)
 {
-    MegaNode* tn; //target node
-    string newname;
-
-    // source node must exist
-    if (!n)
+    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+    api->getFolderInfo(n, megaCmdListener);
+    *nfiles = 0;
+    *nfolders = 0;
+    megaCmdListener->wait();
+    if (checkNoErrors(megaCmdListener->getError(), "getting folder info"))
     {
-        return;
+        MegaFolderInfo * mfi = megaCmdListener->getRequest()->getMegaFolderInfo();
+        if (mfi)
+        {
+            *nfiles  = mfi->getNumFiles();
+            *nfolders  = mfi->getNumFolders();
+            if (nversions)
+            {
+                *nversions = mfi->getNumVersions();
+            }
+            delete mfi;
+        }
     }
+}
 
-
-    char * nodepath = api->getNodePath(n);
-    LOG_debug << "Moving : " << nodepath << " to " << destiny;
-    delete []nodepath;
-
-    // we have four situations:
-    // 1. target path does not exist - fail
-    // 2. target node exists and is folder - move
-    // 3. target node exists and is file - delete and rename (unless same)
-    // 4. target path exists, but filename does not - rename
-    if (( tn = nodebypath(destiny.c_str(), NULL, &newname)))
+vector<string> MegaCmdExecuter::listpaths(bool usepcre, string askedPath, bool discardFiles)
+{
+    vector<string> paths;
+    if ((int)askedPath.size())
     {
-        if (tn->getHandle() == n->getHandle())
-        {
-            LOG_err << "Source and destiny are the same";
-        }
-        else
+        vector<string> *pathsToList = nodesPathsbypath(askedPath.c_str(), usepcre);
+        if (pathsToList)
         {
-            if (newname.size()) //target not found, but tn has what was before the last "/" in the path.
+            for (std::vector< string >::iterator it = pathsToList->begin(); it != pathsToList->end(); ++it)
             {
-                if (tn->getType() == MegaNode::TYPE_FILE)
-                {
-                    setCurrentOutCode(MCMD_INVALIDTYPE);
-                    LOG_err << destiny << ": Not a directory";
-                    delete tn;
-                    delete n;
-                    return;
-                }
-                else //move and rename!
+                string nodepath= *it;
+                MegaNode *ncwd = api->getNodeByHandle(cwd);
+                if (ncwd)
                 {
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->moveNode(n, tn, megaCmdListener);
-                    megaCmdListener->wait();
-                    if (checkNoErrors(megaCmdListener->getError(), "move"))
+                    MegaNode * n = nodebypath(nodepath.c_str());
+                    if (n)
                     {
-                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                        api->renameNode(n, newname.c_str(), megaCmdListener);
-                        megaCmdListener->wait();
-                        checkNoErrors(megaCmdListener->getError(), "rename");
-                        delete megaCmdListener;
+                        if (n->getType() != MegaNode::TYPE_FILE)
+                        {
+                            nodepath += "/";
+                        }
+                        if (!( discardFiles && ( n->getType() == MegaNode::TYPE_FILE )))
+                        {
+                            paths.push_back(nodepath);
+                        }
+
+                        delete n;
                     }
                     else
                     {
-                        LOG_debug << "Won't rename, since move failed " << n->getName() << " to " << tn->getName() << " : " << megaCmdListener->getError()->getErrorCode();
+                        LOG_debug << "Unexpected: matching path has no associated node: " << nodepath << ". Could have been deleted in the process";
                     }
-                    delete megaCmdListener;
+                    delete ncwd;
                 }
-            }
-            else //target found
-            {
-                if (tn->getType() == MegaNode::TYPE_FILE) //move & remove old & rename new
+                else
                 {
-                    // (there should never be any orphaned filenodes)
-                    MegaNode *tnParentNode = api->getNodeByHandle(tn->getParentHandle());
-                    if (tnParentNode)
-                    {
-                        delete tnParentNode;
+                    setCurrentOutCode(MCMD_INVALIDSTATE);
+                    LOG_err << "Couldn't find woking folder (it might been deleted)";
+                }
+            }
+            pathsToList->clear();
+            delete pathsToList;
+        }
+    }
 
-                        //move into the parent of target node
-                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                        std::unique_ptr<MegaNode> parentNode {api->getNodeByHandle(tn->getParentHandle())};
-                        api->moveNode(n, parentNode.get(), megaCmdListener);
-                        megaCmdListener->wait();
-                        if (checkNoErrors(megaCmdListener->getError(), "move node"))
-                        {
-                            const char* name_to_replace = tn->getName();
+    return paths;
+}
 
-                            //remove (replaced) target node
-                            if (n != tn) //just in case moving to same location
-                            {
-                                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                                api->remove(tn, megaCmdListener); //remove target node
-                                megaCmdListener->wait();
-                                if (!checkNoErrors(megaCmdListener->getError(), "remove target node"))
-                                {
-                                    LOG_err << "Couldnt move " << n->getName() << " to " << tn->getName() << " : " << megaCmdListener->getError()->getErrorCode();
-                                }
-                                delete megaCmdListener;
-                            }
+#ifdef _WIN32
+//TODO: try to use these functions from somewhere else
+static std::wstring toUtf16String(const std::string& s, UINT codepage = CP_UTF8)
+{
+    std::wstring ws;
+    ws.resize(s.size() + 1);
+    int nwchars = MultiByteToWideChar(codepage, 0, s.data(), int(s.size()), (LPWSTR)ws.data(), int(ws.size()));
+    ws.resize(nwchars);
+    return ws;
+}
 
-                            // rename moved node with the new name
-                            if (strcmp(name_to_replace, n->getName()))
-                            {
-                                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                                api->renameNode(n, name_to_replace, megaCmdListener);
-                                megaCmdListener->wait();
-                                if (!checkNoErrors(megaCmdListener->getError(), "rename moved node"))
-                                {
-                                    LOG_err << "Failed to rename moved node: " << megaCmdListener->getError()->getErrorString();
-                                }
-                                delete megaCmdListener;
-                            }
-                        }
-                        delete megaCmdListener;
-                    }
-                    else
-                    {
-                        setCurrentOutCode(MCMD_INVALIDSTATE);
-                        LOG_fatal << "Destiny node is orphan!!!";
-                    }
-                }
-                else // target is a folder
-                {
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->moveNode(n, tn, megaCmdListener);
-                    megaCmdListener->wait();
-                    checkNoErrors(megaCmdListener->getError(), "move node");
-                    delete megaCmdListener;
-                }
-            }
-        }
-        delete tn;
-    }
-    else //target not found (not even its folder), cant move
+std::string toUtf8String(const std::wstring& ws, UINT codepage = CP_UTF8)
+{
+    std::string s;
+    s.resize((ws.size() + 1) * 4);
+    int nchars = WideCharToMultiByte(codepage, 0, ws.data(), int(ws.size()), (LPSTR)s.data(), int(s.size()), NULL, NULL);
+    s.resize(nchars);
+    return s;
+}
+
+
+bool replaceW(std::wstring& str, const std::wstring& from, const std::wstring& to)
+{
+    size_t start_pos = str.find(from);
+    if (start_pos == std::wstring::npos)
     {
-        setCurrentOutCode(MCMD_NOTFOUND);
-        LOG_err << destiny << ": No such directory";
+        return false;
     }
+    str.replace(start_pos, from.length(), to);
+    return true;
 }
+#endif
 
-
-bool MegaCmdExecuter::isValidFolder(string destiny)
+vector<string> MegaCmdExecuter::listlocalpathsstartingby(string askedPath, bool discardFiles)
 {
-    bool isdestinyavalidfolder = true;
-    MegaNode *ndestiny = nodebypath(destiny.c_str());;
-    if (ndestiny)
+    vector<string> paths;
+
+#ifdef WIN32
+    string actualaskedPath = fs::u8path(askedPath).u8string();
+    char sep = (!askedPath.empty() && askedPath.find('/') != string::npos ) ?'/':'\\';
+    size_t postlastsep = actualaskedPath.find_last_of("/\\");
+#else
+    string actualaskedPath = askedPath;
+    char sep = '/';
+    size_t postlastsep = actualaskedPath.find_last_of(sep);
+#endif
+
+    if (postlastsep == 0) postlastsep++; // absolute paths
+    string containingfolder = postlastsep == string::npos ? string() : actualaskedPath.substr(0, postlastsep);
+
+    bool removeprefix = false;
+    bool requiresseparatorafterunit = false;
+    if (!containingfolder.size())
     {
-        if (ndestiny->getType() == MegaNode::TYPE_FILE)
-        {
-            isdestinyavalidfolder = false;
-        }
-        delete ndestiny;
+        containingfolder = ".";
+        removeprefix= true;
     }
-    else
+#ifdef WIN32
+    else if (containingfolder.find(":") == 1 && (containingfolder.size() < 3 || ( containingfolder.at(2) != '/' && containingfolder.at(2) != '\\')))
     {
-        isdestinyavalidfolder = false;
+        requiresseparatorafterunit = true;
     }
-    return isdestinyavalidfolder;
-}
+#endif
 
-void MegaCmdExecuter::restartsyncs()
-{
-    std::lock_guard<std::recursive_mutex> g(ConfigurationManager::settingsMutex);
-    map<string, sync_struct *>::iterator itr;
-    for (itr = ConfigurationManager::configuredSyncs.begin(); itr != ConfigurationManager::configuredSyncs.end(); ++itr)
+    // excluded names are only offered once the user starts typing them
+    std::shared_ptr<ExclusionMatcher> exclusions;
+    if (postlastsep == string::npos ? !actualaskedPath.size() : postlastsep + 1 >= actualaskedPath.size())
     {
-        string key = ( *itr ).first;
-        sync_struct *thesync = ((sync_struct*)( *itr ).second );
-        if (thesync->active)
+        exclusions = ConfigurationManager::getExclusionMatcher();
+    }
+
+#ifdef MEGACMDEXECUTER_FILESYSTEM
+    for (fs::directory_iterator iter(fs::u8path(containingfolder)); iter != fs::directory_iterator(); ++iter)
+    {
+        if (exclusions && exclusions->matches(iter->path().filename().u8string()))
         {
-            MegaNode * n = api->getNodeByHandle(thesync->handle);
-            if (n)
+            continue;
+        }
+        if (!discardFiles || iter->status().type() == fs::file_type::directory)
+        {
+#ifdef _WIN32
+            wstring path = iter->path().wstring();
+#else
+            string path = iter->path().string();
+#endif
+            if (removeprefix) path = path.substr(2);
+            if (requiresseparatorafterunit) path.insert(2, 1, sep);
+            if (iter->status().type() == fs::file_type::directory)
             {
-                char * nodepath = api->getNodePath(n);
-                LOG_info << "Restarting sync "<< key << ": " << nodepath;
-                delete []nodepath;
-                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                api->disableSync(n, megaCmdListener);
-                megaCmdListener->wait();
-
-                if (checkNoErrors(megaCmdListener->getError(), "stop sync"))
+                path.append(1, sep);
+            }
+#ifdef _WIN32
+                // try to mimic the exact startup of the asked path to allow mix of '\' & '/'
+                fs::path paskedpath = fs::u8path(askedPath);
+                paskedpath.make_preferred();
+                wstring toreplace = paskedpath.wstring();
+                if (path.find(toreplace) == 0)
                 {
-                    thesync->active = false;
-
-                    MegaSync *msync = api->getSyncByNode(n);
-                    if (!msync)
-                    {
-                        MegaCmdListener *megaCmdListener2 = new MegaCmdListener(NULL);
-                        api->syncFolder(thesync->localpath.c_str(), n, megaCmdListener2);
-                        megaCmdListener2->wait();
+                    replaceW(path, toreplace, toUtf16String(askedPath));
+                }
+#endif
+#ifdef _WIN32
+            paths.push_back(toUtf8String(path));
+#else
+            paths.push_back(path);
+#endif
 
-                        if (checkNoErrors(megaCmdListener2->getError(), "resume sync"))
-                        {
-                            thesync->active = true;
-                            thesync->loadedok = true;
+        }
+    }
 
-                            if (megaCmdListener2->getRequest()->getNumber())
-                            {
-                                thesync->fingerprint = megaCmdListener2->getRequest()->getNumber();
-                            }
-                        }
-                        else
-                        {
-                            thesync->active = false;
-                            thesync->loadedok = false;
-                        }
-                        delete megaCmdListener2;
-                        delete msync;
-                    }
-                    else
-                    {
-                        setCurrentOutCode(MCMD_INVALIDSTATE);
-                        LOG_err << "Failed to restart sync: " << key << ". You will need to manually reenable or restart MEGAcmd";
-                    }
+#elif defined(HAVE_DIRENT_H)
+    DIR *dir;
+    if ((dir = opendir (containingfolder.c_str())) != NULL)
+    {
+        struct dirent *entry;
+        while ((entry = readdir (dir)) != NULL)
+        {
+            if (exclusions && exclusions->matches(entry->d_name))
+            {
+                continue;
+            }
+            if (!discardFiles || entry->d_type == DT_DIR)
+            {
+                string path = containingfolder;
+                if (path != "/")
+                    path.append(1, sep);
+                path.append(entry->d_name);
+                if (removeprefix) path = path.substr(2);
+                if (path.size() && entry->d_type == DT_DIR)
+                {
+                    path.append(1, sep);
                 }
-                delete megaCmdListener;
-                delete n;
+                paths.push_back(path);
             }
         }
+
+        closedir(dir);
     }
+#endif
+    return paths;
 }
 
-std::string MegaCmdExecuter::getNodePathString(MegaNode *n)
+vector<string> MegaCmdExecuter::getlistusers()
 {
-    const char *path = api->getNodePath(n);
-    string toret(path);
-    delete[] path;
-    return toret;
+    vector<string> users;
+
+    MegaUserList* usersList = api->getContacts();
+    if (usersList)
+    {
+        for (int i = 0; i < usersList->size(); i++)
+        {
+            users.push_back(usersList->get(i)->getEmail());
+        }
+
+        delete usersList;
+    }
+    return users;
 }
 
-void MegaCmdExecuter::copyNode(MegaNode *n, string destiny, MegaNode * tn, string &targetuser, string &newname)
+vector<string> MegaCmdExecuter::getNodeAttrs(string nodePath)
 {
-    if (tn)
+    vector<string> attrs;
+
+    MegaNode *n = nodebypath(nodePath.c_str());
+    if (n)
     {
-        if (tn->getHandle() == n->getHandle())
+        //List node custom attributes
+        MegaStringList *attrlist = n->getCustomAttrNames();
+        if (attrlist)
         {
-            LOG_err << "Source and destiny are the same";
-        }
-        else
-        {
-            if (newname.size()) //target not found, but tn has what was before the last "/" in the path.
+            for (int a = 0; a < attrlist->size(); a++)
             {
-                if (n->getType() == MegaNode::TYPE_FILE)
-                {
-                    LOG_debug << "copy with new name: \"" << getNodePathString(n) << "\" to \"" << destiny << "\" newname=" << newname;
-                    //copy with new name
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->copyNode(n, tn, newname.c_str(), megaCmdListener); //only works for files
-                    megaCmdListener->wait();
-                    checkNoErrors(megaCmdListener->getError(), "copy node");
-                    delete megaCmdListener;
-                }
-                else //copy & rename
-                {
-                    LOG_debug << "copy & rename: \"" << getNodePathString(n) << "\" to \"" << destiny << "\"";
-                    //copy with new name
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->copyNode(n, tn, megaCmdListener);
-                    megaCmdListener->wait();
-                    if (checkNoErrors(megaCmdListener->getError(), "copy node"))
-                    {
-                        MegaNode * newNode = api->getNodeByHandle(megaCmdListener->getRequest()->getNodeHandle());
-                        if (newNode)
-                        {
-                            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                            api->renameNode(newNode, newname.c_str(), megaCmdListener);
-                            megaCmdListener->wait();
-                            checkNoErrors(megaCmdListener->getError(), "rename new node");
-                            delete megaCmdListener;
-                            delete newNode;
-                        }
-                        else
-                        {
-                            LOG_err << " Couldn't find new node created upon cp";
-                        }
-                    }
-                    delete megaCmdListener;
-                }
+                attrs.push_back(attrlist->get(a));
             }
-            else
-            { //target exists
-                if (tn->getType() == MegaNode::TYPE_FILE)
-                {
-                    if (n->getType() == MegaNode::TYPE_FILE)
-                    {
-                        LOG_debug << "overwriding target: \"" << getNodePathString(n) << "\" to \"" << destiny << "\"";
-
-                        // overwrite target if source and target are files
-                        MegaNode *tnParentNode = api->getNodeByHandle(tn->getParentHandle());
-                        if (tnParentNode) // (there should never be any orphaned filenodes)
-                        {
-                            const char* name_to_replace = tn->getName();
-                            //copy with new name
-                            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                            api->copyNode(n, tnParentNode, name_to_replace, megaCmdListener);
-                            megaCmdListener->wait();
-                            if (checkNoErrors(megaCmdListener->getError(), "copy with new name") )
-                            {
-                                MegaHandle newNodeHandle = megaCmdListener->getRequest()->getNodeHandle();
-                                delete megaCmdListener;
-                                delete tnParentNode;
-
-                                //remove target node
-                                if (tn->getHandle() != newNodeHandle )//&& newNodeHandle != n->getHandle())
-                                {
-                                    megaCmdListener = new MegaCmdListener(NULL);
-                                    api->remove(tn, megaCmdListener);
-                                    megaCmdListener->wait();
-                                    checkNoErrors(megaCmdListener->getError(), "delete target node");
-                                    delete megaCmdListener;
-                                }
-                            }
-                        }
-                        else
-                        {
-                            setCurrentOutCode(MCMD_INVALIDSTATE);
-                            LOG_fatal << "Destiny node is orphan!!!";
-                        }
-                    }
-                    else
-                    {
-                        setCurrentOutCode(MCMD_INVALIDTYPE);
-                        LOG_err << "Cannot overwrite file with folder";
-                        return;
-                    }
-                }
-                else //copying into folder
-                {
-                    LOG_debug << "Copying into folder: \"" << getNodePathString(n) << "\" to \"" << destiny << "\"";
 
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->copyNode(n, tn, megaCmdListener);
-                    megaCmdListener->wait();
-                    checkNoErrors(megaCmdListener->getError(), "copy node");
-                    delete megaCmdListener;
-                }
-            }
+            delete attrlist;
         }
+        delete n;
     }
-    else if (targetuser.size())
-    {
-        LOG_debug << "Sending to user: \"" << getNodePathString(n) << "\" to \"" << targetuser << "\"";
-
-        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-        api->sendFileToUser(n,targetuser.c_str(),megaCmdListener);
-        megaCmdListener->wait();
-        checkNoErrors(megaCmdListener->getError(), "send file to user");
-        delete megaCmdListener;
-    }
-    else
-    {
-        setCurrentOutCode(MCMD_NOTFOUND);
-        LOG_err << destiny << " Couldn't find destination";
-    }
+    return attrs;
 }
 
-
-#ifdef ENABLE_BACKUPS
-bool MegaCmdExecuter::establishBackup(string pathToBackup, MegaNode *n, int64_t period, string speriod,  int numBackups)
+vector<string> MegaCmdExecuter::getUserAttrs()
 {
-    bool attendpastbackups = true; //TODO: receive as parameter
-    static int backupcounter = 0;
-    LocalPath localrelativepath = LocalPath::fromPath(pathToBackup, *fsAccessCMD);
-    LocalPath localabsolutepath;
-    fsAccessCMD->expanselocalpath(localrelativepath, localabsolutepath);
-
-    MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
-    api->setBackup(localabsolutepath.toPath(*fsAccessCMD).c_str(), n, attendpastbackups, period, speriod.c_str(), numBackups, megaCmdListener);
-    megaCmdListener->wait();
-    if (checkNoErrors(megaCmdListener->getError(), "establish backup"))
+    vector<string> attrs;
+    int i = 0;
+    do
     {
-        mtxBackupsMap.lock();
-
-        backup_struct *thebackup = NULL;
-        if (ConfigurationManager::configuredBackups.find(megaCmdListener->getRequest()->getFile()) != ConfigurationManager::configuredBackups.end())
+        const char *catrn = api->userAttributeToString(i);
+        if (strlen(catrn))
         {
-            thebackup = ConfigurationManager::configuredBackups[megaCmdListener->getRequest()->getFile()];
-            if (thebackup->id == -1)
-            {
-                thebackup->id = backupcounter++;
-            }
+            attrs.push_back(catrn);
         }
         else
         {
-            thebackup = new backup_struct;
-            thebackup->id = backupcounter++;
-            ConfigurationManager::configuredBackups[megaCmdListener->getRequest()->getFile()] = thebackup;
+            delete [] catrn;
+            break;
         }
-        thebackup->active = true;
-        thebackup->handle = megaCmdListener->getRequest()->getNodeHandle();
-        thebackup->localpath = string(megaCmdListener->getRequest()->getFile());
-        thebackup->numBackups = numBackups;
-        thebackup->period = period;
-        thebackup->speriod = speriod;
-        thebackup->failed = false;
-        thebackup->tag = megaCmdListener->getRequest()->getTransferTag();
+        delete [] catrn;
+        i++;
+    } while (true);
 
-        char * nodepath = api->getNodePath(n);
-        LOG_info << "Added backup: " << megaCmdListener->getRequest()->getFile() << " to " << nodepath;
-        mtxBackupsMap.unlock();
-        delete []nodepath;
-        delete megaCmdListener;
+    return attrs;
+}
 
-        return true;
-    }
-    else
+vector<string> MegaCmdExecuter::getsessions()
+{
+    vector<string> sessions;
+    std::shared_ptr<MegaAccountDetails> details = sandboxCMD->accountDetails.get(AccountDetailsCache::EXTENDED, api, true, 3000);
+    if (details)
     {
-        bool foundbytag = false;
-        // find by tag in configured (modification failed)
-        for (std::map<std::string, backup_struct *>::iterator itr = ConfigurationManager::configuredBackups.begin();
-             itr != ConfigurationManager::configuredBackups.end(); itr++)
+        int numSessions = details->getNumSessions();
+        for (int i = 0; i < numSessions; i++)
         {
-            if (itr->second->tag == megaCmdListener->getRequest()->getTransferTag())
+            MegaAccountSession * session = details->getSession(i);
+            if (session)
             {
-                backup_struct *thebackup = itr->second;
-
-                foundbytag = true;
-                thebackup->handle = megaCmdListener->getRequest()->getNodeHandle();
-                thebackup->localpath = string(megaCmdListener->getRequest()->getFile());
-                thebackup->numBackups = megaCmdListener->getRequest()->getNumRetry();
-                thebackup->period = megaCmdListener->getRequest()->getNumber();
-                thebackup->speriod = string(megaCmdListener->getRequest()->getText());;
-                thebackup->failed = true;
+                if (session->isAlive())
+                {
+                    std::unique_ptr<char []> handle {api->userHandleToBase64(session->getHandle())};
+                    sessions.push_back(handle.get());
+                }
+                delete session;
             }
         }
+    }
+    return sessions;
+}
 
+vector<string> MegaCmdExecuter::getlistfilesfolders(string location)
+{
+    vector<string> toret;
+#ifdef MEGACMDEXECUTER_FILESYSTEM
+    for (fs::directory_iterator iter(fs::u8path(location)); iter != fs::directory_iterator(); ++iter)
+    {
+        toret.push_back(iter->path().filename().u8string());
+    }
 
-        if (!foundbytag)
+#elif defined(HAVE_DIRENT_H)
+    DIR *dir;
+    struct dirent *entry;
+    if ((dir = opendir (location.c_str())) != NULL)
+    {
+        while ((entry = readdir (dir)) != NULL)
         {
-            std::map<std::string, backup_struct *>::iterator itr = ConfigurationManager::configuredBackups.find(megaCmdListener->getRequest()->getFile());
-            if ( itr != ConfigurationManager::configuredBackups.end())
+            if (IsFolder(location + entry->d_name))
             {
-                if (megaCmdListener->getError()->getErrorCode() != MegaError::API_EEXIST)
-                {
-                    itr->second->failed = true;
-                }
-                itr->second->id = backupcounter++;
+                toret.push_back(entry->d_name + string("/"));
+            }
+            else
+            {
+                toret.push_back(entry->d_name);
             }
         }
+        closedir (dir);
     }
-    delete megaCmdListener;
-    return false;
-}
 #endif
+    return toret;
+}
 
-void MegaCmdExecuter::confirmCancel(const char* confirmlink, const char* pass)
+void MegaCmdExecuter::signup(string name, string passwd, string email)
 {
     MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-    api->confirmCancelAccount(confirmlink, pass, megaCmdListener);
-    megaCmdListener->wait();
-    if (megaCmdListener->getError()->getErrorCode() == MegaError::API_ETOOMANY)
+
+    size_t spos = name.find(" ");
+    string firstname = name.substr(0, spos);
+    string lastname;
+    if (spos != string::npos && ((spos + 1) < name.length()))
     {
-        LOG_err << "Confirm cancel account failed: too many attempts";
+        lastname = name.substr(spos+1);
     }
-    else if (megaCmdListener->getError()->getErrorCode() == MegaError::API_ENOENT
-             || megaCmdListener->getError()->getErrorCode() == MegaError::API_EKEY)
+
+    OUTSTREAM << "Singinup up. name=" << firstname << ". surname=" << lastname<< endl;
+
+    api->createAccount(email.c_str(), passwd.c_str(), firstname.c_str(), lastname.c_str(), megaCmdListener);
+    megaCmdListener->wait();
+    if (checkNoErrors(megaCmdListener->getError(), "create account <" + email + ">"))
     {
-        LOG_err << "Confirm cancel account failed: invalid link/password";
-    }
-    else if (checkNoErrors(megaCmdListener->getError(), "confirm cancel account"))
-    {
-        OUTSTREAM << "CONFIRM Account cancelled succesfully" << endl;
-        MegaCmdListener *megaCmdListener2 = new MegaCmdListener(NULL);
-        api->localLogout(megaCmdListener2);
-        actUponLogout(megaCmdListener2, false);
-        delete megaCmdListener2;
+        OUTSTREAM << "Account <" << email << "> created succesfully. You will receive a confirmation link. Use \"confirm\" with the provided link to confirm that account" << endl;
     }
+
     delete megaCmdListener;
+
+    MegaCmdListener *megaCmdListener2 = new MegaCmdListener(NULL);
+    api->localLogout(megaCmdListener2);
+    megaCmdListener2->wait();
+    checkNoErrors(megaCmdListener2->getError(), "logging out from ephemeral account");
+    delete megaCmdListener2;
 }
 
-void MegaCmdExecuter::processPath(string path, bool usepcre, bool &firstone, void (*nodeprocessor)(MegaCmdExecuter *, MegaNode *, bool), MegaCmdExecuter *context)
+void MegaCmdExecuter::signupWithPassword(string passwd)
 {
+    return signup(name, passwd, login);
+}
 
-    if (isRegExp(path))
+void MegaCmdExecuter::confirm(string passwd, string email, string link)
+{
+    MegaCmdListener *megaCmdListener2 = new MegaCmdListener(NULL);
+    api->confirmAccount(link.c_str(), passwd.c_str(), megaCmdListener2);
+    megaCmdListener2->wait();
+    if (megaCmdListener2->getError()->getErrorCode() == MegaError::API_ENOENT)
     {
-        vector<MegaNode *> *nodes = nodesbypath(path.c_str(), usepcre);
-        if (nodes)
-        {
-            if (!nodes->size())
-            {
-                setCurrentOutCode(MCMD_NOTFOUND);
-                LOG_err << "Path not found: " << path;
-            }
-            for (std::vector< MegaNode * >::iterator it = nodes->begin(); it != nodes->end(); ++it)
-            {
-                MegaNode * n = *it;
-                if (n)
-                {
-                    nodeprocessor(context, n, firstone);
-                    firstone = false;
-                    delete n;
-                }
-                else
-                {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << "Path not found: " << path;
-                    return;
-                }
-            }
-        }
+        LOG_err << "Invalid password";
     }
-    else // non-regexp
+    else if (checkNoErrors(megaCmdListener2->getError(), "confirm account"))
     {
-        MegaNode *n = nodebypath(path.c_str());
-        if (n)
-        {
-            nodeprocessor(context, n, firstone);
-            firstone = false;
-            delete n;
-        }
-        else
-        {
-            setCurrentOutCode(MCMD_NOTFOUND);
-            LOG_err << "Path not found: " << path;
-            return;
-        }
+        OUTSTREAM << "Account " << email << " confirmed succesfully. You can login with it now" << endl;
     }
-}
-
-
-#ifdef HAVE_LIBUV
 
-void forwarderRemoveWebdavLocation(MegaCmdExecuter* context, MegaNode *n, bool firstone) {
-    context->removeWebdavLocation(n, firstone);
+    delete megaCmdListener2;
 }
-void forwarderAddWebdavLocation(MegaCmdExecuter* context, MegaNode *n, bool firstone) {
-    context->addWebdavLocation(n, firstone);
+
+void MegaCmdExecuter::confirmWithPassword(string passwd)
+{
+    return confirm(passwd, login, link);
 }
-void forwarderRemoveFtpLocation(MegaCmdExecuter* context, MegaNode *n, bool firstone) {
-    context->removeFtpLocation(n, firstone);
+
+bool MegaCmdExecuter::IsFolder(string path)
+{
+#ifdef _WIN32
+    replaceAll(path,"/","\\");
+#endif
+    LocalPath localpath = LocalPath::fromPath(path, *fsAccessCMD);
+    std::unique_ptr<FileAccess> fa = fsAccessCMD->newfileaccess();
+    return fa->isfolder(localpath);
 }
-void forwarderAddFtpLocation(MegaCmdExecuter* context, MegaNode *n, bool firstone) {
-    context->addFtpLocation(n, firstone);
+
+void MegaCmdExecuter::printTransfersHeader(const unsigned int PATHSIZE, bool printstate)
+{
+    OUTSTREAM << "TYPE     TAG  " << getFixLengthString("SOURCEPATH ",PATHSIZE) << getFixLengthString("DESTINYPATH ",PATHSIZE)
+              << "  " << getFixLengthString("    PROGRESS",21);
+    if (printstate)
+    {
+        OUTSTREAM  << "  " << "STATE";
+    }
+    OUTSTREAM << endl;
 }
 
-void MegaCmdExecuter::removeWebdavLocation(MegaNode *n, bool firstone, string name)
+void MegaCmdExecuter::printTransfer(MegaTransfer *transfer, const unsigned int PATHSIZE, bool printstate)
 {
-    char *actualNodePath = api->getNodePath(n);
-    api->httpServerRemoveWebDavAllowedNode(n->getHandle());
+    //Direction
+#ifdef _WIN32
+    OUTSTREAM << " " << ((transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)?"D":"U") << " ";
+#else
+    OUTSTREAM << " " << ((transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)?"\u21d3":"\u21d1") << " ";
+#endif
+    //TODO: handle TYPE_LOCAL_TCP_DOWNLOAD
 
-    mtxWebDavLocations.lock();
-    list<string> servedpaths = ConfigurationManager::getConfigurationValueList("webdav_served_locations");
-    size_t sizeprior = servedpaths.size();
-    servedpaths.remove(actualNodePath);
-    size_t sizeafter = servedpaths.size();
-    if (!sizeafter)
+    //type (transfer/normal)
+    if (transfer->isSyncTransfer())
     {
-        api->httpServerStop();
-        ConfigurationManager::savePropertyValue("webdav_port", -1); //so as not to load server on startup
+#ifdef _WIN32
+        OUTSTREAM << "S";
+#else
+        OUTSTREAM << "\u21f5";
+#endif
     }
-    ConfigurationManager::savePropertyValueList("webdav_served_locations", servedpaths);
-    mtxWebDavLocations.unlock();
-
-    if (sizeprior != sizeafter)
+#ifdef ENABLE_BACKUPS
+    else if (transfer->isBackupTransfer())
     {
-        OUTSTREAM << (name.size()?name:actualNodePath) << " no longer served via webdav" << endl;
+#ifdef _WIN32
+        OUTSTREAM << "B";
+#else
+        OUTSTREAM << "\u23eb";
+#endif
     }
+#endif
     else
     {
-        setCurrentOutCode(MCMD_NOTFOUND);
-        LOG_err << (name.size()?name:actualNodePath) << " is not served via webdav";
+        OUTSTREAM << " " ;
     }
-    delete []actualNodePath;
-}
 
-void MegaCmdExecuter::addWebdavLocation(MegaNode *n, bool firstone, string name)
-{
-    char *actualNodePath = api->getNodePath(n);
-    char *l = api->httpServerGetLocalWebDavLink(n);
-    OUTSTREAM << "Serving via webdav " << (name.size()?name:actualNodePath) << ": " << l << endl;
+    OUTSTREAM << " " ;
 
-    mtxWebDavLocations.lock();
-    list<string> servedpaths = ConfigurationManager::getConfigurationValueList("webdav_served_locations");
-    servedpaths.push_back(actualNodePath);
-    servedpaths.sort();
-    servedpaths.unique();
-    ConfigurationManager::savePropertyValueList("webdav_served_locations", servedpaths);
-    mtxWebDavLocations.unlock();
+    //tag
+    OUTSTREAM << getRightAlignedString(SSTR(transfer->getTag()),7) << " ";
 
-    delete []l;
-    delete []actualNodePath;
-}
+    if (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)
+    {
+        // source
+        string nodepath = sandboxCMD->nodePathCache.getNodePath(api, transfer->getNodeHandle());
+        if (nodepath.size())
+        {
+            OUTSTREAM << getFixLengthString(nodepath,PATHSIZE);
+        }
+        else
+        {
+            globalTransferListener->completedTransfersMutex.lock();
+            OUTSTREAM << getFixLengthString(globalTransferListener->completedPathsByHandle[transfer->getNodeHandle()],PATHSIZE);
+            globalTransferListener->completedTransfersMutex.unlock();
+        }
 
-void MegaCmdExecuter::removeFtpLocation(MegaNode *n, bool firstone, string name)
-{
-    char *actualNodePath = api->getNodePath(n);
-    api->ftpServerRemoveAllowedNode(n->getHandle());
+        OUTSTREAM << " ";
 
-    mtxFtpLocations.lock();
-    list<string> servedpaths = ConfigurationManager::getConfigurationValueList("ftp_served_locations");
-    size_t sizeprior = servedpaths.size();
-    servedpaths.remove(actualNodePath);
-    size_t sizeafter = servedpaths.size();
-    if (!sizeafter)
+        //destination
+        string dest = transfer->getParentPath() ? transfer->getParentPath() : "";
+        dest.append(transfer->getFileName());
+        OUTSTREAM << getFixLengthString(dest,PATHSIZE);
+    }
+    else
     {
-        api->ftpServerStop();
-        ConfigurationManager::savePropertyValue("ftp_port", -1); //so as not to load server on startup
+
+        //source
+        string source(transfer->getParentPath()?transfer->getParentPath():"");
+        source.append(transfer->getFileName());
+
+        OUTSTREAM << getFixLengthString(source, PATHSIZE);
+        OUTSTREAM << " ";
+
+        //destination
+        string parentnodepath = sandboxCMD->nodePathCache.getNodePath(api, transfer->getParentHandle());
+        if (parentnodepath.size())
+        {
+            OUTSTREAM << getFixLengthString(parentnodepath ,PATHSIZE);
+        }
+        else
+        {
+            OUTSTREAM << getFixLengthString("",PATHSIZE,'-');
+            LOG_warn << "Could not find destination (parent handle "<< ((transfer->getParentHandle()==INVALID_HANDLE)?" invalid":" valid")
+                     <<" ) for upload transfer. Source=" << transfer->getParentPath() << transfer->getFileName();
+        }
     }
-    ConfigurationManager::savePropertyValueList("ftp_served_locations", servedpaths);
-    mtxFtpLocations.unlock();
 
-    if (sizeprior != sizeafter)
+    //progress
+    float percent;
+    if (transfer->getTotalBytes() == 0)
     {
-        OUTSTREAM << (name.size()?name:actualNodePath) << " no longer served via ftp" << endl;
+        percent = 0;
     }
     else
     {
-        setCurrentOutCode(MCMD_NOTFOUND);
-        LOG_err << (name.size()?name:actualNodePath)  << " is not served via ftp";
+        percent = float(transfer->getTransferredBytes()*1.0/transfer->getTotalBytes());
     }
-    delete []actualNodePath;
-}
-
-void MegaCmdExecuter::addFtpLocation(MegaNode *n, bool firstone, string name)
-{
-    char *actualNodePath = api->getNodePath(n);
-    char *l = api->ftpServerGetLocalLink(n);
-    OUTSTREAM << "Serving via ftp " << (name.size()?name:n->getName())  << ": " << l << endl;
+    OUTSTREAM << "  " << getFixLengthString(percentageToText(percent),7,' ',true)
+              << " of " << getFixLengthString(sizeToText(transfer->getTotalBytes()),10,' ',true);
 
-    mtxFtpLocations.lock();
-    list<string> servedpaths = ConfigurationManager::getConfigurationValueList("ftp_served_locations");
-    servedpaths.push_back(actualNodePath);
-    servedpaths.sort();
-    servedpaths.unique();
-    ConfigurationManager::savePropertyValueList("ftp_served_locations", servedpaths);
-    mtxFtpLocations.unlock();
+    //state
+    if (printstate)
+    {
+        OUTSTREAM << "  " << getTransferStateStr(transfer->getState());
+    }
 
-    delete []l;
-    delete []actualNodePath;
+    OUTSTREAM << endl;
 }
 
-#endif
-
-
-void MegaCmdExecuter::catFile(MegaNode *n)
+void MegaCmdExecuter::printTransferColumnDisplayer(ColumnDisplayer *cd, MegaTransfer *transfer, bool printstate)
 {
-    if (n->getType() != MegaNode::TYPE_FILE)
-    {
-        LOG_err << " Unable to cat: not a file";
-        setCurrentOutCode(MCMD_EARGS);
-        return;
-    }
+    //Direction
+    string type;
+#ifdef _WIN32
+    type += getutf8fromUtf16((transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)?L"\u25bc":L"\u25b2");
+#else
+    type += (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)?"\u21d3":"\u21d1";
+#endif
+    //TODO: handle TYPE_LOCAL_TCP_DOWNLOAD
 
-    long long nsize = api->getSize(n);
-    if (!nsize)
+    //type (transfer/normal)
+    if (transfer->isSyncTransfer())
     {
-        return;
+#ifdef _WIN32
+        type += getutf8fromUtf16(L"\u21a8");
+#else
+        type += "\u21f5";
+#endif
     }
-    long long end = nsize;
-    long long start = 0;
-
-    MegaCmdCatTransferListener *mcctl = new MegaCmdCatTransferListener(&OUTSTREAM, api, sandboxCMD);
-    api->startStreaming(n, start, end-start, mcctl);
-    mcctl->wait();
-    if (checkNoErrors(mcctl->getError(), "cat streaming from " +SSTR(start) + " to " + SSTR(end) ))
+#ifdef ENABLE_BACKUPS
+    else if (transfer->isBackupTransfer())
     {
-        char * npath = api->getNodePath(n);
-        LOG_verbose << "Streamed: " << npath << " from " << start << " to " << end;
-        delete []npath;
+#ifdef _WIN32
+        type += getutf8fromUtf16(L"\u2191");
+#else
+        type += "\u23eb";
+#endif
     }
+#endif
 
-    delete mcctl;
-}
-
-void MegaCmdExecuter::printInfoFile(MegaNode *n, bool &firstone, int PATHSIZE)
-{
-    char * nodepath = api->getNodePath(n);
-    char *fattrs = n->getFileAttrString();
-    if (fattrs == NULL)
-    {
-        LOG_warn << " Unable to get attributes for node " << nodepath;
-    }
+    cd->addValue("TYPE",type);
+    cd->addValue("TAG", SSTR(transfer->getTag())); //TODO: do SSTR within ColumnDisplayer
 
-    if (firstone)
+    if (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)
     {
-        OUTSTREAM << getFixLengthString("FILE", PATHSIZE);
-        OUTSTREAM << getFixLengthString("WIDTH", 7);
-        OUTSTREAM << getFixLengthString("HEIGHT", 7);
-        OUTSTREAM << getFixLengthString("FPS", 4);
-        OUTSTREAM << getFixLengthString("PLAYTIME", 10);
-        OUTSTREAM << endl;
-        firstone = false;
-    }
-
-    OUTSTREAM << getFixLengthString(nodepath, PATHSIZE-1) << " ";
-    delete []nodepath;
-
-    OUTSTREAM << getFixLengthString( (n->getWidth() == -1) ? "---" : SSTR(n->getWidth()) , 6) << " ";
-    OUTSTREAM << getFixLengthString( (n->getHeight() == -1) ? "---" : SSTR(n->getHeight()) , 6) << " ";
+        // source
+        string nodepath = sandboxCMD->nodePathCache.getNodePath(api, transfer->getNodeHandle());
+        if (nodepath.size())
+        {
+            cd->addValue("SOURCEPATH",nodepath);
+        }
+        else
+        {
+            globalTransferListener->completedTransfersMutex.lock();
+            cd->addValue("SOURCEPATH",globalTransferListener->completedPathsByHandle[transfer->getNodeHandle()]);
+            globalTransferListener->completedTransfersMutex.unlock();
+        }
 
-    if (fattrs == NULL)
-    {
-        OUTSTREAM << getFixLengthString("---", 3) << " ";
+        //destination
+        string dest = transfer->getParentPath() ? transfer->getParentPath() : "";
+        dest.append(transfer->getFileName());
+        cd->addValue("DESTINYPATH",dest);
     }
     else
     {
-        MediaProperties mp = MediaProperties::decodeMediaPropertiesAttributes(fattrs, (uint32_t*)(n->getNodeKey()->data() + FILENODEKEYLENGTH / 2) );
-        OUTSTREAM << getFixLengthString( (mp.fps == 0) ? "---" : SSTR(mp.fps) , 3) << " ";
-    }
-    OUTSTREAM << getFixLengthString( (n->getHeight() == -1) ? "---" : getReadablePeriod(n->getDuration()) , 10) << " ";
-
-    OUTSTREAM << endl;
-}
-
-bool MegaCmdExecuter::printUserAttribute(int a, string user, bool onlylist)
-{
-    const char *catrn = api->userAttributeToString(a);
-    string attrname = catrn;
-    delete [] catrn;
+        //source
+        string source(transfer->getParentPath()?transfer->getParentPath():"");
+        source.append(transfer->getFileName());
 
-    const char *catrln = api->userAttributeToLongName(a);
-    string longname = catrln;
-    delete [] catrln;
+        cd->addValue("SOURCEPATH",source);
 
-    if (attrname.size())
-    {
-        if (onlylist)
+        //destination
+        string parentnodepath = sandboxCMD->nodePathCache.getNodePath(api, transfer->getParentHandle());
+        if (parentnodepath.size())
         {
-            OUTSTREAM << longname << " (" << attrname << ")" << endl;
+            cd->addValue("DESTINYPATH",parentnodepath);
         }
         else
         {
-            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-            if (user.size())
-            {
-                api->getUserAttribute(user.c_str(), a, megaCmdListener);
-            }
-            else
-            {
-                api->getUserAttribute(a, megaCmdListener);
-            }
-            megaCmdListener->wait();
-            if (checkNoErrors(megaCmdListener->getError(), string("get user attribute ") + attrname))
-            {
-                int iattr = megaCmdListener->getRequest()->getParamType();
-                const char *value = megaCmdListener->getRequest()->getText();
-                //if (!value) value = megaCmdListener->getRequest()->getMegaStringMap()->;
-                string svalue;
-                try
-                {
-                    if (value)
-                    {
-                        svalue = string(value);
-                    }
-                    else
-                    {
+            cd->addValue("DESTINYPATH","---------");
 
-                        svalue = "NOT PRINTABLE";
-                    }
+            LOG_warn << "Could not find destination (parent handle "<< ((transfer->getParentHandle()==INVALID_HANDLE)?" invalid":" valid")
+                     <<" ) for upload transfer. Source=" << transfer->getParentPath() << transfer->getFileName();
+        }
+    }
 
-                }
-                catch (exception e)
-                {
-                    svalue = "NOT PRINTABLE";
-                }
-                OUTSTREAM << "\t" << longname << " (" << attrname << ")" << " = " << svalue << endl;
-            }
+    //progress
+    float percent;
+    if (transfer->getTotalBytes() == 0)
+    {
+        percent = 0;
+    }
+    else
+    {
+        percent = float(transfer->getTransferredBytes()*1.0/transfer->getTotalBytes());
+    }
 
-            delete megaCmdListener;
-        }
-        return true;
+    stringstream osspercent;
+    osspercent << percentageToText(percent) << " of " << getFixLengthString(sizeToText(transfer->getTotalBytes()),10,' ',true);
+    cd->addValue("PROGRESS",osspercent.str());
+
+    //state
+    if (printstate)
+    {
+        cd->addValue("STATE",getTransferStateStr(transfer->getState()));
     }
-    return false;
 }
 
-bool MegaCmdExecuter::setProxy(const std::string &url, const std::string &username, const std::string &password, int proxyType)
+void MegaCmdExecuter::printTransferNdjson(MegaTransfer *transfer)
 {
-    MegaProxy mpx;
+    NdjsonLine line;
+    line.addNumber("tag", transfer->getTag());
+    line.addString("type", (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD) ? "download" : "upload");
+    line.addBool("sync", transfer->isSyncTransfer());
+#ifdef ENABLE_BACKUPS
+    line.addBool("backup", transfer->isBackupTransfer());
+#endif
 
-    if (url.size())
+    string localpath = transfer->getParentPath() ? transfer->getParentPath() : "";
+    localpath.append(transfer->getFileName() ? transfer->getFileName() : "");
+
+    MegaHandle h = (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD) ? transfer->getNodeHandle() : transfer->getParentHandle();
+    string remotepath = sandboxCMD->nodePathCache.getNodePath(api, h);
+    if (remotepath.empty() && transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)
     {
-        mpx.setProxyURL(url.c_str());
+        globalTransferListener->completedTransfersMutex.lock();
+        remotepath = globalTransferListener->completedPathsByHandle[h];
+        globalTransferListener->completedTransfersMutex.unlock();
     }
 
-    if (username.size())
+    if (h != INVALID_HANDLE)
     {
-        mpx.setCredentials(username.c_str(), password.c_str());
+        std::unique_ptr<char []> handle {api->handleToBase64(h)};
+        line.addString("handle", handle.get());
     }
+    line.addString("path", remotepath);
+    line.addString("localpath", localpath);
+    line.addNumber("size", transfer->getTotalBytes());
+    line.addNumber("transferred", transfer->getTransferredBytes());
+    line.addString("state", getTransferStateStr(transfer->getState()));
 
-    mpx.setProxyType(proxyType);
+    OUTSTREAM << line.str();
+}
 
-    std::vector<MegaApi *> megaapis;
-    //TODO: add apiFolders to that list
-    megaapis.push_back(api);
-    bool failed = false;
-    for (auto api: megaapis)
+void MegaCmdExecuter::printSyncHeader(const unsigned int PATHSIZE, ColumnDisplayer *cd)
+{
+    if (cd)
     {
-        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-        api->setProxySettings(&mpx, megaCmdListener);
-        megaCmdListener->wait();
-        if (checkNoErrors(megaCmdListener->getError(), "(un)setting proxy"))
-        {
-            //TODO: connectivity check! // review connectivity check branch
-        }
-        else
-        {
-            failed = true;
-        }
-        delete megaCmdListener;
+        cd->addHeader("LOCALPATH", false);
+        cd->addHeader("REMOTEPATH", false);
+        return;
     }
+    OUTSTREAM << "ID ";
+    OUTSTREAM << getFixLengthString("LOCALPATH ", PATHSIZE) << " ";
+    OUTSTREAM << getFixLengthString("REMOTEPATH ", PATHSIZE) << " ";
 
-    if (!failed)
-    {
-        ConfigurationManager::savePropertyValue("proxy_url", mpx.getProxyURL()?mpx.getProxyURL():"");
-        ConfigurationManager::savePropertyValue("proxy_type", mpx.getProxyType());
+    OUTSTREAM << getFixLengthString("ActState", 10) << " ";
+    OUTSTREAM << getFixLengthString("SyncState", 9) << " ";
+    OUTSTREAM << getRightAlignedString("SIZE", 8) << " ";
+    OUTSTREAM << getRightAlignedString("FILES", 6) << " ";
+    OUTSTREAM << getRightAlignedString("DIRS", 6);
+    OUTSTREAM << endl;
+}
 
-        ConfigurationManager::savePropertyValue("proxy_username", mpx.getUsername()?mpx.getUsername():"");
-        ConfigurationManager::savePropertyValue("proxy_password", mpx.getPassword()?mpx.getPassword():"");
+#ifdef ENABLE_BACKUPS
 
-        if (mpx.getProxyType() == MegaProxy::PROXY_NONE)
-        {
-            OUTSTREAM << "Proxy unset correctly" << endl ;
-        }
-        else
-        {
-            OUTSTREAM << "Proxy set: " << (mpx.getProxyURL()?mpx.getProxyURL():"")
-                      << " type = " << getProxyTypeStr(mpx.getProxyType()) << endl;
+void MegaCmdExecuter::printBackupHeader(const unsigned int PATHSIZE)
+{
+    OUTSTREAM << "TAG  " << " ";
+    OUTSTREAM << getFixLengthString("LOCALPATH ", PATHSIZE) << " ";
+    OUTSTREAM << getFixLengthString("REMOTEPARENTPATH ", PATHSIZE) << " ";
+    OUTSTREAM << getRightAlignedString("STATUS", 14);
+    OUTSTREAM << endl;
+}
 
-            broadcastMessage(string("Using proxy: ").append((mpx.getProxyURL()?mpx.getProxyURL():""))
-                             .append(" type = ").append(getProxyTypeStr(mpx.getProxyType())), true);
-        }
-    }
-    else
-    {
-        LOG_err << "Unable to configure proxy";
-        broadcastMessage("Unable to configure proxy", true);
-    }
 
-    return !failed;
+void MegaCmdExecuter::printBackupSummary(int tag, const char * localfolder, const char *remoteparentfolder, string status, const unsigned int PATHSIZE)
+{
+    OUTSTREAM << getFixLengthString(SSTR(tag),5) << " "
+              << getFixLengthString(localfolder, PATHSIZE) << " "
+              << getFixLengthString((remoteparentfolder?remoteparentfolder:"INVALIDPATH"), PATHSIZE) << " "
+              << getRightAlignedString(status, 14)
+              << endl;
 }
 
-void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clflags, map<string, string> *cloptions)
+void MegaCmdExecuter::printBackupDetails(MegaBackup *backup, const char *timeFormat)
 {
-    MegaNode* n = NULL;
-    if (words[0] == "ls")
+    if (backup)
     {
-        if (!api->isFilesystemAvailable())
-        {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
-        }
-        int recursive = getFlag(clflags, "R") + getFlag(clflags, "r");
-        int extended_info = getFlag(clflags, "a");
-        int show_versions = getFlag(clflags, "versions");
-        bool summary = getFlag(clflags, "l");
-        bool firstprint = true;
-        bool humanreadable = getFlag(clflags, "h");
-        bool treelike = getFlag(clflags,"tree");
-        recursive += treelike?1:0;
+        string speriod = (backup->getPeriod() == -1)?backup->getPeriodString():getReadablePeriod(backup->getPeriod()/10);
+        OUTSTREAM << "  Max Backups:   " << backup->getMaxBackups() << endl;
+        OUTSTREAM << "  Period:         " << "\"" << speriod << "\"" << endl;
+        OUTSTREAM << "  Next backup scheduled for: " << getReadableTime(backup->getNextStartTime(), timeFormat);
 
-        if ((int)words.size() > 1)
+        OUTSTREAM << endl;
         {
-            unescapeifRequired(words[1]);
+            std::lock_guard<std::mutex> g(backupJournalsMutex);
+            auto it = backupJournals.find(backup->getLocalFolder());
+            if (it != backupJournals.end() && it->second)
+            {
+                LocalChangeJournal *journal = it->second.get();
+                OUTSTREAM << "  Fingerprints change journal: " << journal->getPendingChanges() << " changes pending, "
+                          << journal->getEvents() << " events, " << journal->getIncrementalScans() << " incremental/"
+                          << journal->getFullScans() << " full fingerprint refreshes, refresh time avoided: "
+                          << getReadablePeriod(journal->getAvoidedScanMs() / 1000) << endl;
+            }
+        }
+        OUTSTREAM << "  " << " -- CURRENT/LAST BACKUP --" << endl;
+        OUTSTREAM << "  " << getFixLengthString("FILES UP/TOT", 15);
+        OUTSTREAM << "  " << getFixLengthString("FOLDERS CREATED", 15);
+        OUTSTREAM << "  " << getRightAlignedString("PROGRESS     ", 22);
+
+        MegaTransferList * ml = backup->getFailedTransfers();
+        if (ml && ml->size())
+        {
+            OUTSTREAM << "  " << getRightAlignedString("FAILED TRANSFERS", 17);
+        }
+        OUTSTREAM << endl;
+
+        string sfiles = SSTR(backup->getNumberFiles()) + "/" + SSTR(backup->getTotalFiles());
+        OUTSTREAM << "  " << getRightAlignedString(sfiles, 8) << "       ";
+        OUTSTREAM << "  " << getRightAlignedString(SSTR(backup->getNumberFolders()), 8) << "       ";
+        long long trabytes = backup->getTransferredBytes();
+        long long totbytes = backup->getTotalBytes();
+        double percent = totbytes?double(trabytes)/double(totbytes):0;
+
+        string sprogress = sizeProgressToText(trabytes, totbytes) + "  " + percentageToText(float(percent));
+        OUTSTREAM << "  " << getRightAlignedString(sprogress,22);
+        if (ml && ml->size())
+        {
+            OUTSTREAM << getRightAlignedString(SSTR(backup->getFailedTransfers()->size()), 17);
+        }
+        delete ml;
+        OUTSTREAM << endl;
+    }
+}
 
-            string rNpath = "NULL";
-            if (words[1].find('/') != string::npos)
+void MegaCmdExecuter::printBackupHistory(MegaBackup *backup, const char *timeFormat, MegaNode *parentnode, const unsigned int PATHSIZE)
+{
+    bool firstinhistory = true;
+    MegaStringList *msl = api->getBackupFolders(backup->getTag());
+    if (msl)
+    {
+        for (int i = 0; i < msl->size(); i++)
+        {
+            int datelength = getReadableTime(m_time(), timeFormat).size();
+
+            if (firstinhistory)
             {
-                string cwpath = getCurrentPath();
-                if (words[1].find(cwpath) == string::npos)
-                {
-                    rNpath = "";
-                }
-                else
-                {
-                    rNpath = cwpath;
-                }
+                OUTSTREAM << "  " << " -- SAVED BACKUPS --" << endl;
+
+                // print header
+                OUTSTREAM << "  " << getFixLengthString("NAME", PATHSIZE) << " ";
+                OUTSTREAM << getFixLengthString("DATE", datelength+1) << " ";
+                OUTSTREAM << getRightAlignedString("STATUS", 11)<< " ";
+                OUTSTREAM << getRightAlignedString("FILES", 6)<< " ";
+                OUTSTREAM << getRightAlignedString("FOLDERS", 7);
+                OUTSTREAM << endl;
+
+                firstinhistory = false;
             }
 
-            if (isRegExp(words[1]))
+            string bpath = msl->get(i);
+            size_t pos = bpath.find("_bk_");
+            string btime = "";
+            if (pos != string::npos)
             {
-                vector<string> *pathsToList = nodesPathsbypath(words[1].c_str(), getFlag(clflags,"use-pcre"));
-                if (pathsToList && pathsToList->size())
-                {
-                    for (std::vector< string >::iterator it = pathsToList->begin(); it != pathsToList->end(); ++it)
-                    {
-                        string nodepath= *it;
-                        MegaNode *ncwd = api->getNodeByHandle(cwd);
-                        if (ncwd)
-                        {
-                            MegaNode * n = nodebypath(nodepath.c_str());
-                            if (n)
-                            {
-                                if (!n->getType() == MegaNode::TYPE_FILE)
-                                {
-                                    OUTSTREAM << nodepath << ": " << endl;
-                                }
-                                if (summary)
-                                {
-                                    if (firstprint)
-                                    {
-                                        dumpNodeSummaryHeader(getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions);
-                                        firstprint = false;
-                                    }
-                                    dumpTreeSummary(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions, recursive, show_versions, 0, humanreadable, rNpath);
-                                }
-                                else
-                                {
-                                    vector<bool> lfs;
-                                    dumptree(n, treelike, lfs, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, recursive, extended_info, show_versions, 0, rNpath);
-                                }
-                                if (( !n->getType() == MegaNode::TYPE_FILE ) && (( it + 1 ) != pathsToList->end()))
-                                {
-                                    OUTSTREAM << endl;
-                                }
-                                delete n;
-                            }
-                            else
-                            {
-                                LOG_debug << "Unexpected: matching path has no associated node: " << nodepath << ". Could have been deleted in the process";
-                            }
-                            delete ncwd;
-                        }
-                        else
-                        {
-                            setCurrentOutCode(MCMD_INVALIDSTATE);
-                            LOG_err << "Couldn't find woking folder (it might been deleted)";
-                        }
-                    }
-                    pathsToList->clear();
-                    delete pathsToList;
-                }
-                else
-                {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << "Couldn't find \"" << words[1] << "\"";
-                }
+                btime = bpath.substr(pos+4);
             }
-            else
+
+            pos = bpath.find_last_of("/\\");
+            string backupInstanceName = bpath;
+            if (pos != string::npos)
             {
-                n = nodebypath(words[1].c_str());
-                if (n)
-                {
-                    if (summary)
-                    {
-                        if (firstprint)
-                        {
-                            dumpNodeSummaryHeader(getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions);
-                            firstprint = false;
-                        }
-                        dumpTreeSummary(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions, recursive, show_versions, 0, humanreadable, rNpath);
-                    }
-                    else
-                    {
-                        if (treelike) OUTSTREAM << words[1] << endl;
-                        vector<bool> lfs;
-                        dumptree(n, treelike, lfs, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, recursive, extended_info, show_versions, 0, rNpath);
-                    }
-                    delete n;
-                }
-                else
-                {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << "Couldn't find " << words[1];
-                }
+                backupInstanceName = bpath.substr(pos+1);
             }
-        }
-        else
-        {
-            n = api->getNodeByHandle(cwd);
-            if (n)
+
+            string printableDate = "UNKNOWN";
+            if (btime.size())
             {
-                if (summary)
-                {
-                    if (firstprint)
-                    {
-                        dumpNodeSummaryHeader(getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions);
-                        firstprint = false;
-                    }
-                    dumpTreeSummary(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions, recursive, show_versions, 0, humanreadable);
-                }
-                else
+                struct tm dt;
+                fillStructWithSYYmdHMS(btime,dt);
+                printableDate = getReadableTime(m_mktime(&dt), timeFormat);
+            }
+
+            string backupInstanceStatus="NOT_FOUND";
+            long long nfiles = 0;
+            long long nfolders = 0;
+            if (parentnode)
+            {
+                MegaNode *backupInstanceNode = nodebypath(msl->get(i));
+                if (backupInstanceNode)
                 {
-                    if (treelike) OUTSTREAM << "." << endl;
-                    vector<bool> lfs;
-                    dumptree(n, treelike, lfs, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, recursive, extended_info, show_versions);
+                    backupInstanceStatus = backupInstanceNode->getCustomAttr("BACKST");
+
+                    getNumFolderFiles(backupInstanceNode, api, &nfiles, &nfolders);
+
                 }
-                delete n;
+
+                delete backupInstanceNode;
             }
+
+            OUTSTREAM << "  " << getFixLengthString(backupInstanceName, PATHSIZE) << " ";
+            OUTSTREAM << getFixLengthString(printableDate, datelength+1) << " ";
+            OUTSTREAM << getRightAlignedString(backupInstanceStatus, 11) << " ";
+            OUTSTREAM << getRightAlignedString(SSTR(nfiles), 6)<< " ";
+            OUTSTREAM << getRightAlignedString(SSTR(nfolders), 7);
+            //OUTSTREAM << getRightAlignedString("PROGRESS", 10);// some info regarding progress or the like in case of failure could be interesting. Although we don't know total files/folders/bytes
+            OUTSTREAM << endl;
+
         }
-        return;
+        delete msl;
     }
-    else if (words[0] == "find")
+}
+
+void MegaCmdExecuter::printBackup(int tag, MegaBackup *backup, const char *timeFormat, const unsigned int PATHSIZE, bool extendedinfo, bool showhistory, MegaNode *parentnode)
+{
+    if (backup)
     {
-        string pattern = getOption(cloptions, "pattern", "*");
-        int printfileinfo = getFlag(clflags,"l");
+        const char *nodepath = NULL;
+        bool deleteparentnode = false;
 
-        if (!api->isFilesystemAvailable())
+        if (!parentnode)
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            parentnode = api->getNodeByHandle(backup->getMegaHandle());
+            if (parentnode)
+            {
+                nodepath = api->getNodePath(parentnode);
+                deleteparentnode = true;
+            }
         }
-
-        m_time_t minTime = -1;
-        m_time_t maxTime = -1;
-        string mtimestring = getOption(cloptions, "mtime", "");
-        if ("" != mtimestring && !getMinAndMaxTime(mtimestring, &minTime, &maxTime))
+        else
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "Invalid time " << mtimestring;
-            return;
+            nodepath = api->getNodePath(parentnode);
         }
 
-        int64_t minSize = -1;
-        int64_t maxSize = -1;
-        string sizestring = getOption(cloptions, "size", "");
-        if ("" != sizestring && !getMinAndMaxSize(sizestring, &minSize, &maxSize))
+        printBackupSummary(tag, backup->getLocalFolder(),nodepath,backupSatetStr(backup->getState()), PATHSIZE);
+        if (extendedinfo)
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "Invalid time " << sizestring;
-            return;
+            printBackupDetails(backup, timeFormat);
         }
+        delete []nodepath;
 
-
-        if (words.size() <= 1)
+        if (showhistory && parentnode)
         {
-            n = api->getNodeByHandle(cwd);
-            doFind(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, "", printfileinfo, pattern, getFlag(clflags,"use-pcre"), minTime, maxTime, minSize, maxSize);
-            delete n;
+            printBackupHistory(backup, timeFormat, parentnode, PATHSIZE);
         }
-        for (int i = 1; i < (int)words.size(); i++)
+
+        if (deleteparentnode)
         {
-            if (isRegExp(words[i]))
-            {
-                vector<MegaNode *> *nodesToFind = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
-                if (nodesToFind->size())
-                {
-                    for (std::vector< MegaNode * >::iterator it = nodesToFind->begin(); it != nodesToFind->end(); ++it)
-                    {
-                        MegaNode * nodeToFind = *it;
-                        if (nodeToFind)
-                        {
-                            doFind(nodeToFind, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i], printfileinfo, pattern, getFlag(clflags,"use-pcre"), minTime, maxTime, minSize, maxSize);
-                            delete nodeToFind;
-                        }
-                    }
-                    nodesToFind->clear();
-                }
-                else
-                {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << words[i] << ": No such file or directory";
-                }
-                delete nodesToFind;
-            }
-            else
-            {
-                n = nodebypath(words[i].c_str());
-                if (!n)
-                {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << "Couldn't find " << words[i];
-                }
-                else
-                {
-                    doFind(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i], printfileinfo, pattern, getFlag(clflags,"use-pcre"), minTime, maxTime, minSize, maxSize);
-                    delete n;
-                }
-            }
+            delete parentnode;
         }
     }
-#if defined(_WIN32) || defined(__APPLE__)
-    else if (words[0] == "update")
+    else
     {
-        string sauto = getOption(cloptions, "auto", "");
-        transform(sauto.begin(), sauto.end(), sauto.begin(), ::tolower);
+        OUTSTREAM << "BACKUP not found " << endl;
+    }
+}
 
-        if (sauto == "off")
-        {
-            stopcheckingForUpdates();
-            OUTSTREAM << "Automatic updates disabled" << endl;
-        }
-        else if (sauto == "on")
+void MegaCmdExecuter::printBackup(backup_struct *backupstruct, const char *timeFormat, const unsigned int PATHSIZE, bool extendedinfo, bool showhistory)
+{
+    if (backupstruct->tag >= 0)
+    {
+        MegaBackup *backup = api->getBackupByTag(backupstruct->tag);
+        if (backup)
         {
-            startcheckingForUpdates();
-            OUTSTREAM << "Automatic updates enabled" << endl;
+            printBackup(backupstruct->tag, backup, timeFormat, PATHSIZE, extendedinfo, showhistory);
+            delete backup;
         }
-        else if (sauto == "query")
+        else
         {
-            OUTSTREAM << "Automatic updates " << (ConfigurationManager::getConfigurationValue("autoupdate", false)?"enabled":"disabled") << endl;
+            OUTSTREAM << "BACKUP not found: " << backupstruct->tag << endl;
         }
-        else
+    }
+    else
+    { //merely print configuration
+        printBackupSummary(backupstruct->tag, backupstruct->localpath.c_str(),"UNKOWN"," FAILED", PATHSIZE);
+        if (extendedinfo)
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("update");
+            string speriod = (backupstruct->period == -1)?backupstruct->speriod:getReadablePeriod(backupstruct->period/10);
+            OUTSTREAM << "         Period: " << "\"" << speriod << "\"" << endl;
+            OUTSTREAM << "   Max. Backups: " << backupstruct->numBackups << endl;
         }
-
-        return;
     }
+}
 #endif
-    else if (words[0] == "cd")
+
+string MegaCmdExecuter::getSyncActiveStateStr(sync_struct *thesync, MegaNode *n)
+{
+    MegaSync *msync = api->getSyncByNode(n);
+    string syncstate = "REMOVED";
+    if (msync)
     {
-        if (!api->isFilesystemAvailable())
+        syncstate = getSyncStateStr(msync->getState());
+    }
+
+    string statetoprint;
+    if (thesync->active)
+    {
+        statetoprint = syncstate;
+    }
+    else
+    {
+        if (msync)
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            statetoprint = "Disabling:";
+            statetoprint+=syncstate;
         }
-        if (words.size() > 1)
+        else
         {
-            if (( n = nodebypath(words[1].c_str())))
-            {
-                if (n->getType() == MegaNode::TYPE_FILE)
-                {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << words[1] << ": Not a directory";
-                }
-                else
-                {
-                    cwd = n->getHandle();
+            statetoprint = "Disabled";
+        }
+    }
+    delete msync;
+    return statetoprint;
+}
 
-                    updateprompt(api);
-                }
+void MegaCmdExecuter::printSyncNdjson(int i, string key, const char *nodepath, sync_struct *thesync, MegaNode *n, long long nfiles, long long nfolders)
+{
+    NdjsonLine line;
+    line.addNumber("id", i);
+    line.addString("localpath", key);
+    line.addString("path", nodepath);
+    if (n)
+    {
+        std::unique_ptr<char []> handle {api->handleToBase64(n->getHandle())};
+        line.addString("handle", handle.get());
+
+        string sstate(key);
+        sstate = rtrim(sstate, '/');
+#ifdef _WIN32
+        sstate = rtrim(sstate, '\\');
+#endif
+        string psstate;
+        fsAccessCMD->path2local(&sstate,&psstate);
+
+        line.addString("state", getSyncActiveStateStr(thesync, n));
+        line.addString("pathstate", getSyncPathStateStr(api->syncPathState(&psstate)));
+        line.addNumber("size", api->getSize(n));
+        line.addNumber("files", nfiles);
+        line.addNumber("folders", nfolders);
+    }
+    else
+    {
+        line.addString("state", "NOT FOUND");
+    }
+
+    OUTSTREAM << line.str();
+}
+
+void MegaCmdExecuter::printSync(int i, string key, const char *nodepath, sync_struct * thesync, MegaNode *n, long long nfiles, long long nfolders, const unsigned int PATHSIZE, megacmd::ColumnDisplayer *cd)
+{
+    if (cd)
+    {
+        cd->addValue("ID", SSTR(i));
+        cd->addValue("LOCALPATH", key);
+        cd->addValue("REMOTEPATH", nodepath);
+
+        string sstate(key);
+        sstate = rtrim(sstate, '/');
+    #ifdef _WIN32
+        sstate = rtrim(sstate, '\\');
+    #endif
+        string psstate;
+        fsAccessCMD->path2local(&sstate,&psstate);
+        int statepath = api->syncPathState(&psstate);
+
+        cd->addValue("ActState", getSyncActiveStateStr(thesync, n));
+        cd->addValue("SyncState", getSyncPathStateStr(statepath));
+        cd->addValue("SIZE", sizeToText(api->getSize(n)));
+        cd->addValue("FILES", SSTR(nfiles));
+        cd->addValue("DIRS", SSTR(nfolders));
+
+        return;
+    }
+
+    //tag
+    OUTSTREAM << getRightAlignedString(SSTR(i),2) << " ";
+
+    OUTSTREAM << getFixLengthString(key,PATHSIZE) << " ";
+
+    OUTSTREAM << getFixLengthString(nodepath,PATHSIZE) << " ";
+
+    string sstate(key);
+    sstate = rtrim(sstate, '/');
+#ifdef _WIN32
+    sstate = rtrim(sstate, '\\');
+#endif
+    string psstate;
+    fsAccessCMD->path2local(&sstate,&psstate);
+    int statepath = api->syncPathState(&psstate);
+
+    OUTSTREAM << getFixLengthString(getSyncActiveStateStr(thesync, n),10) << " ";
+    OUTSTREAM << getFixLengthString(getSyncPathStateStr(statepath),9) << " ";
+
+    OUTSTREAM << getRightAlignedString(sizeToText(api->getSize(n), false),8) << " ";
+
+    OUTSTREAM << getRightAlignedString(SSTR(nfiles),6) << " ";
+    OUTSTREAM << getRightAlignedString(SSTR(nfolders),6) << " ";
+
+    OUTSTREAM << endl;
+
+}
+
+void MegaCmdExecuter::doFind(MegaNode* nodeBase, const char *timeFormat, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions, string word, int printfileinfo, string pattern, bool usepcre, m_time_t minTime, m_time_t maxTime, int64_t minSize, int64_t maxSize)
+{
+    struct criteriaNodeVector pnv;
+    pnv.pattern = pattern;
+
+    vector<MegaNode *> listOfMatches;
+    pnv.nodesMatching = &listOfMatches;
+    pnv.usepcre = usepcre;
+
+    pnv.minTime = minTime;
+    pnv.maxTime = maxTime;
+    pnv.minSize = minSize;
+    pnv.maxSize = maxSize;
+
+
+    processTree(nodeBase, includeIfMatchesCriteria, (void*)&pnv);
+
+    bool ndjson = getOption(cloptions, "output", "") == "ndjson";
+
+    for (std::vector< MegaNode * >::iterator it = listOfMatches.begin(); it != listOfMatches.end(); ++it)
+    {
+        MegaNode * n = *it;
+        if (n)
+        {
+            if (ndjson)
+            {
+                dumpNodeNdjson(n, sandboxCMD->nodePathCache.getNodePath(api, n));
                 delete n;
+                continue;
+            }
+
+            string pathToShow;
+
+            if ( word.size() > 0 && ( (word.find("/") == 0) || (word.find("..") != string::npos)) )
+            {
+                pathToShow = sandboxCMD->nodePathCache.getNodePath(api, n);
             }
             else
             {
-                setCurrentOutCode(MCMD_NOTFOUND);
-                LOG_err << words[1] << ": No such file or directory";
+                pathToShow = getDisplayPath("", n);
             }
-        }
-        else
-        {
-            MegaNode * rootNode = api->getRootNode();
-            if (!rootNode)
+            if (printfileinfo)
             {
-                LOG_err << "nodes not fetched";
-                setCurrentOutCode(MCMD_NOFETCH);
-                delete rootNode;
-                return;
+                dumpNode(n, timeFormat, clflags, cloptions, 3, false, 1, pathToShow.c_str());
             }
-            cwd = rootNode->getHandle();
-            updateprompt(api);
+            else
+            {
+                OUTSTREAM << pathToShow;
 
-            delete rootNode;
+                if (getFlag(clflags, "show-handles"))
+                {
+                    std::unique_ptr<char []> handle {api->handleToBase64(n->getHandle())};
+                    OUTSTREAM << " <H:" << handle.get() << ">";
+                }
+
+                OUTSTREAM << endl;
+            }
+            //notice: some nodes may be dumped twice
+
+            delete n;
         }
+    }
+
+    listOfMatches.clear();
+}
+
+string MegaCmdExecuter::getLPWD()
+{
+    string relativePath = ".";
+    string absolutePath = "Unknown";
+    LocalPath localRelativePath = LocalPath::fromPath(relativePath, *fsAccessCMD);
+    LocalPath localAbsolutePath;
+    if (fsAccessCMD->expanselocalpath(localRelativePath, localAbsolutePath))
+    {
+        absolutePath = localAbsolutePath.toPath(*fsAccessCMD);
+    }
+
+    return absolutePath;
+}
+
+
+void MegaCmdExecuter::move(MegaNode * n, string destiny)
+{
+    MegaNode* tn; //target node
+    string newname;
 
+    // source node must exist
+    if (!n)
+    {
         return;
     }
-    else if (words[0] == "rm")
+
+
+    char * nodepath = api->getNodePath(n);
+    LOG_debug << "Moving : " << nodepath << " to " << destiny;
+    delete []nodepath;
+
+    // we have four situations:
+    // 1. target path does not exist - fail
+    // 2. target node exists and is folder - move
+    // 3. target node exists and is file - delete and rename (unless same)
+    // 4. target path exists, but filename does not - rename
+    if (( tn = nodebypath(destiny.c_str(), NULL, &newname)))
     {
-        if (!api->isFilesystemAvailable())
+        if (tn->getHandle() == n->getHandle())
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            LOG_err << "Source and destiny are the same";
         }
-        if (words.size() > 1)
+        else
         {
-            if (interactiveThread() && nodesToConfirmDelete.size())
+            if (newname.size()) //target not found, but tn has what was before the last "/" in the path.
             {
-                //clear all previous nodes to confirm delete (could have been not cleared in case of ctrl+c)
-                for (std::vector< MegaNode * >::iterator it = nodesToConfirmDelete.begin(); it != nodesToConfirmDelete.end(); ++it)
+                if (tn->getType() == MegaNode::TYPE_FILE)
                 {
-                    delete *it;
+                    setCurrentOutCode(MCMD_INVALIDTYPE);
+                    LOG_err << destiny << ": Not a directory";
+                    delete tn;
+                    delete n;
+                    return;
                 }
-                nodesToConfirmDelete.clear();
-            }
-
-            bool force = getFlag(clflags, "f");
-            bool none = false;
-
-            for (unsigned int i = 1; i < words.size(); i++)
-            {
-                unescapeifRequired(words[i]);
-                if (isRegExp(words[i]))
+                else //move and rename!
                 {
-                    vector<MegaNode *> *nodesToDelete = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
-                    if (nodesToDelete->size())
+                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                    api->moveNode(n, tn, megaCmdListener);
+                    megaCmdListener->wait();
+                    if (checkNoErrors(megaCmdListener->getError(), "move"))
                     {
-                        for (std::vector< MegaNode * >::iterator it = nodesToDelete->begin(); !none && it != nodesToDelete->end(); ++it)
-                        {
-                            MegaNode * nodeToDelete = *it;
-                            if (nodeToDelete)
-                            {
-                                int confirmationCode = deleteNode(nodeToDelete, api, getFlag(clflags, "r"), force);
-                                if (confirmationCode == MCMDCONFIRM_ALL)
-                                {
-                                    force = true;
-                                }
-                                else if (confirmationCode == MCMDCONFIRM_NONE)
-                                {
-                                    none = true;
-                                }
-
-                            }
-                        }
-                        nodesToDelete->clear();
+                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                        api->renameNode(n, newname.c_str(), megaCmdListener);
+                        megaCmdListener->wait();
+                        checkNoErrors(megaCmdListener->getError(), "rename");
+                        delete megaCmdListener;
                     }
                     else
                     {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        LOG_err << words[i] << ": No such file or directory";
+                        LOG_debug << "Won't rename, since move failed " << n->getName() << " to " << tn->getName() << " : " << megaCmdListener->getError()->getErrorCode();
                     }
-                    delete nodesToDelete;
+                    delete megaCmdListener;
                 }
-                else if (!none)
+            }
+            else //target found
+            {
+                if (tn->getType() == MegaNode::TYPE_FILE) //move & remove old & rename new
                 {
-                    MegaNode * nodeToDelete = nodebypath(words[i].c_str());
-                    if (nodeToDelete)
+                    // (there should never be any orphaned filenodes)
+                    MegaNode *tnParentNode = api->getNodeByHandle(tn->getParentHandle());
+                    if (tnParentNode)
                     {
-                        int confirmationCode = deleteNode(nodeToDelete, api, getFlag(clflags, "r"), force);
-                        if (confirmationCode == MCMDCONFIRM_ALL)
-                        {
-                            force = true;
-                        }
-                        else if (confirmationCode == MCMDCONFIRM_NONE)
-                        {
-                            none = true;
-                        }
-                    }
-                    else
+                        delete tnParentNode;
+
+                        //move into the parent of target node
+                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                        std::unique_ptr<MegaNode> parentNode {api->getNodeByHandle(tn->getParentHandle())};
+                        api->moveNode(n, parentNode.get(), megaCmdListener);
+                        megaCmdListener->wait();
+                        if (checkNoErrors(megaCmdListener->getError(), "move node"))
+                        {
+                            const char* name_to_replace = tn->getName();
+
+                            //remove (replaced) target node
+                            if (n != tn) //just in case moving to same location
+                            {
+                                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                                api->remove(tn, megaCmdListener); //remove target node
+                                megaCmdListener->wait();
+                                if (!checkNoErrors(megaCmdListener->getError(), "remove target node"))
+                                {
+                                    LOG_err << "Couldnt move " << n->getName() << " to " << tn->getName() << " : " << megaCmdListener->getError()->getErrorCode();
+                                }
+                                delete megaCmdListener;
+                            }
+
+                            // rename moved node with the new name
+                            if (strcmp(name_to_replace, n->getName()))
+                            {
+                                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                                api->renameNode(n, name_to_replace, megaCmdListener);
+                                megaCmdListener->wait();
+                                if (!checkNoErrors(megaCmdListener->getError(), "rename moved node"))
+                                {
+                                    LOG_err << "Failed to rename moved node: " << megaCmdListener->getError()->getErrorString();
+                                }
+                                delete megaCmdListener;
+                            }
+                        }
+                        delete megaCmdListener;
+                    }
+                    else
                     {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        LOG_err << words[i] << ": No such file or directory";
+                        setCurrentOutCode(MCMD_INVALIDSTATE);
+                        LOG_fatal << "Destiny node is orphan!!!";
                     }
                 }
+                else // target is a folder
+                {
+                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                    api->moveNode(n, tn, megaCmdListener);
+                    megaCmdListener->wait();
+                    checkNoErrors(megaCmdListener->getError(), "move node");
+                    delete megaCmdListener;
+                }
             }
         }
-        else
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("rm");
-        }
-
-        return;
+        delete tn;
     }
-    else if (words[0] == "mv")
+    else //target not found (not even its folder), cant move
     {
-        if (!api->isFilesystemAvailable())
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << destiny << ": No such directory";
+    }
+}
+
+
+bool MegaCmdExecuter::isValidFolder(string destiny)
+{
+    bool isdestinyavalidfolder = true;
+    MegaNode *ndestiny = nodebypath(destiny.c_str());;
+    if (ndestiny)
+    {
+        if (ndestiny->getType() == MegaNode::TYPE_FILE)
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            isdestinyavalidfolder = false;
         }
-        if (words.size() > 2)
-        {
-            string destiny = words[words.size()-1];
-            unescapeifRequired(destiny);
-
-            if (words.size() > 3 && !isValidFolder(destiny))
-            {
-                setCurrentOutCode(MCMD_INVALIDTYPE);
-                LOG_err << destiny << " must be a valid folder";
-                return;
-            }
+        delete ndestiny;
+    }
+    else
+    {
+        isdestinyavalidfolder = false;
+    }
+    return isdestinyavalidfolder;
+}
 
-            for (unsigned int i=1;i<(words.size()-1);i++)
+void MegaCmdExecuter::restartsyncs()
+{
+    std::lock_guard<std::recursive_mutex> g(ConfigurationManager::settingsMutex);
+    map<string, sync_struct *>::iterator itr;
+    for (itr = ConfigurationManager::configuredSyncs.begin(); itr != ConfigurationManager::configuredSyncs.end(); ++itr)
+    {
+        string key = ( *itr ).first;
+        sync_struct *thesync = ((sync_struct*)( *itr ).second );
+        if (thesync->active)
+        {
+            MegaNode * n = api->getNodeByHandle(thesync->handle);
+            if (n)
             {
-                string source = words[i];
-                unescapeifRequired(source);
+                char * nodepath = api->getNodePath(n);
+                LOG_info << "Restarting sync "<< key << ": " << nodepath;
+                delete []nodepath;
+                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                api->disableSync(n, megaCmdListener);
+                megaCmdListener->wait();
 
-                if (isRegExp(source))
+                if (checkNoErrors(megaCmdListener->getError(), "stop sync"))
                 {
-                    vector<MegaNode *> *nodesToList = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
-                    if (nodesToList)
+                    thesync->active = false;
+
+                    MegaSync *msync = api->getSyncByNode(n);
+                    if (!msync)
                     {
-                        if (!nodesToList->size())
-                        {
-                            setCurrentOutCode(MCMD_NOTFOUND);
-                            LOG_err << source << ": No such file or directory";
-                        }
+                        MegaCmdListener *megaCmdListener2 = new MegaCmdListener(NULL);
+                        api->syncFolder(thesync->localpath.c_str(), n, megaCmdListener2);
+                        megaCmdListener2->wait();
 
-                        bool destinyisok=true;
-                        if (nodesToList->size() > 1 && !isValidFolder(destiny))
+                        if (checkNoErrors(megaCmdListener2->getError(), "resume sync"))
                         {
-                            destinyisok = false;
-                            setCurrentOutCode(MCMD_INVALIDTYPE);
-                            LOG_err << destiny << " must be a valid folder";
-                        }
+                            thesync->active = true;
+                            thesync->loadedok = true;
 
-                        if (destinyisok)
-                        {
-                            for (std::vector< MegaNode * >::iterator it = nodesToList->begin(); it != nodesToList->end(); ++it)
+                            if (megaCmdListener2->getRequest()->getNumber())
                             {
-                                MegaNode * n = *it;
-                                if (n)
-                                {
-                                    move(n, destiny);
-                                    delete n;
-                                }
+                                thesync->fingerprint = megaCmdListener2->getRequest()->getNumber();
                             }
                         }
-
-                        nodesToList->clear();
-                        delete nodesToList;
-                    }
-                }
-                else
-                {
-                    if (( n = nodebypath(source.c_str())) )
-                    {
-                        move(n, destiny);
-                        delete n;
+                        else
+                        {
+                            thesync->active = false;
+                            thesync->loadedok = false;
+                        }
+                        delete megaCmdListener2;
+                        delete msync;
                     }
                     else
                     {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        LOG_err << source << ": No such file or directory";
+                        setCurrentOutCode(MCMD_INVALIDSTATE);
+                        LOG_err << "Failed to restart sync: " << key << ". You will need to manually reenable or restart MEGAcmd";
                     }
                 }
+                delete megaCmdListener;
+                delete n;
             }
-
         }
-        else
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("mv");
-        }
-
-        return;
     }
-    else if (words[0] == "cp")
+}
+
+std::string MegaCmdExecuter::getNodePathString(MegaNode *n)
+{
+    const char *path = api->getNodePath(n);
+    string toret(path);
+    delete[] path;
+    return toret;
+}
+
+void MegaCmdExecuter::copyNode(MegaNode *n, string destiny, MegaNode * tn, string &targetuser, string &newname)
+{
+    if (tn)
     {
-        if (!api->isFilesystemAvailable())
+        if (tn->getHandle() == n->getHandle())
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            LOG_err << "Source and destiny are the same";
         }
-        if (words.size() > 2)
+        else
         {
-            string destiny = words[words.size()-1];
-            string targetuser;
-            string newname;
-            MegaNode *tn = nodebypath(destiny.c_str(), &targetuser, &newname);
-
-            if (words.size() > 3 && !isValidFolder(destiny) && !targetuser.size())
-            {
-                setCurrentOutCode(MCMD_INVALIDTYPE);
-                LOG_err << destiny << " must be a valid folder";
-                return;
-            }
-
-            for (unsigned int i=1;i<(words.size()-1);i++)
+            if (newname.size()) //target not found, but tn has what was before the last "/" in the path.
             {
-                string source = words[i];
-
-                if (isRegExp(source))
+                if (n->getType() == MegaNode::TYPE_FILE)
+                {
+                    LOG_debug << "copy with new name: \"" << getNodePathString(n) << "\" to \"" << destiny << "\" newname=" << newname;
+                    //copy with new name
+                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                    api->copyNode(n, tn, newname.c_str(), megaCmdListener); //only works for files
+                    megaCmdListener->wait();
+                    checkNoErrors(megaCmdListener->getError(), "copy node");
+                    delete megaCmdListener;
+                }
+                else //copy & rename
                 {
-                    vector<MegaNode *> *nodesToCopy = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
-                    if (nodesToCopy)
+                    LOG_debug << "copy & rename: \"" << getNodePathString(n) << "\" to \"" << destiny << "\"";
+                    //copy with new name
+                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                    api->copyNode(n, tn, megaCmdListener);
+                    megaCmdListener->wait();
+                    if (checkNoErrors(megaCmdListener->getError(), "copy node"))
                     {
-                        if (!nodesToCopy->size())
+                        MegaNode * newNode = api->getNodeByHandle(megaCmdListener->getRequest()->getNodeHandle());
+                        if (newNode)
                         {
-                            setCurrentOutCode(MCMD_NOTFOUND);
-                            LOG_err << source << ": No such file or directory";
+                            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                            api->renameNode(newNode, newname.c_str(), megaCmdListener);
+                            megaCmdListener->wait();
+                            checkNoErrors(megaCmdListener->getError(), "rename new node");
+                            delete megaCmdListener;
+                            delete newNode;
                         }
-
-                        bool destinyisok=true;
-                        if (nodesToCopy->size() > 1 && !isValidFolder(destiny) && !targetuser.size())
+                        else
                         {
-                            destinyisok = false;
-                            setCurrentOutCode(MCMD_INVALIDTYPE);
-                            LOG_err << destiny << " must be a valid folder";
+                            LOG_err << " Couldn't find new node created upon cp";
                         }
+                    }
+                    delete megaCmdListener;
+                }
+            }
+            else
+            { //target exists
+                if (tn->getType() == MegaNode::TYPE_FILE)
+                {
+                    if (n->getType() == MegaNode::TYPE_FILE)
+                    {
+                        LOG_debug << "overwriding target: \"" << getNodePathString(n) << "\" to \"" << destiny << "\"";
 
-                        if (destinyisok)
+                        // overwrite target if source and target are files
+                        MegaNode *tnParentNode = api->getNodeByHandle(tn->getParentHandle());
+                        if (tnParentNode) // (there should never be any orphaned filenodes)
                         {
-                            for (std::vector< MegaNode * >::iterator it = nodesToCopy->begin(); it != nodesToCopy->end(); ++it)
+                            const char* name_to_replace = tn->getName();
+                            //copy with new name
+                            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                            api->copyNode(n, tnParentNode, name_to_replace, megaCmdListener);
+                            megaCmdListener->wait();
+                            if (checkNoErrors(megaCmdListener->getError(), "copy with new name") )
                             {
-                                MegaNode * n = *it;
-                                if (n)
+                                MegaHandle newNodeHandle = megaCmdListener->getRequest()->getNodeHandle();
+                                delete megaCmdListener;
+                                delete tnParentNode;
+
+                                //remove target node
+                                if (tn->getHandle() != newNodeHandle )//&& newNodeHandle != n->getHandle())
                                 {
-                                    copyNode(n, destiny, tn, targetuser, newname);
-                                    delete n;
+                                    megaCmdListener = new MegaCmdListener(NULL);
+                                    api->remove(tn, megaCmdListener);
+                                    megaCmdListener->wait();
+                                    checkNoErrors(megaCmdListener->getError(), "delete target node");
+                                    delete megaCmdListener;
                                 }
                             }
                         }
-                        nodesToCopy->clear();
-                        delete nodesToCopy;
+                        else
+                        {
+                            setCurrentOutCode(MCMD_INVALIDSTATE);
+                            LOG_fatal << "Destiny node is orphan!!!";
+                        }
+                    }
+                    else
+                    {
+                        setCurrentOutCode(MCMD_INVALIDTYPE);
+                        LOG_err << "Cannot overwrite file with folder";
+                        return;
                     }
                 }
-                else if (( n = nodebypath(source.c_str())))
-                {
-                    copyNode(n, destiny, tn, targetuser, newname);
-                    delete n;
-                }
-                else
+                else //copying into folder
                 {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << source << ": No such file or directory";
+                    LOG_debug << "Copying into folder: \"" << getNodePathString(n) << "\" to \"" << destiny << "\"";
+
+                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                    api->copyNode(n, tn, megaCmdListener);
+                    megaCmdListener->wait();
+                    checkNoErrors(megaCmdListener->getError(), "copy node");
+                    delete megaCmdListener;
                 }
             }
-            delete tn;
-        }
-        else
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("cp");
         }
+    }
+    else if (targetuser.size())
+    {
+        LOG_debug << "Sending to user: \"" << getNodePathString(n) << "\" to \"" << targetuser << "\"";
 
-        return;
+        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+        api->sendFileToUser(n,targetuser.c_str(),megaCmdListener);
+        megaCmdListener->wait();
+        checkNoErrors(megaCmdListener->getError(), "send file to user");
+        delete megaCmdListener;
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << destiny << " Couldn't find destination";
     }
-    else if (words[0] == "du")
+}
+
+
+#ifdef ENABLE_BACKUPS
+bool MegaCmdExecuter::establishBackup(string pathToBackup, MegaNode *n, int64_t period, string speriod,  int numBackups)
+{
+    bool attendpastbackups = true; //TODO: receive as parameter
+    static int backupcounter = 0;
+    LocalPath localrelativepath = LocalPath::fromPath(pathToBackup, *fsAccessCMD);
+    LocalPath localabsolutepath;
+    fsAccessCMD->expanselocalpath(localrelativepath, localabsolutepath);
+
+    MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
+    api->setBackup(localabsolutepath.toPath(*fsAccessCMD).c_str(), n, attendpastbackups, period, speriod.c_str(), numBackups, megaCmdListener);
+    megaCmdListener->wait();
+    if (checkNoErrors(megaCmdListener->getError(), "establish backup"))
     {
-        if (!api->isFilesystemAvailable())
-        {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
-        }
+        mtxBackupsMap.lock();
 
-        int PATHSIZE = getintOption(cloptions,"path-display-size");
-        if (!PATHSIZE)
+        backup_struct *thebackup = NULL;
+        if (ConfigurationManager::configuredBackups.find(megaCmdListener->getRequest()->getFile()) != ConfigurationManager::configuredBackups.end())
         {
-            // get screen size for output purposes
-            unsigned int width = getNumberOfCols(75);
-            PATHSIZE = min(50,int(width-22));
+            thebackup = ConfigurationManager::configuredBackups[megaCmdListener->getRequest()->getFile()];
+            if (thebackup->id == -1)
+            {
+                thebackup->id = backupcounter++;
+            }
         }
-        PATHSIZE = max(0, PATHSIZE);
-
-        long long totalSize = 0;
-        long long currentSize = 0;
-        long long totalVersionsSize = 0;
-        string dpath;
-        if (words.size() == 1)
+        else
         {
-            words.push_back(".");
+            thebackup = new backup_struct;
+            thebackup->id = backupcounter++;
+            ConfigurationManager::configuredBackups[megaCmdListener->getRequest()->getFile()] = thebackup;
         }
+        thebackup->active = true;
+        thebackup->handle = megaCmdListener->getRequest()->getNodeHandle();
+        thebackup->localpath = string(megaCmdListener->getRequest()->getFile());
+        thebackup->numBackups = numBackups;
+        thebackup->period = period;
+        thebackup->speriod = speriod;
+        thebackup->failed = false;
+        thebackup->tag = megaCmdListener->getRequest()->getTransferTag();
 
-        bool humanreadable = getFlag(clflags, "h");
-        bool show_versions_size = getFlag(clflags, "versions");
-        bool firstone = true;
+        char * nodepath = api->getNodePath(n);
+        LOG_info << "Added backup: " << megaCmdListener->getRequest()->getFile() << " to " << nodepath;
+        mtxBackupsMap.unlock();
+        delete []nodepath;
+        delete megaCmdListener;
 
-        for (unsigned int i = 1; i < words.size(); i++)
+        startFingerprintVerifier();
+
+        return true;
+    }
+    else
+    {
+        std::lock_guard<std::recursive_mutex> g(mtxBackupsMap);
+        bool foundbytag = false;
+        // find by tag in configured (modification failed)
+        for (std::map<std::string, backup_struct *>::iterator itr = ConfigurationManager::configuredBackups.begin();
+             itr != ConfigurationManager::configuredBackups.end(); itr++)
         {
-            unescapeifRequired(words[i]);
-            if (isRegExp(words[i]))
+            if (itr->second->tag == megaCmdListener->getRequest()->getTransferTag())
             {
-                vector<MegaNode *> *nodesToList = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
-                if (nodesToList)
-                {
-                    for (std::vector< MegaNode * >::iterator it = nodesToList->begin(); it != nodesToList->end(); ++it)
-                    {
-                        MegaNode * n = *it;
-                        if (n)
-                        {
-                            if (firstone)//print header
-                            {
-                                OUTSTREAM << getFixLengthString("FILENAME",PATHSIZE) << getFixLengthString("SIZE", 12, ' ', true);
-                                if (show_versions_size)
-                                {
-                                    OUTSTREAM << getFixLengthString("S.WITH VERS", 12, ' ', true);;
-                                }
-                                OUTSTREAM << endl;
-                                firstone = false;
-                            }
-                            currentSize = api->getSize(n);
-                            totalSize += currentSize;
+                backup_struct *thebackup = itr->second;
 
-                            dpath = getDisplayPath(words[i], n);
-                            OUTSTREAM << getFixLengthString(dpath+":",PATHSIZE) << getFixLengthString(sizeToText(currentSize, true, humanreadable), 12, ' ', true);
-                            if (show_versions_size)
-                            {
-                                long long sizeWithVersions = getVersionsSize(n);
-                                OUTSTREAM << getFixLengthString(sizeToText(sizeWithVersions, true, humanreadable), 12, ' ', true);
-                                totalVersionsSize += sizeWithVersions;
-                            }
+                foundbytag = true;
+                thebackup->handle = megaCmdListener->getRequest()->getNodeHandle();
+                thebackup->localpath = string(megaCmdListener->getRequest()->getFile());
+                thebackup->numBackups = megaCmdListener->getRequest()->getNumRetry();
+                thebackup->period = megaCmdListener->getRequest()->getNumber();
+                thebackup->speriod = string(megaCmdListener->getRequest()->getText());;
+                thebackup->failed = true;
+            }
+        }
 
-                            OUTSTREAM << endl;
-                            delete n;
-                        }
-                    }
 
-                    nodesToList->clear();
-                    delete nodesToList;
-                }
-            }
-            else
+        if (!foundbytag)
+        {
+            std::map<std::string, backup_struct *>::iterator itr = ConfigurationManager::configuredBackups.find(megaCmdListener->getRequest()->getFile());
+            if ( itr != ConfigurationManager::configuredBackups.end())
             {
-                if (!( n = nodebypath(words[i].c_str())))
-                {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << words[i] << ": No such file or directory";
-                    return;
-                }
-
-                currentSize = api->getSize(n);
-                totalSize += currentSize;
-                dpath = getDisplayPath(words[i], n);
-                if (dpath.size())
+                if (megaCmdListener->getError()->getErrorCode() != MegaError::API_EEXIST)
                 {
-                    if (firstone)//print header
-                    {
-                        OUTSTREAM << getFixLengthString("FILENAME",PATHSIZE) << getFixLengthString("SIZE", 12, ' ', true);
-                        if (show_versions_size)
-                        {
-                            OUTSTREAM << getFixLengthString("S.WITH VERS", 12, ' ', true);;
-                        }
-                        OUTSTREAM << endl;
-                        firstone = false;
-                    }
-
-                    OUTSTREAM << getFixLengthString(dpath+":",PATHSIZE) << getFixLengthString(sizeToText(currentSize, true, humanreadable), 12, ' ', true);
-                    if (show_versions_size)
-                    {
-                        long long sizeWithVersions = getVersionsSize(n);
-                        OUTSTREAM << getFixLengthString(sizeToText(sizeWithVersions, true, humanreadable), 12, ' ', true);
-                        totalVersionsSize += sizeWithVersions;
-                    }
-                    OUTSTREAM << endl;
-
+                    itr->second->failed = true;
                 }
-                delete n;
+                itr->second->id = backupcounter++;
             }
         }
+    }
+    delete megaCmdListener;
+    return false;
+}
+#endif
+
+void MegaCmdExecuter::confirmCancel(const char* confirmlink, const char* pass)
+{
+    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+    api->confirmCancelAccount(confirmlink, pass, megaCmdListener);
+    megaCmdListener->wait();
+    if (megaCmdListener->getError()->getErrorCode() == MegaError::API_ETOOMANY)
+    {
+        LOG_err << "Confirm cancel account failed: too many attempts";
+    }
+    else if (megaCmdListener->getError()->getErrorCode() == MegaError::API_ENOENT
+             || megaCmdListener->getError()->getErrorCode() == MegaError::API_EKEY)
+    {
+        LOG_err << "Confirm cancel account failed: invalid link/password";
+    }
+    else if (checkNoErrors(megaCmdListener->getError(), "confirm cancel account"))
+    {
+        OUTSTREAM << "CONFIRM Account cancelled succesfully" << endl;
+        MegaCmdListener *megaCmdListener2 = new MegaCmdListener(NULL);
+        api->localLogout(megaCmdListener2);
+        actUponLogout(megaCmdListener2, false);
+        delete megaCmdListener2;
+    }
+    delete megaCmdListener;
+}
+
+void MegaCmdExecuter::processPath(string path, bool usepcre, bool &firstone, void (*nodeprocessor)(MegaCmdExecuter *, MegaNode *, bool), MegaCmdExecuter *context)
+{
 
-        if (!firstone)
+    if (isRegExp(path))
+    {
+        vector<MegaNode *> *nodes = nodesbypath(path.c_str(), usepcre);
+        if (nodes)
         {
-            for (int i = 0; i < PATHSIZE+12 +(show_versions_size?12:0) ; i++)
+            if (!nodes->size())
             {
-                OUTSTREAM << "-";
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Path not found: " << path;
             }
-            OUTSTREAM << endl;
-
-            OUTSTREAM << getFixLengthString("Total storage used:",PATHSIZE) << getFixLengthString(sizeToText(totalSize, true, humanreadable), 12, ' ', true);
-            //OUTSTREAM << "Total storage used: " << setw(22) << sizeToText(totalSize, true, humanreadable);
-            if (show_versions_size)
+            for (std::vector< MegaNode * >::iterator it = nodes->begin(); it != nodes->end(); ++it)
             {
-                OUTSTREAM << getFixLengthString(sizeToText(totalVersionsSize, true, humanreadable), 12, ' ', true);
+                MegaNode * n = *it;
+                if (n)
+                {
+                    nodeprocessor(context, n, firstone);
+                    firstone = false;
+                    delete n;
+                }
+                else
+                {
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << "Path not found: " << path;
+                    return;
+                }
             }
-            OUTSTREAM << endl;
         }
-        return;
     }
-    else if (words[0] == "cat")
+    else // non-regexp
     {
-        if (words.size() < 2)
+        MegaNode *n = nodebypath(path.c_str());
+        if (n)
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("cat");
+            nodeprocessor(context, n, firstone);
+            firstone = false;
+            delete n;
+        }
+        else
+        {
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << "Path not found: " << path;
             return;
         }
+    }
+}
 
-        for (int i = 1; i < (int)words.size(); i++)
-        {
-            if (isPublicLink(words[i]))
-            {
-                string publicLink = words[i];
-                if (isEncryptedLink(publicLink))
-                {
-                    string linkPass = getOption(cloptions, "password", "");
-                    if (!linkPass.size())
-                    {
-                        linkPass = askforUserResponse("Enter password: ");
-                    }
 
-                    if (linkPass.size())
-                    {
-                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                        api->decryptPasswordProtectedLink(publicLink.c_str(), linkPass.c_str(), megaCmdListener);
-                        megaCmdListener->wait();
-                        if (checkNoErrors(megaCmdListener->getError(), "decrypt password protected link"))
-                        {
-                            publicLink = megaCmdListener->getRequest()->getText();
-                            delete megaCmdListener;
-                        }
-                        else
-                        {
-                            setCurrentOutCode(MCMD_NOTPERMITTED);
-                            LOG_err << "Invalid password";
-                            delete megaCmdListener;
-                            return;
-                        }
-                    }
-                    else
-                    {
-                        setCurrentOutCode(MCMD_EARGS);
-                        LOG_err << "Need a password to decrypt provided link (--password=PASSWORD)";
-                        return;
+#ifdef HAVE_LIBUV
+
+void forwarderRemoveWebdavLocation(MegaCmdExecuter* context, MegaNode *n, bool firstone) {
+    context->removeWebdavLocation(n, firstone);
+}
+void forwarderAddWebdavLocation(MegaCmdExecuter* context, MegaNode *n, bool firstone) {
+    context->addWebdavLocation(n, firstone);
+}
+void forwarderRemoveFtpLocation(MegaCmdExecuter* context, MegaNode *n, bool firstone) {
+    context->removeFtpLocation(n, firstone);
+}
+void forwarderAddFtpLocation(MegaCmdExecuter* context, MegaNode *n, bool firstone) {
+    context->addFtpLocation(n, firstone);
+}
+
+void MegaCmdExecuter::removeWebdavLocation(MegaNode *n, bool firstone, string name)
+{
+    char *actualNodePath = api->getNodePath(n);
+    api->httpServerRemoveWebDavAllowedNode(n->getHandle());
+
+    mtxWebDavLocations.lock();
+    list<string> servedpaths = ConfigurationManager::getConfigurationValueList("webdav_served_locations");
+    size_t sizeprior = servedpaths.size();
+    servedpaths.remove(actualNodePath);
+    size_t sizeafter = servedpaths.size();
+    if (!sizeafter)
+    {
+        api->httpServerStop();
+        ConfigurationManager::savePropertyValue("webdav_port", -1); //so as not to load server on startup
+    }
+    ConfigurationManager::savePropertyValueList("webdav_served_locations", servedpaths);
+    mtxWebDavLocations.unlock();
+
+    if (sizeprior != sizeafter)
+    {
+        OUTSTREAM << (name.size()?name:actualNodePath) << " no longer served via webdav" << endl;
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << (name.size()?name:actualNodePath) << " is not served via webdav";
+    }
+    delete []actualNodePath;
+}
+
+void MegaCmdExecuter::addWebdavLocation(MegaNode *n, bool firstone, string name)
+{
+    char *actualNodePath = api->getNodePath(n);
+    char *l = api->httpServerGetLocalWebDavLink(n);
+    OUTSTREAM << "Serving via webdav " << (name.size()?name:actualNodePath) << ": " << l << endl;
+
+    mtxWebDavLocations.lock();
+    list<string> servedpaths = ConfigurationManager::getConfigurationValueList("webdav_served_locations");
+    servedpaths.push_back(actualNodePath);
+    servedpaths.sort();
+    servedpaths.unique();
+    ConfigurationManager::savePropertyValueList("webdav_served_locations", servedpaths);
+    mtxWebDavLocations.unlock();
+
+    delete []l;
+    delete []actualNodePath;
+}
+
+void MegaCmdExecuter::removeFtpLocation(MegaNode *n, bool firstone, string name)
+{
+    char *actualNodePath = api->getNodePath(n);
+    api->ftpServerRemoveAllowedNode(n->getHandle());
+
+    mtxFtpLocations.lock();
+    list<string> servedpaths = ConfigurationManager::getConfigurationValueList("ftp_served_locations");
+    size_t sizeprior = servedpaths.size();
+    servedpaths.remove(actualNodePath);
+    size_t sizeafter = servedpaths.size();
+    if (!sizeafter)
+    {
+        api->ftpServerStop();
+        ConfigurationManager::savePropertyValue("ftp_port", -1); //so as not to load server on startup
+    }
+    ConfigurationManager::savePropertyValueList("ftp_served_locations", servedpaths);
+    mtxFtpLocations.unlock();
+
+    if (sizeprior != sizeafter)
+    {
+        OUTSTREAM << (name.size()?name:actualNodePath) << " no longer served via ftp" << endl;
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << (name.size()?name:actualNodePath)  << " is not served via ftp";
+    }
+    delete []actualNodePath;
+}
+
+void MegaCmdExecuter::addFtpLocation(MegaNode *n, bool firstone, string name)
+{
+    char *actualNodePath = api->getNodePath(n);
+    char *l = api->ftpServerGetLocalLink(n);
+    OUTSTREAM << "Serving via ftp " << (name.size()?name:n->getName())  << ": " << l << endl;
+
+    mtxFtpLocations.lock();
+    list<string> servedpaths = ConfigurationManager::getConfigurationValueList("ftp_served_locations");
+    servedpaths.push_back(actualNodePath);
+    servedpaths.sort();
+    servedpaths.unique();
+    ConfigurationManager::savePropertyValueList("ftp_served_locations", servedpaths);
+    mtxFtpLocations.unlock();
+
+    delete []l;
+    delete []actualNodePath;
+}
+
+#endif
+
+
+void MegaCmdExecuter::catFile(MegaNode *n)
+{
+    if (n->getType() != MegaNode::TYPE_FILE)
+    {
+        LOG_err << " Unable to cat: not a file";
+        setCurrentOutCode(MCMD_EARGS);
+        return;
+    }
+
+    long long nsize = api->getSize(n);
+    if (!nsize)
+    {
+        return;
+    }
+
+    loadBlockCache();
+    if (!blockCache.isEnabled())
+    {
+        streamFile(n, 0, nsize, &OUTSTREAM, false);
+        return;
+    }
+
+    // cached blocks are served from disk, and runs of missing ones are streamed and cached
+    MegaHandle h = n->getHandle();
+    string fingerprint = n->getFingerprint() ? n->getFingerprint() : "";
+    long long nblocks = (nsize + LocalBlockCache::BLOCK_SIZE - 1) / LocalBlockCache::BLOCK_SIZE;
+    string data;
+    for (long long block = 0; block < nblocks && OUTSTREAM.isClientConnected(); )
+    {
+        if (blockCache.readBlock(h, fingerprint, nsize, block, &data))
+        {
+            OUTSTREAM << data;
+            block++;
+            continue;
+        }
+
+        long long end = block + 1;
+        while (end < nblocks && !blockCache.hasBlock(h, fingerprint, nsize, end, true))
+        {
+            end++;
+        }
+        if (!streamFile(n, block * LocalBlockCache::BLOCK_SIZE, std::min(nsize, end * LocalBlockCache::BLOCK_SIZE), &OUTSTREAM, true))
+        {
+            break;
+        }
+        block = end;
+    }
+    blockCache.flush();
+}
+
+/**
+ * @brief Streams a range of a file into a stream and/or the block cache
+ * @param ls stream to write the contents to. If NULL, contents are only cached
+ * @param cache whether to keep the contents in the block cache. Then, start must be the beginning of a block
+ * @return true if the whole range was streamed
+ */
+bool MegaCmdExecuter::streamFile(MegaNode *n, long long start, long long end, LoggedStream *ls, bool cache)
+{
+    MegaCmdCatTransferListener *mcctl = new MegaCmdCatTransferListener(ls, api, sandboxCMD);
+    if (cache)
+    {
+        mcctl->setBlockCache(&blockCache, n, start);
+    }
+    api->startStreaming(n, start, end-start, mcctl);
+    mcctl->wait();
+    bool streamed = checkNoErrors(mcctl->getError(), "cat streaming from " +SSTR(start) + " to " + SSTR(end) );
+    if (streamed)
+    {
+        char * npath = api->getNodePath(n);
+        LOG_verbose << "Streamed: " << (npath ? npath : "") << " from " << start << " to " << end;
+        delete []npath;
+    }
+
+    delete mcctl;
+    return streamed;
+}
+
+/**
+ * @brief Streams a whole file to compute the SHA-256 of its contents, without storing them
+ * @return true if the whole file was streamed
+ */
+bool MegaCmdExecuter::hashFileContents(MegaNode *n, string *digest)
+{
+    std::unique_ptr<MegaCmdHashTransferListener> listener {new MegaCmdHashTransferListener(api, sandboxCMD)};
+    api->startStreaming(n, 0, n->getSize(), listener.get());
+    listener->wait();
+    if (!checkNoErrors(listener->getError(), "download the contents of " + sandboxCMD->nodePathCache.getNodePath(api, n)))
+    {
+        return false;
+    }
+    *digest = listener->getDigest();
+    return true;
+}
+
+/**
+ * @brief Downloads into the block cache the blocks of a file that are not there yet
+ * @return true if all of them were downloaded
+ */
+bool MegaCmdExecuter::prefetchFile(MegaNode *n)
+{
+    MegaHandle h = n->getHandle();
+    string fingerprint = n->getFingerprint() ? n->getFingerprint() : "";
+    long long nsize = api->getSize(n);
+    long long nblocks = (nsize + LocalBlockCache::BLOCK_SIZE - 1) / LocalBlockCache::BLOCK_SIZE;
+    for (long long block = 0; block < nblocks; )
+    {
+        if (blockCache.hasBlock(h, fingerprint, nsize, block))
+        {
+            block++;
+            continue;
+        }
+
+        long long end = block + 1;
+        while (end < nblocks && !blockCache.hasBlock(h, fingerprint, nsize, end))
+        {
+            end++;
+        }
+        if (!streamFile(n, block * LocalBlockCache::BLOCK_SIZE, std::min(nsize, end * LocalBlockCache::BLOCK_SIZE), NULL, true))
+        {
+            return false;
+        }
+        block = end;
+    }
+    return true;
+}
+
+void MegaCmdExecuter::loadBlockCache()
+{
+    blockCache.load(ConfigurationManager::getConfigFolder() + "/" + "blockcache");
+}
+
+/**
+ * @brief Queues a subtree to be prefetched, starting the prefetcher thread if needed.
+ * Jobs are run one after the other, each of them walking its tree in parallel.
+ */
+void MegaCmdExecuter::queuePrefetch(std::shared_ptr<PrefetchJob> job)
+{
+    std::lock_guard<std::mutex> g(prefetchMutex);
+    prefetchQueue.push_back(job);
+    prefetchJobs.push_back(job);
+    while (prefetchJobs.size() > 10 && prefetchJobs.front()->finished)
+    {
+        prefetchJobs.pop_front();
+    }
+    prefetchCV.notify_all();
+
+    if (prefetchThread.joinable() || stopPrefetcher)
+    {
+        return;
+    }
+    prefetchThread = std::thread([this]()
+    {
+        std::unique_lock<std::mutex> lock(prefetchMutex);
+        for (;;)
+        {
+            prefetchCV.wait(lock, [this]() { return stopPrefetcher || !prefetchQueue.empty(); });
+            if (stopPrefetcher)
+            {
+                break;
+            }
+            std::shared_ptr<PrefetchJob> next = prefetchQueue.front();
+            prefetchQueue.pop_front();
+            lock.unlock();
+
+            next->running = true;
+            prefetchTree(next.get());
+            next->running = false;
+            next->finished = true;
+
+            lock.lock();
+        }
+    });
+}
+
+/**
+ * @brief Walks a subtree so that the following commands find it warm: the paths of its nodes are
+ * cached, as well as the media info of its files. Files up to job->blocksUnder bytes are downloaded
+ * into the block cache.
+ */
+void MegaCmdExecuter::prefetchTree(PrefetchJob *job)
+{
+    std::unique_ptr<MegaNode> root {api->getNodeByHandle(job->handle)};
+    if (!root)
+    {
+        informStateListener("Prefetch of " + job->path + " failed: node not found", job->clientID);
+        return;
+    }
+
+    bool warmBlocks = job->blocksUnder >= 0 && blockCache.isEnabled();
+    auto warmFile = [this, job, warmBlocks](MegaNode *file)
+    {
+        job->files++;
+        sandboxCMD->mediaInfoCache.getMediaInfo(file);
+        if (warmBlocks && file->getSize() <= job->blocksUnder && prefetchFile(file))
+        {
+            job->cachedFiles++;
+        }
+    };
+
+    sandboxCMD->nodePathCache.getNodePath(api, root.get());
+    if (root->getType() == MegaNode::TYPE_FILE)
+    {
+        warmFile(root.get());
+    }
+    else
+    {
+        walkTreeInParallel(root.get(), ConfigurationManager::getConfigurationValue("prefetch_parallelism", 4), [&](MegaNode *, MegaNodeList *children)
+        {
+            for (int i = 0; children && i < children->size() && !stopPrefetcher; i++)
+            {
+                MegaNode *child = children->get(i);
+                sandboxCMD->nodePathCache.getNodePath(api, child);
+                if (child->getType() == MegaNode::TYPE_FILE)
+                {
+                    warmFile(child);
+                }
+                else
+                {
+                    job->foldersFound++;
+                }
+            }
+            job->foldersVisited++;
+        },
+        [job]()
+        {
+            informProgressUpdate(job->foldersVisited, job->foldersFound, job->clientID, "Prefetching");
+        },
+        [this](MegaNode *)
+        {
+            return !stopPrefetcher;
+        });
+    }
+    blockCache.flush();
+
+    if (!stopPrefetcher)
+    {
+        informProgressUpdate(job->foldersFound, job->foldersFound, job->clientID, "Prefetching");
+        informStateListener("Prefetch of " + job->path + " complete: " + SSTR(job->foldersVisited.load()) + " folders, "
+                            + SSTR(job->files.load()) + " files" + (warmBlocks ? ", " + SSTR(job->cachedFiles.load()) + " in the block cache" : ""),
+                            job->clientID);
+    }
+}
+
+void MegaCmdExecuter::printInfoFile(const string &nodepath, MegaHandle h, const MediaInfoCache::MediaInfo &info, bool &firstone, int PATHSIZE, bool ndjson)
+{
+    if (!info.hasAttributes)
+    {
+        LOG_warn << " Unable to get attributes for node " << nodepath;
+    }
+
+    if (ndjson)
+    {
+        std::unique_ptr<char[]> handle {api->handleToBase64(h)};
+        NdjsonLine line;
+        line.addString("handle", handle.get());
+        line.addString("path", nodepath);
+        line.addNumber("width", info.width);
+        line.addNumber("height", info.height);
+        line.addNumber("fps", info.fps);
+        line.addNumber("playtime", info.playtime);
+        if (info.hasAttributes)
+        {
+            line.addNumber("shortformat", info.shortformat);
+            line.addNumber("container_id", info.containerid);
+            line.addNumber("videocodec_id", info.videocodecid);
+            line.addNumber("audiocodec_id", info.audiocodecid);
+        }
+        OUTSTREAM << line.str();
+        return;
+    }
+
+    if (firstone)
+    {
+        OUTSTREAM << getFixLengthString("FILE", PATHSIZE);
+        OUTSTREAM << getFixLengthString("WIDTH", 7);
+        OUTSTREAM << getFixLengthString("HEIGHT", 7);
+        OUTSTREAM << getFixLengthString("FPS", 4);
+        OUTSTREAM << getFixLengthString("PLAYTIME", 10);
+        OUTSTREAM << endl;
+        firstone = false;
+    }
+
+    OUTSTREAM << getFixLengthString(nodepath, PATHSIZE-1) << " ";
+
+    OUTSTREAM << getFixLengthString( (info.width == -1) ? "---" : SSTR(info.width) , 6) << " ";
+    OUTSTREAM << getFixLengthString( (info.height == -1) ? "---" : SSTR(info.height) , 6) << " ";
+    OUTSTREAM << getFixLengthString( (info.fps == 0) ? "---" : SSTR(info.fps) , 3) << " ";
+    OUTSTREAM << getFixLengthString( (info.playtime == -1) ? "---" : getReadablePeriod(info.playtime) , 10) << " ";
+
+    OUTSTREAM << endl;
+}
+
+bool MegaCmdExecuter::printUserAttribute(int a, string user, bool onlylist)
+{
+    const char *catrn = api->userAttributeToString(a);
+    string attrname = catrn;
+    delete [] catrn;
+
+    const char *catrln = api->userAttributeToLongName(a);
+    string longname = catrln;
+    delete [] catrln;
+
+    if (attrname.size())
+    {
+        if (onlylist)
+        {
+            OUTSTREAM << longname << " (" << attrname << ")" << endl;
+        }
+        else
+        {
+            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+            if (user.size())
+            {
+                api->getUserAttribute(user.c_str(), a, megaCmdListener);
+            }
+            else
+            {
+                api->getUserAttribute(a, megaCmdListener);
+            }
+            megaCmdListener->wait();
+            if (checkNoErrors(megaCmdListener->getError(), string("get user attribute ") + attrname))
+            {
+                int iattr = megaCmdListener->getRequest()->getParamType();
+                const char *value = megaCmdListener->getRequest()->getText();
+                //if (!value) value = megaCmdListener->getRequest()->getMegaStringMap()->;
+                string svalue;
+                try
+                {
+                    if (value)
+                    {
+                        svalue = string(value);
+                    }
+                    else
+                    {
+
+                        svalue = "NOT PRINTABLE";
+                    }
+
+                }
+                catch (exception e)
+                {
+                    svalue = "NOT PRINTABLE";
+                }
+                OUTSTREAM << "\t" << longname << " (" << attrname << ")" << " = " << svalue << endl;
+            }
+
+            delete megaCmdListener;
+        }
+        return true;
+    }
+    return false;
+}
+
+bool MegaCmdExecuter::setProxy(const std::string &url, const std::string &username, const std::string &password, int proxyType)
+{
+    MegaProxy mpx;
+
+    if (url.size())
+    {
+        mpx.setProxyURL(url.c_str());
+    }
+
+    if (username.size())
+    {
+        mpx.setCredentials(username.c_str(), password.c_str());
+    }
+
+    mpx.setProxyType(proxyType);
+
+    std::vector<MegaApi *> megaapis;
+    //TODO: add apiFolders to that list
+    megaapis.push_back(api);
+    bool failed = false;
+    for (auto api: megaapis)
+    {
+        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+        api->setProxySettings(&mpx, megaCmdListener);
+        megaCmdListener->wait();
+        if (checkNoErrors(megaCmdListener->getError(), "(un)setting proxy"))
+        {
+            //TODO: connectivity check! // review connectivity check branch
+        }
+        else
+        {
+            failed = true;
+        }
+        delete megaCmdListener;
+    }
+
+    if (!failed)
+    {
+        ConfigurationManager::savePropertyValue("proxy_url", mpx.getProxyURL()?mpx.getProxyURL():"");
+        ConfigurationManager::savePropertyValue("proxy_type", mpx.getProxyType());
+
+        ConfigurationManager::savePropertyValue("proxy_username", mpx.getUsername()?mpx.getUsername():"");
+        ConfigurationManager::savePropertyValue("proxy_password", mpx.getPassword()?mpx.getPassword():"");
+
+        if (mpx.getProxyType() == MegaProxy::PROXY_NONE)
+        {
+            OUTSTREAM << "Proxy unset correctly" << endl ;
+        }
+        else
+        {
+            OUTSTREAM << "Proxy set: " << (mpx.getProxyURL()?mpx.getProxyURL():"")
+                      << " type = " << getProxyTypeStr(mpx.getProxyType()) << endl;
+
+            broadcastMessage(string("Using proxy: ").append((mpx.getProxyURL()?mpx.getProxyURL():""))
+                             .append(" type = ").append(getProxyTypeStr(mpx.getProxyType())), true);
+        }
+    }
+    else
+    {
+        LOG_err << "Unable to configure proxy";
+        broadcastMessage("Unable to configure proxy", true);
+    }
+
+    return !failed;
+}
+
+const std::unordered_map<std::string, MegaCmdExecuter::CommandHandler> &MegaCmdExecuter::getCommandHandlers()
+{
+    static const std::unordered_map<std::string, CommandHandler> handlers {
+        { "ls", &MegaCmdExecuter::executeLs },
+        { "find", &MegaCmdExecuter::executeFind },
+#if defined(_WIN32) || defined(__APPLE__)
+        { "update", &MegaCmdExecuter::executeUpdate },
+#endif
+        { "cd", &MegaCmdExecuter::executeCd },
+        { "rm", &MegaCmdExecuter::executeRm },
+        { "mv", &MegaCmdExecuter::executeMv },
+        { "cp", &MegaCmdExecuter::executeCp },
+        { "du", &MegaCmdExecuter::executeDu },
+        { "cat", &MegaCmdExecuter::executeCat },
+        { "mediainfo", &MegaCmdExecuter::executeMediainfo },
+        { "get", &MegaCmdExecuter::executeGet },
+#ifdef ENABLE_BACKUPS
+        { "backup", &MegaCmdExecuter::executeBackup },
+#endif
+        { "put", &MegaCmdExecuter::executePut },
+        { "log", &MegaCmdExecuter::executeLog },
+        { "pwd", &MegaCmdExecuter::executePwd },
+        { "lcd", &MegaCmdExecuter::executeLcd },
+        { "lpwd", &MegaCmdExecuter::executeLpwd },
+        { "ipc", &MegaCmdExecuter::executeIpc },
+        { "https", &MegaCmdExecuter::executeHttps },
+        { "graphics", &MegaCmdExecuter::executeGraphics },
+#ifndef _WIN32
+        { "permissions", &MegaCmdExecuter::executePermissions },
+#endif
+        { "deleteversions", &MegaCmdExecuter::executeDeleteversions },
+        { "dedup", &MegaCmdExecuter::executeDedup },
+        { "diff", &MegaCmdExecuter::executeDiff },
+        { "blockcache", &MegaCmdExecuter::executeBlockcache },
+        { "prefetch", &MegaCmdExecuter::executePrefetch },
+#ifdef HAVE_LIBUV
+        { "webdav", &MegaCmdExecuter::executeWebdav },
+        { "ftp", &MegaCmdExecuter::executeFtp },
+#endif
+#ifdef ENABLE_SYNC
+        { "exclude", &MegaCmdExecuter::executeExclude },
+        { "sync", &MegaCmdExecuter::executeSync },
+#endif
+        { "cancel", &MegaCmdExecuter::executeCancel },
+        { "confirmcancel", &MegaCmdExecuter::executeConfirmcancel },
+        { "login", &MegaCmdExecuter::executeLogin },
+        { "psa", &MegaCmdExecuter::executePsa },
+        { "mount", &MegaCmdExecuter::executeMount },
+        { "share", &MegaCmdExecuter::executeShare },
+        { "users", &MegaCmdExecuter::executeUsers },
+        { "mkdir", &MegaCmdExecuter::executeMkdir },
+        { "attr", &MegaCmdExecuter::executeAttr },
+        { "userattr", &MegaCmdExecuter::executeUserattr },
+        { "thumbnail", &MegaCmdExecuter::executeThumbnail },
+        { "preview", &MegaCmdExecuter::executePreview },
+        { "tree", &MegaCmdExecuter::executeTree },
+        { "debug", &MegaCmdExecuter::executeDebug },
+        { "passwd", &MegaCmdExecuter::executePasswd },
+        { "speedlimit", &MegaCmdExecuter::executeSpeedlimit },
+        { "invite", &MegaCmdExecuter::executeInvite },
+        { "errorcode", &MegaCmdExecuter::executeErrorcode },
+        { "signup", &MegaCmdExecuter::executeSignup },
+        { "whoami", &MegaCmdExecuter::executeWhoami },
+        { "df", &MegaCmdExecuter::executeDf },
+        { "export", &MegaCmdExecuter::executeExport },
+        { "import", &MegaCmdExecuter::executeImport },
+        { "reload", &MegaCmdExecuter::executeReload },
+        { "logout", &MegaCmdExecuter::executeLogout },
+        { "confirm", &MegaCmdExecuter::executeConfirm },
+        { "session", &MegaCmdExecuter::executeSession },
+        { "history", &MegaCmdExecuter::executeHistory },
+        { "version", &MegaCmdExecuter::executeVersion },
+        { "masterkey", &MegaCmdExecuter::executeMasterkey },
+        { "showpcr", &MegaCmdExecuter::executeShowpcr },
+        { "killsession", &MegaCmdExecuter::executeKillsession },
+        { "transfers", &MegaCmdExecuter::executeTransfers },
+        { "locallogout", &MegaCmdExecuter::executeLocallogout },
+        { "proxy", &MegaCmdExecuter::executeProxy },
+        { "startup", &MegaCmdExecuter::executeStartup },
+    };
+    return handlers;
+}
+
+void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    const auto &handlers = getCommandHandlers();
+    auto it = handlers.find(words[0]);
+    if (it == handlers.end())
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "Invalid command: " << words[0];
+        return;
+    }
+
+    (this->*(it->second))(words, clflags, cloptions);
+}
+
+void MegaCmdExecuter::executeLs(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    MegaNode* n = NULL;
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    int recursive = getFlag(clflags, "R") + getFlag(clflags, "r");
+    int extended_info = getFlag(clflags, "a");
+    int show_versions = getFlag(clflags, "versions");
+    bool summary = getFlag(clflags, "l");
+    bool firstprint = true;
+    bool humanreadable = getFlag(clflags, "h");
+    bool treelike = getFlag(clflags,"tree");
+    recursive += treelike?1:0;
+
+    MegaCmdOutputFormat outputFormat;
+    if (!getOutputFormat(cloptions, &outputFormat))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        return;
+    }
+    bool ndjson = outputFormat == MCMDOUTPUT_NDJSON;
+
+    if ((int)words.size() > 1)
+    {
+        unescapeifRequired(words[1]);
+
+        string rNpath = "NULL";
+        if (words[1].find('/') != string::npos)
+        {
+            string cwpath = getCurrentPath();
+            if (words[1].find(cwpath) == string::npos)
+            {
+                rNpath = "";
+            }
+            else
+            {
+                rNpath = cwpath;
+            }
+        }
+
+        if (isRegExp(words[1]))
+        {
+            vector<string> *pathsToList = nodesPathsbypath(words[1].c_str(), getFlag(clflags,"use-pcre"));
+            if (pathsToList && pathsToList->size())
+            {
+                for (std::vector< string >::iterator it = pathsToList->begin(); it != pathsToList->end(); ++it)
+                {
+                    string nodepath= *it;
+                    MegaNode *ncwd = api->getNodeByHandle(cwd);
+                    if (ncwd)
+                    {
+                        MegaNode * n = nodebypath(nodepath.c_str());
+                        if (n)
+                        {
+                            if (ndjson)
+                            {
+                                dumpTreeNdjson(n, recursive, show_versions);
+                                delete n;
+                                delete ncwd;
+                                continue;
+                            }
+                            if (!n->getType() == MegaNode::TYPE_FILE)
+                            {
+                                OUTSTREAM << nodepath << ": " << endl;
+                            }
+                            if (summary)
+                            {
+                                if (firstprint)
+                                {
+                                    dumpNodeSummaryHeader(getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions);
+                                    firstprint = false;
+                                }
+                                dumpTreeSummary(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions, recursive, show_versions, 0, humanreadable, rNpath);
+                            }
+                            else
+                            {
+                                vector<bool> lfs;
+                                dumptree(n, treelike, lfs, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, recursive, extended_info, show_versions, 0, rNpath);
+                            }
+                            if (( !n->getType() == MegaNode::TYPE_FILE ) && (( it + 1 ) != pathsToList->end()))
+                            {
+                                OUTSTREAM << endl;
+                            }
+                            delete n;
+                        }
+                        else
+                        {
+                            LOG_debug << "Unexpected: matching path has no associated node: " << nodepath << ". Could have been deleted in the process";
+                        }
+                        delete ncwd;
+                    }
+                    else
+                    {
+                        setCurrentOutCode(MCMD_INVALIDSTATE);
+                        LOG_err << "Couldn't find woking folder (it might been deleted)";
+                    }
+                }
+                pathsToList->clear();
+                delete pathsToList;
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Couldn't find \"" << words[1] << "\"";
+            }
+        }
+        else
+        {
+            n = nodebypath(words[1].c_str());
+            if (n)
+            {
+                if (ndjson)
+                {
+                    dumpTreeNdjson(n, recursive, show_versions);
+                }
+                else if (summary)
+                {
+                    if (firstprint)
+                    {
+                        dumpNodeSummaryHeader(getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions);
+                        firstprint = false;
+                    }
+                    dumpTreeSummary(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions, recursive, show_versions, 0, humanreadable, rNpath);
+                }
+                else
+                {
+                    if (treelike) OUTSTREAM << words[1] << endl;
+                    vector<bool> lfs;
+                    dumptree(n, treelike, lfs, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, recursive, extended_info, show_versions, 0, rNpath);
+                }
+                delete n;
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Couldn't find " << words[1];
+            }
+        }
+    }
+    else
+    {
+        n = api->getNodeByHandle(cwd);
+        if (n)
+        {
+            if (ndjson)
+            {
+                dumpTreeNdjson(n, recursive, show_versions);
+            }
+            else if (summary)
+            {
+                if (firstprint)
+                {
+                    dumpNodeSummaryHeader(getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions);
+                    firstprint = false;
+                }
+                dumpTreeSummary(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","SHORT")), clflags, cloptions, recursive, show_versions, 0, humanreadable);
+            }
+            else
+            {
+                if (treelike) OUTSTREAM << "." << endl;
+                vector<bool> lfs;
+                dumptree(n, treelike, lfs, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, recursive, extended_info, show_versions);
+            }
+            delete n;
+        }
+    }
+    return;
+}
+
+void MegaCmdExecuter::executeFind(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    MegaNode* n = NULL;
+    string pattern = getOption(cloptions, "pattern", "*");
+    int printfileinfo = getFlag(clflags,"l");
+
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+
+    MegaCmdOutputFormat outputFormat;
+    if (!getOutputFormat(cloptions, &outputFormat))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        return;
+    }
+
+    m_time_t minTime = -1;
+    m_time_t maxTime = -1;
+    string mtimestring = getOption(cloptions, "mtime", "");
+    if ("" != mtimestring && !getMinAndMaxTime(mtimestring, &minTime, &maxTime))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "Invalid time " << mtimestring;
+        return;
+    }
+
+    int64_t minSize = -1;
+    int64_t maxSize = -1;
+    string sizestring = getOption(cloptions, "size", "");
+    if ("" != sizestring && !getMinAndMaxSize(sizestring, &minSize, &maxSize))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "Invalid time " << sizestring;
+        return;
+    }
+
+
+    if (words.size() <= 1)
+    {
+        n = api->getNodeByHandle(cwd);
+        doFind(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, "", printfileinfo, pattern, getFlag(clflags,"use-pcre"), minTime, maxTime, minSize, maxSize);
+        delete n;
+    }
+    for (int i = 1; i < (int)words.size(); i++)
+    {
+        if (isRegExp(words[i]))
+        {
+            vector<MegaNode *> *nodesToFind = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
+            if (nodesToFind->size())
+            {
+                for (std::vector< MegaNode * >::iterator it = nodesToFind->begin(); it != nodesToFind->end(); ++it)
+                {
+                    MegaNode * nodeToFind = *it;
+                    if (nodeToFind)
+                    {
+                        doFind(nodeToFind, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i], printfileinfo, pattern, getFlag(clflags,"use-pcre"), minTime, maxTime, minSize, maxSize);
+                        delete nodeToFind;
+                    }
+                }
+                nodesToFind->clear();
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << words[i] << ": No such file or directory";
+            }
+            delete nodesToFind;
+        }
+        else
+        {
+            n = nodebypath(words[i].c_str());
+            if (!n)
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Couldn't find " << words[i];
+            }
+            else
+            {
+                doFind(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i], printfileinfo, pattern, getFlag(clflags,"use-pcre"), minTime, maxTime, minSize, maxSize);
+                delete n;
+            }
+        }
+    }
+}
+
+#if defined(_WIN32) || defined(__APPLE__)
+void MegaCmdExecuter::executeUpdate(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    string sauto = getOption(cloptions, "auto", "");
+    transform(sauto.begin(), sauto.end(), sauto.begin(), ::tolower);
+
+    if (sauto == "off")
+    {
+        stopcheckingForUpdates();
+        OUTSTREAM << "Automatic updates disabled" << endl;
+    }
+    else if (sauto == "on")
+    {
+        startcheckingForUpdates();
+        OUTSTREAM << "Automatic updates enabled" << endl;
+    }
+    else if (sauto == "query")
+    {
+        OUTSTREAM << "Automatic updates " << (ConfigurationManager::getConfigurationValue("autoupdate", false)?"enabled":"disabled") << endl;
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("update");
+    }
+
+    return;
+}
+#endif
+
+void MegaCmdExecuter::executeCd(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    MegaNode* n = NULL;
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    if (words.size() > 1)
+    {
+        if (( n = nodebypath(words[1].c_str())))
+        {
+            if (n->getType() == MegaNode::TYPE_FILE)
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << words[1] << ": Not a directory";
+            }
+            else
+            {
+                cwd = n->getHandle();
+
+                updateprompt(api);
+            }
+            delete n;
+        }
+        else
+        {
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << words[1] << ": No such file or directory";
+        }
+    }
+    else
+    {
+        MegaNode * rootNode = api->getRootNode();
+        if (!rootNode)
+        {
+            LOG_err << "nodes not fetched";
+            setCurrentOutCode(MCMD_NOFETCH);
+            delete rootNode;
+            return;
+        }
+        cwd = rootNode->getHandle();
+        updateprompt(api);
+
+        delete rootNode;
+    }
+
+    return;
+}
+
+void MegaCmdExecuter::executeRm(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    if (words.size() > 1)
+    {
+        if (interactiveThread() && nodesToConfirmDelete.size())
+        {
+            //clear all previous nodes to confirm delete (could have been not cleared in case of ctrl+c)
+            for (std::vector< MegaNode * >::iterator it = nodesToConfirmDelete.begin(); it != nodesToConfirmDelete.end(); ++it)
+            {
+                delete *it;
+            }
+            nodesToConfirmDelete.clear();
+        }
+
+        bool force = getFlag(clflags, "f");
+        bool none = false;
+
+        for (unsigned int i = 1; i < words.size(); i++)
+        {
+            unescapeifRequired(words[i]);
+            if (isRegExp(words[i]))
+            {
+                vector<MegaNode *> *nodesToDelete = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
+                if (nodesToDelete->size())
+                {
+                    for (std::vector< MegaNode * >::iterator it = nodesToDelete->begin(); !none && it != nodesToDelete->end(); ++it)
+                    {
+                        MegaNode * nodeToDelete = *it;
+                        if (nodeToDelete)
+                        {
+                            int confirmationCode = deleteNode(nodeToDelete, api, getFlag(clflags, "r"), force);
+                            if (confirmationCode == MCMDCONFIRM_ALL)
+                            {
+                                force = true;
+                            }
+                            else if (confirmationCode == MCMDCONFIRM_NONE)
+                            {
+                                none = true;
+                            }
+
+                        }
+                    }
+                    nodesToDelete->clear();
+                }
+                else
+                {
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << words[i] << ": No such file or directory";
+                }
+                delete nodesToDelete;
+            }
+            else if (!none)
+            {
+                MegaNode * nodeToDelete = nodebypath(words[i].c_str());
+                if (nodeToDelete)
+                {
+                    int confirmationCode = deleteNode(nodeToDelete, api, getFlag(clflags, "r"), force);
+                    if (confirmationCode == MCMDCONFIRM_ALL)
+                    {
+                        force = true;
+                    }
+                    else if (confirmationCode == MCMDCONFIRM_NONE)
+                    {
+                        none = true;
+                    }
+                }
+                else
+                {
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << words[i] << ": No such file or directory";
+                }
+            }
+        }
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("rm");
+    }
+
+    return;
+}
+
+void MegaCmdExecuter::executeMv(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    MegaNode* n = NULL;
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    if (words.size() > 2)
+    {
+        string destiny = words[words.size()-1];
+        unescapeifRequired(destiny);
+
+        if (words.size() > 3 && !isValidFolder(destiny))
+        {
+            setCurrentOutCode(MCMD_INVALIDTYPE);
+            LOG_err << destiny << " must be a valid folder";
+            return;
+        }
+
+        for (unsigned int i=1;i<(words.size()-1);i++)
+        {
+            string source = words[i];
+            unescapeifRequired(source);
+
+            if (isRegExp(source))
+            {
+                vector<MegaNode *> *nodesToList = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
+                if (nodesToList)
+                {
+                    if (!nodesToList->size())
+                    {
+                        setCurrentOutCode(MCMD_NOTFOUND);
+                        LOG_err << source << ": No such file or directory";
+                    }
+
+                    bool destinyisok=true;
+                    if (nodesToList->size() > 1 && !isValidFolder(destiny))
+                    {
+                        destinyisok = false;
+                        setCurrentOutCode(MCMD_INVALIDTYPE);
+                        LOG_err << destiny << " must be a valid folder";
+                    }
+
+                    if (destinyisok)
+                    {
+                        for (std::vector< MegaNode * >::iterator it = nodesToList->begin(); it != nodesToList->end(); ++it)
+                        {
+                            MegaNode * n = *it;
+                            if (n)
+                            {
+                                move(n, destiny);
+                                delete n;
+                            }
+                        }
+                    }
+
+                    nodesToList->clear();
+                    delete nodesToList;
+                }
+            }
+            else
+            {
+                if (( n = nodebypath(source.c_str())) )
+                {
+                    move(n, destiny);
+                    delete n;
+                }
+                else
+                {
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << source << ": No such file or directory";
+                }
+            }
+        }
+
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("mv");
+    }
+
+    return;
+}
+
+void MegaCmdExecuter::executeCp(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    MegaNode* n = NULL;
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    if (words.size() > 2)
+    {
+        string destiny = words[words.size()-1];
+        string targetuser;
+        string newname;
+        MegaNode *tn = nodebypath(destiny.c_str(), &targetuser, &newname);
+
+        if (words.size() > 3 && !isValidFolder(destiny) && !targetuser.size())
+        {
+            setCurrentOutCode(MCMD_INVALIDTYPE);
+            LOG_err << destiny << " must be a valid folder";
+            return;
+        }
+
+        for (unsigned int i=1;i<(words.size()-1);i++)
+        {
+            string source = words[i];
+
+            if (isRegExp(source))
+            {
+                vector<MegaNode *> *nodesToCopy = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
+                if (nodesToCopy)
+                {
+                    if (!nodesToCopy->size())
+                    {
+                        setCurrentOutCode(MCMD_NOTFOUND);
+                        LOG_err << source << ": No such file or directory";
+                    }
+
+                    bool destinyisok=true;
+                    if (nodesToCopy->size() > 1 && !isValidFolder(destiny) && !targetuser.size())
+                    {
+                        destinyisok = false;
+                        setCurrentOutCode(MCMD_INVALIDTYPE);
+                        LOG_err << destiny << " must be a valid folder";
+                    }
+
+                    if (destinyisok)
+                    {
+                        for (std::vector< MegaNode * >::iterator it = nodesToCopy->begin(); it != nodesToCopy->end(); ++it)
+                        {
+                            MegaNode * n = *it;
+                            if (n)
+                            {
+                                copyNode(n, destiny, tn, targetuser, newname);
+                                delete n;
+                            }
+                        }
+                    }
+                    nodesToCopy->clear();
+                    delete nodesToCopy;
+                }
+            }
+            else if (( n = nodebypath(source.c_str())))
+            {
+                copyNode(n, destiny, tn, targetuser, newname);
+                delete n;
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << source << ": No such file or directory";
+            }
+        }
+        delete tn;
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("cp");
+    }
+
+    return;
+}
+
+void MegaCmdExecuter::executeDu(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    MegaNode* n = NULL;
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+
+    int PATHSIZE = getintOption(cloptions,"path-display-size");
+    if (!PATHSIZE)
+    {
+        // get screen size for output purposes
+        unsigned int width = getNumberOfCols(75);
+        PATHSIZE = min(50,int(width-22));
+    }
+    PATHSIZE = max(0, PATHSIZE);
+
+    long long totalSize = 0;
+    long long currentSize = 0;
+    long long totalVersionsSize = 0;
+    string dpath;
+    if (words.size() == 1)
+    {
+        words.push_back(".");
+    }
+
+    bool humanreadable = getFlag(clflags, "h");
+    bool show_versions_size = getFlag(clflags, "versions");
+    bool firstone = true;
+
+    MegaCmdOutputFormat outputFormat;
+    if (!getOutputFormat(cloptions, &outputFormat))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        return;
+    }
+    bool ndjson = outputFormat == MCMDOUTPUT_NDJSON;
+
+    for (unsigned int i = 1; i < words.size(); i++)
+    {
+        unescapeifRequired(words[i]);
+        if (isRegExp(words[i]))
+        {
+            vector<MegaNode *> *nodesToList = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
+            if (nodesToList)
+            {
+                for (std::vector< MegaNode * >::iterator it = nodesToList->begin(); it != nodesToList->end(); ++it)
+                {
+                    MegaNode * n = *it;
+                    if (n)
+                    {
+                        if (ndjson)
+                        {
+                            printDuNdjson(n, show_versions_size);
+                            delete n;
+                            continue;
+                        }
+                        if (firstone)//print header
+                        {
+                            OUTSTREAM << getFixLengthString("FILENAME",PATHSIZE) << getFixLengthString("SIZE", 12, ' ', true);
+                            if (show_versions_size)
+                            {
+                                OUTSTREAM << getFixLengthString("S.WITH VERS", 12, ' ', true);;
+                            }
+                            OUTSTREAM << endl;
+                            firstone = false;
+                        }
+                        currentSize = api->getSize(n);
+                        totalSize += currentSize;
+
+                        dpath = getDisplayPath(words[i], n);
+                        OUTSTREAM << getFixLengthString(dpath+":",PATHSIZE) << getFixLengthString(sizeToText(currentSize, true, humanreadable), 12, ' ', true);
+                        if (show_versions_size)
+                        {
+                            long long sizeWithVersions = getVersionsSize(n);
+                            OUTSTREAM << getFixLengthString(sizeToText(sizeWithVersions, true, humanreadable), 12, ' ', true);
+                            totalVersionsSize += sizeWithVersions;
+                        }
+
+                        OUTSTREAM << endl;
+                        delete n;
+                    }
+                }
+
+                nodesToList->clear();
+                delete nodesToList;
+            }
+        }
+        else
+        {
+            if (!( n = nodebypath(words[i].c_str())))
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << words[i] << ": No such file or directory";
+                return;
+            }
+
+            if (ndjson)
+            {
+                printDuNdjson(n, show_versions_size);
+                delete n;
+                continue;
+            }
+
+            currentSize = api->getSize(n);
+            totalSize += currentSize;
+            dpath = getDisplayPath(words[i], n);
+            if (dpath.size())
+            {
+                if (firstone)//print header
+                {
+                    OUTSTREAM << getFixLengthString("FILENAME",PATHSIZE) << getFixLengthString("SIZE", 12, ' ', true);
+                    if (show_versions_size)
+                    {
+                        OUTSTREAM << getFixLengthString("S.WITH VERS", 12, ' ', true);;
+                    }
+                    OUTSTREAM << endl;
+                    firstone = false;
+                }
+
+                OUTSTREAM << getFixLengthString(dpath+":",PATHSIZE) << getFixLengthString(sizeToText(currentSize, true, humanreadable), 12, ' ', true);
+                if (show_versions_size)
+                {
+                    long long sizeWithVersions = getVersionsSize(n);
+                    OUTSTREAM << getFixLengthString(sizeToText(sizeWithVersions, true, humanreadable), 12, ' ', true);
+                    totalVersionsSize += sizeWithVersions;
+                }
+                OUTSTREAM << endl;
+
+            }
+            delete n;
+        }
+    }
+
+    if (!firstone)
+    {
+        for (int i = 0; i < PATHSIZE+12 +(show_versions_size?12:0) ; i++)
+        {
+            OUTSTREAM << "-";
+        }
+        OUTSTREAM << endl;
+
+        OUTSTREAM << getFixLengthString("Total storage used:",PATHSIZE) << getFixLengthString(sizeToText(totalSize, true, humanreadable), 12, ' ', true);
+        //OUTSTREAM << "Total storage used: " << setw(22) << sizeToText(totalSize, true, humanreadable);
+        if (show_versions_size)
+        {
+            OUTSTREAM << getFixLengthString(sizeToText(totalVersionsSize, true, humanreadable), 12, ' ', true);
+        }
+        OUTSTREAM << endl;
+    }
+    return;
+}
+
+void MegaCmdExecuter::executeCat(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (words.size() < 2)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("cat");
+        return;
+    }
+
+    for (int i = 1; i < (int)words.size(); i++)
+    {
+        if (isPublicLink(words[i]))
+        {
+            string publicLink = words[i];
+            if (isEncryptedLink(publicLink))
+            {
+                string linkPass = getOption(cloptions, "password", "");
+                if (!linkPass.size())
+                {
+                    linkPass = askforUserResponse("Enter password: ");
+                }
+
+                if (linkPass.size())
+                {
+                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                    api->decryptPasswordProtectedLink(publicLink.c_str(), linkPass.c_str(), megaCmdListener);
+                    megaCmdListener->wait();
+                    if (checkNoErrors(megaCmdListener->getError(), "decrypt password protected link"))
+                    {
+                        publicLink = megaCmdListener->getRequest()->getText();
+                        delete megaCmdListener;
+                    }
+                    else
+                    {
+                        setCurrentOutCode(MCMD_NOTPERMITTED);
+                        LOG_err << "Invalid password";
+                        delete megaCmdListener;
+                        return;
                     }
                 }
+                else
+                {
+                    setCurrentOutCode(MCMD_EARGS);
+                    LOG_err << "Need a password to decrypt provided link (--password=PASSWORD)";
+                    return;
+                }
+            }
 
-                if (getLinkType(publicLink) == MegaNode::TYPE_FILE)
-                {
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->getPublicNode(publicLink.c_str(), megaCmdListener);
-                    megaCmdListener->wait();
+            if (getLinkType(publicLink) == MegaNode::TYPE_FILE)
+            {
+                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                api->getPublicNode(publicLink.c_str(), megaCmdListener);
+                megaCmdListener->wait();
 
-                    if (!checkNoErrors(megaCmdListener->getError(), "cat public node"))
+                if (!checkNoErrors(megaCmdListener->getError(), "cat public node"))
+                {
+                    if (megaCmdListener->getError()->getErrorCode() == MegaError::API_EARGS)
                     {
-                        if (megaCmdListener->getError()->getErrorCode() == MegaError::API_EARGS)
-                        {
-                            LOG_err << "The link provided might be incorrect: " << publicLink.c_str();
-                        }
-                        else if (megaCmdListener->getError()->getErrorCode() == MegaError::API_EINCOMPLETE)
-                        {
-                            LOG_err << "The key is missing or wrong " << publicLink.c_str();
-                        }
+                        LOG_err << "The link provided might be incorrect: " << publicLink.c_str();
+                    }
+                    else if (megaCmdListener->getError()->getErrorCode() == MegaError::API_EINCOMPLETE)
+                    {
+                        LOG_err << "The key is missing or wrong " << publicLink.c_str();
+                    }
+                }
+                else
+                {
+                    if (megaCmdListener->getRequest()->getFlag())
+                    {
+                        LOG_err << "Key not valid " << publicLink.c_str();
+                        setCurrentOutCode(MCMD_EARGS);
                     }
                     else
                     {
-                        if (megaCmdListener->getRequest()->getFlag())
+                        MegaNode *n = megaCmdListener->getRequest()->getPublicMegaNode();
+                        if (n)
                         {
-                            LOG_err << "Key not valid " << publicLink.c_str();
-                            setCurrentOutCode(MCMD_EARGS);
+                            catFile(n);
+                            delete n;
                         }
-                        else
+                    }
+
+                }
+                delete megaCmdListener;
+            }
+            else //TODO: detect if referenced file within public link and in that case, do login and cat it
+            {
+                LOG_err << "Public link is not a file";
+                setCurrentOutCode(MCMD_EARGS);
+            }
+        }
+        else if (!api->isFilesystemAvailable())
+        {
+            setCurrentOutCode(MCMD_NOTLOGGEDIN);
+            LOG_err << "Unable to cat " << words[i] << ": Not logged in.";
+        }
+        else
+        {
+            unescapeifRequired(words[i]);
+            if (isRegExp(words[i]))
+            {
+                vector<MegaNode *> *nodes = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
+                if (nodes)
+                {
+                    if (!nodes->size())
+                    {
+                        setCurrentOutCode(MCMD_NOTFOUND);
+                        LOG_err << "Nodes not found: " << words[i];
+                    }
+                    for (std::vector< MegaNode * >::iterator it = nodes->begin(); it != nodes->end(); ++it)
+                    {
+                        MegaNode * n = *it;
+                        if (n)
                         {
-                            MegaNode *n = megaCmdListener->getRequest()->getPublicMegaNode();
-                            if (n)
-                            {
-                                catFile(n);
-                                delete n;
-                            }
+                            catFile(n);
+                            delete n;
                         }
-
                     }
-                    delete megaCmdListener;
                 }
-                else //TODO: detect if referenced file within public link and in that case, do login and cat it
+            }
+            else
+            {
+                MegaNode *n = nodebypath(words[i].c_str());
+                if (n)
+                {
+                    catFile(n);
+                    delete n;
+                }
+                else
                 {
-                    LOG_err << "Public link is not a file";
-                    setCurrentOutCode(MCMD_EARGS);
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << "Node not found: " << words[i];
+                }
+            }
+        }
+    }
+}
+
+void MegaCmdExecuter::executeBlockcache(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    bool pin = getFlag(clflags, "pin");
+    bool unpin = getFlag(clflags, "unpin");
+    bool prefetch = getFlag(clflags, "prefetch");
+    if (pin + unpin + prefetch > 1 || (pin + unpin + prefetch) != (words.size() > 1))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("blockcache");
+        return;
+    }
+
+    loadBlockCache();
+
+    string limit = getOption(cloptions, "limit", "");
+    if (limit.size())
+    {
+        long long bytes = textToSize(string(limit).c_str());
+        if (bytes == -1)
+        {
+            bytes = textToSize((limit + "B").c_str());
+        }
+        if (bytes < 0)
+        {
+            setCurrentOutCode(MCMD_EARGS);
+            LOG_err << "Invalid size: " << limit;
+            return;
+        }
+        ConfigurationManager::savePropertyValue("blockcache_size", bytes);
+        blockCache.setLimit(bytes);
+    }
+
+    if (getFlag(clflags, "clear"))
+    {
+        blockCache.clear();
+        OUTSTREAM << "Block cache cleared" << endl;
+    }
+
+    if (words.size() > 1)
+    {
+        if (!api->isFilesystemAvailable())
+        {
+            setCurrentOutCode(MCMD_NOTLOGGEDIN);
+            LOG_err << "Not logged in.";
+            return;
+        }
+        if (!unpin && !blockCache.isEnabled())
+        {
+            setCurrentOutCode(MCMD_INVALIDSTATE);
+            LOG_err << "Block cache is disabled. Set its size with \"blockcache --limit=SIZE\"";
+            return;
+        }
+
+        for (unsigned int i = 1; i < words.size(); i++)
+        {
+            vector<MegaNode *> nodes;
+            if (isRegExp(words[i]))
+            {
+                std::unique_ptr<vector<MegaNode *> > found {nodesbypath(words[i].c_str(), getFlag(clflags, "use-pcre"))};
+                if (found)
+                {
+                    nodes = *found;
                 }
             }
-            else if (!api->isFilesystemAvailable())
+            else if (MegaNode *n = nodebypath(words[i].c_str()))
             {
-                setCurrentOutCode(MCMD_NOTLOGGEDIN);
-                LOG_err << "Unable to cat " << words[i] << ": Not logged in.";
+                nodes.push_back(n);
             }
-            else
+            if (nodes.empty())
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Node not found: " << words[i];
+                continue;
+            }
+
+            for (auto n : nodes)
+            {
+                std::unique_ptr<MegaNode> node {n};
+                string path = sandboxCMD->nodePathCache.getNodePath(api, node.get());
+                if (node->getType() != MegaNode::TYPE_FILE)
+                {
+                    setCurrentOutCode(MCMD_INVALIDTYPE);
+                    LOG_err << "Not a file: " << path;
+                    continue;
+                }
+
+                string fingerprint = node->getFingerprint() ? node->getFingerprint() : "";
+                if (unpin)
+                {
+                    blockCache.setPinned(node->getHandle(), fingerprint, node->getSize(), false);
+                    OUTSTREAM << "Unpinned: " << path << endl;
+                    continue;
+                }
+
+                if (pin && !blockCache.setPinned(node->getHandle(), fingerprint, node->getSize(), true))
+                {
+                    setCurrentOutCode(MCMD_INVALIDSTATE);
+                    LOG_err << path << " not pinned: the pinned files would not fit in the block cache";
+                    continue;
+                }
+                else if (node->getSize() > blockCache.getLimit())
+                {
+                    LOG_warn << path << " does not fit in the block cache: only its last blocks will be kept";
+                }
+                if (prefetchFile(node.get()))
+                {
+                    OUTSTREAM << (pin ? "Pinned: " : "Prefetched: ") << path << endl;
+                }
+                else
+                {
+                    setCurrentOutCode(MCMD_EUNEXPECTED);
+                    LOG_err << "Failed to download " << path << " into the block cache";
+                }
+            }
+        }
+        blockCache.flush();
+        return;
+    }
+
+    long long used = blockCache.getUsedBytes();
+    if (!blockCache.isEnabled())
+    {
+        OUTSTREAM << "Block cache disabled. Set its size with \"blockcache --limit=SIZE\" to enable it" << endl;
+    }
+    else
+    {
+        OUTSTREAM << "Block cache: " << sizeToText(used, false) << " used of " << sizeToText(blockCache.getLimit(), false)
+                  << " (" << blockCache.getFileCount() << " files)" << endl;
+    }
+
+    unsigned long long hits = blockCache.getHits();
+    unsigned long long misses = blockCache.getMisses();
+    OUTSTREAM << "Blocks read: " << hits << " from cache, " << misses << " downloaded";
+    if (hits + misses)
+    {
+        OUTSTREAM << " (" << percentageToText(float(hits) / (hits + misses)) << " hit ratio)";
+    }
+    OUTSTREAM << ". " << sizeToText(blockCache.getBytesSaved(), false) << " not downloaded again" << endl;
+
+    vector<MegaHandle> pinned = blockCache.getPinned();
+    if (pinned.size())
+    {
+        OUTSTREAM << "Pinned files:" << endl;
+        for (auto h : pinned)
+        {
+            string path = sandboxCMD->nodePathCache.getNodePath(api, h);
+            if (!path.size())
+            {
+                std::unique_ptr<char[]> handle {api->handleToBase64(h)};
+                path = string("<H:") + handle.get() + ">";
+            }
+            OUTSTREAM << "  " << path << endl;
+        }
+    }
+}
+
+void MegaCmdExecuter::executePrefetch(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (words.size() < 2)
+    {
+        std::lock_guard<std::mutex> g(prefetchMutex);
+        if (prefetchJobs.empty())
+        {
+            OUTSTREAM << "No prefetch has been requested" << endl;
+            return;
+        }
+        OUTSTREAM << getFixLengthString("PATH", 40) << " " << getFixLengthString("STATE", 9) << " "
+                  << getFixLengthString("FOLDERS", 15, ' ', true) << " " << getFixLengthString("FILES", 10, ' ', true) << " "
+                  << getFixLengthString("CACHED", 10, ' ', true) << endl;
+        for (auto &job : prefetchJobs)
+        {
+            const char *state = job->finished ? "DONE" : (job->running ? "RUNNING" : "QUEUED");
+            OUTSTREAM << getFixLengthString(job->path, 40) << " " << getFixLengthString(state, 9) << " "
+                      << getFixLengthString(SSTR(job->foldersVisited.load()) + "/" + SSTR(job->foldersFound.load()), 15, ' ', true) << " "
+                      << getFixLengthString(SSTR(job->files.load()), 10, ' ', true) << " "
+                      << getFixLengthString(job->blocksUnder >= 0 ? SSTR(job->cachedFiles.load()) : "-", 10, ' ', true) << endl;
+        }
+        return;
+    }
+
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+
+    long long blocksUnder = -1;
+    string sizeLimit = getOption(cloptions, "blocks-under", "");
+    if (sizeLimit.size())
+    {
+        blocksUnder = textToSize(string(sizeLimit).c_str());
+        if (blocksUnder == -1)
+        {
+            blocksUnder = textToSize((sizeLimit + "B").c_str());
+        }
+        if (blocksUnder < 0)
+        {
+            setCurrentOutCode(MCMD_EARGS);
+            LOG_err << "Invalid size: " << sizeLimit;
+            return;
+        }
+        loadBlockCache();
+        if (!blockCache.isEnabled())
+        {
+            LOG_warn << "Block cache is disabled: files will not be downloaded. Set its size with \"blockcache --limit=SIZE\"";
+        }
+    }
+
+    for (unsigned int i = 1; i < words.size(); i++)
+    {
+        vector<MegaNode *> nodes;
+        if (isRegExp(words[i]))
+        {
+            std::unique_ptr<vector<MegaNode *> > found {nodesbypath(words[i].c_str(), getFlag(clflags, "use-pcre"))};
+            if (found)
             {
-                unescapeifRequired(words[i]);
-                if (isRegExp(words[i]))
+                nodes = *found;
+            }
+        }
+        else if (MegaNode *n = nodebypath(words[i].c_str()))
+        {
+            nodes.push_back(n);
+        }
+        if (nodes.empty())
+        {
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << "Node not found: " << words[i];
+            continue;
+        }
+
+        for (auto n : nodes)
+        {
+            std::shared_ptr<PrefetchJob> job = std::make_shared<PrefetchJob>();
+            job->path = sandboxCMD->nodePathCache.getNodePath(api, n);
+            job->handle = n->getHandle();
+            job->blocksUnder = blocksUnder;
+            job->clientID = getintOption(cloptions, "clientID", -1);
+            delete n;
+
+            queuePrefetch(job);
+            OUTSTREAM << "Prefetching " << job->path << " in the background" << endl;
+        }
+    }
+}
+
+void MegaCmdExecuter::executeMediainfo(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    if (words.size() < 2)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("mediainfo");
+        return;
+    }
+
+    MegaCmdOutputFormat outputFormat;
+    if (!getOutputFormat(cloptions, &outputFormat))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        return;
+    }
+    bool ndjson = outputFormat == MCMDOUTPUT_NDJSON;
+    bool recursive = getFlag(clflags, "r");
+
+    int PATHSIZE = getintOption(cloptions,"path-display-size");
+    if (!PATHSIZE)
+    {
+        // get screen size for output purposes
+        unsigned int width = getNumberOfCols(75);
+        PATHSIZE = min(50,int(width-28));
+    }
+    PATHSIZE = max(0, PATHSIZE);
+
+    bool firstone = true;
+    auto printNode = [&](MegaNode *n)
+    {
+        if (!recursive || n->getType() == MegaNode::TYPE_FILE)
+        {
+            printInfoFile(sandboxCMD->nodePathCache.getNodePath(api, n), n->getHandle(), sandboxCMD->mediaInfoCache.getMediaInfo(n), firstone, PATHSIZE, ndjson);
+            return;
+        }
+
+        // files with media attributes within the folder: gathered by a pool of threads, and printed as folders are done
+        struct MediaInfoRecord
+        {
+            string path;
+            MegaHandle handle;
+            MediaInfoCache::MediaInfo info;
+        };
+        std::mutex recordsMutex;
+        std::deque<MediaInfoRecord> records;
+
+        auto printRecords = [&]()
+        {
+            std::deque<MediaInfoRecord> toPrint;
+            {
+                std::lock_guard<std::mutex> g(recordsMutex);
+                toPrint.swap(records);
+            }
+            for (auto &record : toPrint)
+            {
+                printInfoFile(record.path, record.handle, record.info, firstone, PATHSIZE, ndjson);
+            }
+        };
+
+        walkTreeInParallel(n, ConfigurationManager::getConfigurationValue("mediainfo_parallelism", 8), [&](MegaNode *, MegaNodeList *children)
+        {
+            std::deque<MediaInfoRecord> found;
+            for (int i = 0; children && i < children->size(); i++)
+            {
+                MegaNode *child = children->get(i);
+                if (child->getType() == MegaNode::TYPE_FILE)
                 {
-                    vector<MegaNode *> *nodes = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
-                    if (nodes)
+                    MediaInfoCache::MediaInfo info = sandboxCMD->mediaInfoCache.getMediaInfo(child);
+                    if (info.hasAttributes || info.width != -1 || info.playtime != -1)
                     {
-                        if (!nodes->size())
-                        {
-                            setCurrentOutCode(MCMD_NOTFOUND);
-                            LOG_err << "Nodes not found: " << words[i];
-                        }
-                        for (std::vector< MegaNode * >::iterator it = nodes->begin(); it != nodes->end(); ++it)
-                        {
-                            MegaNode * n = *it;
-                            if (n)
-                            {
-                                catFile(n);
-                                delete n;
-                            }
-                        }
+                        found.push_back(MediaInfoRecord{sandboxCMD->nodePathCache.getNodePath(api, child), child->getHandle(), info});
                     }
                 }
-                else
+            }
+            std::lock_guard<std::mutex> g(recordsMutex);
+            records.insert(records.end(), found.begin(), found.end());
+        }, printRecords);
+        printRecords();
+    };
+
+    for (int i = 1; i < (int)words.size(); i++)
+    {
+        unescapeifRequired(words[i]);
+        if (isRegExp(words[i]))
+        {
+            vector<MegaNode *> *nodes = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
+            if (nodes)
+            {
+                if (!nodes->size())
+                {
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << "Nodes not found: " << words[i];
+                }
+                for (std::vector< MegaNode * >::iterator it = nodes->begin(); it != nodes->end(); ++it)
                 {
-                    MegaNode *n = nodebypath(words[i].c_str());
+                    MegaNode * n = *it;
                     if (n)
                     {
-                        catFile(n);
+                        printNode(n);
                         delete n;
                     }
-                    else
-                    {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        LOG_err << "Node not found: " << words[i];
-                    }
                 }
+                delete nodes;
+            }
+        }
+        else
+        {
+            MegaNode *n = nodebypath(words[i].c_str());
+            if (n)
+            {
+                printNode(n);
+                delete n;
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Node not found: " << words[i];
             }
         }
     }
-    else if (words[0] == "mediainfo")
+}
+
+/**
+ * @brief getTransferPriority reads the priority and deadline given with --priority and --deadline
+ * @return false if they are not valid (already reported)
+ */
+static bool getTransferPriority(map<string, string> *cloptions, bool background, int *priority, m_time_t *deadline)
+{
+    string spriority = getOption(cloptions, "priority", "");
+    string sdeadline = getOption(cloptions, "deadline", "");
+    *priority = 0;
+    *deadline = 0;
+
+    if (background && (spriority.size() || sdeadline.size()))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "--priority and --deadline cannot be used with -q. Use \"transfers --priority=N TAG\" once queued";
+        return false;
+    }
+    if (spriority.size())
     {
-        if (!api->isFilesystemAvailable())
+        *priority = toInteger(spriority, std::numeric_limits<int>::min());
+        if (*priority == std::numeric_limits<int>::min())
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            setCurrentOutCode(MCMD_EARGS);
+            LOG_err << "Invalid priority: " << spriority;
+            return false;
         }
-        if (words.size() < 2)
+    }
+    if (sdeadline.size())
+    {
+        *deadline = getTimeStampAfter(sdeadline);
+        if (*deadline < 0)
         {
             setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("mediainfo");
+            LOG_err << "Invalid time " << sdeadline;
+            return false;
+        }
+    }
+    return true;
+}
+
+void MegaCmdExecuter::executeGet(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    int clientID = getintOption(cloptions, "clientID", -1);
+    string resumeManifest = getOption(cloptions, "resume", "");
+    if ((words.size() > 1 && words.size() < 4) || (words.size() == 1 && resumeManifest.size()))
+    {
+        string path = "./";
+        bool background = getFlag(clflags,"q");
+        if (background)
+        {
+            clientID = -1;
+        }
+
+        int priority;
+        m_time_t deadline;
+        if (!getTransferPriority(cloptions, background, &priority, &deadline))
+        {
             return;
         }
 
-        int PATHSIZE = getintOption(cloptions,"path-display-size");
-        if (!PATHSIZE)
+        MegaCmdMultiTransferListener *megaCmdMultiTransferListener = new MegaCmdMultiTransferListener(api, sandboxCMD, NULL, clientID);
+        megaCmdMultiTransferListener->setPriority(priority, deadline);
+
+        bool ignorequotawarn = getFlag(clflags,"ignore-quota-warn");
+        bool destinyIsFolder = false;
+        bool skipUnchanged = getFlag(clflags,"skip-unchanged");
+        SkipUnchangedStats skipUnchangedStats;
+
+        if (skipUnchanged && !resumeManifest.size() && isPublicLink(words[1]))
         {
-            // get screen size for output purposes
-            unsigned int width = getNumberOfCols(75);
-            PATHSIZE = min(50,int(width-28));
+            LOG_warn << "--skip-unchanged is not supported for public links: all files will be downloaded";
         }
-        PATHSIZE = max(0, PATHSIZE);
 
-        bool firstone = true;
-        for (int i = 1; i < (int)words.size(); i++)
+        if (resumeManifest.size())
         {
-            unescapeifRequired(words[i]);
-            if (isRegExp(words[i]))
+            if (!api->isFilesystemAvailable())
             {
-                vector<MegaNode *> *nodes = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
-                if (nodes)
+                setCurrentOutCode(MCMD_NOTLOGGEDIN);
+                LOG_err << "Not logged in.";
+                delete megaCmdMultiTransferListener;
+                return;
+            }
+            resumeDownloads(resumeManifest, background, ignorequotawarn, clientID, megaCmdMultiTransferListener, cloptions);
+        }
+        else if (isPublicLink(words[1]))
+        {
+            string publicLink = words[1];
+            if (isEncryptedLink(publicLink))
+            {
+                string linkPass = getOption(cloptions, "password", "");
+                if (!linkPass.size())
                 {
-                    if (!nodes->size())
+                    linkPass = askforUserResponse("Enter password: ");
+                }
+
+                if (linkPass.size())
+                {
+                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                    api->decryptPasswordProtectedLink(publicLink.c_str(), linkPass.c_str(), megaCmdListener);
+                    megaCmdListener->wait();
+                    if (checkNoErrors(megaCmdListener->getError(), "decrypt password protected link"))
                     {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        LOG_err << "Nodes not found: " << words[i];
+                        publicLink = megaCmdListener->getRequest()->getText();
+                        delete megaCmdListener;
                     }
-                    for (std::vector< MegaNode * >::iterator it = nodes->begin(); it != nodes->end(); ++it)
+                    else
                     {
-                        MegaNode * n = *it;
-                        if (n)
-                        {
-                            printInfoFile(n, firstone, PATHSIZE);
-                            delete n;
-                        }
+                        setCurrentOutCode(MCMD_NOTPERMITTED);
+                        LOG_err << "Invalid password";
+                        delete megaCmdListener;
+                        return;
                     }
                 }
-            }
-            else
-            {
-                MegaNode *n = nodebypath(words[i].c_str());
-                if (n)
-                {
-                    printInfoFile(n, firstone, PATHSIZE);
-                    delete n;
-                }
                 else
                 {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << "Node not found: " << words[i];
+                    setCurrentOutCode(MCMD_EARGS);
+                    LOG_err << "Need a password to decrypt provided link (--password=PASSWORD)";
+                    return;
                 }
             }
-        }
-    }
-    else if (words[0] == "get")
-    {
-        int clientID = getintOption(cloptions, "clientID", -1);
-        if (words.size() > 1 && words.size() < 4)
-        {
-            string path = "./";
-            bool background = getFlag(clflags,"q");
-            if (background)
-            {
-                clientID = -1;
-            }
 
-            MegaCmdMultiTransferListener *megaCmdMultiTransferListener = new MegaCmdMultiTransferListener(api, sandboxCMD, NULL, clientID);
-
-            bool ignorequotawarn = getFlag(clflags,"ignore-quota-warn");
-            bool destinyIsFolder = false;
-
-            if (isPublicLink(words[1]))
+            if (getLinkType(publicLink) == MegaNode::TYPE_FILE)
             {
-                string publicLink = words[1];
-                if (isEncryptedLink(publicLink))
+                if (words.size() > 2)
                 {
-                    string linkPass = getOption(cloptions, "password", "");
-                    if (!linkPass.size())
-                    {
-                        linkPass = askforUserResponse("Enter password: ");
-                    }
-
-                    if (linkPass.size())
+                    path = words[2];
+                    destinyIsFolder = IsFolder(path);
+                    if (destinyIsFolder)
                     {
-                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                        api->decryptPasswordProtectedLink(publicLink.c_str(), linkPass.c_str(), megaCmdListener);
-                        megaCmdListener->wait();
-                        if (checkNoErrors(megaCmdListener->getError(), "decrypt password protected link"))
+                        if (! (path.find_last_of("/") == path.size()-1) && ! (path.find_last_of("\\") == path.size()-1))
                         {
-                            publicLink = megaCmdListener->getRequest()->getText();
-                            delete megaCmdListener;
+#ifdef _WIN32
+                            path+="\\";
+#else
+                            path+="/";
+#endif
                         }
-                        else
+                        if (!canWrite(path))
                         {
                             setCurrentOutCode(MCMD_NOTPERMITTED);
-                            LOG_err << "Invalid password";
-                            delete megaCmdListener;
+                            LOG_err << "Write not allowed in " << path;
+                            delete megaCmdMultiTransferListener;
                             return;
                         }
                     }
                     else
                     {
-                        setCurrentOutCode(MCMD_EARGS);
-                        LOG_err << "Need a password to decrypt provided link (--password=PASSWORD)";
-                        return;
+                        if (!TestCanWriteOnContainingFolder(&path))
+                        {
+                            delete megaCmdMultiTransferListener;
+                            return;
+                        }
                     }
                 }
+                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                api->getPublicNode(publicLink.c_str(), megaCmdListener);
+                megaCmdListener->wait();
 
-                if (getLinkType(publicLink) == MegaNode::TYPE_FILE)
+                if (!megaCmdListener->getError())
                 {
-                    if (words.size() > 2)
+                    LOG_fatal << "No error in listener at get public node";
+                }
+                else if (!checkNoErrors(megaCmdListener->getError(), "get public node"))
+                {
+                    if (megaCmdListener->getError()->getErrorCode() == MegaError::API_EARGS)
                     {
-                        path = words[2];
-                        destinyIsFolder = IsFolder(path);
-                        if (destinyIsFolder)
+                        LOG_err << "The link provided might be incorrect: " << publicLink.c_str();
+                    }
+                    else if (megaCmdListener->getError()->getErrorCode() == MegaError::API_EINCOMPLETE)
+                    {
+                        LOG_err << "The key is missing or wrong " << publicLink.c_str();
+                    }
+                }
+                else
+                {
+                    if (megaCmdListener->getRequest() && megaCmdListener->getRequest()->getFlag())
+                    {
+                        LOG_err << "Key not valid " << publicLink.c_str();
+                    }
+                    if (megaCmdListener->getRequest())
+                    {
+                        if (destinyIsFolder && getFlag(clflags,"m"))
                         {
-                            if (! (path.find_last_of("/") == path.size()-1) && ! (path.find_last_of("\\") == path.size()-1))
+                            while( (path.find_last_of("/") == path.size()-1) || (path.find_last_of("\\") == path.size()-1))
                             {
+                                path=path.substr(0,path.size()-1);
+                            }
+                        }
+                        MegaNode *n = megaCmdListener->getRequest()->getPublicMegaNode();
+                        downloadNode(path, api, n, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
+                        delete n;
+                    }
+                    else
+                    {
+                        LOG_err << "Empty Request at get";
+                    }
+                }
+                delete megaCmdListener;
+            }
+            else if (getLinkType(publicLink) == MegaNode::TYPE_FOLDER)
+            {
+                if (words.size() > 2)
+                {
+                    path = words[2];
+                    destinyIsFolder = IsFolder(path);
+                    if (destinyIsFolder)
+                    {
+                        if (! (path.find_last_of("/") == path.size()-1) && ! (path.find_last_of("\\") == path.size()-1))
+                        {
 #ifdef _WIN32
-                                path+="\\";
+                            path+="\\";
 #else
-                                path+="/";
+                            path+="/";
 #endif
-                            }
-                            if (!canWrite(path))
-                            {
-                                setCurrentOutCode(MCMD_NOTPERMITTED);
-                                LOG_err << "Write not allowed in " << path;
-                                delete megaCmdMultiTransferListener;
-                                return;
-                            }
                         }
-                        else
+                        if (!canWrite(words[2]))
                         {
-                            if (!TestCanWriteOnContainingFolder(&path))
-                            {
-                                delete megaCmdMultiTransferListener;
-                                return;
-                            }
+                            setCurrentOutCode(MCMD_NOTPERMITTED);
+                            LOG_err << "Write not allowed in " << words[2];
+                            delete megaCmdMultiTransferListener;
+                            return;
                         }
                     }
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->getPublicNode(publicLink.c_str(), megaCmdListener);
-                    megaCmdListener->wait();
+                    else
+                    {
+                        setCurrentOutCode(MCMD_INVALIDTYPE);
+                        LOG_err << words[2] << " is not a valid Download Folder";
+                        delete megaCmdMultiTransferListener;
+                        return;
+                    }
+                }
 
-                    if (!megaCmdListener->getError())
+                MegaApi* apiFolder = getApiFolderForLink(publicLink);
+                if (apiFolder)
+                {
+                    MegaNode *nodeToDownload = NULL;
+                    bool usedRoot = false;
+                    string shandle = getPublicLinkHandle(publicLink);
+                    if (shandle.size())
                     {
-                        LOG_fatal << "No error in listener at get public node";
+                        handle thehandle = apiFolder->base64ToHandle(shandle.c_str());
+                        nodeToDownload = apiFolder->getNodeByHandle(thehandle);
                     }
-                    else if (!checkNoErrors(megaCmdListener->getError(), "get public node"))
+                    else
+                    {
+                        nodeToDownload = apiFolder->getRootNode();
+                        usedRoot = true;
+                    }
+
+                    if (nodeToDownload)
                     {
-                        if (megaCmdListener->getError()->getErrorCode() == MegaError::API_EARGS)
+                        if (destinyIsFolder && getFlag(clflags,"m"))
+                        {
+                            while( (path.find_last_of("/") == path.size()-1) || (path.find_last_of("\\") == path.size()-1))
+                            {
+                                path=path.substr(0,path.size()-1);
+                            }
+                        }
+                        MegaNode *authorizedNode = apiFolder->authorizeNode(nodeToDownload);
+                        if (authorizedNode != NULL)
                         {
-                            LOG_err << "The link provided might be incorrect: " << publicLink.c_str();
+                            downloadNode(path, api, authorizedNode, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
+                            delete authorizedNode;
                         }
-                        else if (megaCmdListener->getError()->getErrorCode() == MegaError::API_EINCOMPLETE)
+                        else
                         {
-                            LOG_err << "The key is missing or wrong " << publicLink.c_str();
+                            LOG_debug << "Node couldn't be authorized: " << publicLink << ". Downloading as non-loged user";
+                            downloadNode(path, apiFolder, nodeToDownload, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
                         }
+                        delete nodeToDownload;
                     }
                     else
                     {
-                        if (megaCmdListener->getRequest() && megaCmdListener->getRequest()->getFlag())
-                        {
-                            LOG_err << "Key not valid " << publicLink.c_str();
-                        }
-                        if (megaCmdListener->getRequest())
+                        setCurrentOutCode(MCMD_INVALIDSTATE);
+                        if (usedRoot)
                         {
-                            if (destinyIsFolder && getFlag(clflags,"m"))
-                            {
-                                while( (path.find_last_of("/") == path.size()-1) || (path.find_last_of("\\") == path.size()-1))
-                                {
-                                    path=path.substr(0,path.size()-1);
-                                }
-                            }
-                            MegaNode *n = megaCmdListener->getRequest()->getPublicMegaNode();
-                            downloadNode(path, api, n, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
-                            delete n;
+                            LOG_err << "Couldn't get root folder for folder link";
                         }
                         else
                         {
-                            LOG_err << "Empty Request at get";
+                            LOG_err << "Failed to get node corresponding to handle within public link " << shandle;
                         }
                     }
-                    delete megaCmdListener;
+                    freeApiFolder(apiFolder);
                 }
-                else if (getLinkType(publicLink) == MegaNode::TYPE_FOLDER)
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_INVALIDTYPE);
+                LOG_err << "Invalid link: " << publicLink;
+            }
+        }
+        else //remote file
+        {
+            if (!api->isFilesystemAvailable())
+            {
+                setCurrentOutCode(MCMD_NOTLOGGEDIN);
+                LOG_err << "Not logged in.";
+                return;
+            }
+            unescapeifRequired(words[1]);
+
+            if (isRegExp(words[1]))
+            {
+                vector<MegaNode *> *nodesToGet = nodesbypath(words[1].c_str(), getFlag(clflags,"use-pcre"));
+                if (nodesToGet)
                 {
                     if (words.size() > 2)
                     {
@@ -6394,110 +8760,71 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                             {
                                 setCurrentOutCode(MCMD_NOTPERMITTED);
                                 LOG_err << "Write not allowed in " << words[2];
+                                for (std::vector< MegaNode * >::iterator it = nodesToGet->begin(); it != nodesToGet->end(); ++it)
+                                {
+                                    delete (MegaNode *)*it;
+                                }
+                                delete nodesToGet;
                                 delete megaCmdMultiTransferListener;
                                 return;
                             }
                         }
-                        else
+                        else if (nodesToGet->size()>1) //several files into one file!
                         {
                             setCurrentOutCode(MCMD_INVALIDTYPE);
                             LOG_err << words[2] << " is not a valid Download Folder";
-                            delete megaCmdMultiTransferListener;
-                            return;
-                        }
-                    }
-
-                    MegaApi* apiFolder = getFreeApiFolder();
-                    char *accountAuth = api->getAccountAuth();
-                    apiFolder->setAccountAuth(accountAuth);
-                    delete []accountAuth;
-
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(apiFolder, NULL);
-                    apiFolder->loginToFolder(publicLink.c_str(), megaCmdListener);
-                    megaCmdListener->wait();
-                    if (checkNoErrors(megaCmdListener->getError(), "login to folder"))
-                    {
-                        MegaCmdListener *megaCmdListener2 = new MegaCmdListener(apiFolder, NULL);
-                        apiFolder->fetchNodes(megaCmdListener2);
-                        megaCmdListener2->wait();
-                        if (checkNoErrors(megaCmdListener2->getError(), "access folder link " + publicLink))
-                        {
-                            MegaNode *nodeToDownload = NULL;
-                            bool usedRoot = false;
-                            string shandle = getPublicLinkHandle(publicLink);
-                            if (shandle.size())
-                            {
-                                handle thehandle = apiFolder->base64ToHandle(shandle.c_str());
-                                nodeToDownload = apiFolder->getNodeByHandle(thehandle);
-                            }
-                            else
+                            for (std::vector< MegaNode * >::iterator it = nodesToGet->begin(); it != nodesToGet->end(); ++it)
                             {
-                                nodeToDownload = apiFolder->getRootNode();
-                                usedRoot = true;
-                            }
-
-                            if (nodeToDownload)
-                            {
-                                if (destinyIsFolder && getFlag(clflags,"m"))
-                                {
-                                    while( (path.find_last_of("/") == path.size()-1) || (path.find_last_of("\\") == path.size()-1))
-                                    {
-                                        path=path.substr(0,path.size()-1);
-                                    }
-                                }
-                                MegaNode *authorizedNode = apiFolder->authorizeNode(nodeToDownload);
-                                if (authorizedNode != NULL)
-                                {
-                                    downloadNode(path, api, authorizedNode, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
-                                    delete authorizedNode;
-                                }
-                                else
-                                {
-                                    LOG_debug << "Node couldn't be authorized: " << publicLink << ". Downloading as non-loged user";
-                                    downloadNode(path, apiFolder, nodeToDownload, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
-                                }
-                                delete nodeToDownload;
+                                delete (MegaNode *)*it;
                             }
-                            else
+                            delete nodesToGet;
+                            delete megaCmdMultiTransferListener;
+                            return;
+                        }
+                        else //destiny non existing or a file
+                        {
+                            if (!TestCanWriteOnContainingFolder(&path))
                             {
-                                setCurrentOutCode(MCMD_INVALIDSTATE);
-                                if (usedRoot)
-                                {
-                                    LOG_err << "Couldn't get root folder for folder link";
-                                }
-                                else
+                                for (std::vector< MegaNode * >::iterator it = nodesToGet->begin(); it != nodesToGet->end(); ++it)
                                 {
-                                    LOG_err << "Failed to get node corresponding to handle within public link " << shandle;
+                                    delete (MegaNode *)*it;
                                 }
+                                delete nodesToGet;
+                                delete megaCmdMultiTransferListener;
+                                return;
                             }
                         }
-                        delete megaCmdListener2;
                     }
-                    delete megaCmdListener;
-                    freeApiFolder(apiFolder);
-                }
-                else
-                {
-                    setCurrentOutCode(MCMD_INVALIDTYPE);
-                    LOG_err << "Invalid link: " << publicLink;
+                    if (destinyIsFolder && getFlag(clflags,"m"))
+                    {
+                        while( (path.find_last_of("/") == path.size()-1) || (path.find_last_of("\\") == path.size()-1))
+                        {
+                            path=path.substr(0,path.size()-1);
+                        }
+                    }
+                    downloadNodes(nodesToGet, path, background, ignorequotawarn, clientID, megaCmdMultiTransferListener, cloptions, skipUnchanged ? &skipUnchangedStats : NULL);
+                    for (std::vector< MegaNode * >::iterator it = nodesToGet->begin(); it != nodesToGet->end(); ++it)
+                    {
+                        delete (MegaNode *)*it;
+                    }
+                    if (!nodesToGet->size())
+                    {
+                        setCurrentOutCode(MCMD_NOTFOUND);
+                        LOG_err << "Couldn't find " << words[1];
+                    }
+
+                    nodesToGet->clear();
+                    delete nodesToGet;
                 }
             }
-            else //remote file
+            else //not regexp
             {
-                if (!api->isFilesystemAvailable())
-                {
-                    setCurrentOutCode(MCMD_NOTLOGGEDIN);
-                    LOG_err << "Not logged in.";
-                    return;
-                }
-                unescapeifRequired(words[1]);
-
-                if (isRegExp(words[1]))
+                MegaNode *n = nodebypath(words[1].c_str());
+                if (n)
                 {
-                    vector<MegaNode *> *nodesToGet = nodesbypath(words[1].c_str(), getFlag(clflags,"use-pcre"));
-                    if (nodesToGet)
+                    if (words.size() > 2)
                     {
-                        if (words.size() > 2)
+                        if (n->getType() == MegaNode::TYPE_FILE)
                         {
                             path = words[2];
                             destinyIsFolder = IsFolder(path);
@@ -6515,3893 +8842,4993 @@ void MegaCmdExecuter::executecommand(vector<string> words, map<string, int> *clf
                                 {
                                     setCurrentOutCode(MCMD_NOTPERMITTED);
                                     LOG_err << "Write not allowed in " << words[2];
-                                    for (std::vector< MegaNode * >::iterator it = nodesToGet->begin(); it != nodesToGet->end(); ++it)
-                                    {
-                                        delete (MegaNode *)*it;
-                                    }
-                                    delete nodesToGet;
                                     delete megaCmdMultiTransferListener;
                                     return;
                                 }
                             }
-                            else if (nodesToGet->size()>1) //several files into one file!
+                            else
                             {
-                                setCurrentOutCode(MCMD_INVALIDTYPE);
-                                LOG_err << words[2] << " is not a valid Download Folder";
-                                for (std::vector< MegaNode * >::iterator it = nodesToGet->begin(); it != nodesToGet->end(); ++it)
+                                if (!TestCanWriteOnContainingFolder(&path))
                                 {
-                                    delete (MegaNode *)*it;
+                                    delete megaCmdMultiTransferListener;
+                                    return;
                                 }
-                                delete nodesToGet;
-                                delete megaCmdMultiTransferListener;
-                                return;
                             }
-                            else //destiny non existing or a file
+                        }
+                        else
+                        {
+                            path = words[2];
+                            destinyIsFolder = IsFolder(path);
+                            if (destinyIsFolder)
                             {
-                                if (!TestCanWriteOnContainingFolder(&path))
+                                if (! (path.find_last_of("/") == path.size()-1) && ! (path.find_last_of("\\") == path.size()-1))
                                 {
-                                    for (std::vector< MegaNode * >::iterator it = nodesToGet->begin(); it != nodesToGet->end(); ++it)
-                                    {
-                                        delete (MegaNode *)*it;
-                                    }
-                                    delete nodesToGet;
+#ifdef _WIN32
+                                    path+="\\";
+#else
+                                    path+="/";
+#endif
+                                }
+                                if (!canWrite(words[2]))
+                                {
+                                    setCurrentOutCode(MCMD_NOTPERMITTED);
+                                    LOG_err << "Write not allowed in " << words[2];
                                     delete megaCmdMultiTransferListener;
                                     return;
                                 }
                             }
+                            else
+                            {
+                                setCurrentOutCode(MCMD_INVALIDTYPE);
+                                LOG_err << words[2] << " is not a valid Download Folder";
+                                delete megaCmdMultiTransferListener;
+                                return;
+                            }
+                        }
+                    }
+                    if (destinyIsFolder && getFlag(clflags,"m"))
+                    {
+                        while( (path.find_last_of("/") == path.size()-1) || (path.find_last_of("\\") == path.size()-1))
+                        {
+                            path=path.substr(0,path.size()-1);
+                        }
+                    }
+                    if (skipUnchanged)
+                    {
+                        vector<MegaNode *> nodesToGet {n};
+                        downloadNodes(&nodesToGet, path, background, ignorequotawarn, clientID, megaCmdMultiTransferListener, cloptions, &skipUnchangedStats);
+                    }
+                    else
+                    {
+                        downloadNode(path, api, n, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
+                    }
+                    delete n;
+                }
+                else
+                {
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << "Couldn't find file";
+                }
+            }
+        }
+
+        megaCmdMultiTransferListener->waitMultiEnd();
+        if (megaCmdMultiTransferListener->getFinalerror() != MegaError::API_OK)
+        {
+            setCurrentOutCode(megaCmdMultiTransferListener->getFinalerror());
+            LOG_err << "Download failed. error code: " << MegaError::getErrorString(megaCmdMultiTransferListener->getFinalerror());
+        }
+
+        if (skipUnchanged && !resumeManifest.size() && !isPublicLink(words[1]))
+        {
+            printSkipUnchangedStats(&skipUnchangedStats, megaCmdMultiTransferListener, background);
+        }
+
+        if (megaCmdMultiTransferListener->getProgressinformed() || getCurrentOutCode() == MCMD_OK )
+        {
+            informProgressUpdate(PROGRESS_COMPLETE, megaCmdMultiTransferListener->getTotalbytes(), clientID);
+        }
+        delete megaCmdMultiTransferListener;
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("get");
+    }
+
+    return;
+}
+
+#ifdef ENABLE_BACKUPS
+void MegaCmdExecuter::executeBackup(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    bool dodelete = getFlag(clflags,"d");
+    bool abort = getFlag(clflags,"a");
+    bool listinfo = getFlag(clflags,"l");
+    bool listhistory = getFlag(clflags,"h");
+
+//        //TODO: do the following functionality
+//        bool stop = getFlag(clflags,"s");
+//        bool resume = getFlag(clflags,"r");
+//        bool initiatenow = getFlag(clflags,"i");
+
+    int PATHSIZE = getintOption(cloptions,"path-display-size");
+    if (!PATHSIZE)
+    {
+        // get screen size for output purposes
+        unsigned int width = getNumberOfCols(75);
+        PATHSIZE = min(60,int((width-46)/2));
+    }
+    PATHSIZE = max(0, PATHSIZE);
+
+    bool firstbackup = true;
+    string speriod=getOption(cloptions, "period");
+    int numBackups = int(getintOption(cloptions, "num-backups", -1));
+
+    if (words.size() == 3)
+    {
+        string local = words.at(1);
+        string remote = words.at(2);
+        unescapeifRequired(local);
+        unescapeifRequired(remote);
+
+        createOrModifyBackup(local, remote, speriod, numBackups);
+    }
+    else if (words.size() == 2)
+    {
+        string local = words.at(1);
+        unescapeifRequired(local);
+
+        MegaBackup *backup = api->getBackupByPath(local.c_str());
+        if (!backup)
+        {
+            backup = api->getBackupByTag(toInteger(local, -1));
+        }
+        map<string, backup_struct *>::iterator itr;
+        if (backup)
+        {
+            int backupid = -1;
+            for ( itr = ConfigurationManager::configuredBackups.begin(); itr != ConfigurationManager::configuredBackups.end(); itr++ )
+            {
+                if (itr->second->tag == backup->getTag())
+                {
+                    backupid = itr->second->id;
+                    break;
+                }
+            }
+            if (backupid == -1)
+            {
+                LOG_err << " Requesting info of unregistered backup: " << local;
+            }
+
+            if (dodelete)
+            {
+                MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
+                api->removeBackup(backup->getTag(), megaCmdListener);
+                megaCmdListener->wait();
+                if (checkNoErrors(megaCmdListener->getError(), "remove backup"))
+                {
+                    if (backupid != -1)
+                    {
+                      ConfigurationManager::configuredBackups.erase(itr);
+                    }
+                    mtxBackupsMap.lock();
+                    ConfigurationManager::saveBackups(&ConfigurationManager::configuredBackups);
+                    mtxBackupsMap.unlock();
+                    OUTSTREAM << " Backup removed succesffuly: " << local << endl;
+                }
+            }
+            else if (abort)
+            {
+                MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
+                api->abortCurrentBackup(backup->getTag(), megaCmdListener);
+                megaCmdListener->wait();
+                if (checkNoErrors(megaCmdListener->getError(), "abort backup"))
+                {
+                    OUTSTREAM << " Backup aborted succesffuly: " << local << endl;
+                }
+            }
+            else
+            {
+                if (speriod.size() || numBackups != -1)
+                {
+                    createOrModifyBackup(backup->getLocalFolder(), "", speriod, numBackups);
+                }
+                else
+                {
+                    if(firstbackup)
+                    {
+                        printBackupHeader(PATHSIZE);
+                        firstbackup = false;
+                    }
+
+                    printBackup(backup->getTag(), backup, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), PATHSIZE, listinfo, listhistory);
+                }
+            }
+            delete backup;
+        }
+        else
+        {
+            if (dodelete) //remove from configured backups
+            {
+                bool deletedok = false;
+                for ( itr = ConfigurationManager::configuredBackups.begin(); itr != ConfigurationManager::configuredBackups.end(); itr++ )
+                {
+                    if (itr->second->tag == -1 && itr->second->localpath == local)
+                    {
+                        mtxBackupsMap.lock();
+                        ConfigurationManager::configuredBackups.erase(itr);
+                        ConfigurationManager::saveBackups(&ConfigurationManager::configuredBackups);
+                        mtxBackupsMap.unlock();
+                        OUTSTREAM << " Backup removed succesffuly: " << local << endl;
+                        deletedok = true;
+
+                        break;
+                    }
+                }
+
+                if (!deletedok)
+                {
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    OUTSTREAM << "Backup not found: " << local << endl;
+                }
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Backup not found: " << local;
+            }
+        }
+    }
+    else if (words.size() == 1) //list backups
+    {
+        mtxBackupsMap.lock();
+        for (map<string, backup_struct *>::iterator itr = ConfigurationManager::configuredBackups.begin(); itr != ConfigurationManager::configuredBackups.end(); itr++ )
+        {
+            if(firstbackup)
+            {
+                printBackupHeader(PATHSIZE);
+                firstbackup = false;
+            }
+            printBackup(itr->second, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), PATHSIZE, listinfo, listhistory);
+        }
+        if (!ConfigurationManager::configuredBackups.size())
+        {
+            setCurrentOutCode(MCMD_NOTFOUND);
+            OUTSTREAM << "No backup configured. " << endl << " Usage: " << getUsageStr("backup") << endl;
+        }
+        mtxBackupsMap.unlock();
+
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("backup");
+    }
+}
+#endif
+
+void MegaCmdExecuter::executePut(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    int clientID = getintOption(cloptions, "clientID", -1);
+
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+
+    bool background = getFlag(clflags,"q");
+    if (background)
+    {
+        clientID = -1;
+    }
+
+    int priority;
+    m_time_t deadline;
+    if (!getTransferPriority(cloptions, background, &priority, &deadline))
+    {
+        return;
+    }
+
+    MegaCmdMultiTransferListener *megaCmdMultiTransferListener = new MegaCmdMultiTransferListener(api, sandboxCMD, NULL, clientID);
+    megaCmdMultiTransferListener->setPriority(priority, deadline);
+
+    bool ignorequotawarn = getFlag(clflags,"ignore-quota-warn");
+    bool skipUnchanged = getFlag(clflags,"skip-unchanged");
+    SkipUnchangedStats skipUnchangedStats;
+
+    if (words.size() > 1)
+    {
+        string targetuser;
+        string newname = "";
+        string destination = "";
+
+        MegaNode *n = NULL;
+
+        if (words.size() > 2)
+        {
+            destination = words[words.size() - 1];
+            n = nodebypath(destination.c_str(), &targetuser, &newname);
+
+            if (!n && getFlag(clflags,"c"))
+            {
+                string destinationfolder(destination,0,destination.find_last_of("/"));
+                newname=string(destination,destination.find_last_of("/")+1,destination.size());
+                MegaNode *cwdNode = api->getNodeByHandle(cwd);
+                makedir(destinationfolder,true,cwdNode);
+                n = nodebypath(destinationfolder.c_str());
+                delete cwdNode;
+            }
+        }
+        else
+        {
+            n = api->getNodeByHandle(cwd);
+            words.push_back(".");
+        }
+        if (n)
+        {
+            if (n->getType() != MegaNode::TYPE_FILE)
+            {
+                vector<string> sourcesToCompare;
+                for (int i = 1; i < max(1, (int)words.size() - 1); i++)
+                {
+                    if (words[i] == ".")
+                    {
+                        words[i] = getLPWD();
+                    }
+
+#ifdef HAVE_GLOB_H
+                    if (!newname.size()
+#ifdef MEGACMDEXECUTER_FILESYSTEM
+                            && !fs::exists(words[i])
+#endif
+                            && hasWildCards(words[i]))
+                    {
+                        auto paths = resolvewildcard(words[i]);
+                        if (!paths.size())
+                        {
+                            setCurrentOutCode(MCMD_NOTFOUND);
+                            LOG_err << words[i] << " not found";
                         }
-                        if (destinyIsFolder && getFlag(clflags,"m"))
+                        for (auto path : paths)
                         {
-                            while( (path.find_last_of("/") == path.size()-1) || (path.find_last_of("\\") == path.size()-1))
+                            if (skipUnchanged)
                             {
-                                path=path.substr(0,path.size()-1);
+                                sourcesToCompare.push_back(path);
                             }
-                        }
-                        for (std::vector< MegaNode * >::iterator it = nodesToGet->begin(); it != nodesToGet->end(); ++it)
-                        {
-                            MegaNode * n = *it;
-                            if (n)
+                            else
                             {
-                                downloadNode(path, api, n, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
-                                delete n;
+                                uploadNode(path, api, n, newname, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
                             }
                         }
-                        if (!nodesToGet->size())
-                        {
-                            setCurrentOutCode(MCMD_NOTFOUND);
-                            LOG_err << "Couldn't find " << words[1];
-                        }
-
-                        nodesToGet->clear();
-                        delete nodesToGet;
+                    }
+                    else
+#endif
+                    if (skipUnchanged)
+                    {
+                        sourcesToCompare.push_back(words[i]);
+                    }
+                    else
+                    {
+                        uploadNode(words[i], api, n, newname, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
                     }
                 }
-                else //not regexp
+
+                if (skipUnchanged)
                 {
-                    MegaNode *n = nodebypath(words[1].c_str());
-                    if (n)
+                    uploadNodesSkippingUnchanged(sourcesToCompare, n, newname, background, ignorequotawarn, clientID, megaCmdMultiTransferListener, &skipUnchangedStats);
+                }
+            }
+            else if (words.size() == 3 && !IsFolder(words[1])) //replace file
+            {
+                unique_ptr<MegaNode> pn(api->getNodeByHandle(n->getParentHandle()));
+                if (pn)
+                {
+#if defined(HAVE_GLOB_H) && defined(MEGACMDEXECUTER_FILESYSTEM)
+                    if (!fs::exists(words[1]) && hasWildCards(words[1]))
                     {
-                        if (words.size() > 2)
-                        {
-                            if (n->getType() == MegaNode::TYPE_FILE)
-                            {
-                                path = words[2];
-                                destinyIsFolder = IsFolder(path);
-                                if (destinyIsFolder)
-                                {
-                                    if (! (path.find_last_of("/") == path.size()-1) && ! (path.find_last_of("\\") == path.size()-1))
-                                    {
-#ifdef _WIN32
-                                        path+="\\";
-#else
-                                        path+="/";
-#endif
-                                    }
-                                    if (!canWrite(words[2]))
-                                    {
-                                        setCurrentOutCode(MCMD_NOTPERMITTED);
-                                        LOG_err << "Write not allowed in " << words[2];
-                                        delete megaCmdMultiTransferListener;
-                                        return;
-                                    }
-                                }
-                                else
-                                {
-                                    if (!TestCanWriteOnContainingFolder(&path))
-                                    {
-                                        delete megaCmdMultiTransferListener;
-                                        return;
-                                    }
-                                }
-                            }
-                            else
-                            {
-                                path = words[2];
-                                destinyIsFolder = IsFolder(path);
-                                if (destinyIsFolder)
-                                {
-                                    if (! (path.find_last_of("/") == path.size()-1) && ! (path.find_last_of("\\") == path.size()-1))
-                                    {
-#ifdef _WIN32
-                                        path+="\\";
-#else
-                                        path+="/";
+                        LOG_err << "Invalid target for wildcard expression: " << words[1] << ". Folder expected";
+                        setCurrentOutCode(MCMD_INVALIDTYPE);
+                    }
+                    else
 #endif
-                                    }
-                                    if (!canWrite(words[2]))
-                                    {
-                                        setCurrentOutCode(MCMD_NOTPERMITTED);
-                                        LOG_err << "Write not allowed in " << words[2];
-                                        delete megaCmdMultiTransferListener;
-                                        return;
-                                    }
-                                }
-                                else
-                                {
-                                    setCurrentOutCode(MCMD_INVALIDTYPE);
-                                    LOG_err << words[2] << " is not a valid Download Folder";
-                                    delete megaCmdMultiTransferListener;
-                                    return;
-                                }
-                            }
-                        }
-                        if (destinyIsFolder && getFlag(clflags,"m"))
-                        {
-                            while( (path.find_last_of("/") == path.size()-1) || (path.find_last_of("\\") == path.size()-1))
-                            {
-                                path=path.substr(0,path.size()-1);
-                            }
-                        }
-                        downloadNode(path, api, n, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
-                        delete n;
+                    if (skipUnchanged)
+                    {
+                        uploadNodesSkippingUnchanged(vector<string>{words[1]}, pn.get(), n->getName(), background, ignorequotawarn, clientID, megaCmdMultiTransferListener, &skipUnchangedStats);
                     }
                     else
                     {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        LOG_err << "Couldn't find file";
+                        uploadNode(words[1], api, pn.get(), n->getName(), background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
                     }
                 }
+                else
+                {
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << "Destination is not valid. Parent folder cannot be found";
+                }
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_INVALIDTYPE);
+                LOG_err << "Destination is not valid (expected folder or alike)";
             }
+            delete n;
+
 
             megaCmdMultiTransferListener->waitMultiEnd();
-            if (megaCmdMultiTransferListener->getFinalerror() != MegaError::API_OK)
+
+            checkNoErrors(megaCmdMultiTransferListener->getFinalerror(), "upload");
+
+            if (skipUnchanged)
+            {
+                printSkipUnchangedStats(&skipUnchangedStats, megaCmdMultiTransferListener, background);
+            }
+
+            if (megaCmdMultiTransferListener->getProgressinformed() || getCurrentOutCode() == MCMD_OK )
+            {
+                informProgressUpdate(PROGRESS_COMPLETE, megaCmdMultiTransferListener->getTotalbytes(), clientID);
+            }
+            delete megaCmdMultiTransferListener;
+        }
+        else
+        {
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << "Couln't find destination folder: " << destination << ". Use -c to create folder structure";
+        }
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("put");
+    }
+
+    return;
+}
+
+void MegaCmdExecuter::executeLog(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (words.size() == 1)
+    {
+        if (!getFlag(clflags, "s") && !getFlag(clflags, "c"))
+        {
+            OUTSTREAM << "MEGAcmd log level = " << getLogLevelStr(loggerCMD->getCmdLoggerLevel()) << endl;
+            OUTSTREAM << "SDK log level = " << getLogLevelStr(loggerCMD->getApiLoggerLevel()) << endl;
+        }
+        else if (getFlag(clflags, "s"))
+        {
+            OUTSTREAM << "SDK log level = " << getLogLevelStr(loggerCMD->getApiLoggerLevel()) << endl;
+        }
+        else if (getFlag(clflags, "c"))
+        {
+            OUTSTREAM << "MEGAcmd log level = " << getLogLevelStr(loggerCMD->getCmdLoggerLevel()) << endl;
+        }
+    }
+    else
+    {
+        int newLogLevel = getLogLevelNum(words[1].c_str());
+        if (newLogLevel == -1)
+        {
+            setCurrentOutCode(MCMD_EARGS);
+            LOG_err << "Invalid log level";
+            return;
+        }
+        newLogLevel = max(newLogLevel, (int)MegaApi::LOG_LEVEL_FATAL);
+        newLogLevel = min(newLogLevel, (int)MegaApi::LOG_LEVEL_MAX);
+        if (!getFlag(clflags, "s") && !getFlag(clflags, "c"))
+        {
+            loggerCMD->setCmdLoggerLevel(newLogLevel);
+            loggerCMD->setApiLoggerLevel(newLogLevel);
+            OUTSTREAM << "MEGAcmd log level = " << getLogLevelStr(loggerCMD->getCmdLoggerLevel()) << endl;
+            OUTSTREAM << "SDK log level = " << getLogLevelStr(loggerCMD->getApiLoggerLevel()) << endl;
+        }
+        else if (getFlag(clflags, "s"))
+        {
+            loggerCMD->setApiLoggerLevel(newLogLevel);
+            OUTSTREAM << "SDK log level = " << getLogLevelStr(loggerCMD->getApiLoggerLevel()) << endl;
+        }
+        else if (getFlag(clflags, "c"))
+        {
+            loggerCMD->setCmdLoggerLevel(newLogLevel);
+            OUTSTREAM << "MEGAcmd log level = " << getLogLevelStr(loggerCMD->getCmdLoggerLevel()) << endl;
+        }
+    }
+
+    return;
+}
+
+void MegaCmdExecuter::executePwd(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    string cwpath = getCurrentPath();
+
+    OUTSTREAM << cwpath << endl;
+
+    return;
+}
+
+// this only makes sense for interactive mode
+void MegaCmdExecuter::executeLcd(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (words.size() > 1)
+    {
+        LocalPath localpath = LocalPath::fromPath(words[1], *fsAccessCMD);
+        if (fsAccessCMD->chdirlocal(localpath)) // maybe this is already checked in chdir
+        {
+            LOG_debug << "Local folder changed to: " << words[1];
+        }
+        else
+        {
+            setCurrentOutCode(MCMD_INVALIDTYPE);
+            LOG_err << "Not a valid folder: " << words[1];
+        }
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("lcd");
+    }
+
+    return;
+}
+
+void MegaCmdExecuter::executeLpwd(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    string absolutePath = getLPWD();
+
+    OUTSTREAM << absolutePath << endl;
+    return;
+}
+
+void MegaCmdExecuter::executeIpc(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    if (words.size() > 1)
+    {
+        int action;
+        string saction;
+
+        if (getFlag(clflags, "a"))
+        {
+            action = MegaContactRequest::REPLY_ACTION_ACCEPT;
+            saction = "Accept";
+        }
+        else if (getFlag(clflags, "d"))
+        {
+            action = MegaContactRequest::REPLY_ACTION_DENY;
+            saction = "Reject";
+        }
+        else if (getFlag(clflags, "i"))
+        {
+            action = MegaContactRequest::REPLY_ACTION_IGNORE;
+            saction = "Ignore";
+        }
+        else
+        {
+            setCurrentOutCode(MCMD_EARGS);
+            LOG_err << "      " << getUsageStr("ipc");
+            return;
+        }
+
+        MegaContactRequest * cr;
+        string shandle = words[1];
+        handle thehandle = api->base64ToUserHandle(shandle.c_str());
+
+        if (shandle.find('@') != string::npos)
+        {
+            cr = getPcrByContact(shandle);
+        }
+        else
+        {
+            cr = api->getContactRequestByHandle(thehandle);
+        }
+        if (cr)
+        {
+            MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
+            api->replyContactRequest(cr, action, megaCmdListener);
+            megaCmdListener->wait();
+            if (checkNoErrors(megaCmdListener->getError(), "reply ipc"))
             {
-                setCurrentOutCode(megaCmdMultiTransferListener->getFinalerror());
-                LOG_err << "Download failed. error code: " << MegaError::getErrorString(megaCmdMultiTransferListener->getFinalerror());
+                OUTSTREAM << saction << "ed invitation by " << cr->getSourceEmail() << endl;
             }
+            delete megaCmdListener;
+            delete cr;
+        }
+        else
+        {
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << "Could not find invitation " << shandle;
+        }
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("ipc");
+        return;
+    }
+    return;
+}
+
+void MegaCmdExecuter::executeHttps(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (words.size() > 1 && (words[1] == "on" || words[1] == "off"))
+    {
+        bool onlyhttps = words[1] == "on";
+        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+        api->useHttpsOnly(onlyhttps,megaCmdListener);
+        megaCmdListener->wait();
+        if (checkNoErrors(megaCmdListener->getError(), "change https"))
+        {
+            OUTSTREAM << "File transfer now uses " << (api->usingHttpsOnly()?"HTTPS":"HTTP") << endl;
+            ConfigurationManager::savePropertyValue("https", api->usingHttpsOnly());
+        }
+        delete megaCmdListener;
+        return;
+    }
+    else if (words.size() > 1)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("https");
+        return;
+    }
+    else
+    {
+        OUTSTREAM << "File transfer is done using " << (api->usingHttpsOnly()?"HTTPS":"HTTP") << endl;
+    }
+    return;
+}
+
+void MegaCmdExecuter::executeGraphics(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (words.size() == 2 && (words[1] == "on" || words[1] == "off"))
+    {
+        bool enableGraphics = words[1] == "on";
+
+        api->disableGfxFeatures(!enableGraphics);
+        ConfigurationManager::savePropertyValue("graphics", !api->areGfxFeaturesDisabled());
+    }
+    else if (words.size() > 1)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("https");
+        return;
+    }
+
+    OUTSTREAM << "Graphic features " << (api->areGfxFeaturesDisabled()?"disabled":"enabled") << endl;
+    return;
+}
+
+#ifndef _WIN32
+void MegaCmdExecuter::executePermissions(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    bool filesflagread = getFlag(clflags, "files");
+    bool foldersflagread = getFlag(clflags, "folders");
+
+    bool filesflag = filesflagread || (!filesflagread && !foldersflagread);
+    bool foldersflag = foldersflagread || (!filesflagread && !foldersflagread);
+
+    bool setperms = getFlag(clflags, "s");
+
+    if ( (!setperms && words.size() > 1) || (setperms && words.size() != 2) || ( setperms && filesflagread  && foldersflagread ) || (setperms && !filesflagread && !foldersflagread))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("permissions");
+        return;
+    }
+
+    int permvalue = -1;
+    if (setperms)
+    {
+         if (words[1].size() != 3)
+         {
+             setCurrentOutCode(MCMD_EARGS);
+             LOG_err << "Invalid permissions value: " << words[1];
+         }
+         else
+         {
+             int owner = words[1].at(0) - '0';
+             int group = words[1].at(1) - '0';
+             int others = words[1].at(2) - '0';
+             if ( (owner < 6) || (owner == 6 && foldersflag) || (owner > 7) || (group < 0) || (group > 7) || (others < 0) || (others > 7) )
+             {
+                 setCurrentOutCode(MCMD_EARGS);
+                 LOG_err << "Invalid permissions value: " << words[1];
+             }
+             else
+             {
+                 permvalue = (owner << 6) + ( group << 3) + others;
+             }
+         }
+    }
 
-            if (megaCmdMultiTransferListener->getProgressinformed() || getCurrentOutCode() == MCMD_OK )
-            {
-                informProgressUpdate(PROGRESS_COMPLETE, megaCmdMultiTransferListener->getTotalbytes(), clientID);
-            }
-            delete megaCmdMultiTransferListener;
+    if (filesflag)
+    {
+        if (setperms && permvalue != -1)
+        {
+            api->setDefaultFilePermissions(permvalue);
+            ConfigurationManager::savePropertyValue("permissionsFiles", readablePermissions(permvalue));
         }
-        else
+        int filepermissions = api->getDefaultFilePermissions();
+        int owner  = (filepermissions >> 6) & 0x07;
+        int group  = (filepermissions >> 3) & 0x07;
+        int others = filepermissions & 0x07;
+
+        OUTSTREAM << "Default files permissions: " << owner << group << others << endl;
+    }
+    if (foldersflag)
+    {
+        if (setperms && permvalue != -1)
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("get");
+            api->setDefaultFolderPermissions(permvalue);
+            ConfigurationManager::savePropertyValue("permissionsFolders", readablePermissions(permvalue));
         }
+        int folderpermissions = api->getDefaultFolderPermissions();
+        int owner  = (folderpermissions >> 6) & 0x07;
+        int group  = (folderpermissions >> 3) & 0x07;
+        int others = folderpermissions & 0x07;
+        OUTSTREAM << "Default folders permissions: " << owner << group << others << endl;
+    }
+}
+#endif
 
+void MegaCmdExecuter::executeDeleteversions(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    bool deleteall = getFlag(clflags, "all");
+    bool forcedelete = getFlag(clflags, "f");
+    bool dryrun = getFlag(clflags, "dry-run");
+    int clientID = getintOption(cloptions, "clientID", -1);
+    if (deleteall && words.size()>1)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("deleteversions");
         return;
     }
-#ifdef ENABLE_BACKUPS
-
-    else if (words[0] == "backup")
+    if (deleteall && dryrun)
     {
-        bool dodelete = getFlag(clflags,"d");
-        bool abort = getFlag(clflags,"a");
-        bool listinfo = getFlag(clflags,"l");
-        bool listhistory = getFlag(clflags,"h");
-
-//        //TODO: do the following functionality
-//        bool stop = getFlag(clflags,"s");
-//        bool resume = getFlag(clflags,"r");
-//        bool initiatenow = getFlag(clflags,"i");
-
-        int PATHSIZE = getintOption(cloptions,"path-display-size");
-        if (!PATHSIZE)
+        std::unique_ptr<MegaNode> rootNode {api->getRootNode()};
+        if (rootNode)
         {
-            // get screen size for output purposes
-            unsigned int width = getNumberOfCols(75);
-            PATHSIZE = min(60,int((width-46)/2));
+            deleteNodeVersions(rootNode.get(), api, true, true);
         }
-        PATHSIZE = max(0, PATHSIZE);
+    }
+    else if (deleteall)
+    {
+        string confirmationQuery("Are you sure todelete the version histories of all files? (Yes/No): ");
 
-        bool firstbackup = true;
-        string speriod=getOption(cloptions, "period");
-        int numBackups = int(getintOption(cloptions, "num-backups", -1));
+        int confirmationResponse = forcedelete?MCMDCONFIRM_YES:askforConfirmation(confirmationQuery);
 
-        if (words.size() == 3)
+        while ( (confirmationResponse != MCMDCONFIRM_YES) && (confirmationResponse != MCMDCONFIRM_NO) )
         {
-            string local = words.at(1);
-            string remote = words.at(2);
-            unescapeifRequired(local);
-            unescapeifRequired(remote);
-
-            createOrModifyBackup(local, remote, speriod, numBackups);
+            confirmationResponse = askforConfirmation(confirmationQuery);
         }
-        else if (words.size() == 2)
+        if (confirmationResponse == MCMDCONFIRM_YES)
         {
-            string local = words.at(1);
-            unescapeifRequired(local);
 
-            MegaBackup *backup = api->getBackupByPath(local.c_str());
-            if (!backup)
+            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+            api->removeVersions(megaCmdListener);
+            megaCmdListener->wait();
+            if (checkNoErrors(megaCmdListener->getError(), "remove all versions"))
             {
-                backup = api->getBackupByTag(toInteger(local, -1));
+                OUTSTREAM << "File versions deleted succesfully. Please note that the current files were not deleted, just their history." << endl;
             }
-            map<string, backup_struct *>::iterator itr;
-            if (backup)
+            delete megaCmdListener;
+        }
+    }
+    else
+    {
+        for (unsigned int i = 1; i < words.size(); i++)
+        {
+            if (isRegExp(words[i]))
             {
-                int backupid = -1;
-                for ( itr = ConfigurationManager::configuredBackups.begin(); itr != ConfigurationManager::configuredBackups.end(); itr++ )
-                {
-                    if (itr->second->tag == backup->getTag())
-                    {
-                        backupid = itr->second->id;
-                        break;
-                    }
-                }
-                if (backupid == -1)
-                {
-                    LOG_err << " Requesting info of unregistered backup: " << local;
-                }
-
-                if (dodelete)
+                vector<MegaNode *> *nodesToDeleteVersions = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
+                if (nodesToDeleteVersions && nodesToDeleteVersions->size())
                 {
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
-                    api->removeBackup(backup->getTag(), megaCmdListener);
-                    megaCmdListener->wait();
-                    if (checkNoErrors(megaCmdListener->getError(), "remove backup"))
+                    for (std::vector< MegaNode * >::iterator it = nodesToDeleteVersions->begin(); it != nodesToDeleteVersions->end(); ++it)
                     {
-                        if (backupid != -1)
+                        MegaNode * nodeToDeleteVersions = *it;
+                        if (nodeToDeleteVersions)
                         {
-                          ConfigurationManager::configuredBackups.erase(itr);
+                            int ret = deleteNodeVersions(nodeToDeleteVersions, api, forcedelete, dryrun, clientID);
+                            forcedelete = forcedelete || (ret == MCMDCONFIRM_ALL);
                         }
-                        mtxBackupsMap.lock();
-                        ConfigurationManager::saveBackups(&ConfigurationManager::configuredBackups);
-                        mtxBackupsMap.unlock();
-                        OUTSTREAM << " Backup removed succesffuly: " << local << endl;
-                    }
-                }
-                else if (abort)
-                {
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
-                    api->abortCurrentBackup(backup->getTag(), megaCmdListener);
-                    megaCmdListener->wait();
-                    if (checkNoErrors(megaCmdListener->getError(), "abort backup"))
-                    {
-                        OUTSTREAM << " Backup aborted succesffuly: " << local << endl;
                     }
                 }
                 else
                 {
-                    if (speriod.size() || numBackups != -1)
-                    {
-                        createOrModifyBackup(backup->getLocalFolder(), "", speriod, numBackups);
-                    }
-                    else
-                    {
-                        if(firstbackup)
-                        {
-                            printBackupHeader(PATHSIZE);
-                            firstbackup = false;
-                        }
-
-                        printBackup(backup->getTag(), backup, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), PATHSIZE, listinfo, listhistory);
-                    }
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << "No node found: " << words[i];
                 }
-                delete backup;
+                delete nodesToDeleteVersions;
             }
-            else
+            else // non-regexp
             {
-                if (dodelete) //remove from configured backups
+                MegaNode *n = nodebypath(words[i].c_str());
+                if (n)
                 {
-                    bool deletedok = false;
-                    for ( itr = ConfigurationManager::configuredBackups.begin(); itr != ConfigurationManager::configuredBackups.end(); itr++ )
-                    {
-                        if (itr->second->tag == -1 && itr->second->localpath == local)
-                        {
-                            mtxBackupsMap.lock();
-                            ConfigurationManager::configuredBackups.erase(itr);
-                            ConfigurationManager::saveBackups(&ConfigurationManager::configuredBackups);
-                            mtxBackupsMap.unlock();
-                            OUTSTREAM << " Backup removed succesffuly: " << local << endl;
-                            deletedok = true;
-
-                            break;
-                        }
-                    }
-
-                    if (!deletedok)
-                    {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        OUTSTREAM << "Backup not found: " << local << endl;
-                    }
+                    int ret = deleteNodeVersions(n, api, forcedelete, dryrun, clientID);
+                    forcedelete = forcedelete || (ret == MCMDCONFIRM_ALL);
                 }
                 else
                 {
                     setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << "Backup not found: " << local;
+                    LOG_err << "Node not found: " << words[i];
                 }
+                delete n;
             }
         }
-        else if (words.size() == 1) //list backups
+    }
+}
+
+void MegaCmdExecuter::executeDedup(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+
+    bool removeduplicates = getFlag(clflags, "remove");
+    bool forceremove = getFlag(clflags, "f");
+
+    vector<std::unique_ptr<MegaNode>> roots;
+    if (words.size() < 2)
+    {
+        roots.emplace_back(api->getNodeByHandle(cwd));
+    }
+    for (unsigned int i = 1; i < words.size(); i++)
+    {
+        MegaNode *n = nodebypath(words[i].c_str());
+        if (!n)
+        {
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << "Node not found: " << words[i];
+            return;
+        }
+        roots.emplace_back(n);
+    }
+    if (!roots.size() || !roots[0])
+    {
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << "Couldn't find current folder";
+        return;
+    }
+
+    if (removeduplicates && !forceremove)
+    {
+        string confirmationQuery("Duplicates will be moved to the Rubbish Bin, keeping the oldest copy of each group. Are you sure? (Yes/No): ");
+        int confirmationResponse = askforConfirmation(confirmationQuery);
+        while ( (confirmationResponse != MCMDCONFIRM_YES) && (confirmationResponse != MCMDCONFIRM_NO) )
+        {
+            confirmationResponse = askforConfirmation(confirmationQuery);
+        }
+        if (confirmationResponse != MCMDCONFIRM_YES)
+        {
+            return;
+        }
+    }
+
+    // index the files by size, in two passes: the sizes are counted first, so that only the files
+    // whose size is shared with others are kept. Those are the candidates
+    std::unique_ptr<FileSizeIndex> sizeIndex {new FileSizeIndex()};
+    int parallelism = ConfigurationManager::getConfigurationValue("dedup_parallelism", 8);
+    for (int pass = 0; pass < 2; pass++)
+    {
+        auto visitFile = [&sizeIndex, pass](MegaNode *n)
         {
-            mtxBackupsMap.lock();
-            for (map<string, backup_struct *>::iterator itr = ConfigurationManager::configuredBackups.begin(); itr != ConfigurationManager::configuredBackups.end(); itr++ )
+            if (n->getType() == MegaNode::TYPE_FILE && n->getSize() > 0)
             {
-                if(firstbackup)
+                if (pass)
+                {
+                    sizeIndex->add(n->getSize(), n->getHandle());
+                }
+                else
                 {
-                    printBackupHeader(PATHSIZE);
-                    firstbackup = false;
+                    sizeIndex->count(n->getSize());
                 }
-                printBackup(itr->second, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), PATHSIZE, listinfo, listhistory);
             }
-            if (!ConfigurationManager::configuredBackups.size())
+        };
+
+        for (auto &root : roots)
+        {
+            if (root->getType() == MegaNode::TYPE_FILE)
             {
-                setCurrentOutCode(MCMD_NOTFOUND);
-                OUTSTREAM << "No backup configured. " << endl << " Usage: " << getUsageStr("backup") << endl;
+                visitFile(root.get());
+                continue;
             }
-            mtxBackupsMap.unlock();
 
-        }
-        else
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("backup");
+            walkTreeInParallel(root.get(), parallelism, [&visitFile](MegaNode *folder, MegaNodeList *children)
+            {
+                for (int i = 0; children && i < children->size(); i++)
+                {
+                    visitFile(children->get(i));
+                }
+            });
         }
     }
-#endif
-    else if (words[0] == "put")
-    {
-        int clientID = getintOption(cloptions, "clientID", -1);
 
-        if (!api->isFilesystemAvailable())
+    // the candidates are grouped by the CRC of their fingerprints (without the modification time), and groups are
+    // output as found. That CRC only samples the contents: before removing any, the whole contents are compared
+    std::unique_ptr<MegaNode> rubbishNode {removeduplicates ? api->getRubbishNode() : NULL};
+    long long ngroups = 0;
+    long long nredundant = 0;
+    long long redundantSize = 0;
+    int failedRemovals = 0;
+    int unconfirmed = 0;
+
+    auto candidates = sizeIndex->takeCandidates();
+    sizeIndex.reset();
+    for (auto &candidate : candidates)
+    {
+        vector<MegaHandle> &handles = candidate.second;
+        std::sort(handles.begin(), handles.end());
+        handles.erase(std::unique(handles.begin(), handles.end()), handles.end()); // paths given may overlap
+        if (handles.size() < 2)
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            continue;
         }
 
-        bool background = getFlag(clflags,"q");
-        if (background)
+        map<string, vector<std::shared_ptr<MegaNode>>> byCRC;
+        for (auto h : handles)
         {
-            clientID = -1;
+            std::shared_ptr<MegaNode> node {api->getNodeByHandle(h)};
+            if (!node)
+            {
+                continue;
+            }
+            char *crc = api->getCRC(node.get());
+            if (crc)
+            {
+                byCRC[crc].push_back(node);
+                delete [] crc;
+            }
         }
 
-        MegaCmdMultiTransferListener *megaCmdMultiTransferListener = new MegaCmdMultiTransferListener(api, sandboxCMD, NULL, clientID);
-
-        bool ignorequotawarn = getFlag(clflags,"ignore-quota-warn");
-
-        if (words.size() > 1)
+        vector<vector<std::shared_ptr<MegaNode>>> groups;
+        for (auto &group : byCRC)
         {
-            string targetuser;
-            string newname = "";
-            string destination = "";
-
-            MegaNode *n = NULL;
-
-            if (words.size() > 2)
+            if (group.second.size() < 2)
             {
-                destination = words[words.size() - 1];
-                n = nodebypath(destination.c_str(), &targetuser, &newname);
-
-                if (!n && getFlag(clflags,"c"))
-                {
-                    string destinationfolder(destination,0,destination.find_last_of("/"));
-                    newname=string(destination,destination.find_last_of("/")+1,destination.size());
-                    MegaNode *cwdNode = api->getNodeByHandle(cwd);
-                    makedir(destinationfolder,true,cwdNode);
-                    n = nodebypath(destinationfolder.c_str());
-                    delete cwdNode;
-                }
+                continue;
             }
-            else
+            if (!removeduplicates)
             {
-                n = api->getNodeByHandle(cwd);
-                words.push_back(".");
+                groups.push_back(group.second);
+                continue;
             }
-            if (n)
+
+            map<string, vector<std::shared_ptr<MegaNode>>> byDigest;
+            for (auto &node : group.second)
             {
-                if (n->getType() != MegaNode::TYPE_FILE)
+                string digest;
+                if (hashFileContents(node.get(), &digest))
                 {
-                    for (int i = 1; i < max(1, (int)words.size() - 1); i++)
-                    {
-                        if (words[i] == ".")
-                        {
-                            words[i] = getLPWD();
-                        }
-
-#ifdef HAVE_GLOB_H
-                        if (!newname.size()
-#ifdef MEGACMDEXECUTER_FILESYSTEM
-                                && !fs::exists(words[i])
-#endif
-                                && hasWildCards(words[i]))
-                        {
-                            auto paths = resolvewildcard(words[i]);
-                            if (!paths.size())
-                            {
-                                setCurrentOutCode(MCMD_NOTFOUND);
-                                LOG_err << words[i] << " not found";
-                            }
-                            for (auto path : paths)
-                            {
-                                uploadNode(path, api, n, newname, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
-                            }
-                        }
-                        else
-#endif
-                        {
-                            uploadNode(words[i], api, n, newname, background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
-                        }
-                    }
+                    byDigest[digest].push_back(node);
                 }
-                else if (words.size() == 3 && !IsFolder(words[1])) //replace file
+                else
                 {
-                    unique_ptr<MegaNode> pn(api->getNodeByHandle(n->getParentHandle()));
-                    if (pn)
-                    {
-#if defined(HAVE_GLOB_H) && defined(MEGACMDEXECUTER_FILESYSTEM)
-                        if (!fs::exists(words[1]) && hasWildCards(words[1]))
-                        {
-                            LOG_err << "Invalid target for wildcard expression: " << words[1] << ". Folder expected";
-                            setCurrentOutCode(MCMD_INVALIDTYPE);
-                        }
-                        else
-#endif
-                        {
-                            uploadNode(words[1], api, pn.get(), n->getName(), background, ignorequotawarn, clientID, megaCmdMultiTransferListener);
-                        }
-                    }
-                    else
-                    {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        LOG_err << "Destination is not valid. Parent folder cannot be found";
-                    }
+                    unconfirmed++; // kept
                 }
-                else
+            }
+            for (auto &confirmed : byDigest)
+            {
+                if (confirmed.second.size() > 1)
                 {
-                    setCurrentOutCode(MCMD_INVALIDTYPE);
-                    LOG_err << "Destination is not valid (expected folder or alike)";
+                    groups.push_back(confirmed.second);
                 }
-                delete n;
-
+            }
+        }
 
-                megaCmdMultiTransferListener->waitMultiEnd();
+        for (auto &nodes : groups)
+        {
+            std::sort(nodes.begin(), nodes.end(), [](const std::shared_ptr<MegaNode> &a, const std::shared_ptr<MegaNode> &b)
+            {
+                return a->getCreationTime() < b->getCreationTime();
+            });
 
-                checkNoErrors(megaCmdMultiTransferListener->getFinalerror(), "upload");
+            ngroups++;
+            nredundant += nodes.size() - 1;
+            redundantSize += candidate.first * (long long)(nodes.size() - 1);
 
-                if (megaCmdMultiTransferListener->getProgressinformed() || getCurrentOutCode() == MCMD_OK )
+            OUTSTREAM << nodes.size() << " files of " << sizeToText(candidate.first) << ":" << endl;
+            for (size_t i = 0; i < nodes.size(); i++)
+            {
+                OUTSTREAM << "  " << sandboxCMD->nodePathCache.getNodePath(api, nodes[i].get());
+                if (removeduplicates && !i)
                 {
-                    informProgressUpdate(PROGRESS_COMPLETE, megaCmdMultiTransferListener->getTotalbytes(), clientID);
+                    OUTSTREAM << " (kept)";
                 }
-                delete megaCmdMultiTransferListener;
+                OUTSTREAM << endl;
             }
-            else
+
+            for (size_t i = 1; removeduplicates && rubbishNode && i < nodes.size(); i++)
             {
-                setCurrentOutCode(MCMD_NOTFOUND);
-                LOG_err << "Couln't find destination folder: " << destination << ". Use -c to create folder structure";
+                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                api->moveNode(nodes[i].get(), rubbishNode.get(), megaCmdListener);
+                megaCmdListener->wait();
+                if (!checkNoErrors(megaCmdListener->getError(), "move duplicate to the Rubbish Bin"))
+                {
+                    failedRemovals++;
+                }
+                delete megaCmdListener;
             }
         }
-        else
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("put");
-        }
+    }
+
+    if (unconfirmed)
+    {
+        setCurrentOutCode(MCMD_INVALIDSTATE);
+        LOG_err << unconfirmed << " files could not be downloaded to confirm they are duplicates: they were kept";
+    }
+    if (!ngroups)
+    {
+        OUTSTREAM << "No duplicated files found" << endl;
+        return;
+    }
+    OUTSTREAM << ngroups << " groups of duplicated files. " << nredundant << " redundant files "
+              << (removeduplicates ? "moved to the Rubbish Bin" : "taking") << ": " << sizeToText(redundantSize) << endl;
+    if (failedRemovals)
+    {
+        setCurrentOutCode(MCMD_INVALIDSTATE);
+        LOG_err << failedRemovals << " duplicates could not be moved to the Rubbish Bin";
+    }
+}
+
+void MegaCmdExecuter::executeDiff(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+#ifdef MEGACMDEXECUTER_FILESYSTEM
+    if (words.size() < 2 || words.size() > 3)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("diff");
+        return;
+    }
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+
+    MegaCmdOutputFormat outputFormat;
+    if (!getOutputFormat(cloptions, &outputFormat))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        return;
+    }
+    bool ndjson = outputFormat == MCMDOUTPUT_NDJSON;
+    bool checkFingerprints = getFlag(clflags, "fingerprint");
+
+    LocalPath localRelativePath = LocalPath::fromPath(words[1], *fsAccessCMD);
+    LocalPath localAbsolutePath;
+    fsAccessCMD->expanselocalpath(localRelativePath, localAbsolutePath);
+    string localRoot = localAbsolutePath.toPath(*fsAccessCMD);
+
+    std::unique_ptr<MegaNode> remoteRoot {words.size() > 2 ? nodebypath(words[2].c_str()) : api->getNodeByHandle(cwd)};
+    if (!remoteRoot)
+    {
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << "Node not found: " << (words.size() > 2 ? words[2] : string("current folder"));
+        return;
+    }
 
+    std::error_code ec;
+    fs::file_status localStatus = fs::status(fs::u8path(localRoot), ec);
+    if (!fs::is_directory(localStatus) && !fs::is_regular_file(localStatus))
+    {
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << "Local path not found: " << words[1];
         return;
     }
-    else if (words[0] == "log")
+
+    long long counts[3] = {0, 0, 0};
+    auto output = [ndjson, &counts](const DiffRecord &record)
     {
-        if (words.size() == 1)
+        static const char *statuses[] = {"added", "removed", "changed"};
+        counts[record.status]++;
+        if (ndjson)
         {
-            if (!getFlag(clflags, "s") && !getFlag(clflags, "c"))
+            NdjsonLine line;
+            line.addString("status", statuses[record.status]);
+            line.addString("path", record.path);
+            line.addString("type", record.isFolder ? "folder" : "file");
+            if (record.localSize >= 0)
             {
-                OUTSTREAM << "MEGAcmd log level = " << getLogLevelStr(loggerCMD->getCmdLoggerLevel()) << endl;
-                OUTSTREAM << "SDK log level = " << getLogLevelStr(loggerCMD->getApiLoggerLevel()) << endl;
+                line.addNumber("local_size", record.localSize);
             }
-            else if (getFlag(clflags, "s"))
+            if (record.remoteSize >= 0)
             {
-                OUTSTREAM << "SDK log level = " << getLogLevelStr(loggerCMD->getApiLoggerLevel()) << endl;
-            }
-            else if (getFlag(clflags, "c"))
-            {
-                OUTSTREAM << "MEGAcmd log level = " << getLogLevelStr(loggerCMD->getCmdLoggerLevel()) << endl;
+                line.addNumber("remote_size", record.remoteSize);
             }
+            OUTSTREAM << line.str();
         }
         else
         {
-            int newLogLevel = getLogLevelNum(words[1].c_str());
-            if (newLogLevel == -1)
-            {
-                setCurrentOutCode(MCMD_EARGS);
-                LOG_err << "Invalid log level";
-                return;
-            }
-            newLogLevel = max(newLogLevel, (int)MegaApi::LOG_LEVEL_FATAL);
-            newLogLevel = min(newLogLevel, (int)MegaApi::LOG_LEVEL_MAX);
-            if (!getFlag(clflags, "s") && !getFlag(clflags, "c"))
-            {
-                loggerCMD->setCmdLoggerLevel(newLogLevel);
-                loggerCMD->setApiLoggerLevel(newLogLevel);
-                OUTSTREAM << "MEGAcmd log level = " << getLogLevelStr(loggerCMD->getCmdLoggerLevel()) << endl;
-                OUTSTREAM << "SDK log level = " << getLogLevelStr(loggerCMD->getApiLoggerLevel()) << endl;
-            }
-            else if (getFlag(clflags, "s"))
-            {
-                loggerCMD->setApiLoggerLevel(newLogLevel);
-                OUTSTREAM << "SDK log level = " << getLogLevelStr(loggerCMD->getApiLoggerLevel()) << endl;
-            }
-            else if (getFlag(clflags, "c"))
-            {
-                loggerCMD->setCmdLoggerLevel(newLogLevel);
-                OUTSTREAM << "MEGAcmd log level = " << getLogLevelStr(loggerCMD->getCmdLoggerLevel()) << endl;
-            }
+            OUTSTREAM << getFixLengthString(statuses[record.status], 8) << record.path << endl;
         }
+    };
 
-        return;
-    }
-    else if (words[0] == "pwd")
+    if (fs::is_regular_file(localStatus) || remoteRoot->getType() == MegaNode::TYPE_FILE)
     {
-        if (!api->isFilesystemAvailable())
+        // a single file: compared directly, whatever their names
+        LocalFingerprintKey key;
+        statLocalFile(fsAccessCMD, localRoot, &key);
+        bool remoteIsFolder = remoteRoot->getType() != MegaNode::TYPE_FILE;
+        bool equal = fs::is_regular_file(localStatus) && !remoteIsFolder && key.size == remoteRoot->getSize();
+        if (equal && (checkFingerprints || key.mtime != remoteRoot->getModificationTime()))
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            equal = sameContents(localRoot, key, remoteRoot.get());
         }
-        string cwpath = getCurrentPath();
-
-        OUTSTREAM << cwpath << endl;
 
+        if (!equal)
+        {
+            DiffRecord record;
+            record.status = DiffRecord::CHANGED;
+            record.path = remoteRoot->getName() ? remoteRoot->getName() : "";
+            record.isFolder = remoteIsFolder;
+            record.localSize = key.size;
+            record.remoteSize = remoteIsFolder ? api->getSize(remoteRoot.get()) : remoteRoot->getSize();
+            output(record);
+        }
+        else if (!ndjson)
+        {
+            OUTSTREAM << "No differences found" << endl;
+        }
         return;
     }
-    else if (words[0] == "lcd") //this only makes sense for interactive mode
+
+    // folders are compared one by one in parallel, only remembering those pending to be compared
+    std::mutex diffMutex;
+    std::unordered_map<MegaHandle, pair<string, string> > pendingFolders {{remoteRoot->getHandle(), std::make_pair(localRoot, string())}};
+    std::deque<DiffRecord> pendingRecords;
+    std::vector<std::unique_ptr<MegaFileSystemAccess> > fsAccessPool; // not to share fsAccessCMD among threads
+
+    fingerprintCache.load(ConfigurationManager::getConfigFolder() + "/" + "fingerprints");
+    walkTreeInParallel(remoteRoot.get(), ConfigurationManager::getConfigurationValue("diff_parallelism", 8), [&](MegaNode *folder, MegaNodeList *children)
     {
-        if (words.size() > 1)
+        pair<string, string> paths;
+        std::unique_ptr<MegaFileSystemAccess> fsAccess;
         {
-            LocalPath localpath = LocalPath::fromPath(words[1], *fsAccessCMD);
-            if (fsAccessCMD->chdirlocal(localpath)) // maybe this is already checked in chdir
+            std::lock_guard<std::mutex> g(diffMutex);
+            auto it = pendingFolders.find(folder->getHandle());
+            if (it == pendingFolders.end())
             {
-                LOG_debug << "Local folder changed to: " << words[1];
+                return;
             }
-            else
+            paths = std::move(it->second);
+            pendingFolders.erase(it);
+            if (fsAccessPool.size())
             {
-                setCurrentOutCode(MCMD_INVALIDTYPE);
-                LOG_err << "Not a valid folder: " << words[1];
+                fsAccess = std::move(fsAccessPool.back());
+                fsAccessPool.pop_back();
             }
         }
-        else
+        if (!fsAccess)
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("lcd");
+            fsAccess.reset(new MegaFileSystemAccess());
         }
 
-        return;
-    }
-    else if (words[0] == "lpwd")
+        vector<DiffRecord> records;
+        vector<pair<MegaHandle, pair<string, string> > > subfolders;
+        diffFolder(paths.first, paths.second, children, checkFingerprints, fsAccess.get(), &records, &subfolders);
+
+        std::lock_guard<std::mutex> g(diffMutex);
+        for (auto &subfolder : subfolders)
+        {
+            pendingFolders[subfolder.first] = std::move(subfolder.second);
+        }
+        pendingRecords.insert(pendingRecords.end(), records.begin(), records.end());
+        fsAccessPool.push_back(std::move(fsAccess));
+    }, [&]()
+    {
+        std::deque<DiffRecord> ready;
+        {
+            std::lock_guard<std::mutex> g(diffMutex);
+            ready.swap(pendingRecords);
+        }
+        for (auto &record : ready)
+        {
+            output(record);
+        }
+    }, [&](MegaNode *subfolder)
     {
-        string absolutePath = getLPWD();
+        std::lock_guard<std::mutex> g(diffMutex);
+        return pendingFolders.count(subfolder->getHandle()) > 0;
+    });
+    fingerprintCache.flush();
 
-        OUTSTREAM << absolutePath << endl;
-        return;
-    }
-    else if (words[0] == "ipc")
+    if (!ndjson)
     {
-        if (!api->isFilesystemAvailable())
+        if (counts[DiffRecord::ADDED] || counts[DiffRecord::REMOVED] || counts[DiffRecord::CHANGED])
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            OUTSTREAM << counts[DiffRecord::ADDED] << " added, " << counts[DiffRecord::REMOVED] << " removed, "
+                      << counts[DiffRecord::CHANGED] << " changed" << endl;
         }
-        if (words.size() > 1)
+        else
+        {
+            OUTSTREAM << "No differences found" << endl;
+        }
+    }
+#else
+    setCurrentOutCode(MCMD_NOTPERMITTED);
+    LOG_err << "diff is not supported in this platform";
+#endif
+}
+
+#ifdef HAVE_LIBUV
+void MegaCmdExecuter::executeWebdav(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    bool remove = getFlag(clflags, "d");
+    bool all = getFlag(clflags, "all");
+
+    if (words.size() == 1 && remove && !all)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("webdav");
+        return;
+    }
+
+    if (words.size() == 1 && !remove)
+    {
+        //List served nodes
+        MegaNodeList *webdavnodes = api->httpServerGetWebDavAllowedNodes();
+        if (webdavnodes)
         {
-            int action;
-            string saction;
+            bool found = false;
 
-            if (getFlag(clflags, "a"))
+            for (int a = 0; a < webdavnodes->size(); a++)
             {
-                action = MegaContactRequest::REPLY_ACTION_ACCEPT;
-                saction = "Accept";
+                MegaNode *n= webdavnodes->get(a);
+                if (n)
+                {
+                    char *link = api->httpServerGetLocalWebDavLink(n); //notice this is not only consulting but also creating,
+                    //had it been deleted in the meantime this will recreate it
+                    if (link)
+                    {
+                        if (!found)
+                        {
+                            OUTSTREAM << "WEBDAV SERVED LOCATIONS:" << endl;
+                        }
+                        found = true;
+                        char * nodepath = api->getNodePath(n);
+                        OUTSTREAM << nodepath << ": " << link << endl;
+                        delete []nodepath;
+                        delete []link;
+                    }
+                }
             }
-            else if (getFlag(clflags, "d"))
+
+            if(!found)
             {
-                action = MegaContactRequest::REPLY_ACTION_DENY;
-                saction = "Reject";
+                OUTSTREAM << "No webdav links found" << endl;
             }
-            else if (getFlag(clflags, "i"))
+
+            delete webdavnodes;
+
+       }
+       else
+       {
+           OUTSTREAM << "Webdav server might not running. Add a new location to serve." << endl;
+       }
+
+       return;
+    }
+
+    if (!remove)
+    {
+        //create new link:
+        bool tls = getFlag(clflags, "tls");
+        int port = getintOption(cloptions, "port", 4443);
+        bool localonly = !getFlag(clflags, "public");
+
+        string pathtocert = getOption(cloptions, "certificate", "");
+        string pathtokey = getOption(cloptions, "key", "");
+
+        bool serverstarted = api->httpServerIsRunning();
+        if (!serverstarted)
+        {
+            LOG_info << "Starting http server";
+            api->httpServerEnableFolderServer(true);
+//            api->httpServerEnableOfflineAttribute(true); //TODO: we might want to offer this as parameter
+            if (api->httpServerStart(localonly, port, tls, pathtocert.c_str(), pathtokey.c_str()))
             {
-                action = MegaContactRequest::REPLY_ACTION_IGNORE;
-                saction = "Ignore";
+                ConfigurationManager::savePropertyValue("webdav_port", port);
+                ConfigurationManager::savePropertyValue("webdav_localonly", localonly);
+                ConfigurationManager::savePropertyValue("webdav_tls", tls);
+                if (pathtocert.size())
+                {
+                    ConfigurationManager::savePropertyValue("webdav_cert", pathtocert);
+                }
+                if (pathtokey.size())
+                {
+                    ConfigurationManager::savePropertyValue("webdav_key", pathtokey);
+                }
             }
             else
             {
                 setCurrentOutCode(MCMD_EARGS);
-                LOG_err << "      " << getUsageStr("ipc");
+                LOG_err << "Failed to initialize WEBDAV server. Ensure the port is free.";
                 return;
             }
+        }
+    }
 
-            MegaContactRequest * cr;
-            string shandle = words[1];
-            handle thehandle = api->base64ToUserHandle(shandle.c_str());
+    //add/remove
+    if (remove && all)
+    {
+        api->httpServerRemoveWebDavAllowedNodes();
+        api->httpServerStop();
 
-            if (shandle.find('@') != string::npos)
+        list<string> servedpaths;
+        ConfigurationManager::savePropertyValueList("webdav_served_locations", servedpaths);
+        ConfigurationManager::savePropertyValue("webdav_port", -1); //so as not to load server on startup
+        OUTSTREAM << "Wevdav server stopped: no path will be served." << endl;
+    }
+    else
+    {
+        bool firstone = true;
+        for (unsigned int i = 1; i < words.size(); i++)
+        {
+            string pathToServe = words[i];
+            if (remove)
             {
-                cr = getPcrByContact(shandle);
+                processPath(pathToServe, getFlag(clflags,"use-pcre"), firstone, forwarderRemoveWebdavLocation, this);
             }
             else
             {
-                cr = api->getContactRequestByHandle(thehandle);
+                processPath(pathToServe, getFlag(clflags,"use-pcre"), firstone, forwarderAddWebdavLocation, this);
             }
-            if (cr)
+        }
+    }
+}
+
+void MegaCmdExecuter::executeFtp(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    bool remove = getFlag(clflags, "d");
+    bool all = getFlag(clflags, "all");
+
+    if (words.size() == 1 && remove && !all)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("ftp");
+        return;
+    }
+
+    if (words.size() == 1 && !remove)
+    {
+        //List served nodes
+        MegaNodeList *ftpnodes = api->ftpServerGetAllowedNodes();
+        if (ftpnodes)
+        {
+            bool found = false;
+
+            for (int a = 0; a < ftpnodes->size(); a++)
             {
-                MegaCmdListener *megaCmdListener = new MegaCmdListener(api, NULL);
-                api->replyContactRequest(cr, action, megaCmdListener);
-                megaCmdListener->wait();
-                if (checkNoErrors(megaCmdListener->getError(), "reply ipc"))
+                MegaNode *n= ftpnodes->get(a);
+                if (n)
                 {
-                    OUTSTREAM << saction << "ed invitation by " << cr->getSourceEmail() << endl;
+                    char *link = api->ftpServerGetLocalLink(n); //notice this is not only consulting but also creating,
+                    //had it been deleted in the meantime this will recreate it
+                    if (link)
+                    {
+                        if (!found)
+                        {
+                            OUTSTREAM << "FTP SERVED LOCATIONS:" << endl;
+                        }
+                        found = true;
+                        char * nodepath = api->getNodePath(n);
+                        OUTSTREAM << nodepath << ": " << link << endl;
+                        delete []nodepath;
+                        delete []link;
+                    }
                 }
-                delete megaCmdListener;
-                delete cr;
             }
-            else
+
+            if(!found)
             {
-                setCurrentOutCode(MCMD_NOTFOUND);
-                LOG_err << "Could not find invitation " << shandle;
+                OUTSTREAM << "No ftp links found" << endl;
             }
+
+            delete ftpnodes;
+
+       }
+       else
+       {
+           OUTSTREAM << "Ftp server might not running. Add a new location to serve." << endl;
+       }
+
+       return;
+    }
+
+    if (!remove)
+    {
+        //create new link:
+        bool tls = getFlag(clflags, "tls");
+        int port = getintOption(cloptions, "port", 4990);
+        bool localonly = !getFlag(clflags, "public");
+
+        string dataPorts = getOption(cloptions, "data-ports");
+        size_t seppos = dataPorts.find("-");
+        int dataPortRangeBegin = 1500;
+        istringstream is(dataPorts.substr(0,seppos));
+        is >> dataPortRangeBegin;
+        int dataPortRangeEnd = dataPortRangeBegin + 100;
+        if (seppos != string::npos && seppos < (dataPorts.size()+1))
+        {
+            istringstream is(dataPorts.substr(seppos+1));
+            is >> dataPortRangeEnd;
         }
-        else
+
+        string pathtocert = getOption(cloptions, "certificate", "");
+        string pathtokey = getOption(cloptions, "key", "");
+
+        if (tls && (!pathtocert.size() || !pathtokey.size()))
         {
             setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("ipc");
+            LOG_err << "Path to certificate/key not indicated";
             return;
         }
-        return;
+
+        bool serverstarted = api->ftpServerIsRunning();
+        if (!serverstarted)
+        {
+            if (api->ftpServerStart(localonly, port, dataPortRangeBegin, dataPortRangeEnd, tls, pathtocert.c_str(), pathtokey.c_str()))
+            {
+                ConfigurationManager::savePropertyValue("ftp_port", port);
+                ConfigurationManager::savePropertyValue("ftp_port_data_begin", dataPortRangeBegin);
+                ConfigurationManager::savePropertyValue("ftp_port_data_end", dataPortRangeEnd);
+                ConfigurationManager::savePropertyValue("ftp_localonly", localonly);
+                ConfigurationManager::savePropertyValue("ftp_tls", tls);
+                if (pathtocert.size())
+                {
+                    ConfigurationManager::savePropertyValue("ftp_cert", pathtocert);
+                }
+                if (pathtokey.size())
+                {
+                    ConfigurationManager::savePropertyValue("ftp_key", pathtokey);
+                }
+                LOG_info << "Started ftp server at port " << port << ". Data Channel Port Range: " << dataPortRangeBegin << "-" << dataPortRangeEnd;
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_EARGS);
+                LOG_err << "Failed to initialize FTP server. Ensure the port is free.";
+                return;
+            }
+        }
+    }
+
+    //add/remove
+    if (remove && all)
+    {
+        api->ftpServerRemoveAllowedNodes();
+        api->ftpServerStop();
+
+        list<string> servedpaths;
+        ConfigurationManager::savePropertyValueList("ftp_served_locations", servedpaths);
+        ConfigurationManager::savePropertyValue("ftp_port", -1); //so as not to load server on startup
+        OUTSTREAM << "ftp server stopped: no path will be served." << endl;
     }
-    else if (words[0] == "https")
+    else
     {
-        if (words.size() > 1 && (words[1] == "on" || words[1] == "off"))
+        bool firstone = true;
+        for (unsigned int i = 1; i < words.size(); i++)
         {
-            bool onlyhttps = words[1] == "on";
-            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-            api->useHttpsOnly(onlyhttps,megaCmdListener);
-            megaCmdListener->wait();
-            if (checkNoErrors(megaCmdListener->getError(), "change https"))
+            string pathToServe = words[i];
+            if (remove)
             {
-                OUTSTREAM << "File transfer now uses " << (api->usingHttpsOnly()?"HTTPS":"HTTP") << endl;
-                ConfigurationManager::savePropertyValue("https", api->usingHttpsOnly());
+                processPath(pathToServe, getFlag(clflags,"use-pcre"), firstone, forwarderRemoveFtpLocation, this);
+            }
+            else
+            {
+                processPath(pathToServe, getFlag(clflags,"use-pcre"), firstone, forwarderAddFtpLocation, this);
             }
-            delete megaCmdListener;
-            return;
         }
-        else if (words.size() > 1)
+    }
+}
+#endif
+
+#ifdef ENABLE_SYNC
+void MegaCmdExecuter::executeExclude(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    api->enableTransferResumption();
+
+    if (getFlag(clflags, "a"))
+    {
+        for (unsigned int i=1;i<words.size(); i++)
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("https");
-            return;
+            ConfigurationManager::addExcludedName(words[i]);
+        }
+        if (words.size()>1)
+        {
+            std::vector<string> vexcludednames(ConfigurationManager::excludedNames.begin(), ConfigurationManager::excludedNames.end());
+            api->setExcludedNames(&vexcludednames);
+            if (getFlag(clflags, "restart-syncs"))
+            {
+                restartsyncs();
+            }
         }
         else
         {
-            OUTSTREAM << "File transfer is done using " << (api->usingHttpsOnly()?"HTTPS":"HTTP") << endl;
+            setCurrentOutCode(MCMD_EARGS);
+            LOG_err << "      " << getUsageStr("exclude");
+            return;
         }
-        return;
     }
-    else if (words[0] == "graphics")
+    else if (getFlag(clflags, "d"))
     {
-        if (words.size() == 2 && (words[1] == "on" || words[1] == "off"))
+        for (unsigned int i=1;i<words.size(); i++)
         {
-            bool enableGraphics = words[1] == "on";
-
-            api->disableGfxFeatures(!enableGraphics);
-            ConfigurationManager::savePropertyValue("graphics", !api->areGfxFeaturesDisabled());
+            ConfigurationManager::removeExcludedName(words[i]);
+        }
+        if (words.size()>1)
+        {
+            std::vector<string> vexcludednames(ConfigurationManager::excludedNames.begin(), ConfigurationManager::excludedNames.end());
+            api->setExcludedNames(&vexcludednames);
+            if (getFlag(clflags, "restart-syncs"))
+            {
+                restartsyncs();
+            }
         }
-        else if (words.size() > 1)
+        else
         {
             setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("https");
+            LOG_err << "      " << getUsageStr("exclude");
             return;
         }
-
-        OUTSTREAM << "Graphic features " << (api->areGfxFeaturesDisabled()?"disabled":"enabled") << endl;
-        return;
     }
-#ifndef _WIN32
-    else if (words[0] == "permissions")
-    {
-        bool filesflagread = getFlag(clflags, "files");
-        bool foldersflagread = getFlag(clflags, "folders");
 
-        bool filesflag = filesflagread || (!filesflagread && !foldersflagread);
-        bool foldersflag = foldersflagread || (!filesflagread && !foldersflagread);
 
-        bool setperms = getFlag(clflags, "s");
+    OUTSTREAM << "List of excluded names:" << endl;
 
-        if ( (!setperms && words.size() > 1) || (setperms && words.size() != 2) || ( setperms && filesflagread  && foldersflagread ) || (setperms && !filesflagread && !foldersflagread))
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("permissions");
-            return;
-        }
+    for (set<string>::iterator it=ConfigurationManager::excludedNames.begin(); it!=ConfigurationManager::excludedNames.end(); ++it)
+    {
+        OUTSTREAM << *it << endl;
+    }
 
-        int permvalue = -1;
-        if (setperms)
-        {
-             if (words[1].size() != 3)
-             {
-                 setCurrentOutCode(MCMD_EARGS);
-                 LOG_err << "Invalid permissions value: " << words[1];
-             }
-             else
-             {
-                 int owner = words[1].at(0) - '0';
-                 int group = words[1].at(1) - '0';
-                 int others = words[1].at(2) - '0';
-                 if ( (owner < 6) || (owner == 6 && foldersflag) || (owner > 7) || (group < 0) || (group > 7) || (others < 0) || (others > 7) )
-                 {
-                     setCurrentOutCode(MCMD_EARGS);
-                     LOG_err << "Invalid permissions value: " << words[1];
-                 }
-                 else
-                 {
-                     permvalue = (owner << 6) + ( group << 3) + others;
-                 }
-             }
-        }
+    if ( !getFlag(clflags, "restart-syncs") && (getFlag(clflags, "a") || getFlag(clflags, "d")) )
+    {
+        OUTSTREAM << endl <<  "Changes will not be applied immediately to operations being performed in active syncs."
+                  << " See \"exclude --help\" for further info" << endl;
+    }
+}
 
-        if (filesflag)
-        {
-            if (setperms && permvalue != -1)
-            {
-                api->setDefaultFilePermissions(permvalue);
-                ConfigurationManager::savePropertyValue("permissionsFiles", readablePermissions(permvalue));
-            }
-            int filepermissions = api->getDefaultFilePermissions();
-            int owner  = (filepermissions >> 6) & 0x07;
-            int group  = (filepermissions >> 3) & 0x07;
-            int others = filepermissions & 0x07;
+void MegaCmdExecuter::executeSync(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    if (!api->isLoggedIn())
+    {
+        LOG_err << "Not logged in";
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        return;
+    }
 
-            OUTSTREAM << "Default files permissions: " << owner << group << others << endl;
-        }
-        if (foldersflag)
-        {
-            if (setperms && permvalue != -1)
-            {
-                api->setDefaultFolderPermissions(permvalue);
-                ConfigurationManager::savePropertyValue("permissionsFolders", readablePermissions(permvalue));
-            }
-            int folderpermissions = api->getDefaultFolderPermissions();
-            int owner  = (folderpermissions >> 6) & 0x07;
-            int group  = (folderpermissions >> 3) & 0x07;
-            int others = folderpermissions & 0x07;
-            OUTSTREAM << "Default folders permissions: " << owner << group << others << endl;
-        }
+    int PATHSIZE = getintOption(cloptions,"path-display-size");
+    if (!PATHSIZE)
+    {
+        // get screen size for output purposes
+        unsigned int width = getNumberOfCols(75);
+        PATHSIZE = min(60,int((width-46)/2));
     }
-#endif
-    else if (words[0] == "deleteversions")
+    PATHSIZE = max(0, PATHSIZE);
+
+    MegaCmdOutputFormat outputFormat;
+    if (!getOutputFormat(cloptions, &outputFormat))
     {
-        bool deleteall = getFlag(clflags, "all");
-        bool forcedelete = getFlag(clflags, "f");
-        if (deleteall && words.size()>1)
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("deleteversions");
-            return;
-        }
-        if (deleteall)
-        {
-            string confirmationQuery("Are you sure todelete the version histories of all files? (Yes/No): ");
+        setCurrentOutCode(MCMD_EARGS);
+        return;
+    }
+    bool ndjson = outputFormat == MCMDOUTPUT_NDJSON;
 
-            int confirmationResponse = forcedelete?MCMDCONFIRM_YES:askforConfirmation(confirmationQuery);
+    bool headershown = false;
+    bool modifiedsyncs = false;
+    mtxSyncMap.lock();
+    if (words.size() == 3)
+    {
+        LocalPath localRelativePath = LocalPath::fromPath(words[1], *fsAccessCMD);
+        LocalPath localAbsolutePath = localRelativePath;
+        fsAccessCMD->expanselocalpath(localRelativePath, localAbsolutePath);
 
-            while ( (confirmationResponse != MCMDCONFIRM_YES) && (confirmationResponse != MCMDCONFIRM_NO) )
+        MegaNode* n = nodebypath(words[2].c_str());
+        if (n)
+        {
+            if (n->getType() == MegaNode::TYPE_FILE)
             {
-                confirmationResponse = askforConfirmation(confirmationQuery);
+                LOG_err << words[2] << ": Remote sync root must be folder.";
             }
-            if (confirmationResponse == MCMDCONFIRM_YES)
+            else if (api->getAccess(n) >= MegaShare::ACCESS_FULL)
             {
+                std::lock_guard<std::recursive_mutex> g(ConfigurationManager::settingsMutex);
 
                 MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                api->removeVersions(megaCmdListener);
+                api->syncFolder(localAbsolutePath.toPath(*fsAccessCMD).c_str(), n, megaCmdListener);
                 megaCmdListener->wait();
-                if (checkNoErrors(megaCmdListener->getError(), "remove all versions"))
+                if (checkNoErrors(megaCmdListener->getError(), "sync folder"))
                 {
-                    OUTSTREAM << "File versions deleted succesfully. Please note that the current files were not deleted, just their history." << endl;
+                    sync_struct *thesync = new sync_struct;
+                    thesync->active = true;
+                    thesync->handle = megaCmdListener->getRequest()->getNodeHandle();
+                    thesync->localpath = string(megaCmdListener->getRequest()->getFile());
+                    thesync->fingerprint = megaCmdListener->getRequest()->getNumber();
+
+                    if (ConfigurationManager::configuredSyncs.find(megaCmdListener->getRequest()->getFile()) != ConfigurationManager::configuredSyncs.end())
+                    {
+                        delete ConfigurationManager::configuredSyncs[megaCmdListener->getRequest()->getFile()];
+                    }
+                    ConfigurationManager::configuredSyncs[megaCmdListener->getRequest()->getFile()] = thesync;
+
+                    char * nodepath = api->getNodePath(n);
+                    LOG_info << "Added sync: " << megaCmdListener->getRequest()->getFile() << " to " << nodepath;
+
+                    modifiedsyncs=true;
+                    delete []nodepath;
                 }
+
                 delete megaCmdListener;
             }
+            else
+            {
+                setCurrentOutCode(MCMD_NOTPERMITTED);
+                LOG_err << words[2] << ": Syncing requires full access to path, current access: " << api->getAccess(n);
+            }
+            delete n;
         }
         else
         {
-            for (unsigned int i = 1; i < words.size(); i++)
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << "Couldn't find remote folder: " << words[2];
+        }
+    }
+    else if (words.size() == 2)
+    {
+        int id = toInteger(words[1].c_str());
+        map<string, sync_struct *>::iterator itr;
+        int i = 0;
+        bool foundsync = false;
+        std::lock_guard<std::recursive_mutex> g(ConfigurationManager::settingsMutex);
+        for (itr = ConfigurationManager::configuredSyncs.begin(); itr != ConfigurationManager::configuredSyncs.end(); i++)
+        {
+            string key = ( *itr ).first;
+            sync_struct *thesync = ((sync_struct*)( *itr ).second );
+            MegaNode * n = api->getNodeByHandle(thesync->handle);
+            bool erased = false;
+
+            if (n)
             {
-                if (isRegExp(words[i]))
+                char * nodepath = api->getNodePath(n);
+                ColumnDisplayer cd(getintOption(cloptions,"path-display-size", 0));
+
+                if (( id == i ) || (( id == -1 ) && ( words[1] == thesync->localpath )))
                 {
-                    vector<MegaNode *> *nodesToDeleteVersions = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
-                    if (nodesToDeleteVersions && nodesToDeleteVersions->size())
+                    foundsync = true;
+                    long long nfiles = 0;
+                    long long nfolders = 0;
+                    nfolders++; //add the share itself
+                    getInfoFromFolder(n, api, &nfiles, &nfolders);
+
+                    if (getFlag(clflags, "s") || getFlag(clflags, "r"))
                     {
-                        for (std::vector< MegaNode * >::iterator it = nodesToDeleteVersions->begin(); it != nodesToDeleteVersions->end(); ++it)
+                        bool stopping = getFlag(clflags, "s");
+                        LOG_info << (stopping?"Stopping (disabling) sync ":"Resuming sync ") << key << ": " << nodepath;
+                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                        if (stopping)
+                        {
+                            api->disableSync(n, megaCmdListener);
+                        }
+                        else
                         {
-                            MegaNode * nodeToDeleteVersions = *it;
-                            if (nodeToDeleteVersions)
+                            api->syncFolder(thesync->localpath.c_str(), n, megaCmdListener);
+                        }
+
+                        megaCmdListener->wait();
+
+                        if (checkNoErrors(megaCmdListener->getError(), stopping?"stop sync":"resume sync"))
+                        {
+                            thesync->active = !stopping;
+                            thesync->loadedok = true;
+                            if (!stopping) //syncFolder
                             {
-                                int ret = deleteNodeVersions(nodeToDeleteVersions, api, forcedelete);
-                                forcedelete = forcedelete || (ret == MCMDCONFIRM_ALL);
+                                if (megaCmdListener->getRequest()->getNumber())
+                                {
+                                    thesync->fingerprint = megaCmdListener->getRequest()->getNumber();
+                                }
                             }
+                            modifiedsyncs=true;
                         }
+                        else
+                        {
+                            thesync->active = false;
+                            thesync->loadedok = false;
+                        }
+                        delete megaCmdListener;
                     }
-                    else
+                    else if (getFlag(clflags, "d"))
                     {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        LOG_err << "No node found: " << words[i];
+                        LOG_debug << "Removing sync " << key << " to " << nodepath;
+                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                        if (thesync->active)  //if not active, removeSync will fail.)
+                        {
+                            api->removeSync(n, megaCmdListener);
+                            megaCmdListener->wait();
+                            if (checkNoErrors(megaCmdListener->getError(), "remove sync"))
+                            {
+                                ConfigurationManager::configuredSyncs.erase(itr++); //TODO: should protect with mutex!
+                                erased = true;
+                                delete ( thesync );
+                                OUTSTREAM << "Removed sync " << key << " to " << nodepath << endl;
+                                modifiedsyncs=true;
+                            }
+                        }
+                        else //if !active simply remove
+                        {
+                            //TODO: if the sdk ever provides a way to clean cache, call it
+                            ConfigurationManager::configuredSyncs.erase(itr++);
+                            erased = true;
+                            delete ( thesync );
+                            OUTSTREAM << "Removed sync " << key << " to " << nodepath << endl;
+                            modifiedsyncs=true;
+                        }
+                        delete megaCmdListener;
                     }
-                    delete nodesToDeleteVersions;
-                }
-                else // non-regexp
-                {
-                    MegaNode *n = nodebypath(words[i].c_str());
-                    if (n)
+
+                    if (ndjson)
                     {
-                        int ret = deleteNodeVersions(n, api, forcedelete);
-                        forcedelete = forcedelete || (ret == MCMDCONFIRM_ALL);
+                        if (!erased)
+                        {
+                            printSyncNdjson(i, key, nodepath, thesync, n, nfiles, nfolders);
+                        }
                     }
                     else
                     {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        LOG_err << "Node not found: " << words[i];
-                    }
-                    delete n;
-                }
-            }
-        }
-    }
-#ifdef HAVE_LIBUV
-    else if (words[0] == "webdav")
-    {
-        bool remove = getFlag(clflags, "d");
-        bool all = getFlag(clflags, "all");
-
-        if (words.size() == 1 && remove && !all)
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("webdav");
-            return;
-        }
-
-        if (words.size() == 1 && !remove)
-        {
-            //List served nodes
-            MegaNodeList *webdavnodes = api->httpServerGetWebDavAllowedNodes();
-            if (webdavnodes)
-            {
-                bool found = false;
-
-                for (int a = 0; a < webdavnodes->size(); a++)
-                {
-                    MegaNode *n= webdavnodes->get(a);
-                    if (n)
-                    {
-                        char *link = api->httpServerGetLocalWebDavLink(n); //notice this is not only consulting but also creating,
-                        //had it been deleted in the meantime this will recreate it
-                        if (link)
+                        if (!headershown)
                         {
-                            if (!found)
-                            {
-                                OUTSTREAM << "WEBDAV SERVED LOCATIONS:" << endl;
-                            }
-                            found = true;
-                            char * nodepath = api->getNodePath(n);
-                            OUTSTREAM << nodepath << ": " << link << endl;
-                            delete []nodepath;
-                            delete []link;
+                            headershown = true;
+                            printSyncHeader(PATHSIZE, &cd);
                         }
+
+                        printSync(i, key, nodepath, thesync, n, nfiles, nfolders, PATHSIZE, &cd);
                     }
-                }
 
-                if(!found)
+                }
+                delete n;
+                delete []nodepath;
+                if (!ndjson)
                 {
-                    OUTSTREAM << "No webdav links found" << endl;
+                    OUTSTRINGSTREAM oss;
+                    cd.print(oss, getintOption(cloptions, "client-width", getNumberOfCols(75)));
+                    OUTSTREAM << oss.str();
                 }
-
-                delete webdavnodes;
-
-           }
-           else
-           {
-               OUTSTREAM << "Webdav server might not running. Add a new location to serve." << endl;
-           }
-
-           return;
-        }
-
-        if (!remove)
-        {
-            //create new link:
-            bool tls = getFlag(clflags, "tls");
-            int port = getintOption(cloptions, "port", 4443);
-            bool localonly = !getFlag(clflags, "public");
-
-            string pathtocert = getOption(cloptions, "certificate", "");
-            string pathtokey = getOption(cloptions, "key", "");
-
-            bool serverstarted = api->httpServerIsRunning();
-            if (!serverstarted)
+            }
+            else
             {
-                LOG_info << "Starting http server";
-                api->httpServerEnableFolderServer(true);
-    //            api->httpServerEnableOfflineAttribute(true); //TODO: we might want to offer this as parameter
-                if (api->httpServerStart(localonly, port, tls, pathtocert.c_str(), pathtokey.c_str()))
+                if (( id == i ) && getFlag(clflags, "d")) //simply remove: disabled (not found)
                 {
-                    ConfigurationManager::savePropertyValue("webdav_port", port);
-                    ConfigurationManager::savePropertyValue("webdav_localonly", localonly);
-                    ConfigurationManager::savePropertyValue("webdav_tls", tls);
-                    if (pathtocert.size())
-                    {
-                        ConfigurationManager::savePropertyValue("webdav_cert", pathtocert);
-                    }
-                    if (pathtokey.size())
-                    {
-                        ConfigurationManager::savePropertyValue("webdav_key", pathtokey);
-                    }
+                    ConfigurationManager::configuredSyncs.erase(itr++);
+                    erased = true;
+                    delete ( thesync );
+                    OUTSTREAM << "Removed sync " << key << endl;
+                    modifiedsyncs = true;
                 }
                 else
                 {
-                    setCurrentOutCode(MCMD_EARGS);
-                    LOG_err << "Failed to initialize WEBDAV server. Ensure the port is free.";
-                    return;
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << "Node not found for sync " << key << " into handle: " << thesync->handle;
                 }
             }
+            if (!erased)
+            {
+                ++itr;
+            }
         }
-
-        //add/remove
-        if (remove && all)
+        if (!foundsync && !modifiedsyncs)
         {
-            api->httpServerRemoveWebDavAllowedNodes();
-            api->httpServerStop();
-
-            list<string> servedpaths;
-            ConfigurationManager::savePropertyValueList("webdav_served_locations", servedpaths);
-            ConfigurationManager::savePropertyValue("webdav_port", -1); //so as not to load server on startup
-            OUTSTREAM << "Wevdav server stopped: no path will be served." << endl;
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << "Sync not found: " << words[1] << ". Please provide full path or valid ID";
         }
-        else
+    }
+    else if (words.size() == 1)
+    {
+        ColumnDisplayer cd(getintOption(cloptions,"path-display-size", 0));
+        map<string, sync_struct *>::const_iterator itr;
+        int i = 0;
+        for (itr = ConfigurationManager::configuredSyncs.begin(); itr != ConfigurationManager::configuredSyncs.end(); ++itr)
         {
-            bool firstone = true;
-            for (unsigned int i = 1; i < words.size(); i++)
+            sync_struct *thesync = ((sync_struct*)( *itr ).second );
+            MegaNode * n = api->getNodeByHandle(thesync->handle);
+            if (ndjson)
             {
-                string pathToServe = words[i];
-                if (remove)
+                if (n)
                 {
-                    processPath(pathToServe, getFlag(clflags,"use-pcre"), firstone, forwarderRemoveWebdavLocation, this);
+                    long long nfiles = 0;
+                    long long nfolders = 1; //the share itself
+                    getInfoFromFolder(n, api, &nfiles, &nfolders);
+
+                    char * nodepath = api->getNodePath(n);
+                    printSyncNdjson(i++, ( *itr ).first, nodepath, thesync, n, nfiles, nfolders);
+                    delete n;
+                    delete []nodepath;
                 }
                 else
                 {
-                    processPath(pathToServe, getFlag(clflags,"use-pcre"), firstone, forwarderAddWebdavLocation, this);
+                    printSyncNdjson(i++, ( *itr ).first, "", thesync, n, -1, -1);
+                    setCurrentOutCode(MCMD_NOTFOUND);
                 }
+                continue;
+            }
+            if (!headershown)
+            {
+                headershown = true;
+                printSyncHeader(PATHSIZE, &cd);
+            }
+            if (n)
+            {
+                long long nfiles = 0;
+                long long nfolders = 0;
+                nfolders++; //add the share itself
+                getInfoFromFolder(n, api, &nfiles, &nfolders);
+
+                char * nodepath = api->getNodePath(n);
+                printSync(i++, ( *itr ).first, nodepath, thesync, n, nfiles, nfolders, PATHSIZE, &cd);
+
+                delete n;
+                delete []nodepath;
+            }
+            else
+            {
+                printSync(i++, ( *itr ).first, "NOT FOUND", thesync, n, -1, -1, PATHSIZE, &cd);
+                setCurrentOutCode(MCMD_NOTFOUND);
             }
         }
+        if (!ndjson)
+        {
+            OUTSTRINGSTREAM oss;
+            cd.print(oss, getintOption(cloptions, "client-width", getNumberOfCols(75)));
+            OUTSTREAM << oss.str();
+        }
     }
-    else if (words[0] == "ftp")
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("sync");
+        mtxSyncMap.unlock();
+        return;
+    }
+    if (modifiedsyncs)
     {
-        bool remove = getFlag(clflags, "d");
-        bool all = getFlag(clflags, "all");
+        ConfigurationManager::saveSyncs(&ConfigurationManager::configuredSyncs);
+    }
+    mtxSyncMap.unlock();
+    return;
+}
+#endif
 
-        if (words.size() == 1 && remove && !all)
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("ftp");
-            return;
-        }
+void MegaCmdExecuter::executeCancel(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+    api->cancelAccount(megaCmdListener);
+    megaCmdListener->wait();
+    if (checkNoErrors(megaCmdListener->getError(), "cancel account"))
+    {
+        OUTSTREAM << "Account pendind cancel confirmation. You will receive a confirmation link. Use \"confirmcancel\" with the provided link to confirm the cancelation" << endl;
+    }
+    delete megaCmdListener;
+}
+
+void MegaCmdExecuter::executeConfirmcancel(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (words.size() < 2)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("confirmcancel");
+        return;
+    }
+
+    const char * confirmlink = words[1].c_str();
+    if (words.size() > 2)
+    {
+        const char * pass = words[2].c_str();
+        confirmCancel(confirmlink, pass);
+    }
+    else if (interactiveThread())
+    {
+        link = confirmlink;
+        confirmingcancel = true;
+        setprompt(LOGINPASSWORD);
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "Extra args required in non-interactive mode. Usage: " << getUsageStr("confirmcancel");
+    }
+}
 
-        if (words.size() == 1 && !remove)
+void MegaCmdExecuter::executeLogin(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    LoginGuard loginGuard;
+    int clientID = getintOption(cloptions, "clientID", -1);
+
+    if (!api->isLoggedIn())
+    {
+        if (words.size() > 1)
         {
-            //List served nodes
-            MegaNodeList *ftpnodes = api->ftpServerGetAllowedNodes();
-            if (ftpnodes)
+            if (strchr(words[1].c_str(), '@'))
             {
-                bool found = false;
-
-                for (int a = 0; a < ftpnodes->size(); a++)
+                // full account login
+                if (words.size() > 2)
                 {
-                    MegaNode *n= ftpnodes->get(a);
-                    if (n)
+                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL,NULL,clientID);
+                    sandboxCMD->resetSandBox();
+                    api->login(words[1].c_str(), words[2].c_str(), megaCmdListener);
+                    if (actUponLogin(megaCmdListener) == MegaError::API_EMFAREQUIRED )
                     {
-                        char *link = api->ftpServerGetLocalLink(n); //notice this is not only consulting but also creating,
-                        //had it been deleted in the meantime this will recreate it
-                        if (link)
+                        MegaCmdListener *megaCmdListener2 = new MegaCmdListener(NULL,NULL,clientID);
+                        string pin2fa = getOption(cloptions, "auth-code", "");
+                        if (!pin2fa.size())
                         {
-                            if (!found)
-                            {
-                                OUTSTREAM << "FTP SERVED LOCATIONS:" << endl;
-                            }
-                            found = true;
-                            char * nodepath = api->getNodePath(n);
-                            OUTSTREAM << nodepath << ": " << link << endl;
-                            delete []nodepath;
-                            delete []link;
+                            pin2fa = askforUserResponse("Enter the code generated by your authentication app: ");
                         }
+                        LOG_verbose << " Using confirmation pin: " << pin2fa;
+                        api->multiFactorAuthLogin(words[1].c_str(), words[2].c_str(), pin2fa.c_str(), megaCmdListener2);
+                        actUponLogin(megaCmdListener2);
+                        delete megaCmdListener2;
+                        return;
+
                     }
+                    delete megaCmdListener;
                 }
-
-                if(!found)
+                else
+                {
+                    login = words[1];
+                    if (interactiveThread())
+                    {
+                        setprompt(LOGINPASSWORD);
+                    }
+                    else
+                    {
+                        setCurrentOutCode(MCMD_EARGS);
+                        LOG_err << "Extra args required in non-interactive mode. Usage: " << getUsageStr("login");
+                    }
+                }
+            }
+            else
+            {
+                const char* ptr;
+                if (( ptr = strchr(words[1].c_str(), '#')))  // folder link indicator
+                {
+                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                    sandboxCMD->resetSandBox();
+                    api->loginToFolder(words[1].c_str(), megaCmdListener);
+                    actUponLogin(megaCmdListener);
+                    delete megaCmdListener;
+                    return;
+                }
+                else
                 {
-                    OUTSTREAM << "No ftp links found" << endl;
+                    unsigned char session[64];
+
+                    if (words[1].size() < sizeof session * 4 / 3)
+                    {
+                        LOG_info << "Resuming session...";
+                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                        sandboxCMD->resetSandBox();
+                        api->fastLogin(words[1].c_str(), megaCmdListener);
+                        actUponLogin(megaCmdListener);
+                        delete megaCmdListener;
+                        return;
+                    }
                 }
+                setCurrentOutCode(MCMD_EARGS);
+                LOG_err << "Invalid argument. Please specify a valid e-mail address, "
+                          << "a folder link containing the folder key "
+                          << "or a valid session.";
+            }
+        }
+        else
+        {
+            setCurrentOutCode(MCMD_EARGS);
+            LOG_err << "      " << getUsageStr("login");
+        }
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_INVALIDSTATE);
+        LOG_err << "Already logged in. Please log out first.";
+    }
+
+    return;
+}
 
-                delete ftpnodes;
+void MegaCmdExecuter::executePsa(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    int psanum = sandboxCMD->lastPSAnumreceived;
 
-           }
-           else
-           {
-               OUTSTREAM << "Ftp server might not running. Add a new location to serve." << endl;
-           }
+#ifndef NDEBUG
+    if (words.size() >1)
+    {
+        psanum = toInteger(words[1], 0);
+    }
+#endif
+    bool discard = getFlag(clflags, "discard");
 
-           return;
+    if (discard)
+    {
+        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+        api->setPSA(psanum, megaCmdListener);
+        megaCmdListener->wait();
+        if (checkNoErrors(megaCmdListener->getError(), "set psa " + SSTR(psanum)))
+        {
+            OUTSTREAM << "PSA discarded" << endl;
         }
+        delete megaCmdListener;
+    }
 
-        if (!remove)
-        {
-            //create new link:
-            bool tls = getFlag(clflags, "tls");
-            int port = getintOption(cloptions, "port", 4990);
-            bool localonly = !getFlag(clflags, "public");
+    if (!checkAndInformPSA(NULL, true) && !discard) // even when discarded: we need to read the next
+    {
+        OUTSTREAM << "No PSA available" << endl;
+        setCurrentOutCode(MCMD_NOTFOUND);
+    }
+}
 
-            string dataPorts = getOption(cloptions, "data-ports");
-            size_t seppos = dataPorts.find("-");
-            int dataPortRangeBegin = 1500;
-            istringstream is(dataPorts.substr(0,seppos));
-            is >> dataPortRangeBegin;
-            int dataPortRangeEnd = dataPortRangeBegin + 100;
-            if (seppos != string::npos && seppos < (dataPorts.size()+1))
-            {
-                istringstream is(dataPorts.substr(seppos+1));
-                is >> dataPortRangeEnd;
-            }
+void MegaCmdExecuter::executeMount(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    listtrees();
+    return;
+}
+
+void MegaCmdExecuter::executeShare(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    string with = getOption(cloptions, "with", "");
+    if (getFlag(clflags, "a") && ( "" == with ))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << " Required --with=user";
+        LOG_err <<  "      " << getUsageStr("share");
+        return;
+    }
 
-            string pathtocert = getOption(cloptions, "certificate", "");
-            string pathtokey = getOption(cloptions, "key", "");
+    string slevel = getOption(cloptions, "level", "NONE");
 
-            if (tls && (!pathtocert.size() || !pathtokey.size()))
-            {
-                setCurrentOutCode(MCMD_EARGS);
-                LOG_err << "Path to certificate/key not indicated";
-                return;
-            }
+    int level_NOT_present_value = -214;
+    int level;
+    if (slevel == "NONE")
+    {
+        level = level_NOT_present_value;
+    }
+    else
+    {
+        level = getShareLevelNum(slevel.c_str());
+    }
+    if (( level != level_NOT_present_value ) && (( level < -1 ) || ( level > 3 )))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "Invalid level of access";
+        return;
+    }
+    bool listPending = getFlag(clflags, "p");
 
-            bool serverstarted = api->ftpServerIsRunning();
-            if (!serverstarted)
+    if (words.size() <= 1)
+    {
+        words.push_back(string(".")); //cwd
+    }
+    for (int i = 1; i < (int)words.size(); i++)
+    {
+        unescapeifRequired(words[i]);
+        if (isRegExp(words[i]))
+        {
+            vector<MegaNode *> *nodes = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
+            if (nodes)
             {
-                if (api->ftpServerStart(localonly, port, dataPortRangeBegin, dataPortRangeEnd, tls, pathtocert.c_str(), pathtokey.c_str()))
+                if (!nodes->size())
                 {
-                    ConfigurationManager::savePropertyValue("ftp_port", port);
-                    ConfigurationManager::savePropertyValue("ftp_port_data_begin", dataPortRangeBegin);
-                    ConfigurationManager::savePropertyValue("ftp_port_data_end", dataPortRangeEnd);
-                    ConfigurationManager::savePropertyValue("ftp_localonly", localonly);
-                    ConfigurationManager::savePropertyValue("ftp_tls", tls);
-                    if (pathtocert.size())
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    if (words[i].find("@") != string::npos)
                     {
-                        ConfigurationManager::savePropertyValue("ftp_cert", pathtocert);
+                        LOG_err << "Could not find " << words[i] << ". Use --with=" << words[i] << " to specify the user to share with";
                     }
-                    if (pathtokey.size())
+                    else
                     {
-                        ConfigurationManager::savePropertyValue("ftp_key", pathtokey);
+                        LOG_err << "Node not found: " << words[i];
                     }
-                    LOG_info << "Started ftp server at port " << port << ". Data Channel Port Range: " << dataPortRangeBegin << "-" << dataPortRangeEnd;
                 }
-                else
+                for (std::vector< MegaNode * >::iterator it = nodes->begin(); it != nodes->end(); ++it)
                 {
-                    setCurrentOutCode(MCMD_EARGS);
-                    LOG_err << "Failed to initialize FTP server. Ensure the port is free.";
-                    return;
-                }
-            }
-        }
+                    MegaNode * n = *it;
+                    if (n)
+                    {
+                        if (getFlag(clflags, "a"))
+                        {
+                            LOG_debug << " sharing ... " << n->getName() << " with " << with;
+                            if (level == level_NOT_present_value)
+                            {
+                                level = MegaShare::ACCESS_READ;
+                            }
 
-        //add/remove
-        if (remove && all)
-        {
-            api->ftpServerRemoveAllowedNodes();
-            api->ftpServerStop();
+                            if (n->getType() == MegaNode::TYPE_FILE)
+                            {
+                                setCurrentOutCode(MCMD_INVALIDTYPE);
+                                LOG_err << "Cannot share file: " << n->getName() << ". Only folders allowed. You can send file to user's inbox with cp (see \"cp --help\")";
+                            }
+                            else
+                            {
+                                shareNode(n, with, level);
+                            }
+                        }
+                        else if (getFlag(clflags, "d"))
+                        {
+                            if ("" != with)
+                            {
+                                LOG_debug << " deleting share ... " << n->getName() << " with " << with;
+                                disableShare(n, with);
+                            }
+                            else
+                            {
+                                MegaShareList* outShares = api->getOutShares(n);
+                                if (outShares)
+                                {
+                                    for (int i = 0; i < outShares->size(); i++)
+                                    {
+                                        if (outShares->get(i)->getNodeHandle() == n->getHandle())
+                                        {
+                                            LOG_debug << " deleting share ... " << n->getName() << " with " << outShares->get(i)->getUser();
+                                            disableShare(n, outShares->get(i)->getUser());
+                                        }
+                                    }
 
-            list<string> servedpaths;
-            ConfigurationManager::savePropertyValueList("ftp_served_locations", servedpaths);
-            ConfigurationManager::savePropertyValue("ftp_port", -1); //so as not to load server on startup
-            OUTSTREAM << "ftp server stopped: no path will be served." << endl;
-        }
-        else
-        {
-            bool firstone = true;
-            for (unsigned int i = 1; i < words.size(); i++)
-            {
-                string pathToServe = words[i];
-                if (remove)
-                {
-                    processPath(pathToServe, getFlag(clflags,"use-pcre"), firstone, forwarderRemoveFtpLocation, this);
-                }
-                else
-                {
-                    processPath(pathToServe, getFlag(clflags,"use-pcre"), firstone, forwarderAddFtpLocation, this);
+                                    delete outShares;
+                                }
+                            }
+                        }
+                        else
+                        {
+                            if (( level != level_NOT_present_value ) || ( with != "" ))
+                            {
+                                setCurrentOutCode(MCMD_EARGS);
+                                LOG_err << "Unexpected option received. To create/modify a share use -a";
+                            }
+                            else if (listPending)
+                            {
+                                dumpListOfPendingShares(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i]);
+                            }
+                            else
+                            {
+                                dumpListOfShared(n, words[i]);
+                            }
+                        }
+                        delete n;
+                    }
                 }
-            }
-        }
-    }
-#endif
-#ifdef ENABLE_SYNC
-    else if (words[0] == "exclude")
-    {
-        api->enableTransferResumption();
 
-        if (getFlag(clflags, "a"))
-        {
-            for (unsigned int i=1;i<words.size(); i++)
-            {
-                ConfigurationManager::addExcludedName(words[i]);
-            }
-            if (words.size()>1)
-            {
-                std::vector<string> vexcludednames(ConfigurationManager::excludedNames.begin(), ConfigurationManager::excludedNames.end());
-                api->setExcludedNames(&vexcludednames);
-                if (getFlag(clflags, "restart-syncs"))
-                {
-                    restartsyncs();
-                }
-            }
-            else
-            {
-                setCurrentOutCode(MCMD_EARGS);
-                LOG_err << "      " << getUsageStr("exclude");
-                return;
-            }
-        }
-        else if (getFlag(clflags, "d"))
-        {
-            for (unsigned int i=1;i<words.size(); i++)
-            {
-                ConfigurationManager::removeExcludedName(words[i]);
-            }
-            if (words.size()>1)
-            {
-                std::vector<string> vexcludednames(ConfigurationManager::excludedNames.begin(), ConfigurationManager::excludedNames.end());
-                api->setExcludedNames(&vexcludednames);
-                if (getFlag(clflags, "restart-syncs"))
-                {
-                    restartsyncs();
-                }
+                nodes->clear();
+                delete nodes;
             }
             else
             {
-                setCurrentOutCode(MCMD_EARGS);
-                LOG_err << "      " << getUsageStr("exclude");
-                return;
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Node not found: " << words[i];
             }
         }
-
-
-        OUTSTREAM << "List of excluded names:" << endl;
-
-        for (set<string>::iterator it=ConfigurationManager::excludedNames.begin(); it!=ConfigurationManager::excludedNames.end(); ++it)
-        {
-            OUTSTREAM << *it << endl;
-        }
-
-        if ( !getFlag(clflags, "restart-syncs") && (getFlag(clflags, "a") || getFlag(clflags, "d")) )
-        {
-            OUTSTREAM << endl <<  "Changes will not be applied immediately to operations being performed in active syncs."
-                      << " See \"exclude --help\" for further info" << endl;
-        }
-    }
-    else if (words[0] == "sync")
-    {
-        if (!api->isFilesystemAvailable())
-        {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
-        }
-        if (!api->isLoggedIn())
-        {
-            LOG_err << "Not logged in";
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            return;
-        }
-
-        int PATHSIZE = getintOption(cloptions,"path-display-size");
-        if (!PATHSIZE)
-        {
-            // get screen size for output purposes
-            unsigned int width = getNumberOfCols(75);
-            PATHSIZE = min(60,int((width-46)/2));
-        }
-        PATHSIZE = max(0, PATHSIZE);
-
-        bool headershown = false;
-        bool modifiedsyncs = false;
-        mtxSyncMap.lock();
-        if (words.size() == 3)
+        else // non-regexp
         {
-            LocalPath localRelativePath = LocalPath::fromPath(words[1], *fsAccessCMD);
-            LocalPath localAbsolutePath = localRelativePath;
-            fsAccessCMD->expanselocalpath(localRelativePath, localAbsolutePath);
-
-            MegaNode* n = nodebypath(words[2].c_str());
+            MegaNode *n = nodebypath(words[i].c_str());
             if (n)
             {
-                if (n->getType() == MegaNode::TYPE_FILE)
+                if (getFlag(clflags, "a"))
                 {
-                    LOG_err << words[2] << ": Remote sync root must be folder.";
+                    LOG_debug << " sharing ... " << n->getName() << " with " << with;
+                    if (level == level_NOT_present_value)
+                    {
+                        level = MegaShare::ACCESS_READ;
+                    }
+                    shareNode(n, with, level);
                 }
-                else if (api->getAccess(n) >= MegaShare::ACCESS_FULL)
+                else if (getFlag(clflags, "d"))
                 {
-                    std::lock_guard<std::recursive_mutex> g(ConfigurationManager::settingsMutex);
-
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->syncFolder(localAbsolutePath.toPath(*fsAccessCMD).c_str(), n, megaCmdListener);
-                    megaCmdListener->wait();
-                    if (checkNoErrors(megaCmdListener->getError(), "sync folder"))
+                    if ("" != with)
                     {
-                        sync_struct *thesync = new sync_struct;
-                        thesync->active = true;
-                        thesync->handle = megaCmdListener->getRequest()->getNodeHandle();
-                        thesync->localpath = string(megaCmdListener->getRequest()->getFile());
-                        thesync->fingerprint = megaCmdListener->getRequest()->getNumber();
-
-                        if (ConfigurationManager::configuredSyncs.find(megaCmdListener->getRequest()->getFile()) != ConfigurationManager::configuredSyncs.end())
+                        LOG_debug << " deleting share ... " << n->getName() << " with " << with;
+                        disableShare(n, with);
+                    }
+                    else
+                    {
+                        MegaShareList* outShares = api->getOutShares(n);
+                        if (outShares)
                         {
-                            delete ConfigurationManager::configuredSyncs[megaCmdListener->getRequest()->getFile()];
-                        }
-                        ConfigurationManager::configuredSyncs[megaCmdListener->getRequest()->getFile()] = thesync;
-
-                        char * nodepath = api->getNodePath(n);
-                        LOG_info << "Added sync: " << megaCmdListener->getRequest()->getFile() << " to " << nodepath;
+                            for (int i = 0; i < outShares->size(); i++)
+                            {
+                                if (outShares->get(i)->getNodeHandle() == n->getHandle())
+                                {
+                                    LOG_debug << " deleting share ... " << n->getName() << " with " << outShares->get(i)->getUser();
+                                    disableShare(n, outShares->get(i)->getUser());
+                                }
+                            }
 
-                        modifiedsyncs=true;
-                        delete []nodepath;
+                            delete outShares;
+                        }
                     }
-
-                    delete megaCmdListener;
                 }
                 else
                 {
-                    setCurrentOutCode(MCMD_NOTPERMITTED);
-                    LOG_err << words[2] << ": Syncing requires full access to path, current access: " << api->getAccess(n);
+                    if (( level != level_NOT_present_value ) || ( with != "" ))
+                    {
+                        setCurrentOutCode(MCMD_EARGS);
+                        LOG_err << "Unexpected option received. To create/modify a share use -a";
+                    }
+                    else if (listPending)
+                    {
+                        dumpListOfPendingShares(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i]);
+                    }
+                    else
+                    {
+                        dumpListOfShared(n, words[i]);
+                    }
                 }
                 delete n;
             }
             else
             {
                 setCurrentOutCode(MCMD_NOTFOUND);
-                LOG_err << "Couldn't find remote folder: " << words[2];
+                LOG_err << "Node not found: " << words[i];
             }
         }
-        else if (words.size() == 2)
+    }
+
+    return;
+}
+
+void MegaCmdExecuter::executeUsers(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    if (getFlag(clflags, "d") && ( words.size() <= 1 ))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "Contact to delete not specified";
+        return;
+    }
+    MegaUserList* usersList = api->getContacts();
+    if (usersList)
+    {
+        for (int i = 0; i < usersList->size(); i++)
         {
-            int id = toInteger(words[1].c_str());
-            map<string, sync_struct *>::iterator itr;
-            int i = 0;
-            bool foundsync = false;
-            std::lock_guard<std::recursive_mutex> g(ConfigurationManager::settingsMutex);
-            for (itr = ConfigurationManager::configuredSyncs.begin(); itr != ConfigurationManager::configuredSyncs.end(); i++)
-            {
-                string key = ( *itr ).first;
-                sync_struct *thesync = ((sync_struct*)( *itr ).second );
-                MegaNode * n = api->getNodeByHandle(thesync->handle);
-                bool erased = false;
+            MegaUser *user = usersList->get(i);
 
-                if (n)
+            if (getFlag(clflags, "d") && ( words.size() > 1 ) && ( words[1] == user->getEmail()))
+            {
+                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                api->removeContact(user, megaCmdListener);
+                megaCmdListener->wait();
+                if (checkNoErrors(megaCmdListener->getError(), "delete contact"))
                 {
-                    char * nodepath = api->getNodePath(n);
-                    ColumnDisplayer cd(getintOption(cloptions,"path-display-size", 0));
-
-                    if (( id == i ) || (( id == -1 ) && ( words[1] == thesync->localpath )))
+                    OUTSTREAM << "Contact " << words[1] << " removed succesfully" << endl;
+                }
+                delete megaCmdListener;
+            }
+            else
+            {
+                if (!(( user->getVisibility() != MegaUser::VISIBILITY_VISIBLE ) && !getFlag(clflags, "h")))
+                {
+                    if (getFlag(clflags,"n"))
                     {
-                        foundsync = true;
-                        long long nfiles = 0;
-                        long long nfolders = 0;
-                        nfolders++; //add the share itself
-                        getInfoFromFolder(n, api, &nfiles, &nfolders);
-
-                        if (getFlag(clflags, "s") || getFlag(clflags, "r"))
+                        string name;
+                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                        api->getUserAttribute(user, ATTR_FIRSTNAME, megaCmdListener);
+                        megaCmdListener->wait();
+                        if (megaCmdListener->getError()->getErrorCode() == MegaError::API_OK)
                         {
-                            bool stopping = getFlag(clflags, "s");
-                            LOG_info << (stopping?"Stopping (disabling) sync ":"Resuming sync ") << key << ": " << nodepath;
-                            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                            if (stopping)
-                            {
-                                api->disableSync(n, megaCmdListener);
-                            }
-                            else
-                            {
-                                api->syncFolder(thesync->localpath.c_str(), n, megaCmdListener);
-                            }
-
-                            megaCmdListener->wait();
-
-                            if (checkNoErrors(megaCmdListener->getError(), stopping?"stop sync":"resume sync"))
-                            {
-                                thesync->active = !stopping;
-                                thesync->loadedok = true;
-                                if (!stopping) //syncFolder
-                                {
-                                    if (megaCmdListener->getRequest()->getNumber())
-                                    {
-                                        thesync->fingerprint = megaCmdListener->getRequest()->getNumber();
-                                    }
-                                }
-                                modifiedsyncs=true;
-                            }
-                            else
+                            if (megaCmdListener->getRequest()->getText() && strlen(megaCmdListener->getRequest()->getText()))
                             {
-                                thesync->active = false;
-                                thesync->loadedok = false;
+                                name += megaCmdListener->getRequest()->getText();
                             }
-                            delete megaCmdListener;
                         }
-                        else if (getFlag(clflags, "d"))
+                        delete megaCmdListener;
+
+                        megaCmdListener = new MegaCmdListener(NULL);
+                        api->getUserAttribute(user, ATTR_LASTNAME, megaCmdListener);
+                        megaCmdListener->wait();
+                        if (megaCmdListener->getError()->getErrorCode() == MegaError::API_OK)
                         {
-                            LOG_debug << "Removing sync " << key << " to " << nodepath;
-                            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                            if (thesync->active)  //if not active, removeSync will fail.)
+                            if (megaCmdListener->getRequest()->getText() && strlen(megaCmdListener->getRequest()->getText()))
                             {
-                                api->removeSync(n, megaCmdListener);
-                                megaCmdListener->wait();
-                                if (checkNoErrors(megaCmdListener->getError(), "remove sync"))
+                                if (name.size())
                                 {
-                                    ConfigurationManager::configuredSyncs.erase(itr++); //TODO: should protect with mutex!
-                                    erased = true;
-                                    delete ( thesync );
-                                    OUTSTREAM << "Removed sync " << key << " to " << nodepath << endl;
-                                    modifiedsyncs=true;
+                                    name+=" ";
                                 }
+                                name+=megaCmdListener->getRequest()->getText();
                             }
-                            else //if !active simply remove
-                            {
-                                //TODO: if the sdk ever provides a way to clean cache, call it
-                                ConfigurationManager::configuredSyncs.erase(itr++);
-                                erased = true;
-                                delete ( thesync );
-                                OUTSTREAM << "Removed sync " << key << " to " << nodepath << endl;
-                                modifiedsyncs=true;
-                            }
-                            delete megaCmdListener;
                         }
-
-                        if (!headershown)
+                        if (name.size())
                         {
-                            headershown = true;
-                            printSyncHeader(PATHSIZE, &cd);
+                            OUTSTREAM << name << ": ";
                         }
 
-                        printSync(i, key, nodepath, thesync, n, nfiles, nfolders, PATHSIZE, &cd);
-
+                        delete megaCmdListener;
                     }
-                    delete n;
-                    delete []nodepath;
-                    OUTSTRINGSTREAM oss;
-                    cd.print(oss, getintOption(cloptions, "client-width", getNumberOfCols(75)));
-                    OUTSTREAM << oss.str();
-                }
-                else
-                {
-                    if (( id == i ) && getFlag(clflags, "d")) //simply remove: disabled (not found)
+
+
+                    OUTSTREAM << user->getEmail() << ", " << visibilityToString(user->getVisibility());
+                    if (user->getTimestamp())
                     {
-                        ConfigurationManager::configuredSyncs.erase(itr++);
-                        erased = true;
-                        delete ( thesync );
-                        OUTSTREAM << "Removed sync " << key << endl;
-                        modifiedsyncs = true;
+                        OUTSTREAM << " since " << getReadableTime(user->getTimestamp(), getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")));
                     }
-                    else
+                    OUTSTREAM << endl;
+
+                    if (getFlag(clflags, "s"))
                     {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        LOG_err << "Node not found for sync " << key << " into handle: " << thesync->handle;
+                        MegaShareList *shares = api->getOutShares();
+                        if (shares)
+                        {
+                            bool first_share = true;
+                            for (int j = 0; j < shares->size(); j++)
+                            {
+                                if (!strcmp(shares->get(j)->getUser(), user->getEmail()))
+                                {
+                                    MegaNode * n = api->getNodeByHandle(shares->get(j)->getNodeHandle());
+                                    if (n)
+                                    {
+                                        if (first_share)
+                                        {
+                                            OUTSTREAM << "\tSharing:" << endl;
+                                            first_share = false;
+                                        }
+
+                                        OUTSTREAM << "\t";
+                                        dumpNode(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, 2, false, 0, getDisplayPath("/", n).c_str());
+                                        delete n;
+                                    }
+                                }
+                            }
+
+                            delete shares;
+                        }
                     }
                 }
-                if (!erased)
-                {
-                    ++itr;
-                }
-            }
-            if (!foundsync && !modifiedsyncs)
-            {
-                setCurrentOutCode(MCMD_NOTFOUND);
-                LOG_err << "Sync not found: " << words[1] << ". Please provide full path or valid ID";
             }
         }
-        else if (words.size() == 1)
-        {
-            ColumnDisplayer cd(getintOption(cloptions,"path-display-size", 0));
-            map<string, sync_struct *>::const_iterator itr;
-            int i = 0;
-            for (itr = ConfigurationManager::configuredSyncs.begin(); itr != ConfigurationManager::configuredSyncs.end(); ++itr)
-            {
-                sync_struct *thesync = ((sync_struct*)( *itr ).second );
-                MegaNode * n = api->getNodeByHandle(thesync->handle);
-                if (!headershown)
-                {
-                    headershown = true;
-                    printSyncHeader(PATHSIZE, &cd);
-                }
-                if (n)
-                {
-                    long long nfiles = 0;
-                    long long nfolders = 0;
-                    nfolders++; //add the share itself
-                    getInfoFromFolder(n, api, &nfiles, &nfolders);
 
-                    char * nodepath = api->getNodePath(n);
-                    printSync(i++, ( *itr ).first, nodepath, thesync, n, nfiles, nfolders, PATHSIZE, &cd);
+        delete usersList;
+    }
 
-                    delete n;
-                    delete []nodepath;
-                }
-                else
-                {
-                    printSync(i++, ( *itr ).first, "NOT FOUND", thesync, n, -1, -1, PATHSIZE, &cd);
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                }
-            }
-            OUTSTRINGSTREAM oss;
-            cd.print(oss, getintOption(cloptions, "client-width", getNumberOfCols(75)));
-            OUTSTREAM << oss.str();
+    return;
+}
 
-        }
-        else
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("sync");
-            mtxSyncMap.unlock();
-            return;
-        }
-        if (modifiedsyncs)
-        {
-            ConfigurationManager::saveSyncs(&ConfigurationManager::configuredSyncs);
-        }
-        mtxSyncMap.unlock();
+void MegaCmdExecuter::executeMkdir(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
         return;
     }
-#endif
-    else if (words[0] == "cancel")
+    int globalstatus = MCMD_OK;
+    if (words.size()<2)
     {
-        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-        api->cancelAccount(megaCmdListener);
-        megaCmdListener->wait();
-        if (checkNoErrors(megaCmdListener->getError(), "cancel account"))
-        {
-            OUTSTREAM << "Account pendind cancel confirmation. You will receive a confirmation link. Use \"confirmcancel\" with the provided link to confirm the cancelation" << endl;
-        }
-        delete megaCmdListener;
+        globalstatus = MCMD_EARGS;
     }
-    else if (words[0] == "confirmcancel")
+    bool printusage = false;
+    bool recursive = getFlag(clflags, "p");
+    map<MegaHandle, vector<pair<string, string> > > pendingPerBase; // with -p: requested path and the part to create
+    for (unsigned int i = 1; i < words.size(); i++)
     {
-        if (words.size() < 2)
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("confirmcancel");
-            return;
-        }
+        unescapeifRequired(words[i]);
+        //git first existing node in the asked path:
+        MegaNode *baseNode;
 
-        const char * confirmlink = words[1].c_str();
-        if (words.size() > 2)
+        string rest = words[i];
+        if (rest.find("//bin/") == 0)
         {
-            const char * pass = words[2].c_str();
-            confirmCancel(confirmlink, pass);
-        }
-        else if (interactiveThread())
+            baseNode = api->getRubbishNode();
+            rest = rest.substr(6);
+        }//elseif //in/
+        else if(rest.find("/") == 0)
         {
-            link = confirmlink;
-            confirmingcancel = true;
-            setprompt(LOGINPASSWORD);
+            baseNode = api->getRootNode();
+            rest = rest.substr(1);
         }
         else
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "Extra args required in non-interactive mode. Usage: " << getUsageStr("confirmcancel");
+            baseNode = api->getNodeByHandle(cwd);
         }
-    }
-    else if (words[0] == "login")
-    {
-        LoginGuard loginGuard;
-        int clientID = getintOption(cloptions, "clientID", -1);
 
-        if (!api->isLoggedIn())
+        while (baseNode && rest.length())
         {
-            if (words.size() > 1)
+            size_t possep = rest.find_first_of("/");
+            if (possep == string::npos)
+            {
+                break;
+            }
+
+            string next = rest.substr(0, possep);
+            if (next == ".")
+            {
+                rest = rest.substr(possep + 1);
+                continue;
+            }
+            else if(next == "..")
             {
-                if (strchr(words[1].c_str(), '@'))
+                MegaNode *aux = baseNode;
+                baseNode = api->getNodeByHandle(baseNode->getParentHandle());
+
+                if (aux!=baseNode) // let's be paranoid
                 {
-                    // full account login
-                    if (words.size() > 2)
+                    delete aux;
+                }
+            }
+            else
+            {
+                MegaNodeList *children = api->getChildren(baseNode);
+                if (children)
+                {
+                    bool found = false;
+                    for (int i = 0; i < children->size(); i++)
                     {
-                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL,NULL,clientID);
-                        sandboxCMD->resetSandBox();
-                        api->login(words[1].c_str(), words[2].c_str(), megaCmdListener);
-                        if (actUponLogin(megaCmdListener) == MegaError::API_EMFAREQUIRED )
+                        MegaNode *child = children->get(i);
+                        if (next == child->getName())
                         {
-                            MegaCmdListener *megaCmdListener2 = new MegaCmdListener(NULL,NULL,clientID);
-                            string pin2fa = getOption(cloptions, "auth-code", "");
-                            if (!pin2fa.size())
+                            MegaNode *aux = baseNode;
+                            baseNode = child->copy();
+                            found = true;
+                            if (aux!=baseNode) // let's be paranoid
                             {
-                                pin2fa = askforUserResponse("Enter the code generated by your authentication app: ");
+                                delete aux;
                             }
-                            LOG_verbose << " Using confirmation pin: " << pin2fa;
-                            api->multiFactorAuthLogin(words[1].c_str(), words[2].c_str(), pin2fa.c_str(), megaCmdListener2);
-                            actUponLogin(megaCmdListener2);
-                            delete megaCmdListener2;
-                            return;
-
+                            break;
                         }
-                        delete megaCmdListener;
                     }
-                    else
+                    delete children;
+                    if (!found)
                     {
-                        login = words[1];
-                        if (interactiveThread())
-                        {
-                            setprompt(LOGINPASSWORD);
-                        }
-                        else
-                        {
-                            setCurrentOutCode(MCMD_EARGS);
-                            LOG_err << "Extra args required in non-interactive mode. Usage: " << getUsageStr("login");
-                        }
+                        break;
                     }
                 }
-                else
-                {
-                    const char* ptr;
-                    if (( ptr = strchr(words[1].c_str(), '#')))  // folder link indicator
-                    {
-                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                        sandboxCMD->resetSandBox();
-                        api->loginToFolder(words[1].c_str(), megaCmdListener);
-                        actUponLogin(megaCmdListener);
-                        delete megaCmdListener;
-                        return;
-                    }
-                    else
-                    {
-                        unsigned char session[64];
+            }
 
-                        if (words[1].size() < sizeof session * 4 / 3)
-                        {
-                            LOG_info << "Resuming session...";
-                            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                            sandboxCMD->resetSandBox();
-                            api->fastLogin(words[1].c_str(), megaCmdListener);
-                            actUponLogin(megaCmdListener);
-                            delete megaCmdListener;
-                            return;
-                        }
-                    }
-                    setCurrentOutCode(MCMD_EARGS);
-                    LOG_err << "Invalid argument. Please specify a valid e-mail address, "
-                              << "a folder link containing the folder key "
-                              << "or a valid session.";
-                }
+            rest = rest.substr(possep + 1);
+        }
+        if (baseNode && recursive)
+        {
+            pendingPerBase[baseNode->getHandle()].push_back(std::make_pair(words[i], rest));
+            delete baseNode;
+        }
+        else if (baseNode)
+        {
+            int status = makedir(rest,recursive,baseNode);
+            if (status != MCMD_OK)
+            {
+                globalstatus = status;
             }
-            else
+            if (status == MCMD_EARGS)
             {
-                setCurrentOutCode(MCMD_EARGS);
-                LOG_err << "      " << getUsageStr("login");
+                printusage = true;
             }
+            delete baseNode;
         }
         else
         {
             setCurrentOutCode(MCMD_INVALIDSTATE);
-            LOG_err << "Already logged in. Please log out first.";
+            LOG_err << "Folder navigation failed";
+            return;
         }
 
-        return;
     }
-    else if (words[0] == "psa")
-    {
-        int psanum = sandboxCMD->lastPSAnumreceived;
 
-#ifndef NDEBUG
-        if (words.size() >1)
+    // all the folders under the same base are created together, level by level
+    for (auto &pending : pendingPerBase)
+    {
+        std::unique_ptr<MegaNode> baseNode {api->getNodeByHandle(pending.first)};
+        vector<string> paths;
+        for (auto &request : pending.second)
         {
-            psanum = toInteger(words[1], 0);
+            paths.push_back(request.second);
+        }
+        set<string> created;
+        map<string, MegaHandle> handles;
+        if (baseNode)
+        {
+            handles = materializeFolders(baseNode.get(), paths, &created);
         }
-#endif
-        bool discard = getFlag(clflags, "discard");
 
-        if (discard)
+        for (auto &request : pending.second)
         {
-            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-            api->setPSA(psanum, megaCmdListener);
-            megaCmdListener->wait();
-            if (checkNoErrors(megaCmdListener->getError(), "set psa " + SSTR(psanum)))
+            string path = normalizeFolderPath(request.second);
+            if (path.empty())
             {
-                OUTSTREAM << "PSA discarded" << endl;
+                continue; // nothing to create
+            }
+            if (!baseNode || !handles.count(path))
+            {
+                globalstatus = MCMD_INVALIDSTATE; // the reason was already logged
+            }
+            else if (!created.count(path))
+            {
+                LOG_err << "Folder already exists: " << request.first;
+                globalstatus = MCMD_INVALIDSTATE;
             }
-            delete megaCmdListener;
         }
+    }
 
-        if (!checkAndInformPSA(NULL, true) && !discard) // even when discarded: we need to read the next
-        {
-            OUTSTREAM << "No PSA available" << endl;
-            setCurrentOutCode(MCMD_NOTFOUND);
-        }
+    setCurrentOutCode(globalstatus);
+    if (printusage)
+    {
+        LOG_err << "      " << getUsageStr("mkdir");
     }
-    else if (words[0] == "mount")
+
+    return;
+}
+
+void MegaCmdExecuter::executeAttr(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    MegaNode* n = NULL;
+    if (!api->isFilesystemAvailable())
     {
-        if (!api->isFilesystemAvailable())
-        {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
-        }
-        listtrees();
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
         return;
     }
-    else if (words[0] == "share")
+    if (words.size() > 1)
     {
-        if (!api->isFilesystemAvailable())
-        {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
-        }
-        string with = getOption(cloptions, "with", "");
-        if (getFlag(clflags, "a") && ( "" == with ))
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << " Required --with=user";
-            LOG_err <<  "      " << getUsageStr("share");
-            return;
-        }
-
-        string slevel = getOption(cloptions, "level", "NONE");
+        int cancel = getFlag(clflags, "d");
+        bool settingattr = getFlag(clflags, "s");
 
-        int level_NOT_present_value = -214;
-        int level;
-        if (slevel == "NONE")
-        {
-            level = level_NOT_present_value;
-        }
-        else
-        {
-            level = getShareLevelNum(slevel.c_str());
-        }
-        if (( level != level_NOT_present_value ) && (( level < -1 ) || ( level > 3 )))
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "Invalid level of access";
-            return;
-        }
-        bool listPending = getFlag(clflags, "p");
+        string nodePath = words.size() > 1 ? words[1] : "";
+        string attribute = words.size() > 2 ? words[2] : "";
+        string attrValue = words.size() > 3 ? words[3] : "";
+        n = nodebypath(nodePath.c_str());
 
-        if (words.size() <= 1)
-        {
-            words.push_back(string(".")); //cwd
-        }
-        for (int i = 1; i < (int)words.size(); i++)
+        if (n)
         {
-            unescapeifRequired(words[i]);
-            if (isRegExp(words[i]))
+            if (settingattr || cancel)
             {
-                vector<MegaNode *> *nodes = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
-                if (nodes)
+                if (attribute.size())
                 {
-                    if (!nodes->size())
-                    {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        if (words[i].find("@") != string::npos)
-                        {
-                            LOG_err << "Could not find " << words[i] << ". Use --with=" << words[i] << " to specify the user to share with";
-                        }
-                        else
-                        {
-                            LOG_err << "Node not found: " << words[i];
-                        }
-                    }
-                    for (std::vector< MegaNode * >::iterator it = nodes->begin(); it != nodes->end(); ++it)
+                    const char *cattrValue = cancel ? NULL : attrValue.c_str();
+                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                    api->setCustomNodeAttribute(n, attribute.c_str(), cattrValue, megaCmdListener);
+                    megaCmdListener->wait();
+                    if (checkNoErrors(megaCmdListener->getError(), "set node attribute: " + attribute))
                     {
-                        MegaNode * n = *it;
-                        if (n)
-                        {
-                            if (getFlag(clflags, "a"))
-                            {
-                                LOG_debug << " sharing ... " << n->getName() << " with " << with;
-                                if (level == level_NOT_present_value)
-                                {
-                                    level = MegaShare::ACCESS_READ;
-                                }
-
-                                if (n->getType() == MegaNode::TYPE_FILE)
-                                {
-                                    setCurrentOutCode(MCMD_INVALIDTYPE);
-                                    LOG_err << "Cannot share file: " << n->getName() << ". Only folders allowed. You can send file to user's inbox with cp (see \"cp --help\")";
-                                }
-                                else
-                                {
-                                    shareNode(n, with, level);
-                                }
-                            }
-                            else if (getFlag(clflags, "d"))
-                            {
-                                if ("" != with)
-                                {
-                                    LOG_debug << " deleting share ... " << n->getName() << " with " << with;
-                                    disableShare(n, with);
-                                }
-                                else
-                                {
-                                    MegaShareList* outShares = api->getOutShares(n);
-                                    if (outShares)
-                                    {
-                                        for (int i = 0; i < outShares->size(); i++)
-                                        {
-                                            if (outShares->get(i)->getNodeHandle() == n->getHandle())
-                                            {
-                                                LOG_debug << " deleting share ... " << n->getName() << " with " << outShares->get(i)->getUser();
-                                                disableShare(n, outShares->get(i)->getUser());
-                                            }
-                                        }
-
-                                        delete outShares;
-                                    }
-                                }
-                            }
-                            else
-                            {
-                                if (( level != level_NOT_present_value ) || ( with != "" ))
-                                {
-                                    setCurrentOutCode(MCMD_EARGS);
-                                    LOG_err << "Unexpected option received. To create/modify a share use -a";
-                                }
-                                else if (listPending)
-                                {
-                                    dumpListOfPendingShares(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i]);
-                                }
-                                else
-                                {
-                                    dumpListOfShared(n, words[i]);
-                                }
-                            }
-                            delete n;
-                        }
+                        OUTSTREAM << "Node attribute " << attribute << ( cancel ? " removed" : " updated" ) << " correctly" << endl;
+                        delete n;
+                        n = api->getNodeByHandle(megaCmdListener->getRequest()->getNodeHandle());
                     }
-
-                    nodes->clear();
-                    delete nodes;
+                    delete megaCmdListener;
                 }
                 else
                 {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << "Node not found: " << words[i];
+                    setCurrentOutCode(MCMD_EARGS);
+                    LOG_err << "Attribute not specified";
+                    LOG_err << "      " << getUsageStr("attr");
+                    return;
                 }
             }
-            else // non-regexp
+
+            //List node custom attributes
+            MegaStringList *attrlist = n->getCustomAttrNames();
+            if (attrlist)
             {
-                MegaNode *n = nodebypath(words[i].c_str());
-                if (n)
+                if (!attribute.size())
                 {
-                    if (getFlag(clflags, "a"))
-                    {
-                        LOG_debug << " sharing ... " << n->getName() << " with " << with;
-                        if (level == level_NOT_present_value)
-                        {
-                            level = MegaShare::ACCESS_READ;
-                        }
-                        shareNode(n, with, level);
-                    }
-                    else if (getFlag(clflags, "d"))
-                    {
-                        if ("" != with)
-                        {
-                            LOG_debug << " deleting share ... " << n->getName() << " with " << with;
-                            disableShare(n, with);
-                        }
-                        else
-                        {
-                            MegaShareList* outShares = api->getOutShares(n);
-                            if (outShares)
-                            {
-                                for (int i = 0; i < outShares->size(); i++)
-                                {
-                                    if (outShares->get(i)->getNodeHandle() == n->getHandle())
-                                    {
-                                        LOG_debug << " deleting share ... " << n->getName() << " with " << outShares->get(i)->getUser();
-                                        disableShare(n, outShares->get(i)->getUser());
-                                    }
-                                }
-
-                                delete outShares;
-                            }
-                        }
-                    }
-                    else
-                    {
-                        if (( level != level_NOT_present_value ) || ( with != "" ))
-                        {
-                            setCurrentOutCode(MCMD_EARGS);
-                            LOG_err << "Unexpected option received. To create/modify a share use -a";
-                        }
-                        else if (listPending)
-                        {
-                            dumpListOfPendingShares(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i]);
-                        }
-                        else
-                        {
-                            dumpListOfShared(n, words[i]);
-                        }
-                    }
-                    delete n;
+                    OUTSTREAM << "The node has " << attrlist->size() << " attributes" << endl;
                 }
-                else
+                for (int a = 0; a < attrlist->size(); a++)
                 {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << "Node not found: " << words[i];
+                    string iattr = attrlist->get(a);
+                    if (!attribute.size() || ( attribute == iattr ))
+                    {
+                        const char* iattrval = n->getCustomAttr(iattr.c_str());
+                        OUTSTREAM << "\t" << iattr << " = " << ( iattrval ? iattrval : "NULL" ) << endl;
+                    }
                 }
+
+                delete attrlist;
             }
+
+            delete n;
+        }
+        else
+        {
+            setCurrentOutCode(MCMD_NOTFOUND);
+            LOG_err << "Couldn't find node: " << nodePath;
+            return;
         }
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("attr");
+        return;
+    }
+
+
+    return;
+}
 
+void MegaCmdExecuter::executeUserattr(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
         return;
     }
-    else if (words[0] == "users")
+    bool settingattr = getFlag(clflags, "s");
+    bool listattrs = getFlag(clflags, "list");
+    bool listall = words.size() == 1;
+
+    int attribute = api->userAttributeFromString(words.size() > 1 ? words[1].c_str() : "-1");
+    string attrValue = words.size() > 2 ? words[2] : "";
+    string user = getOption(cloptions, "user", "");
+    if (settingattr && user.size())
     {
-        if (!api->isFilesystemAvailable())
+        LOG_err << "Can't change other user attributes";
+        return;
+    }
+
+
+    if (settingattr)
+    {
+        if (attribute != -1)
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            const char *catrn = api->userAttributeToString(attribute);
+            string attrname = catrn;
+            delete [] catrn;
+
+            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+            api->setUserAttribute(attribute, attrValue.c_str(), megaCmdListener);
+            megaCmdListener->wait();
+            if (checkNoErrors(megaCmdListener->getError(), string("set user attribute ") + attrname))
+            {
+                OUTSTREAM << "User attribute " << attrname << " updated correctly" << endl;
+                printUserAttribute(attribute, user, listattrs);
+            }
+            delete megaCmdListener;
         }
-        if (getFlag(clflags, "d") && ( words.size() <= 1 ))
+        else
         {
             setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "Contact to delete not specified";
+            LOG_err << "Attribute not specified";
+            LOG_err << "      " << getUsageStr("userattr");
             return;
         }
-        MegaUserList* usersList = api->getContacts();
-        if (usersList)
+    }
+    else // list
+    {
+        if (listall)
         {
-            for (int i = 0; i < usersList->size(); i++)
+            int a = 0;
+            bool found = false;
+            do
             {
-                MegaUser *user = usersList->get(i);
-
-                if (getFlag(clflags, "d") && ( words.size() > 1 ) && ( words[1] == user->getEmail()))
-                {
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->removeContact(user, megaCmdListener);
-                    megaCmdListener->wait();
-                    if (checkNoErrors(megaCmdListener->getError(), "delete contact"))
-                    {
-                        OUTSTREAM << "Contact " << words[1] << " removed succesfully" << endl;
-                    }
-                    delete megaCmdListener;
-                }
-                else
-                {
-                    if (!(( user->getVisibility() != MegaUser::VISIBILITY_VISIBLE ) && !getFlag(clflags, "h")))
-                    {
-                        if (getFlag(clflags,"n"))
-                        {
-                            string name;
-                            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                            api->getUserAttribute(user, ATTR_FIRSTNAME, megaCmdListener);
-                            megaCmdListener->wait();
-                            if (megaCmdListener->getError()->getErrorCode() == MegaError::API_OK)
-                            {
-                                if (megaCmdListener->getRequest()->getText() && strlen(megaCmdListener->getRequest()->getText()))
-                                {
-                                    name += megaCmdListener->getRequest()->getText();
-                                }
-                            }
-                            delete megaCmdListener;
-
-                            megaCmdListener = new MegaCmdListener(NULL);
-                            api->getUserAttribute(user, ATTR_LASTNAME, megaCmdListener);
-                            megaCmdListener->wait();
-                            if (megaCmdListener->getError()->getErrorCode() == MegaError::API_OK)
-                            {
-                                if (megaCmdListener->getRequest()->getText() && strlen(megaCmdListener->getRequest()->getText()))
-                                {
-                                    if (name.size())
-                                    {
-                                        name+=" ";
-                                    }
-                                    name+=megaCmdListener->getRequest()->getText();
-                                }
-                            }
-                            if (name.size())
-                            {
-                                OUTSTREAM << name << ": ";
-                            }
+                found = printUserAttribute(a, user, listattrs);
+                a++;
+            } while (found && listall);
+        }
+        else
+        {
+            if (!printUserAttribute(attribute, user, listattrs))
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Attribute not found: " << words[1];
+            }
+        }
+    }
 
-                            delete megaCmdListener;
-                        }
+    return;
+}
 
+void MegaCmdExecuter::executeThumbnail(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    transferNodeImages(false, words, clflags, cloptions);
+}
 
-                        OUTSTREAM << user->getEmail() << ", " << visibilityToString(user->getVisibility());
-                        if (user->getTimestamp())
-                        {
-                            OUTSTREAM << " since " << getReadableTime(user->getTimestamp(), getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")));
-                        }
-                        OUTSTREAM << endl;
+void MegaCmdExecuter::executePreview(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    transferNodeImages(true, words, clflags, cloptions);
+}
 
-                        if (getFlag(clflags, "s"))
-                        {
-                            MegaShareList *shares = api->getOutShares();
-                            if (shares)
-                            {
-                                bool first_share = true;
-                                for (int j = 0; j < shares->size(); j++)
-                                {
-                                    if (!strcmp(shares->get(j)->getUser(), user->getEmail()))
-                                    {
-                                        MegaNode * n = api->getNodeByHandle(shares->get(j)->getNodeHandle());
-                                        if (n)
-                                        {
-                                            if (first_share)
-                                            {
-                                                OUTSTREAM << "\tSharing:" << endl;
-                                                first_share = false;
-                                            }
-
-                                            OUTSTREAM << "\t";
-                                            dumpNode(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, 2, false, 0, getDisplayPath("/", n).c_str());
-                                            delete n;
-                                        }
-                                    }
-                                }
+/**
+ * @brief Downloads (or uploads, with -s) the thumbnails/previews of the files given by remotepath.
+ *
+ * remotepath may be a pattern or, with -r, a folder whose files are processed recursively. In those cases
+ * localpath is a folder, where images are named after the remote paths (relative to the folder containing
+ * what was given) or after the handles of the files (--layout=handle).
+ * Up to "thumbnail_window" requests are kept in flight, and failures are reported per file.
+ */
+void MegaCmdExecuter::transferNodeImages(bool preview, vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    const char *command = preview ? "preview" : "thumbnail";
+    if (words.size() < 2 || words.size() > 3)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr(command);
+        return;
+    }
 
-                                delete shares;
-                            }
-                        }
-                    }
-                }
-            }
+    bool setting = getFlag(clflags, "s");
+    bool recursive = getFlag(clflags, "r");
+    bool skipExisting = getFlag(clflags, "skip-existing");
+    string layout = getOption(cloptions, "layout", "path");
+    if (layout != "path" && layout != "handle")
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "Invalid layout: " << layout << ". Use \"path\" or \"handle\"";
+        return;
+    }
+    string nodepath = words[1];
+    string path = words.size() > 2 ? words[2] : "./";
+    string imageName = preview ? "Preview" : "Thumbnail";
 
-            delete usersList;
+    vector<MegaNode *> targets;
+    bool pattern = isRegExp(nodepath);
+    if (pattern)
+    {
+        std::unique_ptr<vector<MegaNode *> > nodes {nodesbypath(nodepath.c_str(), getFlag(clflags, "use-pcre"))};
+        targets = *nodes;
+    }
+    else
+    {
+        MegaNode *n = nodebypath(nodepath.c_str());
+        if (n)
+        {
+            targets.push_back(n);
         }
-
+    }
+    if (targets.empty())
+    {
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << nodepath << ": No such file or directory";
         return;
     }
-    else if (words[0] == "mkdir")
+
+    struct ImageItem
     {
-        if (!api->isFilesystemAvailable())
+        MegaHandle handle;
+        string remotePath; // as displayed
+        string localPath;
+    };
+    vector<ImageItem> items;
+    int skipped = 0;
+    int failed = 0;
+
+    bool batch = pattern || recursive || targets.size() > 1 || targets[0]->getType() != MegaNode::TYPE_FILE;
+    if (!batch)
+    {
+        items.push_back(ImageItem{targets[0]->getHandle(), nodepath, path});
+        delete targets[0];
+    }
+    else
+    {
+        bool validFolder = IsFolder(path);
+#ifdef MEGACMDEXECUTER_FILESYSTEM
+        if (!validFolder && !setting)
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            std::error_code ec;
+            validFolder = fs::create_directories(fs::u8path(path), ec);
         }
-        int globalstatus = MCMD_OK;
-        if (words.size()<2)
+#endif
+        if (!validFolder)
         {
-            globalstatus = MCMD_EARGS;
+            setCurrentOutCode(MCMD_INVALIDTYPE);
+            LOG_err << path << (setting ? " is not a folder: images of several files are taken from a folder"
+                                        : " is not a folder: images of several files are saved into a folder");
+            for (auto t : targets)
+            {
+                delete t;
+            }
+            return;
         }
-        bool printusage = false;
-        for (unsigned int i = 1; i < words.size(); i++)
+        string folder = path;
+        if (folder.back() != '/' && folder.back() != '\\')
         {
-            unescapeifRequired(words[i]);
-            //git first existing node in the asked path:
-            MegaNode *baseNode;
+            folder += "/";
+        }
 
-            string rest = words[i];
-            if (rest.find("//bin/") == 0)
-            {
-                baseNode = api->getRubbishNode();
-                rest = rest.substr(6);
-            }//elseif //in/
-            else if(rest.find("/") == 0)
+        // the matches of a pattern keep their paths relative to the folder the pattern starts at,
+        // not to collide when named alike (e.g: "dir*/a.jpg")
+        string base;
+        if (pattern && layout == "path")
+        {
+            string prefix;
+            for (size_t start = 0, end; (end = nodepath.find('/', start)) != string::npos; start = end + 1)
             {
-                baseNode = api->getRootNode();
-                rest = rest.substr(1);
+                if (isRegExp(nodepath.substr(start, end - start)))
+                {
+                    break;
+                }
+                prefix = end ? nodepath.substr(0, end) : "/";
             }
-            else
+            std::unique_ptr<MegaNode> baseNode {prefix.size() ? nodebypath(prefix.c_str()) : api->getNodeByHandle(cwd)};
+            if (baseNode)
             {
-                baseNode = api->getNodeByHandle(cwd);
+                base = sandboxCMD->nodePathCache.getNodePath(api, baseNode.get());
+                if (base.size() && base.back() != '/')
+                {
+                    base += "/";
+                }
             }
+        }
 
-            while (baseNode && rest.length())
+        // files under the targets, with their paths relative to the folders containing the targets
+        std::deque<pair<MegaNode *, string> > pending;
+        for (auto t : targets)
+        {
+            string relativePath = t->getName() ? t->getName() : "";
+            string fullPath = base.size() ? sandboxCMD->nodePathCache.getNodePath(api, t) : "";
+            if (base.size() && fullPath.size() > base.size() && !fullPath.compare(0, base.size(), base))
             {
-                size_t possep = rest.find_first_of("/");
-                if (possep == string::npos)
-                {
-                    break;
-                }
+                relativePath = fullPath.substr(base.size());
+            }
+            pending.push_back(std::make_pair(t, relativePath));
+        }
+        set<string> localPaths;
+        while (!pending.empty())
+        {
+            std::unique_ptr<MegaNode> n {pending.front().first};
+            string relativePath = pending.front().second;
+            pending.pop_front();
 
-                string next = rest.substr(0, possep);
-                if (next == ".")
+            if (n->getType() != MegaNode::TYPE_FILE)
+            {
+                if (!recursive)
                 {
-                    rest = rest.substr(possep + 1);
+                    LOG_err << relativePath << " is a folder. Use -r to process the files within";
+                    skipped++;
                     continue;
                 }
-                else if(next == "..")
-                {
-                    MegaNode *aux = baseNode;
-                    baseNode = api->getNodeByHandle(baseNode->getParentHandle());
-
-                    if (aux!=baseNode) // let's be paranoid
-                    {
-                        delete aux;
-                    }
-                }
-                else
+                std::unique_ptr<MegaNodeList> children {api->getChildren(n.get())};
+                for (int i = 0; children && i < children->size(); i++)
                 {
-                    MegaNodeList *children = api->getChildren(baseNode);
-                    if (children)
-                    {
-                        bool found = false;
-                        for (int i = 0; i < children->size(); i++)
-                        {
-                            MegaNode *child = children->get(i);
-                            if (next == child->getName())
-                            {
-                                MegaNode *aux = baseNode;
-                                baseNode = child->copy();
-                                found = true;
-                                if (aux!=baseNode) // let's be paranoid
-                                {
-                                    delete aux;
-                                }
-                                break;
-                            }
-                        }
-                        delete children;
-                        if (!found)
-                        {
-                            break;
-                        }
-                    }
+                    MegaNode *child = children->get(i);
+                    pending.push_back(std::make_pair(child->copy(), relativePath + "/" + child->getName()));
                 }
+                continue;
+            }
 
-                rest = rest.substr(possep + 1);
+            if (!setting && !(preview ? n->hasPreview() : n->hasThumbnail()))
+            {
+                LOG_verbose << relativePath << " has no " << command;
+                skipped++;
+                continue;
             }
-            if (baseNode)
+
+            string localPath = folder;
+            if (layout == "handle")
             {
-                int status = makedir(rest,getFlag(clflags, "p"),baseNode);
-                if (status != MCMD_OK)
-                {
-                    globalstatus = status;
-                }
-                if (status == MCMD_EARGS)
-                {
-                    printusage = true;
-                }
-                delete baseNode;
+                std::unique_ptr<char[]> handle {n->getBase64Handle()};
+                localPath += handle.get();
             }
             else
             {
-                setCurrentOutCode(MCMD_INVALIDSTATE);
-                LOG_err << "Folder navigation failed";
-                return;
+                localPath += relativePath;
+            }
+            localPath += ".jpg";
+#ifdef _WIN32
+            replaceAll(localPath, "/", "\\");
+#endif
+            string remotePath = relativePath;
+            if (!pattern) // as given, followed by the path within
+            {
+                size_t firstSeparator = relativePath.find('/');
+                remotePath = nodepath + (firstSeparator == string::npos ? "" : relativePath.substr(firstSeparator));
+            }
+            if (!setting && !localPaths.insert(localPath).second)
+            {
+                LOG_err << "Failed to get " << command << " for " << remotePath << ": " << localPath
+                        << " is already used for another file. Use --layout=handle";
+                failed++;
+                continue;
+            }
+            items.push_back(ImageItem{n->getHandle(), remotePath, localPath});
+        }
+    }
+
+    int done = 0;
+    set<string> createdFolders;
+    size_t window = size_t(std::max(1, ConfigurationManager::getConfigurationValue("thumbnail_window", 16)));
+    std::deque<pair<const ImageItem *, std::unique_ptr<MegaCmdListener> > > inflight;
+
+    auto waitOldest = [&]()
+    {
+        const ImageItem *item = inflight.front().first;
+        MegaCmdListener *megaCmdListener = inflight.front().second.get();
+        megaCmdListener->wait();
+        if (megaCmdListener->getError()->getErrorCode() == MegaError::API_OK)
+        {
+            OUTSTREAM << imageName << " for " << item->remotePath << ( setting ? " loaded from " : " saved in " ) << megaCmdListener->getRequest()->getFile() << endl;
+            done++;
+        }
+        else
+        {
+            LOG_err << "Failed to " << (setting ? "set " : "get ") << command << " for " << item->remotePath << ": " << megaCmdListener->getError()->getErrorString();
+            failed++;
+        }
+        inflight.pop_front();
+    };
+
+    for (auto &item : items)
+    {
+        std::unique_ptr<MegaNode> n {api->getNodeByHandle(item.handle)};
+        if (!n)
+        {
+            LOG_err << item.remotePath << ": No longer exists";
+            failed++;
+            continue;
+        }
+
+        if (skipExisting && (setting ? (preview ? n->hasPreview() : n->hasThumbnail()) : localFileExists(fsAccessCMD, item.localPath)))
+        {
+            LOG_verbose << "Skipping " << command << " for " << item.remotePath << ": already present";
+            skipped++;
+            continue;
+        }
+        if (setting && batch && !localFileExists(fsAccessCMD, item.localPath))
+        {
+            LOG_err << "Failed to set " << command << " for " << item.remotePath << ": " << item.localPath << " not found";
+            failed++;
+            continue;
+        }
+#ifdef MEGACMDEXECUTER_FILESYSTEM
+        if (!setting && batch && layout == "path")
+        {
+            string parent = fs::u8path(item.localPath).parent_path().u8string();
+            if (createdFolders.insert(parent).second)
+            {
+                std::error_code ec;
+                fs::create_directories(fs::u8path(parent), ec);
             }
-
         }
+#endif
 
-        setCurrentOutCode(globalstatus);
-        if (printusage)
+        if (inflight.size() >= window)
+        {
+            waitOldest();
+        }
+        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+        if (setting && preview)
         {
-            LOG_err << "      " << getUsageStr("mkdir");
+            api->setPreview(n.get(), item.localPath.c_str(), megaCmdListener);
         }
+        else if (setting)
+        {
+            api->setThumbnail(n.get(), item.localPath.c_str(), megaCmdListener);
+        }
+        else if (preview)
+        {
+            api->getPreview(n.get(), item.localPath.c_str(), megaCmdListener);
+        }
+        else
+        {
+            api->getThumbnail(n.get(), item.localPath.c_str(), megaCmdListener);
+        }
+        inflight.push_back(std::make_pair(&item, std::unique_ptr<MegaCmdListener>(megaCmdListener)));
+    }
+    while (!inflight.empty())
+    {
+        waitOldest();
+    }
 
-        return;
+    if (batch)
+    {
+        OUTSTREAM << done << " " << command << "s " << (setting ? "set" : "saved") << ", " << skipped << " skipped, " << failed << " failed" << endl;
     }
-    else if (words[0] == "attr")
+    if (failed)
     {
-        if (!api->isFilesystemAvailable())
+        setCurrentOutCode(MCMD_EUNEXPECTED);
+    }
+}
+
+void MegaCmdExecuter::executeTree(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    vector<string> newcom;
+    newcom.push_back("ls");
+    (*clflags)["tree"] = 1;
+    if (words.size()>1)
+    {
+        for (vector<string>::iterator it = ++words.begin(); it != words.end();it++)
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            newcom.push_back(*it);
         }
-        if (words.size() > 1)
-        {
-            int cancel = getFlag(clflags, "d");
-            bool settingattr = getFlag(clflags, "s");
+    }
 
-            string nodePath = words.size() > 1 ? words[1] : "";
-            string attribute = words.size() > 2 ? words[2] : "";
-            string attrValue = words.size() > 3 ? words[3] : "";
-            n = nodebypath(nodePath.c_str());
+    return executecommand(newcom, clflags, cloptions);
+}
 
-            if (n)
-            {
-                if (settingattr || cancel)
-                {
-                    if (attribute.size())
-                    {
-                        const char *cattrValue = cancel ? NULL : attrValue.c_str();
-                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                        api->setCustomNodeAttribute(n, attribute.c_str(), cattrValue, megaCmdListener);
-                        megaCmdListener->wait();
-                        if (checkNoErrors(megaCmdListener->getError(), "set node attribute: " + attribute))
-                        {
-                            OUTSTREAM << "Node attribute " << attribute << ( cancel ? " removed" : " updated" ) << " correctly" << endl;
-                            delete n;
-                            n = api->getNodeByHandle(megaCmdListener->getRequest()->getNodeHandle());
-                        }
-                        delete megaCmdListener;
-                    }
-                    else
-                    {
-                        setCurrentOutCode(MCMD_EARGS);
-                        LOG_err << "Attribute not specified";
-                        LOG_err << "      " << getUsageStr("attr");
-                        return;
-                    }
-                }
+void MegaCmdExecuter::executeDebug(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    vector<string> newcom;
+    newcom.push_back("log");
+    newcom.push_back("5");
 
-                //List node custom attributes
-                MegaStringList *attrlist = n->getCustomAttrNames();
-                if (attrlist)
-                {
-                    if (!attribute.size())
-                    {
-                        OUTSTREAM << "The node has " << attrlist->size() << " attributes" << endl;
-                    }
-                    for (int a = 0; a < attrlist->size(); a++)
-                    {
-                        string iattr = attrlist->get(a);
-                        if (!attribute.size() || ( attribute == iattr ))
-                        {
-                            const char* iattrval = n->getCustomAttr(iattr.c_str());
-                            OUTSTREAM << "\t" << iattr << " = " << ( iattrval ? iattrval : "NULL" ) << endl;
-                        }
-                    }
+    return executecommand(newcom, clflags, cloptions);
+}
 
-                    delete attrlist;
-                }
+void MegaCmdExecuter::executePasswd(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    string confirmationQuery("Changing password will close all your sessions. Are you sure?(Yes/No): ");
+    bool force = getFlag(clflags, "f");
+    int confirmationResponse = force?MCMDCONFIRM_ALL:askforConfirmation(confirmationQuery);
+    if (confirmationResponse != MCMDCONFIRM_YES && confirmationResponse != MCMDCONFIRM_ALL)
+    {
+        return;
+    }
 
-                delete n;
+    if (api->isLoggedIn())
+    {
+        if (words.size() == 1)
+        {
+            if (interactiveThread())
+            {
+                setprompt(NEWPASSWORD);
             }
             else
             {
-                setCurrentOutCode(MCMD_NOTFOUND);
-                LOG_err << "Couldn't find node: " << nodePath;
-                return;
+                setCurrentOutCode(MCMD_EARGS);
+                LOG_err << "Extra args required in non-interactive mode. Usage: " << getUsageStr("passwd");
             }
         }
+        else if (words.size() == 2)
+        {
+            string pin2fa = getOption(cloptions, "auth-code", "");
+            changePassword(words[1].c_str(), pin2fa);
+        }
         else
         {
             setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("attr");
-            return;
+            LOG_err << "      " << getUsageStr("passwd");
         }
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+    }
 
+    return;
+}
 
+void MegaCmdExecuter::executeSpeedlimit(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (words.size() > 2)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("speedlimit");
         return;
     }
-    else if (words[0] == "userattr")
+
+    string schedule = getOption(cloptions, "schedule", "");
+    if (schedule.size())
     {
-        if (!api->isFilesystemAvailable())
+        vector<BandwidthScheduler::Window> windows;
+        if (schedule == "none")
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            schedule = "";
         }
-        bool settingattr = getFlag(clflags, "s");
-        bool listattrs = getFlag(clflags, "list");
-        bool listall = words.size() == 1;
-
-        int attribute = api->userAttributeFromString(words.size() > 1 ? words[1].c_str() : "-1");
-        string attrValue = words.size() > 2 ? words[2] : "";
-        string user = getOption(cloptions, "user", "");
-        if (settingattr && user.size())
+        else if (!BandwidthScheduler::parseSchedule(schedule, windows))
         {
-            LOG_err << "Can't change other user attributes";
+            setCurrentOutCode(MCMD_EARGS);
+            LOG_err << "Invalid schedule: " << schedule << ". Expected HH:MM-HH:MM=LIMIT[/UPLIMIT],...";
             return;
         }
+        ConfigurationManager::savePropertyValue("speedlimit_schedule", schedule);
+    }
 
-
-        if (settingattr)
+    if (words.size() > 1)
+    {
+        long long maxspeed = textToSize(words[1].c_str());
+        if (maxspeed == -1)
         {
-            if (attribute != -1)
-            {
-                const char *catrn = api->userAttributeToString(attribute);
-                string attrname = catrn;
-                delete [] catrn;
-
-                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                api->setUserAttribute(attribute, attrValue.c_str(), megaCmdListener);
-                megaCmdListener->wait();
-                if (checkNoErrors(megaCmdListener->getError(), string("set user attribute ") + attrname))
-                {
-                    OUTSTREAM << "User attribute " << attrname << " updated correctly" << endl;
-                    printUserAttribute(attribute, user, listattrs);
-                }
-                delete megaCmdListener;
-            }
-            else
-            {
-                setCurrentOutCode(MCMD_EARGS);
-                LOG_err << "Attribute not specified";
-                LOG_err << "      " << getUsageStr("userattr");
-                return;
-            }
+            string s = words[1] + "B";
+            maxspeed = textToSize(s.c_str());
         }
-        else // list
+        if (!getFlag(clflags, "u") && !getFlag(clflags, "d"))
         {
-            if (listall)
-            {
-                int a = 0;
-                bool found = false;
-                do
-                {
-                    found = printUserAttribute(a, user, listattrs);
-                    a++;
-                } while (found && listall);
-            }
-            else
-            {
-                if (!printUserAttribute(attribute, user, listattrs))
-                {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << "Attribute not found: " << words[1];
-                }
-            }
+            ConfigurationManager::savePropertyValue("maxspeedupload", maxspeed);
+            ConfigurationManager::savePropertyValue("maxspeeddownload", maxspeed);
+        }
+        else if (getFlag(clflags, "u"))
+        {
+            ConfigurationManager::savePropertyValue("maxspeedupload", maxspeed);
+        }
+        else if (getFlag(clflags, "d"))
+        {
+            ConfigurationManager::savePropertyValue("maxspeeddownload", maxspeed);
         }
+    }
+    sandboxCMD->bandwidthScheduler.apply(api);
 
-        return;
+    bool hr = getFlag(clflags,"h");
+
+    if (!getFlag(clflags, "u") && !getFlag(clflags, "d"))
+    {
+        long long us = api->getMaxUploadSpeed();
+        long long ds = api->getMaxDownloadSpeed();
+        OUTSTREAM << "Upload speed limit = " << (us?sizeToText(us,false,hr):"unlimited") << ((us && hr)?"/s":(us?" B/s":""))  << endl;
+        OUTSTREAM << "Download speed limit = " << (ds?sizeToText(ds,false,hr):"unlimited") << ((ds && hr)?"/s":(us?" B/s":"")) << endl;
     }
-    else if (words[0] == "thumbnail")
+    else if (getFlag(clflags, "u"))
     {
-        if (!api->isFilesystemAvailable())
+        long long us = api->getMaxUploadSpeed();
+        OUTSTREAM << "Upload speed limit = " << (us?sizeToText(us,false,hr):"unlimited") << ((us && hr)?"/s":(us?" B/s":"")) << endl;
+    }
+    else if (getFlag(clflags, "d"))
+    {
+        long long ds = api->getMaxDownloadSpeed();
+        OUTSTREAM << "Download speed limit = " << (ds?sizeToText(ds,false,hr):"unlimited") << ((ds && hr)?"/s":(ds?" B/s":"")) << endl;
+    }
+
+    int active = -1;
+    vector<BandwidthScheduler::Window> windows = sandboxCMD->bandwidthScheduler.getSchedule(&active);
+    if (windows.size())
+    {
+        OUTSTREAM << "Schedule:";
+        for (unsigned int i = 0; i < windows.size(); i++)
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            OUTSTREAM << (i ? ", " : " ") << BandwidthScheduler::windowToString(windows[i], hr);
         }
-        if (words.size() > 1)
+        OUTSTREAM << endl;
+        if (active >= 0)
         {
-            string nodepath = words[1];
-            string path = words.size() > 2 ? words[2] : "./";
-            n = nodebypath(nodepath.c_str());
-            if (n)
-            {
-                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                bool setting = getFlag(clflags, "s");
-                if (setting)
-                {
-                    api->setThumbnail(n, path.c_str(), megaCmdListener);
-                }
-                else
-                {
-                    api->getThumbnail(n, path.c_str(), megaCmdListener);
-                }
-                megaCmdListener->wait();
-                if (checkNoErrors(megaCmdListener->getError(), ( setting ? "set thumbnail " : "get thumbnail " ) + nodepath + " to " + path))
-                {
-                    OUTSTREAM << "Thumbnail for " << nodepath << ( setting ? " loaded from " : " saved in " ) << megaCmdListener->getRequest()->getFile() << endl;
-                }
-                delete megaCmdListener;
-                delete n;
-            }
+            OUTSTREAM << "Limits in effect are those of window " << BandwidthScheduler::windowToString(windows[active], hr)
+                      << ". Base limits apply out of the scheduled windows" << endl;
         }
-        else
+    }
+
+    vector<BandwidthScheduler::ClientUsage> usage = sandboxCMD->bandwidthScheduler.getUsage();
+    if (usage.size())
+    {
+        OUTSTREAM << endl;
+        OUTSTREAM << getFixLengthString("CLIENT", 8) << getFixLengthString("TYPE", 10) << getFixLengthString("TRANSFERS", 11)
+                  << getFixLengthString("OBSERVED", 12, ' ', true) << getFixLengthString("ALLOWED", 12, ' ', true) << "  STATE" << endl;
+        for (auto &u : usage)
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("attr");
-            return;
+            if ((getFlag(clflags, "u") && u.type != MegaTransfer::TYPE_UPLOAD) || (getFlag(clflags, "d") && u.type != MegaTransfer::TYPE_DOWNLOAD))
+            {
+                continue;
+            }
+            OUTSTREAM << getFixLengthString(u.clientID == -1 ? "-" : SSTR(u.clientID), 8)
+                      << getFixLengthString(u.type == MegaTransfer::TYPE_UPLOAD ? "upload" : "download", 10)
+                      << getFixLengthString(SSTR(u.transfers), 11)
+                      << getFixLengthString(sizeToText(u.observed, false, hr) + "/s", 12, ' ', true)
+                      << getFixLengthString(u.allowed ? sizeToText(u.allowed, false, hr) + "/s" : string("unlimited"), 12, ' ', true)
+                      << "  " << (u.throttled ? "throttled" : "active") << endl;
         }
+    }
+
+    return;
+}
+
+void MegaCmdExecuter::executeInvite(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
         return;
     }
-    else if (words[0] == "preview")
+    if (words.size() > 1)
     {
-        if (!api->isFilesystemAvailable())
+        string email = words[1];
+        if (!isValidEmail(email))
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            setCurrentOutCode(MCMD_INVALIDEMAIL);
+            LOG_err << "No valid email provided";
+            LOG_err << "      " << getUsageStr("invite");
         }
-        if (words.size() > 1)
+        else
         {
-            string nodepath = words[1];
-            string path = words.size() > 2 ? words[2] : "./";
-            n = nodebypath(nodepath.c_str());
-            if (n)
+            int action = MegaContactRequest::INVITE_ACTION_ADD;
+            if (getFlag(clflags, "d"))
             {
-                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                bool setting = getFlag(clflags, "s");
-                if (setting)
-                {
-                    api->setPreview(n, path.c_str(), megaCmdListener);
-                }
-                else
-                {
-                    api->getPreview(n, path.c_str(), megaCmdListener);
-                }
-                megaCmdListener->wait();
-                if (checkNoErrors(megaCmdListener->getError(), ( setting ? "set preview " : "get preview " ) + nodepath + " to " + path))
+                action = MegaContactRequest::INVITE_ACTION_DELETE;
+            }
+            if (getFlag(clflags, "r"))
+            {
+                action = MegaContactRequest::INVITE_ACTION_REMIND;
+            }
+
+            string message = getOption(cloptions, "message", "");
+            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+            api->inviteContact(email.c_str(), message.c_str(), action, megaCmdListener);
+            megaCmdListener->wait();
+            if (checkNoErrors(megaCmdListener->getError(), action==MegaContactRequest::INVITE_ACTION_DELETE?"remove invitation":"(re)invite user"))
+            {
+                OUTSTREAM << "Invitation to user: " << email << " " << (action==MegaContactRequest::INVITE_ACTION_DELETE?"removed":"sent") << endl;
+            }
+            else if (megaCmdListener->getError()->getErrorCode() == MegaError::API_EACCESS)
+            {
+                ostringstream os;
+                os << "Reminder not yet available: " << " available after 15 days";
+                MegaContactRequestList *ocrl = api->getOutgoingContactRequests();
+                if (ocrl)
                 {
-                    OUTSTREAM << "Preview for " << nodepath << ( setting ? " loaded from " : " saved in " ) << megaCmdListener->getRequest()->getFile() << endl;
+                    for (int i = 0; i < ocrl->size(); i++)
+                    {
+                        if (ocrl->get(i)->getTargetEmail() && megaCmdListener->getRequest()->getEmail() && !strcmp(ocrl->get(i)->getTargetEmail(), megaCmdListener->getRequest()->getEmail()))
+                        {
+                            os << " (" << getReadableTime(getTimeStampAfter(ocrl->get(i)->getModificationTime(), "15d")) << ")";
+                        }
+                    }
+
+                    delete ocrl;
                 }
-                delete megaCmdListener;
-                delete n;
+                LOG_err << os.str();
             }
+            delete megaCmdListener;
         }
-        else
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("attr");
-            return;
-        }
+    }
+
+    return;
+}
+
+void MegaCmdExecuter::executeErrorcode(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (words.size() != 2)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("errorcode");
         return;
     }
-    else if (words[0] == "tree")
+
+    int errCode = -1999;
+    istringstream is(words[1]);
+    is >> errCode;
+    if (errCode == -1999)
     {
-        vector<string> newcom;
-        newcom.push_back("ls");
-        (*clflags)["tree"] = 1;
-        if (words.size()>1)
-        {
-            for (vector<string>::iterator it = ++words.begin(); it != words.end();it++)
-            {
-                newcom.push_back(*it);
-            }
-        }
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "Invalid error code: " << words[1];
+        return;
+    }
 
-        return executecommand(newcom, clflags, cloptions);
+    if (errCode > 0)
+    {
+        errCode = -errCode;
     }
-    else if (words[0] == "debug")
+
+    string errString = getMCMDErrorString(errCode);
+    if (errString == "UNKNOWN")
     {
-        vector<string> newcom;
-        newcom.push_back("log");
-        newcom.push_back("5");
+        errString = MegaError::getErrorString(errCode);
+    }
+
+    OUTSTREAM << errString << endl;
 
-        return executecommand(newcom, clflags, cloptions);
+}
+
+void MegaCmdExecuter::executeSignup(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (api->isLoggedIn())
+    {
+        setCurrentOutCode(MCMD_INVALIDSTATE);
+        LOG_err << "Please loggout first ";
     }
-    else if (words[0] == "passwd")
+    else if (words.size() > 1)
     {
-        string confirmationQuery("Changing password will close all your sessions. Are you sure?(Yes/No): ");
-        bool force = getFlag(clflags, "f");
-        int confirmationResponse = force?MCMDCONFIRM_ALL:askforConfirmation(confirmationQuery);
-        if (confirmationResponse != MCMDCONFIRM_YES && confirmationResponse != MCMDCONFIRM_ALL)
+        string email = words[1];
+        if (words.size() > 2)
         {
-            return;
+            string name = getOption(cloptions, "name", email);
+            string passwd = words[2];
+            signup(name, passwd, email);
         }
+        else
+        {
+            login = words[1];
+            name = getOption(cloptions, "name", email);
+            signingup = true;
+            if (interactiveThread())
+            {
+                setprompt(NEWPASSWORD);
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_EARGS);
+                LOG_err << "Extra args required in non-interactive mode. Usage: " << getUsageStr("signup");
+            }
+        }
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("signup");
+    }
+
+    return;
+}
 
-        if (api->isLoggedIn())
+void MegaCmdExecuter::executeWhoami(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    MegaUser *u = api->getMyUser();
+    if (u)
+    {
+        OUTSTREAM << "Account e-mail: " << u->getEmail() << endl;
+        if (getFlag(clflags, "l"))
         {
-            if (words.size() == 1)
-            {
-                if (interactiveThread())
-                {
-                    setprompt(NEWPASSWORD);
-                }
-                else
-                {
-                    setCurrentOutCode(MCMD_EARGS);
-                    LOG_err << "Extra args required in non-interactive mode. Usage: " << getUsageStr("passwd");
-                }
-            }
-            else if (words.size() == 2)
+            std::shared_ptr<MegaAccountDetails> details = sandboxCMD->accountDetails.get(AccountDetailsCache::EXTENDED, api, false);
+            if (details)
             {
-                string pin2fa = getOption(cloptions, "auth-code", "");
-                changePassword(words[1].c_str(), pin2fa);
+                printAccountDetails(details.get());
             }
             else
             {
-                setCurrentOutCode(MCMD_EARGS);
-                LOG_err << "      " << getUsageStr("passwd");
+                setCurrentOutCode(MCMD_EUNEXPECTED);
+                LOG_err << "Failed to get account details";
             }
         }
-        else
-        {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-        }
-
-        return;
+        delete u;
     }
-    else if (words[0] == "speedlimit")
+    else
     {
-        if (words.size() > 2)
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+    }
+
+    return;
+}
+
+void MegaCmdExecuter::executeDf(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    MegaNode* n = NULL;
+    bool humanreadable = getFlag(clflags, "h");
+    MegaUser *u = api->getMyUser();
+    if (u)
+    {
+        std::shared_ptr<MegaAccountDetails> details = sandboxCMD->accountDetails.get(AccountDetailsCache::BASIC, api, false);
+        if (!details)
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("speedlimit");
-            return;
+            setCurrentOutCode(MCMD_EUNEXPECTED);
+            LOG_err << "Failed to get used storage";
         }
-        if (words.size() > 1)
+        else
         {
-            long long maxspeed = textToSize(words[1].c_str());
-            if (maxspeed == -1)
+            long long usedTotal = 0;
+            long long rootStorage = 0;
+            long long inboxStorage = 0;
+            long long rubbishStorage = 0;
+            long long insharesStorage = 0;
+
+            long long storageMax = details->getStorageMax();
+
+            unique_ptr<MegaNode> root(api->getRootNode());
+            unique_ptr<MegaNode> inbox(api->getInboxNode());
+            unique_ptr<MegaNode> rubbish(api->getRubbishNode());
+            unique_ptr<MegaNodeList> inShares(api->getInShares());
+
+            if (!root || !inbox || !rubbish)
             {
-                string s = words[1] + "B";
-                maxspeed = textToSize(s.c_str());
+                LOG_err << " Error retrieving storage details. Root node missing";
+                return;
             }
-            if (!getFlag(clflags, "u") && !getFlag(clflags, "d"))
+
+            MegaHandle rootHandle = root->getHandle();
+            MegaHandle inboxHandle = inbox->getHandle();
+            MegaHandle rubbishHandle = rubbish->getHandle();
+
+            rootStorage = details->getStorageUsed(rootHandle);
+            OUTSTREAM << "Cloud drive:          "
+                      << getFixLengthString(sizeToText(rootStorage, true, humanreadable), 12, ' ', true) << " in "
+                      << getFixLengthString(SSTR(details->getNumFiles(rootHandle)),7,' ',true) << " file(s) and "
+                      << getFixLengthString(SSTR(details->getNumFolders(rootHandle)),7,' ',true) << " folder(s)" << endl;
+
+
+            inboxStorage = details->getStorageUsed(inboxHandle);
+            OUTSTREAM << "Inbox:                "
+                      << getFixLengthString(sizeToText(inboxStorage, true, humanreadable), 12, ' ', true ) << " in "
+                      << getFixLengthString(SSTR(details->getNumFiles(inboxHandle)),7,' ',true) << " file(s) and "
+                      << getFixLengthString(SSTR(details->getNumFolders(inboxHandle)),7,' ',true) << " folder(s)" << endl;
+
+            rubbishStorage = details->getStorageUsed(rubbishHandle);
+            OUTSTREAM << "Rubbish bin:          "
+                      << getFixLengthString(sizeToText(rubbishStorage, true, humanreadable), 12, ' ', true) << " in "
+                      << getFixLengthString(SSTR(details->getNumFiles(rubbishHandle)),7,' ',true) << " file(s) and "
+                      << getFixLengthString(SSTR(details->getNumFolders(rubbishHandle)),7,' ',true) << " folder(s)" << endl;
+
+
+            if (inShares)
             {
-                api->setMaxDownloadSpeed(maxspeed);
-                api->setMaxUploadSpeed(maxspeed);
-                ConfigurationManager::savePropertyValue("maxspeedupload", maxspeed);
-                ConfigurationManager::savePropertyValue("maxspeeddownload", maxspeed);
+                for (int i = 0; i < inShares->size(); i++)
+                {
+                    n = inShares->get(i);
+                    long long thisinshareStorage = details->getStorageUsed(n->getHandle());
+                    insharesStorage += thisinshareStorage;
+                    if (i == 0)
+                    {
+                        OUTSTREAM << "Incoming shares:" << endl;
+                    }
+
+                    string name = n->getName();
+                    name += ": ";
+                    name.append(max(0, int (21 - name.size())), ' ');
+
+                    OUTSTREAM << " " << name
+                              << getFixLengthString(sizeToText(thisinshareStorage, true, humanreadable), 12, ' ', true) << " in "
+                              << getFixLengthString(SSTR(details->getNumFiles(n->getHandle())),7,' ',true) << " file(s) and "
+                              << getFixLengthString(SSTR(details->getNumFolders(n->getHandle())),7,' ',true) << " folder(s)" << endl;
+                }
             }
-            else if (getFlag(clflags, "u"))
+
+            usedTotal = sandboxCMD->receivedStorageSum;
+
+            float percent = float(usedTotal * 1.0 / storageMax);
+            if (percent < 0 ) percent = 0;
+
+            string sof= percentageToText(percent);
+            sof +=  " of ";
+            sof +=  sizeToText(storageMax, true, humanreadable);
+
+
+            for (int i = 0; i < 75 ; i++)
             {
-                api->setMaxUploadSpeed(maxspeed);
-                ConfigurationManager::savePropertyValue("maxspeedupload", maxspeed);
+                OUTSTREAM << "-";
             }
-            else if (getFlag(clflags, "d"))
+            OUTSTREAM << endl;
+
+            OUTSTREAM << "USED STORAGE:         " << getFixLengthString(sizeToText(usedTotal, true, humanreadable), 12, ' ', true)
+                      << "  " << getFixLengthString(sof, 39, ' ', true) << endl;
+
+            for (int i = 0; i < 75 ; i++)
             {
-                api->setMaxDownloadSpeed(maxspeed);
-                ConfigurationManager::savePropertyValue("maxspeeddownload", maxspeed);
+                OUTSTREAM << "-";
             }
-        }
+            OUTSTREAM << endl;
 
-        bool hr = getFlag(clflags,"h");
+            long long usedinVersions = details->getVersionStorageUsed(rootHandle)
+                    + details->getVersionStorageUsed(inboxHandle)
+                    + details->getVersionStorageUsed(rubbishHandle);
 
-        if (!getFlag(clflags, "u") && !getFlag(clflags, "d"))
-        {
-            long long us = api->getMaxUploadSpeed();
-            long long ds = api->getMaxDownloadSpeed();
-            OUTSTREAM << "Upload speed limit = " << (us?sizeToText(us,false,hr):"unlimited") << ((us && hr)?"/s":(us?" B/s":""))  << endl;
-            OUTSTREAM << "Download speed limit = " << (ds?sizeToText(ds,false,hr):"unlimited") << ((ds && hr)?"/s":(us?" B/s":"")) << endl;
-        }
-        else if (getFlag(clflags, "u"))
-        {
-            long long us = api->getMaxUploadSpeed();
-            OUTSTREAM << "Upload speed limit = " << (us?sizeToText(us,false,hr):"unlimited") << ((us && hr)?"/s":(us?" B/s":"")) << endl;
-        }
-        else if (getFlag(clflags, "d"))
-        {
-            long long ds = api->getMaxDownloadSpeed();
-            OUTSTREAM << "Download speed limit = " << (ds?sizeToText(ds,false,hr):"unlimited") << ((ds && hr)?"/s":(ds?" B/s":"")) << endl;
+
+            OUTSTREAM << "Total size taken up by file versions: "
+                      << getFixLengthString(sizeToText(usedinVersions, true, humanreadable), 12, ' ', true) << endl;
         }
+        delete u;
+    }
+    else
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+    }
 
+    return;
+}
+
+void MegaCmdExecuter::executeExport(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
         return;
     }
-    else if (words[0] == "invite")
+    ::mega::m_time_t expireTime = 0;
+    string sexpireTime = getOption(cloptions, "expire", "");
+    if ("" != sexpireTime)
     {
-        if (!api->isFilesystemAvailable())
-        {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
-        }
-        if (words.size() > 1)
+        expireTime = getTimeStampAfter(sexpireTime);
+    }
+    if (expireTime < 0)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "Invalid time " << sexpireTime;
+        return;
+    }
+
+    string linkPass = getOption(cloptions, "password", "");
+    bool add = getFlag(clflags, "a");
+
+    if (linkPass.size() && !add)
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "You need to use -a to add an export. Usage: " << getUsageStr("export");
+        return;
+    }
+
+    if (words.size() <= 1)
+    {
+        words.push_back(string(".")); //cwd
+    }
+
+    for (int i = 1; i < (int)words.size(); i++)
+    {
+        unescapeifRequired(words[i]);
+        if (isRegExp(words[i]))
         {
-            string email = words[1];
-            if (!isValidEmail(email))
-            {
-                setCurrentOutCode(MCMD_INVALIDEMAIL);
-                LOG_err << "No valid email provided";
-                LOG_err << "      " << getUsageStr("invite");
-            }
-            else
+            vector<MegaNode *> *nodes = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
+            if (nodes)
             {
-                int action = MegaContactRequest::INVITE_ACTION_ADD;
-                if (getFlag(clflags, "d"))
+                if (!nodes->size())
                 {
-                    action = MegaContactRequest::INVITE_ACTION_DELETE;
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                    LOG_err << "Nodes not found: " << words[i];
                 }
-                if (getFlag(clflags, "r"))
+                for (std::vector< MegaNode * >::iterator it = nodes->begin(); it != nodes->end(); ++it)
                 {
-                    action = MegaContactRequest::INVITE_ACTION_REMIND;
+                    MegaNode * n = *it;
+                    if (n)
+                    {
+                        if (add)
+                        {
+                            LOG_debug << " exporting ... " << n->getName() << " expireTime=" << expireTime;
+                            exportNode(n, expireTime, linkPass, getFlag(clflags,"f"));
+                        }
+                        else if (getFlag(clflags, "d"))
+                        {
+                            LOG_debug << " deleting export ... " << n->getName();
+                            disableExport(n);
+                        }
+                        else
+                        {
+                            if (dumpListOfExported(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i]) == 0 )
+                            {
+                                OUTSTREAM << words[i] << " is not exported. Use -a to export it" << endl;
+                            }
+                        }
+                        delete n;
+                    }
                 }
 
-                string message = getOption(cloptions, "message", "");
-                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                api->inviteContact(email.c_str(), message.c_str(), action, megaCmdListener);
-                megaCmdListener->wait();
-                if (checkNoErrors(megaCmdListener->getError(), action==MegaContactRequest::INVITE_ACTION_DELETE?"remove invitation":"(re)invite user"))
+                nodes->clear();
+                delete nodes;
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Node not found: " << words[i];
+            }
+        }
+        else
+        {
+            MegaNode *n = nodebypath(words[i].c_str());
+            if (n)
+            {
+                if (add)
+                {
+                    LOG_debug << " exporting ... " << n->getName();
+                    exportNode(n, expireTime, linkPass, getFlag(clflags,"f"));
+                }
+                else if (getFlag(clflags, "d"))
                 {
-                    OUTSTREAM << "Invitation to user: " << email << " " << (action==MegaContactRequest::INVITE_ACTION_DELETE?"removed":"sent") << endl;
+                    LOG_debug << " deleting export ... " << n->getName();
+                    disableExport(n);
                 }
-                else if (megaCmdListener->getError()->getErrorCode() == MegaError::API_EACCESS)
+                else
                 {
-                    ostringstream os;
-                    os << "Reminder not yet available: " << " available after 15 days";
-                    MegaContactRequestList *ocrl = api->getOutgoingContactRequests();
-                    if (ocrl)
+                    if (dumpListOfExported(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i]) == 0 )
                     {
-                        for (int i = 0; i < ocrl->size(); i++)
+                        OUTSTREAM << "Couldn't find anything exported below ";
+                        if (words[i] == ".")
                         {
-                            if (ocrl->get(i)->getTargetEmail() && megaCmdListener->getRequest()->getEmail() && !strcmp(ocrl->get(i)->getTargetEmail(), megaCmdListener->getRequest()->getEmail()))
-                            {
-                                os << " (" << getReadableTime(getTimeStampAfter(ocrl->get(i)->getModificationTime(), "15d")) << ")";
-                            }
+                            OUTSTREAM << "current folder";
                         }
-
-                        delete ocrl;
+                        else
+                        {
+                            OUTSTREAM << "<";
+                            OUTSTREAM << words[i];
+                            OUTSTREAM << ">";
+                        }
+                        OUTSTREAM << ". Use -a to export " << (words[i].size()?"it":"something") << endl;
                     }
-                    LOG_err << os.str();
                 }
-                delete megaCmdListener;
+                delete n;
+            }
+            else
+            {
+                setCurrentOutCode(MCMD_NOTFOUND);
+                LOG_err << "Node not found: " << words[i];
             }
         }
-
-        return;
     }
-    else if (words[0] == "errorcode")
+
+    return;
+}
+
+/**
+ * @brief Imports a public link into dstFolder, decrypting it first with password when it is password protected.
+ *
+ * It does not output to the petition, so that several links can be imported concurrently.
+ */
+void MegaCmdExecuter::importLink(string publicLink, const string &password, MegaNode *dstFolder, ImportResult *result)
+{
+    if (isEncryptedLink(publicLink))
     {
-        if (words.size() != 2)
+        if (!password.size())
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("errorcode");
+            result->outCode = MCMD_EARGS;
+            result->error = "Need a password to decrypt provided link (--password=PASSWORD)";
             return;
         }
-
-        int errCode = -1999;
-        istringstream is(words[1]);
-        is >> errCode;
-        if (errCode == -1999)
+        std::unique_ptr<MegaCmdListener> megaCmdListener {new MegaCmdListener(NULL)};
+        api->decryptPasswordProtectedLink(publicLink.c_str(), password.c_str(), megaCmdListener.get());
+        megaCmdListener->wait();
+        if (megaCmdListener->getError()->getErrorCode() != MegaError::API_OK)
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "Invalid error code: " << words[1];
+            result->outCode = MCMD_NOTPERMITTED;
+            result->error = "Invalid password";
             return;
         }
+        publicLink = megaCmdListener->getRequest()->getText();
+    }
 
-        if (errCode > 0)
-        {
-            errCode = -errCode;
-        }
-
-        string errString = getMCMDErrorString(errCode);
-        if (errString == "UNKNOWN")
+    if (getLinkType(publicLink) == MegaNode::TYPE_FILE)
+    {
+        std::unique_ptr<MegaCmdListener> megaCmdListener {new MegaCmdListener(NULL)};
+        api->importFileLink(publicLink.c_str(), dstFolder, megaCmdListener.get());
+        megaCmdListener->wait();
+        if (megaCmdListener->getError()->getErrorCode() != MegaError::API_OK)
         {
-            errString = MegaError::getErrorString(errCode);
+            result->outCode = megaCmdListener->getError()->getErrorCode();
+            result->error = string("Failed to import node: ") + megaCmdListener->getError()->getErrorString();
+            return;
         }
-
-        OUTSTREAM << errString << endl;
-
+        result->handle = megaCmdListener->getRequest()->getNodeHandle();
     }
-    else if (words[0] == "signup")
+    else if (getLinkType(publicLink) == MegaNode::TYPE_FOLDER)
     {
-        if (api->isLoggedIn())
+        MegaApi* apiFolder = getApiFolderForLink(publicLink, &result->error);
+        if (!apiFolder)
         {
-            setCurrentOutCode(MCMD_INVALIDSTATE);
-            LOG_err << "Please loggout first ";
+            result->outCode = MCMD_EUNEXPECTED;
+            return;
         }
-        else if (words.size() > 1)
+
+        std::unique_ptr<MegaNode> nodeToImport;
+        string shandle = getPublicLinkHandle(publicLink);
+        if (shandle.size())
         {
-            string email = words[1];
-            if (words.size() > 2)
-            {
-                string name = getOption(cloptions, "name", email);
-                string passwd = words[2];
-                signup(name, passwd, email);
-            }
-            else
-            {
-                login = words[1];
-                name = getOption(cloptions, "name", email);
-                signingup = true;
-                if (interactiveThread())
-                {
-                    setprompt(NEWPASSWORD);
-                }
-                else
-                {
-                    setCurrentOutCode(MCMD_EARGS);
-                    LOG_err << "Extra args required in non-interactive mode. Usage: " << getUsageStr("signup");
-                }
-            }
+            nodeToImport.reset(apiFolder->getNodeByHandle(apiFolder->base64ToHandle(shandle.c_str())));
         }
         else
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("signup");
+            nodeToImport.reset(apiFolder->getRootNode());
         }
 
-        return;
-    }
-    else if (words[0] == "whoami")
-    {
-        MegaUser *u = api->getMyUser();
-        if (u)
+        std::unique_ptr<MegaNode> authorizedNode {nodeToImport ? apiFolder->authorizeNode(nodeToImport.get()) : NULL};
+        if (!nodeToImport)
         {
-            OUTSTREAM << "Account e-mail: " << u->getEmail() << endl;
-            if (getFlag(clflags, "l"))
-            {
-                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                api->getExtendedAccountDetails(true, true, true, megaCmdListener);
-                actUponGetExtendedAccountDetails(megaCmdListener);
-                delete megaCmdListener;
-            }
-            delete u;
+            result->outCode = MCMD_INVALIDSTATE;
+            result->error = shandle.size() ? "Failed to get node corresponding to handle within public link " + shandle
+                                           : string("Couldn't get root folder for folder link");
         }
-        else
+        else if (!authorizedNode)
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
+            result->outCode = MCMD_EUNEXPECTED;
+            result->error = "Node couldn't be authorized: " + publicLink;
         }
-
-        return;
-    }
-    else if (words[0] == "df")
-    {
-        bool humanreadable = getFlag(clflags, "h");
-        MegaUser *u = api->getMyUser();
-        if (u)
+        else
         {
-            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-            api->getSpecificAccountDetails(true, false, false, -1, megaCmdListener);
-            megaCmdListener->wait();
-            if (checkNoErrors(megaCmdListener->getError(), "failed to get used storage"))
+            std::unique_ptr<MegaCmdListener> megaCmdListener3 {new MegaCmdListener(apiFolder, NULL)};
+            api->copyNode(authorizedNode.get(), dstFolder, megaCmdListener3.get());
+            megaCmdListener3->wait();
+            if (megaCmdListener3->getError()->getErrorCode() != MegaError::API_OK)
             {
-                unique_ptr<MegaAccountDetails> details(megaCmdListener->getRequest()->getMegaAccountDetails());
-                if (details)
-                {
-                    long long usedTotal = 0;
-                    long long rootStorage = 0;
-                    long long inboxStorage = 0;
-                    long long rubbishStorage = 0;
-                    long long insharesStorage = 0;
-
-                    long long storageMax = details->getStorageMax();
-
-                    unique_ptr<MegaNode> root(api->getRootNode());
-                    unique_ptr<MegaNode> inbox(api->getInboxNode());
-                    unique_ptr<MegaNode> rubbish(api->getRubbishNode());
-                    unique_ptr<MegaNodeList> inShares(api->getInShares());
-
-                    if (!root || !inbox || !rubbish)
-                    {
-                        LOG_err << " Error retrieving storage details. Root node missing";
-                        return;
-                    }
-
-                    MegaHandle rootHandle = root->getHandle();
-                    MegaHandle inboxHandle = inbox->getHandle();
-                    MegaHandle rubbishHandle = rubbish->getHandle();
-
-                    rootStorage = details->getStorageUsed(rootHandle);
-                    OUTSTREAM << "Cloud drive:          "
-                              << getFixLengthString(sizeToText(rootStorage, true, humanreadable), 12, ' ', true) << " in "
-                              << getFixLengthString(SSTR(details->getNumFiles(rootHandle)),7,' ',true) << " file(s) and "
-                              << getFixLengthString(SSTR(details->getNumFolders(rootHandle)),7,' ',true) << " folder(s)" << endl;
-
-
-                    inboxStorage = details->getStorageUsed(inboxHandle);
-                    OUTSTREAM << "Inbox:                "
-                              << getFixLengthString(sizeToText(inboxStorage, true, humanreadable), 12, ' ', true ) << " in "
-                              << getFixLengthString(SSTR(details->getNumFiles(inboxHandle)),7,' ',true) << " file(s) and "
-                              << getFixLengthString(SSTR(details->getNumFolders(inboxHandle)),7,' ',true) << " folder(s)" << endl;
-
-                    rubbishStorage = details->getStorageUsed(rubbishHandle);
-                    OUTSTREAM << "Rubbish bin:          "
-                              << getFixLengthString(sizeToText(rubbishStorage, true, humanreadable), 12, ' ', true) << " in "
-                              << getFixLengthString(SSTR(details->getNumFiles(rubbishHandle)),7,' ',true) << " file(s) and "
-                              << getFixLengthString(SSTR(details->getNumFolders(rubbishHandle)),7,' ',true) << " folder(s)" << endl;
-
-
-                    if (inShares)
-                    {
-                        for (int i = 0; i < inShares->size(); i++)
-                        {
-                            n = inShares->get(i);
-                            long long thisinshareStorage = details->getStorageUsed(n->getHandle());
-                            insharesStorage += thisinshareStorage;
-                            if (i == 0)
-                            {
-                                OUTSTREAM << "Incoming shares:" << endl;
-                            }
-
-                            string name = n->getName();
-                            name += ": ";
-                            name.append(max(0, int (21 - name.size())), ' ');
-
-                            OUTSTREAM << " " << name
-                                      << getFixLengthString(sizeToText(thisinshareStorage, true, humanreadable), 12, ' ', true) << " in "
-                                      << getFixLengthString(SSTR(details->getNumFiles(n->getHandle())),7,' ',true) << " file(s) and "
-                                      << getFixLengthString(SSTR(details->getNumFolders(n->getHandle())),7,' ',true) << " folder(s)" << endl;
-                        }
-                    }
-
-                    usedTotal = sandboxCMD->receivedStorageSum;
-
-                    float percent = float(usedTotal * 1.0 / storageMax);
-                    if (percent < 0 ) percent = 0;
-
-                    string sof= percentageToText(percent);
-                    sof +=  " of ";
-                    sof +=  sizeToText(storageMax, true, humanreadable);
-
-
-                    for (int i = 0; i < 75 ; i++)
-                    {
-                        OUTSTREAM << "-";
-                    }
-                    OUTSTREAM << endl;
-
-                    OUTSTREAM << "USED STORAGE:         " << getFixLengthString(sizeToText(usedTotal, true, humanreadable), 12, ' ', true)
-                              << "  " << getFixLengthString(sof, 39, ' ', true) << endl;
-
-                    for (int i = 0; i < 75 ; i++)
-                    {
-                        OUTSTREAM << "-";
-                    }
-                    OUTSTREAM << endl;
-
-                    long long usedinVersions = details->getVersionStorageUsed(rootHandle)
-                            + details->getVersionStorageUsed(inboxHandle)
-                            + details->getVersionStorageUsed(rubbishHandle);
-
-
-                    OUTSTREAM << "Total size taken up by file versions: "
-                              << getFixLengthString(sizeToText(usedinVersions, true, humanreadable), 12, ' ', true) << endl;
-                }
+                result->outCode = megaCmdListener3->getError()->getErrorCode();
+                result->error = string("Failed to import folder node: ") + megaCmdListener3->getError()->getErrorString();
+            }
+            else
+            {
+                result->handle = megaCmdListener3->getRequest()->getNodeHandle();
+                result->isFolder = true;
             }
-            delete megaCmdListener;
-            delete u;
-        }
-        else
-        {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
         }
+        freeApiFolder(apiFolder);
+    }
+    else
+    {
+        result->outCode = MCMD_EARGS;
+        result->error = "Invalid link: " + publicLink;
+    }
+}
 
+/**
+ * @brief Imports the links listed in a manifest: one per line, with tab separated fields
+ * "link [password [destination]]". Lines starting with '#' are ignored.
+ *
+ * Up to maxInFlight links (no more than "folder_links_pool_max") are imported at the same time by a pool
+ * of threads, which reuse the sessions of folder links. Outcomes are printed (and written into resultsPath, if given) as they are known,
+ * one line each: "LINENUMBER link OK handle path" or "LINENUMBER link ERROR - message", tab separated.
+ */
+void MegaCmdExecuter::importManifest(const string &manifestPath, const string &defaultDestination, const string &resultsPath, int maxInFlight, int clientID)
+{
+    struct ImportEntry
+    {
+        int lineNumber;
+        string link;
+        string password;
+        string destination;
+    };
+
+    ifstream manifest(manifestPath.c_str(), ios::in);
+    if (!manifest.is_open())
+    {
+        setCurrentOutCode(MCMD_NOTFOUND);
+        LOG_err << "Could not open manifest file: " << manifestPath;
         return;
     }
-    else if (words[0] == "export")
+    std::deque<ImportEntry> pending;
+    string line;
+    for (int lineNumber = 1; getline(manifest, line); lineNumber++)
     {
-        if (!api->isFilesystemAvailable())
+        if (line.size() && line.back() == '\r')
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
+            line.pop_back();
         }
-        ::mega::m_time_t expireTime = 0;
-        string sexpireTime = getOption(cloptions, "expire", "");
-        if ("" != sexpireTime)
+        if (line.empty() || line[0] == '#')
         {
-            expireTime = getTimeStampAfter(sexpireTime);
+            continue;
         }
-        if (expireTime < 0)
+        vector<string> fields;
+        size_t pos = 0;
+        for (size_t tab; (tab = line.find('\t', pos)) != string::npos; pos = tab + 1)
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "Invalid time " << sexpireTime;
-            return;
+            fields.push_back(line.substr(pos, tab - pos));
         }
+        fields.push_back(line.substr(pos));
+        fields.resize(3);
+        pending.push_back(ImportEntry{lineNumber, fields[0], fields[1], fields[2].size() ? fields[2] : defaultDestination});
+    }
+    manifest.close();
 
-        string linkPass = getOption(cloptions, "password", "");
-        bool add = getFlag(clflags, "a");
-
-        if (linkPass.size() && !add)
+    ofstream results;
+    if (resultsPath.size())
+    {
+        results.open(resultsPath.c_str(), ios::out | ios::trunc);
+        if (!results.is_open())
         {
             setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "You need to use -a to add an export. Usage: " << getUsageStr("export");
+            LOG_err << "Could not create results file: " << resultsPath;
             return;
         }
+    }
+
+    std::mutex importMutex;
+    std::condition_variable importCV;
+    std::deque<pair<ImportEntry, ImportResult> > outcomes;
+    // more importers than instances in the folder links pool would only wait for them
+    maxInFlight = std::min(maxInFlight, ConfigurationManager::getConfigurationValue("folder_links_pool_max", 20));
+    int runningImporters = std::max(1, std::min(maxInFlight, int(pending.size())));
+    size_t total = pending.size();
 
-        if (words.size() <= 1)
+    auto importer = [&]()
+    {
+        std::unique_lock<std::mutex> lock(importMutex);
+        while (!pending.empty())
         {
-            words.push_back(string(".")); //cwd
+            ImportEntry entry = pending.front();
+            pending.pop_front();
+            lock.unlock();
+
+            ImportResult result;
+            std::unique_ptr<MegaNode> dstFolder {entry.destination.size() ? nodebypath(entry.destination.c_str()) : api->getNodeByHandle(cwd)};
+            if (!isPublicLink(entry.link))
+            {
+                result.outCode = MCMD_INVALIDTYPE;
+                result.error = "Invalid link";
+            }
+            else if (!dstFolder || dstFolder->getType() == MegaNode::TYPE_FILE)
+            {
+                result.outCode = MCMD_INVALIDTYPE;
+                result.error = "Invalid destiny: " + entry.destination;
+            }
+            else
+            {
+                importLink(entry.link, entry.password, dstFolder.get(), &result);
+            }
+
+            lock.lock();
+            outcomes.push_back(std::make_pair(entry, result));
+            importCV.notify_all();
         }
+        runningImporters--;
+        importCV.notify_all();
+        lock.unlock();
+        forgetCurrentThreadOutCode(); // in case anything set it, for it not to outlive the thread
+    };
+
+    vector<std::thread> importers;
+    for (int i = runningImporters; i--; )
+    {
+        importers.emplace_back(importer);
+    }
+
+    int failed = 0;
+    size_t done = 0;
+    std::unique_lock<std::mutex> lock(importMutex);
+    while (done < total)
+    {
+        importCV.wait(lock, [&]() { return !outcomes.empty(); });
+        std::deque<pair<ImportEntry, ImportResult> > toReport;
+        toReport.swap(outcomes);
+        lock.unlock();
 
-        for (int i = 1; i < (int)words.size(); i++)
+        for (auto &outcome : toReport)
         {
-            unescapeifRequired(words[i]);
-            if (isRegExp(words[i]))
+            const ImportEntry &entry = outcome.first;
+            const ImportResult &result = outcome.second;
+            ostringstream os;
+            os << entry.lineNumber << "\t" << entry.link << "\t";
+            if (result.outCode == MCMD_OK)
             {
-                vector<MegaNode *> *nodes = nodesbypath(words[i].c_str(), getFlag(clflags,"use-pcre"));
-                if (nodes)
-                {
-                    if (!nodes->size())
-                    {
-                        setCurrentOutCode(MCMD_NOTFOUND);
-                        LOG_err << "Nodes not found: " << words[i];
-                    }
-                    for (std::vector< MegaNode * >::iterator it = nodes->begin(); it != nodes->end(); ++it)
-                    {
-                        MegaNode * n = *it;
-                        if (n)
-                        {
-                            if (add)
-                            {
-                                LOG_debug << " exporting ... " << n->getName() << " expireTime=" << expireTime;
-                                exportNode(n, expireTime, linkPass, getFlag(clflags,"f"));
-                            }
-                            else if (getFlag(clflags, "d"))
-                            {
-                                LOG_debug << " deleting export ... " << n->getName();
-                                disableExport(n);
-                            }
-                            else
-                            {
-                                if (dumpListOfExported(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i]) == 0 )
-                                {
-                                    OUTSTREAM << words[i] << " is not exported. Use -a to export it" << endl;
-                                }
-                            }
-                            delete n;
-                        }
-                    }
-
-                    nodes->clear();
-                    delete nodes;
-                }
-                else
-                {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << "Node not found: " << words[i];
-                }
+                std::unique_ptr<char []> handle {api->handleToBase64(result.handle)};
+                os << "OK\t" << handle.get() << "\t" << sandboxCMD->nodePathCache.getNodePath(api, result.handle);
             }
             else
             {
-                MegaNode *n = nodebypath(words[i].c_str());
-                if (n)
-                {
-                    if (add)
-                    {
-                        LOG_debug << " exporting ... " << n->getName();
-                        exportNode(n, expireTime, linkPass, getFlag(clflags,"f"));
-                    }
-                    else if (getFlag(clflags, "d"))
-                    {
-                        LOG_debug << " deleting export ... " << n->getName();
-                        disableExport(n);
-                    }
-                    else
-                    {
-                        if (dumpListOfExported(n, getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")), clflags, cloptions, words[i]) == 0 )
-                        {
-                            OUTSTREAM << "Couldn't find anything exported below ";
-                            if (words[i] == ".")
-                            {
-                                OUTSTREAM << "current folder";
-                            }
-                            else
-                            {
-                                OUTSTREAM << "<";
-                                OUTSTREAM << words[i];
-                                OUTSTREAM << ">";
-                            }
-                            OUTSTREAM << ". Use -a to export " << (words[i].size()?"it":"something") << endl;
-                        }
-                    }
-                    delete n;
-                }
-                else
-                {
-                    setCurrentOutCode(MCMD_NOTFOUND);
-                    LOG_err << "Node not found: " << words[i];
-                }
+                os << "ERROR\t-\t" << result.error;
+                failed++;
+            }
+            OUTSTREAM << os.str() << endl;
+            if (results.is_open())
+            {
+                results << os.str() << endl;
             }
+            informProgressUpdate(++done, total, clientID, "Importing links");
         }
+        lock.lock();
+    }
+    lock.unlock();
+
+    for (auto &t : importers)
+    {
+        t.join();
+    }
+
+    OUTSTREAM << (total - failed) << " links imported, " << failed << " failed" << endl;
+    if (failed)
+    {
+        setCurrentOutCode(MCMD_EUNEXPECTED);
+    }
+}
 
+void MegaCmdExecuter::executeImport(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
+    {
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
         return;
     }
-    else if (words[0] == "import")
+
+    string manifestPath = getOption(cloptions, "manifest", "");
+    if (manifestPath.size())
     {
-        if (!api->isFilesystemAvailable())
+        if (words.size() > 2)
         {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
+            setCurrentOutCode(MCMD_EARGS);
+            LOG_err << "      " << getUsageStr("import");
             return;
         }
-        string remotePath = "";
-        MegaNode *dstFolder = NULL;
-        if (words.size() > 1) //link
+        int maxInFlight = getintOption(cloptions, "max-in-flight", ConfigurationManager::getConfigurationValue("import_max_in_flight", 8));
+        importManifest(manifestPath, words.size() > 1 ? words[1] : "", getOption(cloptions, "results", ""), maxInFlight,
+                       getintOption(cloptions, "clientID", -1));
+        return;
+    }
+
+    string remotePath = "";
+    MegaNode *dstFolder = NULL;
+    if (words.size() > 1) //link
+    {
+        if (isPublicLink(words[1]))
         {
-            if (isPublicLink(words[1]))
+            string publicLink = words[1];
+            string linkPass;
+            if (isEncryptedLink(publicLink))
             {
-                string publicLink = words[1];
-                if (isEncryptedLink(publicLink))
+                linkPass = getOption(cloptions, "password", "");
+                if (!linkPass.size())
                 {
-                    string linkPass = getOption(cloptions, "password", "");
-                    if (!linkPass.size())
-                    {
-                        linkPass = askforUserResponse("Enter password: ");
-                    }
-
-                    if (linkPass.size())
-                    {
-                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                        api->decryptPasswordProtectedLink(publicLink.c_str(), linkPass.c_str(), megaCmdListener);
-                        megaCmdListener->wait();
-                        if (checkNoErrors(megaCmdListener->getError(), "decrypt password protected link"))
-                        {
-                            publicLink = megaCmdListener->getRequest()->getText();
-                            delete megaCmdListener;
-                        }
-                        else
-                        {
-                            setCurrentOutCode(MCMD_NOTPERMITTED);
-                            LOG_err << "Invalid password";
-                            delete megaCmdListener;
-                            return;
-                        }
-                    }
-                    else
-                    {
-                        setCurrentOutCode(MCMD_EARGS);
-                        LOG_err << "Need a password to decrypt provided link (--password=PASSWORD)";
-                        return;
-                    }
+                    linkPass = askforUserResponse("Enter password: ");
                 }
+            }
 
-                if (words.size() > 2)
+            if (words.size() > 2)
+            {
+                remotePath = words[2];
+                dstFolder = nodebypath(remotePath.c_str());
+            }
+            else
+            {
+                dstFolder = api->getNodeByHandle(cwd);
+                remotePath = "."; //just to inform (alt: getpathbynode)
+            }
+            if (dstFolder && dstFolder->getType() != MegaNode::TYPE_FILE)
+            {
+                ImportResult result;
+                importLink(publicLink, linkPass, dstFolder, &result);
+                if (result.outCode != MCMD_OK)
                 {
-                    remotePath = words[2];
-                    dstFolder = nodebypath(remotePath.c_str());
+                    setCurrentOutCode(result.outCode);
+                    LOG_err << result.error;
+                    if (result.outCode == MCMD_EARGS && !isEncryptedLink(publicLink))
+                    {
+                        LOG_err << "      " << getUsageStr("import");
+                    }
                 }
                 else
                 {
-                    dstFolder = api->getNodeByHandle(cwd);
-                    remotePath = "."; //just to inform (alt: getpathbynode)
-                }
-                if (dstFolder && ( !dstFolder->getType() == MegaNode::TYPE_FILE ))
-                {
-                    if (getLinkType(publicLink) == MegaNode::TYPE_FILE)
+                    string importedPath = sandboxCMD->nodePathCache.getNodePath(api, result.handle);
+                    if (importedPath.size())
                     {
-                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-
-                        api->importFileLink(publicLink.c_str(), dstFolder, megaCmdListener);
-                        megaCmdListener->wait();
-                        if (checkNoErrors(megaCmdListener->getError(), "import node"))
-                        {
-                            MegaNode *imported = api->getNodeByHandle(megaCmdListener->getRequest()->getNodeHandle());
-                            if (imported)
-                            {
-                                char *importedPath = api->getNodePath(imported);
-                                OUTSTREAM << "Import file complete: " << importedPath << endl;
-                                delete []importedPath;
-                            }
-                            else
-                            {
-                                LOG_warn << "Import file complete: Couldn't get path of imported file";
-                            }
-                            delete imported;
-                        }
-
-                        delete megaCmdListener;
-                    }
-                    else if (getLinkType(publicLink) == MegaNode::TYPE_FOLDER)
-                    {
-                        MegaApi* apiFolder = getFreeApiFolder();
-                        char *accountAuth = api->getAccountAuth();
-                        apiFolder->setAccountAuth(accountAuth);
-                        delete []accountAuth;
-
-                        MegaCmdListener *megaCmdListener = new MegaCmdListener(apiFolder, NULL);
-                        apiFolder->loginToFolder(publicLink.c_str(), megaCmdListener);
-                        megaCmdListener->wait();
-                        if (checkNoErrors(megaCmdListener->getError(), "login to folder"))
-                        {
-                            MegaCmdListener *megaCmdListener2 = new MegaCmdListener(apiFolder, NULL);
-                            apiFolder->fetchNodes(megaCmdListener2);
-                            megaCmdListener2->wait();
-                            if (checkNoErrors(megaCmdListener2->getError(), "access folder link " + publicLink))
-                            {
-                                MegaNode *nodeToImport = NULL;
-                                bool usedRoot = false;
-                                string shandle = getPublicLinkHandle(publicLink);
-                                if (shandle.size())
-                                {
-                                    handle thehandle = apiFolder->base64ToHandle(shandle.c_str());
-                                    nodeToImport = apiFolder->getNodeByHandle(thehandle);
-                                }
-                                else
-                                {
-                                    nodeToImport = apiFolder->getRootNode();
-                                    usedRoot = true;
-                                }
-
-                                if (nodeToImport)
-                                {
-                                    MegaNode *authorizedNode = apiFolder->authorizeNode(nodeToImport);
-                                    if (authorizedNode != NULL)
-                                    {
-                                        MegaCmdListener *megaCmdListener3 = new MegaCmdListener(apiFolder, NULL);
-                                        api->copyNode(authorizedNode, dstFolder, megaCmdListener3);
-                                        megaCmdListener3->wait();
-                                        if (checkNoErrors(megaCmdListener->getError(), "import folder node"))
-                                        {
-                                            MegaNode *importedFolderNode = api->getNodeByHandle(megaCmdListener3->getRequest()->getNodeHandle());
-                                            char *pathnewFolder = api->getNodePath(importedFolderNode);
-                                            if (pathnewFolder)
-                                            {
-                                                OUTSTREAM << "Imported folder complete: " << pathnewFolder << endl;
-                                                delete []pathnewFolder;
-                                            }
-                                            delete importedFolderNode;
-                                        }
-                                        delete megaCmdListener3;
-                                        delete authorizedNode;
-                                    }
-                                    else
-                                    {
-                                        setCurrentOutCode(MCMD_EUNEXPECTED);
-                                        LOG_debug << "Node couldn't be authorized: " << publicLink;
-                                    }
-                                    delete nodeToImport;
-                                }
-                                else
-                                {
-                                    setCurrentOutCode(MCMD_INVALIDSTATE);
-                                    if (usedRoot)
-                                    {
-                                        LOG_err << "Couldn't get root folder for folder link";
-                                    }
-                                    else
-                                    {
-                                        LOG_err << "Failed to get node corresponding to handle within public link " << shandle;
-                                    }
-                                }
-                            }
-                            delete megaCmdListener2;
-                        }
-                        delete megaCmdListener;
-                        freeApiFolder(apiFolder);
+                        OUTSTREAM << (result.isFolder ? "Imported folder complete: " : "Import file complete: ") << importedPath << endl;
                     }
                     else
                     {
-                        setCurrentOutCode(MCMD_EARGS);
-                        LOG_err << "Invalid link: " << publicLink;
-                        LOG_err << "      " << getUsageStr("import");
+                        LOG_warn << "Import complete: Couldn't get path of imported node";
                     }
                 }
-                else
-                {
-                    setCurrentOutCode(MCMD_INVALIDTYPE);
-                    LOG_err << "Invalid destiny: " << remotePath;
-                }
-                delete dstFolder;
             }
             else
             {
                 setCurrentOutCode(MCMD_INVALIDTYPE);
-                LOG_err << "Invalid link: " << words[1];
+                LOG_err << "Invalid destiny: " << remotePath;
             }
+            delete dstFolder;
         }
         else
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("import");
+            setCurrentOutCode(MCMD_INVALIDTYPE);
+            LOG_err << "Invalid link: " << words[1];
         }
-
-        return;
     }
-    else if (words[0] == "reload")
+    else
     {
-        int clientID = getintOption(cloptions, "clientID", -1);
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("import");
+    }
 
-        OUTSTREAM << "Reloading account..." << endl;
-        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL, NULL, clientID);
-        api->fetchNodes(megaCmdListener);
-        actUponFetchNodes(api, megaCmdListener);
-        delete megaCmdListener;
-        return;
+    return;
+}
+
+void MegaCmdExecuter::executeReload(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    int clientID = getintOption(cloptions, "clientID", -1);
+
+    OUTSTREAM << "Reloading account..." << endl;
+    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL, NULL, clientID);
+    api->fetchNodes(megaCmdListener);
+    actUponFetchNodes(api, megaCmdListener);
+    delete megaCmdListener;
+    return;
+}
+
+void MegaCmdExecuter::executeLogout(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    OUTSTREAM << "Logging out..." << endl;
+    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+    bool keepSession = getFlag(clflags, "keep-session");
+    char * dumpSession = NULL;
+
+    if (keepSession) //local logout
+    {
+        dumpSession = api->dumpSession();
+        api->localLogout(megaCmdListener);
     }
-    else if (words[0] == "logout")
+    else
     {
-        OUTSTREAM << "Logging out..." << endl;
-        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-        bool keepSession = getFlag(clflags, "keep-session");
-        char * dumpSession = NULL;
+        api->logout(megaCmdListener);
+    }
+    actUponLogout(megaCmdListener, keepSession);
+    if (keepSession)
+    {
+        OUTSTREAM << "Session closed but not deleted. Warning: it will be restored the next time you execute the application. Execute \"logout\" to delete the session permanently." << endl;
 
-        if (keepSession) //local logout
-        {
-            dumpSession = api->dumpSession();
-            api->localLogout(megaCmdListener);
-        }
-        else
+        if (dumpSession)
         {
-            api->logout(megaCmdListener);
+            OUTSTREAM << "You can also login with the session id: " << dumpSession << endl;
+            delete []dumpSession;
         }
-        actUponLogout(megaCmdListener, keepSession);
-        if (keepSession)
-        {
-            OUTSTREAM << "Session closed but not deleted. Warning: it will be restored the next time you execute the application. Execute \"logout\" to delete the session permanently." << endl;
+    }
+    delete megaCmdListener;
 
-            if (dumpSession)
-            {
-                OUTSTREAM << "You can also login with the session id: " << dumpSession << endl;
-                delete []dumpSession;
-            }
-        }
-        delete megaCmdListener;
+    return;
+}
 
-        return;
-    }
-    else if (words[0] == "confirm")
+void MegaCmdExecuter::executeConfirm(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (words.size() > 2)
     {
-        if (words.size() > 2)
+        string link = words[1];
+        string email = words[2];
+        // check email corresponds with link:
+        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+        api->querySignupLink(link.c_str(), megaCmdListener);
+        megaCmdListener->wait();
+        if (checkNoErrors(megaCmdListener->getError(), "check email corresponds to link"))
         {
-            string link = words[1];
-            string email = words[2];
-            // check email corresponds with link:
-            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-            api->querySignupLink(link.c_str(), megaCmdListener);
-            megaCmdListener->wait();
-            if (checkNoErrors(megaCmdListener->getError(), "check email corresponds to link"))
+            if (megaCmdListener->getRequest()->getFlag())
+            {
+                OUTSTREAM << "Account " << email << " confirmed succesfully. You can login with it now" << endl;
+            }
+            else if (megaCmdListener->getRequest()->getEmail() && email == megaCmdListener->getRequest()->getEmail())
             {
-                if (megaCmdListener->getRequest()->getFlag())
+                string passwd;
+                if (words.size() > 3)
                 {
-                    OUTSTREAM << "Account " << email << " confirmed succesfully. You can login with it now" << endl;
+                    passwd = words[3];
+                    confirm(passwd, email, link);
                 }
-                else if (megaCmdListener->getRequest()->getEmail() && email == megaCmdListener->getRequest()->getEmail())
+                else
                 {
-                    string passwd;
-                    if (words.size() > 3)
+                    this->login = email;
+                    this->link = link;
+                    confirming = true;
+                    if (interactiveThread() && !getCurrentThreadIsCmdShell())
                     {
-                        passwd = words[3];
-                        confirm(passwd, email, link);
+                        setprompt(LOGINPASSWORD);
                     }
                     else
                     {
-                        this->login = email;
-                        this->link = link;
-                        confirming = true;
-                        if (interactiveThread() && !getCurrentThreadIsCmdShell())
-                        {
-                            setprompt(LOGINPASSWORD);
-                        }
-                        else
-                        {
-                            setCurrentOutCode(MCMD_EARGS);
-                            LOG_err << "Extra args required in non-interactive mode. Usage: " << getUsageStr("confirm");
-                        }
+                        setCurrentOutCode(MCMD_EARGS);
+                        LOG_err << "Extra args required in non-interactive mode. Usage: " << getUsageStr("confirm");
                     }
                 }
-                else
-                {
-                    setCurrentOutCode(MCMD_INVALIDEMAIL);
-                    LOG_err << email << " doesn't correspond to the confirmation link: " << link;
-                }
             }
-
-            delete megaCmdListener;
-        }
-        else
-        {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("confirm");
+            else
+            {
+                setCurrentOutCode(MCMD_INVALIDEMAIL);
+                LOG_err << email << " doesn't correspond to the confirmation link: " << link;
+            }
         }
 
-        return;
+        delete megaCmdListener;
     }
-    else if (words[0] == "session")
+    else
     {
-        char * dumpSession = api->dumpSession();
-        if (dumpSession)
-        {
-            OUTSTREAM << "Your (secret) session is: " << dumpSession << endl;
-            delete []dumpSession;
-        }
-        else
-        {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-        }
-        return;
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("confirm");
     }
-    else if (words[0] == "history")
+
+    return;
+}
+
+void MegaCmdExecuter::executeSession(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    char * dumpSession = api->dumpSession();
+    if (dumpSession)
     {
-        return;
+        OUTSTREAM << "Your (secret) session is: " << dumpSession << endl;
+        delete []dumpSession;
     }
-    else if (words[0] == "version")
+    else
     {
-        OUTSTREAM << "MEGAcmd version: " << MEGACMD_MAJOR_VERSION << "." << MEGACMD_MINOR_VERSION << "." << MEGACMD_MICRO_VERSION << "." << MEGACMD_BUILD_ID << ": code " << MEGACMD_CODE_VERSION
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+    }
+    return;
+}
+
+void MegaCmdExecuter::executeHistory(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    return;
+}
+
+void MegaCmdExecuter::executeVersion(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    OUTSTREAM << "MEGAcmd version: " << MEGACMD_MAJOR_VERSION << "." << MEGACMD_MINOR_VERSION << "." << MEGACMD_MICRO_VERSION << "." << MEGACMD_BUILD_ID << ": code " << MEGACMD_CODE_VERSION
 #ifdef _WIN64
-                  << " (64 bits)"
+              << " (64 bits)"
 #endif
-                  << endl;
+              << endl;
 
-        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-        api->getLastAvailableVersion("BdARkQSQ",megaCmdListener);
-        if (!megaCmdListener->trywait(2000))
+    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+    api->getLastAvailableVersion("BdARkQSQ",megaCmdListener);
+    if (!megaCmdListener->trywait(2000))
+    {
+        if (!megaCmdListener->getError())
         {
-            if (!megaCmdListener->getError())
-            {
-                LOG_fatal << "No MegaError at getLastAvailableVersion: ";
-            }
-            else if (megaCmdListener->getError()->getErrorCode() != MegaError::API_OK)
-            {
-                LOG_debug << "Couldn't get latests available version: " << megaCmdListener->getError()->getErrorString();
-            }
-            else
+            LOG_fatal << "No MegaError at getLastAvailableVersion: ";
+        }
+        else if (megaCmdListener->getError()->getErrorCode() != MegaError::API_OK)
+        {
+            LOG_debug << "Couldn't get latests available version: " << megaCmdListener->getError()->getErrorString();
+        }
+        else
+        {
+            if (megaCmdListener->getRequest()->getNumber() != MEGACMD_CODE_VERSION)
             {
-                if (megaCmdListener->getRequest()->getNumber() != MEGACMD_CODE_VERSION)
-                {
-                    OUTSTREAM << "---------------------------------------------------------------------" << endl;
-                    OUTSTREAM << "--        There is a new version available of megacmd: " << getLeftAlignedStr(megaCmdListener->getRequest()->getName(), 12) << "--" << endl;
-                    OUTSTREAM << "--        Please, download it from https://mega.nz/cmd             --" << endl;
+                OUTSTREAM << "---------------------------------------------------------------------" << endl;
+                OUTSTREAM << "--        There is a new version available of megacmd: " << getLeftAlignedStr(megaCmdListener->getRequest()->getName(), 12) << "--" << endl;
+                OUTSTREAM << "--        Please, download it from https://mega.nz/cmd             --" << endl;
 #if defined(__APPLE__)
-                    OUTSTREAM << "--        Before installing enter \"exit\" to close MEGAcmd          --" << endl;
+                OUTSTREAM << "--        Before installing enter \"exit\" to close MEGAcmd          --" << endl;
 #endif
-                    OUTSTREAM << "---------------------------------------------------------------------" << endl;
-                }
+                OUTSTREAM << "---------------------------------------------------------------------" << endl;
             }
-            delete megaCmdListener;
         }
-        else
-        {
-            LOG_debug << "Couldn't get latests available version (petition timed out)";
+        delete megaCmdListener;
+    }
+    else
+    {
+        LOG_debug << "Couldn't get latests available version (petition timed out)";
 
-            api->removeRequestListener(megaCmdListener);
-            delete megaCmdListener;
-        }
+        api->removeRequestListener(megaCmdListener);
+        delete megaCmdListener;
+    }
 
 
 
 
 
-        if (getFlag(clflags,"c"))
+    if (getFlag(clflags,"c"))
+    {
+        OUTSTREAM << "Changes in the current version:" << endl;
+        string thechangelog = megacmdchangelog;
+        if (thechangelog.size())
         {
-            OUTSTREAM << "Changes in the current version:" << endl;
-            string thechangelog = megacmdchangelog;
-            if (thechangelog.size())
-            {
-                replaceAll(thechangelog,"\n","\n * ");
-                OUTSTREAM << " * " << thechangelog << endl << endl;
-            }
+            replaceAll(thechangelog,"\n","\n * ");
+            OUTSTREAM << " * " << thechangelog << endl << endl;
         }
-        if (getFlag(clflags,"l"))
-        {
-            OUTSTREAM << "MEGA SDK version: " << MEGA_MAJOR_VERSION << "." << MEGA_MINOR_VERSION << "." << MEGA_MICRO_VERSION << endl;
+    }
+    if (getFlag(clflags,"l"))
+    {
+        OUTSTREAM << "MEGA SDK version: " << MEGA_MAJOR_VERSION << "." << MEGA_MINOR_VERSION << "." << MEGA_MICRO_VERSION << endl;
 
-            OUTSTREAM << "MEGA SDK Credits: https://github.com/meganz/sdk/blob/master/CREDITS.md" << endl;
-            OUTSTREAM << "MEGA SDK License: https://github.com/meganz/sdk/blob/master/LICENSE" << endl;
-            OUTSTREAM << "MEGAcmd License: https://github.com/meganz/megacmd/blob/master/LICENSE" << endl;
-            OUTSTREAM << "MEGA Terms: https://mega.nz/terms" << endl;
-            OUTSTREAM << "MEGA General Data Protection Regulation Disclosure: https://mega.nz/gdpr" << endl;
+        OUTSTREAM << "MEGA SDK Credits: https://github.com/meganz/sdk/blob/master/CREDITS.md" << endl;
+        OUTSTREAM << "MEGA SDK License: https://github.com/meganz/sdk/blob/master/LICENSE" << endl;
+        OUTSTREAM << "MEGAcmd License: https://github.com/meganz/megacmd/blob/master/LICENSE" << endl;
+        OUTSTREAM << "MEGA Terms: https://mega.nz/terms" << endl;
+        OUTSTREAM << "MEGA General Data Protection Regulation Disclosure: https://mega.nz/gdpr" << endl;
 
-            OUTSTREAM << "Features enabled:" << endl;
+        OUTSTREAM << "Features enabled:" << endl;
 
 #ifdef USE_CRYPTOPP
-            OUTSTREAM << "* CryptoPP" << endl;
+        OUTSTREAM << "* CryptoPP" << endl;
 #endif
 
 #ifdef USE_SQLITE
-          OUTSTREAM << "* SQLite" << endl;
+      OUTSTREAM << "* SQLite" << endl;
 #endif
 
 #ifdef USE_BDB
-            OUTSTREAM << "* Berkeley DB" << endl;
+        OUTSTREAM << "* Berkeley DB" << endl;
 #endif
 
 #ifdef USE_INOTIFY
-           OUTSTREAM << "* inotify" << endl;
+       OUTSTREAM << "* inotify" << endl;
 #endif
 
 #ifdef HAVE_FDOPENDIR
-           OUTSTREAM << "* fdopendir" << endl;
+       OUTSTREAM << "* fdopendir" << endl;
 #endif
 
 #ifdef HAVE_SENDFILE
-            OUTSTREAM << "* sendfile" << endl;
+        OUTSTREAM << "* sendfile" << endl;
 #endif
 
 #ifdef _LARGE_FILES
-           OUTSTREAM << "* _LARGE_FILES" << endl;
+       OUTSTREAM << "* _LARGE_FILES" << endl;
 #endif
 
 #ifdef USE_FREEIMAGE
-            OUTSTREAM << "* FreeImage" << endl;
+        OUTSTREAM << "* FreeImage" << endl;
 #endif
 
 #ifdef USE_PCRE
-            OUTSTREAM << "* PCRE" << endl;
+        OUTSTREAM << "* PCRE" << endl;
 #endif
 
 #ifdef ENABLE_SYNC
-           OUTSTREAM << "* sync subsystem" << endl;
+       OUTSTREAM << "* sync subsystem" << endl;
 #endif
-        }
-        return;
     }
-    else if (words[0] == "masterkey")
+    return;
+}
+
+void MegaCmdExecuter::executeMasterkey(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
     {
-        if (!api->isFilesystemAvailable())
-        {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
-        }
-        OUTSTREAM << api->exportMasterKey() << endl;
-        api->masterKeyExported(); //we do not wait for this to end
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
     }
-    else if (words[0] == "showpcr")
+    OUTSTREAM << api->exportMasterKey() << endl;
+    api->masterKeyExported(); //we do not wait for this to end
+}
+
+void MegaCmdExecuter::executeShowpcr(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    if (!api->isFilesystemAvailable())
     {
-        if (!api->isFilesystemAvailable())
-        {
-            setCurrentOutCode(MCMD_NOTLOGGEDIN);
-            LOG_err << "Not logged in.";
-            return;
-        }
-        bool incoming = getFlag(clflags, "in");
-        bool outgoing = getFlag(clflags, "out");
+        setCurrentOutCode(MCMD_NOTLOGGEDIN);
+        LOG_err << "Not logged in.";
+        return;
+    }
+    bool incoming = getFlag(clflags, "in");
+    bool outgoing = getFlag(clflags, "out");
 
-        if (!incoming && !outgoing)
-        {
-            incoming = true;
-            outgoing = true;
-        }
+    if (!incoming && !outgoing)
+    {
+        incoming = true;
+        outgoing = true;
+    }
 
-        if (outgoing)
+    if (outgoing)
+    {
+        MegaContactRequestList *ocrl = api->getOutgoingContactRequests();
+        if (ocrl)
         {
-            MegaContactRequestList *ocrl = api->getOutgoingContactRequests();
-            if (ocrl)
+            if (ocrl->size())
             {
-                if (ocrl->size())
-                {
-                    OUTSTREAM << "Outgoing PCRs:" << endl;
-                }
-                for (int i = 0; i < ocrl->size(); i++)
-                {
-                    MegaContactRequest * cr = ocrl->get(i);
-                    OUTSTREAM << " " << getLeftAlignedStr(cr->getTargetEmail(),22);
-
-                    char * sid = api->userHandleToBase64(cr->getHandle());
+                OUTSTREAM << "Outgoing PCRs:" << endl;
+            }
+            for (int i = 0; i < ocrl->size(); i++)
+            {
+                MegaContactRequest * cr = ocrl->get(i);
+                OUTSTREAM << " " << getLeftAlignedStr(cr->getTargetEmail(),22);
 
-                    OUTSTREAM << "\t (id: " << sid << ", creation: " << getReadableTime(cr->getCreationTime(), getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")))
-                              << ", modification: " << getReadableTime(cr->getModificationTime(), getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822"))) << ")";
+                char * sid = api->userHandleToBase64(cr->getHandle());
 
-                    delete[] sid;
-                    OUTSTREAM << endl;
-                }
+                OUTSTREAM << "\t (id: " << sid << ", creation: " << getReadableTime(cr->getCreationTime(), getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")))
+                          << ", modification: " << getReadableTime(cr->getModificationTime(), getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822"))) << ")";
 
-                delete ocrl;
+                delete[] sid;
+                OUTSTREAM << endl;
             }
+
+            delete ocrl;
         }
+    }
 
-        if (incoming)
+    if (incoming)
+    {
+        MegaContactRequestList *icrl = api->getIncomingContactRequests();
+        if (icrl)
         {
-            MegaContactRequestList *icrl = api->getIncomingContactRequests();
-            if (icrl)
+            if (icrl->size())
             {
-                if (icrl->size())
-                {
-                    OUTSTREAM << "Incoming PCRs:" << endl;
-                }
-
-                for (int i = 0; i < icrl->size(); i++)
-                {
-                    MegaContactRequest * cr = icrl->get(i);
-                    OUTSTREAM << " " << getLeftAlignedStr(cr->getSourceEmail(), 22);
+                OUTSTREAM << "Incoming PCRs:" << endl;
+            }
 
-                    MegaHandle id = cr->getHandle();
-                    char sid[12];
-                    Base64::btoa((unsigned char*)&( id ), sizeof( id ), sid);
+            for (int i = 0; i < icrl->size(); i++)
+            {
+                MegaContactRequest * cr = icrl->get(i);
+                OUTSTREAM << " " << getLeftAlignedStr(cr->getSourceEmail(), 22);
 
-                    OUTSTREAM << "\t (id: " << sid << ", creation: " << getReadableTime(cr->getCreationTime(), getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")))
-                              << ", modification: " << getReadableTime(cr->getModificationTime(), getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822"))) << ")";
-                    if (cr->getSourceMessage())
-                    {
-                        OUTSTREAM << endl << "\t" << "Invitation message: " << cr->getSourceMessage();
-                    }
+                MegaHandle id = cr->getHandle();
+                char sid[12];
+                Base64::btoa((unsigned char*)&( id ), sizeof( id ), sid);
 
-                    OUTSTREAM << endl;
+                OUTSTREAM << "\t (id: " << sid << ", creation: " << getReadableTime(cr->getCreationTime(), getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822")))
+                          << ", modification: " << getReadableTime(cr->getModificationTime(), getTimeFormatFromSTR(getOption(cloptions, "time-format","RFC2822"))) << ")";
+                if (cr->getSourceMessage())
+                {
+                    OUTSTREAM << endl << "\t" << "Invitation message: " << cr->getSourceMessage();
                 }
 
-                delete icrl;
+                OUTSTREAM << endl;
             }
+
+            delete icrl;
         }
+    }
+    return;
+}
+
+void MegaCmdExecuter::executeKillsession(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    bool all = getFlag(clflags, "a");
+
+    if ((words.size() <= 1 && !all) || (all && words.size() > 1))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        LOG_err << "      " << getUsageStr("killsession");
         return;
     }
-    else if (words[0] == "killsession")
+    string thesession;
+    MegaHandle thehandle = UNDEF;
+
+    if (all)
     {
-        bool all = getFlag(clflags, "a");
+        // Kill all sessions (except current)
+        words.push_back("all");
+    }
 
-        if ((words.size() <= 1 && !all) || (all && words.size() > 1))
+    for (unsigned int i = 1; i < words.size() ; i++)
+    {
+        thesession = words[i];
+        if (thesession == "all")
         {
-            setCurrentOutCode(MCMD_EARGS);
-            LOG_err << "      " << getUsageStr("killsession");
-            return;
+            thehandle = INVALID_HANDLE;
         }
-        string thesession;
-        MegaHandle thehandle = UNDEF;
-
-        if (all)
+        else
         {
-            // Kill all sessions (except current)
-            words.push_back("all");
+            thehandle = api->base64ToUserHandle(thesession.c_str());
         }
 
-        for (unsigned int i = 1; i < words.size() ; i++)
+
+        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+        api->killSession(thehandle, megaCmdListener);
+        megaCmdListener->wait();
+        if (checkNoErrors(megaCmdListener->getError(), "kill session " + thesession + ". Maybe the session was not valid."))
         {
-            thesession = words[i];
-            if (thesession == "all")
+            sandboxCMD->accountDetails.invalidate(); // for whoami -l not to list it any longer
+            if (thesession != "all")
             {
-                thehandle = INVALID_HANDLE;
+                OUTSTREAM << "Session " << thesession << " killed successfully" << endl;
             }
             else
             {
-                thehandle = api->base64ToUserHandle(thesession.c_str());
+                OUTSTREAM << "All sessions killed successfully" << endl;
             }
+        }
 
+        delete megaCmdListener;
+    }
 
-            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-            api->killSession(thehandle, megaCmdListener);
-            megaCmdListener->wait();
-            if (checkNoErrors(megaCmdListener->getError(), "kill session " + thesession + ". Maybe the session was not valid."))
+    return;
+}
+
+void MegaCmdExecuter::executeTransfers(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    bool showcompleted = getFlag(clflags, "show-completed");
+    bool onlycompleted = getFlag(clflags, "only-completed");
+    bool onlyuploads = getFlag(clflags, "only-uploads");
+    bool onlydownloads = getFlag(clflags, "only-downloads");
+    bool showsyncs = getFlag(clflags, "show-syncs");
+    bool printsummary = getFlag(clflags, "summary");
+
+    MegaCmdOutputFormat outputFormat;
+    if (!getOutputFormat(cloptions, &outputFormat))
+    {
+        setCurrentOutCode(MCMD_EARGS);
+        return;
+    }
+    bool ndjson = outputFormat == MCMDOUTPUT_NDJSON;
+
+    int PATHSIZE = getintOption(cloptions,"path-display-size");
+    if (!PATHSIZE)
+    {
+        // get screen size for output purposes
+        unsigned int width = getNumberOfCols(75);
+        PATHSIZE = min(60,int((width-46)/2));
+    }
+    PATHSIZE = max(0, PATHSIZE);
+
+    string policy = getOption(cloptions, "policy", "");
+    if (policy.size())
+    {
+        TransferQueueScheduler::Policy p;
+        if (!TransferQueueScheduler::parsePolicy(policy, p))
+        {
+            setCurrentOutCode(MCMD_EARGS);
+            LOG_err << "Invalid policy: " << policy << ". Use fifo, shortest-first or fair-share";
+            return;
+        }
+        ConfigurationManager::savePropertyValue("transfer_queue_policy", policy);
+        OUTSTREAM << "Queued transfers will start in " << policy << " order" << endl;
+        return;
+    }
+
+    if (getOption(cloptions, "priority", "").size() || getOption(cloptions, "deadline", "").size())
+    {
+        int priority;
+        m_time_t deadline;
+        if (!getTransferPriority(cloptions, false, &priority, &deadline))
+        {
+            return;
+        }
+        if (words.size() < 2)
+        {
+            setCurrentOutCode(MCMD_EARGS);
+            LOG_err << "      " << getUsageStr("transfers");
+            return;
+        }
+        for (unsigned int i = 1; i < words.size(); i++)
+        {
+            std::unique_ptr<MegaTransfer> transfer(api->getTransferByTag(toInteger(words[i], -1)));
+            if (transfer)
             {
-                if (thesession != "all")
-                {
-                    OUTSTREAM << "Session " << thesession << " killed successfully" << endl;
-                }
-                else
+                sandboxCMD->transferQueue.setPriority(transfer.get(), priority, deadline);
+                OUTSTREAM << "Transfer " << words[i] << " queued with priority " << priority;
+                if (deadline)
                 {
-                    OUTSTREAM << "All sessions killed successfully" << endl;
+                    OUTSTREAM << " and deadline " << getReadableTime(deadline);
                 }
+                OUTSTREAM << endl;
+            }
+            else
+            {
+                LOG_err << "Could not find transfer with tag: " << words[i];
+                setCurrentOutCode(MCMD_NOTFOUND);
             }
-
-            delete megaCmdListener;
         }
-
         return;
     }
-    else if (words[0] == "transfers")
+
+    if (getFlag(clflags, "queue"))
     {
-        bool showcompleted = getFlag(clflags, "show-completed");
-        bool onlycompleted = getFlag(clflags, "only-completed");
-        bool onlyuploads = getFlag(clflags, "only-uploads");
-        bool onlydownloads = getFlag(clflags, "only-downloads");
-        bool showsyncs = getFlag(clflags, "show-syncs");
-        bool printsummary = getFlag(clflags, "summary");
+        sandboxCMD->transferQueue.reorder(api, true); // to know about the background transfers as well
+        vector<TransferQueueScheduler::QueuedTransfer> queue = sandboxCMD->transferQueue.getTransfers(showcompleted);
+        auto waitToText = [](long long ms)
+        {
+            return ms < 1000 ? SSTR(ms << " ms") : secondsToText(ms / 1000);
+        };
+        m_time_t now = m_time();
+
+        if (!ndjson)
+        {
+            OUTSTREAM << "Policy: " << TransferQueueScheduler::policyToString(TransferQueueScheduler::getPolicy()) << endl;
+            if (queue.size())
+            {
+                OUTSTREAM << getFixLengthString("TAG", 8) << getFixLengthString("TYPE", 10) << getFixLengthString("CLIENT", 8)
+                          << getFixLengthString("PRIORITY", 10) << getFixLengthString("DEADLINE IN", 14)
+                          << getFixLengthString("SIZE", 12, ' ', true) << getFixLengthString("WAITED", 14, ' ', true) << "  STATE" << endl;
+            }
+        }
+        for (auto &t : queue)
+        {
+            if ((onlyuploads && t.type != MegaTransfer::TYPE_UPLOAD) || (onlydownloads && t.type != MegaTransfer::TYPE_DOWNLOAD))
+            {
+                continue;
+            }
+            string state = t.finished ? "finished" : (t.started ? "started" : "queued");
+            string type = t.type == MegaTransfer::TYPE_UPLOAD ? "upload" : "download";
+            if (ndjson)
+            {
+                NdjsonLine line;
+                line.addNumber("tag", t.tag).addString("type", type).addNumber("client", t.clientID).addNumber("priority", t.priority)
+                        .addNumber("deadline", t.deadline).addNumber("size", t.size).addNumber("wait_ms", t.waitMs).addString("state", state);
+                OUTSTREAM << line.str();
+                continue;
+            }
+            string deadline = "-";
+            if (t.deadline)
+            {
+                deadline = t.deadline > now ? secondsToText(t.deadline - now) : string("overdue");
+            }
+            OUTSTREAM << getFixLengthString(SSTR(t.tag), 8) << getFixLengthString(type, 10)
+                      << getFixLengthString(t.clientID == -1 ? "-" : SSTR(t.clientID), 8)
+                      << getFixLengthString(SSTR(t.priority), 10) << getFixLengthString(deadline, 14)
+                      << getFixLengthString(sizeToText(t.size, false), 12, ' ', true)
+                      << getFixLengthString(waitToText(t.waitMs), 14, ' ', true) << "  " << state << endl;
+        }
 
-        int PATHSIZE = getintOption(cloptions,"path-display-size");
-        if (!PATHSIZE)
+        if (!ndjson)
         {
-            // get screen size for output purposes
-            unsigned int width = getNumberOfCols(75);
-            PATHSIZE = min(60,int((width-46)/2));
+            unsigned long long count, moved;
+            long long averageMs, maxMs;
+            sandboxCMD->transferQueue.getWaitStats(&count, &averageMs, &maxMs, &moved);
+            OUTSTREAM << count << " transfers started after waiting " << waitToText(averageMs) << " on average (" << waitToText(maxMs)
+                      << " at most). " << moved << " queued transfers moved" << endl;
         }
-        PATHSIZE = max(0, PATHSIZE);
+        return;
+    }
 
-        if (getFlag(clflags,"c"))
+    if (getFlag(clflags,"c"))
+    {
+        if (getFlag(clflags,"a"))
         {
-            if (getFlag(clflags,"a"))
+            if (onlydownloads || (!onlyuploads && !onlydownloads) )
             {
-                if (onlydownloads || (!onlyuploads && !onlydownloads) )
-                {
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->cancelTransfers(MegaTransfer::TYPE_DOWNLOAD, megaCmdListener);
-                    megaCmdListener->wait();
-                    if (checkNoErrors(megaCmdListener->getError(), "cancel all download transfers"))
-                    {
-                        OUTSTREAM << "Download transfers cancelled successfully." << endl;
-                    }
-                    delete megaCmdListener;
-                }
-                if (onlyuploads || (!onlyuploads && !onlydownloads) )
+                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                api->cancelTransfers(MegaTransfer::TYPE_DOWNLOAD, megaCmdListener);
+                megaCmdListener->wait();
+                if (checkNoErrors(megaCmdListener->getError(), "cancel all download transfers"))
                 {
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->cancelTransfers(MegaTransfer::TYPE_UPLOAD, megaCmdListener);
-                    megaCmdListener->wait();
-                    if (checkNoErrors(megaCmdListener->getError(), "cancel all upload transfers"))
-                    {
-                        OUTSTREAM << "Upload transfers cancelled successfully." << endl;
-                    }
-                    delete megaCmdListener;
+                    OUTSTREAM << "Download transfers cancelled successfully." << endl;
                 }
-
+                delete megaCmdListener;
             }
-            else
+            if (onlyuploads || (!onlyuploads && !onlydownloads) )
             {
-                if (words.size() < 2)
+                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                api->cancelTransfers(MegaTransfer::TYPE_UPLOAD, megaCmdListener);
+                megaCmdListener->wait();
+                if (checkNoErrors(megaCmdListener->getError(), "cancel all upload transfers"))
                 {
-                    setCurrentOutCode(MCMD_EARGS);
-                    LOG_err << "      " << getUsageStr("transfers");
-                    return;
+                    OUTSTREAM << "Upload transfers cancelled successfully." << endl;
                 }
-                for (unsigned int i = 1; i < words.size(); i++)
-                {
-                    MegaTransfer *transfer = api->getTransferByTag(toInteger(words[i],-1));
-                    if (transfer)
-                    {
-                        if (transfer->isSyncTransfer())
-                        {
-                            LOG_err << "Unable to cancel transfer with tag " << words[i] << ". Sync transfers cannot be cancelled";
-                            setCurrentOutCode(MCMD_INVALIDTYPE);
-                        }
-                        else
-                        {
-                            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                            api->cancelTransfer(transfer, megaCmdListener);
-                            megaCmdListener->wait();
-                            if (checkNoErrors(megaCmdListener->getError(), "cancel transfer with tag " + words[i] + "."))
-                            {
-                                OUTSTREAM << "Transfer " << words[i]<< " cancelled successfully." << endl;
-                            }
-                            delete megaCmdListener;
-                        }
+                delete megaCmdListener;
+            }
+
+        }
+        else
+        {
+            if (words.size() < 2)
+            {
+                setCurrentOutCode(MCMD_EARGS);
+                LOG_err << "      " << getUsageStr("transfers");
+                return;
+            }
+            for (unsigned int i = 1; i < words.size(); i++)
+            {
+                MegaTransfer *transfer = api->getTransferByTag(toInteger(words[i],-1));
+                if (transfer)
+                {
+                    if (transfer->isSyncTransfer())
+                    {
+                        LOG_err << "Unable to cancel transfer with tag " << words[i] << ". Sync transfers cannot be cancelled";
+                        setCurrentOutCode(MCMD_INVALIDTYPE);
                     }
                     else
                     {
-                        LOG_err << "Coul not find transfer with tag: " << words[i];
-                        setCurrentOutCode(MCMD_NOTFOUND);
+                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                        api->cancelTransfer(transfer, megaCmdListener);
+                        megaCmdListener->wait();
+                        if (checkNoErrors(megaCmdListener->getError(), "cancel transfer with tag " + words[i] + "."))
+                        {
+                            OUTSTREAM << "Transfer " << words[i]<< " cancelled successfully." << endl;
+                        }
+                        delete megaCmdListener;
                     }
                 }
+                else
+                {
+                    LOG_err << "Coul not find transfer with tag: " << words[i];
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                }
             }
-
-            return;
         }
 
-        if (getFlag(clflags,"p") || getFlag(clflags,"r"))
+        return;
+    }
+
+    if (getFlag(clflags,"p") || getFlag(clflags,"r"))
+    {
+        if (getFlag(clflags,"a"))
         {
-            if (getFlag(clflags,"a"))
+            if (onlydownloads || (!onlyuploads && !onlydownloads) )
             {
-                if (onlydownloads || (!onlyuploads && !onlydownloads) )
+                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                api->pauseTransfers(getFlag(clflags,"p"), MegaTransfer::TYPE_DOWNLOAD, megaCmdListener);
+                megaCmdListener->wait();
+                if (checkNoErrors(megaCmdListener->getError(), (getFlag(clflags,"p")?"pause all download transfers":"resume all download transfers")))
                 {
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->pauseTransfers(getFlag(clflags,"p"), MegaTransfer::TYPE_DOWNLOAD, megaCmdListener);
-                    megaCmdListener->wait();
-                    if (checkNoErrors(megaCmdListener->getError(), (getFlag(clflags,"p")?"pause all download transfers":"resume all download transfers")))
-                    {
-                        OUTSTREAM << "Download transfers "<< (getFlag(clflags,"p")?"pause":"resume") << "d successfully." << endl;
-                    }
-                    delete megaCmdListener;
+                    OUTSTREAM << "Download transfers "<< (getFlag(clflags,"p")?"pause":"resume") << "d successfully." << endl;
                 }
-                if (onlyuploads || (!onlyuploads && !onlydownloads) )
+                delete megaCmdListener;
+            }
+            if (onlyuploads || (!onlyuploads && !onlydownloads) )
+            {
+                MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                api->pauseTransfers(getFlag(clflags,"p"), MegaTransfer::TYPE_UPLOAD, megaCmdListener);
+                megaCmdListener->wait();
+                if (checkNoErrors(megaCmdListener->getError(), (getFlag(clflags,"p")?"pause all download transfers":"resume all download transfers")))
                 {
-                    MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                    api->pauseTransfers(getFlag(clflags,"p"), MegaTransfer::TYPE_UPLOAD, megaCmdListener);
-                    megaCmdListener->wait();
-                    if (checkNoErrors(megaCmdListener->getError(), (getFlag(clflags,"p")?"pause all download transfers":"resume all download transfers")))
-                    {
-                        OUTSTREAM << "Upload transfers "<< (getFlag(clflags,"p")?"pause":"resume") << "d successfully." << endl;
-                    }
-                    delete megaCmdListener;
+                    OUTSTREAM << "Upload transfers "<< (getFlag(clflags,"p")?"pause":"resume") << "d successfully." << endl;
                 }
+                delete megaCmdListener;
+            }
 
+        }
+        else
+        {
+            if (words.size() < 2)
+            {
+                setCurrentOutCode(MCMD_EARGS);
+                LOG_err << "      " << getUsageStr("transfers");
+                return;
             }
-            else
+            for (unsigned int i = 1; i < words.size(); i++)
             {
-                if (words.size() < 2)
-                {
-                    setCurrentOutCode(MCMD_EARGS);
-                    LOG_err << "      " << getUsageStr("transfers");
-                    return;
-                }
-                for (unsigned int i = 1; i < words.size(); i++)
+                MegaTransfer *transfer = api->getTransferByTag(toInteger(words[i],-1));
+                if (transfer)
                 {
-                    MegaTransfer *transfer = api->getTransferByTag(toInteger(words[i],-1));
-                    if (transfer)
+                    if (transfer->isSyncTransfer())
                     {
-                        if (transfer->isSyncTransfer())
-                        {
-                            LOG_err << "Unable to "<< (getFlag(clflags,"p")?"pause":"resume") << " transfer with tag " << words[i] << ". Sync transfers cannot be "<< (getFlag(clflags,"p")?"pause":"resume") << "d";
-                            setCurrentOutCode(MCMD_INVALIDTYPE);
-                        }
-                        else
-                        {
-                            MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
-                            api->pauseTransfer(transfer, getFlag(clflags,"p"), megaCmdListener);
-                            megaCmdListener->wait();
-                            if (checkNoErrors(megaCmdListener->getError(), (getFlag(clflags,"p")?"pause transfer with tag ":"resume transfer with tag ") + words[i] + "."))
-                            {
-                                OUTSTREAM << "Transfer " << words[i]<< " "<< (getFlag(clflags,"p")?"pause":"resume") << "d successfully." << endl;
-                            }
-                            delete megaCmdListener;
-                        }
+                        LOG_err << "Unable to "<< (getFlag(clflags,"p")?"pause":"resume") << " transfer with tag " << words[i] << ". Sync transfers cannot be "<< (getFlag(clflags,"p")?"pause":"resume") << "d";
+                        setCurrentOutCode(MCMD_INVALIDTYPE);
                     }
                     else
                     {
-                        LOG_err << "Coul not find transfer with tag: " << words[i];
-                        setCurrentOutCode(MCMD_NOTFOUND);
+                        MegaCmdListener *megaCmdListener = new MegaCmdListener(NULL);
+                        api->pauseTransfer(transfer, getFlag(clflags,"p"), megaCmdListener);
+                        megaCmdListener->wait();
+                        if (checkNoErrors(megaCmdListener->getError(), (getFlag(clflags,"p")?"pause transfer with tag ":"resume transfer with tag ") + words[i] + "."))
+                        {
+                            sandboxCMD->bandwidthScheduler.onUserPause(transfer->getTag());
+                            OUTSTREAM << "Transfer " << words[i]<< " "<< (getFlag(clflags,"p")?"pause":"resume") << "d successfully." << endl;
+                        }
+                        delete megaCmdListener;
                     }
                 }
+                else
+                {
+                    LOG_err << "Coul not find transfer with tag: " << words[i];
+                    setCurrentOutCode(MCMD_NOTFOUND);
+                }
             }
-
-            return;
         }
 
-        //show transfers
-        MegaTransferData* transferdata = api->getTransferData();
+        return;
+    }
 
-        int ndownloads = transferdata->getNumDownloads();
-        int nuploads = transferdata->getNumUploads();
+    //show transfers
+    MegaTransferData* transferdata = api->getTransferData();
 
-        if (printsummary)
+    int ndownloads = transferdata->getNumDownloads();
+    int nuploads = transferdata->getNumUploads();
+
+    if (printsummary)
+    {
+        long long transferredDownload = 0, transferredUpload = 0, totalDownload = 0, totalUpload = 0;
+        for (int i = 0; i< ndownloads; i++)
         {
-            long long transferredDownload = 0, transferredUpload = 0, totalDownload = 0, totalUpload = 0;
-            for (int i = 0; i< ndownloads; i++)
+            MegaTransfer *t = api->getTransferByTag(transferdata->getDownloadTag(i));
             {
-                MegaTransfer *t = api->getTransferByTag(transferdata->getDownloadTag(i));
+                if (t)
                 {
-                    if (t)
-                    {
-                        transferredDownload += t->getTransferredBytes();
-                        totalDownload += t->getTotalBytes();
-                        delete t;
-                    }
+                    transferredDownload += t->getTransferredBytes();
+                    totalDownload += t->getTotalBytes();
+                    delete t;
                 }
             }
-            for (int i = 0; i< nuploads; i++)
+        }
+        for (int i = 0; i< nuploads; i++)
+        {
+            MegaTransfer *t = api->getTransferByTag(transferdata->getUploadTag(i));
             {
-                MegaTransfer *t = api->getTransferByTag(transferdata->getUploadTag(i));
+                if (t)
                 {
-                    if (t)
-                    {
-                        transferredUpload += t->getTransferredBytes();
-                        totalUpload += t->getTotalBytes();
-                        delete t;
-                    }
+                    transferredUpload += t->getTransferredBytes();
+                    totalUpload += t->getTotalBytes();
+                    delete t;
                 }
             }
+        }
 
-            float percentDownload = !totalDownload?0:float(transferredDownload*1.0/totalDownload);
-            float percentUpload = !totalUpload?0:float(transferredUpload*1.0/totalUpload);
-
-            OUTSTREAM << getFixLengthString("NUM DOWNLOADS", 16, ' ', true);
-            OUTSTREAM << getFixLengthString("DOWNLOADED", 12, ' ', true);
-            OUTSTREAM << getFixLengthString("TOTAL", 12, ' ', true);
-            OUTSTREAM << getFixLengthString("%   ", 8, ' ', true);
-            OUTSTREAM << "     ";
-            OUTSTREAM << getFixLengthString("NUM UPLOADS", 16, ' ', true);
-            OUTSTREAM << getFixLengthString("UPLOADED", 12, ' ', true);
-            OUTSTREAM << getFixLengthString("TOTAL", 12, ' ', true);
-            OUTSTREAM << getFixLengthString("%   ", 8, ' ', true);
-            OUTSTREAM << endl;
-
-            OUTSTREAM << getFixLengthString(SSTR(ndownloads), 16, ' ', true);
-            OUTSTREAM << getFixLengthString(sizeToText(transferredDownload), 12, ' ', true);
-            OUTSTREAM << getFixLengthString(sizeToText(totalDownload), 12, ' ', true);
-            OUTSTREAM << getFixLengthString(percentageToText(percentDownload),8,' ',true);
-
-            OUTSTREAM << "     ";
-            OUTSTREAM << getFixLengthString(SSTR(nuploads), 16, ' ', true);
-            OUTSTREAM << getFixLengthString(sizeToText(transferredUpload), 12, ' ', true);
-            OUTSTREAM << getFixLengthString(sizeToText(totalUpload), 12, ' ', true);
-            OUTSTREAM << getFixLengthString(percentageToText(percentUpload),8,' ',true);
-            OUTSTREAM << endl;
+        if (ndjson)
+        {
+            NdjsonLine downloads, uploads;
+            downloads.addString("type", "download").addNumber("count", ndownloads).addNumber("size", totalDownload).addNumber("transferred", transferredDownload);
+            uploads.addString("type", "upload").addNumber("count", nuploads).addNumber("size", totalUpload).addNumber("transferred", transferredUpload);
+            OUTSTREAM << downloads.str();
+            OUTSTREAM << uploads.str();
             delete transferdata;
             return;
         }
 
+        float percentDownload = !totalDownload?0:float(transferredDownload*1.0/totalDownload);
+        float percentUpload = !totalUpload?0:float(transferredUpload*1.0/totalUpload);
 
+        OUTSTREAM << getFixLengthString("NUM DOWNLOADS", 16, ' ', true);
+        OUTSTREAM << getFixLengthString("DOWNLOADED", 12, ' ', true);
+        OUTSTREAM << getFixLengthString("TOTAL", 12, ' ', true);
+        OUTSTREAM << getFixLengthString("%   ", 8, ' ', true);
+        OUTSTREAM << "     ";
+        OUTSTREAM << getFixLengthString("NUM UPLOADS", 16, ' ', true);
+        OUTSTREAM << getFixLengthString("UPLOADED", 12, ' ', true);
+        OUTSTREAM << getFixLengthString("TOTAL", 12, ' ', true);
+        OUTSTREAM << getFixLengthString("%   ", 8, ' ', true);
+        OUTSTREAM << endl;
 
-        int limit = getintOption(cloptions, "limit", min(10,ndownloads+nuploads+(int)globalTransferListener->completedTransfers.size()));
+        OUTSTREAM << getFixLengthString(SSTR(ndownloads), 16, ' ', true);
+        OUTSTREAM << getFixLengthString(sizeToText(transferredDownload), 12, ' ', true);
+        OUTSTREAM << getFixLengthString(sizeToText(totalDownload), 12, ' ', true);
+        OUTSTREAM << getFixLengthString(percentageToText(percentDownload),8,' ',true);
 
-        if (!transferdata)
-        {
-            setCurrentOutCode(MCMD_EUNEXPECTED);
-            LOG_err << "No transferdata.";
-            return;
-        }
+        OUTSTREAM << "     ";
+        OUTSTREAM << getFixLengthString(SSTR(nuploads), 16, ' ', true);
+        OUTSTREAM << getFixLengthString(sizeToText(transferredUpload), 12, ' ', true);
+        OUTSTREAM << getFixLengthString(sizeToText(totalUpload), 12, ' ', true);
+        OUTSTREAM << getFixLengthString(percentageToText(percentUpload),8,' ',true);
+        OUTSTREAM << endl;
+        delete transferdata;
+        return;
+    }
+
+
+
+    int limit = getintOption(cloptions, "limit", min(10,ndownloads+nuploads+(int)globalTransferListener->completedTransfers.size()));
+
+    if (!transferdata)
+    {
+        setCurrentOutCode(MCMD_EUNEXPECTED);
+        LOG_err << "No transferdata.";
+        return;
+    }
 
-        bool downloadpaused = api->areTransfersPaused(MegaTransfer::TYPE_DOWNLOAD);
-        bool uploadpaused = api->areTransfersPaused(MegaTransfer::TYPE_UPLOAD);
+    bool downloadpaused = api->areTransfersPaused(MegaTransfer::TYPE_DOWNLOAD);
+    bool uploadpaused = api->areTransfersPaused(MegaTransfer::TYPE_UPLOAD);
 
-        int indexUpload = 0;
-        int indexDownload = 0;
-        int shown = 0;
+    int indexUpload = 0;
+    int indexDownload = 0;
+    int shown = 0;
 
-        int showndl = 0;
-        int shownup = 0;
-        unsigned int shownCompleted = 0;
+    int showndl = 0;
+    int shownup = 0;
+    unsigned int shownCompleted = 0;
 
-        vector<MegaTransfer *> transfersDLToShow;
-        vector<MegaTransfer *> transfersUPToShow;
-        vector<MegaTransfer *> transfersCompletedToShow;
+    vector<MegaTransfer *> transfersDLToShow;
+    vector<MegaTransfer *> transfersUPToShow;
+    vector<MegaTransfer *> transfersCompletedToShow;
 
-        if (showcompleted)
+    if (showcompleted)
+    {
+        globalTransferListener->completedTransfersMutex.lock();
+        size_t totalcompleted = globalTransferListener->completedTransfers.size();
+        for (size_t i = 0;(i < totalcompleted)
+             && (shownCompleted < totalcompleted)
+             && (shownCompleted < (size_t)(limit+1)); //Note limit+1 to seek for one more to show if there are more to show!
+             i++)
         {
-            globalTransferListener->completedTransfersMutex.lock();
-            size_t totalcompleted = globalTransferListener->completedTransfers.size();
-            for (size_t i = 0;(i < totalcompleted)
-                 && (shownCompleted < totalcompleted)
-                 && (shownCompleted < (size_t)(limit+1)); //Note limit+1 to seek for one more to show if there are more to show!
-                 i++)
+            MegaTransfer *transfer = globalTransferListener->completedTransfers.at(i);
+            if (
+                (
+                        (transfer->getType() == MegaTransfer::TYPE_UPLOAD && (onlyuploads || (!onlyuploads && !onlydownloads) ))
+                    ||  (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD && (onlydownloads || (!onlyuploads && !onlydownloads) ) )
+                )
+                &&  !(!showsyncs && transfer->isSyncTransfer())
+                )
             {
-                MegaTransfer *transfer = globalTransferListener->completedTransfers.at(i);
-                if (
-                    (
-                            (transfer->getType() == MegaTransfer::TYPE_UPLOAD && (onlyuploads || (!onlyuploads && !onlydownloads) ))
-                        ||  (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD && (onlydownloads || (!onlyuploads && !onlydownloads) ) )
-                    )
-                    &&  !(!showsyncs && transfer->isSyncTransfer())
-                    )
-                {
 
-                    transfersCompletedToShow.push_back(transfer);
-                    shownCompleted++;
-                }
+                transfersCompletedToShow.push_back(transfer);
+                shownCompleted++;
             }
-            globalTransferListener->completedTransfersMutex.unlock();
         }
+        globalTransferListener->completedTransfersMutex.unlock();
+    }
 
-        shown += shownCompleted;
+    shown += shownCompleted;
 
-        while (!onlycompleted)
+    while (!onlycompleted)
+    {
+        //MegaTransfer *transfer = transferdata->get(i);
+        MegaTransfer *transfer = NULL;
+        //Next transfer to show
+        if (onlyuploads && !onlydownloads && indexUpload < transferdata->getNumUploads()) //Only uploads
+        {
+            transfer = api->getTransferByTag(transferdata->getUploadTag(indexUpload++));
+        }
+        else
         {
-            //MegaTransfer *transfer = transferdata->get(i);
-            MegaTransfer *transfer = NULL;
-            //Next transfer to show
-            if (onlyuploads && !onlydownloads && indexUpload < transferdata->getNumUploads()) //Only uploads
+            if ( (!onlydownloads || (onlydownloads && onlyuploads)) //both
+                 && ( (shown >= (limit/2) ) || indexDownload == ndownloads ) // /already chosen half slots for dls or no more dls
+                 && indexUpload < transferdata->getNumUploads()
+                 )
+                //This is not 100 % perfect, it could show with a limit of 10 5 downloads and 3 uploads with more downloads on the queue.
             {
                 transfer = api->getTransferByTag(transferdata->getUploadTag(indexUpload++));
+
             }
-            else
+            else if(indexDownload < ndownloads)
             {
-                if ( (!onlydownloads || (onlydownloads && onlyuploads)) //both
-                     && ( (shown >= (limit/2) ) || indexDownload == ndownloads ) // /already chosen half slots for dls or no more dls
-                     && indexUpload < transferdata->getNumUploads()
-                     )
-                    //This is not 100 % perfect, it could show with a limit of 10 5 downloads and 3 uploads with more downloads on the queue.
-                {
-                    transfer = api->getTransferByTag(transferdata->getUploadTag(indexUpload++));
-
-                }
-                else if(indexDownload < ndownloads)
-                {
-                    transfer =  api->getTransferByTag(transferdata->getDownloadTag(indexDownload++));
-                }
+                transfer =  api->getTransferByTag(transferdata->getDownloadTag(indexDownload++));
             }
+        }
 
-            if (!transfer) break; //finish
+        if (!transfer) break; //finish
 
-            if (
-                    (showcompleted || transfer->getState() != MegaTransfer::STATE_COMPLETED)
-                    &&  !(onlyuploads && transfer->getType() != MegaTransfer::TYPE_UPLOAD && !onlydownloads )
-                    &&  !(onlydownloads && transfer->getType() != MegaTransfer::TYPE_DOWNLOAD && !onlyuploads )
-                    &&  !(!showsyncs && transfer->isSyncTransfer())
-                    &&  (shown < (limit+1)) //Note limit+1 to seek for one more to show if there are more to show!
-                    )
+        if (
+                (showcompleted || transfer->getState() != MegaTransfer::STATE_COMPLETED)
+                &&  !(onlyuploads && transfer->getType() != MegaTransfer::TYPE_UPLOAD && !onlydownloads )
+                &&  !(onlydownloads && transfer->getType() != MegaTransfer::TYPE_DOWNLOAD && !onlyuploads )
+                &&  !(!showsyncs && transfer->isSyncTransfer())
+                &&  (shown < (limit+1)) //Note limit+1 to seek for one more to show if there are more to show!
+                )
+        {
+            shown++;
+            if (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)
             {
-                shown++;
-                if (transfer->getType() == MegaTransfer::TYPE_DOWNLOAD)
-                {
-                    transfersDLToShow.push_back(transfer);
-                    showndl++;
-                }
-                else
-                {
-                    transfersUPToShow.push_back(transfer);
-                    shownup++;
-                }
+                transfersDLToShow.push_back(transfer);
+                showndl++;
             }
             else
             {
-                delete transfer;
-            }
-            if (shown>limit || transfer == NULL) //we-re done
-            {
-                break;
+                transfersUPToShow.push_back(transfer);
+                shownup++;
             }
         }
+        else
+        {
+            delete transfer;
+        }
+        if (shown>limit || transfer == NULL) //we-re done
+        {
+            break;
+        }
+    }
 
-        delete transferdata;
+    delete transferdata;
 
-        vector<MegaTransfer *>::iterator itCompleted = transfersCompletedToShow.begin();
-        vector<MegaTransfer *>::iterator itDLs = transfersDLToShow.begin();
-        vector<MegaTransfer *>::iterator itUPs = transfersUPToShow.begin();
+    vector<MegaTransfer *>::iterator itCompleted = transfersCompletedToShow.begin();
+    vector<MegaTransfer *>::iterator itDLs = transfersDLToShow.begin();
+    vector<MegaTransfer *>::iterator itUPs = transfersUPToShow.begin();
 
-        ColumnDisplayer cd(getintOption(cloptions,"path-display-size", 0));
-        cd.addHeader("SOURCEPATH", false);
-        cd.addHeader("DESTINYPATH", false);
+    ColumnDisplayer cd(getintOption(cloptions,"path-display-size", 0));
+    cd.addHeader("SOURCEPATH", false);
+    cd.addHeader("DESTINYPATH", false);
 
-        for (unsigned int i=0;i<showndl+shownup+shownCompleted; i++)
+    for (unsigned int i=0;i<showndl+shownup+shownCompleted; i++)
+    {
+        MegaTransfer *transfer = NULL;
+        bool deleteTransfer = true;
+        if (itDLs == transfersDLToShow.end() && itCompleted == transfersCompletedToShow.end())
         {
-            MegaTransfer *transfer = NULL;
-            bool deleteTransfer = true;
-            if (itDLs == transfersDLToShow.end() && itCompleted == transfersCompletedToShow.end())
-            {
-                transfer = (MegaTransfer *) *itUPs;
-                itUPs++;
-            }
-            else if (itCompleted == transfersCompletedToShow.end())
-            {
-                transfer = (MegaTransfer *) *itDLs;
-                itDLs++;
-            }
-            else
+            transfer = (MegaTransfer *) *itUPs;
+            itUPs++;
+        }
+        else if (itCompleted == transfersCompletedToShow.end())
+        {
+            transfer = (MegaTransfer *) *itDLs;
+            itDLs++;
+        }
+        else
+        {
+            transfer = (MegaTransfer *) *itCompleted;
+            itCompleted++;
+            deleteTransfer=false;
+        }
+        if (ndjson)
+        {
+            if (i < (unsigned int)limit)
             {
-                transfer = (MegaTransfer *) *itCompleted;
-                itCompleted++;
-                deleteTransfer=false;
+                printTransferNdjson(transfer);
             }
-            if (i == 0) //first
+            if (deleteTransfer)
             {
-                if (uploadpaused || downloadpaused)
-                {
-                    OUTSTREAM << "            " << (downloadpaused?"DOWNLOADS":"") << ((uploadpaused && downloadpaused)?" AND ":"")
-                              << (uploadpaused?"UPLOADS":"") << " ARE PAUSED " << endl;
-                }
+                delete transfer;
             }
-            if (i==(unsigned int)limit) //we are in the extra one (not to be shown)
+            continue;
+        }
+        if (i == 0) //first
+        {
+            if (uploadpaused || downloadpaused)
             {
-                OUTSTREAM << " ...  Showing first " << limit << " transfers ..." << endl;
-                if (deleteTransfer)
-                {
-                    delete transfer;
-                }
-                break;
+                OUTSTREAM << "            " << (downloadpaused?"DOWNLOADS":"") << ((uploadpaused && downloadpaused)?" AND ":"")
+                          << (uploadpaused?"UPLOADS":"") << " ARE PAUSED " << endl;
             }
-
-            printTransferColumnDisplayer(&cd, transfer);
-
+        }
+        if (i==(unsigned int)limit) //we are in the extra one (not to be shown)
+        {
+            OUTSTREAM << " ...  Showing first " << limit << " transfers ..." << endl;
             if (deleteTransfer)
             {
                 delete transfer;
             }
+            break;
+        }
+
+        printTransferColumnDisplayer(&cd, transfer);
+
+        if (deleteTransfer)
+        {
+            delete transfer;
         }
+    }
+    if (!ndjson)
+    {
         OUTSTRINGSTREAM oss;
         cd.print(oss, getintOption(cloptions, "client-width", getNumberOfCols(75)));
         OUTSTREAM << oss.str();
     }
-    else if (words[0] == "locallogout")
+}
+
+void MegaCmdExecuter::executeLocallogout(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    OUTSTREAM << "Logging out locally..." << endl;
+    cwd = UNDEF;
+    return;
+}
+
+void MegaCmdExecuter::executeProxy(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    bool autoProxy = getFlag(clflags, "auto");
+    bool noneProxy = getFlag(clflags, "none");
+    int proxyType = -1;
+
+
+    string username = getOption(cloptions, "username", "");
+    string password;
+    if (username.size())
+    {
+        password = getOption(cloptions, "password", "");
+        if (!password.size())
+        {
+            password = askforUserResponse("Enter password: ");
+        }
+    }
+
+    string urlProxy;
+    if (words.size() > 1)
+    {
+        proxyType = MegaProxy::PROXY_CUSTOM;
+        urlProxy = words[1];
+    }
+    else if (autoProxy)
     {
-        OUTSTREAM << "Logging out locally..." << endl;
-        cwd = UNDEF;
-        return;
+        proxyType = MegaProxy::PROXY_AUTO;
     }
-    else if (words[0] == "proxy")
+    else if (noneProxy)
     {
-        bool autoProxy = getFlag(clflags, "auto");
-        bool noneProxy = getFlag(clflags, "none");
-        int proxyType = -1;
+        proxyType = MegaProxy::PROXY_NONE;
+    }
+
+    if (proxyType == -1)
+    {
+        int configuredProxyType = ConfigurationManager::getConfigurationValue("proxy_type", -1);
+        auto configuredProxyUrl = ConfigurationManager::getConfigurationSValue("proxy_url");
 
+        auto configuredProxyUsername = ConfigurationManager::getConfigurationSValue("proxy_username");
+        auto configuredProxyPassword = ConfigurationManager::getConfigurationSValue("proxy_password");
 
-        string username = getOption(cloptions, "username", "");
-        string password;
-        if (username.size())
+        if (configuredProxyType == -1)
         {
-            password = getOption(cloptions, "password", "");
-            if (!password.size())
-            {
-                password = askforUserResponse("Enter password: ");
-            }
+            OUTSTREAM << "No proxy configuration found" << endl;
+            return;
         }
-
-        string urlProxy;
-        if (words.size() > 1)
+        if (configuredProxyType == MegaProxy::PROXY_NONE)
         {
-            proxyType = MegaProxy::PROXY_CUSTOM;
-            urlProxy = words[1];
+            OUTSTREAM << "Proxy disabled" << endl;
+            return;
         }
-        else if (autoProxy)
+
+
+        OUTSTREAM << "Proxy configured. ";
+
+        if (configuredProxyType == MegaProxy::PROXY_AUTO)
         {
-            proxyType = MegaProxy::PROXY_AUTO;
+            OUTSTREAM << endl << " Type = AUTO";
         }
-        else if (noneProxy)
+        else
         {
-            proxyType = MegaProxy::PROXY_NONE;
+            OUTSTREAM << endl << " Type = CUSTOM";
         }
 
-        if (proxyType == -1)
+        if (configuredProxyUrl.size())
         {
-            int configuredProxyType = ConfigurationManager::getConfigurationValue("proxy_type", -1);
-            auto configuredProxyUrl = ConfigurationManager::getConfigurationSValue("proxy_url");
-
-            auto configuredProxyUsername = ConfigurationManager::getConfigurationSValue("proxy_username");
-            auto configuredProxyPassword = ConfigurationManager::getConfigurationSValue("proxy_password");
-
-            if (configuredProxyType == -1)
-            {
-                OUTSTREAM << "No proxy configuration found" << endl;
-                return;
-            }
-            if (configuredProxyType == MegaProxy::PROXY_NONE)
-            {
-                OUTSTREAM << "Proxy disabled" << endl;
-                return;
-            }
-
-
-            OUTSTREAM << "Proxy configured. ";
-
-            if (configuredProxyType == MegaProxy::PROXY_AUTO)
-            {
-                OUTSTREAM << endl << " Type = AUTO";
-            }
-            else
-            {
-                OUTSTREAM << endl << " Type = CUSTOM";
-            }
-
-            if (configuredProxyUrl.size())
-            {
-                OUTSTREAM << endl << " URL = " << configuredProxyUrl;
-            }
-            if (configuredProxyUsername.size())
-            {
-                OUTSTREAM << endl << " username = " << configuredProxyUsername;
-            }
-            if (configuredProxyPassword.size())
-            {
-                OUTSTREAM << endl << " password = " << configuredProxyPassword;
-            }
-
-            OUTSTREAM << endl;
+            OUTSTREAM << endl << " URL = " << configuredProxyUrl;
         }
-        else
+        if (configuredProxyUsername.size())
         {
-            setProxy(urlProxy, username, password, proxyType);
+            OUTSTREAM << endl << " username = " << configuredProxyUsername;
+        }
+        if (configuredProxyPassword.size())
+        {
+            OUTSTREAM << endl << " password = " << configuredProxyPassword;
         }
 
+        OUTSTREAM << endl;
     }
     else
     {
-        setCurrentOutCode(MCMD_EARGS);
-        LOG_err << "Invalid command: " << words[0];
+        setProxy(urlProxy, username, password, proxyType);
+    }
+
+}
+
+void MegaCmdExecuter::executeStartup(vector<string> &words, map<string, int> *clflags, map<string, string> *cloptions)
+{
+    OUTSTREAM << "Readiness: " << getStartupReadinessStr() << endl;
+    if (getFlag(clflags, "timings"))
+    {
+        OUTSTREAM << endl;
+        printStartupTimings();
     }
 }
 
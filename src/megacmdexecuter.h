@@ -23,11 +23,85 @@
 #include "megacmdsandbox.h"
 #include "listeners.h"
 
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <unordered_map>
+#include <deque>
+
 namespace megacmd {
 class MegaCmdSandbox;
 class MegaCmdMultiTransferListener;
 class MegaCmdGlobalTransferListener;
 
+/**
+ * @brief Counters of the files found unchanged when transferring with --skip-unchanged
+ */
+struct SkipUnchangedStats
+{
+    long long skippedFiles = 0;
+    long long skippedBytes = 0;
+    long long enqueuedTransfers = 0;
+};
+
+/**
+ * @brief A transfer planned by the --skip-unchanged pass.
+ * comparisonIndex points to the local/remote file pair it depends on (-1 if it is to be transferred regardless)
+ */
+struct PlannedTransfer
+{
+    std::string localPath;
+    mega::MegaHandle handle; // the node to download, or the parent folder to upload into
+    std::string newname;
+    int comparisonIndex;
+};
+
+/**
+ * @brief Versions found by scanVersions among the files directly contained in a folder
+ * (or in a single file, when that is what was scanned)
+ */
+struct FolderVersionsReport
+{
+    mega::MegaHandle folder = mega::INVALID_HANDLE;
+    long long currentSize = 0; // size of the current versions of the files
+    long long reclaimableSize = 0; // size of their previous versions
+    long long nversions = 0; // number of previous versions
+};
+
+struct DiffRecord
+{
+    enum Status { ADDED, REMOVED, CHANGED } status; // from the remote side to the local one
+    std::string path; // relative to the compared folders. Folders end with '/'
+    bool isFolder = false;
+    long long localSize = -1;
+    long long remoteSize = -1;
+};
+
+struct ImportResult
+{
+    int outCode = 0; // MCMD_OK or the error
+    std::string error;
+    mega::MegaHandle handle = mega::INVALID_HANDLE; // of the imported node
+    bool isFolder = false;
+};
+
+/**
+ * @brief A subtree to be walked in the background by prefetch, with its progress
+ */
+struct PrefetchJob
+{
+    std::string path;
+    mega::MegaHandle handle = mega::INVALID_HANDLE;
+    long long blocksUnder = -1; // files up to this size are downloaded into the block cache (-1: none)
+    int clientID = -1;
+    std::atomic<long long> foldersFound{1};
+    std::atomic<long long> foldersVisited{0};
+    std::atomic<long long> files{0};
+    std::atomic<long long> cachedFiles{0};
+    std::atomic<bool> running{false};
+    std::atomic<bool> finished{false};
+};
+
 class MegaCmdExecuter
 {
 private:
@@ -58,6 +132,122 @@ private:
 
     std::string getNodePathString(mega::MegaNode *n);
 
+    LocalFingerprintCache fingerprintCache;
+    std::thread fingerprintVerifierThread;
+    std::mutex fingerprintVerifierMutex;
+    std::condition_variable fingerprintVerifierCV;
+    std::atomic<bool> stopFingerprintVerifier{false};
+
+    LocalBlockCache blockCache;
+
+    std::thread prefetchThread;
+    std::mutex prefetchMutex;
+    std::condition_variable prefetchCV;
+    std::deque<std::shared_ptr<PrefetchJob> > prefetchQueue;
+    std::deque<std::shared_ptr<PrefetchJob> > prefetchJobs; // queued, running and the last ones finished
+    std::atomic<bool> stopPrefetcher{false};
+
+    std::map<std::string, std::unique_ptr<LocalChangeJournal> > backupJournals; // per backed up local folder (NULL if it cannot be journaled)
+    std::mutex backupJournalsMutex;
+
+    void startFingerprintVerifier();
+    void verifyLocalFingerprints();
+    LocalChangeJournal *getBackupChangeJournal(const std::string &localpath);
+
+    std::vector<std::thread> startupStageThreads; // stages run after fetching nodes
+    std::mutex startupStageThreadsMutex;
+    void joinStartupStages();
+#ifdef ENABLE_BACKUPS
+    void restoreBackups(mega::MegaApi *api);
+#endif
+#ifdef HAVE_LIBUV
+    void restoreWebdavServer(mega::MegaApi *api);
+    void restoreFtpServer(mega::MegaApi *api);
+#endif
+
+    void planUpload(const std::string &localPath, mega::MegaNode *parent, const std::string &newname, std::vector<PlannedTransfer> &planned,
+                    std::vector<std::pair<std::string, mega::MegaNode *> > &comparisons);
+    void planDownload(mega::MegaNode *node, const std::string &localPath, std::vector<PlannedTransfer> &planned,
+                      std::vector<std::pair<std::string, mega::MegaNode *> > &comparisons);
+
+    // command handlers, dispatched by executecommand
+    void executeLs(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeFind(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+#if defined(_WIN32) || defined(__APPLE__)
+    void executeUpdate(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+#endif
+    void executeCd(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeRm(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeMv(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeCp(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeDu(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeCat(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeMediainfo(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeGet(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+#ifdef ENABLE_BACKUPS
+    void executeBackup(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+#endif
+    void executePut(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeLog(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executePwd(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeLcd(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeLpwd(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeIpc(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeHttps(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeGraphics(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+#ifndef _WIN32
+    void executePermissions(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+#endif
+    void executeDeleteversions(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeDedup(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeDiff(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeBlockcache(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executePrefetch(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+#ifdef HAVE_LIBUV
+    void executeWebdav(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeFtp(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+#endif
+#ifdef ENABLE_SYNC
+    void executeExclude(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeSync(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+#endif
+    void executeCancel(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeConfirmcancel(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeLogin(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executePsa(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeMount(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeShare(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeUsers(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeMkdir(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeAttr(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeUserattr(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeThumbnail(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executePreview(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeTree(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeDebug(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executePasswd(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeSpeedlimit(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeInvite(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeErrorcode(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeSignup(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeWhoami(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeDf(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeExport(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeImport(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeReload(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeLogout(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeConfirm(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeSession(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeHistory(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeVersion(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeMasterkey(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeShowpcr(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeKillsession(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeTransfers(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeLocallogout(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeProxy(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    void executeStartup(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+
 public:
     bool signingup;
     bool confirming;
@@ -70,6 +260,8 @@ public:
 
     void updateprompt(mega::MegaApi *api = nullptr);
 
+    LocalBlockCache &getBlockCache() { return blockCache; }
+
     // nodes browsing
     void listtrees();
     static bool includeIfIsExported(mega::MegaApi* api, mega::MegaNode * n, void *arg);
@@ -94,6 +286,9 @@ public:
     void dumpNodeSummaryHeader(const char *timeFormat, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
     void dumpNodeSummary(mega::MegaNode* n, const char *timeFormat, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions, bool humanreadable = false, const char* title = NULL);
     void dumpTreeSummary(mega::MegaNode* n, const char *timeFormat, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions, int recurse, bool show_versions, int depth = 0, bool humanreadable = false, std::string pathRelativeTo = "NULL");
+    void dumpNodeNdjson(mega::MegaNode* n, const std::string &path, bool isversion = false);
+    void dumpTreeNdjson(mega::MegaNode* n, int recurse, bool showversions, int depth = 0);
+    void printDuNdjson(mega::MegaNode* n, bool showversionssize);
     mega::MegaContactRequest * getPcrByContact(std::string contactEmail);
     bool TestCanWriteOnContainingFolder(std::string *path);
     std::string getDisplayPath(std::string givenPath, mega::MegaNode* n);
@@ -104,20 +299,40 @@ public:
     void dumpListOfPendingShares(mega::MegaNode* n, const char *timeFormat, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions, std::string givenPath);
     std::string getCurrentPath();
     long long getVersionsSize(mega::MegaNode* n);
+    void walkTreeInParallel(mega::MegaNode* n, int parallelism, std::function<void(mega::MegaNode *, mega::MegaNodeList *)> visitFolder,
+                            std::function<void()> onFolderVisited = nullptr, std::function<bool(mega::MegaNode *)> descendInto = nullptr);
+    bool sameContents(const std::string &localPath, const LocalFingerprintKey &key, mega::MegaNode *remote);
+    void diffFolder(const std::string &localFolder, const std::string &relativePath, mega::MegaNodeList *children, bool checkFingerprints,
+                    mega::MegaFileSystemAccess *fsAccess, std::vector<DiffRecord> *records,
+                    std::vector<std::pair<mega::MegaHandle, std::pair<std::string, std::string> > > *subfolders);
+    void scanVersions(mega::MegaNode* n, std::function<void(const FolderVersionsReport &)> onFolderScanned,
+                      std::vector<std::pair<mega::MegaHandle, long long> > *versionsFound = NULL);
+    int removeVersions(const std::vector<std::pair<mega::MegaHandle, long long> > &versions, int clientID);
+    void transferNodeImages(bool preview, std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
     void getInfoFromFolder(mega::MegaNode *, mega::MegaApi *, long long *nfiles, long long *nfolders, long long *nversions = NULL);
 
 
     //acting
     void loginWithPassword(char *password);
     void changePassword(const char *newpassword, std::string pin2fa = "");
-    void actUponGetExtendedAccountDetails(mega::SynchronousRequestListener  *srl, int timeout = -1);
+    void printAccountDetails(mega::MegaAccountDetails *details);
     bool actUponFetchNodes(mega::MegaApi * api, mega::SynchronousRequestListener  *srl, int timeout = -1);
     int actUponLogin(mega::SynchronousRequestListener  *srl, int timeout = -1);
     void actUponLogout(mega::SynchronousRequestListener  *srl, bool deletedSession, int timeout = 0);
     int actUponCreateFolder(mega::SynchronousRequestListener  *srl, int timeout = 0);
     int deleteNode(mega::MegaNode *nodeToDelete, mega::MegaApi* api, int recursive, int force = 0);
-    int deleteNodeVersions(mega::MegaNode *nodeToDelete, mega::MegaApi* api, int force = 0);
+    int deleteNodeVersions(mega::MegaNode *nodeToDelete, mega::MegaApi* api, int force = 0, bool dryrun = false, int clientID = -1);
+    mega::MegaApi *getApiFolderForLink(const std::string &publicLink, std::string *error = NULL);
+    void importLink(std::string publicLink, const std::string &password, mega::MegaNode *dstFolder, ImportResult *result);
+    void importManifest(const std::string &manifestPath, const std::string &defaultDestination, const std::string &resultsPath, int maxInFlight, int clientID);
     void downloadNode(std::string localPath, mega::MegaApi* api, mega::MegaNode *node, bool background, bool ignorequotawar, int clientID, MegaCmdMultiTransferListener *listener = NULL);
+    void downloadNodes(std::vector<mega::MegaNode *> *nodes, std::string localPath, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener, std::map<std::string, std::string> *cloptions, SkipUnchangedStats *skipUnchangedStats = NULL);
+    void resumeDownloads(std::string manifestPath, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener, std::map<std::string, std::string> *cloptions);
+    void scheduleDownloads(std::vector<std::pair<mega::MegaHandle, std::string> > &targets, std::string manifestPath, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener, std::map<std::string, std::string> *cloptions);
+    std::vector<bool> findUnchangedFiles(const std::vector<std::pair<std::string, mega::MegaNode *> > &comparisons);
+    void uploadNodesSkippingUnchanged(const std::vector<std::string> &localPaths, mega::MegaNode *node, std::string newname, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener, SkipUnchangedStats *stats);
+    void planDownloadsSkippingUnchanged(std::vector<mega::MegaNode *> *nodes, std::string localPath, std::vector<std::pair<mega::MegaHandle, std::string> > &targets, SkipUnchangedStats *stats);
+    void printSkipUnchangedStats(SkipUnchangedStats *stats, MegaCmdMultiTransferListener *multiTransferListener, bool background);
     void uploadNode(std::string localPath, mega::MegaApi* api, mega::MegaNode *node, std::string newname, bool background, bool ignorequotawarn, int clientID, MegaCmdMultiTransferListener *multiTransferListener = NULL);
     void exportNode(mega::MegaNode *n, int64_t expireTime, std::string password = std::string(), bool force = false);
     void disableExport(mega::MegaNode *n);
@@ -134,6 +349,8 @@ public:
 
     void restartsyncs();
 
+    typedef void (MegaCmdExecuter::*CommandHandler)(std::vector<std::string> &words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
+    static const std::unordered_map<std::string, CommandHandler> &getCommandHandlers();
     void executecommand(std::vector<std::string> words, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions);
 
     //doomedtodie
@@ -147,6 +364,8 @@ public:
     void confirmWithPassword(std::string passwd);
 
     int makedir(std::string remotepath, bool recursive, mega::MegaNode *parentnode = NULL);
+    std::map<std::string, mega::MegaHandle> materializeFolders(mega::MegaNode *parent, const std::vector<std::string> &paths,
+                                                               std::set<std::string> *created = NULL);
     bool IsFolder(std::string path);
     void doDeleteNode(mega::MegaNode *nodeToDelete, mega::MegaApi* api);
 
@@ -158,6 +377,7 @@ public:
     void printTransfersHeader(const unsigned int PATHSIZE, bool printstate=true);
     void printTransfer(mega::MegaTransfer *transfer, const unsigned int PATHSIZE, bool printstate=true);
     void printTransferColumnDisplayer(ColumnDisplayer *cd, mega::MegaTransfer *transfer, bool printstate=true);
+    void printTransferNdjson(mega::MegaTransfer *transfer);
 
 #ifdef ENABLE_BACKUPS
 
@@ -170,6 +390,8 @@ public:
 #endif
     void printSyncHeader(const unsigned int PATHSIZE, ColumnDisplayer *cd = nullptr);
     void printSync(int i, std::string key, const char *nodepath, sync_struct * thesync, mega::MegaNode *n, long long nfiles, long long nfolders, const unsigned int PATHSIZE, ColumnDisplayer *cd = nullptr);
+    void printSyncNdjson(int i, std::string key, const char *nodepath, sync_struct * thesync, mega::MegaNode *n, long long nfiles, long long nfolders);
+    std::string getSyncActiveStateStr(sync_struct * thesync, mega::MegaNode *n);
 
     void doFind(mega::MegaNode* nodeBase, const char *timeFormat, std::map<std::string, int> *clflags, std::map<std::string, std::string> *cloptions, std::string word, int printfileinfo, std::string pattern, bool usepcre, mega::m_time_t minTime, mega::m_time_t maxTime, int64_t minSize, int64_t maxSize);
 
@@ -191,7 +413,13 @@ public:
 
     void processPath(std::string path, bool usepcre, bool &firstone, void (*nodeprocessor)(MegaCmdExecuter *, mega::MegaNode *, bool), MegaCmdExecuter *context = NULL);
     void catFile(mega::MegaNode *n);
-    void printInfoFile(mega::MegaNode *n, bool &firstone, int PATHSIZE);
+    bool streamFile(mega::MegaNode *n, long long start, long long end, LoggedStream *ls, bool cache);
+    bool hashFileContents(mega::MegaNode *n, std::string *digest);
+    bool prefetchFile(mega::MegaNode *n);
+    void loadBlockCache();
+    void queuePrefetch(std::shared_ptr<PrefetchJob> job);
+    void prefetchTree(PrefetchJob *job);
+    void printInfoFile(const std::string &nodepath, mega::MegaHandle h, const MediaInfoCache::MediaInfo &info, bool &firstone, int PATHSIZE, bool ndjson);
 
 
 #ifdef HAVE_LIBUV
@@ -168,6 +168,12 @@ void setCurrentOutCode(int outCode)
     threadoutCode[MegaThread::currentThreadId()] = outCode;
 }
 
+void forgetCurrentThreadOutCode()
+{
+    std::lock_guard<std::mutex> g(threadLookups);
+    threadoutCode.erase(MegaThread::currentThreadId());
+}
+
 void setCurrentPetition(CmdPetition *petition)
 {
     std::lock_guard<std::mutex> g(threadLookups);
@@ -89,6 +89,7 @@ bool interactiveThread();
 void setCurrentThreadOutStream(LoggedStream *);
 int getCurrentOutCode();
 void setCurrentOutCode(int);
+void forgetCurrentThreadOutCode();
 int getCurrentThreadLogLevel();
 void setCurrentThreadLogLevel(int);
 
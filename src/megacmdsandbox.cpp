@@ -17,10 +17,863 @@
  */
 
 #include "megacmdsandbox.h"
+#include "configurationmanager.h"
+#include "listeners.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
 
 using namespace mega;
 
 namespace megacmd {
+
+void AccountDetailsCache::refresh(int kind, MegaApi *api, std::unique_lock<std::mutex> &lock)
+{
+    entries[kind].refreshing = true;
+    unsigned long long requestEpoch = epoch;
+    unsigned long long requestInvalidations = invalidations;
+    lock.unlock(); // not to call the SDK holding the lock
+
+    auto listener = new MegaCmdListenerFuncExecuter([this, kind, requestEpoch, requestInvalidations](MegaApi *, MegaRequest *request, MegaError *e)
+    {
+        std::shared_ptr<MegaAccountDetails> details;
+        if (e->getErrorCode() == MegaError::API_OK)
+        {
+            details.reset(request->getMegaAccountDetails());
+        }
+        else
+        {
+            LOG_debug << "Failed to refresh account details: " << e->getErrorString();
+        }
+
+        std::lock_guard<std::mutex> g(cacheMutex);
+        Entry &entry = entries[kind];
+        if (requestEpoch == epoch)
+        {
+            entry.refreshing = false;
+            entry.completed++;
+            if (details)
+            {
+                entry.details = details;
+                entry.fetched = std::chrono::steady_clock::now();
+                entry.valid = (requestInvalidations == invalidations);
+            }
+        }
+        cacheCV.notify_all();
+    }, true);
+
+    if (kind == EXTENDED)
+    {
+        api->getExtendedAccountDetails(true, true, true, listener);
+    }
+    else
+    {
+        api->getAccountDetails(listener);
+    }
+    lock.lock();
+}
+
+std::shared_ptr<MegaAccountDetails> AccountDetailsCache::get(int kind, MegaApi *api, bool allowStale, int timeoutMs)
+{
+    int ttl = (kind == EXTENDED) ? ConfigurationManager::getConfigurationValue("account_sessions_ttl", 60)
+                                 : ConfigurationManager::getConfigurationValue("account_details_ttl", 300);
+
+    std::unique_lock<std::mutex> lock(cacheMutex);
+    Entry &entry = entries[kind];
+    bool fresh = entry.details && entry.valid && (std::chrono::steady_clock::now() - entry.fetched) < std::chrono::seconds(ttl);
+    if (fresh || (entry.details && allowStale))
+    {
+        hits++;
+        if (!fresh && !entry.refreshing)
+        {
+            refresh(kind, api, lock);
+        }
+        return entry.details;
+    }
+
+    misses++;
+    unsigned long long currentEpoch = epoch;
+    unsigned long long completed = entry.completed;
+    if (!entry.refreshing)
+    {
+        refresh(kind, api, lock);
+    }
+    auto finished = [&]() { return epoch != currentEpoch || entry.completed != completed; };
+    if (timeoutMs < 0)
+    {
+        cacheCV.wait(lock, finished);
+    }
+    else if (!cacheCV.wait_for(lock, std::chrono::milliseconds(timeoutMs), finished))
+    {
+        return nullptr;
+    }
+    return (epoch == currentEpoch) ? entry.details : nullptr;
+}
+
+void AccountDetailsCache::invalidate()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    invalidations++;
+    for (auto &entry : entries)
+    {
+        entry.valid = false;
+    }
+}
+
+void AccountDetailsCache::clear()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    epoch++;
+    for (auto &entry : entries)
+    {
+        entry.details.reset();
+        entry.valid = false;
+        entry.refreshing = false;
+    }
+    cacheCV.notify_all();
+}
+
+unsigned long long AccountDetailsCache::getHits()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return hits;
+}
+
+unsigned long long AccountDetailsCache::getMisses()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return misses;
+}
+
+namespace {
+int parseTimeOfDay(const std::string &text)
+{
+    int hours = 0, minutes = 0;
+    char extra;
+    if (sscanf(text.c_str(), "%d:%d%c", &hours, &minutes, &extra) != 2
+            || hours < 0 || hours > 24 || minutes < 0 || minutes > 59 || (hours == 24 && minutes))
+    {
+        return -1;
+    }
+    return (hours * 60 + minutes) % (24 * 60);
+}
+
+long long parseSpeed(std::string text)
+{
+    std::string withUnits = text + "B";
+    long long speed = textToSize(text.c_str());
+    if (speed == -1)
+    {
+        speed = textToSize(withUnits.c_str()); // no units given: bytes
+    }
+    return speed;
+}
+
+std::string timeOfDayToString(int minutes)
+{
+    std::ostringstream os;
+    os << std::setfill('0') << std::setw(2) << minutes / 60 << ":" << std::setw(2) << minutes % 60;
+    return os.str();
+}
+
+std::string speedToString(long long speed, bool humanreadable)
+{
+    return speed ? sizeToText(speed, false, humanreadable) : "0";
+}
+}
+
+bool BandwidthScheduler::parseSchedule(const std::string &text, std::vector<Window> &windows)
+{
+    windows.clear();
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        size_t next = text.find(',', pos);
+        std::string item = text.substr(pos, next == std::string::npos ? std::string::npos : next - pos);
+        pos = (next == std::string::npos) ? text.size() : next + 1;
+
+        size_t dash = item.find('-');
+        size_t equals = item.find('=');
+        if (dash == std::string::npos || equals == std::string::npos || equals < dash)
+        {
+            return false;
+        }
+        Window window;
+        window.start = parseTimeOfDay(item.substr(0, dash));
+        window.end = parseTimeOfDay(item.substr(dash + 1, equals - dash - 1));
+
+        std::string limits = item.substr(equals + 1);
+        size_t slash = limits.find('/');
+        window.download = parseSpeed(limits.substr(0, slash));
+        window.upload = (slash == std::string::npos) ? window.download : parseSpeed(limits.substr(slash + 1));
+        if (window.start < 0 || window.end < 0 || window.download < 0 || window.upload < 0)
+        {
+            return false;
+        }
+        windows.push_back(window);
+    }
+    return !windows.empty();
+}
+
+std::string BandwidthScheduler::windowToString(const Window &window, bool humanreadable)
+{
+    return timeOfDayToString(window.start) + "-" + timeOfDayToString(window.end) + "="
+            + speedToString(window.download, humanreadable) + "/" + speedToString(window.upload, humanreadable);
+}
+
+void BandwidthScheduler::apply(MegaApi *api)
+{
+    std::string text = ConfigurationManager::getConfigurationSValue("speedlimit_schedule");
+    long long limits[2] = { ConfigurationManager::getConfigurationValue("maxspeeddownload", -1ll),
+                            ConfigurationManager::getConfigurationValue("maxspeedupload", -1ll) };
+
+    struct tm tms;
+    m_localtime(m_time(), &tms);
+    int now = tms.tm_hour * 60 + tms.tm_min;
+
+    bool changed[2] = { false, false };
+    {
+        std::lock_guard<std::mutex> g(schedulerMutex);
+        if (text != scheduleText)
+        {
+            scheduleText = text;
+            if (text.size() && !parseSchedule(text, windows))
+            {
+                LOG_err << "Invalid speedlimit schedule: " << text;
+                windows.clear();
+            }
+            else if (!text.size())
+            {
+                windows.clear();
+            }
+        }
+
+        int window = -1;
+        for (int i = 0; window == -1 && i < int(windows.size()); i++)
+        {
+            const Window &w = windows[i];
+            if ((w.start == w.end) // the whole day
+                    || (w.start < w.end && now >= w.start && now < w.end)
+                    || (w.start > w.end && (now >= w.start || now < w.end)))
+            {
+                window = i;
+            }
+        }
+        if (window != activeWindow)
+        {
+            if (window >= 0)
+            {
+                LOG_info << "Speed limit schedule: entering window " << windowToString(windows[window], true);
+            }
+            else if (activeWindow >= 0)
+            {
+                LOG_info << "Speed limit schedule: out of scheduled windows, back to the base limits";
+            }
+            activeWindow = window;
+        }
+        if (window >= 0)
+        {
+            limits[MegaTransfer::TYPE_DOWNLOAD] = windows[window].download;
+            limits[MegaTransfer::TYPE_UPLOAD] = windows[window].upload;
+        }
+
+        for (int type = 0; type < 2; type++)
+        {
+            if (limits[type] == -1 && appliedLimits[type] == -1)
+            {
+                continue; // never configured: keep the SDK default
+            }
+            limits[type] = std::max(0ll, limits[type]);
+            changed[type] = (limits[type] != appliedLimits[type]);
+            appliedLimits[type] = limits[type];
+        }
+    }
+
+    // not to call the SDK holding the lock
+    if (changed[MegaTransfer::TYPE_DOWNLOAD])
+    {
+        api->setMaxDownloadSpeed(limits[MegaTransfer::TYPE_DOWNLOAD]);
+    }
+    if (changed[MegaTransfer::TYPE_UPLOAD])
+    {
+        api->setMaxUploadSpeed(limits[MegaTransfer::TYPE_UPLOAD]);
+    }
+}
+
+void BandwidthScheduler::tick(MegaApi *api)
+{
+    apply(api);
+
+    int burstSeconds = std::max(1, ConfigurationManager::getConfigurationValue("speedlimit_burst", 2));
+    std::vector<int> toPause, toResume;
+    {
+        std::lock_guard<std::mutex> g(schedulerMutex);
+        auto now = std::chrono::steady_clock::now();
+        double elapsed = std::chrono::duration<double>(now - lastTick).count();
+        lastTick = now;
+        if (elapsed <= 0 || elapsed > 10)
+        {
+            elapsed = 1; // first tick, or the process was suspended
+        }
+
+        for (int type = 0; type < 2; type++)
+        {
+            std::vector<ClientBucket *> clients;
+            for (auto &b : buckets)
+            {
+                if (b.first.first == type)
+                {
+                    b.second.rate = (b.second.rate + b.second.consumed / elapsed) / 2;
+                    clients.push_back(&b.second);
+                }
+            }
+            long long limit = std::max(0ll, appliedLimits[type]);
+            bool sharing = limit && clients.size() > 1; // otherwise the limit in the SDK is enough
+
+            if (sharing)
+            {
+                // max-min fair shares: what clients below an equal share do not use goes to the rest.
+                // Throttled clients want more than they are given
+                std::sort(clients.begin(), clients.end(), [](ClientBucket *a, ClientBucket *b)
+                {
+                    return !a->throttled && (b->throttled || a->rate < b->rate);
+                });
+                long long equalShare = limit / clients.size();
+                double remaining = double(limit);
+                size_t left = clients.size();
+                for (auto c : clients)
+                {
+                    double demand = c->throttled ? remaining : c->rate * 1.5;
+                    double share = std::min(demand, remaining / left--);
+                    remaining -= share;
+                    // never below an equal share: the limit in the SDK caps the total anyway
+                    c->allowed = std::max(equalShare, (long long) share);
+                }
+            }
+
+            for (auto c : clients)
+            {
+                if (!sharing)
+                {
+                    c->allowed = limit;
+                    c->tokens = 0;
+                    c->throttled = false;
+                }
+                else
+                {
+                    c->tokens = std::min(c->tokens + c->allowed * elapsed, double(c->allowed) * burstSeconds) - c->consumed;
+                    c->throttled = c->tokens < 0;
+                }
+                c->consumed = 0;
+
+                for (auto &t : c->transferred)
+                {
+                    if (c->throttled && !c->userOwned.count(t.first) && c->paused.insert(t.first).second)
+                    {
+                        toPause.push_back(t.first);
+                    }
+                }
+                if (!c->throttled)
+                {
+                    toResume.insert(toResume.end(), c->paused.begin(), c->paused.end());
+                    c->paused.clear();
+                    c->userOwned.clear();
+                }
+            }
+        }
+
+        for (auto it = buckets.begin(); it != buckets.end(); )
+        {
+            if (it->second.transferred.empty())
+            {
+                it = buckets.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    for (auto tag : toPause)
+    {
+        MegaTransfer *transfer = api->getTransferByTag(tag);
+        bool userPaused = transfer && transfer->getState() == MegaTransfer::STATE_PAUSED;
+        delete transfer;
+        if (userPaused)
+        {
+            onUserPause(tag); // not ours to resume
+            continue;
+        }
+        LOG_verbose << "Speed limit: pausing transfer " << tag << " of a client over its share";
+        api->pauseTransferByTag(tag, true);
+    }
+    for (auto tag : toResume)
+    {
+        LOG_verbose << "Speed limit: resuming transfer " << tag;
+        api->pauseTransferByTag(tag, false);
+    }
+}
+
+BandwidthScheduler::ClientBucket *BandwidthScheduler::getBucket(int clientID, MegaTransfer *transfer)
+{
+    if (transfer->getType() != MegaTransfer::TYPE_DOWNLOAD && transfer->getType() != MegaTransfer::TYPE_UPLOAD)
+    {
+        return nullptr;
+    }
+    return &buckets[std::make_pair(transfer->getType(), clientID)];
+}
+
+void BandwidthScheduler::onTransferStart(int clientID, MegaTransfer *transfer)
+{
+    std::lock_guard<std::mutex> g(schedulerMutex);
+    ClientBucket *bucket = getBucket(clientID, transfer);
+    if (bucket)
+    {
+        bucket->transferred[transfer->getTag()] = transfer->getTransferredBytes();
+    }
+}
+
+void BandwidthScheduler::onTransferUpdate(int clientID, MegaTransfer *transfer)
+{
+    std::lock_guard<std::mutex> g(schedulerMutex);
+    ClientBucket *bucket = getBucket(clientID, transfer);
+    if (bucket)
+    {
+        long long &transferred = bucket->transferred[transfer->getTag()];
+        bucket->consumed += std::max(0ll, transfer->getTransferredBytes() - transferred);
+        transferred = transfer->getTransferredBytes();
+    }
+}
+
+void BandwidthScheduler::onTransferFinish(int clientID, MegaTransfer *transfer)
+{
+    std::lock_guard<std::mutex> g(schedulerMutex);
+    ClientBucket *bucket = getBucket(clientID, transfer);
+    if (bucket)
+    {
+        bucket->transferred.erase(transfer->getTag());
+        bucket->paused.erase(transfer->getTag());
+        bucket->userOwned.erase(transfer->getTag());
+    }
+}
+
+void BandwidthScheduler::onUserPause(int tag)
+{
+    std::lock_guard<std::mutex> g(schedulerMutex);
+    for (auto &b : buckets)
+    {
+        if (b.second.transferred.count(tag))
+        {
+            b.second.paused.erase(tag);
+            b.second.userOwned.insert(tag);
+        }
+    }
+}
+
+std::vector<BandwidthScheduler::Window> BandwidthScheduler::getSchedule(int *active)
+{
+    std::lock_guard<std::mutex> g(schedulerMutex);
+    if (active)
+    {
+        *active = activeWindow;
+    }
+    return windows;
+}
+
+std::vector<BandwidthScheduler::ClientUsage> BandwidthScheduler::getUsage()
+{
+    std::vector<ClientUsage> usage;
+    std::lock_guard<std::mutex> g(schedulerMutex);
+    for (auto &b : buckets)
+    {
+        if (b.second.transferred.empty())
+        {
+            continue;
+        }
+        ClientUsage u;
+        u.type = b.first.first;
+        u.clientID = b.first.second;
+        u.transfers = int(b.second.transferred.size());
+        u.observed = (long long) b.second.rate;
+        u.allowed = b.second.allowed;
+        u.throttled = b.second.throttled;
+        usage.push_back(u);
+    }
+    return usage;
+}
+
+namespace {
+const size_t TRANSFER_QUEUE_HISTORY = 100;
+const int TRANSFER_QUEUE_MAX_MOVES = 200; // per call: the rest are left for the next one
+
+bool hasStarted(MegaTransfer *transfer)
+{
+    int state = transfer->getState();
+    return transfer->getTransferredBytes() > 0 || state == MegaTransfer::STATE_ACTIVE
+            || state == MegaTransfer::STATE_COMPLETING || state == MegaTransfer::STATE_COMPLETED;
+}
+}
+
+bool TransferQueueScheduler::parsePolicy(const std::string &text, Policy &policy)
+{
+    if (text == "fifo")
+    {
+        policy = POLICY_FIFO;
+    }
+    else if (text == "shortest-first")
+    {
+        policy = POLICY_SHORTEST_FIRST;
+    }
+    else if (text == "fair-share")
+    {
+        policy = POLICY_FAIR_SHARE;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+std::string TransferQueueScheduler::policyToString(Policy policy)
+{
+    switch (policy)
+    {
+        case POLICY_SHORTEST_FIRST:
+            return "shortest-first";
+        case POLICY_FAIR_SHARE:
+            return "fair-share";
+        default:
+            return "fifo";
+    }
+}
+
+TransferQueueScheduler::Policy TransferQueueScheduler::getPolicy()
+{
+    Policy policy = POLICY_FIFO;
+    std::string text = ConfigurationManager::getConfigurationSValue("transfer_queue_policy");
+    if (text.size() && !parsePolicy(text, policy))
+    {
+        LOG_warn << "Invalid transfer queue policy: " << text << ". Using fifo";
+    }
+    return policy;
+}
+
+TransferQueueScheduler::QueuedTransfer *TransferQueueScheduler::getRecord(int clientID, MegaTransfer *transfer)
+{
+    if (transfer->getType() != MegaTransfer::TYPE_DOWNLOAD && transfer->getType() != MegaTransfer::TYPE_UPLOAD)
+    {
+        return nullptr;
+    }
+
+    auto it = transfers.find(transfer->getTag());
+    if (it == transfers.end())
+    {
+        QueuedTransfer record;
+        record.tag = transfer->getTag();
+        record.type = transfer->getType();
+        record.clientID = clientID;
+        record.size = transfer->getTotalBytes();
+        record.sequence = nextSequence++;
+        record.queuePosition = transfer->getPriority();
+        record.queuedAt = std::chrono::steady_clock::now();
+        it = transfers.insert(std::make_pair(record.tag, record)).first;
+    }
+    else if (it->second.clientID == -1)
+    {
+        it->second.clientID = clientID; // first seen in the SDK queue, before its listener told us
+    }
+    return &it->second;
+}
+
+void TransferQueueScheduler::markStarted(QueuedTransfer &record)
+{
+    record.started = true;
+    record.waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - record.queuedAt).count();
+    waits++;
+    waitTotalMs += record.waitMs;
+    waitMaxMs = std::max(waitMaxMs, record.waitMs);
+    LOG_debug << "Transfer " << record.tag << " started after " << record.waitMs << " ms in the queue";
+}
+
+void TransferQueueScheduler::forget(std::map<int, QueuedTransfer>::iterator it)
+{
+    if (it->second.started)
+    {
+        it->second.finished = true;
+        history.push_front(it->second);
+        if (history.size() > TRANSFER_QUEUE_HISTORY)
+        {
+            history.pop_back();
+        }
+    }
+    transfers.erase(it);
+}
+
+std::vector<int> TransferQueueScheduler::rank(int type, const std::vector<int> &queued, Policy policy)
+{
+    std::vector<QueuedTransfer *> order;
+    for (auto tag : queued)
+    {
+        order.push_back(&transfers[tag]);
+    }
+    // the order of the SDK is kept among equals: MEGAcmd may learn of transfers later than they were queued
+    std::sort(order.begin(), order.end(), [](QueuedTransfer *a, QueuedTransfer *b)
+    {
+        return a->queuePosition != b->queuePosition ? a->queuePosition < b->queuePosition : a->sequence < b->sequence;
+    });
+
+    // fair share: a client's n-th queued transfer goes after the (n-1)-th of every other client,
+    // counting as taken the turns of its transfers already started
+    std::map<int, long long> turns; // by clientID
+    if (policy == POLICY_FAIR_SHARE)
+    {
+        for (auto &t : transfers)
+        {
+            if (t.second.type == type && t.second.started)
+            {
+                turns[t.second.clientID]++;
+            }
+        }
+    }
+
+    std::map<int, long long> keys; // by tag
+    for (auto t : order)
+    {
+        keys[t->tag] = (policy == POLICY_SHORTEST_FIRST) ? t->size
+                                                         : ((policy == POLICY_FAIR_SHARE) ? turns[t->clientID]++ : 0);
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&keys](QueuedTransfer *a, QueuedTransfer *b)
+    {
+        if (a->priority != b->priority)
+        {
+            return a->priority > b->priority;
+        }
+        if (a->deadline != b->deadline)
+        {
+            return a->deadline && (!b->deadline || a->deadline < b->deadline);
+        }
+        return keys[a->tag] < keys[b->tag];
+    });
+
+    std::vector<int> ranked;
+    for (auto t : order)
+    {
+        ranked.push_back(t->tag);
+    }
+    return ranked;
+}
+
+bool TransferQueueScheduler::isReorderingNeeded(Policy policy)
+{
+    if (policy != POLICY_FIFO)
+    {
+        return true;
+    }
+    std::lock_guard<std::mutex> g(queueMutex);
+    for (auto &t : transfers)
+    {
+        if (!t.second.started && (t.second.priority || t.second.deadline))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+void TransferQueueScheduler::reorder(MegaApi *api, bool force)
+{
+    Policy policy = getPolicy();
+    if (!force && !isReorderingNeeded(policy))
+    {
+        return; // listing all the transfers is costly for long queues: the SDK order is already the one to follow
+    }
+
+    for (int type = 0; type < 2; type++)
+    {
+        auto listed = std::chrono::steady_clock::now();
+        std::unique_ptr<MegaTransferList> list(api->getTransfers(type));
+        if (!list)
+        {
+            continue;
+        }
+
+        std::vector<std::pair<unsigned long long, int>> positions; // queue position in the SDK and tag
+        std::vector<int> queued; // in the order of the SDK
+        std::vector<int> desired;
+        {
+            std::lock_guard<std::mutex> g(queueMutex);
+            std::set<int> present;
+            for (int i = 0; i < list->size(); i++)
+            {
+                MegaTransfer *transfer = list->get(i);
+                if (transfer->isFolderTransfer() || transfer->isStreamingTransfer())
+                {
+                    continue;
+                }
+                QueuedTransfer *record = getRecord(-1, transfer);
+                if (!record)
+                {
+                    continue;
+                }
+                present.insert(record->tag);
+                record->size = transfer->getTotalBytes();
+                record->queuePosition = transfer->getPriority();
+                if (!record->started && hasStarted(transfer))
+                {
+                    markStarted(*record);
+                }
+                if (transfer->getState() == MegaTransfer::STATE_QUEUED)
+                {
+                    positions.push_back(std::make_pair(transfer->getPriority(), record->tag));
+                }
+            }
+            std::sort(positions.begin(), positions.end());
+            for (auto &p : positions)
+            {
+                queued.push_back(p.second);
+            }
+
+            // gone without us being told (e.g: background transfers, which have no listener).
+            // Those started after listing them are kept
+            for (auto it = transfers.begin(); it != transfers.end(); )
+            {
+                auto next = std::next(it);
+                if (it->second.type == type && !present.count(it->first) && it->second.queuedAt < listed)
+                {
+                    forget(it);
+                }
+                it = next;
+            }
+
+            desired = rank(type, queued, policy);
+        }
+
+        // not to call the SDK holding the lock
+        int moved = 0;
+        for (size_t i = 0; i < desired.size() && moved < TRANSFER_QUEUE_MAX_MOVES; i++)
+        {
+            if (queued[i] != desired[i])
+            {
+                api->moveTransferBeforeByTag(desired[i], queued[i]);
+                queued.erase(std::find(queued.begin() + i, queued.end(), desired[i]));
+                queued.insert(queued.begin() + i, desired[i]);
+                moved++;
+            }
+        }
+
+        if (moved)
+        {
+            LOG_verbose << "Transfer queue: " << moved << " queued " << (type == MegaTransfer::TYPE_UPLOAD ? "uploads" : "downloads")
+                        << " moved to follow " << policyToString(policy) << " order";
+            std::lock_guard<std::mutex> g(queueMutex);
+            moves += moved;
+        }
+    }
+}
+
+void TransferQueueScheduler::onTransferStart(int clientID, MegaTransfer *transfer, int priority, m_time_t deadline)
+{
+    std::lock_guard<std::mutex> g(queueMutex);
+    QueuedTransfer *record = getRecord(clientID, transfer);
+    if (record && (priority || deadline))
+    {
+        record->priority = priority;
+        record->deadline = deadline;
+    }
+}
+
+void TransferQueueScheduler::onTransferUpdate(int clientID, MegaTransfer *transfer)
+{
+    std::lock_guard<std::mutex> g(queueMutex);
+    auto it = transfers.find(transfer->getTag());
+    if (it != transfers.end() && !it->second.started && hasStarted(transfer))
+    {
+        markStarted(it->second);
+    }
+}
+
+void TransferQueueScheduler::onTransferFinish(int clientID, MegaTransfer *transfer)
+{
+    std::lock_guard<std::mutex> g(queueMutex);
+    auto it = transfers.find(transfer->getTag());
+    if (it == transfers.end())
+    {
+        return;
+    }
+    if (!it->second.started && transfer->getState() == MegaTransfer::STATE_COMPLETED)
+    {
+        markStarted(it->second); // completed before any update
+    }
+    forget(it);
+}
+
+void TransferQueueScheduler::setPriority(MegaTransfer *transfer, int priority, m_time_t deadline)
+{
+    std::lock_guard<std::mutex> g(queueMutex);
+    QueuedTransfer *record = getRecord(-1, transfer);
+    if (record)
+    {
+        record->priority = priority;
+        record->deadline = deadline;
+    }
+}
+
+std::vector<TransferQueueScheduler::QueuedTransfer> TransferQueueScheduler::getTransfers(bool includeFinished)
+{
+    Policy policy = getPolicy();
+    std::vector<QueuedTransfer> result;
+
+    std::lock_guard<std::mutex> g(queueMutex);
+    auto now = std::chrono::steady_clock::now();
+    std::vector<QueuedTransfer> started;
+    std::vector<int> queued[2];
+    for (auto &t : transfers)
+    {
+        if (t.second.started)
+        {
+            started.push_back(t.second);
+        }
+        else
+        {
+            queued[t.second.type].push_back(t.first);
+        }
+    }
+    std::sort(started.begin(), started.end(), [](const QueuedTransfer &a, const QueuedTransfer &b)
+    {
+        return a.sequence < b.sequence;
+    });
+    result = started;
+
+    for (int type = 0; type < 2; type++)
+    {
+        for (auto tag : rank(type, queued[type], policy))
+        {
+            QueuedTransfer t = transfers[tag];
+            t.waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(now - t.queuedAt).count();
+            result.push_back(t);
+        }
+    }
+
+    if (includeFinished)
+    {
+        result.insert(result.end(), history.begin(), history.end());
+    }
+    return result;
+}
+
+void TransferQueueScheduler::getWaitStats(unsigned long long *count, long long *averageMs, long long *maxMs, unsigned long long *moved)
+{
+    std::lock_guard<std::mutex> g(queueMutex);
+    *count = waits;
+    *averageMs = waits ? waitTotalMs / (long long) waits : 0;
+    *maxMs = waitMaxMs;
+    *moved = moves;
+}
+
 bool MegaCmdSandbox::isOverquota() const
 {
     return overquota;
@@ -37,7 +890,6 @@ void MegaCmdSandbox::resetSandBox()
     this->istemporalbandwidthvalid = false;
     this->temporalbandwidth = 0;
     this->temporalbandwithinterval = 0;
-    this->lastQuerytemporalBandwith = m_time();
     this->timeOfOverquota = m_time();
     this->secondsOverQuota = 0;
     this->storageStatus = 0;
@@ -45,6 +897,9 @@ void MegaCmdSandbox::resetSandBox()
     this->totalStorage = 0;
     this->timeOfPSACheck = 0;
     this->lastPSAnumreceived = -1;
+    this->nodePathCache.clear();
+    this->mediaInfoCache.clear();
+    this->accountDetails.clear();
     if (reasonblocked.size()) removeGreetingStatusAllListener(string("message:").append(reasonblocked));
     this->reasonblocked = "";
     this->reasonPending = false;
@@ -108,7 +963,6 @@ MegaCmdSandbox::MegaCmdSandbox()
     this->istemporalbandwidthvalid = false;
     this->temporalbandwidth = 0;
     this->temporalbandwithinterval = 0;
-    this->lastQuerytemporalBandwith = m_time();
     this->timeOfOverquota = m_time();
     this->secondsOverQuota = 0;
     this->storageStatus = 0;
@@ -23,11 +23,237 @@
 #include <ctime>
 #include <string>
 #include <future>
+#include <memory>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
 #include "megacmdexecuter.h"
+#include "megacmdutils.h"
 
 namespace megacmd {
 class MegaCmdExecuter;
 
+/**
+ * @brief The AccountDetailsCache class keeps the last account details received, so that commands
+ * do not need to query them every time.
+ *
+ * Details are considered fresh for "account_details_ttl" seconds ("account_sessions_ttl" for the
+ * extended ones, which include sessions) or until invalidated by account updates. Expired details
+ * are refreshed asynchronously, and can be served meanwhile to those callers that accept them.
+ */
+class AccountDetailsCache
+{
+public:
+    enum
+    {
+        BASIC, // storage, transfer quota and pro level
+        EXTENDED, // BASIC plus sessions, purchases and transactions
+        NUM_KINDS
+    };
+
+private:
+    struct Entry
+    {
+        std::shared_ptr<::mega::MegaAccountDetails> details;
+        std::chrono::steady_clock::time_point fetched;
+        bool valid = false; // not invalidated since requested
+        bool refreshing = false;
+        unsigned long long completed = 0; // requests finished
+    };
+
+    std::mutex cacheMutex;
+    std::condition_variable cacheCV;
+    Entry entries[NUM_KINDS];
+    unsigned long long epoch = 0; // changed on clear: results of previous requests are discarded
+    unsigned long long invalidations = 0;
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+
+    void refresh(int kind, ::mega::MegaApi *api, std::unique_lock<std::mutex> &lock);
+
+public:
+    /**
+     * @brief Gets the account details, waiting for them only if not cached (or if allowStale is false,
+     * when expired), up to timeoutMs milliseconds (-1 for no limit).
+     * @return NULL if they could not be obtained
+     */
+    std::shared_ptr<::mega::MegaAccountDetails> get(int kind, ::mega::MegaApi *api, bool allowStale, int timeoutMs = -1);
+    void invalidate();
+    void clear();
+
+    unsigned long long getHits();
+    unsigned long long getMisses();
+};
+
+/**
+ * @brief The BandwidthScheduler class applies the speed limits of the time windows configured in
+ * "speedlimit_schedule" (the base limits set with speedlimit outside them) and shares the limit in
+ * effect among the clients transferring concurrently.
+ *
+ * Each client and direction gets a token bucket refilled with its share of the limit. Shares not
+ * used by some clients are given to the others, and the transfers of a client that runs out of
+ * tokens are paused until its bucket recovers. Only the pauses made by the scheduler are undone:
+ * transfers the user paused or resumed are left alone until the client stops being throttled.
+ */
+class BandwidthScheduler
+{
+public:
+    struct Window
+    {
+        int start; // minutes since midnight
+        int end; // minutes since midnight: lower than start for windows crossing midnight
+        long long download; // bytes per second, 0 = unlimited
+        long long upload;
+    };
+
+    struct ClientUsage
+    {
+        int clientID;
+        int type; // MegaTransfer::TYPE_DOWNLOAD or MegaTransfer::TYPE_UPLOAD
+        int transfers;
+        long long observed; // bytes per second
+        long long allowed; // bytes per second, 0 = unlimited
+        bool throttled;
+    };
+
+private:
+    struct ClientBucket
+    {
+        std::map<int, long long> transferred; // bytes, by transfer tag
+        std::set<int> paused; // tags paused by the scheduler
+        std::set<int> userOwned; // tags paused or resumed by the user, left alone while throttled
+        double tokens = 0;
+        long long consumed = 0; // bytes since last tick
+        double rate = 0; // observed bytes per second
+        long long allowed = 0;
+        bool throttled = false;
+    };
+
+    std::mutex schedulerMutex;
+    std::string scheduleText;
+    std::vector<Window> windows;
+    int activeWindow = -1;
+    long long appliedLimits[2] = {-1, -1}; // as last set in the SDK, by transfer type
+    std::map<std::pair<int, int>, ClientBucket> buckets; // by transfer type and clientID
+    std::chrono::steady_clock::time_point lastTick;
+
+    ClientBucket *getBucket(int clientID, ::mega::MegaTransfer *transfer);
+
+public:
+    /**
+     * @brief Parses a comma separated list of windows "HH:MM-HH:MM=LIMIT" or "HH:MM-HH:MM=DOWNLIMIT/UPLIMIT"
+     * @return false if the text is not a valid schedule
+     */
+    static bool parseSchedule(const std::string &text, std::vector<Window> &windows);
+    static std::string windowToString(const Window &window, bool humanreadable);
+
+    /**
+     * @brief Sets in the SDK the limits that correspond to the current time, if they changed
+     */
+    void apply(::mega::MegaApi *api);
+
+    /**
+     * @brief Applies the schedule, refills the token buckets and pauses/resumes transfers accordingly.
+     * To be called periodically.
+     */
+    void tick(::mega::MegaApi *api);
+
+    void onTransferStart(int clientID, ::mega::MegaTransfer *transfer);
+    void onTransferUpdate(int clientID, ::mega::MegaTransfer *transfer);
+    void onTransferFinish(int clientID, ::mega::MegaTransfer *transfer);
+
+    /**
+     * @brief Forgets a pause made by the scheduler on a transfer the user paused or resumed
+     */
+    void onUserPause(int tag);
+
+    std::vector<Window> getSchedule(int *active = NULL);
+    std::vector<ClientUsage> getUsage();
+};
+
+/**
+ * @brief The TransferQueueScheduler class decides which queued transfers the SDK starts next.
+ *
+ * Queued transfers are ranked by explicit priority (higher first), then by deadline (earlier first)
+ * and then by the policy in "transfer_queue_policy": the order they were requested (fifo), smaller
+ * ones first (shortest-first) or taking turns among the clients that requested them (fair-share).
+ * The queue of the SDK is rearranged to match by moving queued transfers, and the time each transfer
+ * waited before starting is recorded.
+ */
+class TransferQueueScheduler
+{
+public:
+    enum Policy
+    {
+        POLICY_FIFO,
+        POLICY_SHORTEST_FIRST,
+        POLICY_FAIR_SHARE
+    };
+
+    struct QueuedTransfer
+    {
+        int tag;
+        int type; // MegaTransfer::TYPE_DOWNLOAD or MegaTransfer::TYPE_UPLOAD
+        int clientID; // -1 for background and sync transfers
+        long long size = 0;
+        int priority = 0; // higher first
+        ::mega::m_time_t deadline = 0; // 0 = none
+        unsigned long long sequence; // order MEGAcmd first knew of it
+        unsigned long long queuePosition = 0; // in the queue of the SDK (MegaTransfer::getPriority): ties are ranked by it
+        std::chrono::steady_clock::time_point queuedAt;
+        bool started = false;
+        bool finished = false;
+        long long waitMs = 0; // time queued before starting (so far, if not started yet)
+    };
+
+private:
+    std::mutex queueMutex;
+    std::map<int, QueuedTransfer> transfers; // by tag
+    std::deque<QueuedTransfer> history; // the last ones finished, most recent first
+    unsigned long long nextSequence = 0;
+    unsigned long long waits = 0;
+    long long waitTotalMs = 0;
+    long long waitMaxMs = 0;
+    unsigned long long moves = 0;
+
+    QueuedTransfer *getRecord(int clientID, ::mega::MegaTransfer *transfer);
+    void markStarted(QueuedTransfer &record);
+    void forget(std::map<int, QueuedTransfer>::iterator it);
+    std::vector<int> rank(int type, const std::vector<int> &queued, Policy policy);
+    bool isReorderingNeeded(Policy policy);
+
+public:
+    static bool parsePolicy(const std::string &text, Policy &policy);
+    static std::string policyToString(Policy policy);
+    static Policy getPolicy();
+
+    /**
+     * @brief Moves the queued transfers of the SDK into the order they should start.
+     * To be called periodically. Unless forced (to know about all the transfers queued), the queue of the SDK
+     * is only listed if there is an order to apply: a policy other than fifo, or a priority or deadline set
+     */
+    void reorder(::mega::MegaApi *api, bool force = false);
+
+    void onTransferStart(int clientID, ::mega::MegaTransfer *transfer, int priority = 0, ::mega::m_time_t deadline = 0);
+    void onTransferUpdate(int clientID, ::mega::MegaTransfer *transfer);
+    void onTransferFinish(int clientID, ::mega::MegaTransfer *transfer);
+
+    /**
+     * @brief Sets the priority and deadline of a transfer already in the queue
+     */
+    void setPriority(::mega::MegaTransfer *transfer, int priority, ::mega::m_time_t deadline);
+
+    /**
+     * @brief Gets the transfers being tracked: started ones first, then the queued ones in the order
+     * they would start, and then (if includeFinished) the last ones finished
+     */
+    std::vector<QueuedTransfer> getTransfers(bool includeFinished);
+    void getWaitStats(unsigned long long *count, long long *averageMs, long long *maxMs, unsigned long long *moved);
+};
+
 class MegaCmdSandbox
 {
 private:
@@ -43,7 +269,6 @@ public:
     bool istemporalbandwidthvalid;
     long long temporalbandwidth;
     long long temporalbandwithinterval;
-    ::mega::m_time_t lastQuerytemporalBandwith;
     ::mega::m_time_t timeOfOverquota;
     ::mega::m_time_t secondsOverQuota;
 
@@ -56,6 +281,12 @@ public:
 
     MegaCmdExecuter * cmdexecuter = nullptr;
 
+    NodePathCache nodePathCache;
+    MediaInfoCache mediaInfoCache;
+    AccountDetailsCache accountDetails;
+    BandwidthScheduler bandwidthScheduler;
+    TransferQueueScheduler transferQueue;
+
 public:
     MegaCmdSandbox();
     bool isOverquota() const;
@@ -1761,7 +1761,8 @@ void process_line(const char * line)
                 }
                 else
                 {
-                    if ( words[0] == "get" || words[0] == "put" || words[0] == "reload")
+                    if ( words[0] == "get" || words[0] == "put" || words[0] == "reload" || words[0] == "deleteversions" || words[0] == "import"
+                         || words[0] == "prefetch")
                     {
                         string s = commandtoexec;
                         if (clientID.size())
@@ -62,6 +62,8 @@
 #define INVALID_SOCKET -1
 #endif
 
+#define RECEIVE_BUFFER_SIZE (1024 * 1024)
+
 #ifndef ENOTCONN
 #define ENOTCONN 107
 #endif
@@ -565,6 +567,126 @@ string unescapeutf16escapedseqs(const char *what)
 #endif
 
 
+#ifndef _WIN32
+bool MegaCmdShellCommunications::writeOutput(OUTSTREAMTYPE &output, const char *data, size_t size)
+{
+    if (&output != &COUT)
+    {
+        output.write(data, size);
+        output.flush();
+        return output.good();
+    }
+
+    // write stdout directly: binary safe and without the overhead of iostreams
+    output.flush();
+    while (size)
+    {
+        ssize_t n = write(STDOUT_FILENO, data, size);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+/**
+ * @brief Moves output from the socket to stdout without copying it into user space, when stdout is a pipe
+ * @return the bytes moved, or -1 if it cannot be done (and nothing was moved)
+ */
+long long MegaCmdShellCommunications::spliceToStdout(SOCKET socket, size_t size, bool untilClosed)
+{
+#if defined(__linux__) && defined(SPLICE_F_MOVE)
+    static int stdoutIsPipe = -1;
+    if (stdoutIsPipe == -1)
+    {
+        struct stat st;
+        stdoutIsPipe = !fstat(STDOUT_FILENO, &st) && S_ISFIFO(st.st_mode);
+    }
+    if (!stdoutIsPipe)
+    {
+        return -1;
+    }
+
+    COUT.flush();
+    long long moved = 0;
+    while (untilClosed || size)
+    {
+        ssize_t n = splice(socket, NULL, STDOUT_FILENO, NULL, untilClosed ? RECEIVE_BUFFER_SIZE : size, SPLICE_F_MOVE | SPLICE_F_MORE);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && !moved)
+        {
+            stdoutIsPipe = 0; // not supported for this socket or pipe: do not try again
+            return -1;
+        }
+        if (n <= 0)
+        {
+            break;
+        }
+        moved += n;
+        if (!untilClosed)
+        {
+            size -= n;
+        }
+    }
+    return moved;
+#else
+    return -1;
+#endif
+}
+
+/**
+ * @brief Reads output from the socket (size bytes, or until it is closed) and writes it into output
+ */
+bool MegaCmdShellCommunications::receiveOutput(SOCKET socket, OUTSTREAMTYPE &output, size_t size, bool untilClosed)
+{
+    if (&output == &COUT)
+    {
+        long long moved = spliceToStdout(socket, size, untilClosed);
+        if (moved >= 0)
+        {
+            return untilClosed || (size_t)moved == size;
+        }
+    }
+
+    if (receiveBuffer.size() < RECEIVE_BUFFER_SIZE)
+    {
+        receiveBuffer.resize(RECEIVE_BUFFER_SIZE);
+    }
+
+    while (untilClosed || size)
+    {
+        ssize_t n = recv(socket, receiveBuffer.data(), untilClosed ? receiveBuffer.size() : min(size, receiveBuffer.size()), MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return untilClosed && !n;
+        }
+        if (!writeOutput(output, receiveBuffer.data(), n))
+        {
+            return false;
+        }
+        if (!untilClosed)
+        {
+            size -= n;
+        }
+    }
+    return true;
+}
+#endif
+
 int MegaCmdShellCommunications::executeCommandW(wstring wcommand, std::string (*readresponse)(const char *), OUTSTREAMTYPE &output, bool interactiveshell)
 {
     return executeCommand("", readresponse, output, interactiveshell, wcommand);
@@ -645,6 +767,14 @@ int MegaCmdShellCommunications::executeCommand(string command, std::string (*rea
             n = recv(newsockfd, (char *)&partialoutsize, sizeof(partialoutsize), MSG_NOSIGNAL);
             if (n && partialoutsize > 0)
             {
+#ifndef _WIN32
+                std::lock_guard<std::mutex> g(megaCmdStdoutputing);
+                if (!receiveOutput(newsockfd, output, partialoutsize, false))
+                {
+                    cerr << "ERROR reading partial output: " << ERRNO << endl;
+                    return -1;
+                }
+#else
                 megaCmdStdoutputing.lock();
 
                 do{
@@ -670,6 +800,7 @@ int MegaCmdShellCommunications::executeCommand(string command, std::string (*rea
                     delete[] buffer;
                 } while(n != 0 && partialoutsize && n !=SOCKET_ERROR);
                 megaCmdStdoutputing.unlock();
+#endif
             }
             else
             {
@@ -728,6 +859,7 @@ int MegaCmdShellCommunications::executeCommand(string command, std::string (*rea
         }
     }
 
+#ifdef _WIN32
     int BUFFERSIZE = 1024;
     char buffer[1025];
     do{
@@ -736,7 +868,6 @@ int MegaCmdShellCommunications::executeCommand(string command, std::string (*rea
         {
             megaCmdStdoutputing.lock();
 
-#ifdef _WIN32
             buffer[n]='\0';
 
             wstring wbuffer;
@@ -744,15 +875,28 @@ int MegaCmdShellCommunications::executeCommand(string command, std::string (*rea
             int oldmode = _setmode(_fileno(stdout), _O_U16TEXT);
             output << wbuffer;
             _setmode(_fileno(stdout), oldmode);
-#else
-            if (n != 1 || buffer[0] != 0) //To avoid outputing 0 char in binary outputs
-            {
-                output << string(buffer,n) << flush;
-            }
-#endif
             megaCmdStdoutputing.unlock();
         }
     } while(n != 0 && n !=SOCKET_ERROR);
+#else
+    // the server sends a single 0 char for empty outputs: it is not to be output
+    char first;
+    n = recv(newsockfd, &first, 1, MSG_NOSIGNAL);
+    if (n == 1)
+    {
+        char second;
+        int more = recv(newsockfd, &second, 1, MSG_NOSIGNAL | MSG_PEEK);
+        std::lock_guard<std::mutex> g(megaCmdStdoutputing);
+        if ((first || more > 0) && !writeOutput(output, &first, 1))
+        {
+            n = SOCKET_ERROR;
+        }
+        else if (more > 0 && !receiveOutput(newsockfd, output, 0, true))
+        {
+            n = SOCKET_ERROR;
+        }
+    }
+#endif
 
     if (n == SOCKET_ERROR)
     {
@@ -27,6 +27,7 @@
 #include <string>
 #include <iostream>
 #include <mutex>
+#include <vector>
 
 #ifdef _WIN32
 #include <WinSock2.h>
@@ -135,6 +136,14 @@ private:
     static bool socketValid(SOCKET socket);
     static void closeSocket(SOCKET socket);
 
+#ifndef _WIN32
+    std::vector<char> receiveBuffer; // reused for all the output received
+
+    bool writeOutput(OUTSTREAMTYPE &output, const char *data, size_t size);
+    bool receiveOutput(SOCKET socket, OUTSTREAMTYPE &output, size_t size, bool untilClosed);
+    long long spliceToStdout(SOCKET socket, size_t size, bool untilClosed);
+#endif
+
     static void *listenToStateChangesEntry(void *slsc);
     static int listenToStateChanges(int receiveSocket, void (*statechangehandle)(std::string) = NULL);
 
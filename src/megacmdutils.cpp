@@ -17,6 +17,7 @@
  */
 
 #include "megacmdutils.h"
+#include "configurationmanager.h"
 
 #ifdef USE_PCRE
 #include <pcrecpp.h>
@@ -27,11 +28,23 @@
 #ifdef _WIN32
 #else
 #include <sys/ioctl.h> // console size
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
 #endif
 
 #include <iomanip>
 #include <fstream>
+#include <cstdio>
 #include <time.h>
+#include <algorithm>
 
 using namespace mega;
 
@@ -464,6 +477,25 @@ const char * getProxyTypeStr(int proxyType)
 
 }
 
+const char * getNodeTypeStr(int nodeType)
+{
+    switch (nodeType)
+    {
+    case MegaNode::TYPE_FILE:
+        return "file";
+    case MegaNode::TYPE_FOLDER:
+        return "folder";
+    case MegaNode::TYPE_ROOT:
+        return "root";
+    case MegaNode::TYPE_INCOMING:
+        return "inbox";
+    case MegaNode::TYPE_RUBBISH:
+        return "rubbish";
+    default:
+        return "unknown";
+    }
+}
+
 int getLinkType(string link)
 {
     if (link.find("/folder/") != string::npos)
@@ -1167,7 +1199,7 @@ bool nodeNameIsVersion(string &nodeName)
     return isversion;
 }
 
-bool setOptionsAndFlags(map<string, string> *opts, map<string, int> *flags, vector<string> *ws, set<string> vvalidOptions, bool global)
+bool setOptionsAndFlags(map<string, string> *opts, map<string, int> *flags, vector<string> *ws, const set<string> &vvalidOptions, bool global)
 {
     bool discarded = false;
 
@@ -1275,4 +1307,1626 @@ int permissionsFromReadable(string permissions)
 }
 #endif
 
+bool getOutputFormat(map<string, string> *cloptions, MegaCmdOutputFormat *format)
+{
+    string output = getOption(cloptions, "output", "");
+    if (output.empty() || output == "human")
+    {
+        *format = MCMDOUTPUT_HUMAN;
+    }
+    else if (output == "ndjson")
+    {
+        *format = MCMDOUTPUT_NDJSON;
+    }
+    else
+    {
+        LOG_err << "Invalid output format: " << output << ". Valid formats are: human, ndjson";
+        return false;
+    }
+    return true;
+}
+
+string jsonEscape(const string &what)
+{
+    static const char hexdigits[] = "0123456789abcdef";
+    string escaped;
+    escaped.reserve(what.size() + 2);
+    for (char c : what)
+    {
+        switch (c)
+        {
+        case '"':
+            escaped.append("\\\"");
+            break;
+        case '\\':
+            escaped.append("\\\\");
+            break;
+        case '\n':
+            escaped.append("\\n");
+            break;
+        case '\r':
+            escaped.append("\\r");
+            break;
+        case '\t':
+            escaped.append("\\t");
+            break;
+        default:
+            if ((unsigned char)c < 0x20) // other control characters. UTF-8 sequences are kept as they are
+            {
+                escaped.append("\\u00");
+                escaped.push_back(hexdigits[(unsigned char)c >> 4]);
+                escaped.push_back(hexdigits[(unsigned char)c & 0x0f]);
+            }
+            else
+            {
+                escaped.push_back(c);
+            }
+            break;
+        }
+    }
+    return escaped;
+}
+
+NdjsonLine::NdjsonLine()
+{
+    line.reserve(256);
+    line.push_back('{');
+}
+
+void NdjsonLine::addKey(const char *key)
+{
+    if (line.size() > 1)
+    {
+        line.push_back(',');
+    }
+    line.push_back('"');
+    line.append(key);
+    line.append("\":");
+}
+
+NdjsonLine &NdjsonLine::addString(const char *key, const string &value)
+{
+    addKey(key);
+    line.push_back('"');
+    line.append(jsonEscape(value));
+    line.push_back('"');
+    return *this;
+}
+
+NdjsonLine &NdjsonLine::addNumber(const char *key, long long value)
+{
+    addKey(key);
+    line.append(std::to_string(value));
+    return *this;
+}
+
+NdjsonLine &NdjsonLine::addBool(const char *key, bool value)
+{
+    addKey(key);
+    line.append(value ? "true" : "false");
+    return *this;
+}
+
+string NdjsonLine::str()
+{
+    return line + "}\n";
+}
+
+
+const size_t NodePathCache::ARENA_CHUNK_SIZE = 64 * 1024;
+const size_t NodePathCache::MAX_ARENA_SIZE = 64 * 1024 * 1024;
+
+const char *NodePathCache::intern(const string &path)
+{
+    size_t required = path.size() + 1;
+    if (arenaChunks.empty() || (arenaChunkUsed + required) > ARENA_CHUNK_SIZE)
+    {
+        size_t chunksize = max(ARENA_CHUNK_SIZE, required);
+        arenaChunks.push_back(std::unique_ptr<char[]>(new char[chunksize]));
+        arenaChunkUsed = (chunksize == ARENA_CHUNK_SIZE) ? 0 : ARENA_CHUNK_SIZE; // oversized chunks are not reused
+        arenaSize += chunksize;
+        if (chunksize != ARENA_CHUNK_SIZE)
+        {
+            char *dest = arenaChunks.back().get();
+            memcpy(dest, path.c_str(), required);
+            return dest;
+        }
+    }
+
+    char *dest = arenaChunks.back().get() + arenaChunkUsed;
+    memcpy(dest, path.c_str(), required);
+    arenaChunkUsed += required;
+    return dest;
+}
+
+void NodePathCache::doClear()
+{
+    entries.clear();
+    arenaChunks.clear();
+    arenaChunkUsed = 0;
+    arenaSize = 0;
+    generation++;
+}
+
+string NodePathCache::getNodePath(MegaApi *api, MegaNode *n)
+{
+    if (!n)
+    {
+        return string();
+    }
+
+    unsigned long long startgeneration;
+    {
+        std::lock_guard<std::mutex> g(cacheMutex);
+        startgeneration = generation;
+        auto it = entries.find(n->getHandle());
+        if (it != entries.end())
+        {
+            hits++;
+            return string(it->second.path, it->second.length);
+        }
+        misses++;
+    }
+
+    // Notice: the SDK is not queried while holding cacheMutex: node updates (that invalidate entries)
+    // are received from the SDK thread, and that would lead to deadlocks.
+    string path;
+    std::unique_ptr<MegaNode> parent;
+    if (n->getName() && !n->isInShare() && n->getParentHandle() != UNDEF)
+    {
+        parent.reset(api->getNodeByHandle(n->getParentHandle()));
+    }
+
+    if (parent)
+    {
+        path = getNodePath(api, parent.get());
+    }
+
+    if (path.size())
+    {
+        if (path.back() != '/')
+        {
+            path.append("/");
+        }
+        path.append(n->getName());
+    }
+    else // root nodes, inshares or nodes without accessible parent
+    {
+        std::unique_ptr<char[]> nodepath(api->getNodePath(n));
+        if (!nodepath)
+        {
+            return path;
+        }
+        path = nodepath.get();
+    }
+
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (startgeneration == generation) // discard if invalidated meanwhile
+    {
+        if (arenaSize > MAX_ARENA_SIZE)
+        {
+            doClear(); // entries will be repopulated from the ancestors on
+            return path;
+        }
+        PathEntry entry;
+        entry.path = intern(path);
+        entry.length = path.size();
+        entries[n->getHandle()] = entry;
+    }
+    return path;
+}
+
+string NodePathCache::getNodePath(MegaApi *api, MegaHandle h)
+{
+    std::unique_ptr<MegaNode> n(api->getNodeByHandle(h));
+    return getNodePath(api, n.get());
+}
+
+void NodePathCache::invalidate(MegaNodeList *nodes)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (!nodes) //initial update or too many changes
+    {
+        doClear();
+        return;
+    }
+
+    for (int i = 0; i < nodes->size(); i++)
+    {
+        MegaNode *n = nodes->get(i);
+        if (!n->hasChanged(MegaNode::CHANGE_TYPE_REMOVED) && !n->hasChanged(MegaNode::CHANGE_TYPE_ATTRIBUTES)
+                && !n->hasChanged(MegaNode::CHANGE_TYPE_PARENT) && !n->hasChanged(MegaNode::CHANGE_TYPE_INSHARE))
+        {
+            continue;
+        }
+
+        auto it = entries.find(n->getHandle());
+        if (it == entries.end())
+        {
+            continue;
+        }
+
+        if (n->getType() == MegaNode::TYPE_FILE)
+        {
+            entries.erase(it);
+        }
+        else // descendants' paths were composed from this one
+        {
+            doClear();
+            return;
+        }
+    }
+}
+
+void NodePathCache::clear()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    doClear();
+}
+
+unsigned long long NodePathCache::getHits()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return hits;
+}
+
+unsigned long long NodePathCache::getMisses()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return misses;
+}
+
+MediaInfoCache::MediaInfo MediaInfoCache::getMediaInfo(MegaNode *n)
+{
+    MediaInfo info;
+    info.width = n->getWidth();
+    info.height = n->getHeight();
+    info.playtime = n->getDuration();
+
+    std::unique_ptr<char[]> fattrs {n->getFileAttrString()};
+    if (!fattrs || n->getType() != MegaNode::TYPE_FILE)
+    {
+        return info;
+    }
+
+    {
+        std::lock_guard<std::mutex> g(cacheMutex);
+        auto it = entries.find(n->getHandle());
+        if (it != entries.end() && it->second.fileAttributes == fattrs.get())
+        {
+            hits++;
+            return it->second.info;
+        }
+        misses++;
+    }
+
+    MediaProperties mp = MediaProperties::decodeMediaPropertiesAttributes(fattrs.get(), (uint32_t*)(n->getNodeKey()->data() + FILENODEKEYLENGTH / 2));
+    info.fps = int(mp.fps);
+    info.shortformat = int(mp.shortformat);
+    info.containerid = int(mp.containerid);
+    info.videocodecid = int(mp.videocodecid);
+    info.audiocodecid = int(mp.audiocodecid);
+    info.hasAttributes = true;
+
+    size_t maxEntries = size_t(std::max(1, ConfigurationManager::getConfigurationValue("mediainfo_cache_max", 500000)));
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (entries.size() >= maxEntries)
+    {
+        entries.clear();
+    }
+    Entry &entry = entries[n->getHandle()];
+    entry.fileAttributes = fattrs.get();
+    entry.info = info;
+    return info;
+}
+
+void MediaInfoCache::clear()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    entries.clear();
+}
+
+unsigned long long MediaInfoCache::getHits()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return hits;
+}
+
+unsigned long long MediaInfoCache::getMisses()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return misses;
+}
+
+std::atomic<long long> ExclusionMatcher::prunedEntries(0);
+std::atomic<long long> ExclusionMatcher::prunedBytes(0);
+
+ExclusionMatcher::ExclusionMatcher(const std::set<string> &patterns)
+{
+    for (auto &pattern : patterns)
+    {
+        size_t firstWildcard = pattern.find_first_of("*?");
+        if (firstWildcard == string::npos)
+        {
+            literals.insert(pattern);
+        }
+        else if (firstWildcard == 0 && pattern.size() > 1 && pattern.find_first_of("*?", 1) == string::npos && pattern[0] == '*')
+        {
+            suffixes.insert(pattern.substr(1));
+            suffixLengths.insert(pattern.size() - 1);
+        }
+        else if (firstWildcard == pattern.size() - 1 && pattern[firstWildcard] == '*')
+        {
+            prefixes.insert(pattern.substr(0, firstWildcard));
+            prefixLengths.insert(firstWildcard);
+        }
+        else
+        {
+            globStarts.push_back(globStates.size());
+            for (size_t i = 0; i < pattern.size(); i++)
+            {
+                if (pattern[i] == '*')
+                {
+                    if (globStates.size() == globStarts.back() || globStates.back().type != GLOB_STAR)
+                    {
+                        globStates.push_back(GlobState{GLOB_STAR, 0});
+                    }
+                }
+                else
+                {
+                    globStates.push_back(GlobState{pattern[i] == '?' ? GLOB_ANY : GLOB_CHAR, pattern[i]});
+                }
+            }
+            globStates.push_back(GlobState{GLOB_ACCEPT, 0});
+        }
+    }
+}
+
+bool ExclusionMatcher::empty() const
+{
+    return literals.empty() && prefixes.empty() && suffixes.empty() && globStarts.empty();
+}
+
+bool ExclusionMatcher::matchesGlobs(const string &name) const
+{
+    // simulates all the patterns at once: the active states are those reachable with the characters consumed so far
+    vector<size_t> active, next;
+    vector<size_t> seen(globStates.size(), string::npos);
+    auto activate = [this, &seen](vector<size_t> &states, size_t state, size_t step)
+    {
+        while (seen[state] != step)
+        {
+            seen[state] = step;
+            states.push_back(state);
+            if (globStates[state].type != GLOB_STAR)
+            {
+                break;
+            }
+            state++; // a star may match nothing
+        }
+    };
+
+    for (auto start : globStarts)
+    {
+        activate(active, start, 0);
+    }
+    for (size_t i = 0; i < name.size() && !active.empty(); i++)
+    {
+        next.clear();
+        for (auto state : active)
+        {
+            const GlobState &s = globStates[state];
+            if (s.type == GLOB_STAR)
+            {
+                activate(next, state, i + 1);
+            }
+            else if (s.type == GLOB_ANY || (s.type == GLOB_CHAR && s.c == name[i]))
+            {
+                activate(next, state + 1, i + 1);
+            }
+        }
+        active.swap(next);
+    }
+
+    for (auto state : active)
+    {
+        if (globStates[state].type == GLOB_ACCEPT)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ExclusionMatcher::matches(const string &name) const
+{
+    if (literals.count(name))
+    {
+        return true;
+    }
+    for (auto length : prefixLengths)
+    {
+        if (length > name.size())
+        {
+            break;
+        }
+        if (prefixes.count(name.substr(0, length)))
+        {
+            return true;
+        }
+    }
+    for (auto length : suffixLengths)
+    {
+        if (length > name.size())
+        {
+            break;
+        }
+        if (suffixes.count(name.substr(name.size() - length)))
+        {
+            return true;
+        }
+    }
+    return !globStarts.empty() && matchesGlobs(name);
+}
+
+bool ExclusionMatcher::prune(const string &name, long long bytes) const
+{
+    if (!matches(name))
+    {
+        return false;
+    }
+    prunedEntries++;
+    prunedBytes += bytes;
+    return true;
+}
+
+long long ExclusionMatcher::getPrunedEntries()
+{
+    return prunedEntries;
+}
+
+long long ExclusionMatcher::getPrunedBytes()
+{
+    return prunedBytes;
+}
+
+static const char FINGERPRINT_CACHE_MAGIC[8] = {'M', 'C', 'M', 'D', 'F', 'P', 'C', '2'};
+static const uint64_t FINGERPRINT_CACHE_INITIAL_CAPACITY = 1024;
+
+LocalFingerprintCache::~LocalFingerprintCache()
+{
+    flush();
+    unmap();
+#ifndef _WIN32
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+#endif
+}
+
+bool LocalFingerprintCache::map(uint64_t capacity)
+{
+    size_t newSize = sizeof(Header) + capacity * sizeof(Record);
+#ifdef _WIN32
+    storage.resize(newSize);
+    header = (Header *)storage.data();
+#else
+    if (newSize > mappedSize && ftruncate(fd, newSize))
+    {
+        LOG_err << "Could not grow local fingerprints cache " << cacheFile << ": " << strerror(errno);
+        return false;
+    }
+    void *mapping = mmap(NULL, newSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED)
+    {
+        LOG_err << "Could not map local fingerprints cache " << cacheFile << ": " << strerror(errno);
+        return false;
+    }
+    unmap();
+    header = (Header *)mapping;
+#endif
+    records = (Record *)(header + 1);
+    mappedSize = newSize;
+    header->capacity = capacity;
+    return true;
+}
+
+void LocalFingerprintCache::unmap()
+{
+#ifdef _WIN32
+    storage.clear();
+#else
+    if (header)
+    {
+        munmap(header, mappedSize);
+    }
+#endif
+    header = nullptr;
+    records = nullptr;
+    mappedSize = 0;
+}
+
+void LocalFingerprintCache::removeRecord(size_t i)
+{
+    index.erase(FileId(records[i].device, records[i].inode));
+    size_t last = header->count - 1;
+    if (i != last)
+    {
+        records[i] = records[last];
+        index[FileId(records[i].device, records[i].inode)] = i;
+    }
+    header->count--;
+}
+
+void LocalFingerprintCache::setKnownPath(const FileId &id, const string &localPath)
+{
+    string &known = knownPaths[id];
+    if (known != localPath)
+    {
+        known = localPath;
+        pathsChanged = true;
+    }
+}
+
+void LocalFingerprintCache::loadKnownPaths()
+{
+    ifstream fi((cacheFile + ".paths").c_str());
+    string line;
+    while (getline(fi, line))
+    {
+        // "device inode path"
+        char *end = NULL;
+        uint64_t device = strtoull(line.c_str(), &end, 10);
+        uint64_t inode = strtoull(end, &end, 10);
+        if (*end == ' ')
+        {
+            knownPaths[FileId(device, inode)] = end + 1;
+        }
+    }
+
+    // records of unknown paths could never be found to be stale
+    size_t dropped = 0;
+    for (size_t i = header->count; i-- > 0; )
+    {
+        if (!knownPaths.count(FileId(records[i].device, records[i].inode)))
+        {
+            removeRecord(i);
+            dropped++;
+        }
+    }
+    if (dropped)
+    {
+        LOG_debug << "Dropped " << dropped << " cached local fingerprints of unknown paths";
+        pathsChanged = true;
+    }
+}
+
+void LocalFingerprintCache::saveKnownPaths()
+{
+    string pathsFile = cacheFile + ".paths";
+    {
+        ofstream fo((pathsFile + ".tmp").c_str(), ios::out | ios::trunc);
+        for (size_t i = 0; i < header->count; i++)
+        {
+            auto it = knownPaths.find(FileId(records[i].device, records[i].inode));
+            if (it != knownPaths.end() && it->second.find('\n') == string::npos)
+            {
+                fo << it->first.first << " " << it->first.second << " " << it->second << "\n";
+            }
+        }
+        if (!fo)
+        {
+            LOG_err << "Could not save the paths of the local fingerprints cache: " << pathsFile;
+            return;
+        }
+    }
+    if (std::rename((pathsFile + ".tmp").c_str(), pathsFile.c_str()))
+    {
+        LOG_err << "Could not save the paths of the local fingerprints cache: " << pathsFile;
+        return;
+    }
+    pathsChanged = false;
+}
+
+void LocalFingerprintCache::load(const string &file)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (loaded && file == cacheFile)
+    {
+        return;
+    }
+
+    unmap();
+    index.clear();
+    knownPaths.clear();
+    pathsChanged = false;
+    cacheFile = file;
+    loaded = true;
+
+    size_t existingSize = 0;
+#ifdef _WIN32
+    ifstream fi(cacheFile.c_str(), ios::in | ios::binary);
+    if (fi.is_open())
+    {
+        storage.assign(std::istreambuf_iterator<char>(fi), std::istreambuf_iterator<char>());
+        existingSize = mappedSize = storage.size();
+        header = existingSize ? (Header *)storage.data() : nullptr;
+    }
+#else
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    fd = open(cacheFile.c_str(), O_RDWR | O_CREAT, 0600);
+    if (fd < 0)
+    {
+        LOG_err << "Could not open local fingerprints cache " << cacheFile << ": " << strerror(errno);
+        return;
+    }
+    struct stat st;
+    if (!fstat(fd, &st) && st.st_size >= (off_t)sizeof(Header))
+    {
+        void *mapping = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED)
+        {
+            header = (Header *)mapping;
+            existingSize = mappedSize = st.st_size;
+        }
+    }
+#endif
+
+    bool valid = header && existingSize >= sizeof(Header)
+            && !memcmp(header->magic, FINGERPRINT_CACHE_MAGIC, sizeof(FINGERPRINT_CACHE_MAGIC))
+            && header->recordSize == sizeof(Record)
+            && header->count <= header->capacity
+            && sizeof(Header) + header->capacity * sizeof(Record) <= existingSize;
+
+    if (valid)
+    {
+        records = (Record *)(header + 1);
+        for (size_t i = 0; i < header->count; i++)
+        {
+            index[FileId(records[i].device, records[i].inode)] = i;
+        }
+        loadKnownPaths();
+        LOG_debug << "Loaded " << header->count << " cached local fingerprints";
+        return;
+    }
+
+    if (header)
+    {
+        LOG_warn << "Discarding invalid local fingerprints cache: " << cacheFile;
+    }
+    unmap();
+    if (map(FINGERPRINT_CACHE_INITIAL_CAPACITY))
+    {
+        memcpy(header->magic, FINGERPRINT_CACHE_MAGIC, sizeof(FINGERPRINT_CACHE_MAGIC));
+        header->recordSize = sizeof(Record);
+        header->reserved = 0;
+        header->count = 0;
+    }
+}
+
+void LocalFingerprintCache::flush()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (!header)
+    {
+        return;
+    }
+#ifdef _WIN32
+    ofstream fo(cacheFile.c_str(), ios::out | ios::binary | ios::trunc);
+    if (!fo.is_open() || !fo.write(storage.data(), mappedSize)) // the whole capacity: load checks it is there
+    {
+        LOG_err << "Could not save local fingerprints cache: " << cacheFile;
+    }
+#else
+    msync(header, mappedSize, MS_ASYNC);
+#endif
+    if (pathsChanged)
+    {
+        saveKnownPaths();
+    }
+}
+
+bool LocalFingerprintCache::getFingerprint(const string &localPath, const LocalFingerprintKey &key, string *fingerprint)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (!header)
+    {
+        return false;
+    }
+
+    FileId id(key.device, key.inode);
+    setKnownPath(id, localPath);
+    auto it = index.find(id);
+    if (it == index.end())
+    {
+        misses++;
+        return false;
+    }
+
+    Record &record = records[it->second];
+    if (record.size != key.size || record.mtime != key.mtime)
+    {
+        removeRecord(it->second);
+        invalidations++;
+        misses++;
+        return false;
+    }
+
+    hits++;
+    *fingerprint = record.fingerprint;
+    return true;
+}
+
+void LocalFingerprintCache::setFingerprint(const string &localPath, const LocalFingerprintKey &key, const string &fingerprint)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (!header || fingerprint.size() >= FINGERPRINT_MAX_LENGTH)
+    {
+        return;
+    }
+
+    FileId id(key.device, key.inode);
+    setKnownPath(id, localPath);
+    size_t i;
+    auto it = index.find(id);
+    if (it != index.end())
+    {
+        i = it->second;
+    }
+    else
+    {
+        if (header->count == header->capacity && !map(header->capacity * 2))
+        {
+            return;
+        }
+        i = header->count++;
+        index[id] = i;
+    }
+
+    Record &record = records[i];
+    record.device = key.device;
+    record.inode = key.inode;
+    record.size = key.size;
+    record.mtime = key.mtime;
+    memset(record.fingerprint, 0, FINGERPRINT_MAX_LENGTH);
+    memcpy(record.fingerprint, fingerprint.data(), fingerprint.size());
+}
+
+size_t LocalFingerprintCache::verify(std::function<bool(const string &, LocalFingerprintKey *)> statPath)
+{
+    std::unordered_map<FileId, string, FileIdHash> paths;
+    {
+        std::lock_guard<std::mutex> g(cacheMutex);
+        paths = knownPaths;
+    }
+
+    // stat without holding the lock: this may take long for large trees
+    vector<pair<FileId, LocalFingerprintKey>> current;
+    vector<FileId> gone;
+    for (auto &p : paths)
+    {
+        LocalFingerprintKey key;
+        if (statPath(p.second, &key) && FileId(key.device, key.inode) == p.first)
+        {
+            current.push_back(std::make_pair(p.first, key));
+        }
+        else
+        {
+            gone.push_back(p.first);
+        }
+    }
+
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (!header)
+    {
+        return 0;
+    }
+
+    size_t dropped = 0;
+    for (auto &id : gone)
+    {
+        knownPaths.erase(id);
+        pathsChanged = true;
+        auto it = index.find(id);
+        if (it != index.end())
+        {
+            removeRecord(it->second);
+            dropped++;
+        }
+    }
+    for (auto &c : current)
+    {
+        auto it = index.find(c.first);
+        if (it != index.end() && (records[it->second].size != c.second.size || records[it->second].mtime != c.second.mtime))
+        {
+            removeRecord(it->second);
+            dropped++;
+        }
+    }
+    invalidations += dropped;
+    return dropped;
+}
+
+size_t LocalFingerprintCache::size()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return header ? header->count : 0;
+}
+
+unsigned long long LocalFingerprintCache::getHits()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return hits;
+}
+
+unsigned long long LocalFingerprintCache::getMisses()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return misses;
+}
+
+unsigned long long LocalFingerprintCache::getInvalidations()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return invalidations;
+}
+
+LocalBlockCache::~LocalBlockCache()
+{
+    flush();
+}
+
+void LocalBlockCache::load(const string &folder)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (loaded && folder == cacheFolder)
+    {
+        return;
+    }
+
+    lru.clear();
+    blocks.clear();
+    files.clear();
+    usedBytes = 0;
+    cacheFolder = folder;
+    loaded = true;
+    limit = ConfigurationManager::getConfigurationValue("blockcache_size", 0ll);
+
+    MegaFileSystemAccess fsAccess;
+    fsAccess.setdefaultfolderpermissions(0700);
+    LocalPath localFolder = LocalPath::fromPath(cacheFolder, fsAccess);
+    std::unique_ptr<FileAccess> fa = fsAccess.newfileaccess();
+    if (!(fa->fopen(localFolder, true, false) && fa->type == FOLDERNODE) && !fsAccess.mkdirlocal(localFolder, false))
+    {
+        LOG_err << "Could not create block cache folder " << cacheFolder;
+        loaded = false;
+        return;
+    }
+
+    // index lines: "F handle size pinned fingerprint" for files and "B handle block length" for blocks, most recent first,
+    // followed by "E handle block" for the blocks evicted since it was saved
+    ifstream fi((cacheFolder + "/index").c_str(), ios::in);
+    string line;
+    while (std::getline(fi, line))
+    {
+        istringstream is(line);
+        char type = 0;
+        MegaHandle h = INVALID_HANDLE;
+        is >> type >> h;
+        if (type == 'F')
+        {
+            File file;
+            int pinned = 0;
+            is >> file.size >> pinned >> file.fingerprint;
+            if (!is.fail())
+            {
+                file.pinned = pinned;
+                file.fingerprint = (file.fingerprint == "-") ? string() : file.fingerprint;
+                files[h] = file;
+            }
+        }
+        else if (type == 'B')
+        {
+            long long block = -1;
+            size_t length = 0;
+            is >> block >> length;
+            BlockKey key(h, block);
+            auto fit = files.find(h);
+            if (is.fail() || fit == files.end() || blocks.count(key))
+            {
+                continue;
+            }
+            lru.push_back(key);
+            blocks[key] = Block{length, std::prev(lru.end())};
+            fit->second.blocks++;
+            usedBytes += length;
+        }
+        else if (type == 'E')
+        {
+            long long block = -1;
+            is >> block;
+            auto it = blocks.find(BlockKey(h, block));
+            if (!is.fail() && it != blocks.end())
+            {
+                usedBytes -= it->second.length;
+                lru.erase(it->second.lruPosition);
+                blocks.erase(it);
+                files[h].blocks--;
+            }
+        }
+    }
+
+    for (auto it = files.begin(); it != files.end(); )
+    {
+        if (!it->second.blocks && !it->second.pinned)
+        {
+            it = files.erase(it);
+        }
+        else
+        {
+            it++;
+        }
+    }
+    evict(); // the limit might have been lowered
+    LOG_debug << "Block cache loaded: " << blocks.size() << " blocks of " << files.size() << " files, " << usedBytes << " bytes";
+}
+
+void LocalBlockCache::saveIndex()
+{
+    ofstream fo((cacheFolder + "/index").c_str(), ios::out | ios::trunc);
+    if (!fo.is_open())
+    {
+        LOG_err << "Could not save block cache index in " << cacheFolder;
+        return;
+    }
+    for (auto &file : files)
+    {
+        fo << "F " << file.first << " " << file.second.size << " " << file.second.pinned << " "
+           << (file.second.fingerprint.size() ? file.second.fingerprint : "-") << "\n";
+    }
+    for (auto &key : lru)
+    {
+        fo << "B " << key.first << " " << key.second << " " << blocks[key].length << "\n";
+    }
+}
+
+void LocalBlockCache::flush()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (loaded)
+    {
+        saveIndex();
+    }
+}
+
+string LocalBlockCache::blockFile(MegaHandle h)
+{
+    ostringstream os;
+    os << cacheFolder << "/" << std::hex << h;
+    return os.str();
+}
+
+void LocalBlockCache::removeBlock(std::map<BlockKey, Block>::iterator it)
+{
+    MegaHandle h = it->first.first;
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+    // record the eviction first: otherwise, after a crash, the index would list the hole as the block.
+    // If it cannot be recorded, the contents are left in place, still valid for that index
+    ofstream fo((cacheFolder + "/index").c_str(), ios::out | ios::app);
+    fo << "E " << h << " " << it->first.second << "\n";
+    fo.close();
+    if (!fo.fail())
+    {
+        // give the space back, keeping the rest of the sparse file
+        int fd = open(blockFile(h).c_str(), O_WRONLY);
+        if (fd >= 0)
+        {
+            fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, it->first.second * BLOCK_SIZE, it->second.length);
+            close(fd);
+        }
+    }
+#endif
+    usedBytes -= it->second.length;
+    lru.erase(it->second.lruPosition);
+    blocks.erase(it);
+
+    auto fit = files.find(h);
+    if (fit != files.end() && !--fit->second.blocks && !fit->second.pinned)
+    {
+        files.erase(fit);
+        std::remove(blockFile(h).c_str());
+    }
+}
+
+void LocalBlockCache::removeFile(MegaHandle h)
+{
+    for (auto it = blocks.lower_bound(BlockKey(h, 0)); it != blocks.end() && it->first.first == h; )
+    {
+        usedBytes -= it->second.length;
+        lru.erase(it->second.lruPosition);
+        it = blocks.erase(it);
+    }
+    files.erase(h);
+    std::remove(blockFile(h).c_str());
+}
+
+void LocalBlockCache::dropIfChanged(MegaHandle h, const string &fingerprint, long long size)
+{
+    auto fit = files.find(h);
+    if (fit == files.end() || (fit->second.fingerprint == fingerprint && fit->second.size == size))
+    {
+        return;
+    }
+
+    LOG_debug << "Contents of " << h << " changed: dropping its cached blocks";
+    bool pinned = fit->second.pinned;
+    removeFile(h);
+    if (pinned)
+    {
+        File &file = files[h];
+        file.fingerprint = fingerprint;
+        file.size = size;
+        file.pinned = true;
+    }
+}
+
+void LocalBlockCache::evict()
+{
+    auto it = lru.end();
+    while (usedBytes > limit && it != lru.begin())
+    {
+        auto victim = std::prev(it);
+        auto fit = files.find(victim->first);
+        if (fit != files.end() && fit->second.pinned)
+        {
+            it = victim;
+            continue;
+        }
+        removeBlock(blocks.find(*victim));
+    }
+}
+
+bool LocalBlockCache::isEnabled()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return loaded && limit > 0;
+}
+
+long long LocalBlockCache::getLimit()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return limit;
+}
+
+void LocalBlockCache::setLimit(long long bytes)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    limit = std::max(0ll, bytes);
+    evict();
+}
+
+long long LocalBlockCache::blockLength(long long fileSize, long long block)
+{
+    return std::max(0ll, std::min(BLOCK_SIZE, fileSize - block * BLOCK_SIZE));
+}
+
+bool LocalBlockCache::hasBlock(MegaHandle h, const string &fingerprint, long long size, long long block, bool countMiss)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (!loaded || limit <= 0)
+    {
+        return false;
+    }
+    dropIfChanged(h, fingerprint, size);
+    if (blocks.count(BlockKey(h, block)))
+    {
+        return true;
+    }
+    misses += countMiss;
+    return false;
+}
+
+bool LocalBlockCache::readBlock(MegaHandle h, const string &fingerprint, long long size, long long block, string *data)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (!loaded || limit <= 0)
+    {
+        return false;
+    }
+    dropIfChanged(h, fingerprint, size);
+
+    auto it = blocks.find(BlockKey(h, block));
+    if (it == blocks.end())
+    {
+        misses++;
+        return false;
+    }
+
+    size_t length = it->second.length;
+    data->resize(length);
+    ifstream fi(blockFile(h).c_str(), ios::in | ios::binary);
+    fi.seekg(block * BLOCK_SIZE);
+    fi.read(&(*data)[0], length);
+    if (!fi || size_t(fi.gcount()) != length)
+    {
+        LOG_warn << "Cached block " << block << " of " << h << " could not be read: it will be downloaded again";
+        removeBlock(it);
+        misses++;
+        return false;
+    }
+
+    lru.splice(lru.begin(), lru, it->second.lruPosition);
+    hits++;
+    bytesSaved += length;
+    return true;
+}
+
+void LocalBlockCache::writeBlock(MegaHandle h, const string &fingerprint, long long size, long long block, const char *data, size_t length)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (!loaded || limit <= 0)
+    {
+        return;
+    }
+    dropIfChanged(h, fingerprint, size);
+    BlockKey key(h, block);
+    if (blocks.count(key))
+    {
+        return;
+    }
+
+    File &file = files[h];
+    file.fingerprint = fingerprint;
+    file.size = size;
+
+    string path = blockFile(h);
+    fstream fo(path.c_str(), ios::in | ios::out | ios::binary);
+    if (!fo.is_open())
+    {
+        fo.open(path.c_str(), ios::out | ios::binary);
+    }
+    fo.seekp(block * BLOCK_SIZE); // the gaps before it are left as holes
+    fo.write(data, length);
+    fo.close();
+    if (fo.fail())
+    {
+        LOG_warn << "Could not write into block cache file " << path;
+        if (!file.blocks && !file.pinned)
+        {
+            files.erase(h);
+        }
+        return;
+    }
+
+    lru.push_front(key);
+    blocks[key] = Block{length, lru.begin()};
+    file.blocks++;
+    usedBytes += length;
+    evict();
+}
+
+bool LocalBlockCache::setPinned(MegaHandle h, const string &fingerprint, long long size, bool pinned)
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    if (pinned)
+    {
+        long long pinnedBytes = size; // their blocks are never evicted: they have to fit altogether
+        for (auto &file : files)
+        {
+            pinnedBytes += (file.second.pinned && file.first != h) ? file.second.size : 0;
+        }
+        if (pinnedBytes > limit)
+        {
+            return false;
+        }
+
+        dropIfChanged(h, fingerprint, size);
+        File &file = files[h];
+        file.fingerprint = fingerprint;
+        file.size = size;
+        file.pinned = true;
+        return true;
+    }
+
+    auto fit = files.find(h);
+    if (fit != files.end())
+    {
+        fit->second.pinned = false;
+        if (!fit->second.blocks)
+        {
+            files.erase(fit);
+        }
+        evict();
+    }
+    return true;
+}
+
+vector<MegaHandle> LocalBlockCache::getPinned()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    vector<MegaHandle> pinned;
+    for (auto &file : files)
+    {
+        if (file.second.pinned)
+        {
+            pinned.push_back(file.first);
+        }
+    }
+    return pinned;
+}
+
+void LocalBlockCache::clear()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    vector<MegaHandle> handles;
+    for (auto &file : files)
+    {
+        handles.push_back(file.first);
+    }
+    for (auto h : handles)
+    {
+        removeFile(h);
+    }
+}
+
+long long LocalBlockCache::getUsedBytes()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return usedBytes;
+}
+
+size_t LocalBlockCache::getFileCount()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return files.size();
+}
+
+unsigned long long LocalBlockCache::getHits()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return hits;
+}
+
+unsigned long long LocalBlockCache::getMisses()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return misses;
+}
+
+unsigned long long LocalBlockCache::getBytesSaved()
+{
+    std::lock_guard<std::mutex> g(cacheMutex);
+    return bytesSaved;
+}
+
+LocalChangeJournal::LocalChangeJournal(const string &root)
+{
+    this->root = root;
+}
+
+LocalChangeJournal::~LocalChangeJournal()
+{
+#ifdef __linux__
+    stopping = true;
+    if (readerThread.joinable())
+    {
+        readerThread.join();
+    }
+    if (inotifyFd >= 0)
+    {
+        close(inotifyFd);
+    }
+#endif
+}
+
+void LocalChangeJournal::recordChange(const string &path)
+{
+    std::lock_guard<std::mutex> g(journalMutex);
+    if (overflowed)
+    {
+        return;
+    }
+    if (changedPaths.size() >= MAX_PENDING_CHANGES)
+    {
+        LOG_debug << "Too many changes pending in " << root << ": a full scan will be required";
+        overflowed = true;
+        changedPaths.clear();
+        return;
+    }
+    changedPaths.insert(path);
+}
+
+void LocalChangeJournal::setOverflowed()
+{
+    std::lock_guard<std::mutex> g(journalMutex);
+    overflowed = true;
+    changedPaths.clear();
+}
+
+#ifdef __linux__
+static const uint32_t JOURNAL_WATCH_MASK = IN_CREATE | IN_CLOSE_WRITE | IN_MODIFY | IN_ATTRIB | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO;
+
+void LocalChangeJournal::watchTree(const string &folder, bool recordFiles)
+{
+    int wd = inotify_add_watch(inotifyFd, folder.c_str(), JOURNAL_WATCH_MASK);
+    if (wd < 0)
+    {
+        // e.g: fs.inotify.max_user_watches reached: changes in this folder would go unnoticed
+        LOG_warn << "Could not watch local folder " << folder << ": " << strerror(errno);
+        setOverflowed();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> g(journalMutex);
+        watchedFolders[wd] = folder;
+    }
+
+    DIR *dir = opendir(folder.c_str());
+    if (!dir)
+    {
+        return;
+    }
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && !stopping)
+    {
+        if (!strcmp(entry->d_name, ".") || !strcmp(entry->d_name, ".."))
+        {
+            continue;
+        }
+
+        string path = folder + "/" + entry->d_name;
+        bool isFolder = entry->d_type == DT_DIR;
+        if (entry->d_type == DT_UNKNOWN)
+        {
+            struct stat st;
+            isFolder = !lstat(path.c_str(), &st) && S_ISDIR(st.st_mode);
+        }
+
+        if (isFolder)
+        {
+            watchTree(path, recordFiles);
+        }
+        else if (recordFiles)
+        {
+            recordChange(path);
+        }
+    }
+    closedir(dir);
+}
+
+void LocalChangeJournal::unwatchTree(const string &folder)
+{
+    vector<int> watches;
+    {
+        std::lock_guard<std::mutex> g(journalMutex);
+        for (auto it = watchedFolders.begin(); it != watchedFolders.end(); )
+        {
+            if (it->second == folder || !it->second.compare(0, folder.size() + 1, folder + "/"))
+            {
+                watches.push_back(it->first);
+                it = watchedFolders.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+    for (auto wd : watches)
+    {
+        inotify_rm_watch(inotifyFd, wd);
+    }
+}
+
+void LocalChangeJournal::readEvents()
+{
+    alignas(struct inotify_event) char buffer[64 * 1024];
+    while (!stopping)
+    {
+        struct pollfd pfd;
+        pfd.fd = inotifyFd;
+        pfd.events = POLLIN;
+        if (poll(&pfd, 1, 500) <= 0)
+        {
+            continue;
+        }
+
+        ssize_t len = read(inotifyFd, buffer, sizeof(buffer));
+        for (char *p = buffer; len > 0 && p < buffer + len; )
+        {
+            struct inotify_event *event = (struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + event->len;
+
+            string folder;
+            {
+                std::lock_guard<std::mutex> g(journalMutex);
+                events++;
+                auto it = watchedFolders.find(event->wd);
+                if (it != watchedFolders.end())
+                {
+                    folder = it->second;
+                    if (event->mask & IN_IGNORED)
+                    {
+                        watchedFolders.erase(it);
+                    }
+                }
+            }
+
+            if (event->mask & IN_Q_OVERFLOW)
+            {
+                LOG_debug << "Change events lost for " << root << ": a full scan will be required";
+                setOverflowed();
+                continue;
+            }
+            if (!folder.size() || (event->mask & IN_IGNORED))
+            {
+                continue;
+            }
+
+            string path = event->len ? folder + "/" + event->name : folder;
+            if ((event->mask & IN_ISDIR) && (event->mask & IN_MOVED_FROM))
+            {
+                // its watches would keep reporting the old paths: they are set again if moved within the tree
+                unwatchTree(path);
+            }
+            else if ((event->mask & IN_ISDIR) && (event->mask & (IN_CREATE | IN_MOVED_TO)))
+            {
+                watchTree(path, true); // its contents are new as well
+            }
+            else if (!(event->mask & IN_ISDIR))
+            {
+                recordChange(path);
+            }
+        }
+    }
+}
+#endif
+
+bool LocalChangeJournal::start()
+{
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+        LOG_warn << "Could not initialize change journal for " << root << ": " << strerror(errno);
+        return false;
+    }
+    watchTree(root, false);
+    LOG_debug << "Journaling changes of " << root << ": " << watchedFolders.size() << " folders watched";
+    readerThread = std::thread([this]() { readEvents(); });
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool LocalChangeJournal::takeChanges(std::set<string> *changed)
+{
+    std::lock_guard<std::mutex> g(journalMutex);
+    if (overflowed)
+    {
+        overflowed = false; // the caller will perform a full scan: new changes will be journaled from now on
+        changedPaths.clear();
+        return false;
+    }
+    changed->swap(changedPaths);
+    changedPaths.clear();
+    return true;
+}
+
+void LocalChangeJournal::recordFullScan(int64_t ms)
+{
+    std::lock_guard<std::mutex> g(journalMutex);
+    fullScans++;
+    lastFullScanMs = ms;
+}
+
+void LocalChangeJournal::recordIncrementalScan(int64_t ms)
+{
+    std::lock_guard<std::mutex> g(journalMutex);
+    incrementalScans++;
+    if (lastFullScanMs > ms)
+    {
+        avoidedScanMs += lastFullScanMs - ms;
+    }
+}
+
+size_t LocalChangeJournal::getPendingChanges()
+{
+    std::lock_guard<std::mutex> g(journalMutex);
+    return changedPaths.size();
+}
+
+unsigned long long LocalChangeJournal::getEvents()
+{
+    std::lock_guard<std::mutex> g(journalMutex);
+    return events;
+}
+
+unsigned long long LocalChangeJournal::getIncrementalScans()
+{
+    std::lock_guard<std::mutex> g(journalMutex);
+    return incrementalScans;
+}
+
+unsigned long long LocalChangeJournal::getFullScans()
+{
+    std::lock_guard<std::mutex> g(journalMutex);
+    return fullScans;
+}
+
+int64_t LocalChangeJournal::getAvoidedScanMs()
+{
+    std::lock_guard<std::mutex> g(journalMutex);
+    return avoidedScanMs;
+}
+
+FileSizeIndex::FileSizeIndex()
+    : seenOnce(new std::atomic<uint64_t>[FILTER_WORDS]())
+    , seenTwice(new std::atomic<uint64_t>[FILTER_WORDS]())
+{
+}
+
+void FileSizeIndex::count(int64_t size)
+{
+    size_t bit = std::hash<int64_t>()(size) % (FILTER_WORDS * 64);
+    uint64_t mask = uint64_t(1) << (bit % 64);
+    if (seenOnce[bit / 64].fetch_or(mask) & mask)
+    {
+        seenTwice[bit / 64].fetch_or(mask);
+    }
+}
+
+void FileSizeIndex::add(int64_t size, MegaHandle h)
+{
+    size_t bit = std::hash<int64_t>()(size) % (FILTER_WORDS * 64);
+    if (!(seenTwice[bit / 64].load() & (uint64_t(1) << (bit % 64))))
+    {
+        return; // a size of a single file
+    }
+
+    Shard &shard = shards[std::hash<int64_t>()(size) % NUM_SHARDS];
+    std::lock_guard<std::mutex> g(shard.shardMutex);
+    auto it = shard.groups.find(size);
+    if (it == shard.groups.end())
+    {
+        shard.groups[size].first = h;
+    }
+    else
+    {
+        it->second.others.push_back(h);
+    }
+}
+
+vector<pair<int64_t, vector<MegaHandle> > > FileSizeIndex::takeCandidates()
+{
+    vector<pair<int64_t, vector<MegaHandle> > > candidates;
+    for (auto &shard : shards)
+    {
+        std::lock_guard<std::mutex> g(shard.shardMutex);
+        for (auto &group : shard.groups)
+        {
+            if (group.second.others.size())
+            {
+                vector<MegaHandle> handles;
+                handles.reserve(group.second.others.size() + 1);
+                handles.push_back(group.second.first);
+                handles.insert(handles.end(), group.second.others.begin(), group.second.others.end());
+                candidates.push_back(std::make_pair(group.first, std::move(handles)));
+            }
+        }
+        std::unordered_map<int64_t, SizeGroup>().swap(shard.groups);
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [](const pair<int64_t, vector<MegaHandle> > &a, const pair<int64_t, vector<MegaHandle> > &b)
+    {
+        return a.first > b.first;
+    });
+    return candidates;
+}
+
 }//end namespace
@@ -23,6 +23,17 @@
 #include "megacmd.h"
 
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <set>
+#include <thread>
+#include <atomic>
 
 namespace megacmd {
 using ::mega::m_time_t;
@@ -60,6 +71,8 @@ std::string backupSatetStr(int backupstate);
 
 const char * getProxyTypeStr(int proxyType);
 
+const char * getNodeTypeStr(int nodeType);
+
 /* Files and folders */
 
 int getLinkType(std::string link);
@@ -116,7 +129,7 @@ bool nodeNameIsVersion(std::string &nodeName);
 
 /* Flags and Options */
 bool setOptionsAndFlags(std::map<std::string, std::string> *opts, std::map<std::string, int> *flags, std::vector<std::string> *ws,
-                        std::set<std::string> vvalidOptions, bool global = false);
+                        const std::set<std::string> &vvalidOptions, bool global = false);
 
 bool getMinAndMaxSize(std::string sizestring, int64_t *minSize, int64_t *maxSize);
 
@@ -124,5 +137,467 @@ bool getMinAndMaxSize(std::string sizestring, int64_t *minSize, int64_t *maxSize
 std::string readablePermissions(int permvalue);
 int permissionsFromReadable(std::string permissions);
 
+/* Structured output */
+enum MegaCmdOutputFormat
+{
+    MCMDOUTPUT_HUMAN,
+    MCMDOUTPUT_NDJSON,
+};
+
+bool getOutputFormat(std::map<std::string, std::string> *cloptions, MegaCmdOutputFormat *format);
+
+std::string jsonEscape(const std::string &what);
+
+/**
+ * @brief The NdjsonLine class composes a compact JSON object, to be output as a single line of NDJSON.
+ *
+ * Members are appended in order, without any intermediate structure, and str() closes the object.
+ */
+class NdjsonLine
+{
+private:
+    std::string line;
+    void addKey(const char *key);
+
+public:
+    NdjsonLine();
+    NdjsonLine &addString(const char *key, const std::string &value);
+    NdjsonLine &addNumber(const char *key, long long value);
+    NdjsonLine &addBool(const char *key, bool value);
+    std::string str();
+};
+
+
+/**
+ * @brief The NodePathCache class renders remote paths of nodes avoiding walking
+ * all the way up to the root for each node.
+ *
+ * The path of a node is composed from the cached path of its parent, so listing
+ * thousands of siblings only asks the SDK for the path of their common ancestor.
+ * Paths are stored in an append-only arena, that is reclaimed as a whole when
+ * cleared or when it grows beyond a limit.
+ *
+ * Entries are invalidated from node updates: renaming/moving/removing a file
+ * drops its entry, whereas doing so on a folder drops the whole cache (its
+ * descendants' paths are no longer valid).
+ *
+ * It is only meant to be used with the main MegaApi.
+ */
+class NodePathCache
+{
+private:
+    struct PathEntry
+    {
+        const char *path;
+        size_t length;
+    };
+
+    static const size_t ARENA_CHUNK_SIZE;
+    static const size_t MAX_ARENA_SIZE;
+
+    std::mutex cacheMutex;
+    std::unordered_map<mega::MegaHandle, PathEntry> entries;
+    std::vector<std::unique_ptr<char[]>> arenaChunks;
+    size_t arenaChunkUsed = 0;
+    size_t arenaSize = 0;
+    unsigned long long generation = 0;
+
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+
+    const char *intern(const std::string &path);
+    void doClear();
+
+public:
+    std::string getNodePath(mega::MegaApi *api, mega::MegaNode *n);
+    std::string getNodePath(mega::MegaApi *api, mega::MegaHandle h);
+
+    void invalidate(mega::MegaNodeList *nodes);
+    void clear();
+
+    unsigned long long getHits();
+    unsigned long long getMisses();
+};
+
+/**
+ * @brief The MediaInfoCache class keeps the media attributes decoded from file nodes, by handle.
+ *
+ * Entries are checked against the file attributes of the nodes, so they are only decoded
+ * again when those change. The cache is emptied when it reaches "mediainfo_cache_max" entries.
+ */
+class MediaInfoCache
+{
+public:
+    struct MediaInfo
+    {
+        int width = -1;
+        int height = -1;
+        int fps = 0;
+        int playtime = -1; // seconds
+        int shortformat = 0;
+        int containerid = 0;
+        int videocodecid = 0;
+        int audiocodecid = 0;
+        bool hasAttributes = false;
+    };
+
+private:
+    struct Entry
+    {
+        std::string fileAttributes;
+        MediaInfo info;
+    };
+
+    std::mutex cacheMutex;
+    std::unordered_map<mega::MegaHandle, Entry> entries;
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+
+public:
+    MediaInfo getMediaInfo(mega::MegaNode *n);
+    void clear();
+
+    unsigned long long getHits();
+    unsigned long long getMisses();
+};
+
+/**
+ * @brief The ExclusionMatcher class holds the excluded names compiled for local walks.
+ *
+ * Plain names, "*suffix" and "prefix*" patterns are looked up in hash sets, by length.
+ * The rest of wildcard patterns ('*' and '?') are merged into a single automaton,
+ * so that every name is matched against all of them in one pass.
+ */
+class ExclusionMatcher
+{
+private:
+    enum GlobStateType { GLOB_CHAR, GLOB_ANY, GLOB_STAR, GLOB_ACCEPT };
+    struct GlobState
+    {
+        GlobStateType type;
+        char c;
+    };
+
+    std::unordered_set<std::string> literals;
+    std::unordered_set<std::string> prefixes;
+    std::set<size_t> prefixLengths;
+    std::unordered_set<std::string> suffixes;
+    std::set<size_t> suffixLengths;
+    std::vector<GlobState> globStates;
+    std::vector<size_t> globStarts;
+
+    static std::atomic<long long> prunedEntries;
+    static std::atomic<long long> prunedBytes;
+
+    bool matchesGlobs(const std::string &name) const;
+
+public:
+    explicit ExclusionMatcher(const std::set<std::string> &patterns);
+
+    bool empty() const;
+    bool matches(const std::string &name) const;
+
+    /**
+     * @brief Checks whether an entry of a local walk is excluded, accounting it as pruned if so
+     * @param bytes size of the entry (0 for folders, whose contents are not visited)
+     */
+    bool prune(const std::string &name, long long bytes = 0) const;
+
+    static long long getPrunedEntries();
+    static long long getPrunedBytes();
+};
+
+/**
+ * @brief Identifies a version of a local file: its inode (file system id) and device (volume serial number on Windows),
+ * along with its size and modification time
+ */
+struct LocalFingerprintKey
+{
+    uint64_t inode;
+    int64_t size;
+    int64_t mtime;
+    uint64_t device;
+};
+
+/**
+ * @brief The LocalFingerprintCache class keeps the fingerprints of local files, indexed by device and inode,
+ * so that they are only recomputed when the size or modification time of a file changes.
+ *
+ * It is persisted into a file of fixed-size records in the configuration folder, which is memory-mapped
+ * (where available), so that loading it and updating it does not require reading or rewriting it entirely.
+ * The local path of each record is kept in a side file, so that records of files that are gone can be
+ * dropped: records whose path is not known are dropped when loading.
+ */
+class LocalFingerprintCache
+{
+private:
+    static const size_t FINGERPRINT_MAX_LENGTH = 64;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t recordSize;
+        uint32_t reserved;
+        uint64_t count;
+        uint64_t capacity;
+    };
+
+    struct Record
+    {
+        uint64_t device;
+        uint64_t inode;
+        int64_t size;
+        int64_t mtime;
+        char fingerprint[FINGERPRINT_MAX_LENGTH];
+    };
+
+    std::mutex cacheMutex;
+    std::string cacheFile;
+    bool loaded = false;
+
+    Header *header = nullptr;
+    Record *records = nullptr;
+    size_t mappedSize = 0;
+#ifdef _WIN32
+    std::vector<char> storage;
+#else
+    int fd = -1;
+#endif
+
+    typedef std::pair<uint64_t, uint64_t> FileId; // device and inode
+    struct FileIdHash
+    {
+        size_t operator()(const FileId &id) const { return std::hash<uint64_t>()(id.first * 0x9e3779b97f4a7c15ull ^ id.second); }
+    };
+
+    std::unordered_map<FileId, size_t, FileIdHash> index; // -> record
+    std::unordered_map<FileId, std::string, FileIdHash> knownPaths; // -> local path it was last looked up for
+    bool pathsChanged = false;
+
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+    unsigned long long invalidations = 0;
+
+    bool map(uint64_t capacity);
+    void unmap();
+    void removeRecord(size_t i);
+    void setKnownPath(const FileId &id, const std::string &localPath);
+    void loadKnownPaths();
+    void saveKnownPaths();
+
+public:
+    ~LocalFingerprintCache();
+
+    void load(const std::string &file);
+    void flush();
+
+    bool getFingerprint(const std::string &localPath, const LocalFingerprintKey &key, std::string *fingerprint);
+    void setFingerprint(const std::string &localPath, const LocalFingerprintKey &key, const std::string &fingerprint);
+
+    /**
+     * @brief Checks the local paths the cached fingerprints were looked up for, dropping the records of
+     * files that are gone, have been replaced (their path now has another inode) or have changed.
+     * @param statPath function that fills the key of a local path, returning false if it does not exist
+     * @return the number of records dropped
+     */
+    size_t verify(std::function<bool(const std::string &, LocalFingerprintKey *)> statPath);
+
+    size_t size();
+    unsigned long long getHits();
+    unsigned long long getMisses();
+    unsigned long long getInvalidations();
+};
+
+/**
+ * @brief The LocalBlockCache class keeps blocks of the contents of remote files in the configuration folder,
+ * so that reading them again does not require downloading them.
+ *
+ * Blocks are identified by node handle and offset, and written at their offset into a sparse file per node.
+ * The least recently used blocks are evicted once the cache exceeds its limit ("blockcache_size",
+ * 0 disables the cache), except those of pinned files, which altogether cannot exceed that limit.
+ * The blocks of a node are dropped if its fingerprint changes. Evictions are appended to the index
+ * before their space is given back, so that a reloaded index never lists a block no longer there.
+ */
+class LocalBlockCache
+{
+public:
+    static const long long BLOCK_SIZE = 1024 * 1024;
+
+private:
+    typedef std::pair<mega::MegaHandle, long long> BlockKey; // handle and block number
+
+    struct Block
+    {
+        size_t length;
+        std::list<BlockKey>::iterator lruPosition;
+    };
+
+    struct File
+    {
+        std::string fingerprint;
+        long long size = 0;
+        bool pinned = false;
+        size_t blocks = 0;
+    };
+
+    std::mutex cacheMutex;
+    std::string cacheFolder;
+    bool loaded = false;
+    long long limit = 0;
+    long long usedBytes = 0;
+
+    std::list<BlockKey> lru; // most recently used first
+    std::map<BlockKey, Block> blocks;
+    std::unordered_map<mega::MegaHandle, File> files;
+
+    unsigned long long hits = 0;
+    unsigned long long misses = 0;
+    unsigned long long bytesSaved = 0;
+
+    std::string blockFile(mega::MegaHandle h);
+    void dropIfChanged(mega::MegaHandle h, const std::string &fingerprint, long long size);
+    void removeBlock(std::map<BlockKey, Block>::iterator it);
+    void removeFile(mega::MegaHandle h);
+    void evict();
+    void saveIndex();
+
+public:
+    ~LocalBlockCache();
+
+    void load(const std::string &folder);
+    void flush();
+
+    bool isEnabled();
+    long long getLimit();
+    void setLimit(long long bytes);
+
+    static long long blockLength(long long fileSize, long long block);
+
+    bool hasBlock(mega::MegaHandle h, const std::string &fingerprint, long long size, long long block, bool countMiss = false);
+    bool readBlock(mega::MegaHandle h, const std::string &fingerprint, long long size, long long block, std::string *data);
+    void writeBlock(mega::MegaHandle h, const std::string &fingerprint, long long size, long long block, const char *data, size_t length);
+
+    bool setPinned(mega::MegaHandle h, const std::string &fingerprint, long long size, bool pinned);
+    std::vector<mega::MegaHandle> getPinned();
+    void clear();
+
+    long long getUsedBytes();
+    size_t getFileCount();
+    unsigned long long getHits();
+    unsigned long long getMisses();
+    unsigned long long getBytesSaved();
+};
+
+/**
+ * @brief The LocalChangeJournal class records the paths that change under a local folder
+ * (using inotify, where available), so that it does not need to be walked entirely to find them.
+ *
+ * If events are lost (queue overflow, not enough watches, too many pending changes), the journal
+ * is marked as overflowed and the next consumer has to fall back to a full scan.
+ */
+class LocalChangeJournal
+{
+private:
+    static const size_t MAX_PENDING_CHANGES = 1000000;
+
+    std::string root;
+    std::mutex journalMutex;
+    std::set<std::string> changedPaths;
+    bool overflowed = true; // nothing is known until the first full scan
+
+    unsigned long long events = 0;
+    unsigned long long incrementalScans = 0;
+    unsigned long long fullScans = 0;
+    int64_t lastFullScanMs = 0;
+    int64_t avoidedScanMs = 0;
+
+#ifdef __linux__
+    int inotifyFd = -1;
+    std::unordered_map<int, std::string> watchedFolders; // watch descriptor -> folder
+    std::thread readerThread;
+    std::atomic<bool> stopping{false};
+
+    void watchTree(const std::string &folder, bool recordFiles);
+    void unwatchTree(const std::string &folder);
+    void readEvents();
+#endif
+    void recordChange(const std::string &path);
+    void setOverflowed();
+
+public:
+    LocalChangeJournal(const std::string &root);
+    ~LocalChangeJournal();
+
+    /**
+     * @brief Starts watching the folder
+     * @return false if changes cannot be journaled in this platform or for this folder
+     */
+    bool start();
+
+    /**
+     * @brief Takes the paths changed since the last call
+     * @return false if they are unknown, and a full scan is required
+     */
+    bool takeChanges(std::set<std::string> *changed);
+
+    void recordFullScan(int64_t ms);
+    void recordIncrementalScan(int64_t ms);
+
+    size_t getPendingChanges();
+    unsigned long long getEvents();
+    unsigned long long getIncrementalScans();
+    unsigned long long getFullScans();
+    int64_t getAvoidedScanMs();
+};
+
+/**
+ * @brief The FileSizeIndex class groups the handles of files by size, to look for duplicates.
+ *
+ * It is filled in two passes: the sizes of all files are counted first into a fixed-size filter,
+ * and only files whose size may be repeated are then indexed. Memory grows with the groups of
+ * files sharing a size (the candidates to be duplicates) and the few false positives of the filter.
+ * It is split into shards, so that it can be filled from several threads.
+ */
+class FileSizeIndex
+{
+private:
+    struct SizeGroup
+    {
+        mega::MegaHandle first;
+        std::vector<mega::MegaHandle> others;
+    };
+
+    struct Shard
+    {
+        std::mutex shardMutex;
+        std::unordered_map<int64_t, SizeGroup> groups;
+    };
+
+    static const size_t NUM_SHARDS = 64;
+    Shard shards[NUM_SHARDS];
+
+    static const size_t FILTER_WORDS = (1 << 24) / 64; // 2^24 bits for each of the filters
+    std::unique_ptr<std::atomic<uint64_t>[]> seenOnce;
+    std::unique_ptr<std::atomic<uint64_t>[]> seenTwice;
+
+public:
+    FileSizeIndex();
+
+    /**
+     * @brief First pass: counts a file of this size
+     */
+    void count(int64_t size);
+
+    /**
+     * @brief Second pass: indexes a file, if its size may be shared with another one
+     */
+    void add(int64_t size, mega::MegaHandle h);
+
+    /**
+     * @brief Takes the groups of more than one file, sorted by descending size. The index is emptied.
+     */
+    std::vector<std::pair<int64_t, std::vector<mega::MegaHandle> > > takeCandidates();
+};
+
 }//end namespace
 #endif // MEGACMDUTILS_H
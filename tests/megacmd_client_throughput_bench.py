@@ -0,0 +1,161 @@
+#!/usr/bin/python
+# -*- coding: utf-8 -*-
+
+# Measures how fast the MEGAcmd client (mega-exec) receives output from the server,
+# and compares it with the raw speed of the same unix sockets.
+#
+# It impersonates the server (MEGAcmd server must NOT be running): no account nor network is involved.
+# Usage: megacmd_client_throughput_bench.py [--size=MB] [--chunk=KB] [--mega-exec=PATH]
+
+from __future__ import print_function
+import sys, os, socket, struct, threading, time, subprocess
+
+MCMD_OK = 0
+MCMD_PARTIALOUT = -62
+STATE_DELIMITER = b'\x1f'
+
+SIZE = 512 * 1024 * 1024
+CHUNK = 1024 * 1024
+MEGAEXEC = "mega-exec"
+
+for arg in sys.argv[1:]:
+    if arg.startswith("--size="):
+        SIZE = int(arg[len("--size="):]) * 1024 * 1024
+    elif arg.startswith("--chunk="):
+        CHUNK = int(arg[len("--chunk="):]) * 1024
+    elif arg.startswith("--mega-exec="):
+        MEGAEXEC = arg[len("--mega-exec="):]
+    else:
+        print("Usage: " + sys.argv[0] + " [--size=MB] [--chunk=KB] [--mega-exec=PATH]", file=sys.stderr)
+        exit(1)
+
+SOCKETS_FOLDER = "/tmp/megaCMD_%d" % os.getuid()
+PAYLOAD = (b'0123456789abcdef' * (CHUNK // 16 + 1))[:CHUNK]
+
+
+def listen_unix(path):
+    if os.path.exists(path):
+        os.unlink(path)
+    s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    s.bind(path)
+    s.listen(5)
+    return s
+
+
+class FakeServer(object):
+    """Speaks the petition protocol of the server: every petition gets a new socket, whose id is returned"""
+
+    def __init__(self):
+        if not os.path.isdir(SOCKETS_FOLDER):
+            os.makedirs(SOCKETS_FOLDER, 0o700)
+        probe = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            probe.connect(os.path.join(SOCKETS_FOLDER, "srv"))
+            print("MEGAcmd server seems to be running. Please, stop it before running this benchmark", file=sys.stderr)
+            exit(1)
+        except socket.error:
+            pass
+        finally:
+            probe.close()
+
+        self.mainsocket = listen_unix(os.path.join(SOCKETS_FOLDER, "srv"))
+        self.nextid = 1000
+        self.mode = "partial"
+        self.listeners = []
+        thread = threading.Thread(target=self.serve)
+        thread.daemon = True
+        thread.start()
+
+    def new_output_socket(self, conn):
+        self.nextid += 1
+        outsocket = listen_unix(os.path.join(SOCKETS_FOLDER, "srv_%d" % self.nextid))
+        conn.sendall(struct.pack("i", self.nextid))
+        conn.close()
+        out, _ = outsocket.accept()
+        outsocket.close()
+        os.unlink(os.path.join(SOCKETS_FOLDER, "srv_%d" % self.nextid))
+        return out
+
+    def serve(self):
+        while True:
+            conn, _ = self.mainsocket.accept()
+            petition = conn.recv(1024)
+            out = self.new_output_socket(conn)
+            if b"registerstatelistener" in petition:
+                out.sendall(b"prompt:MEGA CMD> " + STATE_DELIMITER)
+                self.listeners.append(out) # kept open: closing it would mean the server is down
+            elif self.mode == "partial":
+                sent = 0
+                while sent < SIZE:
+                    n = min(CHUNK, SIZE - sent)
+                    out.sendall(struct.pack("i", MCMD_PARTIALOUT) + struct.pack("N", n))
+                    out.sendall(PAYLOAD[:n])
+                    sent += n
+                out.sendall(struct.pack("i", MCMD_OK) + b'\0')
+                out.close()
+            else: # all the output sent as final output
+                out.sendall(struct.pack("i", MCMD_OK))
+                sent = 0
+                while sent < SIZE:
+                    n = min(CHUNK, SIZE - sent)
+                    out.sendall(PAYLOAD[:n])
+                    sent += n
+                out.close()
+
+
+def raw_socket_speed():
+    path = os.path.join(SOCKETS_FOLDER, "srv_bench_raw")
+    server = listen_unix(path)
+
+    def send():
+        conn, _ = server.accept()
+        sent = 0
+        while sent < SIZE:
+            n = min(CHUNK, SIZE - sent)
+            conn.sendall(PAYLOAD[:n])
+            sent += n
+        conn.close()
+
+    thread = threading.Thread(target=send)
+    thread.start()
+    client = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+    client.connect(path)
+    buf = bytearray(CHUNK)
+    received = 0
+    start = time.time()
+    while True:
+        n = client.recv_into(buf)
+        if not n:
+            break
+        received += n
+    elapsed = time.time() - start
+    thread.join()
+    client.close()
+    server.close()
+    os.unlink(path)
+    return received, elapsed
+
+
+def client_speed(server, mode, redirection):
+    server.mode = mode
+    start = time.time()
+    code = subprocess.call(MEGAEXEC + " cat benchmark " + redirection, shell=True)
+    elapsed = time.time() - start
+    if code:
+        print("mega-exec failed: " + str(code), file=sys.stderr)
+    return elapsed
+
+
+def report(title, size, elapsed):
+    print("%-45s %8.1f MB/s" % (title, size / (1024.0 * 1024.0) / max(elapsed, 1e-9)))
+
+
+server = FakeServer()
+print("Receiving %d MB in chunks of %d KB" % (SIZE // (1024 * 1024), CHUNK // 1024))
+
+received, elapsed = raw_socket_speed()
+report("raw unix socket", received, elapsed)
+report("mega-exec, partial outputs > /dev/null", SIZE, client_speed(server, "partial", "> /dev/null"))
+report("mega-exec, partial outputs | cat > /dev/null", SIZE, client_speed(server, "partial", "| cat > /dev/null"))
+report("mega-exec, final output > /dev/null", SIZE, client_speed(server, "final", "> /dev/null"))
+report("mega-exec, final output | cat > /dev/null", SIZE, client_speed(server, "final", "| cat > /dev/null"))